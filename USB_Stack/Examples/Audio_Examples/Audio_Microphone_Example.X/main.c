@@ -0,0 +1,324 @@
+/**
+ * @file main.c
+ * @brief Main C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Audio Microphone Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * USB uC BOOTLOADER INSTRUCTIONS
+ * 
+ * 1. SETUP PROJECT
+ * Right click on your MPLABX project, and select Properties. 
+ * Under XC8 global options, click XC8 linker. In the Option categories dropdown, 
+ * select Additional options. In the Codeoffset input, you need to put an 
+ * offset of 0x2000. (For PIC16F145X offset is in words, therefore 0x1000).
+ * 
+ * If you are using the a J Series bootloader:
+ * In the Option categories dropdown, select Memory Model. In the ROM ranges 
+ * input, you need to put a range starting from the Codeoffset (0x2000) to 1KB from last 
+ * byte in flash. e.g. For X7J53, 2000-1FBFF is used. This makes sure your code 
+ * isn't placed in the same Flash Page as the Config Words. That area is write 
+ * protected.
+ * 
+ * PIC18FX4J50: 2000-03BFF
+ * PIC18FX5J50: 2000-07BFF
+ * PIC18FX6J50: 2000-0FBFF
+ * PIC18FX6J53: 2000-0FBFF
+ * PIC18FX7J53: 2000-1FBFF
+ * 
+ * 2. DOWNLOAD FROM MPLABX
+ * You can get MPLABX to download your code every time you press build. 
+ * To set this up, right click on your MPLABX project, and select Properties. 
+ * Under Conf: "PROCESSOR", click Building. Check the "Execute this line after 
+ * build" box and place in this line of code (use the drive letter or name of 
+ * your device depending on OS):
+ * 
+ * Windows Example: cp ${ImagePath} E:\ 
+ *                  **Needs a space following "\".
+ * 
+ * OSX Example: cp ${ImagePath} /Volumes/PIC18FX7J53
+ * 
+ * Linux Example: cp ${ImagePath} /media/PIC18FX7J53
+ * 
+ * 3. START BOOTLOADER
+ * If you have previously loaded a program, reset your device or insert the USB 
+ * cable whilst holding down the bootloader button. The bootloader LED will 
+ * turn on to indicate "bootloader mode" is active. If no program is present, 
+ * just insert the USB cable.. Your PIC will now appear as a thumb drive.
+ * 
+ * 4. READ/ERASE
+ * If you've previously loaded a program, PROG_MEM.BIN file will exist on the 
+ * drive. You can use this file to view the raw binary of your program using a 
+ * hex editor. If you wish to erase your program, just delete this file. After 
+ * the erase completes, the bootloader will restart and you can load a new program.
+ * 
+ * 5. EEPROM READ/WRITE/ERASE
+ * For PICs that have EEPROM, a EEPROM.BIN file will also exist on the drive. 
+ * This file can be used to view your EEPROM and modify it's values. Open the 
+ * file in a hex editor, and modify any values and save the file. You can also 
+ * erase all the EEPROM values by deleting this file (the bootloader will restart, 
+ * and the file will reappear with blank EEPROM).
+ * 
+ * 6. DOWNLOAD
+ * To program, simply drag and drop your hex file or right click your hex file 
+ * and select send to PIC18F25K50 (for example). The bootloader will close and 
+ * instantly start running your code. Alternatively, as seen in step two, you 
+ * can get MPLABX to download the file automatically after a build.
+ * 
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "fuses.h"
+#include "config.h"
+#include "usb.h"
+#include "usb_audio.h"
+
+#if defined(_16F1454)
+#error "The Audio Microphone Example needs an ADC, PIC16F1454 doesn't have one."
+#endif
+
+#if defined(_18F47J53_FAMILY_) || defined(_18F2458) || defined(_18F4458) || defined(_18F2553) || defined(_18F4553)
+#define ADC_TO_SAMPLE(adc) ((int16_t)(((adc) - 2048u) << 4)) // 12-bit ADC.
+#else
+#define ADC_TO_SAMPLE(adc) ((int16_t)(((adc) - 512u) << 6)) // 10-bit ADC.
+#endif
+
+static void example_init(void);
+static void sample_timer_init(void);
+#ifdef USE_BOOT_LED
+static void flash_led(void);
+#endif
+static void __interrupt() isr(void);
+
+void main(void)
+{
+    example_init();
+    
+    #ifdef USE_BOOT_LED
+	LED_OFF();
+    LED_OUPUT();
+    flash_led();
+	#endif
+    
+    usb_init();
+    INTCONbits.PEIE = 1;
+    USB_INTERRUPT_FLAG = 0;
+    USB_INTERRUPT_ENABLE = 1;
+    INTCONbits.GIE = 1;
+    
+    sample_timer_init();
+    
+    while(1)
+    {
+        // Samples are taken and sent from the interrupt, nothing to do here.
+    }
+}
+
+static void example_init(void)
+{
+    // Oscillator Settings.
+    // PIC16F145X.
+    #if defined(_PIC14E)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 0xF;
+    #endif
+    #if XTAL_USED != MHz_12
+    OSCCONbits.SPLLMULT = 1;
+    #endif
+    OSCCONbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18FX450, PIC18FX550, and PIC18FX455.
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F14K50.
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    OSCTUNEbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F2XK50.
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 7;
+    #endif
+    #if (XTAL_USED != MHz_12)
+    OSCTUNEbits.SPLLMULT = 1;
+    #endif
+    OSCCON2bits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18F2XJ53 and PIC18F4XJ53.
+    #elif defined(__J_PART)
+    OSCTUNEbits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #endif
+
+    
+    // Make boot pin digital.
+    #if defined(BUTTON_ANSEL) 
+    BUTTON_ANSEL &= ~(1<<BUTTON_ANSEL_BIT);
+    #elif defined(BUTTON_ANCON)
+    BUTTON_ANCON |= (1<<BUTTON_ANCON_BIT);
+    #endif
+
+
+    // Apply pull-up.
+    #ifdef BUTTON_WPU
+    #if defined(_PIC14E)
+    WPUA = 0;
+    #if defined(_16F1459)
+    WPUB = 0;
+    #endif
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    OPTION_REGbits.nWPUEN = 0;
+    
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    LATB = 0;
+    LATD = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    #if BUTTON_RXPU_REG == INTCON2
+    INTCON2 &= 7F;
+    #else
+    PORTE |= 80;
+    #endif
+    
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    WPUA = 0;
+    WPUB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRABPU = 0;
+    
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    WPUB = 0;
+    TRISE &= 0x7F;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRBPU = 0;
+    
+    #elif defined(_18F24J50) || defined(_18F25J50) || defined(_18F26J50) || defined(_18F26J53) || defined(_18F27J53)
+    LATB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    
+    #elif defined(_18F44J50) || defined(_18F45J50) || defined(_18F46J50) || defined(_18F46J53) || defined(_18F47J53)
+    LATB = 0;
+    LATD = 0;
+    LATE = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    #endif
+    #endif
+    
+    
+    // Setup analog pin.
+    #if defined(_PIC14E)
+    ADCON0bits.CHS = 3; // AN3 (RA4).
+    ADCON1bits.ADCS = 0b110;
+    ADCON1bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    ADCON0bits.CHS = 10; // AN10 (RB4).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    ADCON2bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    ADCON0bits.CHS = 0; // AN0 (RA0).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    ADCON2bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #elif defined(_18F4550_FAMILY_) || defined(_18F4450_FAMILY_)
+    ADCON1bits.PCFG = 1; // RA0 analog pin
+    ADCON0bits.CHS = 0; // AN0 (RA0).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    ADCON2bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #elif defined(__J_PART)
+    ADCON0bits.CHS = 8; // AN8 (RB2).
+    ADCON1bits.ADCS = 0b110;
+    ADCON1bits.ACQT = 0b011;
+    ADCON1bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #endif
+}
+
+static void sample_timer_init(void)
+{
+    // TMR2 interrupt at AUDIO_SAMPLE_RATE (8kHz), Fosc/4 = 12MHz / 4 / 3 / 125.
+    PR2 = 124;
+    T2CON = 0x15; // Postscaler 1:3, on, prescaler 1:4.
+    PIR1bits.TMR2IF = 0;
+    PIE1bits.TMR2IE = 1;
+    ADCON0bits.GO_nDONE = 1;
+}
+
+#ifdef USE_BOOT_LED
+static void flash_led(void)
+{
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        LED_ON();
+        __delay_ms(500);
+        LED_OFF();
+        __delay_ms(500);
+    }
+}
+#endif
+
+void usb_sof(void)
+{
+    audio_sof();
+}
+
+static void __interrupt() isr(void)
+{
+    if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
+    {
+        usb_tasks();
+        USB_INTERRUPT_FLAG = 0;
+    }
+    
+    if(PIE1bits.TMR2IE && PIR1bits.TMR2IF)
+    {
+        // Sample started last period is done, start the next one.
+        uint16_t adc = ((uint16_t)ADRESH << 8) | ADRESL;
+        ADCON0bits.GO_nDONE = 1;
+        audio_put_sample(ADC_TO_SAMPLE(adc));
+        PIR1bits.TMR2IF = 0;
+    }
+}
\ No newline at end of file
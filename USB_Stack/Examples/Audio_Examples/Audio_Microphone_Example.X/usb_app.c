@@ -0,0 +1,86 @@
+/**
+ * @file usb_app.c
+ * @brief Contains application specific functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Application file (This file is for the Audio Microphone Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+ 
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_app.h"
+#include "usb_audio.h"
+
+
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [AUDIO_EP][IN] = NULL // Isochronous packets are armed from audio_sof(), not on completion.
+};
+#endif
+
+
+bool usb_service_class_request(void)
+{
+    return audio_class_request();
+}
+
+bool usb_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+{
+    return false; // Audio descriptors are all in the Configuration Descriptor.
+}
+
+
+void usb_app_init(void)
+{
+    audio_init();
+}
+
+
+void usb_app_tasks(void)
+{
+}
+
+
+void usb_app_clear_halt(uint8_t bd_table_index, uint8_t ep, uint8_t dir)
+{
+}
+
+
+bool usb_app_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    return audio_set_interface(alternate_setting, interface);
+}
+
+
+bool usb_app_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    return audio_get_interface(alternate_setting_result, interface);
+}
+
+
+bool usb_out_control_finished(void)
+{
+    return false;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file usb_audio_config.h
+ * @brief <i>Audio Class</i> 1.0 microphone settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Audio Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_AUDIO_CONFIG_H
+#define USB_AUDIO_CONFIG_H
+
+#include "usb_config.h"
+
+/* SETTINGS */
+// Interface numbers, the Audio Control interface is followed by its Audio 
+// Streaming interface.
+#define AUDIO_AC_INT 0
+#define AUDIO_AS_INT 1
+
+// Stream format, 16 bit PCM. The host reads one packet per frame, sized by 
+// how many samples came in during the last frame (asynchronous source).
+#define AUDIO_SAMPLE_RATE 8000 // Hz, 8000 to 48000.
+#define AUDIO_CHANNELS    1    // 1 or 2.
+
+// Audio Endpoint HAL
+#define AUDIO_EP EP1
+
+#ifdef _PIC14E
+#warning "Audio EP Buffer addresses have been manually set for PIC16 devices."
+#endif
+
+#endif /* USB_AUDIO_CONFIG_H */
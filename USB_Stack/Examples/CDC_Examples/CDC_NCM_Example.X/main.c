@@ -0,0 +1,427 @@
+/**
+ * @file main.c
+ * @brief Main C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * CDC NCM Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * USB uC BOOTLOADER INSTRUCTIONS
+ * 
+ * 1. SETUP PROJECT
+ * Right click on your MPLABX project, and select Properties. 
+ * Under XC8 global options, click XC8 linker. In the Option categories dropdown, 
+ * select Additional options. In the Codeoffset input, you need to put an 
+ * offset of 0x2000. (For PIC16F145X offset is in words, therefore 0x1000).
+ * 
+ * If you are using the a J Series bootloader:
+ * In the Option categories dropdown, select Memory Model. In the ROM ranges 
+ * input, you need to put a range starting from the Codeoffset (0x2000) to 1KB from last 
+ * byte in flash. e.g. For X7J53, 2000-1FBFF is used. This makes sure your code 
+ * isn't placed in the same Flash Page as the Config Words. That area is write 
+ * protected.
+ * 
+ * PIC18FX4J50: 2000-03BFF
+ * PIC18FX5J50: 2000-07BFF
+ * PIC18FX6J50: 2000-0FBFF
+ * PIC18FX6J53: 2000-0FBFF
+ * PIC18FX7J53: 2000-1FBFF
+ * 
+ * 2. DOWNLOAD FROM MPLABX
+ * You can get MPLABX to download your code every time you press build. 
+ * To set this up, right click on your MPLABX project, and select Properties. 
+ * Under Conf: "PROCESSOR", click Building. Check the "Execute this line after 
+ * build" box and place in this line of code (use the drive letter or name of 
+ * your device depending on OS):
+ * 
+ * Windows Example: cp ${ImagePath} E:\ 
+ *                  **Needs a space following "\".
+ * 
+ * OSX Example: cp ${ImagePath} /Volumes/PIC18FX7J53
+ * 
+ * Linux Example: cp ${ImagePath} /media/PIC18FX7J53
+ * 
+ * 3. START BOOTLOADER
+ * If you have previously loaded a program, reset your device or insert the USB 
+ * cable whilst holding down the bootloader button. The bootloader LED will 
+ * turn on to indicate "bootloader mode" is active. If no program is present, 
+ * just insert the USB cable.. Your PIC will now appear as a thumb drive.
+ * 
+ * 4. READ/ERASE
+ * If you've previously loaded a program, PROG_MEM.BIN file will exist on the 
+ * drive. You can use this file to view the raw binary of your program using a 
+ * hex editor. If you wish to erase your program, just delete this file. After 
+ * the erase completes, the bootloader will restart and you can load a new program.
+ * 
+ * 5. EEPROM READ/WRITE/ERASE
+ * For PICs that have EEPROM, a EEPROM.BIN file will also exist on the drive. 
+ * This file can be used to view your EEPROM and modify it's values. Open the 
+ * file in a hex editor, and modify any values and save the file. You can also 
+ * erase all the EEPROM values by deleting this file (the bootloader will restart, 
+ * and the file will reappear with blank EEPROM).
+ * 
+ * 6. DOWNLOAD
+ * To program, simply drag and drop your hex file or right click your hex file 
+ * and select send to PIC18F25K50 (for example). The bootloader will close and 
+ * instantly start running your code. Alternatively, as seen in step two, you 
+ * can get MPLABX to download the file automatically after a build.
+ * 
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "fuses.h"
+#include "config.h"
+#include "usb.h"
+#include "usb_cdc_ncm.h"
+
+/*
+ * The device end of the link answers ARP and ping on NET_IP, give the host's 
+ * USB Ethernet interface an address on the same subnet, e.g. 192.168.7.2/24.
+ */
+#define NET_IP  {192, 168, 7, 1}
+#define NET_MAC {0x02, 0x00, 0x00, 0x00, 0x00, 0x02} // Device side, the host side is iMACAddress.
+
+// Frame offsets.
+#define ETH_DST       0
+#define ETH_SRC       6
+#define ETH_TYPE      12
+#define ETH_HDR_LEN   14
+#define ARP_OPER      (ETH_HDR_LEN + 6)
+#define ARP_SHA       (ETH_HDR_LEN + 8)
+#define ARP_SPA       (ETH_HDR_LEN + 14)
+#define ARP_THA       (ETH_HDR_LEN + 18)
+#define ARP_TPA       (ETH_HDR_LEN + 24)
+#define ARP_LEN       (ETH_HDR_LEN + 28)
+#define IP_VER_IHL    ETH_HDR_LEN
+#define IP_TOTAL_LEN  (ETH_HDR_LEN + 2)
+#define IP_TTL        (ETH_HDR_LEN + 8)
+#define IP_PROTOCOL   (ETH_HDR_LEN + 9)
+#define IP_CHECKSUM   (ETH_HDR_LEN + 10)
+#define IP_SRC        (ETH_HDR_LEN + 12)
+#define IP_DST        (ETH_HDR_LEN + 16)
+#define IP_HDR_LEN    20
+#define ICMP_TYPE     (ETH_HDR_LEN + IP_HDR_LEN)
+#define ICMP_CHECKSUM (ETH_HDR_LEN + IP_HDR_LEN + 2)
+
+#define ETH_TYPE_IP   0x0800
+#define ETH_TYPE_ARP  0x0806
+#define ARP_REQUEST   1
+#define ARP_REPLY     2
+#define IP_ICMP       1
+#define ICMP_ECHO     8
+#define ICMP_REPLY    0
+
+static uint8_t m_ip[4]  = NET_IP;  // In RAM, copied with usb_ram_copy().
+static uint8_t m_mac[6] = NET_MAC;
+
+static void example_init(void);
+static bool net_input(const uint8_t* p_frame, uint16_t len);
+static bool arp_input(const uint8_t* p_frame, uint16_t len);
+static bool icmp_input(const uint8_t* p_frame, uint16_t len);
+static uint16_t get_be16(const uint8_t* p);
+static void put_be16(uint8_t* p, uint16_t val);
+static uint16_t checksum(const uint8_t* p, uint16_t len);
+static bool match(const uint8_t* p_a, const uint8_t* p_b, uint8_t len);
+#ifdef USE_BOOT_LED
+static void flash_led(void);
+#endif
+static void __interrupt() isr(void);
+
+void main(void)
+{
+    example_init();
+    
+    #ifdef USE_BOOT_LED
+	LED_OFF();
+    LED_OUPUT();
+    flash_led();
+	#endif
+    
+    usb_init();
+    INTCONbits.PEIE = 1;
+    USB_INTERRUPT_FLAG = 0;
+    USB_INTERRUPT_ENABLE = 1;
+    INTCONbits.GIE = 1;
+    
+    while(1)
+    {
+        uint16_t len;
+        uint8_t* p_frame;
+        
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+        
+        if(usb_get_state() != STATE_CONFIGURED) continue;
+        
+        cdc_net_tasks();
+        
+        // Frames are parsed in the RX buffer and replies built in the TX buffer, NCM 
+        // sends the replies to a whole NTB together once it has been released.
+        while((p_frame = cdc_net_rx_frame(&len)) != NULL)
+        {
+            if(!net_input(p_frame, len)) break; // No room for the reply yet, try again.
+            cdc_net_rx_release();
+        }
+    }
+}
+
+/**
+ * Returns false if a reply is needed but the TX buffer is busy, the frame is 
+ * kept until the next pass. Anything not for us is dropped (returns true).
+ */
+static bool net_input(const uint8_t* p_frame, uint16_t len)
+{
+    if(len < ETH_HDR_LEN) return true;
+    
+    switch(get_be16(&p_frame[ETH_TYPE]))
+    {
+        case ETH_TYPE_ARP:
+            return arp_input(p_frame, len);
+        case ETH_TYPE_IP:
+            return icmp_input(p_frame, len);
+        default:
+            return true;
+    }
+}
+
+static bool arp_input(const uint8_t* p_frame, uint16_t len)
+{
+    uint8_t* p_reply;
+    
+    if(len < ARP_LEN || get_be16(&p_frame[ARP_OPER]) != ARP_REQUEST) return true;
+    if(!match(&p_frame[ARP_TPA], m_ip, 4)) return true;
+    
+    if((p_reply = cdc_net_tx_acquire(ARP_LEN)) == NULL) return false;
+    
+    usb_ram_copy((uint8_t*)p_frame, p_reply, ARP_LEN); // Hardware and protocol types.
+    usb_ram_copy((uint8_t*)&p_frame[ETH_SRC], &p_reply[ETH_DST], 6);
+    usb_ram_copy(m_mac, &p_reply[ETH_SRC], 6);
+    put_be16(&p_reply[ARP_OPER], ARP_REPLY);
+    usb_ram_copy(m_mac, &p_reply[ARP_SHA], 6);
+    usb_ram_copy(m_ip, &p_reply[ARP_SPA], 4);
+    usb_ram_copy((uint8_t*)&p_frame[ARP_SHA], &p_reply[ARP_THA], 10); // THA and TPA.
+    cdc_net_tx_commit(ARP_LEN);
+    return true;
+}
+
+static bool icmp_input(const uint8_t* p_frame, uint16_t len)
+{
+    uint8_t* p_reply;
+    uint16_t ip_len;
+    
+    if(len < (ICMP_TYPE + 8) || p_frame[IP_VER_IHL] != 0x45) return true; // IPv4 without options.
+    if(p_frame[IP_PROTOCOL] != IP_ICMP || p_frame[ICMP_TYPE] != ICMP_ECHO) return true;
+    if(!match(&p_frame[IP_DST], m_ip, 4)) return true;
+    ip_len = get_be16(&p_frame[IP_TOTAL_LEN]);
+    if(ip_len < (IP_HDR_LEN + 8) || (ETH_HDR_LEN + ip_len) > len) return true;
+    len = ETH_HDR_LEN + ip_len;
+    
+    if((p_reply = cdc_net_tx_acquire(len)) == NULL) return false;
+    
+    // The echo data is the only copy, copied in chunks as usb_ram_copy() takes a byte count.
+    for(uint16_t i = 0; i < len; i += 255)
+    {
+        uint16_t left = len - i;
+        usb_ram_copy((uint8_t*)&p_frame[i], &p_reply[i], (left > 255) ? 255 : (uint8_t)left);
+    }
+    usb_ram_copy((uint8_t*)&p_frame[ETH_SRC], &p_reply[ETH_DST], 6);
+    usb_ram_copy(m_mac, &p_reply[ETH_SRC], 6);
+    usb_ram_copy((uint8_t*)&p_frame[IP_SRC], &p_reply[IP_DST], 4);
+    usb_ram_copy(m_ip, &p_reply[IP_SRC], 4);
+    p_reply[IP_TTL] = 64;
+    put_be16(&p_reply[IP_CHECKSUM], 0);
+    put_be16(&p_reply[IP_CHECKSUM], checksum(&p_reply[ETH_HDR_LEN], IP_HDR_LEN));
+    p_reply[ICMP_TYPE] = ICMP_REPLY;
+    put_be16(&p_reply[ICMP_CHECKSUM], 0);
+    put_be16(&p_reply[ICMP_CHECKSUM], checksum(&p_reply[ICMP_TYPE], ip_len - IP_HDR_LEN));
+    cdc_net_tx_commit(len);
+    return true;
+}
+
+static uint16_t get_be16(const uint8_t* p)
+{
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static void put_be16(uint8_t* p, uint16_t val)
+{
+    p[0] = (uint8_t)(val >> 8);
+    p[1] = (uint8_t)val;
+}
+
+static uint16_t checksum(const uint8_t* p, uint16_t len)
+{
+    uint32_t sum = 0;
+    
+    for(uint16_t i = 0; i < len; i += 2)
+    {
+        sum += (uint16_t)p[i] << 8;
+        if((i + 1) < len) sum += p[i + 1];
+    }
+    while(sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+static bool match(const uint8_t* p_a, const uint8_t* p_b, uint8_t len)
+{
+    for(uint8_t i = 0; i < len; i++)
+    {
+        if(p_a[i] != p_b[i]) return false;
+    }
+    return true;
+}
+
+static void example_init(void)
+{
+    // Oscillator Settings.
+    // PIC16F145X.
+    #if defined(_PIC14E)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 0xF;
+    #endif
+    #if XTAL_USED != MHz_12
+    OSCCONbits.SPLLMULT = 1;
+    #endif
+    OSCCONbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18FX450, PIC18FX550, and PIC18FX455.
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F14K50.
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    OSCTUNEbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F2XK50.
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 7;
+    #endif
+    #if (XTAL_USED != MHz_12)
+    OSCTUNEbits.SPLLMULT = 1;
+    #endif
+    OSCCON2bits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18F2XJ53 and PIC18F4XJ53.
+    #elif defined(__J_PART)
+    OSCTUNEbits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #endif
+
+    
+    // Make boot pin digital.
+    #if defined(BUTTON_ANSEL) 
+    BUTTON_ANSEL &= ~(1<<BUTTON_ANSEL_BIT);
+    #elif defined(BUTTON_ANCON)
+    BUTTON_ANCON |= (1<<BUTTON_ANCON_BIT);
+    #endif
+
+
+    // Apply pull-up.
+    #ifdef BUTTON_WPU
+    #if defined(_PIC14E)
+    WPUA = 0;
+    #if defined(_16F1459)
+    WPUB = 0;
+    #endif
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    OPTION_REGbits.nWPUEN = 0;
+    
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    LATB = 0;
+    LATD = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    #if BUTTON_RXPU_REG == INTCON2
+    INTCON2 &= 7F;
+    #else
+    PORTE |= 80;
+    #endif
+    
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    WPUA = 0;
+    WPUB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRABPU = 0;
+    
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    WPUB = 0;
+    TRISE &= 0x7F;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRBPU = 0;
+    
+    #elif defined(_18F24J50) || defined(_18F25J50) || defined(_18F26J50) || defined(_18F26J53) || defined(_18F27J53)
+    LATB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    
+    #elif defined(_18F44J50) || defined(_18F45J50) || defined(_18F46J50) || defined(_18F46J53) || defined(_18F47J53)
+    LATB = 0;
+    LATD = 0;
+    LATE = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    #endif
+    #endif
+}
+
+#ifdef USE_BOOT_LED
+static void flash_led(void)
+{
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        LED_ON();
+        __delay_ms(500);
+        LED_OFF();
+        __delay_ms(500);
+    }
+}
+#endif
+
+void usb_sof(void)
+{
+}
+
+static void __interrupt() isr(void)
+{
+    if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
+    {
+        usb_tasks();
+        USB_INTERRUPT_FLAG = 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+/**
+ * @file usb_app.c
+ * @brief Contains application specific functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Application file (This file is for the CDC NCM Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+ 
+#include <stdbool.h>
+#include "usb.h"
+#include "usb_app.h"
+#include "usb_cdc_ncm.h"
+
+
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [CDC_COM_EP][IN]  = cdc_net_ep_tasks,
+    [CDC_DAT_EP][OUT] = cdc_net_ep_tasks,
+    [CDC_DAT_EP][IN]  = cdc_net_ep_tasks
+};
+#endif
+
+
+bool usb_service_class_request(void)
+{
+    return cdc_net_class_request();
+}
+
+bool usb_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+{
+    return false; // CDC descriptors are all in the Configuration Descriptor.
+}
+
+
+void usb_app_init(void)
+{
+    cdc_net_init();
+}
+
+
+void usb_app_tasks(void)
+{
+    if(TRANSACTION_EP == CDC_COM_EP || TRANSACTION_EP == CDC_DAT_EP) cdc_net_ep_tasks();
+}
+
+
+void usb_app_clear_halt(uint8_t bd_table_index, uint8_t ep, uint8_t dir)
+{
+    if(ep == CDC_COM_EP || ep == CDC_DAT_EP) cdc_net_clear_halt(bd_table_index, ep, dir);
+}
+
+
+bool usb_app_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    return cdc_net_set_interface(alternate_setting, interface);
+}
+
+
+bool usb_app_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    return cdc_net_get_interface(alternate_setting_result, interface);
+}
+
+
+bool usb_out_control_finished(void)
+{
+    return false;
+}
\ No newline at end of file
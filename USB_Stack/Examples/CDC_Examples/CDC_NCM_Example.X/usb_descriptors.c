@@ -0,0 +1,155 @@
+/**
+ * @file usb_descriptors.c
+ * @brief Contains core USB stack descriptors stored in ROM.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Stack (This file is for the CDC NCM Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_config.h"
+#include "usb_ch9.h"
+#include "usb_cdc_ncm.h"
+
+/** Device Descriptor */
+const ch9_device_descriptor_t g_device_descriptor =
+{
+    0x12,                 // bLength:8 -  Size of descriptor in bytes
+    DEVICE_DESC,          // bDescriptorType:8  - Device descriptor type
+    0x0200,               // bcdUSB:16 -  USB in BCD (2.00H)
+    MISC_CLASS,           // bDeviceClass:8 - The function is described by its IAD
+    MISC_COMMON_SUBCLASS, // bDeviceSubClass:8
+    MISC_IAD_PROTOCOL,    // bDeviceProtocol:8
+    EP0_SIZE,             // bMaxPacketSize0:8 - Maximum packet size
+    0x04D8,               // idVendor:16 - Microchip VID = 0x04D8
+    0x0059,               // idProduct:16 - Product ID (PID) = 0x0059
+    0x0100,               // bcdDevice:16 - Device release number in BCD
+    0x01,                 // iManufacturer:8 - Manufacturer string index
+    0x02,                 // iProduct:8 - Product string index
+    0x00,                 // iSerialNumber:8 - Device serial number string index
+    0x01                  // bNumConfigurations:8 - Number of possible configurations
+};
+
+/** Configuration Descriptor Structure */
+typedef struct
+{
+    ch9_configutarion_descriptor_t configuration0_descriptor;
+    cdc_net_function_descriptors_t cdc_net_function;
+}config_descriptor_t;
+
+/** Configuration Descriptor */
+static const config_descriptor_t config_descriptor0 =
+{
+    CH9_CONFIGURATION_DESCRIPTOR(sizeof(config_descriptor0), 2, 1, 0x80, 50), // Bus Powered, 100mA
+    CDC_NET_FUNCTION_DESCRIPTORS(8)
+};
+
+/** Configuration Descriptor Addresses Array */
+const uint16_t g_config_descriptors[] = 
+{
+    (uint16_t)&config_descriptor0
+};
+
+#ifdef USE_FAST_ENUMERATION
+/** Configuration Descriptor Lengths Array */
+const uint16_t g_config_descriptor_lengths[] =
+{
+    sizeof(config_descriptor0)
+};
+#endif
+
+/** String Zero Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t wLANGID[1];
+}string_zero_descriptor_t;
+
+/** Vendor String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[6];
+}vendor_string_descriptor_t;
+
+/** Product String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[12];
+}product_string_descriptor_t;
+
+/** MAC Address String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[12];
+}mac_string_descriptor_t;
+    
+/** String Zero Descriptor */
+static const string_zero_descriptor_t string_zero_descriptor =
+{
+    sizeof(string_zero_descriptor_t),
+    STRING_DESC,
+    {0x0409}
+};
+
+/** Vendor String Descriptor */
+static const vendor_string_descriptor_t vendor_string_descriptor =
+{
+    sizeof(vendor_string_descriptor_t),
+    STRING_DESC,
+    {'J','o','h','n','n','y'}
+};
+
+/** Product String Descriptor */
+static const product_string_descriptor_t product_string_descriptor =
+{
+    sizeof(product_string_descriptor_t),
+    STRING_DESC,
+    {'U','S','B',' ','E','t','h','e','r','n','e','t'}
+};
+
+/** MAC Address String Descriptor, the host side of the link (locally administered) */
+static const mac_string_descriptor_t mac_string_descriptor =
+{
+    sizeof(mac_string_descriptor_t),
+    STRING_DESC,
+    {'0','2','0','0','0','0','0','0','0','0','0','1'}
+};
+
+/** String Descriptor Addresses Array */
+const uint16_t g_string_descriptors[] =
+{
+    (uint16_t)&string_zero_descriptor,
+    (uint16_t)&vendor_string_descriptor,
+    (uint16_t)&product_string_descriptor,
+    (uint16_t)&mac_string_descriptor
+};
+
+/** String Descriptor Addresses Array Size */
+const uint8_t g_size_of_sd = sizeof(g_string_descriptors);
+
@@ -106,6 +106,9 @@ static void serial_print_string(char* string);
 static void serial_echo(void);
 static void send(uint8_t amount);
 static void receive(void);
+#ifdef USE_TRACE
+static void serial_print_trace(void);
+#endif
 
 static bool volatile m_serial_pkt_sent = true;
 static bool volatile m_serial_pkt_rcv = false;
@@ -131,7 +134,11 @@ void main(void)
         
         // Hello World Example
         while(BUTTON_RELEASED){}
+        #ifdef USE_TRACE
+        serial_print_trace(); // Trace Example: prints the trace ring instead.
+        #else
         serial_print_string("Hello World!\r\n");
+        #endif
         while(BUTTON_PRESSED){}
         
         // Loop-back Example
@@ -272,9 +279,9 @@ void cdc_set_control_line_state(void)
 
 }
 
-void cdc_set_line_coding(void)
+bool cdc_set_line_coding(void)
 {
-    
+    return true;
 }
 
 void cdc_data_out(void)
@@ -315,12 +322,51 @@ static void send(uint8_t amount)
 {
     m_serial_pkt_sent = false;
     cdc_arm_data_ep_in(amount);
-    while(!m_serial_pkt_sent){}
+    while(!m_serial_pkt_sent)
+    {
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks(); // The handler sets m_serial_pkt_sent.
+        #endif
+    }
 }
 
 static void receive(void)
 {
-    while(!m_serial_pkt_rcv){}
+    while(!m_serial_pkt_rcv)
+    {
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+    }
     m_serial_pkt_rcv = false;
     cdc_arm_data_ep_out();
-}
\ No newline at end of file
+}
+
+#ifdef USE_TRACE
+static void serial_print_trace(void)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    usb_trace_entry_t entry;
+    char line[13];
+    
+    // One "EE UU TTTT" line per entry: event, USTAT and TRACE_TIMER in hex. 
+    // Only what's in the ring now is printed, printing adds entries of its own.
+    for(uint8_t entries = g_usb_trace_count; entries && usb_trace_read(&entry, 1); entries--)
+    {
+        line[0]  = hex[entry.Event >> 4];
+        line[1]  = hex[entry.Event & 0xF];
+        line[2]  = ' ';
+        line[3]  = hex[entry.Last_USTAT >> 4];
+        line[4]  = hex[entry.Last_USTAT & 0xF];
+        line[5]  = ' ';
+        line[6]  = hex[entry.Time >> 12];
+        line[7]  = hex[(entry.Time >> 8) & 0xF];
+        line[8]  = hex[(entry.Time >> 4) & 0xF];
+        line[9]  = hex[entry.Time & 0xF];
+        line[10] = '\r';
+        line[11] = '\n';
+        line[12] = 0;
+        serial_print_string(line);
+    }
+}
+#endif
\ No newline at end of file
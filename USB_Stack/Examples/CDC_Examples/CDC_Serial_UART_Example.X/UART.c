@@ -37,16 +37,68 @@
 #define UART2_SPBRGH_DEFAULT (UART2_SPBRG_DEFAULT / 256)
 #endif /* BAUD_8BITS */
 
+/* BAUD TABLE (integer only, folded by the compiler) */
+#ifdef BAUD_8BITS
+#define UART_BRG_DIV 16
+#define UART_BRG_MAX 0xFF
+#else
+#define UART_BRG_DIV 4
+#define UART_BRG_MAX 0xFFFF
+#endif /* BAUD_8BITS */
+#define UART_BRG_NONE  0xFFFF // Rate can't be reached from _XTAL_FREQ (never a valid 8-bit value, a 16-bit one is 
+                              // below the lowest table rate).
+#define UART_BRG_CLK   ((uint32_t)_XTAL_FREQ / UART_BRG_DIV)
+#define UART_BRG_N(baud)    ((UART_BRG_CLK + ((baud) / 2)) / (baud)) // SPBRG + 1, rounded.
+#define UART_BRG_DIFF(baud) ((UART_BRG_N(baud) * (baud)) > UART_BRG_CLK ? \
+                             (UART_BRG_N(baud) * (baud)) - UART_BRG_CLK : UART_BRG_CLK - (UART_BRG_N(baud) * (baud)))
+#define UART_BRG_OK(baud)   ((UART_BRG_N(baud) != 0) && (UART_BRG_N(baud) <= (UART_BRG_MAX + 1UL)) && \
+                             (UART_BRG_DIFF(baud) <= (UART_BRG_CLK / UART_BAUD_ERROR_DIV)))
+#define UART_BRG_ENTRY(baud) {baud, UART_BRG_OK(baud) ? (uint16_t)(UART_BRG_N(baud) - 1) : UART_BRG_NONE}
+
 #include <xc.h>
 #include "uart.h"
 
+typedef struct
+{
+    uint32_t baud;
+    uint16_t brg; // SPBRGH:SPBRG, or UART_BRG_NONE.
+}baud_entry_t;
+
+static const baud_entry_t m_baud_table[] =
+{
+    UART_BRG_ENTRY(300UL),     UART_BRG_ENTRY(1200UL),    UART_BRG_ENTRY(2400UL),    UART_BRG_ENTRY(4800UL),
+    UART_BRG_ENTRY(9600UL),    UART_BRG_ENTRY(19200UL),   UART_BRG_ENTRY(38400UL),   UART_BRG_ENTRY(57600UL),
+    UART_BRG_ENTRY(115200UL),  UART_BRG_ENTRY(230400UL),  UART_BRG_ENTRY(460800UL),  UART_BRG_ENTRY(921600UL),
+    UART_BRG_ENTRY(1000000UL), UART_BRG_ENTRY(1500000UL), UART_BRG_ENTRY(2000000UL), UART_BRG_ENTRY(3000000UL)
+};
+
+#ifdef UART1_USE_RINGS
+#if (UART1_RX_RING_SIZE & (UART1_RX_RING_SIZE - 1)) || (UART1_TX_RING_SIZE & (UART1_TX_RING_SIZE - 1)) ||     (UART1_RX_RING_SIZE > 128) || (UART1_TX_RING_SIZE > 128)
+#error "UART1_RX_RING_SIZE and UART1_TX_RING_SIZE must be a power of 2, up to 128."
+#endif
+
+/* RING BUFFERS (indexes are free running, used = head - tail) */
+static uint8_t          m_rx1_ring[UART1_RX_RING_SIZE];
+static volatile uint8_t m_rx1_head; // Written by the ISR.
+static volatile uint8_t m_rx1_tail;
+static uint8_t          m_tx1_ring[UART1_TX_RING_SIZE];
+static volatile uint8_t m_tx1_head;
+static volatile uint8_t m_tx1_tail; // Written by the ISR.
+#endif
+
 /* STATIC PROTOTYPES */
+static uint16_t baud_calc(uint32_t baud);
 static void    init1(void);
 static void    set_baud1(uint16_t baud_calc);
 static bool    data_ready1(void);
 static bool    tx_idle1(void);
 static uint8_t read1(void);
 static void    write1(uint8_t byte);
+static uint8_t hw_read1(void);
+#ifdef UART1_USE_RINGS
+static void    isr1(void);
+static void    rx_release1(void);
+#endif
 
 static void    init2(void);
 static void    set_baud2(uint16_t baud_calc);
@@ -79,24 +131,26 @@ void uart__init(uint8_t uart)
 
 void uart__set_baud(uint8_t uart, uint16_t baud)
 {
-    #if BAUD_8BITS
-    uint16_t baud_calc = (uint16_t)UART_SPBRG_CALC_8(_XTAL_FREQ, baud);
-    #else
-    uint16_t baud_calc = (uint16_t)UART_SPBRG_CALC_16(_XTAL_FREQ, baud);
-    #endif
+    uart__set_baud_rate(uart, baud);
+}
+
+bool uart__set_baud_rate(uint8_t uart, uint32_t baud)
+{
+    uint16_t brg = baud_calc(baud);
+    if(brg == UART_BRG_NONE) return false; // Leave the UART on its last good rate.
 
     switch(uart)
     {
         case 0:
-            set_baud1(baud_calc);
-            break;
+            set_baud1(brg);
+            return true;
         #if NUM_UARTS >= 2
         case 1:
-            set_baud2(baud_calc);
-            break;
+            set_baud2(brg);
+            return true;
         #endif
         default:
-            break; // This uart doesn't exist.
+            return false; // This uart doesn't exist.
     }
 }
 
@@ -196,7 +250,75 @@ void uart__write_string(uint8_t uart, uint8_t* string)
     }
 }
 
+#ifdef UART1_USE_RINGS
+void uart__isr(uint8_t uart)
+{
+    if(uart == 0) isr1(); // Only UART1 has rings.
+}
+
+void uart__tasks(uint8_t uart)
+{
+    if(uart != 0) return;
+    #ifdef UART1_USE_RTS_CTS
+    if(UART1_CTS == UART1_CTS_ACTIVE && m_tx1_head != m_tx1_tail) PIE1bits.TXIE = 1; // Restart TX stopped by CTS.
+    #endif
+}
+
+uint8_t uart__available(uint8_t uart)
+{
+    if(uart != 0) return 0;
+    return (uint8_t)(m_rx1_head - m_rx1_tail);
+}
+
+uint8_t uart__read_block(uint8_t uart, uint8_t* p_data, uint8_t len)
+{
+    uint8_t used;
+    
+    if(uart != 0) return 0;
+    used = (uint8_t)(m_rx1_head - m_rx1_tail);
+    if(len > used) len = used;
+    for(uint8_t i = 0; i < len; i++) p_data[i] = m_rx1_ring[(uint8_t)(m_rx1_tail + i) & (UART1_RX_RING_SIZE - 1)];
+    m_rx1_tail += len;
+    rx_release1();
+    return len;
+}
+
+uint8_t uart__write_block(uint8_t uart, const uint8_t* p_data, uint8_t len)
+{
+    uint8_t space;
+    
+    if(uart != 0) return 0;
+    space = UART1_TX_RING_SIZE - (uint8_t)(m_tx1_head - m_tx1_tail);
+    if(len > space) len = space;
+    for(uint8_t i = 0; i < len; i++) m_tx1_ring[(uint8_t)(m_tx1_head + i) & (UART1_TX_RING_SIZE - 1)] = p_data[i];
+    m_tx1_head += len;
+    if(len) PIE1bits.TXIE = 1;
+    return len;
+}
+#endif
+
 /* STATIC FUNCTIONS */
+static uint16_t baud_calc(uint32_t baud)
+{
+    uint32_t n;
+    uint32_t diff;
+    
+    // Standard rates, no division.
+    for(uint8_t i = 0; i < (sizeof(m_baud_table) / sizeof(baud_entry_t)); i++)
+    {
+        if(m_baud_table[i].baud == baud) return m_baud_table[i].brg;
+    }
+    
+    // Anything else, one integer division.
+    if(baud == 0) return UART_BRG_NONE;
+    n = (UART_BRG_CLK + (baud >> 1)) / baud;
+    if(n == 0 || n > (UART_BRG_MAX + 1UL)) return UART_BRG_NONE;
+    diff = n * baud;
+    diff = diff > UART_BRG_CLK ? diff - UART_BRG_CLK : UART_BRG_CLK - diff;
+    if(diff > (UART_BRG_CLK / UART_BAUD_ERROR_DIV)) return UART_BRG_NONE;
+    return (uint16_t)(n - 1);
+}
+
 static void init1(void)
 {
     #ifdef HAS_PPS1
@@ -220,6 +342,19 @@ static void init1(void)
     TXSTAbits.TXEN = 1; // Enable transmitter.
     RCSTAbits.CREN = 1; // Enable Receiver.
     RCSTAbits.SPEN = 1; // Enable serial port.
+    
+    #ifdef UART1_USE_RINGS
+    m_rx1_head = 0;
+    m_rx1_tail = 0;
+    m_tx1_head = 0;
+    m_tx1_tail = 0;
+    #ifdef UART1_USE_RTS_CTS
+    UART1_RTS = UART1_RTS_ACTIVE;
+    UART1_RTS_TRIS = 0;
+    #endif
+    PIE1bits.TXIE = 0;
+    PIE1bits.RCIE = 1;
+    #endif
 }
 
 static void set_baud1(uint16_t baud_calc)
@@ -230,6 +365,82 @@ static void set_baud1(uint16_t baud_calc)
     #endif
 }
 
+#ifdef UART1_USE_RINGS
+static bool data_ready1(void)
+{
+    return m_rx1_head != m_rx1_tail;
+}
+
+static bool tx_idle1(void)
+{
+    return (uint8_t)(m_tx1_head - m_tx1_tail) < UART1_TX_RING_SIZE; // Room in the TX ring.
+}
+
+static uint8_t read1(void)
+{
+    uint8_t byte;
+    
+    if(m_rx1_head == m_rx1_tail) return 0;
+    byte = m_rx1_ring[m_rx1_tail & (UART1_RX_RING_SIZE - 1)];
+    m_rx1_tail++;
+    rx_release1();
+    return byte;
+}
+
+static void write1(uint8_t byte)
+{
+    while((uint8_t)(m_tx1_head - m_tx1_tail) >= UART1_TX_RING_SIZE){} // Wait for room.
+    m_tx1_ring[m_tx1_head & (UART1_TX_RING_SIZE - 1)] = byte;
+    m_tx1_head++;
+    PIE1bits.TXIE = 1;
+}
+
+static void isr1(void)
+{
+    uint8_t byte;
+    
+    // Empty the RX FIFO.
+    while(PIE1bits.RCIE && PIR1bits.RCIF)
+    {
+        if(RCSTAbits.OERR || RCSTAbits.FERR)
+        {
+            hw_read1(); // Clears the error, the byte is dropped.
+            continue;
+        }
+        byte = RCREG;
+        if((uint8_t)(m_rx1_head - m_rx1_tail) < UART1_RX_RING_SIZE)
+        {
+            m_rx1_ring[m_rx1_head & (UART1_RX_RING_SIZE - 1)] = byte;
+            m_rx1_head++;
+        } // Otherwise the ring is full and the byte is lost, the other end ignored RTS.
+        #ifdef UART1_USE_RTS_CTS
+        if((uint8_t)(m_rx1_head - m_rx1_tail) >= UART1_RX_HIGH_WATER) UART1_RTS = UART1_RTS_ACTIVE ^ 1;
+        #endif
+    }
+    
+    if(PIE1bits.TXIE && PIR1bits.TXIF)
+    {
+        if(m_tx1_head == m_tx1_tail) PIE1bits.TXIE = 0; // Nothing left to send.
+        #ifdef UART1_USE_RTS_CTS
+        else if(UART1_CTS != UART1_CTS_ACTIVE) PIE1bits.TXIE = 0; // Restarted by uart__tasks().
+        #endif
+        else
+        {
+            TXREG = m_tx1_ring[m_tx1_tail & (UART1_TX_RING_SIZE - 1)];
+            m_tx1_tail++;
+        }
+    }
+}
+
+static void rx_release1(void)
+{
+    #ifdef UART1_USE_RTS_CTS
+    PIE1bits.RCIE = 0; // Stop the ISR changing RTS in between.
+    if((uint8_t)(m_rx1_head - m_rx1_tail) <= UART1_RX_LOW_WATER) UART1_RTS = UART1_RTS_ACTIVE;
+    PIE1bits.RCIE = 1;
+    #endif
+}
+#else
 static bool data_ready1(void)
 {
     return PIR1bits.RCIF;
@@ -241,6 +452,17 @@ static bool tx_idle1(void)
 }
 
 static uint8_t read1(void)
+{
+    return hw_read1();
+}
+
+static void write1(uint8_t byte)
+{
+    TXREG = byte;
+}
+#endif
+
+static uint8_t hw_read1(void)
 {
     volatile uint8_t temp;
     if(RCSTAbits.OERR)
@@ -261,11 +483,6 @@ static uint8_t read1(void)
     return RCREG;
 }
 
-static void write1(uint8_t byte)
-{
-    TXREG = byte;
-}
-
 #if NUM_UARTS >= 2
 static void init2(void)
 {
@@ -36,6 +36,7 @@ extern "C" {
 
 void    uart__init(uint8_t uart);
 void    uart__set_baud(uint8_t uart, uint16_t baud);
+bool    uart__set_baud_rate(uint8_t uart, uint32_t baud); // false if _XTAL_FREQ can't make it to 2%.
 bool    uart__data_ready(uint8_t uart);
 bool    uart__tx_idle(uint8_t uart);
 uint8_t uart__read(uint8_t uart);
@@ -43,6 +44,14 @@ void    uart__read_string(uint8_t uart, uint8_t* output, uint8_t* delimiter, uin
 void    uart__write(uint8_t uart, uint8_t byte);
 void    uart__write_string(uint8_t uart, uint8_t* string);
 
+#ifdef UART1_USE_RINGS
+void    uart__isr(uint8_t uart);
+void    uart__tasks(uint8_t uart);
+uint8_t uart__available(uint8_t uart);
+uint8_t uart__read_block(uint8_t uart, uint8_t* p_data, uint8_t len);
+uint8_t uart__write_block(uint8_t uart, const uint8_t* p_data, uint8_t len);
+#endif
+
 #ifdef	__cplusplus
 }
 #endif /* __cplusplus */
@@ -104,18 +104,38 @@ static void flash_led(void);
 #endif
 static void __interrupt() isr(void);
 static void vcp_tasks(void);
+#ifndef UART1_USE_RINGS
 static void uart_tx_byte(void);
+#endif
+#ifndef USE_CDC_RINGS
 static void copy_ep_out_to_tx_buffer(void);
 static void copy_rx_buffer_to_ep_in(void);
+#endif
 
 #define RX_BUFFER_SIZE 64
 #define TX_BUFFER_SIZE 64
 
+#if defined(UART1_USE_RINGS) && !defined(USE_CDC_RINGS)
+#error "UART1_USE_RINGS needs USE_CDC_RINGS in usb_cdc_config.h"
+#endif
+#if defined(UART1_USE_RTS_CTS) && defined(USE_RTS)
+#error "Use either UART1_USE_RTS_CTS or USE_RTS, not both"
+#endif
+
+#ifndef USE_CDC_RINGS
 static bool volatile m_serial_pkt_sent = true;
 static bool volatile m_serial_pkt_rcv = false;
+#endif
 
+#if !defined(USE_CDC_RINGS) || defined(UART1_USE_RINGS)
 static uint8_t m_rx_buffer[RX_BUFFER_SIZE];
+#endif
+#ifndef USE_CDC_RINGS
 static uint8_t m_rx_index = 0;
+#elif defined(UART1_USE_RINGS)
+static uint8_t m_rx_offset = 0;
+static uint8_t m_rx_cnt = 0;
+#endif
 static bool volatile m_rx_buffer_almost_full = false;
 
 static uint8_t m_tx_buffer[TX_BUFFER_SIZE];
@@ -150,6 +170,9 @@ void main(void)
     
     while(1)
     {
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
         while(usb_get_state() < STATE_CONFIGURED){} // Pause if not configured or suspended.
         vcp_tasks();
     }
@@ -159,6 +182,9 @@ void main(void)
 
 static void __interrupt() isr(void)
 {
+    #ifdef UART1_USE_RINGS
+    uart__isr(0);
+    #endif
     if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
     {
         usb_tasks();
@@ -296,13 +322,12 @@ void cdc_set_control_line_state(void)
     #endif
 }
 
-void cdc_set_line_coding(void)
+bool cdc_set_line_coding(void)
 {
-    uint16_t calc_SPBRG = (uint16_t)((_XTAL_FREQ / (g_cdc_set_line_coding.dwDTERate << 2)) - 1);
-    SPBRG  = (uint8_t)calc_SPBRG;
-    SPBRGH = (uint8_t)(calc_SPBRG >> 8);
+    return uart__set_baud_rate(0, g_cdc_set_line_coding.dwDTERate);
 }
 
+#ifndef USE_CDC_RINGS
 void cdc_data_out(void)
 {
     m_serial_pkt_rcv = true;
@@ -312,6 +337,14 @@ void cdc_data_in(void)
 {
     m_serial_pkt_sent = true;
 }
+#endif
+
+#if defined(USE_CDC_RINGS) && defined(USE_SOF)
+void usb_sof(void)
+{
+    cdc_service_sof();
+}
+#endif
 
 void cdc_notification(void)
 {
@@ -322,6 +355,59 @@ void cdc_notification(void)
 
 static void vcp_tasks(void)
 {
+    #if defined(USE_CDC_RINGS) && defined(UART1_USE_RINGS)
+    // Refill from the UART's RX ring once the last block has been taken by CDC's TX ring.
+    if(m_rx_offset == m_rx_cnt)
+    {
+        m_rx_cnt = uart__read_block(0, m_rx_buffer, RX_BUFFER_SIZE);
+        m_rx_offset = 0;
+    }
+    if(m_rx_offset != m_rx_cnt)
+    {
+        m_rx_offset += cdc_write(&m_rx_buffer[m_rx_offset], m_rx_cnt - m_rx_offset); // Whatever doesn't fit is kept for next time.
+        #ifndef USE_SOF
+        if(m_rx_offset == m_rx_cnt && !uart__available(0)) cdc_flush();
+        #endif
+    }
+    
+    // If UART's TX ring has taken the last block, take what's been received on the CDC endpoint.
+    if(!m_tx_to_cpy)
+    {
+        m_tx_to_cpy = cdc_read(m_tx_buffer, TX_BUFFER_SIZE);
+        m_tx_index = 0;
+    }
+    #ifdef USE_DTR
+    if(m_tx_to_cpy && DSR == DSR_ACTIVE) // Block if DSR is not active.
+    #else
+    if(m_tx_to_cpy)
+    #endif
+    {
+        uint8_t written = uart__write_block(0, &m_tx_buffer[m_tx_index], m_tx_to_cpy);
+        m_tx_index += written;
+        m_tx_to_cpy -= written;
+    }
+    uart__tasks(0);
+    #elif defined(USE_CDC_RINGS)
+    uint8_t rx_byte;
+    
+    // If UART packet received, add to CDC's TX ring. Full packets go out straight away, 
+    // what's left is flushed by cdc_service_sof() (or straight away once the UART goes quiet, without USE_SOF).
+    if(PIR1bits.RCIF)
+    {
+        rx_byte = uart__read(0);
+        cdc_write(&rx_byte, 1); // If the ring is full, data will be lost.
+        #ifndef USE_SOF
+        if(!PIR1bits.RCIF) cdc_flush();
+        #endif
+    }
+    
+    // If UART currently has no data to send, take what's been received on the CDC endpoint.
+    if(!m_tx_to_cpy)
+    {
+        m_tx_to_cpy = cdc_read(m_tx_buffer, TX_BUFFER_SIZE);
+        m_tx_index = 0;
+    }
+    #else
     // If UART packet received, add to m_rx_buffer.
     if(PIR1bits.RCIF)
     {
@@ -353,7 +439,9 @@ static void vcp_tasks(void)
         copy_ep_out_to_tx_buffer();
         cdc_arm_data_ep_out();
     }
+    #endif
 
+    #ifndef UART1_USE_RINGS
     // If there is data in m_tx_buffer, send one byte over UART.
     if(m_tx_to_cpy)
     {
@@ -370,6 +458,7 @@ static void vcp_tasks(void)
         uart_tx_byte();
         #endif
     }
+    #endif
 
     #ifdef USE_DTR
     if((DSR ^ DSR_ACTIVE) == g_cdc_serial_state.bTxCarrier) // Detect change on DSR.
@@ -390,12 +479,15 @@ static void vcp_tasks(void)
     #endif
 }
 
+#ifndef UART1_USE_RINGS
 static void uart_tx_byte(void)
 {
     uart__write(0, m_tx_buffer[m_tx_index++]);
     m_tx_to_cpy--;
 }
+#endif
 
+#ifndef USE_CDC_RINGS
 static void copy_ep_out_to_tx_buffer(void)
 {
     m_tx_to_cpy = g_cdc_num_data_out;        // Number of bytes to grab from EP.
@@ -408,4 +500,5 @@ static void copy_rx_buffer_to_ep_in(void)
     usb_ram_copy(m_rx_buffer, g_cdc_dat_ep_in, m_rx_index);
     cdc_arm_data_ep_in(m_rx_index);
     m_rx_index = 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -28,6 +28,22 @@
 
 #define UART1_BAUD 9600
 #define UART2_BAUD 9600
+#define UART_BAUD_ERROR_DIV 50 // uart__set_baud_rate() refuses rates more than 1/50 (2%) off.
+
+// UART1 RING BUFFER SETTINGS
+//#define UART1_USE_RINGS           // RX and TX are interrupt driven through rings, uart__isr() must 
+                                    // be called from the interrupt, RCIE/TXIE are used.
+#define UART1_RX_RING_SIZE 64       // Power of 2, up to 128.
+#define UART1_TX_RING_SIZE 64       // Power of 2, up to 128.
+//#define UART1_USE_RTS_CTS         // RTS follows the RX ring watermarks, TX waits for CTS 
+                                    // (call uart__tasks() to restart it).
+#define UART1_RX_HIGH_WATER (UART1_RX_RING_SIZE - 16) // RTS made inactive from here.
+#define UART1_RX_LOW_WATER  (UART1_RX_RING_SIZE / 2)  // RTS made active again from here.
+#define UART1_RTS        LATBbits.LATB3
+#define UART1_RTS_TRIS   TRISBbits.TRISB3
+#define UART1_CTS        PORTBbits.RB4
+#define UART1_RTS_ACTIVE 0
+#define UART1_CTS_ACTIVE 0
 
 #if defined(_16F1454) || defined(_16F1455)
 #define BAUD_16BITS
@@ -31,6 +31,16 @@
 #include "usb_cdc.h"
 
 
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [CDC_COM_EP][IN]  = cdc_com_ep_in_tasks,
+    [CDC_DAT_EP][OUT] = cdc_dat_ep_out_tasks,
+    [CDC_DAT_EP][IN]  = cdc_dat_ep_in_tasks
+};
+#endif
+
+
 bool usb_service_class_request(void)
 {
     return cdc_class_request();
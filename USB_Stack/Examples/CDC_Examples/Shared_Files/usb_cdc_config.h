@@ -84,6 +84,47 @@
 /* ************************************************************************** */
 
 
+/* ************************************************************************** */
+/* ************************* RING BUFFER SETTINGS *************************** */
+/* ************************************************************************** */
+
+//#define USE_CDC_RINGS       // CDC library owns the DATA Endpoints, use cdc_read(), cdc_write(), 
+                              // cdc_available() and cdc_flush(). Needed for PINGPONG_1_15/ALL_EP.
+#define CDC_RX_RING_SIZE 64   // Power of 2, CDC_DAT_EP_SIZE to 128.
+#define CDC_TX_RING_SIZE 64   // Power of 2, CDC_DAT_EP_SIZE to 128.
+#define CDC_TX_FLUSH_FRAMES 2 // With USE_SOF, cdc_service_sof() flushes the TX ring once no 
+                              // cdc_write() has been made for this many frames (1ms each).
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************* MULTIPLE PORT SETTINGS ************************* */
+/* ************************************************************************** */
+
+//#define USE_CDC_PORTS       // Build usb_cdc_ports.c instead of usb_cdc_acm.c, CDC_NUM_PORTS virtual COM 
+                              // ports, each with its own rings and line coding (port p = EP(1 + 2p) and EP(2 + 2p)).
+#define CDC_NUM_PORTS 2       // 1 to 3, port p uses interfaces CDC_COM_INT + 2p and CDC_COM_INT + 2p + 1.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************* NETWORK (NCM/ECM) SETTINGS ********************* */
+/* ************************************************************************** */
+
+//#define USE_CDC_NCM           // Build usb_cdc_ncm.c instead of usb_cdc_acm.c, the device is a USB 
+                                // Ethernet adapter batching frames in NTBs (CDC-NCM).
+//#define USE_CDC_ECM           // As USE_CDC_NCM, one frame per transfer (CDC-ECM), for older macOS hosts.
+#define CDC_NET_MAX_SEGMENT_SIZE 590 // wMaxSegmentSize, the largest Ethernet frame (MTU + 14).
+#define CDC_NET_RX_SIZE          640 // Bytes, receives a whole OUT NTB (NCM) or frame (ECM).
+#define CDC_NET_TX_SIZE          640 // Bytes, the IN NTB (NCM) or frame (ECM) being built or sent.
+#define CDC_NET_TX_MAX_DATAGRAMS 4   // NCM, frames batched into one IN NTB.
+#define CDC_NET_MAC_STRING       3   // iMACAddress, String Descriptor index of the host side MAC (12 hex digits).
+
+/* ************************************************************************** */
+
+
 /* ************************************************************************** */
 /* ***************************** CDC INTERFACE ****************************** */
 /* ************************************************************************** */
@@ -111,9 +152,15 @@
 /* *************************** CDC BD LOCATIONS ***************************** */
 /* ************************************************************************** */
 
-#define CDC_COM_BD_IN  BD1_IN
-#define CDC_DAT_BD_OUT BD2_OUT
-#define CDC_DAT_BD_IN  BD2_IN
+#define CDC_COM_BD_IN       BD1_IN
+#define CDC_COM_BD_IN_EVEN  BD1_IN_EVEN
+#define CDC_COM_BD_IN_ODD   BD1_IN_ODD
+#define CDC_DAT_BD_OUT      BD2_OUT
+#define CDC_DAT_BD_OUT_EVEN BD2_OUT_EVEN
+#define CDC_DAT_BD_OUT_ODD  BD2_OUT_ODD
+#define CDC_DAT_BD_IN       BD2_IN
+#define CDC_DAT_BD_IN_EVEN  BD2_IN_EVEN
+#define CDC_DAT_BD_IN_ODD   BD2_IN_ODD
 
 /* ************************************************************************** */
 
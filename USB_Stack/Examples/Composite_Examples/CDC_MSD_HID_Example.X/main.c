@@ -0,0 +1,593 @@
+/**
+ * @file main.c
+ * @brief Main C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * CDC MSD HID Composite Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * USB uC BOOTLOADER INSTRUCTIONS
+ * 
+ * 1. SETUP PROJECT
+ * Right click on your MPLABX project, and select Properties. 
+ * Under XC8 global options, click XC8 linker. In the Option categories dropdown, 
+ * select Additional options. In the Codeoffset input, you need to put an 
+ * offset of 0x2000. (For PIC16F145X offset is in words, therefore 0x1000).
+ * 
+ * If you are using the a J Series bootloader:
+ * In the Option categories dropdown, select Memory Model. In the ROM ranges 
+ * input, you need to put a range starting from the Codeoffset (0x2000) to 1KB from last 
+ * byte in flash. e.g. For X7J53, 2000-1FBFF is used. This makes sure your code 
+ * isn't placed in the same Flash Page as the Config Words. That area is write 
+ * protected.
+ * 
+ * PIC18FX4J50: 2000-03BFF
+ * PIC18FX5J50: 2000-07BFF
+ * PIC18FX6J50: 2000-0FBFF
+ * PIC18FX6J53: 2000-0FBFF
+ * PIC18FX7J53: 2000-1FBFF
+ * 
+ * 2. DOWNLOAD FROM MPLABX
+ * You can get MPLABX to download your code every time you press build. 
+ * To set this up, right click on your MPLABX project, and select Properties. 
+ * Under Conf: "PROCESSOR", click Building. Check the "Execute this line after 
+ * build" box and place in this line of code (use the drive letter or name of 
+ * your device depending on OS):
+ * 
+ * Windows Example: cp ${ImagePath} E:\ 
+ *                  **Needs a space following "\".
+ * 
+ * OSX Example: cp ${ImagePath} /Volumes/PIC18FX7J53
+ * 
+ * Linux Example: cp ${ImagePath} /media/PIC18FX7J53
+ * 
+ * 3. START BOOTLOADER
+ * If you have previously loaded a program, reset your device or insert the USB 
+ * cable whilst holding down the bootloader button. The bootloader LED will 
+ * turn on to indicate "bootloader mode" is active. If no program is present, 
+ * just insert the USB cable.. Your PIC will now appear as a thumb drive.
+ * 
+ * 4. READ/ERASE
+ * If you've previously loaded a program, PROG_MEM.BIN file will exist on the 
+ * drive. You can use this file to view the raw binary of your program using a 
+ * hex editor. If you wish to erase your program, just delete this file. After 
+ * the erase completes, the bootloader will restart and you can load a new program.
+ * 
+ * 5. EEPROM READ/WRITE/ERASE
+ * For PICs that have EEPROM, a EEPROM.BIN file will also exist on the drive. 
+ * This file can be used to view your EEPROM and modify it's values. Open the 
+ * file in a hex editor, and modify any values and save the file. You can also 
+ * erase all the EEPROM values by deleting this file (the bootloader will restart, 
+ * and the file will reappear with blank EEPROM).
+ * 
+ * 6. DOWNLOAD
+ * To program, simply drag and drop your hex file or right click your hex file 
+ * and select send to PIC18F25K50 (for example). The bootloader will close and 
+ * instantly start running your code. Alternatively, as seen in step two, you 
+ * can get MPLABX to download the file automatically after a build.
+ * 
+ */
+
+/*
+ * Configuration 1, the one hosts pick, has four functions:
+ * Interfaces 0 and 1 (EP1 and EP2) - CDC ACM serial port, echoes what it receives.
+ * Interface 2 (EP3)                - MSD drive with HELLO.TXT, read only.
+ * Interface 3 (EP4)                - HID vendor reports, the HID Custom example's commands.
+ * Interface 4 (EP0 only)           - Run-Time DFU, "dfu-util -e" restarts into the DFU 
+ *                                    Bootloader Example, which takes the update.
+ * 
+ * Configuration 2 (on Linux, echo 2 > /sys/bus/usb/devices/<port>/bConfigurationValue) 
+ * leaves out HID and DFU, and the serial port echoes whole lines instead, once Enter 
+ * is received. The HID reports and the line are never in use together, so they share 
+ * g_usb_arena (USE_ARENA), 128 bytes instead of 256.
+ * 
+ * usb_descriptors.c builds the configurations from each class's function descriptors, 
+ * and usb_app.c routes requests by interface (g_usb_if_handlers) and transactions by 
+ * endpoint (g_usb_ep_handlers).
+ */
+
+/* Emulated FAT12 File System
+             ______________
+    0x00000 |              |
+            |  BOOT SECT   | 0x200 (512B)
+    0x001FF |______________|
+    0x00200 |              |
+            |   FAT SECT   | 0x200 (512B)
+    0x003FF |______________|
+    0x00400 |              |
+            |  ROOT SECT   | 0x200 (512B)
+    0x005FF |______________|
+    0x00600 |              |
+            |  DATA SECT   | 0x1FA00 (126.5KB)
+    0x1FFFF |______________|
+
+ */
+
+#define BOOT_SECT_ADDR 0
+#define FAT_SECT_ADDR  1
+#define ROOT_SECT_ADDR 2
+#define DATA_SECT_ADDR 3
+#define FILE_SECT_ADDR DATA_SECT_ADDR
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "fuses.h"
+#include "config.h"
+#include "usb.h"
+#include "usb_cdc.h"
+#include "usb_msd.h"
+#include "usb_hid.h"
+#include "usb_dfu.h"
+#include "usb_hid_reports.h"
+
+typedef enum
+{
+    COMMAND_TOGGLE_LED = 0x80,
+    COMMAND_GET_BUTTON_STATUS = 0x81,
+    COMMAND_READ_POTENTIOMETER = 0x37
+}hid_custom_example_commands_t;
+
+/** Boot Sector */
+typedef struct
+{
+    uint8_t  jmpBoot[3];
+    uint8_t  OEMName[8];
+    uint16_t BytesPerSec;
+    uint8_t  SecPerClus;
+    uint16_t RsvdSecCnt;
+    uint8_t  NumFATs;
+    uint16_t RootEntCnt;
+    uint16_t TotSec16;
+    uint8_t  Media;
+    uint16_t FATSz16;
+    uint16_t SecPerTrk;
+    uint16_t NumHeads;
+    uint32_t HiddSec;
+    uint32_t TotSec32;
+    uint8_t  DrvNum;
+    uint8_t  Reserved1;
+    uint8_t  BootSig;
+    uint8_t  VolID[4];
+    uint8_t  VolLab[11];
+    uint8_t  FilSysType[8];
+}BOOT16_t;
+
+static const BOOT16_t boot16 =
+{
+    {0xEB,0x3C,0x90},
+    {'M','S','D','O','S','5','.','0'},
+    BYTES_PER_BLOCK_LE,
+    1,
+    1,
+    1,
+    16,
+    VOL_CAPACITY_IN_BLOCKS,
+    0xF8,
+    1,
+    0,
+    0,
+    0,
+    0,
+    0,
+    0,
+    0x29,
+    {0x86,0xE8,0xA3,0x56},
+    {'U','S','B',' ','D','R','I','V','E',' ',' '},
+    {'F','A','T','1','6',' ',' ',' '}
+};
+
+/** Directory Entry Structure */
+typedef struct
+{
+    uint8_t  Name[11];
+    uint8_t  Attr;
+    uint8_t  NTRes;
+    uint8_t  CrtTimeTenth;
+    uint16_t CrtTime;
+    uint16_t CrtDate;
+    uint16_t LstAccDate;
+    uint16_t FstClusHI;
+    uint16_t WrtTime;
+    uint16_t WrtDate;
+    uint16_t FstClusLO;
+    uint32_t FileSize;
+}DIR_ENTRY_t;
+
+/** Root Directory Structure */
+typedef struct
+{
+    DIR_ENTRY_t VOL;
+    DIR_ENTRY_t FILE1;
+}ROOT_DIR_t;
+
+static const uint8_t file[] = "Hello World!";
+
+/** Volume Root Entry */
+static const ROOT_DIR_t root =
+{
+    {
+        {'U','S','B',' ','D','R','I','V','E',' ',' '},
+        0x08,
+        0,
+        0,
+        0x7BA0,
+        0x4B0B,
+        0x4B0B,
+        0,
+        0x7BA0,
+        0x4B0B,
+        0,
+        0
+    },
+    {
+       {'H','E','L','L','O',' ',' ',' ','T','X','T'},
+        0x20,
+        0,
+        0,
+        0x7BA0,
+        0x4B0B,
+        0x4B0B,
+        0,
+        0x7BA0,
+        0x4B0B,
+        2,
+        sizeof(file)
+    }
+};
+
+static void example_init(void);
+#ifdef USE_BOOT_LED
+static void flash_led(void);
+#endif
+static void __interrupt() isr(void);
+static void serial_echo(void);
+static void serial_lines(void);
+static void line_clear(void);
+static void hid_commands(void);
+
+static volatile bool m_out_event = false;
+
+#define LINE_SIZE 128 // Longest line serial_lines() echoes whole.
+#ifdef USE_ARENA
+#define m_line USB_ARENA_ARRAY(uint8_t, LINE_SIZE, line, 0) // Configuration 2 only.
+#else
+static uint8_t m_line[LINE_SIZE];
+#endif
+static uint8_t m_line_len;  // Bytes in m_line.
+static uint8_t m_line_sent; // Bytes of a finished line placed in the TX ring.
+static bool    m_line_done; // m_line ends in Enter, or is full.
+
+void main(void)
+{
+    example_init();
+    
+    // Setup analog pin.
+    #if defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    ADCON0bits.CHS = 0; // AN0 (RA0).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    ADCON2bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #elif defined(_18F4550_FAMILY_) || defined(_18F4450_FAMILY_)
+    ADCON1bits.PCFG = 1; // RA0 analog pin
+    ADCON0bits.CHS = 0; // AN0 (RA0).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    ADCON2bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #elif defined(__J_PART)
+    ADCON0bits.CHS = 8; // AN8 (RB2).
+    ADCON1bits.ADCS = 0b110;
+    ADCON1bits.ACQT = 0b011;
+    ADCON1bits.ADFM = 1;
+    ADCON0bits.ADON = 1;
+    #endif
+
+    #ifdef USE_BOOT_LED
+    LED_OFF();
+    LED_OUPUT();
+    flash_led();
+    #endif
+    
+    usb_init();
+    INTCONbits.PEIE = 1;
+    USB_INTERRUPT_FLAG = 0;
+    USB_INTERRUPT_ENABLE = 1;
+    INTCONbits.GIE = 1;
+    
+    while(1)
+    {
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+        dfu_tasks();
+        if(usb_get_state() < STATE_CONFIGURED) continue; // Pause if not configured or suspended.
+        
+        // Each function is serviced in turn, none of them block.
+        msd_tasks();
+        if(usb_get_configuration() == 1)
+        {
+            serial_echo();
+            hid_commands();
+            line_clear(); // The HID reports are in m_line's RAM.
+        }
+        else serial_lines();
+    }
+    
+    return;
+}
+
+static void __interrupt() isr(void)
+{
+    if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
+    {
+        usb_tasks();
+        USB_INTERRUPT_FLAG = 0;
+    }
+}
+
+static void example_init(void)
+{
+    // Oscillator Settings.
+    // PIC16F145X.
+    #if defined(_PIC14E)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 0xF;
+    #endif
+    #if XTAL_USED != MHz_12
+    OSCCONbits.SPLLMULT = 1;
+    #endif
+    OSCCONbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18FX450, PIC18FX550, and PIC18FX455.
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F14K50.
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    OSCTUNEbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F2XK50.
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 7;
+    #endif
+    #if (XTAL_USED != MHz_12)
+    OSCTUNEbits.SPLLMULT = 1;
+    #endif
+    OSCCON2bits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18F2XJ53 and PIC18F4XJ53.
+    #elif defined(__J_PART)
+    OSCTUNEbits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #endif
+
+    
+    // Make boot pin digital.
+    #if defined(BUTTON_ANSEL) 
+    BUTTON_ANSEL &= ~(1<<BUTTON_ANSEL_BIT);
+    #elif defined(BUTTON_ANCON)
+    BUTTON_ANCON |= (1<<BUTTON_ANCON_BIT);
+    #endif
+
+
+    // Apply pull-up.
+    #ifdef BUTTON_WPU
+    #if defined(_PIC14E)
+    WPUA = 0;
+    #if defined(_16F1459)
+    WPUB = 0;
+    #endif
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    OPTION_REGbits.nWPUEN = 0;
+    
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    LATB = 0;
+    LATD = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    #if BUTTON_RXPU_REG == INTCON2
+    INTCON2 &= 7F;
+    #else
+    PORTE |= 80;
+    #endif
+    
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    WPUA = 0;
+    WPUB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRABPU = 0;
+    
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    WPUB = 0;
+    TRISE &= 0x7F;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRBPU = 0;
+    
+    #elif defined(_18F24J50) || defined(_18F25J50) || defined(_18F26J50) || defined(_18F26J53) || defined(_18F27J53)
+    LATB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    
+    #elif defined(_18F44J50) || defined(_18F45J50) || defined(_18F46J50) || defined(_18F46J53) || defined(_18F47J53)
+    LATB = 0;
+    LATD = 0;
+    LATE = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    #endif
+    #endif
+}
+
+#ifdef USE_BOOT_LED
+static void flash_led(void)
+{
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        LED_ON();
+        __delay_ms(500);
+        LED_OFF();
+        __delay_ms(500);
+    }
+}
+#endif
+
+static void serial_echo(void)
+{
+    uint8_t buffer[CDC_DAT_EP_SIZE];
+    uint8_t cnt = cdc_read(buffer, sizeof(buffer));
+    
+    if(cnt) cdc_write(buffer, cnt); // Sent by cdc_service_sof() once the host stops sending.
+}
+
+static void serial_lines(void)
+{
+    if(m_line_done)
+    {
+        m_line_sent += cdc_write(&m_line[m_line_sent], m_line_len - m_line_sent);
+        if(m_line_sent != m_line_len) return; // TX ring full, the rest goes next time.
+        line_clear();
+    }
+    
+    while(m_line_len < sizeof(m_line))
+    {
+        if(cdc_read(&m_line[m_line_len], 1) == 0) return;
+        if(m_line[m_line_len++] == '\r') break;
+    }
+    m_line_done = true;
+}
+
+static void line_clear(void)
+{
+    m_line_len = 0;
+    m_line_sent = 0;
+    m_line_done = false;
+}
+
+static void hid_commands(void)
+{
+    if(!m_out_event) return;
+    
+    switch(g_hid_out_report1.array[0])
+    {
+        case COMMAND_TOGGLE_LED:
+            #ifdef USE_BOOT_LED
+            LED_LAT ^= (1 << LED_BIT);
+            #endif
+            break;
+        case COMMAND_GET_BUTTON_STATUS:
+            if(g_hid_report_sent != true) return; // Try again once the last report has gone.
+
+            g_hid_in_report1.array[0] = COMMAND_GET_BUTTON_STATUS;
+            g_hid_in_report1.array[1] = BUTTON_PRESSED ? false : true;
+            hid_send_report(0);
+            break;
+        case COMMAND_READ_POTENTIOMETER:
+            if(g_hid_report_sent != true) return; // Try again once the last report has gone.
+
+            ADCON0bits.GO_nDONE = 1;
+            while(ADCON0bits.GO_nDONE){}
+            g_hid_in_report1.array[0] = COMMAND_READ_POTENTIOMETER;
+            #if defined(_18F47J53_FAMILY_) || defined(_18F2458) || \
+                defined(_18F4458) || defined(_18F2553) || defined(_18F4553)
+            // 12-bit ADC. If not converted to 10-bit number the
+            // application will report an exception.
+            g_hid_in_report1.array[1] = (ADRESH << 6) | (ADRESL >> 2); 
+            g_hid_in_report1.array[2] = ADRESH >> 2;
+            #else
+            g_hid_in_report1.array[1] = ADRESL;
+            g_hid_in_report1.array[2] = ADRESH;
+            #endif
+            hid_send_report(0);
+            break;
+    }
+    hid_arm_ep_out();
+    m_out_event = false;
+}
+
+void cdc_notification(void)
+{
+
+}
+
+void hid_out(uint8_t report_num)
+{
+    m_out_event = true;
+}
+
+void dfu_detach(void)
+{
+    RESET(); // The DFU Bootloader Example stays in DFU mode after the RESET instruction.
+}
+
+void usb_sof(void)
+{
+    cdc_service_sof();
+}
+
+void msd_rx_sector(void)
+{
+    usb_ram_set(0, g_msd_ep_in, 64);
+    
+    if(g_msd_rw_10_vars.LBA == BOOT_SECT_ADDR)  // If PC is reading the Boot Sector.
+    {
+        if(g_msd_byte_of_sect == 0) usb_rom_copy((const uint8_t*)(&boot16), g_msd_ep_in, sizeof(boot16));
+        else if(g_msd_byte_of_sect == 448)
+        {
+            g_msd_ep_in[62] = 0x55;
+            g_msd_ep_in[63] = 0xAA;
+        }
+    }
+    else if(g_msd_rw_10_vars.LBA == FAT_SECT_ADDR) // If PC is reading the FAT.
+    {
+        if(g_msd_byte_of_sect == 0)
+        {
+            g_msd_ep_in[0] = 0xF8;
+            g_msd_ep_in[1] = 0xFF;
+            g_msd_ep_in[2] = 0xFF;
+            g_msd_ep_in[3] = 0xFF;
+            g_msd_ep_in[4] = 0x0F;
+        }
+    }
+    else if(g_msd_rw_10_vars.LBA == ROOT_SECT_ADDR) // If PC is reading the Root Sector.
+    {
+        if(g_msd_byte_of_sect == 0) usb_rom_copy((const uint8_t*)(&root), g_msd_ep_in, 64);
+    }
+    else if(g_msd_rw_10_vars.LBA == FILE_SECT_ADDR) // If PC is reading HELLO.TXT.
+    {
+        if(g_msd_byte_of_sect == 0) usb_rom_copy(file, g_msd_ep_in, sizeof(file));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+/**
+ * @file usb_config.h
+ * @brief Contains core USB stack settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Stack.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_CONFIG_H
+#define USB_CONFIG_H
+
+/* ************************************************************************** */
+/* **************************** USB SETTINGS ******************************** */
+/* ************************************************************************** */
+
+#define BUS_POWERED  0
+#define SELF_POWERED 1
+#define POWERED_TYPE BUS_POWERED
+
+#define LOW_SPEED  0
+#define FULL_SPEED (1 << 2)
+#define USB_SPEED  FULL_SPEED
+
+#define SPEED_PULLUP_OFF 0
+#define SPEED_PULLUP_ON  (1 << 4)
+#define SPEED_PULLUP     SPEED_PULLUP_ON
+
+#define REMOTE_WAKEUP_OFF 0
+#define REMOTE_WAKEUP_ON  1
+#define REMOTE_WAKEUP     REMOTE_WAKEUP_OFF
+
+#define PINGPONG_DIS      0
+#define PINGPONG_0_OUT    1
+#define PINGPONG_ALL_EP   2
+#define PINGPONG_1_15     3
+#define PINGPONG_MODE     PINGPONG_0_OUT
+
+#define NUM_CONFIGURATIONS 2  // 1: CDC, MSD, HID and Run-Time DFU. 2: CDC (line echo) and MSD.
+#define NUM_INTERFACES     5  // CDC COM (0), CDC DATA (1), MSD (2), HID (3) and Run-Time DFU (4).
+#define NUM_ALT_INTERFACES 0
+#define NUM_ENDPOINTS      5
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
+#define EP1_SIZE           10 // CDC COM.
+#define EP1_OUT_SIZE       0  // CDC COM is IN only.
+#define EP2_SIZE           32 // CDC DATA.
+#define EP3_SIZE           64 // MSD.
+#define EP4_SIZE           64 // HID.
+
+#if defined(_PIC14E) || defined(_18F13K50) || defined(_18F14K50)
+#error "This example needs more USB RAM than PIC16F145X and PIC18F1XK50 parts have."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************* INTERRUPT SETTINGS ***************************** */
+/* ************************************************************************** */
+
+/*
+ * INTERRUPT MASK OPTIONS:
+ * _SOFIE   - Start Of Frame Interrupt (Optional, must define USE_SOF if used)
+ * _STALLIE - Stall Interrupt (*not used)
+ * _IDLEIE  - Idle Interrupt (Mandatory)
+ * _TRNIE   - Transaction Complete Interrupt (Mandatory)
+ * _ACTVIE  - Bus Activity Interrupt (Mandatory)
+ * _UERIE   - USB Error Interrupt (Optional, must define USE_ERROR if used)
+ * _URSTIE  - USB Reset Interrupt (Mandatory)
+ */
+
+#define INTERRUPTS_MASK (_IDLEIE | _TRNIE | _ACTVIE | _URSTIE | _SOFIE)
+#define ERROR_INTERRUPT_MASK 0
+
+//#define USE_RESET
+//#define USE_ERROR
+//#define USE_IDLE
+//#define USE_ACTIVITY
+#define USE_SOF
+#define USE_OUT_CONTROL_FINISHED
+
+// USB TASKS SETTINGS
+//#define USE_USTAT_BATCH // usb_tasks() services every transaction in the USTAT FIFO before 
+                          // returning, instead of returning after the first non-EP0 one.
+//#define USE_POLLING     // usb_tasks() is called from the main loop, the USB interrupt 
+                          // isn't used and the class libraries won't enable it.
+//#define USE_SUSPEND_SLEEP // usb_sleep() puts the CPU to Sleep while the bus is suspended.
+//#define USE_CLOCK_SCALING // Runs from the internal oscillator at CLOCK_LOW_IRCF while suspended.
+//#define USE_EVENTS      // usb_tasks() posts events, usb_event_tasks() in the main loop calls 
+                          // g_usb_event_handlers[] and idles the CPU when none are pending.
+//#define USE_ISOCHRONOUS // usb_iso_ functions for isochronous Endpoints, needs PINGPONG_1_15 or PINGPONG_ALL_EP.
+//#define USE_DEFERRED_TASKS // usb_tasks() only queues the transactions of EP1 and up, their handlers run 
+                             // from usb_deferred_tasks() in the main loop or a low priority interrupt.
+#define DEFERRED_QUEUE_SIZE 8  // Queued transactions, power of 2, up to 128.
+//#define USE_NEAR_RAM    // The per-transaction state of usb.c and the classes goes in access RAM (PIC18) 
+                          // or common RAM (PIC16), needs XC8 Address Qualifiers set to request.
+//#define USE_BD_TOGGLE   // usb_arm_endpoint() takes the next toggle from the BD, the classes don't keep one. 
+                          // Needs PINGPONG_DIS or PINGPONG_0_OUT.
+#define USE_EP_HANDLER_TABLE // usb_tasks() calls g_usb_ep_handlers[ENDP][DIR] from usb_app.c 
+                               // directly, instead of usb_app_tasks().
+#define USE_IF_HANDLER_TABLE // Interface Class Requests and Get Descriptor Requests go to 
+                               // g_usb_if_handlers[wIndex] from usb_app.c, for composite devices.
+//#define USE_ENUM_STATS  // Frame numbers and counts for each enumeration stage, read with usb_get_stats().
+//#define USE_FAST_ENUMERATION // Configuration descriptor lengths come from g_config_descriptor_lengths[] 
+                               // in usb_descriptors.c, instead of being read from the descriptor.
+//#define USE_EP_STATS    // Per-EP transaction and byte counts, stalls, UEIR errors, and per-frame peaks.
+//#define USE_STATS_REQUEST // The host can read the stats with a vendor request, see usb.h.
+#define STATS_REQUEST_CODE 0xE0 // bRequest of the stats vendor request.
+//#define USE_MEM_REQUEST // The host can read RAM and program memory and write RAM with a vendor request, see usb.h.
+#define MEM_REQUEST_CODE 0xE1 // bRequest of the memory vendor request.
+//#define USE_BOS         // Get Descriptor(BOS) is answered with g_bos_descriptor from usb_descriptors.c (bcdUSB 0x0201).
+//#define USE_MS_OS_20    // The MS OS 2.0 Descriptor Set vendor request is answered with g_ms_os_20_descriptor_set, 
+                          // so Windows binds WinUSB without an INF. Needs USE_BOS.
+#define MS_OS_20_VENDOR_CODE 0x20 // bMS_VendorCode, bRequest of the MS OS 2.0 vendor request.
+//#define USE_TRACE       // usb_tasks(), process_setup() and the EP handlers record entry/exit times 
+                          // in a trace ring, read with usb_trace_read().
+#define TRACE_RING_SIZE       32             // Entries (4 bytes each), power of 2, up to 128.
+#define TRACE_TIMER           TMR1
+#define TRACE_TIMER_START()   T1CON = 0x01   // TMR1 on Fosc/4, one count per instruction cycle.
+//#define USE_TIMESTAMP   // usb_get_frame() and usb_timestamp() extend the frame number to 32 bits, 
+                          // with microseconds into the frame from a timer latched at each SOF. Needs USE_SOF.
+#define TIMESTAMP_TIMER           TMR1
+#define TIMESTAMP_TIMER_START()   T1CON = 0x01 // Can share TRACE_TIMER.
+#define TIMESTAMP_TICKS_PER_US    12           // Fosc/4 at 48MHz.
+#define USE_ARENA         // Buffers of states that are never in use together share g_usb_arena, 
+                          // X(name, bytes) per state, sizeof(g_usb_arena) is the peak. See usb.h.
+                          // Only one configuration is live at a time, so each one is a state: 
+                          // 128 bytes here, where the HID reports and the line took 256.
+#define USB_ARENA_STATES(X) X(hid, 128)  /* Configuration 1, g_hid_in_report1 and g_hid_out_report1. */ \
+                            X(line, 128) /* Configuration 2, the line serial_lines() echoes. */
+#define USB_ARENA_BUDGET 128 // Fails the build if the largest state is bigger.
+
+/* ************************************************************************** */
+
+#endif /* USB_CONFIG_H */
\ No newline at end of file
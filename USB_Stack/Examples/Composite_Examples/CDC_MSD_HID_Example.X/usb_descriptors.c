@@ -0,0 +1,207 @@
+/**
+ * @file usb_descriptors.c
+ * @brief Contains core USB stack descriptors stored in ROM.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Stack (This file is for the Composite Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_config.h"
+#include "usb_cdc.h"
+#include "usb_msd.h"
+#include "usb_hid.h"
+#include "usb_dfu.h"
+#include "usb_hid_report_defines.h"
+#include "usb_hid_pages.h"
+#include "usb_ch9.h"
+
+// Report Descriptor (Vendor), the same reports as the HID Custom example.
+const uint8_t g_hid_report_descriptor[] =
+{
+    Usage_Page2(VENDOR_DEFINED_PAGE),
+    Usage(0x01),
+    Collection(APPLICATION),
+        Usage_Minimum(1),
+        Usage_Maximum(64),
+        Logic_Minimum(0),
+        Logic_Maximum2(0x00FF),
+        Report_Size(8),
+        Report_Count(64),
+        Input(DATA|ARRAY|ABSOLUTE),
+        Usage_Minimum(1),
+        Usage_Maximum(64),
+        Output(DATA|ARRAY|ABSOLUTE),
+    End_Collection()
+};
+
+const uint16_t g_hid_report_descriptor_size = sizeof(g_hid_report_descriptor);
+
+/** Device Descriptor */
+const ch9_device_descriptor_t g_device_descriptor =
+{
+    0x12,                 // bLength:8 -  Size of descriptor in bytes
+    DEVICE_DESC,          // bDescriptorType:8  - Device descriptor type
+    0x0200,               // bcdUSB:16 -  USB in BCD (2.0H)
+    MISC_CLASS,           // bDeviceClass:8 - Functions are described by IADs
+    MISC_COMMON_SUBCLASS, // bDeviceSubClass:8
+    MISC_IAD_PROTOCOL,    // bDeviceProtocol:8
+    EP0_SIZE,             // bMaxPacketSize0:8 - Maximum packet size
+    0x04D8,               // idVendor:16 - Microchip VID = 0x04D8
+    0x0054,               // idProduct:16 - Product ID (PID) = 0x0054
+    0x0100,               // bcdDevice:16 - Device release number in BCD
+    0x01,                 // iManufacturer:8 - Manufacturer string index
+    0x02,                 // iProduct:8 - Product string index
+    0x03,                 // iSerialNumber:8 - Device serial number string index
+    NUM_CONFIGURATIONS    // bNumConfigurations:8 - Number of possible configurations
+};
+
+/** Configuration Descriptor Structure */
+typedef struct
+{
+    ch9_configutarion_descriptor_t configuration0_descriptor;
+    cdc_function_descriptors_t     cdc; // Interfaces 0 and 1, EP1 and EP2.
+    msd_function_descriptors_t     msd; // Interface 2, EP3.
+    hid_function_descriptors_t     hid; // Interface 3, EP4.
+    dfu_function_descriptors_t     dfu; // Interface 4, Run-Time DFU on EP0.
+}config_descriptor_t;
+
+/** Configuration Descriptor */
+static const config_descriptor_t config_descriptor0 =
+{
+    CH9_CONFIGURATION_DESCRIPTOR(sizeof(config_descriptor0), NUM_INTERFACES, 1, 0xC0, 50), // Self Powered, 100mA.
+    CDC_FUNCTION_DESCRIPTORS(2),
+    MSD_FUNCTION_DESCRIPTORS(),
+    HID_FUNCTION_DESCRIPTORS(0, 0, sizeof(g_hid_report_descriptor), 1),
+    DFU_FUNCTION_DESCRIPTORS()
+};
+
+/** Configuration 2 Descriptor Structure, CDC and MSD only */
+typedef struct
+{
+    ch9_configutarion_descriptor_t configuration1_descriptor;
+    cdc_function_descriptors_t     cdc; // Interfaces 0 and 1, EP1 and EP2.
+    msd_function_descriptors_t     msd; // Interface 2, EP3.
+}config1_descriptor_t;
+
+/** Configuration 2 Descriptor */
+static const config1_descriptor_t config_descriptor1 =
+{
+    CH9_CONFIGURATION_DESCRIPTOR(sizeof(config_descriptor1), 3, 2, 0xC0, 50), // Self Powered, 100mA.
+    CDC_FUNCTION_DESCRIPTORS(2),
+    MSD_FUNCTION_DESCRIPTORS()
+};
+
+/** hid_descriptor Address */
+const uint8_t* g_hid_descriptor = (uint8_t*)&config_descriptor0.hid.hid;
+
+/** Configuration Descriptor Addresses Array */
+const uint16_t g_config_descriptors[] =
+{
+    (uint16_t)&config_descriptor0,
+    (uint16_t)&config_descriptor1
+};
+
+#ifdef USE_FAST_ENUMERATION
+/** Configuration Descriptor Lengths Array */
+const uint16_t g_config_descriptor_lengths[] =
+{
+    sizeof(config_descriptor0),
+    sizeof(config_descriptor1)
+};
+#endif
+
+/** String Zero Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t wLANGID[1];
+}string_zero_descriptor_t;
+
+/** Vendor String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[6];
+}vendor_string_descriptor_t;
+
+/** Product String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[18];
+}product_string_descriptor_t;
+
+/** Serial String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[12];
+}serial_string_descriptor_t;
+
+/** String Zero Descriptor */
+static const string_zero_descriptor_t string_zero_descriptor =
+{
+    sizeof(string_zero_descriptor_t),
+    STRING_DESC,
+    {0x0409}
+};
+
+/** Vendor String Descriptor */
+static const vendor_string_descriptor_t vendor_string_descriptor =
+{
+    sizeof(vendor_string_descriptor_t),
+    STRING_DESC,
+    {'J','o','h','n','n','y'}
+};
+
+/** Product String Descriptor */
+static const product_string_descriptor_t product_string_descriptor =
+{
+    sizeof(product_string_descriptor_t),
+    STRING_DESC,
+    {'C','D','C',' ','M','S','D',' ','H','I','D',' ','D','e','v','i','c','e'}
+};
+
+/** Serial String Descriptor */
+static const serial_string_descriptor_t serial_string_descriptor =
+{
+    sizeof(serial_string_descriptor_t),
+    STRING_DESC,
+    {'0','1','2','3','4','5','6','7','8','9','A','B'}
+};
+
+/** String Descriptor Addresses Array */
+const uint16_t g_string_descriptors[] =
+{
+    (uint16_t)&string_zero_descriptor,
+    (uint16_t)&vendor_string_descriptor,
+    (uint16_t)&product_string_descriptor,
+    (uint16_t)&serial_string_descriptor
+};
+
+/** String Descriptor Addresses Array Size */
+const uint8_t g_size_of_sd = sizeof(g_string_descriptors);
\ No newline at end of file
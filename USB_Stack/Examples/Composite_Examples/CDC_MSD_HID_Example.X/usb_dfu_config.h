@@ -0,0 +1,56 @@
+/**
+ * @file usb_dfu_config.h
+ * @brief <i>DFU Class</i> settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - DFU Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_DFU_CONFIG_H
+#define USB_DFU_CONFIG_H
+
+#include "usb_config.h"
+
+/* SETTINGS */
+// Interface number of the DFU interface.
+#define DFU_INT 4
+
+// Mode - Uncomment to use
+#define DFU_RUNTIME   // The Run-Time interface for an application (DETACH, GETSTATUS, GETSTATE), 
+                      // instead of the DFU mode interface of a bootloader.
+//#define DFU_USE_UPLOAD // DFU_UPLOAD reads the firmware back with dfu_upload_block().
+
+// Timing
+#define DFU_DETACH_TIMEOUT 1000 // wDetachTimeOut in mS.
+#define DFU_DETACH_FRAMES  10   // Frames after DFU_DETACH before dfu_detach() is called, for its status stage.
+#define DFU_POLL_TIMEOUT   5    // bwPollTimeout in mS (up to 255), the time dfu_program_block() takes for one block.
+
+// Block size, wTransferSize. One flash erase row, so each DFU_DNLOAD block is
+// erased and written with no read-modify-write.
+#ifdef _PIC14E
+#define DFU_TRANSFER_SIZE (_FLASH_ERASE_SIZE * 2) // 2 bytes per program word.
+#else
+#define DFU_TRANSFER_SIZE _FLASH_ERASE_SIZE
+#endif
+
+#endif /* USB_DFU_CONFIG_H */
@@ -0,0 +1,118 @@
+/**
+ * @file usb_hid_config.h
+ * @brief Contains HID user settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Stack.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef USB_HID_CONFIG_H
+#define USB_HID_CONFIG_H
+
+#include "usb_config.h"
+
+/* SETTINGS */
+// Number of HID descriptors
+#define HID_NUM_DESC 1
+
+// Supported Class Requests - Uncomment to use
+#define USE_SET_REPORT
+#define USE_GET_IDLE
+#define USE_SET_IDLE
+//#define USE_GET_PROTOCOL // Needed by boot devices, g_hid_protocol holds boot (0) or report (1).
+//#define USE_SET_PROTOCOL // Boot protocol sends IN report 0 from g_hid_boot_in_report, in usb_hid_reports.c.
+
+// Interface Settings
+#define HID_INT 3
+
+// Endpoint Settings
+#define IN_REPORT_EP      EP4
+#define IN_REPORT_BDT     EP_BD_INDEX(EP4, IN, EVEN)
+#define IN_REPORT_EP_ADDR HID_EP_IN_BUFFER_BASE_ADDR
+
+// Report Queue - Uncomment to use
+//#define USE_HID_REPORT_QUEUE // hid_send_report() queues a report while the IN EP is busy, instead of dropping 
+                               // it. Each IN completion sends the next queued report (latest data wins).
+//#define HID_QUEUE_PRIORITY   // Queued reports go lowest report number first, instead of round-robin.
+//#define USE_HID_FEATURE_TASKS // SET_REPORT(Feature) data is passed to hid_set_feature(report_num) from
+                                // hid_feature_tasks() in the main loop. Needs USE_OUT_CONTROL_FINISHED.
+//#define USE_HID_IN         // hid_in(report_num) is called when an IN report has gone, from the USB interrupt.
+//#define USE_HID_OUT_NO_COPY // hid_out_packet() is given the OUT report in its EP buffer instead of hid_out(),
+                               // hid_release_out() hands the buffer back.
+//#define USE_HID_MOTION    // hid_motion_add()/hid_motion_buttons() build report HID_MOTION_REPORT at each IN 
+                               // completion, from movement summed since the last poll.
+#define HID_MOTION_REPORT  0   // IN report number, and the byte offsets of its fields.
+#define HID_MOTION_BUTTONS 0
+#define HID_MOTION_X       1
+#define HID_MOTION_Y       2
+//#define HID_MOTION_WHEEL 3   // Leave undefined without a wheel.
+
+// Idle_Settings
+#define DEFAULT_IDLE 500 // in mS
+//#define USE_HID_FRAME_IDLE  // hid_service_idle() in the main loop catches the idle timers up from the frame 
+                             // number, the SOF interrupt only runs near a deadline. Take _SOFIE out of INTERRUPTS_MASK
+                             // if HID is the only usb_sof() user, it stays on otherwise.
+#define HID_IDLE_WAKE_FRAMES 2 // SOF interrupt on from this many frames before a deadline.
+
+// HID Endpoint HAL
+#define HID_EP      EP4
+#define HID_EP_SIZE EP4_SIZE
+
+#define HID_BD_OUT      EP_BD_INDEX(EP4, OUT, EVEN)
+#define HID_BD_OUT_EVEN EP_BD_INDEX(EP4, OUT, EVEN)
+#define HID_BD_OUT_ODD  EP_BD_INDEX(EP4, OUT, ODD)
+#define HID_BD_IN       EP_BD_INDEX(EP4, IN, EVEN)
+#define HID_BD_IN_EVEN  EP_BD_INDEX(EP4, IN, EVEN)
+#define HID_BD_IN_ODD   EP_BD_INDEX(EP4, IN, ODD)
+
+#define HID_UEPbits UEP4bits
+
+/* NUMBER OF REPORTS */
+#define HID_NUM_IN_REPORTS      1
+#define HID_NUM_OUT_REPORTS     1
+#define HID_NUM_FEATURE_REPORTS 0
+
+/* REPORT STRUCTURES/VARS/DEFINES */
+#define HID_USE_REPORT_IDS 0
+#define HID_NUM_REPORT_IDS 0
+
+// KEY MODIFIERS
+#define MOD_KEY_LEFTCTRL    0x01 // LeftControl
+#define MOD_KEY_LEFTSHIFT   0x02 // LeftShift
+#define MOD_KEY_LEFTALT     0x04 // LeftAlt
+#define MOD_KEY_LEFTMETA    0x08 // LeftGUI
+#define MOD_KEY_RIGHTCTRL   0x10 // RightControl
+#define MOD_KEY_RIGHTSHIFT  0x20 // RightShift
+#define MOD_KEY_RIGHTALT    0x40 // RightAlt
+#define MOD_KEY_RIGHTMETA   0x80 // RightGUI
+
+// CONSUMER KEYS
+#define _SCAN_NEXT_TRACK 0x01
+#define _SCAN_PREV_TRACK 0x02
+#define _STOP            0x04
+#define _EJECT           0x08
+#define _PLAY_PAUSE      0x10
+#define _MUTE            0x20
+#define _VOL_INC         0x40
+#define _VOL_DEC         0x80
+
+#endif /* USB_HID_CONFIG_H */
\ No newline at end of file
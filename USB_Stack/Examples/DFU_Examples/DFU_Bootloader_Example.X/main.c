@@ -0,0 +1,212 @@
+/**
+ * @file main.c
+ * @brief Main C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * DFU Bootloader Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * USB uC DFU BOOTLOADER INSTRUCTIONS
+ * 
+ * The bootloader takes 0x0000 to 0x1FFF, where the USB uC bootloader sits, so 
+ * applications set up for it (a Codeoffset of 0x2000, see the instructions in 
+ * the other examples) run under this one unchanged. It's a Device Firmware 
+ * Upgrade 1.1 device in DFU mode, any DFU host such as dfu-util programs it.
+ * 
+ * 1. PROGRAM THE BOOTLOADER
+ * Build this project and program it with a PIC programmer. ROM ranges is set 
+ * to 0-1FFF in the project's Memory Model options, keep it there if you add code.
+ * 
+ * 2. START BOOTLOADER
+ * The bootloader stays in DFU mode, with the bootloader LED on, if the button 
+ * is held at reset, if no application is present, or if the application 
+ * restarted with the RESET instruction. An application with a Run-Time DFU 
+ * interface (see the CDC MSD HID Example) does that in dfu_detach(), so 
+ * "dfu-util -e" gets here without the button. Any other RESET() in the 
+ * application also ends up here.
+ * 
+ * 3. MAKE THE IMAGE
+ * A download is the raw application from 0x2000, without the Config Words 
+ * (this bootloader's are kept). With the hexmate that ships with XC8 and 
+ * objcopy, e.g. for a PIC18F25K50 (32K):
+ * 
+ * hexmate r2000-7FFF,app.hex -Oapp_only.hex
+ * objcopy -I ihex -O binary --gap-fill 0xFF app_only.hex app.bin
+ * 
+ * J parts end 1KB before the last byte of flash, that page holds the Config 
+ * Words. e.g. For X7J53 use r2000-1FBFF.
+ * 
+ * 4. DOWNLOAD
+ * dfu-util -d 04d8:005c -D app.bin -R
+ * 
+ * Each block is one flash erase row. Blocks past the end of the application 
+ * space are refused (errADDRESS). The first word of the reset vector is 
+ * written last, in dfu_manifest(), so an update that stops part way leaves no 
+ * application and the bootloader starts again. -R resets the bus after the 
+ * download, which starts the new application.
+ * 
+ * 5. READ
+ * dfu-util -d 04d8:005c -U backup.bin reads the application space back.
+ * 
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "fuses.h"
+#include "config.h"
+#include "usb.h"
+#include "usb_dfu.h"
+#include "flash.h"
+
+#define APP_START  0x2000 // Reset vector of the application, its interrupt vectors are 0x08 and 0x18 on from it.
+#ifdef __J_PART
+#define APP_END    (_ROMSIZE - _FLASH_ERASE_SIZE) // The last erase row holds the Config Words.
+#else
+#define APP_END    _ROMSIZE
+#endif
+#define APP_BLOCKS ((APP_END - APP_START) / DFU_TRANSFER_SIZE)
+
+// The bootloader polls the USB module and uses no interrupts, the hardware 
+// vectors go straight to the application's.
+asm("psect intcode,global,reloc=2,class=CODE,delta=1");
+asm("GOTO " ___mkstr(APP_START + 0x08));
+asm("psect intcodelo,global,reloc=2,class=CODE,delta=1");
+asm("GOTO " ___mkstr(APP_START + 0x18));
+
+static void example_init(void);
+static bool app_present(void);
+static void start_app(void);
+
+static uint8_t m_reset_vector[2]; // First word of block 0, written by dfu_manifest().
+static bool    m_have_reset_vector = false;
+static bool    m_updated = false;   // dfu_manifest() finished, the next bus reset starts the application.
+static bool    m_start_app = false;
+
+void main(void)
+{
+    bool detached = !RCONbits.RI; // RESET instruction, the application's dfu_detach().
+    
+    RCONbits.RI = 1;
+    example_init();
+    if(!detached && BUTTON_RELEASED && app_present()) start_app();
+    
+    #ifdef USE_BOOT_LED
+    LED_OFF();
+    LED_OUPUT();
+    LED_ON();
+    #endif
+    
+    usb_init();
+    
+    // Flash is erased and written from dfu_tasks(). No interrupts are on, so 
+    // nothing gets between the unlock sequences in flash.c.
+    while(1)
+    {
+        usb_tasks();
+        dfu_tasks();
+        if(m_start_app)
+        {
+            usb_close();
+            __delay_ms(100); // The host sees the detach before the application attaches.
+            start_app();
+        }
+    }
+}
+
+static bool app_present(void)
+{
+    uint8_t word[2];
+    
+    Flash_ReadBytes(APP_START, 2, word);
+    return word[0] != 0xFF || word[1] != 0xFF;
+}
+
+static void start_app(void)
+{
+    asm("GOTO " ___mkstr(APP_START));
+}
+
+uint8_t dfu_program_block(uint16_t block_num, uint8_t* p_data, uint16_t bytes)
+{
+    uint24_t addr = APP_START + (uint24_t)block_num * DFU_TRANSFER_SIZE;
+    uint8_t  check[8];
+    uint16_t i;
+    
+    if(block_num >= APP_BLOCKS) return DFU_STATUS_ERR_ADDRESS;
+    
+    for(i = bytes; i < DFU_TRANSFER_SIZE; i++) p_data[i] = 0xFF; // A short last block, the rest stays erased.
+    if(block_num == 0)
+    {
+        m_reset_vector[0] = p_data[0];
+        m_reset_vector[1] = p_data[1];
+        m_have_reset_vector = true;
+        p_data[0] = 0xFF;
+        p_data[1] = 0xFF;
+    }
+    m_updated = false;
+    Flash_EraseWriteBlock(addr, p_data);
+    
+    for(i = 0; i < DFU_TRANSFER_SIZE; i += sizeof(check))
+    {
+        Flash_ReadBytes(addr + i, sizeof(check), check);
+        for(uint8_t j = 0; j < sizeof(check); j++)
+        {
+            if(check[j] != p_data[i + j]) return DFU_STATUS_ERR_VERIFY;
+        }
+    }
+    return DFU_STATUS_OK;
+}
+
+uint8_t dfu_manifest(void)
+{
+    uint8_t row[_FLASH_WRITE_SIZE];
+    uint8_t word[2];
+    
+    if(!m_have_reset_vector) return DFU_STATUS_ERR_NOTDONE; // Block 0 never came.
+    
+    // Only the first word is programmed, 0xFF leaves the rest of the row as it is.
+    for(uint8_t i = 2; i < _FLASH_WRITE_SIZE; i++) row[i] = 0xFF;
+    row[0] = m_reset_vector[0];
+    row[1] = m_reset_vector[1];
+    Flash_WriteBlock(APP_START, row);
+    m_have_reset_vector = false;
+    
+    Flash_ReadBytes(APP_START, 2, word);
+    if(word[0] != m_reset_vector[0] || word[1] != m_reset_vector[1]) return DFU_STATUS_ERR_VERIFY;
+    m_updated = true;
+    return DFU_STATUS_OK;
+}
+
+uint16_t dfu_upload_block(uint16_t block_num, uint8_t* p_data, uint16_t bytes)
+{
+    if(block_num >= APP_BLOCKS) return 0; // Past the end, the short block ends the upload.
+    Flash_ReadBytes(APP_START + (uint24_t)block_num * DFU_TRANSFER_SIZE, bytes, p_data);
+    return bytes;
+}
+
+void usb_reset(void)
+{
+    if(m_updated) m_start_app = true; // dfu-util -R after the download.
+}
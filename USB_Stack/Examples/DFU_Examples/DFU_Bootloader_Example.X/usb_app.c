@@ -0,0 +1,88 @@
+/**
+ * @file usb_app.c
+ * @brief Contains application specific functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Application file (This file is for the DFU Bootloader Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_app.h"
+#include "usb_dfu.h"
+
+
+const usb_if_handler_t g_usb_if_handlers[NUM_INTERFACES] =
+{
+    [DFU_INT] = {dfu_class_request, NULL, dfu_out_control_finished}
+};
+
+
+bool usb_service_class_request(void)
+{
+    return false; // Every Class Request is for the DFU interface, see g_usb_if_handlers.
+}
+
+bool usb_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+{
+    return false; // The DFU Functional Descriptor is only read in the Configuration Descriptor.
+}
+
+
+void usb_app_init(void)
+{
+    dfu_init();
+}
+
+
+void usb_app_tasks(void)
+{
+    // DFU only uses EP0.
+}
+
+
+void usb_app_clear_halt(uint8_t bd_table_index, uint8_t ep, uint8_t dir)
+{
+    g_usb_ep_stat[ep][dir].Halt = 0;
+    g_usb_ep_stat[ep][dir].Data_Toggle_Val = 0;
+    g_usb_bd_table[bd_table_index].STAT = 0;
+}
+
+
+bool usb_app_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    return alternate_setting == 0 && interface == DFU_INT;
+}
+
+
+bool usb_app_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    return false;
+}
+
+
+bool usb_out_control_finished(void)
+{
+    return false; // DFU_DNLOAD ends in dfu_out_control_finished(), see g_usb_if_handlers.
+}
@@ -96,6 +96,25 @@
 */
 #define HID_API_MAX_REPORT_DESCRIPTOR_SIZE 4096
 
+/** @brief Number of OUT reports hid_write_async() can have in flight
+	per device before it blocks for one to complete.
+
+	@ingroup API
+*/
+#ifndef HID_API_MAX_ASYNC_WRITES
+#define HID_API_MAX_ASYNC_WRITES 8
+#endif
+
+/** @brief Number of Input report reads the Windows backend keeps
+	queued per device, so reports keep arriving between hid_read()
+	calls instead of piling up in the HID class driver.
+
+	@ingroup API
+*/
+#ifndef HID_API_MAX_PENDING_READS
+#define HID_API_MAX_PENDING_READS 8
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -181,6 +200,68 @@ extern "C" {
 			hid_bus_type bus_type;
 		};
 
+		/** One input report slot for hid_read_batch(). */
+		struct hid_report_buffer {
+			/** Buffer the report is copied into */
+			unsigned char *data;
+			/** Size of data in bytes */
+			size_t length;
+			/** Number of bytes of the report, set by hid_read_batch() */
+			size_t actual_length;
+		};
+
+
+		/** @brief Hotplug events, a bit mask for hid_hotplug_register_callback().
+
+			@ingroup API
+		*/
+		typedef enum {
+			/** A device matching the callback was connected */
+			HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED = (1 << 0),
+
+			/** A device matching the callback was disconnected */
+			HID_API_HOTPLUG_EVENT_DEVICE_LEFT = (1 << 1)
+		} hid_hotplug_event;
+
+		/** @brief Flags for hid_hotplug_register_callback().
+
+			@ingroup API
+		*/
+		typedef enum {
+			/** Call the callback with HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED
+			    for every matching device already connected, before
+			    hid_hotplug_register_callback() returns */
+			HID_API_HOTPLUG_ENUMERATE = (1 << 0)
+		} hid_hotplug_flag;
+
+		/** Identifies a registered hotplug callback. */
+		typedef int hid_hotplug_callback_handle;
+
+		/** @brief Hotplug callback.
+
+			Called from HIDAPI's hotplug thread (or, on Windows, a system
+			thread pool thread), never from the thread that registered it
+			unless HID_API_HOTPLUG_ENUMERATE was given. @p device is a
+			single entry (device->next is NULL) owned by HIDAPI and only
+			valid until the callback returns, copy what's needed. For
+			HID_API_HOTPLUG_EVENT_DEVICE_LEFT it holds the information
+			from when the device arrived, the device can no longer be
+			opened.
+
+			Callbacks are called one at a time. They may register and
+			deregister callbacks, but must not call hid_exit().
+
+			@ingroup API
+			@param callback_handle The handle of this callback.
+			@param device The device that arrived or left.
+			@param event The event, one of #hid_hotplug_event.
+			@param user_data The user_data given when registering.
+
+			@returns
+				Return 0 to keep the callback registered, anything
+				else to deregister it.
+		*/
+		typedef int (HID_API_CALL *hid_hotplug_callback_fn)(hid_hotplug_callback_handle callback_handle, struct hid_device_info *device, hid_hotplug_event event, void *user_data);
 
 		/** @brief Initialize the HIDAPI library.
 
@@ -249,6 +330,55 @@ extern "C" {
 		*/
 		void  HID_API_EXPORT HID_API_CALL hid_free_enumeration(struct hid_device_info *devs);
 
+		/** @brief Register a callback for HID devices being connected
+			or disconnected.
+
+			Events come from the system (a libusb hotplug callback, a
+			udev monitor, CM_Register_Notification() or IOHIDManager
+			matching callbacks) instead of polling hid_enumerate() or
+			hid_open(), so nothing is rescanned while nothing changes and
+			a device is reported as soon as the system sees it.
+
+			The first registration starts HIDAPI's hotplug thread and
+			takes a snapshot of the connected devices, so that later
+			HID_API_HOTPLUG_EVENT_DEVICE_LEFT events can report what left.
+			The thread is stopped by hid_exit().
+
+			@ingroup API
+			@param vendor_id The Vendor ID (VID) to match, 0 for any.
+			@param product_id The Product ID (PID) to match, 0 for any.
+			@param events A bit mask of #hid_hotplug_event.
+			@param flags A bit mask of #hid_hotplug_flag.
+			@param callback The callback.
+			@param user_data Passed to the callback.
+			@param callback_handle Set to the callback's handle
+				(Optionally NULL). It's set before any
+				HID_API_HOTPLUG_ENUMERATE events are delivered.
+
+			@returns
+				This function returns 0 on success and -1 on error
+				(including a system without hotplug support, where the
+				caller has to fall back to polling).
+				Call hid_error(NULL) to get the failure reason.
+		*/
+		int HID_API_EXPORT HID_API_CALL hid_hotplug_register_callback(unsigned short vendor_id, unsigned short product_id, int events, int flags, hid_hotplug_callback_fn callback, void *user_data, hid_hotplug_callback_handle *callback_handle);
+
+		/** @brief Deregister a hotplug callback.
+
+			Once this returns the callback won't be called again, even
+			if it's running in the hotplug thread at the time this is
+			called from another thread (this waits for it to return).
+
+			@ingroup API
+			@param callback_handle The handle from
+				hid_hotplug_register_callback().
+
+			@returns
+				This function returns 0 on success and -1 if the handle
+				isn't registered.
+		*/
+		int HID_API_EXPORT HID_API_CALL hid_hotplug_deregister_callback(hid_hotplug_callback_handle callback_handle);
+
 		/** @brief Open a HID device using a Vendor ID (VID), Product ID
 			(PID) and optionally a serial number.
 
@@ -364,6 +494,69 @@ extern "C" {
 		*/
 		int  HID_API_EXPORT HID_API_CALL hid_read(hid_device *dev, unsigned char *data, size_t length);
 
+		/** @brief Queue an Output report without waiting for it to be sent.
+
+			The report is copied into one of HID_API_MAX_ASYNC_WRITES
+			preallocated slots and submitted, so the caller can keep
+			several reports in flight and saturate the OUT endpoint. If
+			all slots are busy this function blocks until one completes.
+			The data buffer can be reused as soon as this returns.
+
+			Errors from reports that fail after this returns are reported
+			by hid_write_async_wait(). hid_close() discards reports still
+			in flight, call hid_write_async_wait() first to flush them.
+
+			Backends without native asynchronous writes send the report
+			synchronously.
+
+			@ingroup API
+			@param dev A device handle returned from hid_open().
+			@param data The data to send, including the report number as
+				the first byte.
+			@param length The length in bytes of the data to send.
+
+			@returns
+				This function returns length once the report is queued
+				and -1 if it couldn't be queued.
+				Call hid_error(dev) to get the failure reason.
+		*/
+		int  HID_API_EXPORT HID_API_CALL hid_write_async(hid_device *dev, const unsigned char *data, size_t length);
+
+		/** @brief Wait for queued Output reports to be sent.
+
+			@ingroup API
+			@param dev A device handle returned from hid_open().
+			@param milliseconds timeout in milliseconds or -1 for blocking wait.
+
+			@returns
+				This function returns the number of reports still in
+				flight (0 once all have been sent), and -1 if any report
+				queued by hid_write_async() failed.
+				Call hid_error(dev) to get the failure reason.
+		*/
+		int  HID_API_EXPORT HID_API_CALL hid_write_async_wait(hid_device *dev, int milliseconds);
+
+		/** @brief Read several Input reports in one call.
+
+			Waits up to milliseconds for the first report, then returns
+			it together with every report already queued, up to n,
+			without waiting any further. Each report is copied into
+			bufs[i].data (truncated to bufs[i].length) and its size is
+			stored in bufs[i].actual_length.
+
+			@ingroup API
+			@param dev A device handle returned from hid_open().
+			@param bufs Array of n report slots.
+			@param n The number of slots in bufs.
+			@param milliseconds timeout in milliseconds or -1 for blocking wait.
+
+			@returns
+				This function returns the number of reports read, 0 if
+				none arrived within the timeout and -1 on error.
+				Call hid_error(dev) to get the failure reason.
+		*/
+		int  HID_API_EXPORT HID_API_CALL hid_read_batch(hid_device *dev, struct hid_report_buffer *bufs, size_t n, int milliseconds);
+
 		/** @brief Set the device handle to be non-blocking.
 
 			In non-blocking mode calls to hid_read() will return
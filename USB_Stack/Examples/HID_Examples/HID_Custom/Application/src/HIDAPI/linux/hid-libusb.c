@@ -134,11 +134,27 @@ libusb HIDAPI programs are encouraged to use the interface number
 instead to differentiate between interfaces on a composite HID device. */
 /*#define INVASIVE_GET_USAGE*/
 
-/* Linked List of input reports received from the device. */
+/* Number of interrupt IN transfers kept submitted at once, so the
+   endpoint is polled again while a completed one is being handled. */
+#define NUM_READ_TRANSFERS 4
+
+/* Number of input report slots per device. Once they're all full
+   the oldest report is overwritten, so the queue doesn't grow forever
+   if the user never reads anything from the device. */
+#define NUM_INPUT_REPORTS 32
+
+/* Slot in the ring of input reports received from the device. data
+   points into one block allocated when the device is opened. */
 struct input_report {
 	uint8_t *data;
 	size_t len;
-	struct input_report *next;
+};
+
+/* Preallocated OUT transfer for hid_write_async(). */
+struct write_slot {
+	hid_device *dev;
+	struct libusb_transfer *transfer;
+	size_t buffer_size;
 };
 
 
@@ -169,15 +185,30 @@ struct hid_device_ {
 
 	/* Read thread objects */
 	pthread_t thread;
-	pthread_mutex_t mutex; /* Protects input_reports */
+	pthread_mutex_t mutex; /* Protects the input report ring */
 	pthread_cond_t condition;
 	pthread_barrier_t barrier; /* Ensures correct startup sequence */
 	int shutdown_thread;
 	int transfer_loop_finished;
-	struct libusb_transfer *transfer;
-
-	/* List of received input reports. */
-	struct input_report *input_reports;
+	struct libusb_transfer *transfers[NUM_READ_TRANSFERS];
+	int transfers_active;
+
+	/* hid_write_async() objects, also protected by mutex */
+	pthread_cond_t write_condition;
+	struct write_slot write_slots[HID_API_MAX_ASYNC_WRITES];
+	struct write_slot *write_free[HID_API_MAX_ASYNC_WRITES];
+	int write_free_count;
+	int writes_pending;
+	int writes_closed;
+	int write_error;
+
+	/* Ring of received input reports, protected by mutex. */
+	struct input_report input_reports[NUM_INPUT_REPORTS];
+	uint8_t *input_report_data;
+	int input_head;
+	int input_count;
+	unsigned long input_reports_received;
+	unsigned long input_reports_dropped;
 
 	/* Was kernel driver detached by libusb */
 #ifdef DETACH_KERNEL_DRIVER
@@ -195,6 +226,7 @@ static libusb_context *usb_context = NULL;
 
 uint16_t get_usb_code_for_current_locale(void);
 static int return_data(hid_device *dev, unsigned char *data, size_t length);
+static void hotplug_cleanup(void);
 
 static hid_device *new_hid_device(void)
 {
@@ -203,6 +235,7 @@ static hid_device *new_hid_device(void)
 
 	pthread_mutex_init(&dev->mutex, NULL);
 	pthread_cond_init(&dev->condition, NULL);
+	pthread_cond_init(&dev->write_condition, NULL);
 	pthread_barrier_init(&dev->barrier, NULL, 2);
 
 	return dev;
@@ -212,11 +245,14 @@ static void free_hid_device(hid_device *dev)
 {
 	/* Clean up the thread objects */
 	pthread_barrier_destroy(&dev->barrier);
+	pthread_cond_destroy(&dev->write_condition);
 	pthread_cond_destroy(&dev->condition);
 	pthread_mutex_destroy(&dev->mutex);
 
 	hid_free_enumeration(dev->device_info);
 
+	free(dev->input_report_data);
+
 	/* Free the device itself */
 	free(dev);
 }
@@ -557,6 +593,7 @@ int HID_API_EXPORT hid_init(void)
 int HID_API_EXPORT hid_exit(void)
 {
 	if (usb_context) {
+		hotplug_cleanup();
 		libusb_exit(usb_context);
 		usb_context = NULL;
 	}
@@ -739,107 +776,130 @@ static uint16_t get_report_descriptor_size_from_interface_descriptors(const stru
 	return result;
 }
 
-struct hid_device_info  HID_API_EXPORT *hid_enumerate(unsigned short vendor_id, unsigned short product_id)
+/* All HID interfaces of one device, in the order hid_enumerate() lists them. */
+static struct hid_device_info *enumerate_device(libusb_device *dev, unsigned short vendor_id, unsigned short product_id)
 {
-	libusb_device **devs;
-	libusb_device *dev;
 	libusb_device_handle *handle = NULL;
-	ssize_t num_devs;
-	int i = 0;
+	struct libusb_device_descriptor desc;
+	struct libusb_config_descriptor *conf_desc = NULL;
+	int j, k;
 
 	struct hid_device_info *root = NULL; /* return object */
 	struct hid_device_info *cur_dev = NULL;
 
-	if(hid_init() < 0)
-		return NULL;
+	int res = libusb_get_device_descriptor(dev, &desc);
+	unsigned short dev_vid = desc.idVendor;
+	unsigned short dev_pid = desc.idProduct;
 
-	num_devs = libusb_get_device_list(usb_context, &devs);
-	if (num_devs < 0)
+	if ((vendor_id != 0x0 && vendor_id != dev_vid) ||
+	    (product_id != 0x0 && product_id != dev_pid)) {
 		return NULL;
-	while ((dev = devs[i++]) != NULL) {
-		struct libusb_device_descriptor desc;
-		struct libusb_config_descriptor *conf_desc = NULL;
-		int j, k;
-
-		int res = libusb_get_device_descriptor(dev, &desc);
-		unsigned short dev_vid = desc.idVendor;
-		unsigned short dev_pid = desc.idProduct;
+	}
 
-		if ((vendor_id != 0x0 && vendor_id != dev_vid) ||
-		    (product_id != 0x0 && product_id != dev_pid)) {
-			continue;
-		}
+	res = libusb_get_active_config_descriptor(dev, &conf_desc);
+	if (res < 0)
+		libusb_get_config_descriptor(dev, 0, &conf_desc);
+	if (conf_desc) {
+		for (j = 0; j < conf_desc->bNumInterfaces; j++) {
+			const struct libusb_interface *intf = &conf_desc->interface[j];
+			for (k = 0; k < intf->num_altsetting; k++) {
+				const struct libusb_interface_descriptor *intf_desc;
+				intf_desc = &intf->altsetting[k];
+				if (intf_desc->bInterfaceClass == LIBUSB_CLASS_HID) {
+					struct hid_device_info *tmp;
 
-		res = libusb_get_active_config_descriptor(dev, &conf_desc);
-		if (res < 0)
-			libusb_get_config_descriptor(dev, 0, &conf_desc);
-		if (conf_desc) {
-			for (j = 0; j < conf_desc->bNumInterfaces; j++) {
-				const struct libusb_interface *intf = &conf_desc->interface[j];
-				for (k = 0; k < intf->num_altsetting; k++) {
-					const struct libusb_interface_descriptor *intf_desc;
-					intf_desc = &intf->altsetting[k];
-					if (intf_desc->bInterfaceClass == LIBUSB_CLASS_HID) {
-						struct hid_device_info *tmp;
-
-						res = libusb_open(dev, &handle);
+					res = libusb_open(dev, &handle);
 
 #ifdef __ANDROID__
-						if (handle) {
-							/* There is (a potential) libusb Android backend, in which
-							   device descriptor is not accurate up until the device is opened.
-							   https://github.com/libusb/libusb/pull/874#discussion_r632801373
-							   A workaround is to re-read the descriptor again.
-							   Even if it is not going to be accepted into libusb master,
-							   having it here won't do any harm, since reading the device descriptor
-							   is as cheap as copy 18 bytes of data. */
-							libusb_get_device_descriptor(dev, &desc);
-						}
+					if (handle) {
+						/* There is (a potential) libusb Android backend, in which
+						   device descriptor is not accurate up until the device is opened.
+						   https://github.com/libusb/libusb/pull/874#discussion_r632801373
+						   A workaround is to re-read the descriptor again.
+						   Even if it is not going to be accepted into libusb master,
+						   having it here won't do any harm, since reading the device descriptor
+						   is as cheap as copy 18 bytes of data. */
+						libusb_get_device_descriptor(dev, &desc);
+					}
 #endif
 
-						tmp = create_device_info_for_device(dev, handle, &desc, conf_desc->bConfigurationValue, intf_desc->bInterfaceNumber);
-						if (tmp) {
+					tmp = create_device_info_for_device(dev, handle, &desc, conf_desc->bConfigurationValue, intf_desc->bInterfaceNumber);
+					if (tmp) {
 #ifdef INVASIVE_GET_USAGE
-							/* TODO: have a runtime check for this section. */
-
-							/*
-							This section is removed because it is too
-							invasive on the system. Getting a Usage Page
-							and Usage requires parsing the HID Report
-							descriptor. Getting a HID Report descriptor
-							involves claiming the interface. Claiming the
-							interface involves detaching the kernel driver.
-							Detaching the kernel driver is hard on the system
-							because it will unclaim interfaces (if another
-							app has them claimed) and the re-attachment of
-							the driver will sometimes change /dev entry names.
-							It is for these reasons that this section is
-							optional. For composite devices, use the interface
-							field in the hid_device_info struct to distinguish
-							between interfaces. */
-							if (handle) {
-								uint16_t report_descriptor_size = get_report_descriptor_size_from_interface_descriptors(intf_desc);
-
-								invasive_fill_device_info_usage(tmp, handle, intf_desc->bInterfaceNumber, report_descriptor_size);
-							}
-#endif /* INVASIVE_GET_USAGE */
+						/* TODO: have a runtime check for this section. */
+
+						/*
+						This section is removed because it is too
+						invasive on the system. Getting a Usage Page
+						and Usage requires parsing the HID Report
+						descriptor. Getting a HID Report descriptor
+						involves claiming the interface. Claiming the
+						interface involves detaching the kernel driver.
+						Detaching the kernel driver is hard on the system
+						because it will unclaim interfaces (if another
+						app has them claimed) and the re-attachment of
+						the driver will sometimes change /dev entry names.
+						It is for these reasons that this section is
+						optional. For composite devices, use the interface
+						field in the hid_device_info struct to distinguish
+						between interfaces. */
+						if (handle) {
+							uint16_t report_descriptor_size = get_report_descriptor_size_from_interface_descriptors(intf_desc);
 
-							if (cur_dev) {
-								cur_dev->next = tmp;
-							}
-							else {
-								root = tmp;
-							}
-							cur_dev = tmp;
+							invasive_fill_device_info_usage(tmp, handle, intf_desc->bInterfaceNumber, report_descriptor_size);
 						}
+#endif /* INVASIVE_GET_USAGE */
 
-						if (res >= 0)
-							libusb_close(handle);
+						if (cur_dev) {
+							cur_dev->next = tmp;
+						}
+						else {
+							root = tmp;
+						}
+						cur_dev = tmp;
 					}
-				} /* altsettings */
-			} /* interfaces */
-			libusb_free_config_descriptor(conf_desc);
+
+					if (res >= 0)
+						libusb_close(handle);
+				}
+			} /* altsettings */
+		} /* interfaces */
+		libusb_free_config_descriptor(conf_desc);
+	}
+
+	return root;
+}
+
+struct hid_device_info  HID_API_EXPORT *hid_enumerate(unsigned short vendor_id, unsigned short product_id)
+{
+	libusb_device **devs;
+	libusb_device *dev;
+	ssize_t num_devs;
+	int i = 0;
+
+	struct hid_device_info *root = NULL; /* return object */
+	struct hid_device_info *cur_dev = NULL;
+
+	if(hid_init() < 0)
+		return NULL;
+
+	num_devs = libusb_get_device_list(usb_context, &devs);
+	if (num_devs < 0)
+		return NULL;
+	while ((dev = devs[i++]) != NULL) {
+		struct hid_device_info *tmp = enumerate_device(dev, vendor_id, product_id);
+		if (!tmp)
+			continue;
+
+		if (cur_dev) {
+			cur_dev->next = tmp;
+		}
+		else {
+			root = tmp;
 		}
+		cur_dev = tmp;
+		while (cur_dev->next)
+			cur_dev = cur_dev->next;
 	}
 
 	libusb_free_device_list(devs, 1);
@@ -861,6 +921,389 @@ void  HID_API_EXPORT hid_free_enumeration(struct hid_device_info *devs)
 	}
 }
 
+/* Hotplug. libusb's own hotplug callback can run in any thread handling
+   events on usb_context (the read threads too), where synchronous
+   transfers aren't allowed, so it only queues the event. The hotplug
+   thread reads the device strings and calls the user callbacks. */
+struct hotplug_callback {
+	hid_hotplug_callback_handle handle;
+	unsigned short vendor_id;
+	unsigned short product_id;
+	int events; /* 0 once deregistered while callbacks are being called */
+	hid_hotplug_callback_fn callback;
+	void *user_data;
+	struct hotplug_callback *next;
+};
+
+/* A connected device and its HID interfaces, so that LEFT can report
+   what left. */
+struct hotplug_device {
+	libusb_device *device; /* Referenced */
+	struct hid_device_info *info;
+	struct hotplug_device *next;
+};
+
+struct hotplug_event {
+	libusb_device *device; /* Referenced */
+	libusb_hotplug_event event;
+	struct hotplug_event *next;
+};
+
+static struct {
+	pthread_once_t once;
+	pthread_mutex_t mutex; /* Recursive, callbacks may (de)register callbacks */
+	pthread_mutex_t queue_mutex;
+	struct hotplug_callback *callbacks;
+	hid_hotplug_callback_handle next_handle;
+	int dispatching;
+	struct hotplug_device *devices;
+	struct hotplug_event *queue_head;
+	struct hotplug_event *queue_tail;
+	libusb_hotplug_callback_handle libusb_handle;
+	pthread_t thread;
+	int thread_running;
+	int shutdown_thread;
+} hotplug = { .once = PTHREAD_ONCE_INIT };
+
+static void hotplug_init_mutexes(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&hotplug.mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+	pthread_mutex_init(&hotplug.queue_mutex, NULL);
+}
+
+static int hotplug_match(const struct hotplug_callback *cb, const struct hid_device_info *info)
+{
+	return (cb->vendor_id == 0x0 || cb->vendor_id == info->vendor_id) &&
+	       (cb->product_id == 0x0 || cb->product_id == info->product_id);
+}
+
+/* Call cb for every interface in info that it matches. Called with
+   hotplug.mutex held and hotplug.dispatching raised. */
+static void hotplug_call(struct hotplug_callback *cb, struct hid_device_info *info, hid_hotplug_event event)
+{
+	struct hid_device_info *cur;
+
+	for (cur = info; cur && (cb->events & event); cur = cur->next) {
+		struct hid_device_info *next = cur->next;
+		if (!hotplug_match(cb, cur))
+			continue;
+
+		/* The callback sees a single entry */
+		cur->next = NULL;
+		if (cb->callback(cb->handle, cur, event, cb->user_data))
+			cb->events = 0;
+		cur->next = next;
+	}
+}
+
+/* Free the callbacks deregistered while callbacks were being called. */
+static void hotplug_purge(void)
+{
+	struct hotplug_callback **pp = &hotplug.callbacks;
+
+	if (hotplug.dispatching)
+		return;
+
+	while (*pp) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->events == 0) {
+			*pp = cb->next;
+			free(cb);
+		}
+		else {
+			pp = &cb->next;
+		}
+	}
+}
+
+static void hotplug_dispatch(struct hid_device_info *info, hid_hotplug_event event)
+{
+	struct hotplug_callback *cb;
+
+	hotplug.dispatching++;
+	for (cb = hotplug.callbacks; cb; cb = cb->next)
+		hotplug_call(cb, info, event);
+	hotplug.dispatching--;
+	hotplug_purge();
+}
+
+static struct hotplug_device *hotplug_find(libusb_device *device, struct hotplug_device ***link)
+{
+	struct hotplug_device **pp;
+
+	for (pp = &hotplug.devices; *pp; pp = &(*pp)->next) {
+		if ((*pp)->device == device) {
+			if (link)
+				*link = pp;
+			return *pp;
+		}
+	}
+	return NULL;
+}
+
+static void hotplug_add(libusb_device *device, int notify)
+{
+	struct hotplug_device *hd;
+	struct hid_device_info *info;
+
+	if (hotplug_find(device, NULL))
+		return; /* Arrived between registering with libusb and the snapshot */
+
+	info = enumerate_device(device, 0, 0);
+	if (!info)
+		return; /* Not a HID device */
+
+	hd = (struct hotplug_device*) calloc(1, sizeof(struct hotplug_device));
+	if (!hd) {
+		hid_free_enumeration(info);
+		return;
+	}
+	hd->device = libusb_ref_device(device);
+	hd->info = info;
+	hd->next = hotplug.devices;
+	hotplug.devices = hd;
+
+	if (notify)
+		hotplug_dispatch(info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+}
+
+static void hotplug_remove(libusb_device *device)
+{
+	struct hotplug_device **link;
+	struct hotplug_device *hd = hotplug_find(device, &link);
+
+	if (!hd)
+		return;
+	*link = hd->next;
+
+	hotplug_dispatch(hd->info, HID_API_HOTPLUG_EVENT_DEVICE_LEFT);
+	hid_free_enumeration(hd->info);
+	libusb_unref_device(hd->device);
+	free(hd);
+}
+
+static int LIBUSB_CALL hotplug_libusb_callback(libusb_context *ctx, libusb_device *device, libusb_hotplug_event event, void *user_data)
+{
+	struct hotplug_event *ev = (struct hotplug_event*) malloc(sizeof(struct hotplug_event));
+	(void)ctx;
+	(void)user_data;
+
+	if (!ev)
+		return 0;
+	ev->device = libusb_ref_device(device);
+	ev->event = event;
+	ev->next = NULL;
+
+	pthread_mutex_lock(&hotplug.queue_mutex);
+	if (hotplug.queue_tail)
+		hotplug.queue_tail->next = ev;
+	else
+		hotplug.queue_head = ev;
+	hotplug.queue_tail = ev;
+	pthread_mutex_unlock(&hotplug.queue_mutex);
+
+	return 0; /* Stay registered */
+}
+
+static void hotplug_process_queue(void)
+{
+	struct hotplug_event *ev;
+
+	for (;;) {
+		pthread_mutex_lock(&hotplug.queue_mutex);
+		ev = hotplug.queue_head;
+		if (ev) {
+			hotplug.queue_head = ev->next;
+			if (!hotplug.queue_head)
+				hotplug.queue_tail = NULL;
+		}
+		pthread_mutex_unlock(&hotplug.queue_mutex);
+		if (!ev)
+			break;
+
+		pthread_mutex_lock(&hotplug.mutex);
+		if (ev->event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+			hotplug_add(ev->device, 1);
+		else
+			hotplug_remove(ev->device);
+		pthread_mutex_unlock(&hotplug.mutex);
+
+		libusb_unref_device(ev->device);
+		free(ev);
+	}
+}
+
+static void *hotplug_thread(void *param)
+{
+	(void)param;
+
+	while (!hotplug.shutdown_thread) {
+		/* An event handled by a read thread is picked up within the timeout */
+		struct timeval tv = { 0, 100000 };
+		libusb_handle_events_timeout_completed(usb_context, &tv, &hotplug.shutdown_thread);
+		hotplug_process_queue();
+	}
+
+	return NULL;
+}
+
+static void hotplug_free_devices(void)
+{
+	while (hotplug.devices) {
+		struct hotplug_device *hd = hotplug.devices;
+		hotplug.devices = hd->next;
+		hid_free_enumeration(hd->info);
+		libusb_unref_device(hd->device);
+		free(hd);
+	}
+}
+
+/* Called with hotplug.mutex held. */
+static int hotplug_start(void)
+{
+	libusb_device **devs;
+	ssize_t num_devs;
+	ssize_t i;
+
+	/* Register before the snapshot so no arrival is missed, hotplug_add()
+	   drops the doubles. */
+	if (libusb_hotplug_register_callback(usb_context,
+		LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, 0,
+		LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+		hotplug_libusb_callback, NULL, &hotplug.libusb_handle) != LIBUSB_SUCCESS)
+		return -1;
+
+	num_devs = libusb_get_device_list(usb_context, &devs);
+	for (i = 0; i < num_devs; i++)
+		hotplug_add(devs[i], 0);
+	if (num_devs >= 0)
+		libusb_free_device_list(devs, 1);
+
+	hotplug.shutdown_thread = 0;
+	if (pthread_create(&hotplug.thread, NULL, hotplug_thread, NULL)) {
+		libusb_hotplug_deregister_callback(usb_context, hotplug.libusb_handle);
+		hotplug_free_devices();
+		return -1;
+	}
+	hotplug.thread_running = 1;
+
+	return 0;
+}
+
+static void hotplug_cleanup(void)
+{
+	if (!hotplug.thread_running)
+		return;
+
+	hotplug.shutdown_thread = 1;
+	libusb_hotplug_deregister_callback(usb_context, hotplug.libusb_handle);
+	pthread_join(hotplug.thread, NULL);
+	hotplug.thread_running = 0;
+
+	pthread_mutex_lock(&hotplug.mutex);
+	while (hotplug.callbacks) {
+		struct hotplug_callback *cb = hotplug.callbacks;
+		hotplug.callbacks = cb->next;
+		free(cb);
+	}
+	hotplug_free_devices();
+	while (hotplug.queue_head) {
+		struct hotplug_event *ev = hotplug.queue_head;
+		hotplug.queue_head = ev->next;
+		libusb_unref_device(ev->device);
+		free(ev);
+	}
+	hotplug.queue_tail = NULL;
+	pthread_mutex_unlock(&hotplug.mutex);
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_register_callback(unsigned short vendor_id, unsigned short product_id, int events, int flags, hid_hotplug_callback_fn callback, void *user_data, hid_hotplug_callback_handle *callback_handle)
+{
+	struct hotplug_callback *cb;
+	struct hotplug_device *hd;
+
+	events &= HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED | HID_API_HOTPLUG_EVENT_DEVICE_LEFT;
+	if (!callback || !events)
+		return -1;
+
+	if (hid_init() < 0)
+		return -1;
+
+	if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+		return -1;
+
+	cb = (struct hotplug_callback*) calloc(1, sizeof(struct hotplug_callback));
+	if (!cb)
+		return -1;
+	cb->vendor_id = vendor_id;
+	cb->product_id = product_id;
+	cb->events = events;
+	cb->callback = callback;
+	cb->user_data = user_data;
+
+	pthread_once(&hotplug.once, hotplug_init_mutexes);
+	pthread_mutex_lock(&hotplug.mutex);
+
+	if (!hotplug.thread_running && hotplug_start() < 0) {
+		pthread_mutex_unlock(&hotplug.mutex);
+		free(cb);
+		return -1;
+	}
+
+	cb->handle = ++hotplug.next_handle;
+	/* At the head, so a callback registered from a callback isn't called
+	   for the event being dispatched */
+	cb->next = hotplug.callbacks;
+	hotplug.callbacks = cb;
+	if (callback_handle)
+		*callback_handle = cb->handle;
+
+	if (flags & HID_API_HOTPLUG_ENUMERATE) {
+		hotplug.dispatching++;
+		for (hd = hotplug.devices; hd; hd = hd->next)
+			hotplug_call(cb, hd->info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+		hotplug.dispatching--;
+		hotplug_purge();
+	}
+
+	pthread_mutex_unlock(&hotplug.mutex);
+
+	return 0;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_deregister_callback(hid_hotplug_callback_handle callback_handle)
+{
+	struct hotplug_callback **pp;
+	int res = -1;
+
+	pthread_once(&hotplug.once, hotplug_init_mutexes);
+	pthread_mutex_lock(&hotplug.mutex);
+
+	for (pp = &hotplug.callbacks; *pp; pp = &(*pp)->next) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->handle == callback_handle && cb->events) {
+			if (hotplug.dispatching) {
+				cb->events = 0; /* Freed by hotplug_purge() */
+			}
+			else {
+				*pp = cb->next;
+				free(cb);
+			}
+			res = 0;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&hotplug.mutex);
+
+	return res;
+}
+
 hid_device * hid_open(unsigned short vendor_id, unsigned short product_id, const wchar_t *serial_number)
 {
 	struct hid_device_info *devs, *cur_dev;
@@ -897,6 +1340,18 @@ hid_device * hid_open(unsigned short vendor_id, unsigned short product_id, const
 	return handle;
 }
 
+/* Account for a read transfer that won't be resubmitted. Once the
+   read thread is shutting down and nothing is left in flight, its
+   event loop can end. */
+static void transfer_finished(hid_device *dev)
+{
+	pthread_mutex_lock(&dev->mutex);
+	dev->transfers_active--;
+	if (dev->shutdown_thread && dev->transfers_active == 0 && dev->writes_pending == 0)
+		dev->transfer_loop_finished = 1;
+	pthread_mutex_unlock(&dev->mutex);
+}
+
 static void read_callback(struct libusb_transfer *transfer)
 {
 	hid_device *dev = transfer->user_data;
@@ -904,36 +1359,27 @@ static void read_callback(struct libusb_transfer *transfer)
 
 	if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
 
-		struct input_report *rpt = (struct input_report*) malloc(sizeof(*rpt));
-		rpt->data = (uint8_t*) malloc(transfer->actual_length);
-		memcpy(rpt->data, transfer->buffer, transfer->actual_length);
-		rpt->len = transfer->actual_length;
-		rpt->next = NULL;
+		struct input_report *rpt;
 
 		pthread_mutex_lock(&dev->mutex);
 
-		/* Attach the new report object to the end of the list. */
-		if (dev->input_reports == NULL) {
-			/* The list is empty. Put it at the root. */
-			dev->input_reports = rpt;
-			pthread_cond_signal(&dev->condition);
+		/* Drop the oldest report if the ring is full. */
+		if (dev->input_count == NUM_INPUT_REPORTS) {
+			return_data(dev, NULL, 0);
+			dev->input_reports_dropped++;
 		}
-		else {
-			/* Find the end of the list and attach. */
-			struct input_report *cur = dev->input_reports;
-			int num_queued = 0;
-			while (cur->next != NULL) {
-				cur = cur->next;
-				num_queued++;
-			}
-			cur->next = rpt;
 
-			/* Pop one off if we've reached 30 in the queue. This
-			   way we don't grow forever if the user never reads
-			   anything from the device. */
-			if (num_queued > 30) {
-				return_data(dev, NULL, 0);
-			}
+		/* Copy into the slot after the newest report. The transfer
+		   buffer is never longer than a slot. */
+		rpt = &dev->input_reports[(dev->input_head + dev->input_count) % NUM_INPUT_REPORTS];
+		memcpy(rpt->data, transfer->buffer, transfer->actual_length);
+		rpt->len = transfer->actual_length;
+		dev->input_count++;
+		dev->input_reports_received++;
+
+		if (dev->input_count == 1) {
+			/* The ring was empty, wake a waiting reader. */
+			pthread_cond_signal(&dev->condition);
 		}
 		pthread_mutex_unlock(&dev->mutex);
 	}
@@ -951,7 +1397,7 @@ static void read_callback(struct libusb_transfer *transfer)
 	}
 
 	if (dev->shutdown_thread) {
-		dev->transfer_loop_finished = 1;
+		transfer_finished(dev);
 		return;
 	}
 
@@ -960,37 +1406,80 @@ static void read_callback(struct libusb_transfer *transfer)
 	if (res != 0) {
 		LOG("Unable to submit URB: (%d) %s\n", res, libusb_error_name(res));
 		dev->shutdown_thread = 1;
-		dev->transfer_loop_finished = 1;
+		transfer_finished(dev);
+	}
+}
+
+static void write_callback(struct libusb_transfer *transfer)
+{
+	struct write_slot *slot = transfer->user_data;
+	hid_device *dev = slot->dev;
+
+	pthread_mutex_lock(&dev->mutex);
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		LOG("Async write failed: %d\n", transfer->status);
+		dev->write_error = 1;
 	}
+
+	/* Give the slot back and wake hid_write_async() or
+	   hid_write_async_wait(). */
+	dev->write_free[dev->write_free_count++] = slot;
+	dev->writes_pending--;
+	if (dev->shutdown_thread && dev->transfers_active == 0 && dev->writes_pending == 0)
+		dev->transfer_loop_finished = 1;
+	pthread_cond_broadcast(&dev->write_condition);
+
+	pthread_mutex_unlock(&dev->mutex);
 }
 
 
 static void *read_thread(void *param)
 {
+	int i;
 	int res;
 	hid_device *dev = param;
 	uint8_t *buf;
 	const size_t length = dev->input_ep_max_packet_size;
 
-	/* Set up the transfer object. */
-	buf = (uint8_t*) malloc(length);
-	dev->transfer = libusb_alloc_transfer(0);
-	libusb_fill_interrupt_transfer(dev->transfer,
-		dev->device_handle,
-		dev->input_endpoint,
-		buf,
-		length,
-		read_callback,
-		dev,
-		5000/*timeout*/);
-
-	/* Make the first submission. Further submissions are made
+	/* Set up the write slots. Their buffers are allocated by
+	   hid_write_async() and kept for reuse. */
+	for (i = 0; i < HID_API_MAX_ASYNC_WRITES; i++) {
+		dev->write_slots[i].dev = dev;
+		dev->write_slots[i].transfer = libusb_alloc_transfer(0);
+		dev->write_slots[i].transfer->buffer = NULL;
+		dev->write_slots[i].buffer_size = 0;
+		dev->write_free[i] = &dev->write_slots[i];
+	}
+	dev->write_free_count = HID_API_MAX_ASYNC_WRITES;
+
+	/* Set up the transfer objects. */
+	for (i = 0; i < NUM_READ_TRANSFERS; i++) {
+		buf = (uint8_t*) malloc(length);
+		dev->transfers[i] = libusb_alloc_transfer(0);
+		libusb_fill_interrupt_transfer(dev->transfers[i],
+			dev->device_handle,
+			dev->input_endpoint,
+			buf,
+			length,
+			read_callback,
+			dev,
+			5000/*timeout*/);
+	}
+
+	/* Make the first submissions. Further submissions are made
 	   from inside read_callback() */
-	res = libusb_submit_transfer(dev->transfer);
-	if(res < 0) {
-                LOG("libusb_submit_transfer failed: %d %s. Stopping read_thread from running\n", res, libusb_error_name(res));
-                dev->shutdown_thread = 1;
-                dev->transfer_loop_finished = 1;
+	for (i = 0; i < NUM_READ_TRANSFERS && !dev->shutdown_thread; i++) {
+		res = libusb_submit_transfer(dev->transfers[i]);
+		if(res < 0) {
+			LOG("libusb_submit_transfer failed: %d %s. Stopping read_thread from running\n", res, libusb_error_name(res));
+			dev->shutdown_thread = 1;
+		}
+		else {
+			pthread_mutex_lock(&dev->mutex);
+			dev->transfers_active++;
+			pthread_mutex_unlock(&dev->mutex);
+		}
 	}
 
 	/* Notify the main thread that the read thread is up and running. */
@@ -1014,9 +1503,20 @@ static void *read_thread(void *param)
 		}
 	}
 
-	/* Cancel any transfer that may be pending. This call will fail
-	   if no transfers are pending, but that's OK. */
-	libusb_cancel_transfer(dev->transfer);
+	/* Stop hid_write_async() from submitting more transfers. */
+	pthread_mutex_lock(&dev->mutex);
+	dev->shutdown_thread = 1;
+	dev->writes_closed = 1;
+	if (dev->transfers_active == 0 && dev->writes_pending == 0)
+		dev->transfer_loop_finished = 1;
+	pthread_mutex_unlock(&dev->mutex);
+
+	/* Cancel any transfer that may be pending. These calls will fail
+	   for transfers that aren't pending, but that's OK. */
+	for (i = 0; i < NUM_READ_TRANSFERS; i++)
+		libusb_cancel_transfer(dev->transfers[i]);
+	for (i = 0; i < HID_API_MAX_ASYNC_WRITES; i++)
+		libusb_cancel_transfer(dev->write_slots[i].transfer);
 
 	while (!dev->transfer_loop_finished)
 		libusb_handle_events_completed(usb_context, &dev->transfer_loop_finished);
@@ -1028,9 +1528,10 @@ static void *read_thread(void *param)
 	   signaled. */
 	pthread_mutex_lock(&dev->mutex);
 	pthread_cond_broadcast(&dev->condition);
+	pthread_cond_broadcast(&dev->write_condition);
 	pthread_mutex_unlock(&dev->mutex);
 
-	/* The dev->transfer->buffer and dev->transfer objects are cleaned up
+	/* The transfer buffers and transfer objects are cleaned up
 	   in hid_close(). They are not cleaned up here because this thread
 	   could end either due to a disconnect or due to a user
 	   call to hid_close(). In both cases the objects can be safely
@@ -1126,6 +1627,17 @@ static int hidapi_initialize_device(hid_device *dev, int config_number, const st
 		}
 	}
 
+	/* Allocate the input report ring once, each slot holds one
+	   transfer's worth of data. */
+	dev->input_report_data = (uint8_t*) malloc(NUM_INPUT_REPORTS * dev->input_ep_max_packet_size);
+	if (!dev->input_report_data) {
+		LOG("Unable to allocate the input report ring\n");
+		libusb_release_interface(dev->device_handle, dev->interface);
+		return 0;
+	}
+	for (i = 0; i < NUM_INPUT_REPORTS; i++)
+		dev->input_reports[i].data = dev->input_report_data + i * dev->input_ep_max_packet_size;
+
 	pthread_create(&dev->thread, NULL, read_thread, dev);
 
 	/* Wait here for the read thread to be initialized. */
@@ -1326,19 +1838,151 @@ int HID_API_EXPORT hid_write(hid_device *dev, const unsigned char *data, size_t
 	}
 }
 
+/* Convert a relative timeout into the absolute time used by
+   pthread_cond_timedwait(). */
+static void get_timeout_ts(struct timespec *ts, int milliseconds)
+{
+	clock_gettime(CLOCK_REALTIME, ts);
+	ts->tv_sec += milliseconds / 1000;
+	ts->tv_nsec += (milliseconds % 1000) * 1000000;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+int HID_API_EXPORT hid_write_async(hid_device *dev, const unsigned char *data, size_t length)
+{
+	struct write_slot *slot;
+	unsigned char *buf;
+	size_t size;
+	int res;
+	int report_number;
+	int skipped_report_id = 0;
+
+	if (!data || (length == 0)) {
+		return -1;
+	}
+
+	report_number = data[0];
+
+	if (report_number == 0x0) {
+		data++;
+		length--;
+		skipped_report_id = 1;
+	}
+
+	/* Wait for a free slot */
+	pthread_mutex_lock(&dev->mutex);
+	while (dev->write_free_count == 0 && !dev->writes_closed)
+		pthread_cond_wait(&dev->write_condition, &dev->mutex);
+	if (dev->writes_closed) {
+		pthread_mutex_unlock(&dev->mutex);
+		return -1;
+	}
+	slot = dev->write_free[--dev->write_free_count];
+	pthread_mutex_unlock(&dev->mutex);
+
+	/* The slot is ours until write_callback() gives it back. Grow its
+	   buffer only when a longer report than before is sent. */
+	size = (dev->output_endpoint <= 0)? LIBUSB_CONTROL_SETUP_SIZE + length: length;
+	if (slot->buffer_size < size) {
+		buf = (unsigned char*) realloc(slot->transfer->buffer, size);
+		if (!buf) {
+			res = LIBUSB_ERROR_NO_MEM;
+			goto err;
+		}
+		slot->transfer->buffer = buf;
+		slot->buffer_size = size;
+	}
+	buf = slot->transfer->buffer;
+
+	if (dev->output_endpoint <= 0) {
+		/* No interrupt out endpoint. Use the Control Endpoint */
+		libusb_fill_control_setup(buf,
+			LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE|LIBUSB_ENDPOINT_OUT,
+			0x09/*HID Set_Report*/,
+			(2/*HID output*/ << 8) | report_number,
+			dev->interface,
+			length);
+		memcpy(buf + LIBUSB_CONTROL_SETUP_SIZE, data, length);
+		libusb_fill_control_transfer(slot->transfer, dev->device_handle,
+			buf, write_callback, slot, 1000/*timeout millis*/);
+	}
+	else {
+		/* Use the interrupt out endpoint */
+		memcpy(buf, data, length);
+		libusb_fill_interrupt_transfer(slot->transfer, dev->device_handle,
+			dev->output_endpoint, buf, length, write_callback, slot, 1000);
+	}
+
+	/* Submit under the mutex so read_thread() can't close writes
+	   between the check above and the submission. */
+	pthread_mutex_lock(&dev->mutex);
+	if (dev->writes_closed) {
+		pthread_mutex_unlock(&dev->mutex);
+		res = LIBUSB_ERROR_NO_DEVICE;
+		goto err;
+	}
+	res = libusb_submit_transfer(slot->transfer);
+	if (res == 0)
+		dev->writes_pending++;
+	pthread_mutex_unlock(&dev->mutex);
+	if (res < 0)
+		goto err;
+
+	if (skipped_report_id)
+		length++;
+
+	return length;
+
+err:
+	LOG("hid_write_async failed: (%d) %s\n", res, libusb_error_name(res));
+	pthread_mutex_lock(&dev->mutex);
+	dev->write_free[dev->write_free_count++] = slot;
+	pthread_cond_broadcast(&dev->write_condition);
+	pthread_mutex_unlock(&dev->mutex);
+	return -1;
+}
+
+int HID_API_EXPORT hid_write_async_wait(hid_device *dev, int milliseconds)
+{
+	struct timespec ts;
+	int res;
+
+	pthread_mutex_lock(&dev->mutex);
+
+	if (milliseconds > 0)
+		get_timeout_ts(&ts, milliseconds);
+
+	while (dev->writes_pending > 0 && !dev->writes_closed && milliseconds != 0) {
+		if (milliseconds < 0)
+			pthread_cond_wait(&dev->write_condition, &dev->mutex);
+		else if (pthread_cond_timedwait(&dev->write_condition, &dev->mutex, &ts) == ETIMEDOUT)
+			break;
+	}
+
+	/* Report a failure once, then start counting again */
+	res = (dev->write_error)? -1: dev->writes_pending;
+	dev->write_error = 0;
+
+	pthread_mutex_unlock(&dev->mutex);
+
+	return res;
+}
+
 /* Helper function, to simplify hid_read().
    This should be called with dev->mutex locked. */
 static int return_data(hid_device *dev, unsigned char *data, size_t length)
 {
-	/* Copy the data out of the linked list item (rpt) into the
-	   return buffer (data), and delete the liked list item. */
-	struct input_report *rpt = dev->input_reports;
+	/* Copy the data out of the oldest slot (rpt) into the return
+	   buffer (data), and free the slot. */
+	struct input_report *rpt = &dev->input_reports[dev->input_head];
 	size_t len = (length < rpt->len)? length: rpt->len;
 	if (len > 0)
 		memcpy(data, rpt->data, len);
-	dev->input_reports = rpt->next;
-	free(rpt->data);
-	free(rpt);
+	dev->input_head = (dev->input_head + 1) % NUM_INPUT_REPORTS;
+	dev->input_count--;
 	return len;
 }
 
@@ -1367,7 +2011,7 @@ int HID_API_EXPORT hid_read_timeout(hid_device *dev, unsigned char *data, size_t
 	bytes_read = -1;
 
 	/* There's an input report queued up. Return it. */
-	if (dev->input_reports) {
+	if (dev->input_count) {
 		/* Return the first one */
 		bytes_read = return_data(dev, data, length);
 		goto ret;
@@ -1382,10 +2026,10 @@ int HID_API_EXPORT hid_read_timeout(hid_device *dev, unsigned char *data, size_t
 
 	if (milliseconds == -1) {
 		/* Blocking */
-		while (!dev->input_reports && !dev->shutdown_thread) {
+		while (!dev->input_count && !dev->shutdown_thread) {
 			pthread_cond_wait(&dev->condition, &dev->mutex);
 		}
-		if (dev->input_reports) {
+		if (dev->input_count) {
 			bytes_read = return_data(dev, data, length);
 		}
 	}
@@ -1393,18 +2037,12 @@ int HID_API_EXPORT hid_read_timeout(hid_device *dev, unsigned char *data, size_t
 		/* Non-blocking, but called with timeout. */
 		int res;
 		struct timespec ts;
-		clock_gettime(CLOCK_REALTIME, &ts);
-		ts.tv_sec += milliseconds / 1000;
-		ts.tv_nsec += (milliseconds % 1000) * 1000000;
-		if (ts.tv_nsec >= 1000000000L) {
-			ts.tv_sec++;
-			ts.tv_nsec -= 1000000000L;
-		}
+		get_timeout_ts(&ts, milliseconds);
 
-		while (!dev->input_reports && !dev->shutdown_thread) {
+		while (!dev->input_count && !dev->shutdown_thread) {
 			res = pthread_cond_timedwait(&dev->condition, &dev->mutex, &ts);
 			if (res == 0) {
-				if (dev->input_reports) {
+				if (dev->input_count) {
 					bytes_read = return_data(dev, data, length);
 					break;
 				}
@@ -1442,6 +2080,44 @@ int HID_API_EXPORT hid_read(hid_device *dev, unsigned char *data, size_t length)
 	return hid_read_timeout(dev, data, length, dev->blocking ? -1 : 0);
 }
 
+int HID_API_EXPORT hid_read_batch(hid_device *dev, struct hid_report_buffer *bufs, size_t n, int milliseconds)
+{
+	size_t count;
+	int res;
+
+	if (!bufs || n == 0)
+		return -1;
+
+	/* Wait for the first report as hid_read_timeout() does */
+	res = hid_read_timeout(dev, bufs[0].data, bufs[0].length, milliseconds);
+	if (res <= 0)
+		return res;
+	bufs[0].actual_length = res;
+	count = 1;
+
+	/* Then take whatever else is already queued under one lock */
+	pthread_mutex_lock(&dev->mutex);
+	while (count < n && dev->input_count) {
+		bufs[count].actual_length = return_data(dev, bufs[count].data, bufs[count].length);
+		count++;
+	}
+	pthread_mutex_unlock(&dev->mutex);
+
+	return (int)count;
+}
+
+int HID_API_EXPORT_CALL hid_libusb_get_input_stats(hid_device *dev, unsigned long *received, unsigned long *dropped)
+{
+	pthread_mutex_lock(&dev->mutex);
+	if (received)
+		*received = dev->input_reports_received;
+	if (dropped)
+		*dropped = dev->input_reports_dropped;
+	pthread_mutex_unlock(&dev->mutex);
+
+	return 0;
+}
+
 int HID_API_EXPORT hid_set_nonblocking(hid_device *dev, int nonblock)
 {
 	dev->blocking = !nonblock;
@@ -1542,20 +2218,30 @@ int HID_API_EXPORT HID_API_CALL hid_get_input_report(hid_device *dev, unsigned c
 
 void HID_API_EXPORT hid_close(hid_device *dev)
 {
+	int i;
+
 	if (!dev)
 		return;
 
 	/* Cause read_thread() to stop. */
 	dev->shutdown_thread = 1;
-	libusb_cancel_transfer(dev->transfer);
+	for (i = 0; i < NUM_READ_TRANSFERS; i++)
+		libusb_cancel_transfer(dev->transfers[i]);
 
 	/* Wait for read_thread() to end. */
 	pthread_join(dev->thread, NULL);
 
 	/* Clean up the Transfer objects allocated in read_thread(). */
-	free(dev->transfer->buffer);
-	dev->transfer->buffer = NULL;
-	libusb_free_transfer(dev->transfer);
+	for (i = 0; i < NUM_READ_TRANSFERS; i++) {
+		free(dev->transfers[i]->buffer);
+		dev->transfers[i]->buffer = NULL;
+		libusb_free_transfer(dev->transfers[i]);
+	}
+	for (i = 0; i < HID_API_MAX_ASYNC_WRITES; i++) {
+		free(dev->write_slots[i].transfer->buffer);
+		dev->write_slots[i].transfer->buffer = NULL;
+		libusb_free_transfer(dev->write_slots[i].transfer);
+	}
 
 	/* release the interface */
 	libusb_release_interface(dev->device_handle, dev->interface);
@@ -1572,13 +2258,6 @@ void HID_API_EXPORT hid_close(hid_device *dev)
 	/* Close the handle */
 	libusb_close(dev->device_handle);
 
-	/* Clear out the queue of received reports. */
-	pthread_mutex_lock(&dev->mutex);
-	while (dev->input_reports) {
-		return_data(dev, NULL, 0);
-	}
-	pthread_mutex_unlock(&dev->mutex);
-
 	free_hid_device(dev);
 }
 
@@ -35,6 +35,8 @@
 #include <sys/utsname.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <pthread.h>
+#include <time.h>
 
 /* Linux */
 #include <linux/hidraw.h>
@@ -73,6 +75,21 @@ struct hid_device_ {
 	int blocking;
 	wchar_t *last_error_str;
 	struct hid_device_info* device_info;
+
+	/* hid_write_async() ring, drained by write_thread(). hidraw
+	   writes block until the report is sent, so the thread is what
+	   lets the caller keep reports queued. */
+	pthread_t write_thread;
+	pthread_mutex_t write_mutex; /* Protects everything below */
+	pthread_cond_t write_condition;
+	unsigned char *write_buffers[HID_API_MAX_ASYNC_WRITES];
+	size_t write_buffer_size[HID_API_MAX_ASYNC_WRITES];
+	size_t write_length[HID_API_MAX_ASYNC_WRITES];
+	int write_head;
+	int write_count;
+	int write_thread_started;
+	int write_shutdown;
+	int write_errno;
 };
 
 static struct hid_api_version api_version = {
@@ -83,6 +100,7 @@ static struct hid_api_version api_version = {
 
 static wchar_t *last_global_error_str = NULL;
 
+static void hotplug_cleanup(void);
 
 static hid_device *new_hid_device(void)
 {
@@ -96,6 +114,9 @@ static hid_device *new_hid_device(void)
 	dev->last_error_str = NULL;
 	dev->device_info = NULL;
 
+	pthread_mutex_init(&dev->write_mutex, NULL);
+	pthread_cond_init(&dev->write_condition, NULL);
+
 	return dev;
 }
 
@@ -813,6 +834,8 @@ int HID_API_EXPORT hid_init(void)
 
 int HID_API_EXPORT hid_exit(void)
 {
+	hotplug_cleanup();
+
 	/* Free global error message */
 	register_global_error(NULL);
 
@@ -920,6 +943,385 @@ void  HID_API_EXPORT hid_free_enumeration(struct hid_device_info *devs)
 	}
 }
 
+/* Hotplug. A udev monitor on the hidraw subsystem, read by the hotplug
+   thread, which builds the device info and calls the user callbacks. */
+struct hotplug_callback {
+	hid_hotplug_callback_handle handle;
+	unsigned short vendor_id;
+	unsigned short product_id;
+	int events; /* 0 once deregistered while callbacks are being called */
+	hid_hotplug_callback_fn callback;
+	void *user_data;
+	struct hotplug_callback *next;
+};
+
+/* A connected hidraw node and its usages, so that LEFT can report what
+   left once the node is gone. */
+struct hotplug_device {
+	struct hid_device_info *info; /* info->path is the node */
+	struct hotplug_device *next;
+};
+
+static struct {
+	pthread_once_t once;
+	pthread_mutex_t mutex; /* Recursive, callbacks may (de)register callbacks */
+	struct hotplug_callback *callbacks;
+	hid_hotplug_callback_handle next_handle;
+	int dispatching;
+	struct hotplug_device *devices;
+	struct udev *udev;
+	struct udev_monitor *monitor;
+	int wake_pipe[2]; /* Written by hotplug_cleanup() to stop the thread */
+	pthread_t thread;
+	int thread_running;
+} hotplug = { .once = PTHREAD_ONCE_INIT };
+
+static void hotplug_init_mutexes(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&hotplug.mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+static int hotplug_match(const struct hotplug_callback *cb, const struct hid_device_info *info)
+{
+	return (cb->vendor_id == 0x0 || cb->vendor_id == info->vendor_id) &&
+	       (cb->product_id == 0x0 || cb->product_id == info->product_id);
+}
+
+/* Call cb for every entry in info that it matches. Called with
+   hotplug.mutex held and hotplug.dispatching raised. */
+static void hotplug_call(struct hotplug_callback *cb, struct hid_device_info *info, hid_hotplug_event event)
+{
+	struct hid_device_info *cur;
+
+	for (cur = info; cur && (cb->events & event); cur = cur->next) {
+		struct hid_device_info *next = cur->next;
+		if (!hotplug_match(cb, cur))
+			continue;
+
+		/* The callback sees a single entry */
+		cur->next = NULL;
+		if (cb->callback(cb->handle, cur, event, cb->user_data))
+			cb->events = 0;
+		cur->next = next;
+	}
+}
+
+/* Free the callbacks deregistered while callbacks were being called. */
+static void hotplug_purge(void)
+{
+	struct hotplug_callback **pp = &hotplug.callbacks;
+
+	if (hotplug.dispatching)
+		return;
+
+	while (*pp) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->events == 0) {
+			*pp = cb->next;
+			free(cb);
+		}
+		else {
+			pp = &cb->next;
+		}
+	}
+}
+
+static void hotplug_dispatch(struct hid_device_info *info, hid_hotplug_event event)
+{
+	struct hotplug_callback *cb;
+
+	hotplug.dispatching++;
+	for (cb = hotplug.callbacks; cb; cb = cb->next)
+		hotplug_call(cb, info, event);
+	hotplug.dispatching--;
+	hotplug_purge();
+}
+
+static struct hotplug_device *hotplug_find(const char *path, struct hotplug_device ***link)
+{
+	struct hotplug_device **pp;
+
+	for (pp = &hotplug.devices; *pp; pp = &(*pp)->next) {
+		if ((*pp)->info->path && strcmp((*pp)->info->path, path) == 0) {
+			if (link)
+				*link = pp;
+			return *pp;
+		}
+	}
+	return NULL;
+}
+
+/* Takes ownership of info, all entries of one node. */
+static void hotplug_add(struct hid_device_info *info, int notify)
+{
+	struct hotplug_device *hd;
+
+	if (!info->path || hotplug_find(info->path, NULL)) {
+		/* Arrived between starting the monitor and the snapshot */
+		hid_free_enumeration(info);
+		return;
+	}
+
+	hd = (struct hotplug_device*) calloc(1, sizeof(struct hotplug_device));
+	if (!hd) {
+		hid_free_enumeration(info);
+		return;
+	}
+	hd->info = info;
+	hd->next = hotplug.devices;
+	hotplug.devices = hd;
+
+	if (notify)
+		hotplug_dispatch(info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+}
+
+static void hotplug_remove(const char *path)
+{
+	struct hotplug_device **link;
+	struct hotplug_device *hd = hotplug_find(path, &link);
+
+	if (!hd)
+		return;
+	*link = hd->next;
+
+	hotplug_dispatch(hd->info, HID_API_HOTPLUG_EVENT_DEVICE_LEFT);
+	hid_free_enumeration(hd->info);
+	free(hd);
+}
+
+static void *hotplug_thread(void *param)
+{
+	struct pollfd fds[2];
+	(void)param;
+
+	fds[0].fd = udev_monitor_get_fd(hotplug.monitor);
+	fds[0].events = POLLIN;
+	fds[1].fd = hotplug.wake_pipe[0];
+	fds[1].events = POLLIN;
+
+	for (;;) {
+		struct udev_device *raw_dev;
+		const char *action;
+		const char *path;
+
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (fds[1].revents)
+			break; /* hotplug_cleanup() */
+		if (!(fds[0].revents & POLLIN))
+			continue;
+
+		raw_dev = udev_monitor_receive_device(hotplug.monitor);
+		if (!raw_dev)
+			continue;
+
+		action = udev_device_get_action(raw_dev);
+		path = udev_device_get_devnode(raw_dev);
+		if (action && path) {
+			pthread_mutex_lock(&hotplug.mutex);
+			if (strcmp(action, "add") == 0) {
+				struct hid_device_info *info = create_device_info_for_device(raw_dev);
+				if (info)
+					hotplug_add(info, 1);
+			}
+			else if (strcmp(action, "remove") == 0) {
+				hotplug_remove(path);
+			}
+			pthread_mutex_unlock(&hotplug.mutex);
+		}
+		udev_device_unref(raw_dev);
+	}
+
+	return NULL;
+}
+
+static void hotplug_free(void)
+{
+	while (hotplug.devices) {
+		struct hotplug_device *hd = hotplug.devices;
+		hotplug.devices = hd->next;
+		hid_free_enumeration(hd->info);
+		free(hd);
+	}
+	if (hotplug.monitor) {
+		udev_monitor_unref(hotplug.monitor);
+		hotplug.monitor = NULL;
+	}
+	if (hotplug.udev) {
+		udev_unref(hotplug.udev);
+		hotplug.udev = NULL;
+	}
+}
+
+/* Called with hotplug.mutex held. */
+static int hotplug_start(void)
+{
+	struct hid_device_info *devs;
+
+	hotplug.udev = udev_new();
+	if (!hotplug.udev) {
+		register_global_error("Couldn't create udev context");
+		return -1;
+	}
+
+	/* Monitor before the snapshot so no arrival is missed, hotplug_add()
+	   drops the doubles. */
+	hotplug.monitor = udev_monitor_new_from_netlink(hotplug.udev, "udev");
+	if (!hotplug.monitor ||
+	    udev_monitor_filter_add_match_subsystem_devtype(hotplug.monitor, "hidraw", NULL) < 0 ||
+	    udev_monitor_enable_receiving(hotplug.monitor) < 0) {
+		register_global_error("Couldn't create udev monitor");
+		hotplug_free();
+		return -1;
+	}
+
+	/* hid_enumerate() lists the usages of one node one after another */
+	devs = hid_enumerate(0x0, 0x0);
+	while (devs) {
+		struct hid_device_info *last = devs;
+		struct hid_device_info *rest;
+		while (last->next && last->path && last->next->path && strcmp(last->next->path, last->path) == 0)
+			last = last->next;
+		rest = last->next;
+		last->next = NULL;
+		hotplug_add(devs, 0);
+		devs = rest;
+	}
+	register_global_error(NULL);
+
+	if (pipe(hotplug.wake_pipe) < 0) {
+		register_global_error_format("pipe failed: %s", strerror(errno));
+		hotplug_free();
+		return -1;
+	}
+	if (pthread_create(&hotplug.thread, NULL, hotplug_thread, NULL)) {
+		register_global_error("Couldn't start the hotplug thread");
+		close(hotplug.wake_pipe[0]);
+		close(hotplug.wake_pipe[1]);
+		hotplug_free();
+		return -1;
+	}
+	hotplug.thread_running = 1;
+
+	return 0;
+}
+
+static void hotplug_cleanup(void)
+{
+	ssize_t res;
+
+	if (!hotplug.thread_running)
+		return;
+
+	/* Wake the thread out of poll() */
+	res = write(hotplug.wake_pipe[1], "", 1);
+	(void)res;
+	pthread_join(hotplug.thread, NULL);
+	hotplug.thread_running = 0;
+	close(hotplug.wake_pipe[0]);
+	close(hotplug.wake_pipe[1]);
+
+	pthread_mutex_lock(&hotplug.mutex);
+	while (hotplug.callbacks) {
+		struct hotplug_callback *cb = hotplug.callbacks;
+		hotplug.callbacks = cb->next;
+		free(cb);
+	}
+	hotplug_free();
+	pthread_mutex_unlock(&hotplug.mutex);
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_register_callback(unsigned short vendor_id, unsigned short product_id, int events, int flags, hid_hotplug_callback_fn callback, void *user_data, hid_hotplug_callback_handle *callback_handle)
+{
+	struct hotplug_callback *cb;
+	struct hotplug_device *hd;
+
+	hid_init();
+	/* register_global_error: global error is reset by hid_init */
+
+	events &= HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED | HID_API_HOTPLUG_EVENT_DEVICE_LEFT;
+	if (!callback || !events) {
+		register_global_error("Invalid hotplug callback or events");
+		return -1;
+	}
+
+	cb = (struct hotplug_callback*) calloc(1, sizeof(struct hotplug_callback));
+	if (!cb) {
+		register_global_error("Couldn't allocate memory");
+		return -1;
+	}
+	cb->vendor_id = vendor_id;
+	cb->product_id = product_id;
+	cb->events = events;
+	cb->callback = callback;
+	cb->user_data = user_data;
+
+	pthread_once(&hotplug.once, hotplug_init_mutexes);
+	pthread_mutex_lock(&hotplug.mutex);
+
+	if (!hotplug.thread_running && hotplug_start() < 0) {
+		pthread_mutex_unlock(&hotplug.mutex);
+		free(cb);
+		return -1;
+	}
+
+	cb->handle = ++hotplug.next_handle;
+	/* At the head, so a callback registered from a callback isn't called
+	   for the event being dispatched */
+	cb->next = hotplug.callbacks;
+	hotplug.callbacks = cb;
+	if (callback_handle)
+		*callback_handle = cb->handle;
+
+	if (flags & HID_API_HOTPLUG_ENUMERATE) {
+		hotplug.dispatching++;
+		for (hd = hotplug.devices; hd; hd = hd->next)
+			hotplug_call(cb, hd->info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+		hotplug.dispatching--;
+		hotplug_purge();
+	}
+
+	pthread_mutex_unlock(&hotplug.mutex);
+
+	return 0;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_deregister_callback(hid_hotplug_callback_handle callback_handle)
+{
+	struct hotplug_callback **pp;
+	int res = -1;
+
+	pthread_once(&hotplug.once, hotplug_init_mutexes);
+	pthread_mutex_lock(&hotplug.mutex);
+
+	for (pp = &hotplug.callbacks; *pp; pp = &(*pp)->next) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->handle == callback_handle && cb->events) {
+			if (hotplug.dispatching) {
+				cb->events = 0; /* Freed by hotplug_purge() */
+			}
+			else {
+				*pp = cb->next;
+				free(cb);
+			}
+			res = 0;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&hotplug.mutex);
+
+	return res;
+}
+
 hid_device * hid_open(unsigned short vendor_id, unsigned short product_id, const wchar_t *serial_number)
 {
 	struct hid_device_info *devs, *cur_dev;
@@ -1018,6 +1420,130 @@ int HID_API_EXPORT hid_write(hid_device *dev, const unsigned char *data, size_t
 }
 
 
+static void *write_thread(void *param)
+{
+	hid_device *dev = param;
+	int slot;
+	ssize_t res;
+
+	pthread_mutex_lock(&dev->write_mutex);
+	for (;;) {
+		while (dev->write_count == 0 && !dev->write_shutdown)
+			pthread_cond_wait(&dev->write_condition, &dev->write_mutex);
+		if (dev->write_shutdown)
+			break;
+
+		/* The head slot isn't touched by hid_write_async() until
+		   write_count says it's free again. */
+		slot = dev->write_head;
+		pthread_mutex_unlock(&dev->write_mutex);
+
+		res = write(dev->device_handle, dev->write_buffers[slot], dev->write_length[slot]);
+
+		pthread_mutex_lock(&dev->write_mutex);
+		if (res < 0 && dev->write_errno == 0)
+			dev->write_errno = errno;
+		dev->write_head = (slot + 1) % HID_API_MAX_ASYNC_WRITES;
+		dev->write_count--;
+		pthread_cond_broadcast(&dev->write_condition);
+	}
+	pthread_mutex_unlock(&dev->write_mutex);
+
+	return NULL;
+}
+
+int HID_API_EXPORT hid_write_async(hid_device *dev, const unsigned char *data, size_t length)
+{
+	unsigned char *buf;
+	int slot;
+
+	if (!data || (length == 0)) {
+		errno = EINVAL;
+		register_device_error(dev, strerror(errno));
+		return -1;
+	}
+
+	register_device_error(dev, NULL);
+
+	pthread_mutex_lock(&dev->write_mutex);
+
+	/* Only start the writer for handles that use it */
+	if (!dev->write_thread_started) {
+		if (pthread_create(&dev->write_thread, NULL, write_thread, dev) != 0) {
+			pthread_mutex_unlock(&dev->write_mutex);
+			register_device_error(dev, "hid_write_async: couldn't start write thread");
+			return -1;
+		}
+		dev->write_thread_started = 1;
+	}
+
+	/* Wait for a free slot */
+	while (dev->write_count == HID_API_MAX_ASYNC_WRITES)
+		pthread_cond_wait(&dev->write_condition, &dev->write_mutex);
+
+	/* Slot buffers are kept between reports and only grow */
+	slot = (dev->write_head + dev->write_count) % HID_API_MAX_ASYNC_WRITES;
+	if (dev->write_buffer_size[slot] < length) {
+		buf = (unsigned char*) realloc(dev->write_buffers[slot], length);
+		if (!buf) {
+			pthread_mutex_unlock(&dev->write_mutex);
+			register_device_error(dev, "Couldn't allocate memory");
+			return -1;
+		}
+		dev->write_buffers[slot] = buf;
+		dev->write_buffer_size[slot] = length;
+	}
+	memcpy(dev->write_buffers[slot], data, length);
+	dev->write_length[slot] = length;
+	dev->write_count++;
+	pthread_cond_broadcast(&dev->write_condition);
+
+	pthread_mutex_unlock(&dev->write_mutex);
+
+	return (int)length;
+}
+
+int HID_API_EXPORT hid_write_async_wait(hid_device *dev, int milliseconds)
+{
+	struct timespec ts;
+	int res;
+
+	pthread_mutex_lock(&dev->write_mutex);
+
+	if (milliseconds > 0) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += milliseconds / 1000;
+		ts.tv_nsec += (milliseconds % 1000) * 1000000;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+	}
+
+	while (dev->write_count > 0 && milliseconds != 0) {
+		if (milliseconds < 0)
+			pthread_cond_wait(&dev->write_condition, &dev->write_mutex);
+		else if (pthread_cond_timedwait(&dev->write_condition, &dev->write_mutex, &ts) == ETIMEDOUT)
+			break;
+	}
+
+	/* Report a failure once, then start counting again */
+	if (dev->write_errno) {
+		register_device_error(dev, strerror(dev->write_errno));
+		dev->write_errno = 0;
+		res = -1;
+	}
+	else {
+		register_device_error(dev, NULL);
+		res = dev->write_count;
+	}
+
+	pthread_mutex_unlock(&dev->write_mutex);
+
+	return res;
+}
+
+
 int HID_API_EXPORT hid_read_timeout(hid_device *dev, unsigned char *data, size_t length, int milliseconds)
 {
 	/* Set device error to none */
@@ -1075,6 +1601,37 @@ int HID_API_EXPORT hid_read(hid_device *dev, unsigned char *data, size_t length)
 	return hid_read_timeout(dev, data, length, (dev->blocking)? -1: 0);
 }
 
+int HID_API_EXPORT hid_read_batch(hid_device *dev, struct hid_report_buffer *bufs, size_t n, int milliseconds)
+{
+	size_t count;
+	int res;
+
+	if (!bufs || n == 0) {
+		errno = EINVAL;
+		register_device_error(dev, strerror(errno));
+		return -1;
+	}
+
+	/* Wait for the first report as hid_read_timeout() does */
+	res = hid_read_timeout(dev, bufs[0].data, bufs[0].length, milliseconds);
+	if (res <= 0)
+		return res;
+	bufs[0].actual_length = res;
+	count = 1;
+
+	/* Then take whatever else the kernel already has queued. An
+	   error here is returned by the next read instead. */
+	while (count < n) {
+		res = hid_read_timeout(dev, bufs[count].data, bufs[count].length, 0);
+		if (res <= 0)
+			break;
+		bufs[count].actual_length = res;
+		count++;
+	}
+
+	return (int)count;
+}
+
 int HID_API_EXPORT hid_set_nonblocking(hid_device *dev, int nonblock)
 {
 	/* Do all non-blocking in userspace using poll(), since it looks
@@ -1127,9 +1684,24 @@ int HID_API_EXPORT HID_API_CALL hid_get_input_report(hid_device *dev, unsigned c
 
 void HID_API_EXPORT hid_close(hid_device *dev)
 {
+	int i;
+
 	if (!dev)
 		return;
 
+	/* Stop write_thread(), reports it hasn't started on are dropped */
+	if (dev->write_thread_started) {
+		pthread_mutex_lock(&dev->write_mutex);
+		dev->write_shutdown = 1;
+		pthread_cond_broadcast(&dev->write_condition);
+		pthread_mutex_unlock(&dev->write_mutex);
+		pthread_join(dev->write_thread, NULL);
+	}
+	for (i = 0; i < HID_API_MAX_ASYNC_WRITES; i++)
+		free(dev->write_buffers[i]);
+	pthread_cond_destroy(&dev->write_condition);
+	pthread_mutex_destroy(&dev->write_mutex);
+
 	close(dev->device_handle);
 
 	/* Free the device error message */
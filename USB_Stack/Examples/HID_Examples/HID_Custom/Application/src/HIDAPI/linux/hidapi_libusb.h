@@ -49,6 +49,25 @@ extern "C" {
 		*/
 		HID_API_EXPORT hid_device * HID_API_CALL hid_libusb_wrap_sys_device(intptr_t sys_dev, int interface_num);
 
+		/** @brief Get the input report counters of a device.
+
+			Input reports are queued in a fixed ring per device. When
+			it's full the oldest report is overwritten and counted as
+			dropped, so a reader that can't keep up sees the most
+			recent reports.
+
+			@ingroup API
+			@param dev A device handle returned from hid_open().
+			@param received Set to the number of reports received
+				since the device was opened, may be NULL.
+			@param dropped Set to the number of reports overwritten
+				before they were read, may be NULL.
+
+			@returns
+				This function returns 0 on success.
+		*/
+		int HID_API_EXPORT_CALL hid_libusb_get_input_stats(hid_device *dev, unsigned long *received, unsigned long *dropped);
+
 #ifdef __cplusplus
 }
 #endif
@@ -101,6 +101,8 @@ static int pthread_barrier_wait(pthread_barrier_t *barrier)
 }
 
 static int return_data(hid_device *dev, unsigned char *data, size_t length);
+static void hotplug_cleanup(void);
+static void shared_loop_cleanup(void);
 
 /* Linked List of input reports received from the device. */
 struct input_report {
@@ -119,6 +121,7 @@ static struct hid_api_version api_version = {
 static	IOHIDManagerRef hid_mgr = 0x0;
 static	int is_macos_10_10_or_greater = 0;
 static	IOOptionBits device_open_options = 0;
+static	int device_shared_run_loop = 0;
 static	wchar_t *last_global_error_str = NULL;
 /* --- */
 
@@ -142,6 +145,16 @@ struct hid_device_ {
 	pthread_barrier_t shutdown_barrier; /* Ensures correct shutdown sequence */
 	int shutdown_thread;
 	wchar_t *last_error_str;
+
+	/* Shared run loop mode, the ring is written by the shared thread and
+	   read by hid_read() without a lock. mutex and condition are only used
+	   when the reader has to sleep. */
+	int shared;
+	uint8_t *ring_data; /* HID_API_DARWIN_SHARED_RING_REPORTS * max_input_report_len */
+	CFIndex ring_len[HID_API_DARWIN_SHARED_RING_REPORTS];
+	unsigned ring_head; /* Written by the shared thread only */
+	unsigned ring_tail; /* Written by the reader only */
+	int ring_waiting; /* The reader is, or is about to be, asleep */
 };
 
 static hid_device *new_hid_device(void)
@@ -163,6 +176,11 @@ static hid_device *new_hid_device(void)
 	dev->device_info = NULL;
 	dev->shutdown_thread = 0;
 	dev->last_error_str = NULL;
+	dev->shared = 0;
+	dev->ring_data = NULL;
+	dev->ring_head = 0;
+	dev->ring_tail = 0;
+	dev->ring_waiting = 0;
 
 	/* Thread objects */
 	pthread_mutex_init(&dev->mutex, NULL);
@@ -195,6 +213,7 @@ static void free_hid_device(hid_device *dev)
 	if (dev->source)
 		CFRelease(dev->source);
 	free(dev->input_report_buf);
+	free(dev->ring_data);
 	hid_free_enumeration(dev->device_info);
 
 	/* Clean up the thread objects */
@@ -446,6 +465,9 @@ int HID_API_EXPORT hid_init(void)
 
 int HID_API_EXPORT hid_exit(void)
 {
+	hotplug_cleanup();
+	shared_loop_cleanup();
+
 	if (hid_mgr) {
 		/* Close the HID manager. */
 		IOHIDManagerClose(hid_mgr, kIOHIDOptionsTypeNone);
@@ -725,6 +747,375 @@ void  HID_API_EXPORT hid_free_enumeration(struct hid_device_info *devs)
 	}
 }
 
+/* Hotplug. The hotplug thread runs its own IOHIDManager on its own run
+   loop, the matching and removal callbacks build the device info and call
+   the user callbacks there. */
+struct hotplug_callback {
+	hid_hotplug_callback_handle handle;
+	unsigned short vendor_id;
+	unsigned short product_id;
+	int events; /* 0 once deregistered while callbacks are being called */
+	hid_hotplug_callback_fn callback;
+	void *user_data;
+	struct hotplug_callback *next;
+};
+
+/* A connected device and its usages, so that LEFT can report what left. */
+struct hotplug_device {
+	IOHIDDeviceRef device; /* Retained */
+	struct hid_device_info *info;
+	struct hotplug_device *next;
+};
+
+static struct {
+	pthread_once_t once;
+	pthread_mutex_t mutex; /* Recursive, callbacks may (de)register callbacks */
+	pthread_mutex_t start_mutex; /* Held while the thread starts */
+	struct hotplug_callback *callbacks;
+	hid_hotplug_callback_handle next_handle;
+	int dispatching;
+	struct hotplug_device *devices;
+	IOHIDManagerRef manager;
+	CFRunLoopRef run_loop; /* Retained */
+	CFRunLoopSourceRef source; /* Signaled by hotplug_cleanup() */
+	pthread_barrier_t barrier; /* The snapshot is taken */
+	pthread_t thread;
+	int thread_running;
+	int started; /* Matches after the snapshot are arrivals */
+	int shutdown_thread;
+} hotplug = { .once = PTHREAD_ONCE_INIT };
+
+static void hotplug_init_mutexes(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&hotplug.mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+	pthread_mutex_init(&hotplug.start_mutex, NULL);
+}
+
+static int hotplug_match(const struct hotplug_callback *cb, const struct hid_device_info *info)
+{
+	return (cb->vendor_id == 0x0 || cb->vendor_id == info->vendor_id) &&
+	       (cb->product_id == 0x0 || cb->product_id == info->product_id);
+}
+
+/* Call cb for every entry in info that it matches. Called with
+   hotplug.mutex held and hotplug.dispatching raised. */
+static void hotplug_call(struct hotplug_callback *cb, struct hid_device_info *info, hid_hotplug_event event)
+{
+	struct hid_device_info *cur;
+
+	for (cur = info; cur && (cb->events & event); cur = cur->next) {
+		struct hid_device_info *next = cur->next;
+		if (!hotplug_match(cb, cur))
+			continue;
+
+		/* The callback sees a single entry */
+		cur->next = NULL;
+		if (cb->callback(cb->handle, cur, event, cb->user_data))
+			cb->events = 0;
+		cur->next = next;
+	}
+}
+
+/* Free the callbacks deregistered while callbacks were being called. */
+static void hotplug_purge(void)
+{
+	struct hotplug_callback **pp = &hotplug.callbacks;
+
+	if (hotplug.dispatching)
+		return;
+
+	while (*pp) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->events == 0) {
+			*pp = cb->next;
+			free(cb);
+		}
+		else {
+			pp = &cb->next;
+		}
+	}
+}
+
+static void hotplug_dispatch(struct hid_device_info *info, hid_hotplug_event event)
+{
+	struct hotplug_callback *cb;
+
+	hotplug.dispatching++;
+	for (cb = hotplug.callbacks; cb; cb = cb->next)
+		hotplug_call(cb, info, event);
+	hotplug.dispatching--;
+	hotplug_purge();
+}
+
+static void hotplug_matching_callback(void *context, IOReturn result, void *sender, IOHIDDeviceRef device)
+{
+	struct hotplug_device *hd;
+	struct hid_device_info *info;
+	(void)context;
+	(void)result;
+	(void)sender;
+
+	pthread_mutex_lock(&hotplug.mutex);
+
+	for (hd = hotplug.devices; hd; hd = hd->next) {
+		if (hd->device == device)
+			goto end;
+	}
+
+	info = create_device_info(device);
+	if (!info)
+		goto end;
+
+	hd = (struct hotplug_device*) calloc(1, sizeof(struct hotplug_device));
+	if (!hd) {
+		hid_free_enumeration(info);
+		goto end;
+	}
+	CFRetain(device);
+	hd->device = device;
+	hd->info = info;
+	hd->next = hotplug.devices;
+	hotplug.devices = hd;
+
+	if (hotplug.started)
+		hotplug_dispatch(info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+
+end:
+	pthread_mutex_unlock(&hotplug.mutex);
+}
+
+static void hotplug_removal_callback(void *context, IOReturn result, void *sender, IOHIDDeviceRef device)
+{
+	struct hotplug_device **pp;
+	(void)context;
+	(void)result;
+	(void)sender;
+
+	pthread_mutex_lock(&hotplug.mutex);
+
+	for (pp = &hotplug.devices; *pp; pp = &(*pp)->next) {
+		struct hotplug_device *hd = *pp;
+		if (hd->device == device) {
+			*pp = hd->next;
+			hotplug_dispatch(hd->info, HID_API_HOTPLUG_EVENT_DEVICE_LEFT);
+			hid_free_enumeration(hd->info);
+			CFRelease(hd->device);
+			free(hd);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&hotplug.mutex);
+}
+
+/* Stops the run loop when hotplug_cleanup() signals the source. */
+static void hotplug_perform_signal_callback(void *context)
+{
+	(void)context;
+	CFRunLoopStop(hotplug.run_loop);
+}
+
+static void *hotplug_thread(void *param)
+{
+	CFRunLoopSourceContext ctx;
+	(void)param;
+
+	/* Retained, hotplug_cleanup() wakes it after this thread may have ended */
+	hotplug.run_loop = (CFRunLoopRef) CFRetain(CFRunLoopGetCurrent());
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.version = 0;
+	ctx.perform = &hotplug_perform_signal_callback;
+	hotplug.source = CFRunLoopSourceCreate(kCFAllocatorDefault, 0/*order*/, &ctx);
+	CFRunLoopAddSource(hotplug.run_loop, hotplug.source, kCFRunLoopDefaultMode);
+
+	IOHIDManagerSetDeviceMatching(hotplug.manager, NULL);
+	IOHIDManagerRegisterDeviceMatchingCallback(hotplug.manager, hotplug_matching_callback, NULL);
+	IOHIDManagerRegisterDeviceRemovalCallback(hotplug.manager, hotplug_removal_callback, NULL);
+	IOHIDManagerScheduleWithRunLoop(hotplug.manager, hotplug.run_loop, kCFRunLoopDefaultMode);
+
+	/* The devices already connected match on the first passes, they're
+	   the snapshot. */
+	process_pending_events();
+	pthread_mutex_lock(&hotplug.mutex);
+	hotplug.started = 1;
+	pthread_mutex_unlock(&hotplug.mutex);
+
+	/* Notify hid_hotplug_register_callback() that the snapshot is taken. */
+	pthread_barrier_wait(&hotplug.barrier);
+
+	while (!hotplug.shutdown_thread)
+		CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1000/*sec*/, FALSE);
+
+	IOHIDManagerUnscheduleFromRunLoop(hotplug.manager, hotplug.run_loop, kCFRunLoopDefaultMode);
+	CFRunLoopRemoveSource(hotplug.run_loop, hotplug.source, kCFRunLoopDefaultMode);
+
+	return NULL;
+}
+
+static void hotplug_free(void)
+{
+	while (hotplug.devices) {
+		struct hotplug_device *hd = hotplug.devices;
+		hotplug.devices = hd->next;
+		hid_free_enumeration(hd->info);
+		CFRelease(hd->device);
+		free(hd);
+	}
+	if (hotplug.source) {
+		CFRelease(hotplug.source);
+		hotplug.source = NULL;
+	}
+	if (hotplug.run_loop) {
+		CFRelease(hotplug.run_loop);
+		hotplug.run_loop = NULL;
+	}
+	if (hotplug.manager) {
+		CFRelease(hotplug.manager);
+		hotplug.manager = NULL;
+	}
+}
+
+/* Called with hotplug.start_mutex held, and not hotplug.mutex, which the
+   snapshot's matching callbacks take. */
+static int hotplug_start(void)
+{
+	hotplug.manager = IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDOptionsTypeNone);
+	if (!hotplug.manager) {
+		register_global_error("Failed to create IOHIDManager");
+		return -1;
+	}
+
+	hotplug.started = 0;
+	hotplug.shutdown_thread = 0;
+	pthread_barrier_init(&hotplug.barrier, NULL, 2);
+	if (pthread_create(&hotplug.thread, NULL, hotplug_thread, NULL)) {
+		register_global_error("Couldn't start the hotplug thread");
+		pthread_barrier_destroy(&hotplug.barrier);
+		hotplug_free();
+		return -1;
+	}
+	pthread_barrier_wait(&hotplug.barrier);
+	pthread_barrier_destroy(&hotplug.barrier);
+	hotplug.thread_running = 1;
+
+	return 0;
+}
+
+static void hotplug_cleanup(void)
+{
+	if (!hotplug.thread_running)
+		return;
+
+	hotplug.shutdown_thread = 1;
+	CFRunLoopSourceSignal(hotplug.source);
+	CFRunLoopWakeUp(hotplug.run_loop);
+	pthread_join(hotplug.thread, NULL);
+	hotplug.thread_running = 0;
+
+	pthread_mutex_lock(&hotplug.mutex);
+	while (hotplug.callbacks) {
+		struct hotplug_callback *cb = hotplug.callbacks;
+		hotplug.callbacks = cb->next;
+		free(cb);
+	}
+	hotplug_free();
+	pthread_mutex_unlock(&hotplug.mutex);
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_register_callback(unsigned short vendor_id, unsigned short product_id, int events, int flags, hid_hotplug_callback_fn callback, void *user_data, hid_hotplug_callback_handle *callback_handle)
+{
+	struct hotplug_callback *cb;
+	struct hotplug_device *hd;
+
+	if (hid_init() < 0) {
+		return -1;
+	}
+	/* register_global_error: global error is set/reset by hid_init */
+
+	events &= HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED | HID_API_HOTPLUG_EVENT_DEVICE_LEFT;
+	if (!callback || !events) {
+		register_global_error("Invalid hotplug callback or events");
+		return -1;
+	}
+
+	cb = (struct hotplug_callback*) calloc(1, sizeof(struct hotplug_callback));
+	if (!cb) {
+		register_global_error("Couldn't allocate memory");
+		return -1;
+	}
+	cb->vendor_id = vendor_id;
+	cb->product_id = product_id;
+	cb->events = events;
+	cb->callback = callback;
+	cb->user_data = user_data;
+
+	pthread_once(&hotplug.once, hotplug_init_mutexes);
+
+	pthread_mutex_lock(&hotplug.start_mutex);
+	if (!hotplug.thread_running && hotplug_start() < 0) {
+		pthread_mutex_unlock(&hotplug.start_mutex);
+		free(cb);
+		return -1;
+	}
+	pthread_mutex_unlock(&hotplug.start_mutex);
+
+	pthread_mutex_lock(&hotplug.mutex);
+
+	cb->handle = ++hotplug.next_handle;
+	/* At the head, so a callback registered from a callback isn't called
+	   for the event being dispatched */
+	cb->next = hotplug.callbacks;
+	hotplug.callbacks = cb;
+	if (callback_handle)
+		*callback_handle = cb->handle;
+
+	if (flags & HID_API_HOTPLUG_ENUMERATE) {
+		hotplug.dispatching++;
+		for (hd = hotplug.devices; hd; hd = hd->next)
+			hotplug_call(cb, hd->info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+		hotplug.dispatching--;
+		hotplug_purge();
+	}
+
+	pthread_mutex_unlock(&hotplug.mutex);
+
+	return 0;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_deregister_callback(hid_hotplug_callback_handle callback_handle)
+{
+	struct hotplug_callback **pp;
+	int res = -1;
+
+	pthread_once(&hotplug.once, hotplug_init_mutexes);
+	pthread_mutex_lock(&hotplug.mutex);
+
+	for (pp = &hotplug.callbacks; *pp; pp = &(*pp)->next) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->handle == callback_handle && cb->events) {
+			if (hotplug.dispatching) {
+				cb->events = 0; /* Freed by hotplug_purge() */
+			}
+			else {
+				*pp = cb->next;
+				free(cb);
+			}
+			res = 0;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&hotplug.mutex);
+
+	return res;
+}
+
 hid_device * HID_API_EXPORT hid_open(unsigned short vendor_id, unsigned short product_id, const wchar_t *serial_number)
 {
 	/* This function is identical to the Linux version. Platform independent. */
@@ -910,6 +1301,231 @@ static void *read_thread(void *param)
 	return NULL;
 }
 
+/* Shared run loop mode. One thread runs one run loop that every device
+   opened in this mode is scheduled on. Its source is signalled to stop the
+   loop or to sync: once the perform callback has run, no report or removal
+   callback that started before the signal is still running. */
+static struct {
+	pthread_mutex_t mutex; /* Protects everything below */
+	pthread_cond_t cond;
+	pthread_t thread;
+	int thread_running;
+	int shutdown_thread;
+	CFStringRef mode;
+	CFRunLoopRef run_loop; /* Retained */
+	CFRunLoopSourceRef source;
+	unsigned sync_requested;
+	unsigned sync_done;
+} shared_loop = { .mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+static void shared_loop_perform(void *context)
+{
+	(void) context;
+
+	pthread_mutex_lock(&shared_loop.mutex);
+	shared_loop.sync_done = shared_loop.sync_requested;
+	pthread_cond_broadcast(&shared_loop.cond);
+	if (shared_loop.shutdown_thread)
+		CFRunLoopStop(shared_loop.run_loop);
+	pthread_mutex_unlock(&shared_loop.mutex);
+}
+
+static void *shared_loop_thread(void *param)
+{
+	CFRunLoopSourceContext ctx;
+	(void) param;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.version = 0;
+	ctx.perform = &shared_loop_perform;
+
+	pthread_mutex_lock(&shared_loop.mutex);
+	shared_loop.run_loop = (CFRunLoopRef) CFRetain(CFRunLoopGetCurrent());
+	shared_loop.source = CFRunLoopSourceCreate(kCFAllocatorDefault, 0/*order*/, &ctx);
+	CFRunLoopAddSource(shared_loop.run_loop, shared_loop.source, shared_loop.mode);
+	shared_loop.thread_running = 1;
+	pthread_cond_broadcast(&shared_loop.cond);
+	pthread_mutex_unlock(&shared_loop.mutex);
+
+	/* Report and removal callbacks of every shared device run from here. */
+	while (!shared_loop.shutdown_thread)
+		CFRunLoopRunInMode(shared_loop.mode, 1000/*sec*/, FALSE);
+
+	CFRunLoopRemoveSource(shared_loop.run_loop, shared_loop.source, shared_loop.mode);
+	return NULL;
+}
+
+/* Start the shared thread if it isn't running yet. */
+static int shared_loop_start(void)
+{
+	int res = 0;
+
+	pthread_mutex_lock(&shared_loop.mutex);
+	if (!shared_loop.thread_running) {
+		if (!shared_loop.mode)
+			shared_loop.mode = CFStringCreateWithCString(NULL, "HIDAPI_shared", kCFStringEncodingASCII);
+		shared_loop.shutdown_thread = 0;
+		if (pthread_create(&shared_loop.thread, NULL, shared_loop_thread, NULL)) {
+			register_global_error("hid_open_path: couldn't start the shared run loop thread");
+			res = -1;
+		}
+		else {
+			while (!shared_loop.thread_running)
+				pthread_cond_wait(&shared_loop.cond, &shared_loop.mutex);
+		}
+	}
+	pthread_mutex_unlock(&shared_loop.mutex);
+
+	return res;
+}
+
+/* Wait for the shared thread to get through its pending callbacks. */
+static void shared_loop_sync(void)
+{
+	unsigned target;
+
+	pthread_mutex_lock(&shared_loop.mutex);
+	target = ++shared_loop.sync_requested;
+	CFRunLoopSourceSignal(shared_loop.source);
+	CFRunLoopWakeUp(shared_loop.run_loop);
+	while ((int)(shared_loop.sync_done - target) < 0)
+		pthread_cond_wait(&shared_loop.cond, &shared_loop.mutex);
+	pthread_mutex_unlock(&shared_loop.mutex);
+}
+
+static void shared_loop_cleanup(void)
+{
+	if (!shared_loop.thread_running)
+		return;
+
+	pthread_mutex_lock(&shared_loop.mutex);
+	shared_loop.shutdown_thread = 1;
+	CFRunLoopSourceSignal(shared_loop.source);
+	CFRunLoopWakeUp(shared_loop.run_loop);
+	pthread_mutex_unlock(&shared_loop.mutex);
+	pthread_join(shared_loop.thread, NULL);
+
+	CFRelease(shared_loop.source);
+	shared_loop.source = NULL;
+	CFRelease(shared_loop.run_loop);
+	shared_loop.run_loop = NULL;
+	shared_loop.thread_running = 0;
+}
+
+/* Runs on the shared thread, the only writer of ring_head. */
+static void shared_report_callback(void *context, IOReturn result, void *sender,
+                         IOHIDReportType report_type, uint32_t report_id,
+                         uint8_t *report, CFIndex report_length)
+{
+	(void) result;
+	(void) sender;
+	(void) report_type;
+	(void) report_id;
+
+	hid_device *dev = (hid_device*) context;
+	unsigned head = dev->ring_head;
+	unsigned slot;
+
+	/* Full, drop this one rather than take the reader's slot away. */
+	if (head - __atomic_load_n(&dev->ring_tail, __ATOMIC_ACQUIRE) >= HID_API_DARWIN_SHARED_RING_REPORTS)
+		return;
+
+	slot = head & (HID_API_DARWIN_SHARED_RING_REPORTS - 1);
+	if (report_length > dev->max_input_report_len)
+		report_length = dev->max_input_report_len;
+	memcpy(dev->ring_data + slot * dev->max_input_report_len, report, report_length);
+	dev->ring_len[slot] = report_length;
+
+	/* Publish, then only take the mutex if the reader went to sleep. Both
+	   sides store then load sequentially consistent, so either we see
+	   ring_waiting or the reader sees the new head. */
+	__atomic_store_n(&dev->ring_head, head + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&dev->ring_waiting, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&dev->mutex);
+		pthread_cond_signal(&dev->condition);
+		pthread_mutex_unlock(&dev->mutex);
+	}
+}
+
+static void shared_removal_callback(void *context, IOReturn result, void *sender)
+{
+	(void) result;
+	(void) sender;
+
+	hid_device *dev = (hid_device*) context;
+
+	pthread_mutex_lock(&dev->mutex);
+	dev->disconnected = 1;
+	pthread_cond_broadcast(&dev->condition);
+	pthread_mutex_unlock(&dev->mutex);
+}
+
+/* Take the oldest report, -1 if the ring is empty. */
+static int ring_pop(hid_device *dev, unsigned char *data, size_t length)
+{
+	unsigned tail = dev->ring_tail;
+	unsigned slot;
+	size_t len;
+
+	if (__atomic_load_n(&dev->ring_head, __ATOMIC_SEQ_CST) == tail)
+		return -1;
+
+	slot = tail & (HID_API_DARWIN_SHARED_RING_REPORTS - 1);
+	len = (length < (size_t) dev->ring_len[slot])? length: (size_t) dev->ring_len[slot];
+	memcpy(data, dev->ring_data + slot * dev->max_input_report_len, len);
+	__atomic_store_n(&dev->ring_tail, tail + 1, __ATOMIC_RELEASE);
+
+	return (int) len;
+}
+
+static int shared_read_timeout(hid_device *dev, unsigned char *data, size_t length, int milliseconds)
+{
+	struct timespec ts;
+	int bytes_read;
+	int res = 0;
+
+	bytes_read = ring_pop(dev, data, length);
+	if (bytes_read >= 0)
+		return bytes_read;
+
+	if (milliseconds == 0)
+		return (dev->disconnected)? -1: 0;
+
+	if (milliseconds > 0) {
+		struct timeval tv;
+		gettimeofday(&tv, NULL);
+		TIMEVAL_TO_TIMESPEC(&tv, &ts);
+		ts.tv_sec += milliseconds / 1000;
+		ts.tv_nsec += (milliseconds % 1000) * 1000000;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&dev->mutex);
+	__atomic_store_n(&dev->ring_waiting, 1, __ATOMIC_SEQ_CST);
+	while ((bytes_read = ring_pop(dev, data, length)) < 0 && !dev->disconnected && res == 0) {
+		if (milliseconds > 0)
+			res = pthread_cond_timedwait(&dev->condition, &dev->mutex, &ts);
+		else
+			res = pthread_cond_wait(&dev->condition, &dev->mutex);
+	}
+	__atomic_store_n(&dev->ring_waiting, 0, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&dev->mutex);
+
+	if (bytes_read >= 0)
+		return bytes_read;
+	if (res == ETIMEDOUT)
+		return 0;
+
+	if (dev->disconnected)
+		register_device_error(dev, "hid_read_timeout: device disconnected");
+	else
+		register_device_error(dev, "hid_read_timeout: error waiting for more data");
+	return -1;
+}
+
 /* \p path must be one of:
      - in format 'DevSrvsID:<RegistryEntryID>' (as returned by hid_enumerate);
      - a valid path to an IOHIDDevice in the IOService plane (as returned by IORegistryEntryGetPath,
@@ -983,6 +1599,31 @@ hid_device * HID_API_EXPORT hid_open_path(const char *path)
 	dev->max_input_report_len = (CFIndex) get_max_report_length(dev->device_handle);
 	dev->input_report_buf = (uint8_t*) calloc(dev->max_input_report_len, sizeof(uint8_t));
 
+	if (device_shared_run_loop) {
+		if (shared_loop_start() < 0)
+			goto return_error;
+
+		dev->ring_data = (uint8_t*) calloc(HID_API_DARWIN_SHARED_RING_REPORTS, dev->max_input_report_len);
+		if (!dev->ring_data) {
+			register_global_error("Couldn't allocate memory");
+			goto return_error;
+		}
+
+		dev->shared = 1;
+		dev->run_loop_mode = (CFStringRef) CFRetain(shared_loop.mode);
+		dev->run_loop = shared_loop.run_loop;
+
+		IOHIDDeviceRegisterInputReportCallback(
+			dev->device_handle, dev->input_report_buf, dev->max_input_report_len,
+			&shared_report_callback, dev);
+		IOHIDDeviceRegisterRemovalCallback(dev->device_handle, shared_removal_callback, dev);
+		IOHIDDeviceScheduleWithRunLoop(dev->device_handle, dev->run_loop, dev->run_loop_mode);
+		CFRunLoopWakeUp(dev->run_loop);
+
+		IOObjectRelease(entry);
+		return dev;
+	}
+
 	/* Create the Run Loop Mode for this device.
 	   printing the reference seems to work. */
 	sprintf(str, "HIDAPI_%p", (void*) dev->device_handle);
@@ -1162,6 +1803,9 @@ int HID_API_EXPORT hid_read_timeout(hid_device *dev, unsigned char *data, size_t
 {
 	int bytes_read = -1;
 
+	if (dev->shared)
+		return shared_read_timeout(dev, data, length, milliseconds);
+
 	/* Lock the access to the report list. */
 	pthread_mutex_lock(&dev->mutex);
 
@@ -1242,6 +1886,47 @@ int HID_API_EXPORT hid_read(hid_device *dev, unsigned char *data, size_t length)
 	return hid_read_timeout(dev, data, length, (dev->blocking)? -1: 0);
 }
 
+/* No native asynchronous writes here: reports are sent before
+   hid_write_async() returns, so there's never anything to wait for. */
+int HID_API_EXPORT hid_write_async(hid_device *dev, const unsigned char *data, size_t length)
+{
+	return hid_write(dev, data, length);
+}
+
+int HID_API_EXPORT hid_write_async_wait(hid_device *dev, int milliseconds)
+{
+	(void)dev;
+	(void)milliseconds;
+
+	return 0;
+}
+
+int HID_API_EXPORT hid_read_batch(hid_device *dev, struct hid_report_buffer *bufs, size_t n, int milliseconds)
+{
+	size_t count;
+	int res;
+
+	if (!bufs || n == 0) {
+		register_device_error(dev, "hid_read_batch: no buffers");
+		return -1;
+	}
+
+	/* Wait for the first report, then take any already queued */
+	res = hid_read_timeout(dev, bufs[0].data, bufs[0].length, milliseconds);
+	if (res <= 0)
+		return res;
+	bufs[0].actual_length = res;
+
+	for (count = 1; count < n; count++) {
+		res = hid_read_timeout(dev, bufs[count].data, bufs[count].length, 0);
+		if (res <= 0)
+			break;
+		bufs[count].actual_length = res;
+	}
+
+	return (int)count;
+}
+
 int HID_API_EXPORT hid_set_nonblocking(hid_device *dev, int nonblock)
 {
 	/* All Nonblocking operation is handled by the library. */
@@ -1282,6 +1967,13 @@ void HID_API_EXPORT hid_close(hid_device *dev)
 		IOHIDDeviceScheduleWithRunLoop(dev->device_handle, CFRunLoopGetMain(), kCFRunLoopDefaultMode);
 	}
 
+	if (dev->shared) {
+		/* No thread of our own, just make sure the shared one is done
+		   with our callbacks. */
+		shared_loop_sync();
+		goto close_device;
+	}
+
 	/* Cause read_thread() to stop. */
 	dev->shutdown_thread = 1;
 
@@ -1295,6 +1987,7 @@ void HID_API_EXPORT hid_close(hid_device *dev)
 	/* Wait for read_thread() to end. */
 	pthread_join(dev->thread, NULL);
 
+close_device:
 	/* Close the OS handle to the device, but only if it's not
 	   been unplugged. If it's been unplugged, then calling
 	   IOHIDDeviceClose() will crash.
@@ -1422,6 +2115,16 @@ int HID_API_EXPORT_CALL hid_darwin_get_open_exclusive(void)
 	return (device_open_options == kIOHIDOptionsTypeSeizeDevice) ? 1 : 0;
 }
 
+void HID_API_EXPORT_CALL hid_darwin_set_shared_run_loop(int shared)
+{
+	device_shared_run_loop = (shared != 0);
+}
+
+int HID_API_EXPORT_CALL hid_darwin_get_shared_run_loop(void)
+{
+	return device_shared_run_loop;
+}
+
 int HID_API_EXPORT_CALL hid_darwin_is_device_open_exclusive(hid_device *dev)
 {
 	if (!dev)
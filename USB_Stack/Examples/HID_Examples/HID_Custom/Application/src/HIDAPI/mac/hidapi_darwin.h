@@ -30,6 +30,15 @@
 
 #include "hidapi.h"
 
+/** @brief Input reports a device opened in shared run loop mode can hold
+	before hid_read() takes them, a power of 2.
+
+	@ingroup API
+*/
+#ifndef HID_API_DARWIN_SHARED_RING_REPORTS
+#define HID_API_DARWIN_SHARED_RING_REPORTS 32
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -91,6 +100,34 @@ extern "C" {
 		*/
 		int HID_API_EXPORT_CALL hid_darwin_is_device_open_exclusive(hid_device *dev);
 
+		/** @brief Changes how all further calls to @ref hid_open or @ref hid_open_path
+			receive Input reports.
+
+			By default every opened device gets its own thread running its own
+			run loop. In shared mode one thread runs a single run loop for every
+			device opened in shared mode, and each device's reports go into a
+			lock-free ring of @ref HID_API_DARWIN_SHARED_RING_REPORTS reports
+			which @ref hid_read takes them from. The number of threads then stays
+			the same however many devices are open. When a device's ring is full
+			new reports are dropped until it's read.
+
+			@ingroup API
+			@param shared When set to 0 - all further devices get their own
+				thread (the default). Otherwise - all further devices are
+				serviced by the shared thread.
+
+			@note The shared thread starts with the first device opened in shared
+			mode and runs until @ref hid_exit.
+		*/
+		void HID_API_EXPORT_CALL hid_darwin_set_shared_run_loop(int shared);
+
+		/** @brief Getter for option set by @ref hid_darwin_set_shared_run_loop.
+
+			@ingroup API
+			@return 1 if all further devices will be serviced by the shared thread.
+		*/
+		int HID_API_EXPORT_CALL hid_darwin_get_shared_run_loop(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -102,6 +102,8 @@ static CM_Get_DevNode_PropertyW_ CM_Get_DevNode_PropertyW = NULL;
 static CM_Get_Device_Interface_PropertyW_ CM_Get_Device_Interface_PropertyW = NULL;
 static CM_Get_Device_Interface_List_SizeW_ CM_Get_Device_Interface_List_SizeW = NULL;
 static CM_Get_Device_Interface_ListW_ CM_Get_Device_Interface_ListW = NULL;
+static CM_Register_Notification_ CM_Register_Notification = NULL; /* Optional, Windows 8 and later */
+static CM_Unregister_Notification_ CM_Unregister_Notification = NULL;
 
 static HMODULE hid_lib_handle = NULL;
 static HMODULE cfgmgr32_lib_handle = NULL;
@@ -156,6 +158,14 @@ static int lookup_functions()
 	RESOLVE(cfgmgr32_lib_handle, CM_Get_Device_Interface_List_SizeW);
 	RESOLVE(cfgmgr32_lib_handle, CM_Get_Device_Interface_ListW);
 
+	/* Without these hid_hotplug_register_callback() fails and the caller polls */
+	CM_Register_Notification = (CM_Register_Notification_)GetProcAddress(cfgmgr32_lib_handle, "CM_Register_Notification");
+	CM_Unregister_Notification = (CM_Unregister_Notification_)GetProcAddress(cfgmgr32_lib_handle, "CM_Unregister_Notification");
+	if (!CM_Register_Notification || !CM_Unregister_Notification) {
+		CM_Register_Notification = NULL;
+		CM_Unregister_Notification = NULL;
+	}
+
 #undef RESOLVE
 #if defined(__GNUC__)
 # pragma GCC diagnostic pop
@@ -170,6 +180,16 @@ err:
 
 #endif /* HIDAPI_USE_DDK */
 
+/* One queued ReadFile() */
+struct hid_read_slot {
+	OVERLAPPED ol;
+	hid_device *dev;
+	BOOL in_flight;
+	DWORD bytes_read;
+	DWORD error;
+	char *buf;
+};
+
 struct hid_device_ {
 		HANDLE device_handle;
 		BOOL blocking;
@@ -179,9 +199,11 @@ struct hid_device_ {
 		USHORT feature_report_length;
 		unsigned char *feature_buf;
 		wchar_t *last_error_str;
-		BOOL read_pending;
-		char *read_buf;
-		OVERLAPPED ol;
+		HANDLE read_handle; /* Own handle so only reads complete to the port */
+		HANDLE read_event; /* Set when one of our reads completes */
+		BOOL reads_started;
+		size_t read_next; /* Oldest read, reports are returned in order */
+		struct hid_read_slot read_slots[HID_API_MAX_PENDING_READS];
 		OVERLAPPED write_ol;
 		struct hid_device_info* device_info;
 };
@@ -202,10 +224,10 @@ static hid_device *new_hid_device()
 	dev->feature_report_length = 0;
 	dev->feature_buf = NULL;
 	dev->last_error_str = NULL;
-	dev->read_pending = FALSE;
-	dev->read_buf = NULL;
-	memset(&dev->ol, 0, sizeof(dev->ol));
-	dev->ol.hEvent = CreateEvent(NULL, FALSE, FALSE /*initial state f=nonsignaled*/, NULL);
+	dev->read_handle = INVALID_HANDLE_VALUE;
+	dev->read_event = CreateEvent(NULL, FALSE, FALSE /*initial state f=nonsignaled*/, NULL);
+	dev->reads_started = FALSE;
+	dev->read_next = 0;
 	memset(&dev->write_ol, 0, sizeof(dev->write_ol));
 	dev->write_ol.hEvent = CreateEvent(NULL, FALSE, FALSE /*inital state f=nonsignaled*/, NULL);
 	dev->device_info = NULL;
@@ -215,14 +237,19 @@ static hid_device *new_hid_device()
 
 static void free_hid_device(hid_device *dev)
 {
-	CloseHandle(dev->ol.hEvent);
+	size_t i;
+
+	for (i = 0; i < HID_API_MAX_PENDING_READS; i++)
+		free(dev->read_slots[i].buf);
+	if (dev->read_handle != INVALID_HANDLE_VALUE)
+		CloseHandle(dev->read_handle);
+	CloseHandle(dev->read_event);
 	CloseHandle(dev->write_ol.hEvent);
 	CloseHandle(dev->device_handle);
 	free(dev->last_error_str);
 	dev->last_error_str = NULL;
 	free(dev->write_buf);
 	free(dev->feature_buf);
-	free(dev->read_buf);
 	hid_free_enumeration(dev->device_info);
 	free(dev);
 }
@@ -305,6 +332,8 @@ static void register_string_error(hid_device *dev, const WCHAR *string_error)
 
 static wchar_t *last_global_error_str = NULL;
 
+static void hotplug_cleanup(void);
+
 static void register_global_winapi_error(const WCHAR *op)
 {
 	register_winapi_error_to_buffer(&last_global_error_str, op);
@@ -359,6 +388,7 @@ int HID_API_EXPORT hid_init(void)
 
 int HID_API_EXPORT hid_exit(void)
 {
+	hotplug_cleanup();
 #ifndef HIDAPI_USE_DDK
 	free_library_handles();
 	hidapi_initialized = FALSE;
@@ -765,6 +795,331 @@ void  HID_API_EXPORT HID_API_CALL hid_free_enumeration(struct hid_device_info *d
 	}
 }
 
+/* Hotplug. CM_Register_Notification() on the HID interface class calls
+   hotplug_cm_callback() on a thread pool thread, which builds the device
+   info and calls the user callbacks. */
+struct hotplug_callback {
+	hid_hotplug_callback_handle handle;
+	unsigned short vendor_id;
+	unsigned short product_id;
+	int events; /* 0 once deregistered while callbacks are being called */
+	hid_hotplug_callback_fn callback;
+	void *user_data;
+	struct hotplug_callback *next;
+};
+
+/* A connected interface, so that LEFT can report what left. */
+struct hotplug_device {
+	struct hid_device_info *info; /* info->path is the interface path */
+	struct hotplug_device *next;
+};
+
+static struct {
+	INIT_ONCE once;
+	CRITICAL_SECTION lock; /* Recursive, callbacks may (de)register callbacks */
+	struct hotplug_callback *callbacks;
+	hid_hotplug_callback_handle next_handle;
+	int dispatching;
+	struct hotplug_device *devices;
+	HCMNOTIFICATION notify;
+} hotplug = { .once = INIT_ONCE_STATIC_INIT };
+
+static BOOL CALLBACK hotplug_init_lock(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+	(void)once;
+	(void)param;
+	(void)context;
+	InitializeCriticalSection(&hotplug.lock);
+	return TRUE;
+}
+
+static int hotplug_match(const struct hotplug_callback *cb, const struct hid_device_info *info)
+{
+	return (cb->vendor_id == 0x0 || cb->vendor_id == info->vendor_id) &&
+	       (cb->product_id == 0x0 || cb->product_id == info->product_id);
+}
+
+/* Called with hotplug.lock held and hotplug.dispatching raised. */
+static void hotplug_call(struct hotplug_callback *cb, struct hid_device_info *info, hid_hotplug_event event)
+{
+	if ((cb->events & event) && hotplug_match(cb, info)) {
+		if (cb->callback(cb->handle, info, event, cb->user_data))
+			cb->events = 0;
+	}
+}
+
+/* Free the callbacks deregistered while callbacks were being called. */
+static void hotplug_purge(void)
+{
+	struct hotplug_callback **pp = &hotplug.callbacks;
+
+	if (hotplug.dispatching)
+		return;
+
+	while (*pp) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->events == 0) {
+			*pp = cb->next;
+			free(cb);
+		}
+		else {
+			pp = &cb->next;
+		}
+	}
+}
+
+static void hotplug_dispatch(struct hid_device_info *info, hid_hotplug_event event)
+{
+	struct hotplug_callback *cb;
+
+	hotplug.dispatching++;
+	for (cb = hotplug.callbacks; cb; cb = cb->next)
+		hotplug_call(cb, info, event);
+	hotplug.dispatching--;
+	hotplug_purge();
+}
+
+static struct hotplug_device *hotplug_find(const char *path, struct hotplug_device ***link)
+{
+	struct hotplug_device **pp;
+
+	for (pp = &hotplug.devices; *pp; pp = &(*pp)->next) {
+		/* The notification and the interface list don't agree on case */
+		if ((*pp)->info->path && _stricmp((*pp)->info->path, path) == 0) {
+			if (link)
+				*link = pp;
+			return *pp;
+		}
+	}
+	return NULL;
+}
+
+/* Takes ownership of info, a single entry. */
+static void hotplug_add(struct hid_device_info *info, int notify)
+{
+	struct hotplug_device *hd;
+
+	if (!info->path || hotplug_find(info->path, NULL)) {
+		/* Arrived between registering and the snapshot */
+		hid_free_enumeration(info);
+		return;
+	}
+
+	hd = (struct hotplug_device*)calloc(1, sizeof(struct hotplug_device));
+	if (!hd) {
+		hid_free_enumeration(info);
+		return;
+	}
+	hd->info = info;
+	hd->next = hotplug.devices;
+	hotplug.devices = hd;
+
+	if (notify)
+		hotplug_dispatch(info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+}
+
+static void hotplug_remove(const char *path)
+{
+	struct hotplug_device **link;
+	struct hotplug_device *hd = hotplug_find(path, &link);
+
+	if (!hd)
+		return;
+	*link = hd->next;
+
+	hotplug_dispatch(hd->info, HID_API_HOTPLUG_EVENT_DEVICE_LEFT);
+	hid_free_enumeration(hd->info);
+	free(hd);
+}
+
+static DWORD CALLBACK hotplug_cm_callback(HCMNOTIFICATION notify, PVOID context, CM_NOTIFY_ACTION action, PCM_NOTIFY_EVENT_DATA event_data, DWORD event_data_size)
+{
+	const wchar_t *interface_path = event_data->u.DeviceInterface.SymbolicLink;
+	(void)notify;
+	(void)context;
+	(void)event_data_size;
+
+	if (event_data->FilterType != CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE)
+		return ERROR_SUCCESS;
+
+	if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL) {
+		/* Read the attributes and strings before taking the lock */
+		struct hid_device_info *info;
+		HANDLE device_handle = open_device(interface_path, FALSE);
+		if (device_handle == INVALID_HANDLE_VALUE)
+			return ERROR_SUCCESS;
+		info = hid_internal_get_device_info(interface_path, device_handle);
+		CloseHandle(device_handle);
+		if (!info)
+			return ERROR_SUCCESS;
+
+		EnterCriticalSection(&hotplug.lock);
+		hotplug_add(info, 1);
+		LeaveCriticalSection(&hotplug.lock);
+	}
+	else if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEREMOVAL) {
+		char *path = hid_internal_UTF16toUTF8(interface_path);
+		if (!path)
+			return ERROR_SUCCESS;
+
+		EnterCriticalSection(&hotplug.lock);
+		hotplug_remove(path);
+		LeaveCriticalSection(&hotplug.lock);
+		free(path);
+	}
+
+	return ERROR_SUCCESS;
+}
+
+static void hotplug_free(void)
+{
+	while (hotplug.devices) {
+		struct hotplug_device *hd = hotplug.devices;
+		hotplug.devices = hd->next;
+		hid_free_enumeration(hd->info);
+		free(hd);
+	}
+}
+
+/* Called with hotplug.lock held. */
+static int hotplug_start(void)
+{
+	CM_NOTIFY_FILTER filter;
+	struct hid_device_info *devs;
+
+	if (!CM_Register_Notification) {
+		register_global_error(L"Device notifications need Windows 8 or later");
+		return -1;
+	}
+
+	/* Register before the snapshot so no arrival is missed, hotplug_add()
+	   drops the doubles. */
+	memset(&filter, 0, sizeof(filter));
+	filter.cbSize = sizeof(filter);
+	filter.FilterType = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+	HidD_GetHidGuid(&filter.u.DeviceInterface.ClassGuid);
+	if (CM_Register_Notification(&filter, NULL, hotplug_cm_callback, &hotplug.notify) != CR_SUCCESS) {
+		register_global_error(L"Failed to register for HID device notifications");
+		hotplug.notify = NULL;
+		return -1;
+	}
+
+	devs = hid_enumerate(0x0, 0x0);
+	while (devs) {
+		struct hid_device_info *next = devs->next;
+		devs->next = NULL;
+		hotplug_add(devs, 0);
+		devs = next;
+	}
+	register_global_error(NULL);
+
+	return 0;
+}
+
+static void hotplug_cleanup(void)
+{
+	if (!hotplug.notify)
+		return;
+
+	/* Not under the lock, this waits for a running hotplug_cm_callback() */
+	CM_Unregister_Notification(hotplug.notify);
+	hotplug.notify = NULL;
+
+	EnterCriticalSection(&hotplug.lock);
+	while (hotplug.callbacks) {
+		struct hotplug_callback *cb = hotplug.callbacks;
+		hotplug.callbacks = cb->next;
+		free(cb);
+	}
+	hotplug_free();
+	LeaveCriticalSection(&hotplug.lock);
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_register_callback(unsigned short vendor_id, unsigned short product_id, int events, int flags, hid_hotplug_callback_fn callback, void *user_data, hid_hotplug_callback_handle *callback_handle)
+{
+	struct hotplug_callback *cb;
+	struct hotplug_device *hd;
+
+	if (hid_init() < 0) {
+		/* register_global_error: global error is reset by hid_init */
+		return -1;
+	}
+
+	events &= HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED | HID_API_HOTPLUG_EVENT_DEVICE_LEFT;
+	if (!callback || !events) {
+		register_global_error(L"Invalid hotplug callback or events");
+		return -1;
+	}
+
+	cb = (struct hotplug_callback*)calloc(1, sizeof(struct hotplug_callback));
+	if (!cb) {
+		register_global_error(L"Failed to allocate memory");
+		return -1;
+	}
+	cb->vendor_id = vendor_id;
+	cb->product_id = product_id;
+	cb->events = events;
+	cb->callback = callback;
+	cb->user_data = user_data;
+
+	InitOnceExecuteOnce(&hotplug.once, hotplug_init_lock, NULL, NULL);
+	EnterCriticalSection(&hotplug.lock);
+
+	if (!hotplug.notify && hotplug_start() < 0) {
+		LeaveCriticalSection(&hotplug.lock);
+		free(cb);
+		return -1;
+	}
+
+	cb->handle = ++hotplug.next_handle;
+	/* At the head, so a callback registered from a callback isn't called
+	   for the event being dispatched */
+	cb->next = hotplug.callbacks;
+	hotplug.callbacks = cb;
+	if (callback_handle)
+		*callback_handle = cb->handle;
+
+	if (flags & HID_API_HOTPLUG_ENUMERATE) {
+		hotplug.dispatching++;
+		for (hd = hotplug.devices; hd; hd = hd->next)
+			hotplug_call(cb, hd->info, HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED);
+		hotplug.dispatching--;
+		hotplug_purge();
+	}
+
+	LeaveCriticalSection(&hotplug.lock);
+
+	return 0;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hotplug_deregister_callback(hid_hotplug_callback_handle callback_handle)
+{
+	struct hotplug_callback **pp;
+	int res = -1;
+
+	InitOnceExecuteOnce(&hotplug.once, hotplug_init_lock, NULL, NULL);
+	EnterCriticalSection(&hotplug.lock);
+
+	for (pp = &hotplug.callbacks; *pp; pp = &(*pp)->next) {
+		struct hotplug_callback *cb = *pp;
+		if (cb->handle == callback_handle && cb->events) {
+			if (hotplug.dispatching) {
+				cb->events = 0; /* Freed by hotplug_purge() */
+			}
+			else {
+				*pp = cb->next;
+				free(cb);
+			}
+			res = 0;
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&hotplug.lock);
+
+	return res;
+}
+
 HID_API_EXPORT hid_device * HID_API_CALL hid_open(unsigned short vendor_id, unsigned short product_id, const wchar_t *serial_number)
 {
 	/* TODO: Merge this functions with the Linux version. This function should be platform independent. */
@@ -809,6 +1164,194 @@ HID_API_EXPORT hid_device * HID_API_CALL hid_open(unsigned short vendor_id, unsi
 	return handle;
 }
 
+/* Input reads of every open device complete through one I/O completion
+   port, so one thread can keep dozens of devices' reads going. Whichever
+   thread is waiting takes completions off the port (holding pump, one
+   thread at a time) and hands each one to the slot it belongs to, setting
+   that device's read_event in case its reader is waiting on it. The port
+   lives until the process exits. */
+static struct {
+	INIT_ONCE once;
+	HANDLE port;
+	HANDLE pump; /* Mutex, so waiters can wait on it and read_event together */
+	CRITICAL_SECTION lock; /* in_flight, bytes_read and error of every slot */
+} read_port = { .once = INIT_ONCE_STATIC_INIT };
+
+static BOOL CALLBACK read_port_init(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+	(void)once;
+	(void)param;
+	(void)context;
+	read_port.port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+	if (!read_port.port)
+		return FALSE;
+	read_port.pump = CreateMutex(NULL, FALSE, NULL);
+	if (!read_port.pump) {
+		CloseHandle(read_port.port);
+		read_port.port = NULL;
+		return FALSE;
+	}
+	InitializeCriticalSection(&read_port.lock);
+	return TRUE;
+}
+
+/* Give the device its own read handle on the port. A device that can't
+   be opened for reading (keyboards, mice) still opens, hid_read() fails. */
+static BOOL read_port_open(hid_device *dev, const wchar_t *interface_path)
+{
+	size_t i;
+
+	if (!InitOnceExecuteOnce(&read_port.once, read_port_init, NULL, NULL)) {
+		register_global_winapi_error(L"CreateIoCompletionPort");
+		return FALSE;
+	}
+
+	for (i = 0; i < HID_API_MAX_PENDING_READS; i++) {
+		dev->read_slots[i].dev = dev;
+		dev->read_slots[i].buf = (char*) malloc(dev->input_report_length);
+		if (!dev->read_slots[i].buf) {
+			register_global_error(L"hid_device allocation error");
+			return FALSE;
+		}
+	}
+
+	dev->read_handle = open_device(interface_path, TRUE);
+	if (dev->read_handle == INVALID_HANDLE_VALUE)
+		return TRUE;
+
+	/* The driver's buffer is per handle, this is the one reports are read from. */
+	if (!HidD_SetNumInputBuffers(dev->read_handle, 64)) {
+		register_global_winapi_error(L"set input buffers");
+		return FALSE;
+	}
+
+	if (!CreateIoCompletionPort(dev->read_handle, read_port.port, 0, 0)) {
+		register_global_winapi_error(L"CreateIoCompletionPort");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void read_submit(struct hid_read_slot *slot)
+{
+	hid_device *dev = slot->dev;
+
+	EnterCriticalSection(&read_port.lock);
+	memset(&slot->ol, 0, sizeof(slot->ol));
+	slot->in_flight = TRUE;
+	slot->bytes_read = 0;
+	slot->error = 0;
+	LeaveCriticalSection(&read_port.lock);
+
+	if (!ReadFile(dev->read_handle, slot->buf, (DWORD) dev->input_report_length, NULL, &slot->ol) &&
+	    GetLastError() != ERROR_IO_PENDING) {
+		/* Nothing goes to the port, hid_read() reports the error when it gets here. */
+		DWORD error = GetLastError();
+
+		EnterCriticalSection(&read_port.lock);
+		slot->error = error;
+		slot->in_flight = FALSE;
+		LeaveCriticalSection(&read_port.lock);
+	}
+}
+
+/* Called with read_port.lock held. */
+static BOOL read_ready(hid_device *dev)
+{
+	return !dev->read_slots[dev->read_next].in_flight;
+}
+
+/* Called with read_port.lock held. */
+static BOOL read_idle(hid_device *dev)
+{
+	size_t i;
+
+	for (i = 0; i < HID_API_MAX_PENDING_READS; i++) {
+		if (dev->read_slots[i].in_flight)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL read_check(hid_device *dev, BOOL (*done)(hid_device *))
+{
+	BOOL res;
+
+	EnterCriticalSection(&read_port.lock);
+	res = done(dev);
+	LeaveCriticalSection(&read_port.lock);
+	return res;
+}
+
+/* Hand one completion to its slot, FALSE when the port stayed empty. */
+static BOOL read_port_take(DWORD milliseconds)
+{
+	DWORD bytes = 0;
+	ULONG_PTR key;
+	OVERLAPPED *ol = NULL;
+	BOOL res;
+	struct hid_read_slot *slot;
+
+	res = GetQueuedCompletionStatus(read_port.port, &bytes, &key, &ol, milliseconds);
+	if (!ol)
+		return FALSE;
+
+	slot = CONTAINING_RECORD(ol, struct hid_read_slot, ol);
+
+	/* SetEvent() under the lock, hid_close() can free the device as soon
+	   as it sees the slot isn't in flight. */
+	EnterCriticalSection(&read_port.lock);
+	slot->bytes_read = bytes;
+	slot->error = res? 0: GetLastError();
+	slot->in_flight = FALSE;
+	SetEvent(slot->dev->read_event);
+	LeaveCriticalSection(&read_port.lock);
+
+	return TRUE;
+}
+
+/* Wait until done(dev), taking completions off the port while no other
+   thread is. FALSE if the time runs out first. */
+static BOOL read_wait(hid_device *dev, BOOL (*done)(hid_device *), DWORD milliseconds)
+{
+	HANDLE handles[2] = { dev->read_event, read_port.pump };
+	DWORD start = GetTickCount();
+	DWORD remaining = milliseconds;
+	BOOL timed_out = FALSE;
+
+	for (;;) {
+		DWORD res;
+
+		if (read_check(dev, done))
+			return TRUE;
+		if (timed_out)
+			return FALSE;
+
+		res = WaitForMultipleObjects(2, handles, FALSE, remaining);
+		if (res == WAIT_OBJECT_0 + 1 || res == WAIT_ABANDONED_0 + 1) {
+			/* Our turn on the port, until our own read is in or time's up. */
+			while (!read_check(dev, done) && read_port_take(remaining)) {
+				if (milliseconds != INFINITE) {
+					DWORD elapsed = GetTickCount() - start;
+					remaining = (elapsed < milliseconds)? milliseconds - elapsed: 0;
+				}
+			}
+			ReleaseMutex(read_port.pump);
+		}
+		else if (res != WAIT_OBJECT_0) {
+			timed_out = TRUE;
+		}
+
+		if (milliseconds != INFINITE) {
+			DWORD elapsed = GetTickCount() - start;
+			if (elapsed >= milliseconds)
+				timed_out = TRUE;
+			remaining = timed_out? 0: milliseconds - elapsed;
+		}
+	}
+}
+
 HID_API_EXPORT hid_device * HID_API_CALL hid_open_path(const char *path)
 {
 	hid_device *dev = NULL;
@@ -877,9 +1420,14 @@ HID_API_EXPORT hid_device * HID_API_CALL hid_open_path(const char *path)
 	dev->output_report_length = caps.OutputReportByteLength;
 	dev->input_report_length = caps.InputReportByteLength;
 	dev->feature_report_length = caps.FeatureReportByteLength;
-	dev->read_buf = (char*) malloc(dev->input_report_length);
 	dev->device_info = hid_internal_get_device_info(interface_path, dev->device_handle);
 
+	if (!read_port_open(dev, interface_path)) {
+		free_hid_device(dev);
+		dev = NULL;
+		goto end_of_function;
+	}
+
 end_of_function:
 	free(interface_path);
 	CloseHandle(device_handle);
@@ -965,10 +1513,10 @@ end_of_function:
 
 int HID_API_EXPORT HID_API_CALL hid_read_timeout(hid_device *dev, unsigned char *data, size_t length, int milliseconds)
 {
-	DWORD bytes_read = 0;
+	struct hid_read_slot *slot;
 	size_t copy_len = 0;
-	BOOL res = FALSE;
-	BOOL overlapped = FALSE;
+	DWORD bytes_read;
+	DWORD error;
 
 	if (!data || !length) {
 		register_string_error(dev, L"Zero buffer/length");
@@ -977,73 +1525,54 @@ int HID_API_EXPORT HID_API_CALL hid_read_timeout(hid_device *dev, unsigned char
 
 	register_string_error(dev, NULL);
 
-	/* Copy the handle for convenience. */
-	HANDLE ev = dev->ol.hEvent;
-
-	if (!dev->read_pending) {
-		/* Start an Overlapped I/O read. */
-		dev->read_pending = TRUE;
-		memset(dev->read_buf, 0, dev->input_report_length);
-		ResetEvent(ev);
-		res = ReadFile(dev->device_handle, dev->read_buf, (DWORD) dev->input_report_length, &bytes_read, &dev->ol);
-
-		if (!res) {
-			if (GetLastError() != ERROR_IO_PENDING) {
-				/* ReadFile() has failed.
-				   Clean up and return error. */
-				register_winapi_error(dev, L"ReadFile");
-				CancelIo(dev->device_handle);
-				dev->read_pending = FALSE;
-				goto end_of_function;
-			}
-			overlapped = TRUE;
-		}
-	}
-	else {
-		overlapped = TRUE;
+	if (dev->read_handle == INVALID_HANDLE_VALUE) {
+		register_string_error(dev, L"Device not opened for reading");
+		return -1;
 	}
 
-	if (overlapped) {
-		if (milliseconds >= 0) {
-			/* See if there is any data yet. */
-			res = WaitForSingleObject(ev, milliseconds);
-			if (res != WAIT_OBJECT_0) {
-				/* There was no data this time. Return zero bytes available,
-				   but leave the Overlapped I/O running. */
-				return 0;
-			}
-		}
+	if (!dev->reads_started) {
+		/* Queue every read now, from here on each one taken is queued again. */
+		size_t i;
 
-		/* Either WaitForSingleObject() told us that ReadFile has completed, or
-		   we are in non-blocking mode. Get the number of bytes read. The actual
-		   data has been copied to the data[] array which was passed to ReadFile(). */
-		res = GetOverlappedResult(dev->device_handle, &dev->ol, &bytes_read, TRUE/*wait*/);
+		dev->reads_started = TRUE;
+		for (i = 0; i < HID_API_MAX_PENDING_READS; i++)
+			read_submit(&dev->read_slots[i]);
 	}
-	/* Set pending back to false, even if GetOverlappedResult() returned error. */
-	dev->read_pending = FALSE;
 
-	if (res && bytes_read > 0) {
-		if (dev->read_buf[0] == 0x0) {
+	slot = &dev->read_slots[dev->read_next];
+	if (!read_wait(dev, read_ready, (milliseconds >= 0)? (DWORD) milliseconds: INFINITE)) {
+		/* There was no data this time. Return zero bytes available,
+		   but leave the reads queued. */
+		return 0;
+	}
+
+	/* A completed slot isn't touched by anyone else until it's queued again. */
+	bytes_read = slot->bytes_read;
+	error = slot->error;
+
+	if (!error && bytes_read > 0) {
+		if (slot->buf[0] == 0x0) {
 			/* If report numbers aren't being used, but Windows sticks a report
 			   number (0x0) on the beginning of the report anyway. To make this
 			   work like the other platforms, and to make it work more like the
 			   HID spec, we'll skip over this byte. */
 			bytes_read--;
 			copy_len = length > bytes_read ? bytes_read : length;
-			memcpy(data, dev->read_buf+1, copy_len);
+			memcpy(data, slot->buf+1, copy_len);
 		}
 		else {
 			/* Copy the whole buffer, report number and all. */
 			copy_len = length > bytes_read ? bytes_read : length;
-			memcpy(data, dev->read_buf, copy_len);
+			memcpy(data, slot->buf, copy_len);
 		}
 	}
-	if (!res) {
-		register_winapi_error(dev, L"hid_read_timeout/GetOverlappedResult");
-	}
 
-end_of_function:
-	if (!res) {
+	dev->read_next = (dev->read_next + 1) % HID_API_MAX_PENDING_READS;
+	read_submit(slot);
+
+	if (error) {
+		SetLastError(error);
+		register_winapi_error(dev, L"hid_read_timeout/ReadFile");
 		return -1;
 	}
 
@@ -1055,6 +1584,47 @@ int HID_API_EXPORT HID_API_CALL hid_read(hid_device *dev, unsigned char *data, s
 	return hid_read_timeout(dev, data, length, (dev->blocking)? -1: 0);
 }
 
+/* No native asynchronous writes here: reports are sent before
+   hid_write_async() returns, so there's never anything to wait for. */
+int HID_API_EXPORT HID_API_CALL hid_write_async(hid_device *dev, const unsigned char *data, size_t length)
+{
+	return hid_write(dev, data, length);
+}
+
+int HID_API_EXPORT HID_API_CALL hid_write_async_wait(hid_device *dev, int milliseconds)
+{
+	(void)dev;
+	(void)milliseconds;
+
+	return 0;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_read_batch(hid_device *dev, struct hid_report_buffer *bufs, size_t n, int milliseconds)
+{
+	size_t count;
+	int res;
+
+	if (!bufs || n == 0) {
+		register_string_error(dev, L"hid_read_batch: no buffers");
+		return -1;
+	}
+
+	/* Wait for the first report, then take any already queued */
+	res = hid_read_timeout(dev, bufs[0].data, bufs[0].length, milliseconds);
+	if (res <= 0)
+		return res;
+	bufs[0].actual_length = res;
+
+	for (count = 1; count < n; count++) {
+		res = hid_read_timeout(dev, bufs[count].data, bufs[count].length, 0);
+		if (res <= 0)
+			break;
+		bufs[count].actual_length = res;
+	}
+
+	return (int)count;
+}
+
 int HID_API_EXPORT HID_API_CALL hid_set_nonblocking(hid_device *dev, int nonblock)
 {
 	dev->blocking = !nonblock;
@@ -1167,6 +1737,12 @@ void HID_API_EXPORT HID_API_CALL hid_close(hid_device *dev)
 		return;
 
 	CancelIo(dev->device_handle);
+	if (dev->read_handle != INVALID_HANDLE_VALUE) {
+		/* Cancelled reads still complete to the port, wait for all of them
+		   before the slots go away. */
+		CancelIoEx(dev->read_handle, NULL);
+		read_wait(dev, read_idle, INFINITE);
+	}
 	free_hid_device(dev);
 }
 
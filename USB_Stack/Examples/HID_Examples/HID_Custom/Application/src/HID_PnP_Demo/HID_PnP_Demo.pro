@@ -7,14 +7,18 @@ QT       += core gui \
 
 TARGET = HID_PnP_Demo
 TEMPLATE = app
+CONFIG += c++11
 
 
 SOURCES += main.cpp \
         demoapp.cpp \
-        hid_pnp.cpp
+        hid_pnp.cpp \
+        hid_reader.cpp
 
 HEADERS  += demoapp.h \
-         hid_pnp.h
+         hid_pnp.h \
+         hid_reader.h \
+         spsc_queue.h
 
 FORMS    += demoapp.ui
 
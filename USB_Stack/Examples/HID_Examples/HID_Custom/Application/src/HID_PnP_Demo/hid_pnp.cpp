@@ -1,7 +1,5 @@
 #include "hid_pnp.h"
 
-#define REPORT_0                   0x00
-#define COMMAND_TOGGLE_LED         0x80
 #define COMMAND_GET_BUTTON_STATUS  0x81
 #define COMMAND_READ_POTENTIOMETER 0x37
 
@@ -10,113 +8,151 @@ HID_PnP::HID_PnP(QObject *parent) : QObject(parent)
     isConnected = false;
     pushbuttonStatus = false;
     potentiometerValue = 0;
-    toggleLeds = 0;
 
     device = NULL;
+    reader = NULL;
 
-    // Setup first out report
-    buf[0] = REPORT_0;
-    buf[1] = COMMAND_READ_POTENTIOMETER;
-    memset((void*)&buf[2], 0x00, sizeof(buf) - 2);
-    
-    // Initialise timer for polling
     timer = new QTimer();
     connect(timer, SIGNAL(timeout()), this, SLOT(PollUSB()));
 
-    // Start timer at 250ms intervals
-    timer->start(250);
+    // Let HIDAPI say when the device comes and goes, ENUMERATE reports it if it's already plugged in
+    hotplugActive = (hid_hotplug_register_callback(0x04d8, 0x003f,
+                         HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED | HID_API_HOTPLUG_EVENT_DEVICE_LEFT,
+                         HID_API_HOTPLUG_ENUMERATE, hotplug_callback, this, &hotplugHandle) == 0);
+
+    // No notifications on this system, look for the device at 250ms intervals instead
+    if(!hotplugActive)
+        timer->start(250);
 }
 
 HID_PnP::~HID_PnP()
 {
+    // Once this returns the callback isn't running and won't be called again
+    if(hotplugActive)
+        hid_hotplug_deregister_callback(hotplugHandle);
     disconnect(timer, SIGNAL(timeout()), this, SLOT(PollUSB()));
+    if(isConnected)
+        CloseDevice();
+    delete timer;
 }
 
 void HID_PnP::PollUSB()
 {
-    // Setup for out report
-    buf[0] = REPORT_0;
-    memset((void*)&buf[2], 0x00, sizeof(buf) - 2);
+    if(isConnected)
+        return;
 
-    // Check if connected
-    if(isConnected == false)
+    // Not connected, attempt to connect
+    device = hid_open(0x04d8, 0x003f, NULL);
+
+    if(device)
     {
-        // If not connected, attempt to connect
-        device = hid_open(0x04d8, 0x003f, NULL);
-
-        if(device)
-        {
-            // Device detected, poll at 15ms interval
-            isConnected = true;
-            hid_set_nonblocking(device, true);
-            timer->start(15);
-        }
+        timer->stop();
+        devicePath.clear();
+        StartReader();
     }
+}
+
+// Called on HIDAPI's hotplug thread, hand the event to the GUI thread
+int HID_API_CALL HID_PnP::hotplug_callback(hid_hotplug_callback_handle handle, struct hid_device_info *info,
+                                           hid_hotplug_event event, void *user_data)
+{
+    HID_PnP *pnp = static_cast<HID_PnP*>(user_data);
+    QString path = QString::fromUtf8(info->path);
+
+    (void)handle;
+    if(event == HID_API_HOTPLUG_EVENT_DEVICE_ARRIVED)
+        QMetaObject::invokeMethod(pnp, "DeviceArrived", Qt::QueuedConnection, Q_ARG(QString, path));
     else
+        QMetaObject::invokeMethod(pnp, "DeviceLeft", Qt::QueuedConnection, Q_ARG(QString, path));
+
+    return 0; // Stay registered
+}
+
+void HID_PnP::DeviceArrived(QString path)
+{
+    if(isConnected)
+        return;
+
+    device = hid_open_path(path.toUtf8().constData());
+
+    if(device)
     {
-        // Device is connected
-        if(toggleLeds == true)
-        {
-            // Send COMMAND_TOGGLE_LED in out report
-            toggleLeds = false;
-
-            buf[1] = COMMAND_TOGGLE_LED;
-
-            if(hid_write(device, buf, sizeof(buf)) == -1)
-            {
-                CloseDevice();
-                return;
-            }
-
-            // Next out report has COMMAND_READ_POTENTIOMETER
-            buf[0] = REPORT_0;
-            buf[1] = COMMAND_READ_POTENTIOMETER;
-            memset((void*)&buf[2], 0x00, sizeof(buf) - 2);
-        }
-
-        // Send next out report (either COMMAND_READ_POTENTIOMETER or COMMAND_GET_BUTTON_STATUS)
-        if(hid_write(device, buf, sizeof(buf)) == -1)
-        {
-            CloseDevice();
-            return;
-        }
-
-        // Read in report (response)
-        if(hid_read(device, buf, sizeof(buf)) == -1)
-        {
-            CloseDevice();
-            return;
-        }
-
-        // Process response and prepare other command
-        if(buf[0] == COMMAND_READ_POTENTIOMETER)
-        {
-            potentiometerValue = (buf[2]<<8) + buf[1];
-            buf[1] = COMMAND_GET_BUTTON_STATUS;
-        }
-        else if(buf[0] == COMMAND_GET_BUTTON_STATUS)
-        {
-            pushbuttonStatus = (buf[1] == 0x00);
-            buf[1] = COMMAND_READ_POTENTIOMETER;
-        }
+        devicePath = path;
+        StartReader();
     }
+}
+
+void HID_PnP::DeviceLeft(QString path)
+{
+    // The reader's device_error() may have closed it already
+    if(isConnected && path == devicePath)
+        CloseDevice();
+}
+
+void HID_PnP::StartReader()
+{
+    // Device opened, the reader thread does all the reads and writes from now on
+    isConnected = true;
 
+    reader = new HID_Reader(device);
+    connect(reader, SIGNAL(reports_available()), this, SLOT(ProcessReports()), Qt::QueuedConnection);
+    connect(reader, SIGNAL(device_error()), this, SLOT(CloseDevice()), Qt::QueuedConnection);
+    reader->start();
+
+    emit hid_comm_update(isConnected, pushbuttonStatus, potentiometerValue);
+}
+
+void HID_PnP::ProcessReports()
+{
+    HID_Report report;
+
+    if(reader == NULL)
+        return;
+
+    // Clear the flag first, a reply pushed while draining then signals again
+    reader->reports_drained();
+    while(reader->pop_report(report))
+    {
+        if(report.data[0] == COMMAND_READ_POTENTIOMETER)
+            potentiometerValue = (report.data[2]<<8) + report.data[1];
+        else if(report.data[0] == COMMAND_GET_BUTTON_STATUS)
+            pushbuttonStatus = (report.data[1] == 0x00);
+    }
+
+    // One GUI update per batch of replies
     emit hid_comm_update(isConnected, pushbuttonStatus, potentiometerValue);
 }
 
 void HID_PnP::toggle_leds()
 {
-    toggleLeds = true;
+    if(reader)
+        reader->toggle_leds();
 }
 
 void HID_PnP::CloseDevice()
 {
-    hid_close(device);
-    device = NULL;
+    // A queued device_error() can arrive after the device was already closed
+    if(isConnected == false)
+        return;
+
+    if(reader)
+    {
+        reader->stop();
+        reader->wait();
+        delete reader;
+        reader = NULL;
+    }
+    if(device)
+    {
+        hid_close(device);
+        device = NULL;
+    }
     isConnected = false;
     pushbuttonStatus = false;
     potentiometerValue = 0;
-    toggleLeds = 0;
     emit hid_comm_update(isConnected, pushbuttonStatus, potentiometerValue);
-    timer->start(250);
+
+    // With hotplug the next DeviceArrived() reconnects
+    if(!hotplugActive)
+        timer->start(250);
 }
@@ -2,15 +2,15 @@
 #define HID_PNP_H
 
 #include <QObject>
+#include <QString>
 #include <QTimer>
 #include "../HIDAPI/hidapi.h"
+#include "hid_reader.h"
 
 #include <wchar.h>
 #include <string.h>
 #include <stdlib.h>
 
-#define MAX_STR 65
-
 class HID_PnP : public QObject
 {
     Q_OBJECT
@@ -24,18 +24,26 @@ signals:
 public slots:
     void toggle_leds();
     void PollUSB();
+    void DeviceArrived(QString path);
+    void DeviceLeft(QString path);
+    void ProcessReports();
+    void CloseDevice();
 
 private:
+    static int HID_API_CALL hotplug_callback(hid_hotplug_callback_handle handle, struct hid_device_info *info,
+                                             hid_hotplug_event event, void *user_data);
+    void StartReader();
+
     bool isConnected;
     bool pushbuttonStatus;
-    bool toggleLeds;
     int potentiometerValue;
 
     hid_device *device;
-    QTimer *timer;
-    unsigned char buf[MAX_STR];
-
-    void CloseDevice();
+    QString devicePath;
+    HID_Reader *reader;
+    QTimer *timer;   // Only used when the system has no hotplug notifications
+    bool hotplugActive;
+    hid_hotplug_callback_handle hotplugHandle;
 };
 
 #endif // HID_PNP_H
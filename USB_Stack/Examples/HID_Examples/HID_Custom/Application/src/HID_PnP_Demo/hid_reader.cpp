@@ -0,0 +1,97 @@
+#include "hid_reader.h"
+
+#include <string.h>
+
+#define REPORT_0                   0x00
+#define COMMAND_TOGGLE_LED         0x80
+#define COMMAND_GET_BUTTON_STATUS  0x81
+#define COMMAND_READ_POTENTIOMETER 0x37
+
+HID_Reader::HID_Reader(hid_device *device, QObject *parent) : QThread(parent)
+{
+    this->device = device;
+    running = true;
+    toggleLeds = false;
+    notifyPending = false;
+    nextCommand = COMMAND_READ_POTENTIOMETER;
+}
+
+void HID_Reader::stop()
+{
+    running = false;
+}
+
+void HID_Reader::toggle_leds()
+{
+    toggleLeds = true;
+}
+
+bool HID_Reader::pop_report(HID_Report &report)
+{
+    return reports.pop(report);
+}
+
+void HID_Reader::reports_drained()
+{
+    notifyPending = false;
+}
+
+bool HID_Reader::write_command(unsigned char command)
+{
+    unsigned char buf[MAX_STR];
+
+    buf[0] = REPORT_0;
+    buf[1] = command;
+    memset((void*)&buf[2], 0x00, sizeof(buf) - 2);
+
+    return hid_write(device, buf, sizeof(buf)) != -1;
+}
+
+void HID_Reader::run()
+{
+    HID_Report report;
+    int outstanding = 0;
+    bool failed = false;
+
+    while(running && !failed)
+    {
+        // COMMAND_TOGGLE_LED has no reply, so it isn't counted
+        if(toggleLeds.exchange(false) && !write_command(COMMAND_TOGGLE_LED))
+        {
+            failed = true;
+            break;
+        }
+
+        // Keep the pipeline full, alternating between the two commands with replies
+        while(outstanding < PIPELINE_DEPTH && !failed)
+        {
+            failed = !write_command(nextCommand);
+            nextCommand = (nextCommand == COMMAND_READ_POTENTIOMETER) ? COMMAND_GET_BUTTON_STATUS : COMMAND_READ_POTENTIOMETER;
+            outstanding++;
+        }
+        if(failed)
+            break;
+
+        // Blocks until a reply arrives, so latency is set by the device's bInterval
+        report.length = hid_read_timeout(device, report.data, sizeof(report.data), READ_TIMEOUT_MS);
+        if(report.length < 0)
+        {
+            failed = true;
+            break;
+        }
+        if(report.length == 0)
+        {
+            // The device drops a command when its last reply hasn't been read yet, start again
+            outstanding = 0;
+            continue;
+        }
+        outstanding--;
+
+        // If the Qt thread has fallen behind, drop the reply, a newer one is coming
+        if(reports.push(report) && !notifyPending.exchange(true))
+            emit reports_available();
+    }
+
+    if(failed)
+        emit device_error();
+}
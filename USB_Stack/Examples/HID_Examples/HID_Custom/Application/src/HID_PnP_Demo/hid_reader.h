@@ -0,0 +1,57 @@
+#ifndef HID_READER_H
+#define HID_READER_H
+
+#include <QThread>
+#include <atomic>
+#include "../HIDAPI/hidapi.h"
+#include "spsc_queue.h"
+
+#define MAX_STR 65
+
+// Number of OUT reports (commands) sent ahead of their replies.
+#define PIPELINE_DEPTH 2
+
+// How long a command's reply is waited for before it's treated as lost (ms).
+#define READ_TIMEOUT_MS 50
+
+struct HID_Report
+{
+    unsigned char data[MAX_STR];
+    int length;
+};
+
+// Owns all reads and writes on an open device. Replies go into a queue for
+// the Qt thread, reports_available() is only emitted when the queue has gone
+// from drained to not drained, so the event loop isn't flooded.
+class HID_Reader : public QThread
+{
+    Q_OBJECT
+public:
+    explicit HID_Reader(hid_device *device, QObject *parent = 0);
+
+    void stop();
+    void toggle_leds();
+
+    // Qt thread only, call reports_drained() before popping.
+    bool pop_report(HID_Report &report);
+    void reports_drained();
+
+signals:
+    void reports_available();
+    void device_error();
+
+protected:
+    void run();
+
+private:
+    hid_device *device;
+    std::atomic<bool> running;
+    std::atomic<bool> toggleLeds;
+    std::atomic<bool> notifyPending;
+    SpscQueue<HID_Report, 64> reports;
+    unsigned char nextCommand;
+
+    bool write_command(unsigned char command);
+};
+
+#endif // HID_READER_H
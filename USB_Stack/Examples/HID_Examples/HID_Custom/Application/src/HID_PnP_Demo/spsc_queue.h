@@ -0,0 +1,56 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+// Lock-free queue for exactly one producer thread and one consumer thread.
+// SIZE must be a power of 2, one slot is always left empty.
+template <typename T, size_t SIZE>
+class SpscQueue
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "SpscQueue SIZE must be a power of 2");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer only. Returns false when full.
+    bool push(const T &item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t next = (h + 1) & (SIZE - 1);
+
+        if(next == tail.load(std::memory_order_acquire))
+            return false;
+
+        items[h] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false when empty.
+    bool pop(T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if(t == head.load(std::memory_order_acquire))
+            return false;
+
+        item = items[t];
+        tail.store((t + 1) & (SIZE - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only, once the producer has stopped.
+    void clear()
+    {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    T items[SIZE];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+#endif // SPSC_QUEUE_H
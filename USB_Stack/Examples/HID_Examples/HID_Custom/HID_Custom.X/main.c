@@ -92,6 +92,7 @@
 #include <xc.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "fuses.h"
 #include "config.h"
 #include "usb.h"
@@ -111,7 +112,7 @@ static void flash_led(void);
 #endif
 static void __interrupt() isr(void);
 
-static bool m_out_event = false;
+static uint8_t* volatile m_out_report = NULL; // OUT report waiting in its EP buffer.
 
 void main(void)
 {
@@ -165,9 +166,14 @@ void main(void)
     while(usb_get_state() != STATE_CONFIGURED){}
     while(1)
     {
-        if(m_out_event)
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+        hid_feature_tasks();
+        
+        if(m_out_report != NULL)
         {
-            switch(g_hid_out_report1.array[0])
+            switch(m_out_report[0])
             {
                 case COMMAND_TOGGLE_LED:
 				    #ifdef USE_BOOT_LED
@@ -206,13 +212,8 @@ void main(void)
                     hid_send_report(0);
                     break;
             }
-            #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-            if(HID_EP_OUT_LAST_PPB == ODD) hid_arm_ep_out(HID_BD_OUT_EVEN);
-            else hid_arm_ep_out(HID_BD_OUT_ODD);
-            #else
-            hid_arm_ep_out();
-            #endif
-            m_out_event = false;
+            m_out_report = NULL;
+            hid_release_out();
         }
     }
 }
@@ -334,9 +335,17 @@ static void flash_led(void)
 }
 #endif
 
-void hid_out(uint8_t report_num)
+void hid_out_packet(uint8_t report_num, uint8_t* report, uint8_t cnt)
 {
-    m_out_event = true;
+    m_out_report = report;
+}
+
+void hid_set_feature(uint8_t report_num)
+{
+    #ifdef USE_BOOT_LED
+    if(g_hid_feature_report1.array[0] & 1) LED_ON();
+    else LED_OFF();
+    #endif
 }
 
 void usb_sof(void)
@@ -32,6 +32,17 @@
 #include "usb_hid.h"
 
 
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [HID_EP][IN]  = hid_in_tasks,
+    #if HID_NUM_OUT_REPORTS > 0
+    [HID_EP][OUT] = hid_out_tasks
+    #endif
+};
+#endif
+
+
 bool usb_service_class_request(void)
 {
     return hid_class_request();
@@ -85,5 +96,5 @@ bool usb_app_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
 
 bool usb_out_control_finished(void)
 {
-    return false;
+    return hid_out_control_finished();
 }
\ No newline at end of file
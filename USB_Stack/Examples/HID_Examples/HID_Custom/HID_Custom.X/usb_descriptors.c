@@ -48,6 +48,10 @@ const uint8_t g_hid_report_descriptor[] =
         Usage_Minimum(1),
         Usage_Maximum(64),
         Output(DATA|ARRAY|ABSOLUTE),
+        Usage_Minimum(1),
+        Usage_Maximum(8),
+        Report_Count(8),
+        Feature(DATA|VARIABLE|ABSOLUTE),
     End_Collection()
 };
 
@@ -151,6 +155,14 @@ const uint16_t g_config_descriptors[] =
     (uint16_t)&config_descriptor0
 };
 
+#ifdef USE_FAST_ENUMERATION
+/** Configuration Descriptor Lengths Array */
+const uint16_t g_config_descriptor_lengths[] =
+{
+    sizeof(config_descriptor0)
+};
+#endif
+
 /** String Zero Descriptor Structure */
 typedef struct
 {
@@ -52,14 +52,14 @@ const uint8_t g_hid_out_report_size[] =
     sizeof(g_hid_out_report1)
 };
 
-//volatile hid_feature_report1_t g_hid_feature_report1;
-//
-//uint16_t g_hid_feature_reports[] =
-//{
-//    (uint16_t)&g_hid_feature_report1,
-//};
-//
-//uint8_t g_hid_feature_report_size[] =
-//{
-//    sizeof(g_hid_feature_report1)
-//};
\ No newline at end of file
+volatile hid_feature_report1_t g_hid_feature_report1 = {0};
+
+const uint16_t g_hid_feature_reports[] =
+{
+    (uint16_t)&g_hid_feature_report1
+};
+
+const uint8_t g_hid_feature_report_size[] =
+{
+    sizeof(g_hid_feature_report1)
+};
\ No newline at end of file
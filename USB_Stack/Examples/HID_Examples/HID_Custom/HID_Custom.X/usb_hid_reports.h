@@ -44,7 +44,7 @@ typedef struct
 
 typedef struct
 {
-
+    uint8_t array[8]; // array[0] bit 0 sets the LED.
 }hid_feature_report1_t;
 
 extern volatile hid_in_report1_t  g_hid_in_report1;
@@ -55,4 +55,8 @@ extern volatile hid_out_report1_t g_hid_out_report1;
 extern const    uint16_t          g_hid_out_reports[];
 extern const    uint8_t           g_hid_out_report_size[];
 
+extern volatile hid_feature_report1_t g_hid_feature_report1;
+extern const    uint16_t              g_hid_feature_reports[];
+extern const    uint8_t               g_hid_feature_report_size[];
+
 #endif /* USB_HID_REPORTS_H */
\ No newline at end of file
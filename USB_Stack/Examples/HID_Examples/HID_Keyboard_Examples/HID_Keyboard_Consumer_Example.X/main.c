@@ -140,12 +140,26 @@ void main(void)
         // Uncomment out the following for polling method.
         //usb_tasks(); 
         
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+        
+        if(usb_get_state() == STATE_SUSPENDED)
+        {
+            // Sleep, unless the host let the button wake it up.
+            if(!usb_get_remote_wakeup()) usb_sleep();
+            else if(BUTTON_PRESSED) usb_remote_wakeup();
+            continue;
+        }
         if(usb_get_state() != STATE_CONFIGURED) continue;  
         
+        #ifdef USE_HID_FRAME_IDLE
+        hid_service_idle();
+        #endif
         service_reports_to_send();
         
         // Uncomment the following for Keyboard Example
-        if(g_hid_sent_report[0] == true && g_hid_report_sent)
+        if(g_hid_sent_report[0] == true) // Report 0 has gone, it can be changed.
         {
             if(BUTTON_WAS_PRESSED)
             {
@@ -164,7 +178,7 @@ void main(void)
         }
         
         // Uncomment the following for Consumer Example
-//        if(g_hid_sent_report[1] == true && g_hid_report_sent)
+//        if(g_hid_sent_report[1] == true)
 //        {
 //            if(BUTTON_WAS_PRESSED)
 //            {
@@ -299,12 +313,13 @@ static void flash_led(void)
 
 static void service_reports_to_send(void)
 {
-    if((g_hid_in_report_settings[0].Idle_Count_Overflow || m_send_report0) && g_hid_report_sent)
+    // USE_HID_REPORT_QUEUE, both reports can be handed over at once, the second goes when the first has.
+    if(g_hid_in_report_settings[0].Idle_Count_Overflow || m_send_report0)
     {
         m_send_report0 = false;
         hid_send_report(0);
     }
-    if((g_hid_in_report_settings[1].Idle_Count_Overflow || m_send_report1) && g_hid_report_sent)
+    if(g_hid_in_report_settings[1].Idle_Count_Overflow || m_send_report1)
     {
         m_send_report1 = false;
         hid_send_report(1);
@@ -313,8 +328,9 @@ static void service_reports_to_send(void)
 
 static void send_key(uint8_t modifier, uint8_t key_code)
 {
-    g_hid_in_report1.Modifiers = modifier;
-    g_hid_in_report1.Keycode   = key_code;
+    keyboard_release_all();
+    keyboard_set_modifiers(modifier);
+    if(key_code != KEY_NULL) keyboard_press(key_code);
     m_send_report0 = true;
 }
 
@@ -329,6 +345,11 @@ void usb_sof(void)
     hid_service_sof();
 }
 
+void hid_in(uint8_t report_num)
+{
+    // Nothing to do, reports are sent from main.
+}
+
 void hid_out(uint8_t report_num)
 {
     #ifdef USE_BOOT_LED
@@ -97,19 +97,13 @@
 #include "usb_hid.h"
 #include "usb_hid_reports.h"
 #include "ascii_2_key.h"
-
-#if INTERRUPTS_MASK == 0
-#error "RubberDucky Example needs usb interrupt method, because blocking is used."
-#endif
+#include "key_typer.h"
 
 static void example_init(void);
 #ifdef USE_BOOT_LED
 static void flash_led(void);
 #endif
 static void __interrupt() isr(void);
-static void send_key(uint8_t modifier, uint8_t key_code);
-static void send_consumer(uint8_t consumer_val);
-static void print_keys(const uint8_t * str);
 
 static const uint8_t message[] = "https://youtu.be/dQw4w9WgXcQ?t=43s\r";
 
@@ -128,19 +122,23 @@ void main(void)
     USB_INTERRUPT_ENABLE = 1;
     INTCONbits.GIE = 1;
     
-    while(usb_get_state() != STATE_CONFIGURED){}
-    __delay_ms(2000);
-    send_key(0,0);
-    send_consumer(0x00);
+    key_typer_init();
+    while(usb_get_state() != STATE_CONFIGURED) usb_sleep();
+    
+    // Everything is typed from the USB interrupt, main only keeps the queue full.
+    key_typer_pause(2000);
+    key_typer_key(MOD_KEY_LEFTMETA, KEY_R); // Open Run.
+    key_typer_pause(500);
     
-    send_key(MOD_KEY_LEFTMETA, 0);
-    __delay_ms(100);
-    send_key(MOD_KEY_LEFTMETA, KEY_R);
-    __delay_ms(100);
-    send_key(0,0);
-    __delay_ms(500);
-    print_keys(message);
-    while(1){}
+    uint8_t i = 0;
+    while(1)
+    {
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+        usb_sleep(); // Only sleeps while the host has suspended the bus.
+        if(message[i]) i += key_typer_print(&message[i]);
+    }
 }
 
 static void example_init(void)
@@ -260,37 +258,10 @@ static void flash_led(void)
 }
 #endif
 
-static void send_key(uint8_t modifier, uint8_t key_code)
-{
-    g_hid_in_report1.Modifiers = modifier;
-    g_hid_in_report1.Keycode   = key_code;
-    hid_send_report(0);
-    while(!g_hid_report_sent){}
-}
-
-static void send_consumer(uint8_t consumer_val)
-{
-    g_hid_in_report2.Consumer_Byte = consumer_val;
-    hid_send_report(1);
-    while(!g_hid_report_sent){}
-}
-
-static void print_keys(const uint8_t * str)
-{
-    uint8_t i = 0;
-    while(str[i])
-    {
-        ascii_2_key(str[i]);
-        send_key(g_key_result.Modifier, g_key_result.KeyCode);
-        i++;
-        if(str[i] == str[i - 1]) send_key(0,0);  // Repeated letters need to be released first.
-    }
-    send_key(0,0);
-}
-
 void usb_sof(void)
 {
     //hid_service_sof(); // We ignore idle in this example
+    key_typer_sof();
 }
 
 void USB_ServiceAppOut(void)
@@ -298,6 +269,11 @@ void USB_ServiceAppOut(void)
     
 }
 
+void hid_in(uint8_t report_num)
+{
+    key_typer_in(report_num);
+}
+
 void hid_out(uint8_t report_num)
 {
     #ifdef USE_BOOT_LED
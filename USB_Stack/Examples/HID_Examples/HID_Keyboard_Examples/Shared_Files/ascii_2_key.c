@@ -30,130 +30,447 @@
 #include <stdbool.h>
 #include "ascii_2_key.h"
 
-#define IS_CHARACTER      (val > 31 && val < 127)
-#define IS_CAPITAL_LETTER (val > 64 && val < 91)
-#define IS_LOWER_LETTER   (val > 96 && val < 123)
-#define IS_NUMBER         (val > 47 && val < 58)
-
-#define IS_SYMBOL_AREA_1  (val < 48)
-#define IS_SYMBOL_AREA_2  (val < 65)
-#define IS_SYMBOL_AREA_3  (val < 97)
-#define IS_SYMBOL_AREA_4  (val < 127)
+// Each entry packs the modifier in the high byte and the key code in the low one.
+#define SHIFT(key)  (((uint16_t)MOD_KEY_LEFTSHIFT << 8) | (key))
+#define ALT_GR(key) (((uint16_t)MOD_KEY_RIGHTALT << 8) | (key))
 
 Key_Result_t g_key_result;
 
-const uint8_t symbol_lookup_1[16] =
+/* Printable ASCII, ' ' to DEL, in the KEYBOARD_LAYOUT the host is set to. */
+#if KEYBOARD_LAYOUT == LAYOUT_US
+static const uint16_t key_lookup[96] =
 {
-    KEY_SPACE,      // ' '
-    KEY_1,          // '!'
-    KEY_APOSTROPHE, // '\"'
-    KEY_3,          // '#'
-    KEY_4,          // '$'
-    KEY_5,          // '%'
-    KEY_7,          // '&'
-    KEY_APOSTROPHE, // '\''
-    KEY_9,          // '('
-    KEY_0,          // ')'
-    KEY_8,          // '*'
-    KEY_EQUAL,      // '+'
-    KEY_COMMA,      // ','
-    KEY_MINUS,      // '-'
-    KEY_DOT,        // '.'
-    KEY_SLASH       // '/'
+    KEY_SPACE,             // ' '
+    SHIFT(KEY_1),          // '!'
+    SHIFT(KEY_APOSTROPHE), // '"'
+    SHIFT(KEY_3),          // '#'
+    SHIFT(KEY_4),          // '$'
+    SHIFT(KEY_5),          // '%'
+    SHIFT(KEY_7),          // '&'
+    KEY_APOSTROPHE,        // '\''
+    SHIFT(KEY_9),          // '('
+    SHIFT(KEY_0),          // ')'
+    SHIFT(KEY_8),          // '*'
+    SHIFT(KEY_EQUAL),      // '+'
+    KEY_COMMA,             // ','
+    KEY_MINUS,             // '-'
+    KEY_DOT,               // '.'
+    KEY_SLASH,             // '/'
+    KEY_0,                 // '0'
+    KEY_1,                 // '1'
+    KEY_2,                 // '2'
+    KEY_3,                 // '3'
+    KEY_4,                 // '4'
+    KEY_5,                 // '5'
+    KEY_6,                 // '6'
+    KEY_7,                 // '7'
+    KEY_8,                 // '8'
+    KEY_9,                 // '9'
+    SHIFT(KEY_SEMICOLON),  // ':'
+    KEY_SEMICOLON,         // ';'
+    SHIFT(KEY_COMMA),      // '<'
+    KEY_EQUAL,             // '='
+    SHIFT(KEY_DOT),        // '>'
+    SHIFT(KEY_SLASH),      // '?'
+    SHIFT(KEY_2),          // '@'
+    SHIFT(KEY_A),          // 'A'
+    SHIFT(KEY_B),          // 'B'
+    SHIFT(KEY_C),          // 'C'
+    SHIFT(KEY_D),          // 'D'
+    SHIFT(KEY_E),          // 'E'
+    SHIFT(KEY_F),          // 'F'
+    SHIFT(KEY_G),          // 'G'
+    SHIFT(KEY_H),          // 'H'
+    SHIFT(KEY_I),          // 'I'
+    SHIFT(KEY_J),          // 'J'
+    SHIFT(KEY_K),          // 'K'
+    SHIFT(KEY_L),          // 'L'
+    SHIFT(KEY_M),          // 'M'
+    SHIFT(KEY_N),          // 'N'
+    SHIFT(KEY_O),          // 'O'
+    SHIFT(KEY_P),          // 'P'
+    SHIFT(KEY_Q),          // 'Q'
+    SHIFT(KEY_R),          // 'R'
+    SHIFT(KEY_S),          // 'S'
+    SHIFT(KEY_T),          // 'T'
+    SHIFT(KEY_U),          // 'U'
+    SHIFT(KEY_V),          // 'V'
+    SHIFT(KEY_W),          // 'W'
+    SHIFT(KEY_X),          // 'X'
+    SHIFT(KEY_Y),          // 'Y'
+    SHIFT(KEY_Z),          // 'Z'
+    KEY_LEFTBRACE,         // '['
+    KEY_BACKSLASH,         // '\\'
+    KEY_RIGHTBRACE,        // ']'
+    SHIFT(KEY_6),          // '^'
+    SHIFT(KEY_MINUS),      // '_'
+    KEY_GRAVE,             // '`'
+    KEY_A,                 // 'a'
+    KEY_B,                 // 'b'
+    KEY_C,                 // 'c'
+    KEY_D,                 // 'd'
+    KEY_E,                 // 'e'
+    KEY_F,                 // 'f'
+    KEY_G,                 // 'g'
+    KEY_H,                 // 'h'
+    KEY_I,                 // 'i'
+    KEY_J,                 // 'j'
+    KEY_K,                 // 'k'
+    KEY_L,                 // 'l'
+    KEY_M,                 // 'm'
+    KEY_N,                 // 'n'
+    KEY_O,                 // 'o'
+    KEY_P,                 // 'p'
+    KEY_Q,                 // 'q'
+    KEY_R,                 // 'r'
+    KEY_S,                 // 's'
+    KEY_T,                 // 't'
+    KEY_U,                 // 'u'
+    KEY_V,                 // 'v'
+    KEY_W,                 // 'w'
+    KEY_X,                 // 'x'
+    KEY_Y,                 // 'y'
+    KEY_Z,                 // 'z'
+    SHIFT(KEY_LEFTBRACE),  // '{'
+    SHIFT(KEY_BACKSLASH),  // '|'
+    SHIFT(KEY_RIGHTBRACE), // '}'
+    SHIFT(KEY_GRAVE),      // '~'
+    KEY_DELETE             // DEL
 };
 
-const uint8_t symbol_lookup_2[7] =
+#elif KEYBOARD_LAYOUT == LAYOUT_UK
+static const uint16_t key_lookup[96] =
 {
-    KEY_SEMICOLON,  // ':'
-    KEY_SEMICOLON,  // ';'
-    KEY_COMMA,      // '<'
-    KEY_EQUAL,      // '='
-    KEY_DOT,        // '>'
-    KEY_SLASH,      // '?'
-    KEY_2           // '@'
+    KEY_SPACE,             // ' '
+    SHIFT(KEY_1),          // '!'
+    SHIFT(KEY_2),          // '"'
+    KEY_HASHTILDE,         // '#'
+    SHIFT(KEY_4),          // '$'
+    SHIFT(KEY_5),          // '%'
+    SHIFT(KEY_7),          // '&'
+    KEY_APOSTROPHE,        // '\''
+    SHIFT(KEY_9),          // '('
+    SHIFT(KEY_0),          // ')'
+    SHIFT(KEY_8),          // '*'
+    SHIFT(KEY_EQUAL),      // '+'
+    KEY_COMMA,             // ','
+    KEY_MINUS,             // '-'
+    KEY_DOT,               // '.'
+    KEY_SLASH,             // '/'
+    KEY_0,                 // '0'
+    KEY_1,                 // '1'
+    KEY_2,                 // '2'
+    KEY_3,                 // '3'
+    KEY_4,                 // '4'
+    KEY_5,                 // '5'
+    KEY_6,                 // '6'
+    KEY_7,                 // '7'
+    KEY_8,                 // '8'
+    KEY_9,                 // '9'
+    SHIFT(KEY_SEMICOLON),  // ':'
+    KEY_SEMICOLON,         // ';'
+    SHIFT(KEY_COMMA),      // '<'
+    KEY_EQUAL,             // '='
+    SHIFT(KEY_DOT),        // '>'
+    SHIFT(KEY_SLASH),      // '?'
+    SHIFT(KEY_APOSTROPHE), // '@'
+    SHIFT(KEY_A),          // 'A'
+    SHIFT(KEY_B),          // 'B'
+    SHIFT(KEY_C),          // 'C'
+    SHIFT(KEY_D),          // 'D'
+    SHIFT(KEY_E),          // 'E'
+    SHIFT(KEY_F),          // 'F'
+    SHIFT(KEY_G),          // 'G'
+    SHIFT(KEY_H),          // 'H'
+    SHIFT(KEY_I),          // 'I'
+    SHIFT(KEY_J),          // 'J'
+    SHIFT(KEY_K),          // 'K'
+    SHIFT(KEY_L),          // 'L'
+    SHIFT(KEY_M),          // 'M'
+    SHIFT(KEY_N),          // 'N'
+    SHIFT(KEY_O),          // 'O'
+    SHIFT(KEY_P),          // 'P'
+    SHIFT(KEY_Q),          // 'Q'
+    SHIFT(KEY_R),          // 'R'
+    SHIFT(KEY_S),          // 'S'
+    SHIFT(KEY_T),          // 'T'
+    SHIFT(KEY_U),          // 'U'
+    SHIFT(KEY_V),          // 'V'
+    SHIFT(KEY_W),          // 'W'
+    SHIFT(KEY_X),          // 'X'
+    SHIFT(KEY_Y),          // 'Y'
+    SHIFT(KEY_Z),          // 'Z'
+    KEY_LEFTBRACE,         // '['
+    KEY_102ND,             // '\\'
+    KEY_RIGHTBRACE,        // ']'
+    SHIFT(KEY_6),          // '^'
+    SHIFT(KEY_MINUS),      // '_'
+    KEY_GRAVE,             // '`'
+    KEY_A,                 // 'a'
+    KEY_B,                 // 'b'
+    KEY_C,                 // 'c'
+    KEY_D,                 // 'd'
+    KEY_E,                 // 'e'
+    KEY_F,                 // 'f'
+    KEY_G,                 // 'g'
+    KEY_H,                 // 'h'
+    KEY_I,                 // 'i'
+    KEY_J,                 // 'j'
+    KEY_K,                 // 'k'
+    KEY_L,                 // 'l'
+    KEY_M,                 // 'm'
+    KEY_N,                 // 'n'
+    KEY_O,                 // 'o'
+    KEY_P,                 // 'p'
+    KEY_Q,                 // 'q'
+    KEY_R,                 // 'r'
+    KEY_S,                 // 's'
+    KEY_T,                 // 't'
+    KEY_U,                 // 'u'
+    KEY_V,                 // 'v'
+    KEY_W,                 // 'w'
+    KEY_X,                 // 'x'
+    KEY_Y,                 // 'y'
+    KEY_Z,                 // 'z'
+    SHIFT(KEY_LEFTBRACE),  // '{'
+    SHIFT(KEY_102ND),      // '|'
+    SHIFT(KEY_RIGHTBRACE), // '}'
+    SHIFT(KEY_HASHTILDE),  // '~'
+    KEY_DELETE             // DEL
 };
 
-const uint8_t symbol_lookup_3[6] =
+#elif KEYBOARD_LAYOUT == LAYOUT_DE
+// '^' and '`' are dead keys, the host waits for the next key (a space gives the character).
+static const uint16_t key_lookup[96] =
 {
-    KEY_LEFTBRACE,  // '['
-    KEY_BACKSLASH,  // '\'
-    KEY_RIGHTBRACE, // ']'
-    KEY_6,          // '^'
-    KEY_MINUS,      // '_'
-    KEY_GRAVE       // '`'
+    KEY_SPACE,             // ' '
+    SHIFT(KEY_1),          // '!'
+    SHIFT(KEY_2),          // '"'
+    KEY_HASHTILDE,         // '#'
+    SHIFT(KEY_4),          // '$'
+    SHIFT(KEY_5),          // '%'
+    SHIFT(KEY_6),          // '&'
+    SHIFT(KEY_HASHTILDE),  // '\''
+    SHIFT(KEY_8),          // '('
+    SHIFT(KEY_9),          // ')'
+    SHIFT(KEY_RIGHTBRACE), // '*'
+    KEY_RIGHTBRACE,        // '+'
+    KEY_COMMA,             // ','
+    KEY_SLASH,             // '-'
+    KEY_DOT,               // '.'
+    SHIFT(KEY_7),          // '/'
+    KEY_0,                 // '0'
+    KEY_1,                 // '1'
+    KEY_2,                 // '2'
+    KEY_3,                 // '3'
+    KEY_4,                 // '4'
+    KEY_5,                 // '5'
+    KEY_6,                 // '6'
+    KEY_7,                 // '7'
+    KEY_8,                 // '8'
+    KEY_9,                 // '9'
+    SHIFT(KEY_DOT),        // ':'
+    SHIFT(KEY_COMMA),      // ';'
+    KEY_102ND,             // '<'
+    SHIFT(KEY_0),          // '='
+    SHIFT(KEY_102ND),      // '>'
+    SHIFT(KEY_MINUS),      // '?'
+    ALT_GR(KEY_Q),         // '@'
+    SHIFT(KEY_A),          // 'A'
+    SHIFT(KEY_B),          // 'B'
+    SHIFT(KEY_C),          // 'C'
+    SHIFT(KEY_D),          // 'D'
+    SHIFT(KEY_E),          // 'E'
+    SHIFT(KEY_F),          // 'F'
+    SHIFT(KEY_G),          // 'G'
+    SHIFT(KEY_H),          // 'H'
+    SHIFT(KEY_I),          // 'I'
+    SHIFT(KEY_J),          // 'J'
+    SHIFT(KEY_K),          // 'K'
+    SHIFT(KEY_L),          // 'L'
+    SHIFT(KEY_M),          // 'M'
+    SHIFT(KEY_N),          // 'N'
+    SHIFT(KEY_O),          // 'O'
+    SHIFT(KEY_P),          // 'P'
+    SHIFT(KEY_Q),          // 'Q'
+    SHIFT(KEY_R),          // 'R'
+    SHIFT(KEY_S),          // 'S'
+    SHIFT(KEY_T),          // 'T'
+    SHIFT(KEY_U),          // 'U'
+    SHIFT(KEY_V),          // 'V'
+    SHIFT(KEY_W),          // 'W'
+    SHIFT(KEY_X),          // 'X'
+    SHIFT(KEY_Z),          // 'Y'
+    SHIFT(KEY_Y),          // 'Z'
+    ALT_GR(KEY_8),         // '['
+    ALT_GR(KEY_MINUS),     // '\\'
+    ALT_GR(KEY_9),         // ']'
+    KEY_GRAVE,             // '^'
+    SHIFT(KEY_SLASH),      // '_'
+    SHIFT(KEY_EQUAL),      // '`'
+    KEY_A,                 // 'a'
+    KEY_B,                 // 'b'
+    KEY_C,                 // 'c'
+    KEY_D,                 // 'd'
+    KEY_E,                 // 'e'
+    KEY_F,                 // 'f'
+    KEY_G,                 // 'g'
+    KEY_H,                 // 'h'
+    KEY_I,                 // 'i'
+    KEY_J,                 // 'j'
+    KEY_K,                 // 'k'
+    KEY_L,                 // 'l'
+    KEY_M,                 // 'm'
+    KEY_N,                 // 'n'
+    KEY_O,                 // 'o'
+    KEY_P,                 // 'p'
+    KEY_Q,                 // 'q'
+    KEY_R,                 // 'r'
+    KEY_S,                 // 's'
+    KEY_T,                 // 't'
+    KEY_U,                 // 'u'
+    KEY_V,                 // 'v'
+    KEY_W,                 // 'w'
+    KEY_X,                 // 'x'
+    KEY_Z,                 // 'y'
+    KEY_Y,                 // 'z'
+    ALT_GR(KEY_7),         // '{'
+    ALT_GR(KEY_102ND),     // '|'
+    ALT_GR(KEY_0),         // '}'
+    ALT_GR(KEY_RIGHTBRACE),// '~'
+    KEY_DELETE             // DEL
 };
 
-const uint8_t symbol_lookup_4[4] =
+#elif KEYBOARD_LAYOUT == LAYOUT_FR
+// '`' and '~' are dead keys, the host waits for the next key (a space gives the character).
+static const uint16_t key_lookup[96] =
 {
-    KEY_LEFTBRACE,  // '{'
-    KEY_BACKSLASH,  // '|'
-    KEY_RIGHTBRACE, // '{'
-    KEY_GRAVE       // '~'
+    KEY_SPACE,             // ' '
+    KEY_SLASH,             // '!'
+    KEY_3,                 // '"'
+    ALT_GR(KEY_3),         // '#'
+    KEY_RIGHTBRACE,        // '$'
+    SHIFT(KEY_APOSTROPHE), // '%'
+    KEY_1,                 // '&'
+    KEY_4,                 // '\''
+    KEY_5,                 // '('
+    KEY_MINUS,             // ')'
+    KEY_HASHTILDE,         // '*'
+    SHIFT(KEY_EQUAL),      // '+'
+    KEY_M,                 // ','
+    KEY_6,                 // '-'
+    SHIFT(KEY_COMMA),      // '.'
+    SHIFT(KEY_DOT),        // '/'
+    SHIFT(KEY_0),          // '0'
+    SHIFT(KEY_1),          // '1'
+    SHIFT(KEY_2),          // '2'
+    SHIFT(KEY_3),          // '3'
+    SHIFT(KEY_4),          // '4'
+    SHIFT(KEY_5),          // '5'
+    SHIFT(KEY_6),          // '6'
+    SHIFT(KEY_7),          // '7'
+    SHIFT(KEY_8),          // '8'
+    SHIFT(KEY_9),          // '9'
+    KEY_DOT,               // ':'
+    KEY_COMMA,             // ';'
+    KEY_102ND,             // '<'
+    KEY_EQUAL,             // '='
+    SHIFT(KEY_102ND),      // '>'
+    SHIFT(KEY_M),          // '?'
+    ALT_GR(KEY_0),         // '@'
+    SHIFT(KEY_Q),          // 'A'
+    SHIFT(KEY_B),          // 'B'
+    SHIFT(KEY_C),          // 'C'
+    SHIFT(KEY_D),          // 'D'
+    SHIFT(KEY_E),          // 'E'
+    SHIFT(KEY_F),          // 'F'
+    SHIFT(KEY_G),          // 'G'
+    SHIFT(KEY_H),          // 'H'
+    SHIFT(KEY_I),          // 'I'
+    SHIFT(KEY_J),          // 'J'
+    SHIFT(KEY_K),          // 'K'
+    SHIFT(KEY_L),          // 'L'
+    SHIFT(KEY_SEMICOLON),  // 'M'
+    SHIFT(KEY_N),          // 'N'
+    SHIFT(KEY_O),          // 'O'
+    SHIFT(KEY_P),          // 'P'
+    SHIFT(KEY_A),          // 'Q'
+    SHIFT(KEY_R),          // 'R'
+    SHIFT(KEY_S),          // 'S'
+    SHIFT(KEY_T),          // 'T'
+    SHIFT(KEY_U),          // 'U'
+    SHIFT(KEY_V),          // 'V'
+    SHIFT(KEY_Z),          // 'W'
+    SHIFT(KEY_X),          // 'X'
+    SHIFT(KEY_Y),          // 'Y'
+    SHIFT(KEY_W),          // 'Z'
+    ALT_GR(KEY_5),         // '['
+    ALT_GR(KEY_8),         // '\\'
+    ALT_GR(KEY_MINUS),     // ']'
+    ALT_GR(KEY_9),         // '^'
+    KEY_8,                 // '_'
+    ALT_GR(KEY_7),         // '`'
+    KEY_Q,                 // 'a'
+    KEY_B,                 // 'b'
+    KEY_C,                 // 'c'
+    KEY_D,                 // 'd'
+    KEY_E,                 // 'e'
+    KEY_F,                 // 'f'
+    KEY_G,                 // 'g'
+    KEY_H,                 // 'h'
+    KEY_I,                 // 'i'
+    KEY_J,                 // 'j'
+    KEY_K,                 // 'k'
+    KEY_L,                 // 'l'
+    KEY_SEMICOLON,         // 'm'
+    KEY_N,                 // 'n'
+    KEY_O,                 // 'o'
+    KEY_P,                 // 'p'
+    KEY_A,                 // 'q'
+    KEY_R,                 // 'r'
+    KEY_S,                 // 's'
+    KEY_T,                 // 't'
+    KEY_U,                 // 'u'
+    KEY_V,                 // 'v'
+    KEY_Z,                 // 'w'
+    KEY_X,                 // 'x'
+    KEY_Y,                 // 'y'
+    KEY_W,                 // 'z'
+    ALT_GR(KEY_4),         // '{'
+    ALT_GR(KEY_6),         // '|'
+    ALT_GR(KEY_EQUAL),     // '}'
+    ALT_GR(KEY_2),         // '~'
+    KEY_DELETE             // DEL
 };
 
+#else
+#error "KEYBOARD_LAYOUT must be LAYOUT_US, LAYOUT_UK, LAYOUT_DE or LAYOUT_FR."
+#endif
+
 void ascii_2_key(uint8_t val)
 {
-    g_key_result.Modifier = 0;
-    g_key_result.KeyCode  = KEY_NULL;
+    uint16_t key;
     
-    if(IS_CHARACTER)
+    if(val >= ' ' && val <= 127)
     {
-        if(IS_LOWER_LETTER)
-        {
-            g_key_result.KeyCode = val - ('a' - KEY_A); // 'a' - KEY_A = 97 - 4 = 93.
-        }
-        else if(IS_CAPITAL_LETTER)
-        {
-            g_key_result.Modifier = MOD_KEY_LEFTSHIFT;
-            g_key_result.KeyCode = val - ('A' - KEY_A);  // 'A' - KEY_A = 65 - 4 = 61.
-        }
-        else if(IS_NUMBER)
-        {
-            if(val == '0') g_key_result.KeyCode = KEY_0;
-            else g_key_result.KeyCode = val - ('1' - KEY_1);  // '1' - KEY_1 = 49 - 30 = 19.
-        }
-        else
-        {
-            if(IS_SYMBOL_AREA_1)
-            {
-                if((val != ' ') && 
-                   (val != '\'') && 
-                   (val != ',') &&
-                   (val != '-') &&
-                   (val != '.') &&
-                   (val != '/')) g_key_result.Modifier = MOD_KEY_LEFTSHIFT;
-                g_key_result.KeyCode = symbol_lookup_1[val - ' '];
-            }
-            else if(IS_SYMBOL_AREA_2)
-            {
-                if((val != ';')&&(val != '=')) g_key_result.Modifier = MOD_KEY_LEFTSHIFT;
-                g_key_result.KeyCode = symbol_lookup_2[val - ':'];
-            }
-            else if(IS_SYMBOL_AREA_3)
-            {
-                if((val == '^')||(val == '_')) g_key_result.Modifier = MOD_KEY_LEFTSHIFT;
-                g_key_result.KeyCode = symbol_lookup_3[val - '['];
-            }
-            else if(IS_SYMBOL_AREA_4)
-            {
-                g_key_result.Modifier = MOD_KEY_LEFTSHIFT;
-                g_key_result.KeyCode = symbol_lookup_4[val - '{'];
-            }
-        }
+        key = key_lookup[val - ' '];
+        g_key_result.Modifier = (uint8_t)(key >> 8);
+        g_key_result.KeyCode  = (uint8_t)key;
+        return;
     }
-    else
+    
+    g_key_result.Modifier = 0;
+    g_key_result.KeyCode  = KEY_NULL;
+    switch(val)
     {
-        switch(val)
-        {
-            case ELC: // End of Line Character set in header file.
-                g_key_result.KeyCode = KEY_ENTER;
-                break;
-            case '\t':
-                g_key_result.KeyCode = KEY_TAB;
-                break;
-            case '\b':
-                g_key_result.KeyCode = KEY_BACKSPACE;
-                break;
-        }
+        case ELC: // End of Line Character set in header file.
+            g_key_result.KeyCode = KEY_ENTER;
+            break;
+        case '\t':
+            g_key_result.KeyCode = KEY_TAB;
+            break;
+        case '\b':
+            g_key_result.KeyCode = KEY_BACKSPACE;
+            break;
     }
 }
\ No newline at end of file
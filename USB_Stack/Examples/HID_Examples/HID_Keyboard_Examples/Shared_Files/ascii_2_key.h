@@ -39,6 +39,14 @@
 // Mac uses \r.
 #define ELC '\r'
 
+// Keyboard layout the host is set to, the key codes are picked so it types the right characters.
+#define LAYOUT_US 0
+#define LAYOUT_UK 1
+#define LAYOUT_DE 2
+#define LAYOUT_FR 3
+
+#define KEYBOARD_LAYOUT LAYOUT_US
+
 typedef struct
 {
     uint8_t Modifier;
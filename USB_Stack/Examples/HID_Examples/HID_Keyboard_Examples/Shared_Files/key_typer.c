@@ -0,0 +1,240 @@
+/**
+ * @file key_typer.c
+ * @brief Non-blocking keystroke queue for the keyboard examples.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - HID Examples.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_hid.h"
+#include "usb_hid_reports.h"
+#include "ascii_2_key.h"
+#include "key_typer.h"
+
+#define FIFO_MASK (KEY_TYPER_FIFO_SIZE - 1)
+
+#if (KEY_TYPER_FIFO_SIZE & FIFO_MASK) || (KEY_TYPER_FIFO_SIZE > 128)
+#error "KEY_TYPER_FIFO_SIZE must be a power of 2, up to 128."
+#endif
+
+#define STATE_IDLE     0
+#define STATE_PRESSED  1
+#define STATE_RELEASED 2
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+static key_typer_key_t  m_fifo[KEY_TYPER_FIFO_SIZE];
+static volatile uint8_t m_head;  // Written by main only.
+static volatile uint8_t m_tail;  // Written by the USB interrupt only.
+static volatile uint8_t m_state;
+static volatile uint8_t m_wait;  // SOFs left before the next key.
+static uint8_t          m_modifier; // Key held down in STATE_PRESSED.
+static uint8_t          m_key_code;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void send_key(uint8_t modifier, uint8_t key_code)
+ * 
+ * @brief Puts a key in report 0 and hands it to the HID library.
+ */
+static void send_key(uint8_t modifier, uint8_t key_code);
+
+/**
+ * @fn void next_key(void)
+ * 
+ * @brief Takes the next entry from the queue, a key is pressed and a pause 
+ * starts the wait.
+ */
+static void next_key(void);
+
+/**
+ * @fn bool roll_key(void)
+ * 
+ * @brief Swaps the key held down for the next one in the same report, when 
+ * KEY_TYPER_ROLLOVER is set, the key differs and the modifiers match.
+ * 
+ * @return Returns false if a release report has to go first.
+ */
+static bool roll_key(void);
+
+/**
+ * @fn bool put(uint8_t modifier, uint8_t key_code)
+ * 
+ * @brief Adds an entry to the queue.
+ * 
+ * @return Returns false if the queue is full.
+ */
+static bool put(uint8_t modifier, uint8_t key_code);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** KEY TYPER FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void key_typer_init(void)
+{
+    m_head  = 0;
+    m_tail  = 0;
+    m_state = STATE_IDLE;
+    m_wait  = 0;
+}
+
+bool key_typer_key(uint8_t modifier, uint8_t key_code)
+{
+    return put(modifier, key_code);
+}
+
+bool key_typer_pause(uint16_t ms)
+{
+    uint8_t entries = (uint8_t)((ms + 254u) / 255u);
+    
+    if((uint8_t)(KEY_TYPER_FIFO_SIZE - (uint8_t)(m_head - m_tail)) < entries) return false;
+    while(ms > 255)
+    {
+        put(255, KEY_TYPER_PAUSE);
+        ms -= 255;
+    }
+    if(ms) put((uint8_t)ms, KEY_TYPER_PAUSE);
+    return true;
+}
+
+uint8_t key_typer_print(const uint8_t* str)
+{
+    uint8_t i = 0;
+    
+    while(str[i])
+    {
+        ascii_2_key(str[i]);
+        if(!put(g_key_result.Modifier, g_key_result.KeyCode)) break;
+        i++;
+    }
+    return i;
+}
+
+bool key_typer_busy(void)
+{
+    return (m_head != m_tail) || (m_state != STATE_IDLE) || m_wait;
+}
+
+void key_typer_sof(void)
+{
+    if(m_wait)
+    {
+        m_wait--;
+        return;
+    }
+    if(m_state == STATE_IDLE && g_hid_sent_report[0]) next_key();
+}
+
+void key_typer_in(uint8_t report_num)
+{
+    if(report_num != 0) return;
+    
+    if(m_state == STATE_PRESSED)
+    {
+        if(roll_key()) return;
+        send_key(0, KEY_NULL);
+        m_state = STATE_RELEASED;
+    }
+    else if(m_state == STATE_RELEASED)
+    {
+        m_state = STATE_IDLE;
+        m_wait  = KEY_TYPER_INTERVAL;
+        if(m_wait == 0) next_key();
+    }
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static void send_key(uint8_t modifier, uint8_t key_code)
+{
+    keyboard_release_all();
+    keyboard_set_modifiers(modifier);
+    if(key_code != KEY_NULL) keyboard_press(key_code);
+    m_modifier = modifier;
+    m_key_code = key_code;
+    hid_send_report(0);
+}
+
+static void next_key(void)
+{
+    key_typer_key_t* p_key;
+    
+    if(m_tail == m_head) return;
+    
+    p_key = &m_fifo[m_tail & FIFO_MASK];
+    if(p_key->KeyCode == KEY_TYPER_PAUSE)
+    {
+        m_wait = p_key->Modifier;
+    }
+    else
+    {
+        send_key(p_key->Modifier, p_key->KeyCode);
+        m_state = STATE_PRESSED;
+    }
+    m_tail++;
+}
+
+static bool roll_key(void)
+{
+    key_typer_key_t* p_key;
+    
+    if(!KEY_TYPER_ROLLOVER || KEY_TYPER_INTERVAL != 0 || m_tail == m_head) return false;
+    
+    p_key = &m_fifo[m_tail & FIFO_MASK];
+    if(p_key->KeyCode == KEY_TYPER_PAUSE) return false;
+    if(p_key->KeyCode == m_key_code || p_key->Modifier != m_modifier) return false; // Host would miss it.
+    
+    send_key(p_key->Modifier, p_key->KeyCode);
+    m_tail++;
+    return true;
+}
+
+static bool put(uint8_t modifier, uint8_t key_code)
+{
+    if((uint8_t)(m_head - m_tail) == KEY_TYPER_FIFO_SIZE) return false;
+    
+    m_fifo[m_head & FIFO_MASK].Modifier = modifier;
+    m_fifo[m_head & FIFO_MASK].KeyCode  = key_code;
+    m_head++;
+    return true;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,140 @@
+/**
+ * @file key_typer.h
+ * @brief Non-blocking keystroke queue for the keyboard examples.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - HID Examples.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef KEY_TYPER_H
+#define KEY_TYPER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_hid.h"
+
+/*
+ * Keys are queued from main and typed from the USB interrupt: a press is sent 
+ * on report 0, the release follows as soon as the host has read it (hid_in()), 
+ * and the next key after KEY_TYPER_INTERVAL SOFs. Call key_typer_sof() from 
+ * usb_sof() and key_typer_in() from hid_in().
+ */
+
+#if !defined(USE_SOF) || !defined(USE_HID_IN) || !defined(USE_HID_REPORT_QUEUE)
+#error "key_typer needs USE_SOF, USE_HID_IN and USE_HID_REPORT_QUEUE."
+#endif
+
+/* SETTINGS */
+#define KEY_TYPER_FIFO_SIZE 32 // Keys queued, power of 2, up to 128.
+#define KEY_TYPER_INTERVAL  0  // SOFs (ms) after a release before the next key, 0 is the next poll.
+#define KEY_TYPER_ROLLOVER  1  // 1, a different key with the same modifiers replaces the last one in a 
+                               // single report, instead of a release report between them.
+
+#define KEY_TYPER_PAUSE 0xFF // Reserved Keycode, marks a pause entry.
+
+typedef struct
+{
+    uint8_t Modifier; // Pause length in SOFs for a KEY_TYPER_PAUSE entry.
+    uint8_t KeyCode;
+}key_typer_key_t;
+
+/**
+ * @fn void key_typer_init(void)
+ * 
+ * @brief Empties the queue.
+ */
+void key_typer_init(void);
+
+/**
+ * @fn bool key_typer_key(uint8_t modifier, uint8_t key_code)
+ * 
+ * @brief Queues one key press and release.
+ * 
+ * @param[in] modifier MOD_KEY_x bits held with the key.
+ * @param[in] key_code KEY_x code, KEY_NULL for modifiers only.
+ * 
+ * @return Returns false if the queue is full.
+ */
+bool key_typer_key(uint8_t modifier, uint8_t key_code);
+
+/**
+ * @fn bool key_typer_pause(uint16_t ms)
+ * 
+ * @brief Queues a pause, e.g. for a window to open before typing into it.
+ * 
+ * @param[in] ms Pause length in SOFs (ms).
+ * 
+ * @return Returns false if the queue doesn't have room for it.
+ */
+bool key_typer_pause(uint16_t ms);
+
+/**
+ * @fn uint8_t key_typer_print(const uint8_t* str)
+ * 
+ * @brief Queues as much of a string as fits.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * static const uint8_t message[] = "Hello\r";
+ * uint8_t i = 0;
+ * while(message[i])
+ * {
+ *     i += key_typer_print(&message[i]);
+ *     do_other_work();
+ * }
+ * @endcode
+ * </li></ul>
+ * 
+ * @param[in] str NULL terminated ASCII string.
+ * 
+ * @return Returns the amount of characters queued.
+ */
+uint8_t key_typer_print(const uint8_t* str);
+
+/**
+ * @fn bool key_typer_busy(void)
+ * 
+ * @brief Lets main know if keys are still being typed.
+ * 
+ * @return Returns true until the queue is empty and the last key released.
+ */
+bool key_typer_busy(void);
+
+/**
+ * @fn void key_typer_sof(void)
+ * 
+ * @brief Counts the pause between keys and starts typing, call from usb_sof().
+ */
+void key_typer_sof(void);
+
+/**
+ * @fn void key_typer_in(uint8_t report_num)
+ * 
+ * @brief Sends the release or next key once a report has gone, call from hid_in().
+ * 
+ * @param[in] report_num Report number sent.
+ */
+void key_typer_in(uint8_t report_num);
+
+#endif /* KEY_TYPER_H */
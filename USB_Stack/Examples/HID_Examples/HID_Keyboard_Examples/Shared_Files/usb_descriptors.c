@@ -31,6 +31,7 @@
 #include "usb_hid_report_defines.h"
 #include "usb_hid_pages.h"
 #include "usb_ch9.h"
+#include "usb_hid_reports.h"
 
 // Report Descriptor (Keyboard)
 const uint8_t g_hid_report_descriptor[] =
@@ -63,6 +64,15 @@ const uint8_t g_hid_report_descriptor[] =
         Report_Count(8),
         Input(DATA|VARIABLE|ABSOLUTE),
     
+        #ifdef KEYBOARD_NKRO
+        Usage_Minimum(0),
+        Usage_Maximum(KEYBOARD_NKRO_KEYS - 1),
+        Logic_Minimum(0),
+        Logic_Maximum(1),
+        Report_Size(1),
+        Report_Count(KEYBOARD_NKRO_KEYS),
+        Input(DATA|VARIABLE|ABSOLUTE),
+        #else
         Usage_Minimum(0),
         Usage_Maximum(101),
         Logic_Minimum(0),
@@ -70,6 +80,7 @@ const uint8_t g_hid_report_descriptor[] =
         Report_Size(8),
         Report_Count(1),
         Input(DATA|ARRAY),
+        #endif
     End_Collection(),
     
     Usage_Page(CONSUMER_PAGE),
@@ -135,7 +146,7 @@ static const config_descriptor_t config_descriptor0 =
         0x01,                       // bNumInterfaces:8 - Number of interfaces in this configuration
         0x01,                       // bConfigurationValue:8 - Index value for this configuration
         0x00,                       // iConfiguration:8 - Index of string describing this configuration
-        0xC0,                       // bmAttributes:8 {0:5,RemoteWakeup:1,SelfPowered:1,1:1} - Self Powered
+        0xE0,                       // bmAttributes:8 {0:5,RemoteWakeup:1,SelfPowered:1,1:1} - Self Powered, Remote Wakeup
         50                          // bMaxPower:8 - 100mA power allowed (increments of 2mA)
     },
 
@@ -147,8 +158,13 @@ static const config_descriptor_t config_descriptor0 =
         0x00,           // bAlternateSetting:8 - Value used to select alternate setting
         0x02,           // bNumEndpoints:8 - Number of endpoints used in this interface
         HID,            // bInterfaceClass:8 - Class Code (Assigned by USB Org)
+        #ifdef USE_SET_PROTOCOL
+        HID_BOOT,       // bInterfaceSubClass:8 - Subclass Code (Assigned by USB Org) 
+        HID_KEYBOARD,   // bInterfaceProtocol:8 - Protocol Code (Assigned by USB Org)
+        #else
         0,              // bInterfaceSubClass:8 - Subclass Code (Assigned by USB Org) 
         0,              // bInterfaceProtocol:8 - Protocol Code (Assigned by USB Org)
+        #endif
         0x00            // iInterface:8 - Index of String Descriptor Describing this interface
     },
 
@@ -193,6 +209,14 @@ const uint16_t g_config_descriptors[] =
     (uint16_t)&config_descriptor0
 };
 
+#ifdef USE_FAST_ENUMERATION
+/** Configuration Descriptor Lengths Array */
+const uint16_t g_config_descriptor_lengths[] =
+{
+    sizeof(config_descriptor0)
+};
+#endif
+
 /** String Zero Descriptor Structure */
 typedef struct
 {
@@ -39,16 +39,37 @@
 #define USE_SET_REPORT
 #define USE_GET_IDLE
 #define USE_SET_IDLE
-//#define USE_GET_PROTOCOL // Not yet supported
-//#define USE_SET_PROTOCOL // Not yet supported
+#define USE_GET_PROTOCOL   // Needed by boot devices, g_hid_protocol holds boot (0) or report (1).
+#define USE_SET_PROTOCOL   // Boot protocol sends IN report 0 from g_hid_boot_in_report, in usb_hid_reports.c.
 
 // Endpoint Settings
 #define IN_REPORT_EP      EP1
 #define IN_REPORT_BDT     BD1_IN
 #define IN_REPORT_EP_ADDR EP1_IN_BUFFER_BASE_ADDR
 
+// Report Queue - Uncomment to use
+#define USE_HID_REPORT_QUEUE   // hid_send_report() queues a report while the IN EP is busy, instead of dropping 
+                               // it. Each IN completion sends the next queued report (latest data wins).
+//#define HID_QUEUE_PRIORITY   // Queued reports go lowest report number first, instead of round-robin.
+//#define USE_HID_FEATURE_TASKS // SET_REPORT(Feature) data is passed to hid_set_feature(report_num) from
+                                // hid_feature_tasks() in the main loop. Needs USE_OUT_CONTROL_FINISHED.
+#define USE_HID_IN           // hid_in(report_num) is called when an IN report has gone, from the USB interrupt.
+//#define USE_HID_OUT_NO_COPY // hid_out_packet() is given the OUT report in its EP buffer instead of hid_out(),
+                               // hid_release_out() hands the buffer back.
+//#define USE_HID_MOTION    // hid_motion_add()/hid_motion_buttons() build report HID_MOTION_REPORT at each IN 
+                               // completion, from movement summed since the last poll.
+#define HID_MOTION_REPORT  0   // IN report number, and the byte offsets of its fields.
+#define HID_MOTION_BUTTONS 0
+#define HID_MOTION_X       1
+#define HID_MOTION_Y       2
+//#define HID_MOTION_WHEEL 3   // Leave undefined without a wheel.
+
 // Idle_Settings
 #define DEFAULT_IDLE 500 // in mS
+//#define USE_HID_FRAME_IDLE  // hid_service_idle() in the main loop catches the idle timers up from the frame 
+                             // number, the SOF interrupt only runs near a deadline. Take _SOFIE out of INTERRUPTS_MASK
+                             // if HID is the only usb_sof() user, it stays on otherwise.
+#define HID_IDLE_WAKE_FRAMES 2 // SOF interrupt on from this many frames before a deadline.
 
 // HID Endpoint HAL
 #define HID_EP      EP1
@@ -76,6 +97,9 @@
 #define HID_USE_REPORT_IDS 0
 #define HID_NUM_REPORT_IDS 2
 
+// Keyboard Report - Uncomment to use
+#define KEYBOARD_NKRO // Keyboard report is a bitmap of every key (N-key rollover), instead of one key code.
+
 // KEY MODIFIERS
 #define MOD_KEY_LEFTCTRL    0x01 // LeftControl
 #define MOD_KEY_LEFTSHIFT   0x02 // LeftShift
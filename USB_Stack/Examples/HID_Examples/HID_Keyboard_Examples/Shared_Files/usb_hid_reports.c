@@ -27,8 +27,9 @@
  */
 
 #include "usb_hid_reports.h"
+#include "usb_hid_pages.h"
 
-volatile hid_in_report1_t g_hid_in_report1 = {1,0,0};
+volatile hid_in_report1_t g_hid_in_report1 = {1};
 volatile hid_in_report2_t g_hid_in_report2 = {2,0};
 
 const uint16_t g_hid_in_reports[] =
@@ -43,6 +44,13 @@ const uint8_t g_hid_in_report_size[] =
     sizeof(g_hid_in_report2)
 };
 
+#ifdef USE_SET_PROTOCOL
+volatile hid_boot_keyboard_report_t g_hid_boot_keyboard_report;
+
+const uint16_t g_hid_boot_in_report      = (uint16_t)&g_hid_boot_keyboard_report;
+const uint8_t  g_hid_boot_in_report_size = sizeof(g_hid_boot_keyboard_report);
+#endif
+
 volatile hid_out_report1_t g_hid_out_report1;
 
 const uint16_t g_hid_out_reports[] =
@@ -65,4 +73,75 @@ const uint8_t g_hid_out_report_size[] =
 //uint8_t g_hid_feature_report_size[] =
 //{
 //    sizeof(g_hid_feature_report1)
-//};
\ No newline at end of file
+//};
+
+void keyboard_press(uint8_t key_code)
+{
+    #ifdef USE_SET_PROTOCOL
+    uint8_t free_slot = 6;
+    #endif
+    
+    if(key_code >= KEY_LEFTCTRL && key_code <= KEY_RIGHTMETA)
+    {
+        keyboard_set_modifiers(g_hid_in_report1.Modifiers | (uint8_t)(1 << (key_code - KEY_LEFTCTRL)));
+        return;
+    }
+    #ifdef KEYBOARD_NKRO
+    if(key_code >= KEYBOARD_NKRO_KEYS) return;
+    g_hid_in_report1.Keys[key_code >> 3] |= (uint8_t)(1 << (key_code & 7));
+    #else
+    g_hid_in_report1.Keycode = key_code;
+    #endif
+    
+    #ifdef USE_SET_PROTOCOL
+    for(uint8_t i = 0; i < 6; i++)
+    {
+        if(g_hid_boot_keyboard_report.Keycode[i] == key_code) return; // Already down.
+        if(g_hid_boot_keyboard_report.Keycode[i] == KEY_NULL && free_slot == 6) free_slot = i;
+    }
+    if(free_slot != 6) g_hid_boot_keyboard_report.Keycode[free_slot] = key_code;
+    #endif
+}
+
+void keyboard_release(uint8_t key_code)
+{
+    if(key_code >= KEY_LEFTCTRL && key_code <= KEY_RIGHTMETA)
+    {
+        keyboard_set_modifiers(g_hid_in_report1.Modifiers & (uint8_t)~(1 << (key_code - KEY_LEFTCTRL)));
+        return;
+    }
+    #ifdef KEYBOARD_NKRO
+    if(key_code >= KEYBOARD_NKRO_KEYS) return;
+    g_hid_in_report1.Keys[key_code >> 3] &= (uint8_t)~(1 << (key_code & 7));
+    #else
+    if(g_hid_in_report1.Keycode == key_code) g_hid_in_report1.Keycode = KEY_NULL;
+    #endif
+    
+    #ifdef USE_SET_PROTOCOL
+    for(uint8_t i = 0; i < 6; i++)
+    {
+        if(g_hid_boot_keyboard_report.Keycode[i] == key_code) g_hid_boot_keyboard_report.Keycode[i] = KEY_NULL;
+    }
+    #endif
+}
+
+void keyboard_set_modifiers(uint8_t modifiers)
+{
+    g_hid_in_report1.Modifiers = modifiers;
+    #ifdef USE_SET_PROTOCOL
+    g_hid_boot_keyboard_report.Modifiers = modifiers;
+    #endif
+}
+
+void keyboard_release_all(void)
+{
+    keyboard_set_modifiers(0);
+    #ifdef KEYBOARD_NKRO
+    for(uint8_t i = 0; i < sizeof(g_hid_in_report1.Keys); i++) g_hid_in_report1.Keys[i] = 0;
+    #else
+    g_hid_in_report1.Keycode = KEY_NULL;
+    #endif
+    #ifdef USE_SET_PROTOCOL
+    for(uint8_t i = 0; i < 6; i++) g_hid_boot_keyboard_report.Keycode[i] = KEY_NULL;
+    #endif
+}
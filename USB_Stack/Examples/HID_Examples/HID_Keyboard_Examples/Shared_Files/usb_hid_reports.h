@@ -30,6 +30,11 @@
 #define USB_HID_REPORTS_H
 
 #include <stdint.h>
+#include "usb_hid_config.h"
+
+#ifdef KEYBOARD_NKRO
+#define KEYBOARD_NKRO_KEYS 104 // Key codes 0x00 to 0x67 (Keypad =), one bit each.
+#endif
 
 typedef struct
 {
@@ -49,11 +54,24 @@ typedef struct
             unsigned RIGHT_GUI   :1;
         };
     };
+    #ifdef KEYBOARD_NKRO
+    uint8_t Keys[KEYBOARD_NKRO_KEYS / 8]; // Bit (key_code & 7) of Keys[key_code >> 3].
+    #else
     //uint8_t Reserved;
     //uint8_t Keycode[6];
     uint8_t Keycode;
+    #endif
 }hid_in_report1_t;
 
+#ifdef USE_SET_PROTOCOL
+typedef struct
+{
+    uint8_t Modifiers;
+    uint8_t Reserved;
+    uint8_t Keycode[6];
+}hid_boot_keyboard_report_t;
+#endif
+
 typedef struct
 {
     uint8_t Report_ID;
@@ -94,6 +112,9 @@ typedef struct
 
 extern volatile hid_in_report1_t  g_hid_in_report1;
 extern volatile hid_in_report2_t  g_hid_in_report2;
+#ifdef USE_SET_PROTOCOL
+extern volatile hid_boot_keyboard_report_t g_hid_boot_keyboard_report;
+#endif
 extern const    uint16_t          g_hid_in_reports[];
 extern const    uint8_t           g_hid_in_report_size[];
 
@@ -101,4 +122,49 @@ extern volatile hid_out_report1_t g_hid_out_report1;
 extern const    uint16_t          g_hid_out_reports[];
 extern const    uint8_t           g_hid_out_report_size[];
 
+/**
+ * @fn void keyboard_press(uint8_t key_code)
+ * 
+ * @brief Adds a key to report 1, and to the boot report with USE_SET_PROTOCOL.
+ * 
+ * Modifier keys (KEY_LEFTCTRL to KEY_RIGHTMETA) set their Modifiers bit. 
+ * Without KEYBOARD_NKRO report 1 only holds one key, which is replaced. The 
+ * boot report holds 6, a 7th key is left out of it.
+ * 
+ * @param[in] key_code Key code from usb_hid_pages.h.
+ * 
+ * <b>Code Example:</b>
+ * @code
+ * keyboard_press(KEY_LEFTCTRL);
+ * keyboard_press(KEY_C);
+ * hid_send_report(0);
+ * @endcode
+ */
+void keyboard_press(uint8_t key_code);
+
+/**
+ * @fn void keyboard_release(uint8_t key_code)
+ * 
+ * @brief Takes a key out of report 1, and out of the boot report.
+ * 
+ * @param[in] key_code Key code from usb_hid_pages.h.
+ */
+void keyboard_release(uint8_t key_code);
+
+/**
+ * @fn void keyboard_set_modifiers(uint8_t modifiers)
+ * 
+ * @brief Sets every modifier at once, from the MOD_KEY_ values.
+ * 
+ * @param[in] modifiers Modifier bits.
+ */
+void keyboard_set_modifiers(uint8_t modifiers);
+
+/**
+ * @fn void keyboard_release_all(void)
+ * 
+ * @brief Releases every key and modifier.
+ */
+void keyboard_release_all(void);
+
 #endif /* USB_HID_REPORTS_H */
\ No newline at end of file
@@ -94,6 +94,7 @@
 #include "fuses.h"
 #include "config.h"
 #include "usb.h"
+#include "usb_app.h"
 #include "usb_hid.h"
 #include "usb_hid_reports.h"
 
@@ -106,10 +107,16 @@ static void flash_led(void);
 #endif
 static void __interrupt() isr(void);
 static void service_reports_to_send(void);
+static void mouse_tasks(void);
 
 static bool m_released    = true;
 static bool m_send_report = false;
 
+const usb_event_handler_t g_usb_event_handlers[NUM_EVENTS] =
+{
+    [EVENT_SOF] = mouse_tasks // The button is checked once a frame, the CPU idles in between.
+};
+
 void main(void)
 {
     example_init();
@@ -128,46 +135,39 @@ void main(void)
     
     m_send_report = true;
     
-    while(1)
+    while(1) usb_event_tasks(); // Calls usb_tasks() itself for polling method.
+}
+
+static void mouse_tasks(void)
+{
+    if(usb_get_state() != STATE_CONFIGURED) return;
+    
+    service_reports_to_send();
+    
+    // Movement and buttons go to the HID driver's totals, it builds the 
+    // report when the host polls, so nothing is lost between polls.
+    
+    // Uncomment the following for Button Example
+//    if(BUTTON_WAS_PRESSED)
+//    {
+//        m_released = false;
+//        hid_motion_buttons(0x01);
+//    }
+//    else if(BUTTON_WAS_RELEASED)
+//    {
+//        m_released = true;
+//        hid_motion_buttons(0);
+//    }
+    
+    // Uncomment the following for Pointer Example
+    if(BUTTON_WAS_PRESSED)
+    {
+        m_released = false;
+        hid_motion_add(0, -65, 0);
+    }
+    else if(BUTTON_WAS_RELEASED)
     {
-        // Uncomment out the following for polling method.
-        //usb_tasks(); 
-        
-        if(usb_get_state() != STATE_CONFIGURED) continue;
-        
-        service_reports_to_send();
-        
-        // Uncomment the following for Button Example
-//        if(g_hid_report_sent)
-//        {
-//            if(BUTTON_WAS_PRESSED)
-//            {
-//                m_released = false;
-//                g_hid_in_report1.BUTTON_1 = 1;
-//                m_send_report = true;
-//            }
-//            else if(BUTTON_WAS_RELEASED)
-//            {
-//                m_released = true;
-//                *((uint8_t*)&g_hid_in_report1) = 0;
-//                m_send_report = true;
-//            }
-//        }
-        
-        // Uncomment the following for Pointer Example
-        if(g_hid_report_sent)
-        {
-            if(BUTTON_WAS_PRESSED)
-            {
-                m_released = false;
-                g_hid_in_report1.y = -65;
-                m_send_report = true;
-            }
-            else if(BUTTON_WAS_RELEASED)
-            {
-                m_released = true;
-            }
-        }
+        m_released = true;
     }
 }
 
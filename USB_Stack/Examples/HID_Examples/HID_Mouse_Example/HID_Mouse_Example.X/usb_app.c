@@ -32,6 +32,17 @@
 #include "../../../../USB/usb_hid.h"
 
 
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [HID_EP][IN]  = hid_in_tasks,
+    #if HID_NUM_OUT_REPORTS > 0
+    [HID_EP][OUT] = hid_out_tasks
+    #endif
+};
+#endif
+
+
 bool usb_service_class_request(void)
 {
     return hid_class_request();
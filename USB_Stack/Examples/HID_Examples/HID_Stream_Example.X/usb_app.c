@@ -0,0 +1,116 @@
+/**
+ * @file usb_app.c
+ * @brief Contains application specific functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Application file (This file is for the HID Stream Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+ 
+#include <stdbool.h>
+#include "usb.h"
+#include "usb_app.h"
+#include "usb_hid_stream.h"
+
+
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [EP1][OUT] = hid_stream_out_tasks,
+    [EP1][IN]  = hid_stream_in_tasks,
+    #if HID_STREAM_NUM_CH > 1
+    [EP2][OUT] = hid_stream_out_tasks,
+    [EP2][IN]  = hid_stream_in_tasks,
+    #endif
+    #if HID_STREAM_NUM_CH > 2
+    [EP3][OUT] = hid_stream_out_tasks,
+    [EP3][IN]  = hid_stream_in_tasks,
+    #endif
+    #if HID_STREAM_NUM_CH > 3
+    [EP4][OUT] = hid_stream_out_tasks,
+    [EP4][IN]  = hid_stream_in_tasks,
+    #endif
+    #if HID_STREAM_NUM_CH > 4
+    [EP5][OUT] = hid_stream_out_tasks,
+    [EP5][IN]  = hid_stream_in_tasks,
+    #endif
+    #if HID_STREAM_NUM_CH > 5
+    [EP6][OUT] = hid_stream_out_tasks,
+    [EP6][IN]  = hid_stream_in_tasks,
+    #endif
+    #if HID_STREAM_NUM_CH > 6
+    [EP7][OUT] = hid_stream_out_tasks,
+    [EP7][IN]  = hid_stream_in_tasks
+    #endif
+};
+#endif
+
+
+bool usb_service_class_request(void)
+{
+    return hid_stream_class_request();
+}
+
+bool usb_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+{
+    return hid_stream_get_class_descriptor(descriptor, size);
+}
+
+
+void usb_app_init(void)
+{
+    hid_stream_init();
+}
+
+
+void usb_app_tasks(void)
+{
+    hid_stream_tasks(); // Every EP after EP0 belongs to HID Stream.
+}
+
+
+void usb_app_clear_halt(uint8_t bd_table_index, uint8_t ep, uint8_t dir)
+{
+    hid_stream_clear_halt(bd_table_index, ep, dir);
+}
+
+
+bool usb_app_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    if(alternate_setting != 0) return false;
+    if(interface < HID_STREAM_FIRST_INT || interface >= (HID_STREAM_FIRST_INT + HID_STREAM_NUM_CH)) return false;
+
+    hid_stream_clear_ep_toggle(interface - HID_STREAM_FIRST_INT);
+    return true;
+}
+
+
+bool usb_app_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    return false;
+}
+
+
+bool usb_out_control_finished(void)
+{
+    return false;
+}
@@ -48,7 +48,7 @@
             |     CODE     |
     0x01FFF |______________|
     0x02000 |              |
-            |  PROG MEM    | 0x2000 (8KB) *Only 4KB usable due to 14-bit size words
+            |  PROG MEM    | 0x2000 (8KB) *Only 4KB usable due to 14-bit size words (6KB with MSD_PACKED_FLASH)
     0x03FFF |______________|
     0x10000 |              |
             | CONFIG WORDS | 0x0E
@@ -67,6 +67,22 @@
 #define FAT_REST_OF_START     0x1204
 #define ROOT_ENTRY_START      0x1400
 
+#ifdef MSD_PACKED_FLASH
+/*
+ * Packed, every 8 bytes of a sector take 5 words. Bytes 0-4 are the words' low 
+ * bytes and bytes 5-7 are sliced over the high 6 bits of the first 4 words, the
+ * 5th word's are left erased. A sector is 320 words, 10 erase rows, so 12 
+ * sectors fit where 8 did and each one is 320 flash reads instead of 512.
+ */
+#define PACKED_GROUP_BYTES    8
+#define PACKED_GROUP_WORDS    5
+#define SECTOR_WORDS          (BYTES_PER_BLOCK_LE / PACKED_GROUP_BYTES * PACKED_GROUP_WORDS)
+#define PACKET_WORDS(bytes)   ((bytes) / PACKED_GROUP_BYTES * PACKED_GROUP_WORDS)
+#if SECTOR_WORDS % _FLASH_ERASE_SIZE
+#error "MSD_PACKED_FLASH sectors must be whole erase rows."
+#endif
+#endif
+
 #elif defined(_18F2450) || defined(_18F4450)
 /* PIC18FX450 ROM Space
              ______________
@@ -454,7 +470,13 @@ typedef struct
     uint8_t  FilSysType[8];
 }BOOT16_t;
 
-static const BOOT16_t boot16 __at(BOOT_START) =
+#if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+#define VOLUME_AT(addr) // Written packed by format_volume().
+#else
+#define VOLUME_AT(addr) __at(addr)
+#endif
+
+static const BOOT16_t boot16 VOLUME_AT(BOOT_START) =
 {
     {0xEB,0x3C,0x90},
     {'M','S','D','O','S','5','.','0'},
@@ -478,8 +500,8 @@ static const BOOT16_t boot16 __at(BOOT_START) =
     {'F','A','T','1','2',' ',' ',' '}
 };
 
-static const uint8_t signature_word[SIGNATURE_WORD_SIZE] __at(SIGNATURE_WORD_START) = {0x55, 0xAA};
-static const uint8_t fat12_default[FAT_DEFAULT_SIZE]     __at(FAT_DEFAULT_START)    = {0xF8,0xFF,0xFF,0x00};
+static const uint8_t signature_word[SIGNATURE_WORD_SIZE] VOLUME_AT(SIGNATURE_WORD_START) = {0x55, 0xAA};
+static const uint8_t fat12_default[FAT_DEFAULT_SIZE]     VOLUME_AT(FAT_DEFAULT_START)    = {0xF8,0xFF,0xFF,0x00};
 
 /** Directory Entry Structure */
 typedef struct
@@ -498,7 +520,7 @@ typedef struct
     uint32_t FileSize;
 }DIR_ENTRY_t;
 
-static const DIR_ENTRY_t dir_entry __at(ROOT_ENTRY_START) =
+static const DIR_ENTRY_t dir_entry VOLUME_AT(ROOT_ENTRY_START) =
 {
     {'U','S','B',' ','D','R','I','V','E',' ',' '},
     0x08,
@@ -519,8 +541,21 @@ static void example_init(void);
 static void flash_led(void);
 #endif
 static uint32_t LBA_to_flash_addr(uint32_t LBA);
+#if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+static void pack_group(const uint8_t *p_src, uint8_t *p_words);
+static void unpack_group(const uint8_t *p_words, uint8_t *p_dst);
+static void packed_read(uint16_t addr, uint8_t *p_dst);
+static void packed_write(uint16_t addr, bool sector_start, const uint8_t *p_src);
+static void format_volume(void);
+#endif
 static void __interrupt() isr(void);
 
+#if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+static uint8_t  m_row[_FLASH_ERASE_SIZE * 2]; // Erase row msd_tx_sector() is filling, low and high byte of each word.
+static uint8_t  m_row_words;
+static uint16_t m_row_addr;
+#endif
+
 void main(void)
 {
     example_init();
@@ -530,17 +565,36 @@ void main(void)
     flash_led();
     #endif
     
+    #if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+    format_volume();
+    #endif
+    
     usb_init();
+    #ifndef USE_POLLING
     INTCONbits.PEIE = 1;
     USB_INTERRUPT_FLAG = 0;
     USB_INTERRUPT_ENABLE = 1;
     INTCONbits.GIE = 1;
+    #endif
     
-    while(usb_get_state() != STATE_CONFIGURED){}
+    while(usb_get_state() != STATE_CONFIGURED)
+    {
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+    }
     while(1)
     {
-        //usb_tasks();
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
         msd_tasks();
+        #ifdef MSD_WRITE_CACHE
+        msd_flush_tasks();
+        #endif
     }
 }
 
@@ -673,7 +727,7 @@ static void flash_led(void)
 void msd_rx_sector(void)
 {
     uint32_t addr;
-    #if defined(_PIC14E)
+    #if defined(_PIC14E) && !defined(MSD_PACKED_FLASH)
     uint8_t buffer[64];
     uint8_t i, x;
     #endif
@@ -681,7 +735,10 @@ void msd_rx_sector(void)
     #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
     if(addr < END_OF_FLASH) // If address is in flash space.
     {
-        #if defined(_PIC14E)
+        #if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+        packed_read((uint16_t)(addr + PACKET_WORDS(g_msd_byte_of_sect)), MSD_EP_IN_LAST_PPB == ODD ? g_msd_ep_in_odd : g_msd_ep_in_even);
+        
+        #elif defined(_PIC14E)
         uint8_t *p_ep = MSD_EP_IN_LAST_PPB == ODD ? g_msd_ep_in_odd : g_msd_ep_in_even;
         
         Flash_ReadBytes((uint24_t)(addr + g_msd_byte_of_sect), 64, buffer);
@@ -710,7 +767,10 @@ void msd_rx_sector(void)
     #else
     if(addr < END_OF_FLASH)
     {
-        #if defined(_PIC14E)
+        #if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+        packed_read((uint16_t)(addr + PACKET_WORDS(g_msd_byte_of_sect)), g_msd_ep_in);
+        
+        #elif defined(_PIC14E)
         Flash_ReadBytes((uint24_t)(addr + g_msd_byte_of_sect), 64, buffer);
         for(i = 0, x = 0; i < 64; i += 2, x++) g_msd_ep_in[x] = buffer[i];
         Flash_ReadBytes((uint24_t)(addr + 32 + g_msd_byte_of_sect), 64, buffer);
@@ -735,7 +795,7 @@ void msd_rx_sector(void)
 void msd_tx_sector(void)
 {
     uint32_t addr;
-    #if defined(_PIC14E)
+    #if defined(_PIC14E) && !defined(MSD_PACKED_FLASH)
     uint8_t buffer[64];
     uint8_t i, x;
     #endif
@@ -743,7 +803,10 @@ void msd_tx_sector(void)
     if(addr < END_OF_FLASH) // If address is in flash space.
     {
         #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-        #if defined(_PIC14E)
+        #if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+        packed_write((uint16_t)(addr + PACKET_WORDS(g_msd_byte_of_sect)), g_msd_byte_of_sect == 0, MSD_EP_OUT_LAST_PPB == ODD ? g_msd_ep_out_odd : g_msd_ep_out_even);
+        
+        #elif defined(_PIC14E)
         uint8_t *p_ep = MSD_EP_OUT_LAST_PPB == ODD ? g_msd_ep_out_odd : g_msd_ep_out_even;
         
         for(i = 0, x = 0; i < 64; i += 2, x++)
@@ -751,13 +814,13 @@ void msd_tx_sector(void)
             buffer[i] = p_ep[x];
             buffer[i + 1] = 0xFF;
         }
-        Flash_EraseWriteBlock((uint24_t)(addr + g_msd_byte_of_sect), buffer);
+        Flash_UpdateBlocks((uint24_t)(addr + g_msd_byte_of_sect), (uint24_t)(addr + g_msd_byte_of_sect + 32), buffer);
         for(i = 0, x = 32; i < 64; i += 2, x++)
         {
             buffer[i] = p_ep[x];
             buffer[i + 1] = 0xFF;
         }
-        Flash_EraseWriteBlock((uint24_t)(addr + 32 + g_msd_byte_of_sect), buffer);
+        Flash_UpdateBlocks((uint24_t)(addr + 32 + g_msd_byte_of_sect), (uint24_t)(addr + 64 + g_msd_byte_of_sect), buffer);
         
         #elif defined(__J_PART)
         #ifdef MSD_LIMITED_RAM
@@ -769,27 +832,30 @@ void msd_tx_sector(void)
         #else
 
         #ifdef MSD_LIMITED_RAM
-        if(MSD_EP_OUT_LAST_PPB == ODD) Flash_EraseWriteBlock((uint24_t)(addr + g_msd_byte_of_sect), g_msd_ep_out_odd);
-        else Flash_EraseWriteBlock((uint24_t)(addr + g_msd_byte_of_sect), g_msd_ep_out_even);
+        if(MSD_EP_OUT_LAST_PPB == ODD) Flash_UpdateBlocks((uint24_t)(addr + g_msd_byte_of_sect), (uint24_t)(addr + g_msd_byte_of_sect + 64), g_msd_ep_out_odd);
+        else Flash_UpdateBlocks((uint24_t)(addr + g_msd_byte_of_sect), (uint24_t)(addr + g_msd_byte_of_sect + 64), g_msd_ep_out_even);
         #else
-        for(uint16_t i = 0; i < 512; i += _FLASH_ERASE_SIZE, addr += _FLASH_ERASE_SIZE) Flash_EraseWriteBlock((uint24_t)addr, g_msd_sect_data + i);
+        Flash_UpdateBlocks((uint24_t)addr, (uint24_t)(addr + 512), g_msd_sect_data);
         #endif
         #endif
 
         #else
-        #if defined(_PIC14E)
+        #if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+        packed_write((uint16_t)(addr + PACKET_WORDS(g_msd_byte_of_sect)), g_msd_byte_of_sect == 0, g_msd_ep_out);
+        
+        #elif defined(_PIC14E)
         for(i = 0, x = 0; i < 64; i += 2, x++)
         {
             buffer[i] = g_msd_ep_out[x];
             buffer[i + 1] = 0xFF;
         }
-        Flash_EraseWriteBlock((uint24_t)(addr + g_msd_byte_of_sect), buffer);
+        Flash_UpdateBlocks((uint24_t)(addr + g_msd_byte_of_sect), (uint24_t)(addr + g_msd_byte_of_sect + 32), buffer);
         for(i = 0, x = 32; i < 64; i += 2, x++)
         {
             buffer[i] = g_msd_ep_out[x];
             buffer[i + 1] = 0xFF;
         }
-        Flash_EraseWriteBlock((uint24_t)(addr + 32 + g_msd_byte_of_sect), buffer);
+        Flash_UpdateBlocks((uint24_t)(addr + 32 + g_msd_byte_of_sect), (uint24_t)(addr + 64 + g_msd_byte_of_sect), buffer);
         
         #elif defined(__J_PART)
         #ifdef MSD_LIMITED_RAM
@@ -800,16 +866,132 @@ void msd_tx_sector(void)
         
         #else
         #ifdef MSD_LIMITED_RAM
-        Flash_EraseWriteBlock((uint24_t)(addr + g_msd_byte_of_sect), g_msd_ep_out);
+        Flash_UpdateBlocks((uint24_t)(addr + g_msd_byte_of_sect), (uint24_t)(addr + g_msd_byte_of_sect + 64), g_msd_ep_out);
         #else
-        for(uint16_t i = 0; i < 512; i += _FLASH_ERASE_SIZE, addr += _FLASH_ERASE_SIZE) Flash_EraseWriteBlock((uint24_t)addr, g_msd_sect_data + i);
+        Flash_UpdateBlocks((uint24_t)addr, (uint24_t)(addr + 512), g_msd_sect_data);
         #endif
         #endif
         #endif
     }
 }
 
+#ifdef MSD_WRITE_CACHE
+void msd_commit_sector(uint32_t lba, uint8_t* p_sect_data)
+{
+    uint32_t addr;
+    addr = LBA_to_flash_addr(lba); // Convert from LBA address space to flash address space.
+    if(addr < END_OF_FLASH) // If address is in flash space.
+    {
+        #if defined(__J_PART)
+        for(uint16_t i = 0; i < 512; i += 64, addr += 64) Flash_WriteBlock((uint24_t)addr, p_sect_data + i);
+        #else
+        Flash_UpdateBlocks((uint24_t)addr, (uint24_t)(addr + 512), p_sect_data);
+        #endif
+    }
+}
+#endif
+
 static uint32_t LBA_to_flash_addr(uint32_t LBA)
 {
+    #if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+    return (LBA * SECTOR_WORDS) + FLASH_SPACE_START;
+    #else
     return (LBA * BYTES_PER_BLOCK_LE) + FLASH_SPACE_START;
-}
\ No newline at end of file
+    #endif
+}
+#if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+static void pack_group(const uint8_t *p_src, uint8_t *p_words)
+{
+    p_words[0] = p_src[0];
+    p_words[1] = p_src[5] & 0x3F;
+    p_words[2] = p_src[1];
+    p_words[3] = (uint8_t)((p_src[5] >> 6) | ((p_src[6] & 0x0F) << 2));
+    p_words[4] = p_src[2];
+    p_words[5] = (uint8_t)((p_src[6] >> 4) | ((p_src[7] & 0x03) << 4));
+    p_words[6] = p_src[3];
+    p_words[7] = p_src[7] >> 2;
+    p_words[8] = p_src[4];
+    p_words[9] = 0x3F; // Spare bits, left erased.
+}
+
+static void unpack_group(const uint8_t *p_words, uint8_t *p_dst)
+{
+    p_dst[0] = p_words[0];
+    p_dst[1] = p_words[2];
+    p_dst[2] = p_words[4];
+    p_dst[3] = p_words[6];
+    p_dst[4] = p_words[8];
+    p_dst[5] = (uint8_t)((p_words[1] & 0x3F) | (p_words[3] << 6));
+    p_dst[6] = (uint8_t)(((p_words[3] & 0x3F) >> 2) | (p_words[5] << 4));
+    p_dst[7] = (uint8_t)(((p_words[5] & 0x3F) >> 4) | (p_words[7] << 2));
+}
+
+// One EP packet, 64 bytes from the 40 words at addr.
+static void packed_read(uint16_t addr, uint8_t *p_dst)
+{
+    uint8_t words[PACKED_GROUP_WORDS * 2];
+    
+    for(uint8_t i = 0; i < MSD_EP_SIZE; i += PACKED_GROUP_BYTES, addr += PACKED_GROUP_WORDS, p_dst += PACKED_GROUP_BYTES)
+    {
+        Flash_ReadBytes(addr, sizeof(words), words);
+        unpack_group(words, p_dst);
+    }
+}
+
+// One EP packet to the 40 words at addr. 40 words don't line up with the 32 
+// word erase rows, so the row being filled is kept in m_row across packets and
+// only whole rows are written. Every sector starts on a row, and WRITE_10 
+// sends all of a sector's packets in order.
+static void packed_write(uint16_t addr, bool sector_start, const uint8_t *p_src)
+{
+    uint8_t words[PACKED_GROUP_WORDS * 2];
+    
+    if(sector_start)
+    {
+        m_row_addr  = addr;
+        m_row_words = 0;
+    }
+    for(uint8_t i = 0; i < MSD_EP_SIZE; i += PACKED_GROUP_BYTES, p_src += PACKED_GROUP_BYTES)
+    {
+        pack_group(p_src, words);
+        for(uint8_t x = 0; x < sizeof(words); x += 2)
+        {
+            m_row[m_row_words << 1]       = words[x];
+            m_row[(m_row_words << 1) + 1] = words[x + 1];
+            if(++m_row_words == _FLASH_ERASE_SIZE)
+            {
+                Flash_UpdateBlocks(m_row_addr, m_row_addr + _FLASH_ERASE_SIZE, m_row);
+                m_row_addr += _FLASH_ERASE_SIZE;
+                m_row_words = 0;
+            }
+        }
+    }
+}
+
+// The boot sector, FAT and root directory the other parts get from the
+// compiler, written packed when sector 0 doesn't end in the signature word.
+static void format_volume(void)
+{
+    uint8_t  packet[MSD_EP_SIZE];
+    uint16_t addr = FLASH_SPACE_START;
+    
+    packed_read(FLASH_SPACE_START + PACKET_WORDS(BYTES_PER_BLOCK_LE - MSD_EP_SIZE), packet);
+    if(packet[MSD_EP_SIZE - 2] == signature_word[0] && packet[MSD_EP_SIZE - 1] == signature_word[1]) return;
+    
+    for(uint8_t lba = 0; lba < 3; lba++)
+    {
+        for(uint16_t byte = 0; byte < BYTES_PER_BLOCK_LE; byte += MSD_EP_SIZE, addr += PACKET_WORDS(MSD_EP_SIZE))
+        {
+            usb_ram_set(0, packet, MSD_EP_SIZE);
+            if(byte == 0)
+            {
+                if(lba == 0) usb_rom_copy((const uint8_t*)&boot16, packet, sizeof(boot16));
+                else if(lba == 1) usb_rom_copy(fat12_default, packet, FAT_DEFAULT_SIZE);
+                else usb_rom_copy((const uint8_t*)&dir_entry, packet, sizeof(dir_entry));
+            }
+            else if(lba == 0 && byte == BYTES_PER_BLOCK_LE - MSD_EP_SIZE) usb_rom_copy(signature_word, &packet[MSD_EP_SIZE - 2], SIGNATURE_WORD_SIZE);
+            packed_write(addr, byte == 0, packet);
+        }
+    }
+}
+#endif
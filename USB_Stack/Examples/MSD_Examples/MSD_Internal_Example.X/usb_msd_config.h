@@ -43,6 +43,7 @@
 //#define USE_TEST_UNIT_READY
 //#define USE_START_STOP_UNIT
 //#define USE_READ_CAPACITY   // if not defined use the constant defines for capacity below. 
+//#define USE_RW_12_16        // READ_12/16, WRITE_12/16 (with USE_WRITE_10) and READ_CAPACITY_16.
 
 // CAPACITY
 #if defined(__J_PART)
@@ -53,6 +54,13 @@
 #define BYTES_PER_BLOCK_BE 0x00020000UL // Big-endian version
 #endif
 #if defined(_PIC14E)
+//#define MSD_PACKED_FLASH // PIC16F145X: 8 bytes in every 5 flash words (using the high 6 bits)
+                         // instead of one byte per word. The volume is formatted on the 
+                         // first boot, as the compiler can only place one byte per word.
+#endif
+#if defined(_PIC14E) && defined(MSD_PACKED_FLASH)
+#define VOL_CAPACITY_IN_BYTES  0x1800UL // 6KB, 12 sectors of 320 words.
+#elif defined(_PIC14E)
 #define VOL_CAPACITY_IN_BYTES  0x1000UL // 4KB
 #elif defined(__J_PART)
 #define VOL_CAPACITY_IN_BYTES (_ROMSIZE - 0x2000 - 0x3F8) // Don't include last block.
@@ -61,7 +69,6 @@
 #endif
 #define VOL_CAPACITY_IN_BLOCKS (VOL_CAPACITY_IN_BYTES / BYTES_PER_BLOCK_LE)
 #define LAST_BLOCK_LE (VOL_CAPACITY_IN_BLOCKS - 1)
-#define LAST_BLOCK_BE (LAST_BLOCK_LE << 24) // This conversion method is fine unless number of blocks is greater than 255.
 
 // MSD Endpoint HAL
 #define MSD_EP EP1
@@ -90,4 +97,46 @@ Use R_W_10_Vars.LBA in combination with g_msd_byte_of_sect to find locations in
                         // of Sector locations using g_msd_rw_10_vars.LBA in combination 
                         // with g_msd_byte_of_sect.
 
+//#define MSD_READ_PREFETCH // Double buffers sectors during READ_10. The next sector is
+                          // fetched with msd_rx_sector_async() while the current one 
+                          // is sent, hiding slow media access. Needs an extra 512 bytes 
+                          // of RAM and MSD_LIMITED_RAM to be undefined.
+
+//#define MSD_WRITE_CACHE // Write behind cache for WRITE_10. Sectors are buffered in RAM
+                        // and the CSW is returned straight away, msd_flush_tasks() then 
+                        // commits them with msd_commit_sector(). Needs an extra 512 bytes 
+                        // of RAM, USE_WRITE_10 and MSD_LIMITED_RAM to be undefined.
+
+//#define MSD_DIRECT_WRITE // WRITE_10 packets are received straight into g_msd_sect_data by
+                         // re-pointing the OUT BD, instead of copying from the Endpoint. 
+                         // Needs g_msd_sect_data in SIE reachable RAM (falls back to 
+                         // copying if not), USE_WRITE_10, MSD_LIMITED_RAM and 
+                         // MSD_WRITE_CACHE undefined, and no ping-pong on MSD's Endpoints.
+
+//#define MSD_ASYNC_MEDIA // msd_rx_sector() and msd_tx_sector() may return MSD_MEDIA_PENDING
+                        // and finish later, calling msd_media_complete(). MSD's Endpoints
+                        // are left unarmed meanwhile (the host is NAKed), so EP0 and other
+                        // interfaces keep running during slow erases. Needs MSD_LIMITED_RAM,
+                        // MSD_READ_PREFETCH and MSD_WRITE_CACHE undefined.
+
+//#define MSD_ARENA // g_msd_sect_data, and the MSD_READ_PREFETCH and MSD_WRITE_CACHE buffers,
+                  // are the msd state of g_usb_arena (see usb.h), so RAM can be shared 
+                  // with states that never run alongside MSD, e.g. another configuration. 
+                  // Flush the write cache before leaving the state. Needs USE_ARENA, 
+                  // X(msd, 512) in USB_ARENA_STATES (512 more per extra buffer), and 
+                  // MSD_LIMITED_RAM undefined.
+
+//#define MSD_IMAGE_CRC // Keeps a CRC-32 of the sectors WRITE_10 receives and of the ones
+                      // VERIFY_10 reads back, for the vendor MSD_IMAGE_CRC_CMD (0xC0).
+                      // A flashing tool can then check an image with VERIFY_10 instead 
+                      // of reading it over USB. Uses 1KB of ROM for the CRC table,
+                      // the verify CRC needs USE_VERIFY_10.
+
+//#define MSD_MOUNT_STATS // Frames from the first CBW to the first READ, the commands failed 
+                        // meanwhile and the first unsupported opcodes, read with msd_get_mount_stats().
+
+//#define MSD_TASK_QUEUE_SIZE 8 // Endpoint transactions msd_add_task() can queue for msd_tasks(),
+                              // a power of two (default 4). Raise it if g_msd_task_overflows
+                              // counts, e.g. when the main loop is slow to call msd_tasks().
+
 #endif
\ No newline at end of file
@@ -0,0 +1,499 @@
+/**
+ * @file log_vol.c
+ * @brief Circular log on the NOR flash, shown as a one file FAT volume.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD NOR Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb.h"
+#include "nor_spi.h"
+#include "log_vol.h"
+
+/* ************************************************************************** */
+/* ****************************** LOG LAYOUT ******************************** */
+/* ************************************************************************** */
+
+/*
+ * UNIT: MARKER (4) | SEQUENCE (4, little endian) | RECORDS (4088)
+ *
+ * Units are entered in ring order and each gets the next sequence number, so
+ * the newest unit is the one with the highest, and the log runs back from it
+ * for as long as the sequence numbers count down by one.
+ */
+#define HEADER_SIZE 8
+#define UNIT_DATA   (NOR_UNIT_SIZE - HEADER_SIZE)
+#define MAX_UNITS   4096UL // 16 MB flash, 3 byte addressing.
+#define SCAN_CHUNK  32   // Bytes read at a time looking for the end of the log.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** VOLUME LAYOUT ******************************* */
+/* ************************************************************************** */
+
+/*
+ * BOOT SECT | FAT | ROOT DIR | DATA
+ *
+ * Same layout as the VFAT Example, FAT16 only. LOG.BIN's clusters start at 2
+ * and are contiguous.
+ */
+#define BLOCK_SIZE     512
+#define DIR_ENTRY_SIZE 32
+#define CLUSTER_BYTES  ((uint32_t)LOG_VOL_SECTS_PER_CLUSTER * BLOCK_SIZE)
+#define ROOT_ENTRIES   16 // Volume label and LOG.BIN, the rest are unused.
+
+#define ROOT_SECTS ((ROOT_ENTRIES * DIR_ENTRY_SIZE + (BLOCK_SIZE - 1)) / BLOCK_SIZE)
+#define ROUGH_DATA (LOG_VOL_BLOCKS - 1 - ROOT_SECTS) // FAT and data sectors.
+#define ROUGH_CLUS (ROUGH_DATA / LOG_VOL_SECTS_PER_CLUSTER)
+#define FAT_SECTS  ((((ROUGH_CLUS + 2) * 2) + (BLOCK_SIZE - 1)) / BLOCK_SIZE)
+#define CLUSTERS   ((ROUGH_DATA - FAT_SECTS) / LOG_VOL_SECTS_PER_CLUSTER)
+
+#if CLUSTERS < 4085
+#error "LOG VOL: Too few clusters for FAT16, make LOG_VOL_BLOCKS bigger or LOG_VOL_SECTS_PER_CLUSTER smaller."
+#elif CLUSTERS > 65524
+#error "LOG VOL: Too many clusters for FAT16, make LOG_VOL_SECTS_PER_CLUSTER bigger."
+#elif CLUSTERS < ((MAX_UNITS * UNIT_DATA) + (LOG_VOL_SECTS_PER_CLUSTER * BLOCK_SIZE) - 1) / (LOG_VOL_SECTS_PER_CLUSTER * BLOCK_SIZE)
+#error "LOG VOL: The volume can't hold the log of a 16 MB flash, make LOG_VOL_BLOCKS bigger."
+#endif
+
+#define FAT_START  1
+#define ROOT_START (FAT_START + FAT_SECTS)
+#define DATA_START (ROOT_START + ROOT_SECTS)
+
+#define FAT_MEDIA 0xFFF8
+#define FAT_EOC   0xFFFF // End of chain.
+
+#define ATTR_READ_ONLY 0x01
+#define ATTR_VOLUME_ID 0x08
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** BOOT SECTOR ******************************** */
+/* ************************************************************************** */
+
+/** Boot Sector */
+typedef struct
+{
+    uint8_t  jmpBoot[3];
+    uint8_t  OEMName[8];
+    uint16_t BytesPerSec;
+    uint8_t  SecPerClus;
+    uint16_t RsvdSecCnt;
+    uint8_t  NumFATs;
+    uint16_t RootEntCnt;
+    uint16_t TotSec16;
+    uint8_t  Media;
+    uint16_t FATSz16;
+    uint16_t SecPerTrk;
+    uint16_t NumHeads;
+    uint32_t HiddSec;
+    uint32_t TotSec32;
+    uint8_t  DrvNum;
+    uint8_t  Reserved1;
+    uint8_t  BootSig;
+    uint8_t  VolID[4];
+    uint8_t  VolLab[11];
+    uint8_t  FilSysType[8];
+}BOOT_t;
+
+static const BOOT_t m_boot =
+{
+    {0xEB,0x3C,0x90},
+    {'M','S','D','O','S','5','.','0'},
+    BLOCK_SIZE,
+    LOG_VOL_SECTS_PER_CLUSTER,
+    FAT_START,
+    1,
+    ROOT_ENTRIES,
+    (LOG_VOL_BLOCKS < 0x10000UL) ? (uint16_t)LOG_VOL_BLOCKS : 0,
+    0xF8,
+    FAT_SECTS,
+    1,
+    1,
+    0,
+    (LOG_VOL_BLOCKS < 0x10000UL) ? 0 : LOG_VOL_BLOCKS,
+    0x80,
+    0,
+    0x29,
+    {0x4C,0x4F,0x47,0x56},
+    LOG_VOL_LABEL,
+    {'F','A','T','1','6',' ',' ',' '}
+};
+
+/** Directory Entry Structure */
+typedef struct
+{
+    uint8_t  Name[11];
+    uint8_t  Attr;
+    uint8_t  NTRes;
+    uint8_t  CrtTimeTenth;
+    uint16_t CrtTime;
+    uint16_t CrtDate;
+    uint16_t LstAccDate;
+    uint16_t FstClusHI;
+    uint16_t WrtTime;
+    uint16_t WrtDate;
+    uint16_t FstClusLO;
+    uint32_t FileSize;
+}DIR_ENTRY_t;
+
+static const uint8_t m_label[11] = LOG_VOL_LABEL;
+static const uint8_t m_name[11]  = {'L','O','G',' ',' ',' ',' ',' ','B','I','N'};
+static const uint8_t m_marker[4] = {'L','O','G','1'};
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static bool     m_ready;
+static uint16_t m_units;     // Erase units in the ring.
+static uint16_t m_head_unit; // Unit records are being added to.
+static uint32_t m_head_seq;
+static uint16_t m_head_pos;  // Record bytes in the head unit.
+static uint16_t m_tail_unit; // Oldest unit.
+static uint32_t m_tail_seq;
+
+// LOG.BIN as fixed by log_vol_mount().
+static uint16_t m_file_unit;
+static uint32_t m_file_seq;
+static uint32_t m_file_size;
+static uint16_t m_file_last_clus; // 0 for an empty file.
+
+// Place in LOG.BIN the last read stopped, the host reads the file in order.
+static uint32_t m_next_pos;
+static uint16_t m_next_unit;
+static uint32_t m_next_seq;
+static uint16_t m_next_byte;
+
+static uint8_t  m_buf[SCAN_CHUNK];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** LOCAL FUNCTION DECLARATIONS ********************** */
+/* ************************************************************************** */
+
+static bool     read_header(uint16_t unit, uint32_t *p_seq);
+static uint16_t find_end(uint16_t unit);
+static void     next_unit(void);
+static uint16_t ring_add(uint16_t unit, uint16_t count);
+static uint32_t unit_addr(uint16_t unit);
+static uint16_t fat_entry(uint16_t clus);
+static void     read_boot(uint16_t offset, uint8_t *p_data, uint16_t len);
+static void     read_fat(uint32_t byte, uint8_t *p_data, uint16_t len);
+static void     read_root(uint16_t entry, uint8_t *p_data, uint16_t len);
+static void     read_file(uint32_t pos, uint8_t *p_data, uint16_t len);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+bool log_init(void)
+{
+    uint32_t seq;
+    uint16_t unit, prev;
+    bool     found = false;
+
+    m_ready = false;
+    m_units = (uint16_t)(g_nor_block_count / NOR_BLOCKS_PER_UNIT);
+    if(m_units < 2) return false;
+
+    for(unit = 0; unit < m_units; unit++)
+    {
+        if(!read_header(unit, &seq)) continue;
+        if(!found || seq > m_head_seq)
+        {
+            m_head_unit = unit;
+            m_head_seq  = seq;
+            found       = true;
+        }
+    }
+
+    if(found)
+    {
+        m_tail_unit = m_head_unit;
+        m_tail_seq  = m_head_seq;
+        for(unit = 1; unit < m_units && m_tail_seq; unit++)
+        {
+            prev = ring_add(m_tail_unit, m_units - 1);
+            if(!read_header(prev, &seq) || seq != m_tail_seq - 1) break; // Older units were erased, or are left over.
+            m_tail_unit = prev;
+            m_tail_seq  = seq;
+        }
+        m_head_pos = find_end(m_head_unit);
+    }
+    else
+    {
+        // Start the log in the last unit, so next_unit() opens unit 0 as sequence 0.
+        m_head_unit = m_units - 1;
+        m_head_seq  = 0xFFFFFFFF;
+        m_tail_unit = 0;
+        m_tail_seq  = 0;
+        next_unit();
+    }
+
+    m_ready = true;
+    log_vol_mount();
+    return true;
+}
+
+bool log_append(const uint8_t *p_data, uint16_t len)
+{
+    uint16_t chunk;
+
+    if(!m_ready) return false;
+
+    while(len)
+    {
+        if(m_head_pos == UNIT_DATA) next_unit();
+        chunk = UNIT_DATA - m_head_pos;
+        if(chunk > len) chunk = len;
+
+        nor_program_raw(unit_addr(m_head_unit) + HEADER_SIZE + m_head_pos, p_data, chunk);
+        m_head_pos += chunk;
+        p_data     += chunk;
+        len        -= chunk;
+    }
+    return true;
+}
+
+uint32_t log_size(void)
+{
+    if(!m_ready) return 0;
+    return ((m_head_seq - m_tail_seq) * UNIT_DATA) + m_head_pos;
+}
+
+void log_vol_mount(void)
+{
+    m_file_unit      = m_tail_unit;
+    m_file_seq       = m_tail_seq;
+    m_file_size      = log_size();
+    m_file_last_clus = (uint16_t)((m_file_size + (CLUSTER_BYTES - 1)) / CLUSTER_BYTES);
+    if(m_file_last_clus) m_file_last_clus++; // Clusters are numbered from 2.
+
+    m_next_pos  = 0;
+    m_next_unit = m_file_unit;
+    m_next_seq  = m_file_seq;
+    m_next_byte = 0;
+}
+
+void log_vol_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    usb_ram_set(0, p_data, len);
+    if(!m_ready || lba >= LOG_VOL_BLOCKS) return;
+
+    if(lba >= DATA_START) read_file(((lba - DATA_START) * BLOCK_SIZE) + offset, p_data, len);
+    else if(lba == 0) read_boot(offset, p_data, len);
+    else if(lba < ROOT_START) read_fat(((lba - FAT_START) * BLOCK_SIZE) + offset, p_data, len);
+    else read_root((uint16_t)((lba - ROOT_START) * (BLOCK_SIZE / DIR_ENTRY_SIZE)) + (offset / DIR_ENTRY_SIZE), p_data, len);
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+static bool read_header(uint16_t unit, uint32_t *p_seq)
+{
+    uint8_t i;
+
+    nor_read_raw(unit_addr(unit), m_buf, HEADER_SIZE);
+    for(i = 0; i < sizeof(m_marker); i++) if(m_buf[i] != m_marker[i]) return false;
+    *p_seq = ((uint32_t)m_buf[7] << 24) | ((uint32_t)m_buf[6] << 16) | ((uint16_t)m_buf[5] << 8) | m_buf[4];
+    return true;
+}
+
+/*
+ * Record bytes in unit, found by looking back from its end for the last byte
+ * that's been programmed.
+ */
+static uint16_t find_end(uint16_t unit)
+{
+    uint16_t pos = UNIT_DATA;
+    uint8_t  chunk, i;
+
+    while(pos)
+    {
+        chunk = (pos > SCAN_CHUNK) ? SCAN_CHUNK : (uint8_t)pos;
+        pos  -= chunk;
+        nor_read_raw(unit_addr(unit) + HEADER_SIZE + pos, m_buf, chunk);
+        for(i = chunk; i; i--) if(m_buf[i - 1] != 0xFF) return pos + i;
+    }
+    return 0;
+}
+
+/*
+ * Moves the head into the next unit of the ring, dropping the oldest unit if
+ * the ring is full.
+ */
+static void next_unit(void)
+{
+    uint16_t unit = ring_add(m_head_unit, 1);
+    uint8_t  i;
+
+    if(unit == m_tail_unit && m_head_seq != 0xFFFFFFFF)
+    {
+        m_tail_unit = ring_add(m_tail_unit, 1);
+        m_tail_seq++;
+    }
+    m_head_unit = unit;
+    m_head_seq++;
+    m_head_pos = 0;
+
+    nor_erase_raw(unit);
+    for(i = 0; i < sizeof(m_marker); i++) m_buf[i] = m_marker[i];
+    m_buf[4] = (uint8_t)m_head_seq;
+    m_buf[5] = (uint8_t)(m_head_seq >> 8);
+    m_buf[6] = (uint8_t)(m_head_seq >> 16);
+    m_buf[7] = (uint8_t)(m_head_seq >> 24);
+    nor_program_raw(unit_addr(unit), m_buf, HEADER_SIZE);
+}
+
+static uint16_t ring_add(uint16_t unit, uint16_t count)
+{
+    uint32_t sum = (uint32_t)unit + count;
+
+    if(sum >= m_units) sum -= m_units;
+    return (uint16_t)sum;
+}
+
+static uint32_t unit_addr(uint16_t unit)
+{
+    return (uint32_t)unit * NOR_UNIT_SIZE;
+}
+
+static uint16_t fat_entry(uint16_t clus)
+{
+    if(clus == 0) return FAT_MEDIA;
+    if(clus == 1) return FAT_EOC;
+    if(clus > m_file_last_clus) return 0; // Free.
+    if(clus == m_file_last_clus) return FAT_EOC;
+    return clus + 1;
+}
+
+static void read_boot(uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    for(; len; len--, offset++, p_data++)
+    {
+        if(offset < sizeof(m_boot)) *p_data = ((const uint8_t*)&m_boot)[offset];
+        else if(offset == 510) *p_data = 0x55;
+        else if(offset == 511) *p_data = 0xAA;
+    }
+}
+
+static void read_fat(uint32_t byte, uint8_t *p_data, uint16_t len)
+{
+    uint16_t clus = (uint16_t)(byte >> 1);
+    uint16_t entry;
+
+    for(; len >= 2; len -= 2)
+    {
+        entry = fat_entry(clus++);
+        *p_data++ = (uint8_t)entry;
+        *p_data++ = (uint8_t)(entry >> 8);
+    }
+}
+
+static void read_root(uint16_t entry, uint8_t *p_data, uint16_t len)
+{
+    DIR_ENTRY_t *p_entry;
+    uint8_t i;
+
+    for(; len >= DIR_ENTRY_SIZE && entry < 2; len -= DIR_ENTRY_SIZE, p_data += DIR_ENTRY_SIZE, entry++)
+    {
+        p_entry = (DIR_ENTRY_t*)p_data;
+        if(entry == 0)
+        {
+            for(i = 0; i < 11; i++) p_entry->Name[i] = m_label[i];
+            p_entry->Attr = ATTR_VOLUME_ID;
+        }
+        else
+        {
+            for(i = 0; i < 11; i++) p_entry->Name[i] = m_name[i];
+            p_entry->Attr       = ATTR_READ_ONLY;
+            p_entry->CrtTime    = LOG_VOL_TIME;
+            p_entry->CrtDate    = LOG_VOL_DATE;
+            p_entry->LstAccDate = LOG_VOL_DATE;
+            if(m_file_last_clus) p_entry->FstClusLO = 2;
+            p_entry->FileSize   = m_file_size;
+        }
+        p_entry->WrtTime = LOG_VOL_TIME;
+        p_entry->WrtDate = LOG_VOL_DATE;
+    }
+}
+
+/*
+ * Reads LOG.BIN from pos, already zeroed past its end. Only a read that
+ * doesn't carry on from the last one needs the divide to find its unit.
+ */
+static void read_file(uint32_t pos, uint8_t *p_data, uint16_t len)
+{
+    uint32_t n;
+    uint16_t chunk;
+
+    if(pos >= m_file_size) return;
+    if(m_file_size - pos < len) len = (uint16_t)(m_file_size - pos);
+
+    if(pos != m_next_pos)
+    {
+        n           = pos / UNIT_DATA;
+        m_next_unit = ring_add(m_file_unit, (uint16_t)n);
+        m_next_seq  = m_file_seq + n;
+        m_next_byte = (uint16_t)(pos - (n * UNIT_DATA));
+    }
+    m_next_pos = pos + len;
+
+    while(len)
+    {
+        chunk = UNIT_DATA - m_next_byte;
+        if(chunk > len) chunk = len;
+
+        if(m_next_seq >= m_tail_seq) nor_read_raw(unit_addr(m_next_unit) + HEADER_SIZE + m_next_byte, p_data, chunk); // Else written over since the mount, left as zeros.
+        p_data      += chunk;
+        len         -= chunk;
+        m_next_byte += chunk;
+        if(m_next_byte == UNIT_DATA)
+        {
+            m_next_unit = ring_add(m_next_unit, 1);
+            m_next_seq++;
+            m_next_byte = 0;
+        }
+    }
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,142 @@
+/**
+ * @file log_vol.h
+ * @brief Circular log on the NOR flash, shown as a one file FAT volume.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD NOR Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LOG_VOL_H
+#define LOG_VOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* *************************** LOG VOL SETTINGS ***************************** */
+/* ************************************************************************** */
+
+/*
+ * The flash is used as a ring of 4KB erase units. Each unit starts with an 8
+ * byte header (a marker and a sequence number), so the log is found again
+ * after a reset, and log_append() page programs records straight in after it.
+ * Entering a unit erases it, once the ring is full that drops the oldest unit.
+ * 
+ * Nothing of the FAT volume is stored. The boot sector, a FAT with one chain
+ * and a root directory holding LOG.BIN are worked out as the host reads them,
+ * and LOG.BIN's data is read out of the ring, oldest record first. The volume
+ * is FAT16 and always large enough for the log of a 16 MB flash.
+ */
+#define LOG_VOL_BLOCKS            65536UL // 32 MB volume, 512 byte blocks.
+#define LOG_VOL_SECTS_PER_CLUSTER 8       // 4KB clusters, a power of 2.
+
+#define LOG_VOL_LABEL {'L','O','G',' ',' ',' ',' ',' ',' ',' ',' '}
+#define LOG_VOL_DATE  0x596E // 2024-11-14, ((Year - 1980) << 9) | (Month << 5) | Day.
+#define LOG_VOL_TIME  0x6000 // 12:00:00, (Hours << 11) | (Minutes << 5) | (Seconds / 2).
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOG VOL GLOBAL FUNCTIONS ************************ */
+/* ************************************************************************** */
+
+/**
+ * @fn bool log_init(void)
+ * 
+ * @brief Finds the log on the flash, carrying on from its last record.
+ * 
+ * Call it after nor_init() and before usb_init(). A flash without a log
+ * starts an empty one. The end of the log is the last byte of the newest unit
+ * that isn't 0xFF, so 0xFF bytes at the very end of the log are lost over a
+ * reset.
+ * 
+ * @return Returns false if the flash can't be used.
+ */
+bool log_init(void);
+
+/**
+ * @fn bool log_append(const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Adds a record to the end of the log.
+ * 
+ * Runs at page program speed, with a 4KB erase each time the log moves into
+ * the next unit. Call it from the same loop as msd_tasks(), both use the SPI.
+ * 
+ * <b>Code Example:</b>
+ * <code>
+ * log_append(record, sizeof(record));
+ * </code>
+ * 
+ * @param[in] p_data Record.
+ * @param[in] len Size of the record in bytes.
+ * 
+ * @return Returns false if the flash can't be used.
+ */
+bool log_append(const uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn uint32_t log_size(void)
+ * 
+ * @brief Size of the log in bytes, records added since log_vol_mount() included.
+ * 
+ * @return Returns the size of the log.
+ */
+uint32_t log_size(void);
+
+/**
+ * @fn void log_vol_mount(void)
+ * 
+ * @brief Fixes the volume's LOG.BIN to the log as it is now.
+ * 
+ * The host reads the FAT and directory once when it mounts the volume, so the
+ * file's size and chain it sees can't move after that. Call it whenever the
+ * device is configured, records added later show up at the next mount. If
+ * the log wraps over records of the fixed file before the host reads them,
+ * they're read as zeros.
+ */
+void log_vol_mount(void);
+
+/**
+ * @fn void log_vol_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads part of a block of the volume.
+ * 
+ * offset and len need to be multiples of 32 (a directory entry), which the
+ * MSD library's EP sized and full sector reads are.
+ * 
+ * <b>Code Example:</b>
+ * <code>
+ * log_vol_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE); // MSD_LIMITED_RAM.
+ * </code>
+ * 
+ * @param[in] lba Block being read.
+ * @param[in] offset Byte of the block to start at.
+ * @param[out] p_data Buffer the data is read into.
+ * @param[in] len Amount of bytes to read.
+ */
+void log_vol_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len);
+
+/* ************************************************************************** */
+
+#endif /* LOG_VOL_H */
@@ -0,0 +1,344 @@
+/**
+ * @file main.c
+ * @brief Main C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD NOR Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include "fuses.h"
+#include "config.h"
+#include "usb.h"
+#include "usb_msd.h"
+#include "nor_spi.h"
+#ifdef MSD_LOG
+#include "log_vol.h"
+#endif
+
+/*
+ * The flash is the volume, written by the host through nor_write().
+ * 
+ * With MSD_LOG it's a circular log instead, and the volume is made up from it
+ * (see log_vol.h). Here a line with the seconds since power up in hex is added
+ * every second from Timer1, the host finds the lines in LOG.BIN, oldest first.
+ */
+
+#ifdef MSD_LOG
+#define VOLUME_READ log_vol_read
+#define TICKS_PER_SECOND 183 // Timer1 overflows, 65536 / 12MHz = 5.46ms each.
+#else
+#define VOLUME_READ nor_read
+#endif
+
+#if _HTC_EDITION_ == 0
+#error "Use optimization level 2 and above."
+#endif
+
+static void example_init(void);
+#ifdef USE_BOOT_LED
+static void flash_led(void);
+#endif
+static uint32_t blocks_left(void);
+#ifdef MSD_LOG
+static void log_tick(void);
+#endif
+static void __interrupt() isr(void);
+
+void main(void)
+{
+    example_init();
+    #ifdef USE_BOOT_LED
+    LED_OFF();
+    LED_OUPUT();
+    flash_led();
+    #endif
+    
+    nor_init();
+    #ifdef MSD_LOG
+    log_init();
+    TMR1 = 0;
+    PIR1bits.TMR1IF = 0;
+    T1CON = 0x01; // Fosc/4.
+    #endif
+    
+    usb_init();
+    #ifndef USE_POLLING
+    INTCONbits.PEIE = 1;
+    USB_INTERRUPT_FLAG = 0;
+    USB_INTERRUPT_ENABLE = 1;
+    INTCONbits.GIE = 1;
+    #endif
+    
+    while(usb_get_state() != STATE_CONFIGURED)
+    {
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+        #ifdef MSD_LOG
+        log_tick();
+        #endif
+    }
+    #ifdef MSD_LOG
+    log_vol_mount(); // Host sees the log as it is now.
+    #endif
+    while(1)
+    {
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+        msd_tasks();
+        #ifdef MSD_WRITE_CACHE
+        msd_flush_tasks();
+        #endif
+        #ifdef MSD_LOG
+        log_tick();
+        #endif
+    }
+}
+
+static void __interrupt() isr(void)
+{
+    if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
+    {
+        usb_tasks();
+        USB_INTERRUPT_FLAG = 0;
+    }
+}
+
+static void example_init(void)
+{
+    // Oscillator Settings.
+    // PIC16F145X.
+    #if defined(_PIC14E)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 0xF;
+    #endif
+    #if XTAL_USED != MHz_12
+    OSCCONbits.SPLLMULT = 1;
+    #endif
+    OSCCONbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18FX450, PIC18FX550, and PIC18FX455.
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F14K50.
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    OSCTUNEbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F2XK50.
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 7;
+    #endif
+    #if (XTAL_USED != MHz_12)
+    OSCTUNEbits.SPLLMULT = 1;
+    #endif
+    OSCCON2bits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18F2XJ53 and PIC18F4XJ53.
+    #elif defined(__J_PART)
+    OSCTUNEbits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #endif
+
+    
+    // Make boot pin digital.
+    #if defined(BUTTON_ANSEL) 
+    BUTTON_ANSEL &= ~(1<<BUTTON_ANSEL_BIT);
+    #elif defined(BUTTON_ANCON)
+    BUTTON_ANCON |= (1<<BUTTON_ANCON_BIT);
+    #endif
+
+
+    // Apply pull-up.
+    #ifdef BUTTON_WPU
+    #if defined(_PIC14E)
+    WPUA = 0;
+    #if defined(_16F1459)
+    WPUB = 0;
+    #endif
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    OPTION_REGbits.nWPUEN = 0;
+    
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    LATB = 0;
+    LATD = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    #if BUTTON_RXPU_REG == INTCON2
+    INTCON2 &= 7F;
+    #else
+    PORTE |= 80;
+    #endif
+    
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    WPUA = 0;
+    WPUB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRABPU = 0;
+    
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    WPUB = 0;
+    TRISE &= 0x7F;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRBPU = 0;
+    
+    #elif defined(_18F24J50) || defined(_18F25J50) || defined(_18F26J50) || defined(_18F26J53) || defined(_18F27J53)
+    LATB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    
+    #elif defined(_18F44J50) || defined(_18F45J50) || defined(_18F46J50) || defined(_18F46J53) || defined(_18F47J53)
+    LATB = 0;
+    LATD = 0;
+    LATE = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    #endif
+    #endif
+}
+
+#ifdef USE_BOOT_LED
+static void flash_led(void)
+{
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        LED_ON();
+        __delay_ms(500);
+        LED_OFF();
+        __delay_ms(500);
+    }
+}
+#endif
+
+#ifdef MSD_LOG
+/*
+ * Adds "SSSSSSSS\r\n" to the log once a second.
+ */
+static void log_tick(void)
+{
+    static uint8_t  ticks;
+    static uint32_t seconds;
+    uint8_t line[10];
+    uint8_t i, digit;
+    
+    if(!PIR1bits.TMR1IF) return;
+    PIR1bits.TMR1IF = 0;
+    if(++ticks != TICKS_PER_SECOND) return;
+    ticks = 0;
+    seconds++;
+    
+    for(i = 0; i < 8; i++)
+    {
+        digit = (uint8_t)(seconds >> (28 - (i * 4))) & 0xF;
+        line[i] = (digit < 10) ? (uint8_t)('0' + digit) : (uint8_t)('A' - 10 + digit);
+    }
+    line[8] = '\r';
+    line[9] = '\n';
+    log_append(line, sizeof(line));
+}
+#endif
+
+uint8_t msd_test_unit_ready(void)
+{
+    nor_flush(); // Host has gone idle, finish off the erase unit being written.
+    return 0;
+}
+
+uint8_t msd_start_stop_unit(void)
+{
+    nor_flush(); // Eject, or about to be powered down.
+    return 0;
+}
+
+/*
+ * Blocks the WRITE_10 still has to send, counting the current one. nor_write()
+ * uses it to skip saving the parts of an erase unit that are being replaced.
+ */
+static uint32_t blocks_left(void)
+{
+    #ifdef MSD_LIMITED_RAM
+    return g_msd_rw_10_vars.TF_LEN_IN_BYTES / BYTES_PER_BLOCK_LE; // Called at the start of each block.
+    #else
+    return ((g_msd_rw_10_vars.TF_LEN_IN_BYTES - MSD_EP_SIZE) / BYTES_PER_BLOCK_LE) + 1; // Called before the last packet is counted.
+    #endif
+}
+
+void msd_rx_sector(void)
+{
+    #ifdef MSD_LIMITED_RAM
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    if(MSD_EP_IN_LAST_PPB == ODD) VOLUME_READ(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in_odd, MSD_EP_SIZE);
+    else VOLUME_READ(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in_even, MSD_EP_SIZE);
+    #else
+    VOLUME_READ(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE);
+    #endif
+    #else
+    VOLUME_READ(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, BYTES_PER_BLOCK_LE);
+    #endif
+}
+
+#ifdef MSD_READ_PREFETCH
+void msd_rx_sector_async(uint32_t lba, uint8_t* p_sect_data)
+{
+    VOLUME_READ(lba, 0, p_sect_data, BYTES_PER_BLOCK_LE);
+    msd_rx_sector_complete();
+}
+#endif
+
+void msd_tx_sector(void)
+{
+    #ifdef MSD_LIMITED_RAM
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    if(MSD_EP_OUT_LAST_PPB == ODD) nor_write(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out_odd, MSD_EP_SIZE, blocks_left());
+    else nor_write(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out_even, MSD_EP_SIZE, blocks_left());
+    #else
+    nor_write(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out, MSD_EP_SIZE, blocks_left());
+    #endif
+    #else
+    nor_write(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, BYTES_PER_BLOCK_LE, blocks_left());
+    #endif
+}
+
+#ifdef MSD_WRITE_CACHE
+void msd_commit_sector(uint32_t lba, uint8_t* p_sect_data)
+{
+    nor_write(lba, 0, p_sect_data, BYTES_PER_BLOCK_LE, 1); // Transfer may have finished already, assume only this block.
+}
+#endif
@@ -0,0 +1,352 @@
+/**
+ * @file nor_spi.c
+ * @brief SPI NOR flash driver, with 4KB erase unit management.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD NOR Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "nor_spi.h"
+
+/* ************************************************************************** */
+/* **************************** NOR COMMANDS ******************************** */
+/* ************************************************************************** */
+
+#define CMD_PAGE_PROGRAM   0x02
+#define CMD_READ           0x03
+#define CMD_READ_STATUS    0x05
+#define CMD_WRITE_ENABLE   0x06
+#define CMD_SECTOR_ERASE   0x20 // 4KB
+#define CMD_JEDEC_ID       0x9F
+#define CMD_RELEASE_PD     0xAB // Release from Deep Power-down.
+
+#define STATUS_WIP 0x01 // Write In Progress.
+
+#define BUSY_TIMEOUT 0x7FFFF // Status reads, sector erase can take up to 400ms.
+#define COPY_CHUNK   64      // Bytes moved at a time when copying a block.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL VARS ******************************** */
+/* ************************************************************************** */
+
+uint32_t g_nor_block_count;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static bool     m_ready;
+static uint16_t m_unit_count; // Erase units in the volume, the scratch units follow them.
+static uint8_t  m_scratch;    // Scratch unit used next, always kept erased.
+static bool     m_open;       // An erase unit is being written.
+static uint16_t m_open_unit;
+static uint8_t  m_keep;       // Blocks of the open unit saved in the scratch unit, one bit each.
+static uint8_t  m_written;    // Blocks of the open unit written since it was opened.
+static uint8_t  m_copy_buf[COPY_CHUNK];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+static uint8_t  spi_xfer(uint8_t data);
+static void     command_addr(uint8_t cmd, uint32_t addr);
+static bool     wait_ready(void);
+static void     write_enable(void);
+static void     read(uint32_t addr, uint8_t *p_data, uint16_t len);
+static void     program(uint32_t addr, const uint8_t *p_data, uint16_t len);
+static void     erase_unit(uint16_t unit);
+static void     copy_block(uint16_t from_unit, uint16_t to_unit, uint8_t block);
+static bool     unit_looks_blank(uint16_t unit);
+static void     open_unit(uint16_t unit, uint8_t block, uint32_t blocks_left);
+static void     close_unit(void);
+static uint32_t block_addr(uint16_t unit, uint8_t block);
+
+/* ************************************************************************** */
+
+
+uint8_t nor_init(void)
+{
+    uint8_t manufacturer, capacity, i, next;
+    
+    m_ready           = false;
+    m_open            = false;
+    g_nor_block_count = 0;
+    
+    NOR_CS = 1;
+    NOR_PINS_INIT();
+    NOR_SPI_INIT();
+    
+    NOR_CS = 0;
+    spi_xfer(CMD_RELEASE_PD); // In case it was left in Deep Power-down.
+    NOR_CS = 1;
+    __delay_us(50);
+    
+    NOR_CS = 0;
+    spi_xfer(CMD_JEDEC_ID);
+    manufacturer = spi_xfer(0xFF);
+    spi_xfer(0xFF); // Memory type.
+    capacity     = spi_xfer(0xFF); // Size is 2^capacity bytes.
+    NOR_CS = 1;
+    
+    if(manufacturer == 0x00 || manufacturer == 0xFF) return NOR_ERR_NO_CHIP;
+    if(capacity < 17 || capacity > 24) return NOR_ERR_SIZE; // 128KB (room for the scratch units) to 16MB.
+    
+    m_unit_count      = (uint16_t)((1UL << capacity) / NOR_UNIT_SIZE) - NOR_SCRATCH_UNITS;
+    g_nor_block_count = (uint32_t)m_unit_count * NOR_BLOCKS_PER_UNIT;
+    
+    // Carry on the rotation after the last scratch unit used, it's followed by the erased one.
+    m_scratch = 0;
+    for(i = 0; i < NOR_SCRATCH_UNITS; i++)
+    {
+        next = (uint8_t)((i + 1) % NOR_SCRATCH_UNITS);
+        if(!unit_looks_blank(m_unit_count + i) && unit_looks_blank(m_unit_count + next))
+        {
+            m_scratch = next;
+            break;
+        }
+    }
+    erase_unit(m_unit_count + m_scratch); // A used unit can still look blank.
+    
+    m_ready = true;
+    return NOR_OK;
+}
+
+void nor_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    uint16_t unit, i;
+    uint8_t  block, bit;
+    
+    if(!m_ready)
+    {
+        for(i = 0; i < len; i++) p_data[i] = 0;
+        return;
+    }
+    
+    unit  = (uint16_t)(lba / NOR_BLOCKS_PER_UNIT);
+    block = (uint8_t)(lba % NOR_BLOCKS_PER_UNIT);
+    bit   = (uint8_t)(1 << block);
+    
+    if(m_open && unit == m_open_unit && (m_keep & bit) && !(m_written & bit)) unit = m_unit_count + m_scratch; // Only copy is in the scratch unit.
+    read(block_addr(unit, block) + offset, p_data, len);
+}
+
+void nor_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len, uint32_t blocks_left)
+{
+    uint16_t unit;
+    uint8_t  block, bit;
+    
+    if(!m_ready) return;
+    
+    unit  = (uint16_t)(lba / NOR_BLOCKS_PER_UNIT);
+    block = (uint8_t)(lba % NOR_BLOCKS_PER_UNIT);
+    
+    if(offset == 0)
+    {
+        bit = (uint8_t)(1 << block);
+        if(m_open && (unit != m_open_unit || (m_written & bit))) close_unit(); // Moved on, or the block has to be erased again.
+        if(!m_open) open_unit(unit, block, blocks_left);
+        m_written |= bit;
+    }
+    program(block_addr(unit, block) + offset, p_data, len);
+}
+
+void nor_flush(void)
+{
+    if(m_open) close_unit();
+}
+
+void nor_read_raw(uint32_t addr, uint8_t *p_data, uint16_t len)
+{
+    if(m_ready) read(addr, p_data, len);
+}
+
+void nor_program_raw(uint32_t addr, const uint8_t *p_data, uint16_t len)
+{
+    if(m_ready) program(addr, p_data, len);
+}
+
+void nor_erase_raw(uint16_t unit)
+{
+    if(m_ready && unit < m_unit_count) erase_unit(unit);
+}
+
+static uint8_t spi_xfer(uint8_t data)
+{
+    NOR_SSPBUF = data;
+    while(!NOR_SSPSTATbits.BF);
+    return NOR_SSPBUF;
+}
+
+static void command_addr(uint8_t cmd, uint32_t addr)
+{
+    NOR_CS = 0;
+    spi_xfer(cmd);
+    spi_xfer((uint8_t)(addr >> 16));
+    spi_xfer((uint8_t)(addr >> 8));
+    spi_xfer((uint8_t)addr);
+}
+
+static bool wait_ready(void)
+{
+    uint24_t timeout;
+    bool     ready = false;
+    
+    NOR_CS = 0;
+    spi_xfer(CMD_READ_STATUS);
+    for(timeout = BUSY_TIMEOUT; timeout; timeout--) // Status is sent over and over while CS is held low.
+    {
+        if(!(spi_xfer(0xFF) & STATUS_WIP))
+        {
+            ready = true;
+            break;
+        }
+    }
+    NOR_CS = 1;
+    return ready;
+}
+
+static void write_enable(void)
+{
+    NOR_CS = 0;
+    spi_xfer(CMD_WRITE_ENABLE);
+    NOR_CS = 1;
+}
+
+static void read(uint32_t addr, uint8_t *p_data, uint16_t len)
+{
+    uint16_t i;
+    
+    command_addr(CMD_READ, addr);
+    for(i = 0; i < len; i++) p_data[i] = spi_xfer(0xFF);
+    NOR_CS = 1;
+}
+
+static void program(uint32_t addr, const uint8_t *p_data, uint16_t len)
+{
+    uint16_t chunk, i;
+    
+    while(len)
+    {
+        chunk = NOR_PAGE_SIZE - (uint16_t)(addr & (NOR_PAGE_SIZE - 1)); // Page Program wraps inside the page.
+        if(chunk > len) chunk = len;
+        
+        write_enable();
+        command_addr(CMD_PAGE_PROGRAM, addr);
+        for(i = 0; i < chunk; i++) spi_xfer(p_data[i]);
+        NOR_CS = 1;
+        wait_ready();
+        
+        addr   += chunk;
+        p_data += chunk;
+        len    -= chunk;
+    }
+}
+
+static void erase_unit(uint16_t unit)
+{
+    write_enable();
+    command_addr(CMD_SECTOR_ERASE, (uint32_t)unit * NOR_UNIT_SIZE);
+    NOR_CS = 1;
+    wait_ready();
+}
+
+static void copy_block(uint16_t from_unit, uint16_t to_unit, uint8_t block)
+{
+    uint16_t offset;
+    uint8_t  i;
+    
+    for(offset = 0; offset < NOR_BLOCK_SIZE; offset += COPY_CHUNK)
+    {
+        read(block_addr(from_unit, block) + offset, m_copy_buf, COPY_CHUNK);
+        for(i = 0; i < COPY_CHUNK; i++) if(m_copy_buf[i] != 0xFF) break;
+        if(i == COPY_CHUNK) continue; // Erased already.
+        program(block_addr(to_unit, block) + offset, m_copy_buf, COPY_CHUNK);
+    }
+}
+
+static bool unit_looks_blank(uint16_t unit)
+{
+    uint8_t block, data;
+    
+    for(block = 0; block < NOR_BLOCKS_PER_UNIT; block++)
+    {
+        read(block_addr(unit, block), &data, 1);
+        if(data != 0xFF) return false;
+    }
+    return true;
+}
+
+static void open_unit(uint16_t unit, uint8_t block, uint32_t blocks_left)
+{
+    uint8_t cover, i;
+    
+    // Blocks this transfer is going to overwrite don't need saving.
+    if(blocks_left >= (uint32_t)(NOR_BLOCKS_PER_UNIT - block)) cover = (uint8_t)(0xFF << block);
+    else cover = (uint8_t)(((1 << blocks_left) - 1) << block);
+    m_keep = (uint8_t)~cover;
+    
+    for(i = 0; i < NOR_BLOCKS_PER_UNIT; i++)
+    {
+        if(m_keep & (1 << i)) copy_block(unit, m_unit_count + m_scratch, i);
+    }
+    erase_unit(unit);
+    
+    m_open      = true;
+    m_open_unit = unit;
+    m_written   = 0;
+}
+
+static void close_unit(void)
+{
+    uint8_t restore, i;
+    
+    restore = m_keep & (uint8_t)~m_written;
+    for(i = 0; i < NOR_BLOCKS_PER_UNIT; i++)
+    {
+        if(restore & (1 << i)) copy_block(m_unit_count + m_scratch, m_open_unit, i);
+    }
+    m_open = false;
+    
+    if(m_keep) // Scratch unit was used, move on to the next, and erase it now so it's ready.
+    {
+        m_scratch = (uint8_t)((m_scratch + 1) % NOR_SCRATCH_UNITS);
+        erase_unit(m_unit_count + m_scratch);
+    }
+}
+
+static uint32_t block_addr(uint16_t unit, uint8_t block)
+{
+    return ((uint32_t)unit * NOR_UNIT_SIZE) + ((uint16_t)block * NOR_BLOCK_SIZE);
+}
\ No newline at end of file
@@ -0,0 +1,238 @@
+/**
+ * @file nor_spi.h
+ * @brief SPI NOR flash driver, with 4KB erase unit management.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD NOR Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NOR_SPI_H
+#define NOR_SPI_H
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* **************************** NOR SETTINGS ******************************** */
+/* ************************************************************************** */
+
+/*
+ * Any 25 series SPI NOR flash (W25Q, MX25L, IS25LP, ...) up to 16 MB, with
+ * 4KB Sector Erase (0x20), 256 byte Page Program (0x02) and JEDEC ID (0x9F).
+ * The MSSP runs in SPI mode 0 at Fosc/4, 12 MHz at 48 MHz.
+ */
+#if defined(_16F1459)
+#define NOR_SSPBUF      SSP1BUF
+#define NOR_SSPSTAT     SSP1STAT
+#define NOR_SSPSTATbits SSP1STATbits
+#define NOR_SSPCON1     SSP1CON1
+#define NOR_PINS_INIT() do{ANSELB &= 0xEF; ANSELC &= 0x3F; TRISB |= 0x10; TRISB &= 0xBF; TRISC &= 0x3F;}while(0) // SDI RB4, SCK RB6, SDO RC7, CS RC6.
+#define NOR_CS          LATCbits.LATC6
+
+#elif defined(_16F1454) || defined(_16F1455)
+#define NOR_SSPBUF      SSP1BUF
+#define NOR_SSPSTAT     SSP1STAT
+#define NOR_SSPSTATbits SSP1STATbits
+#define NOR_SSPCON1     SSP1CON1
+#if defined(_16F1455)
+#define NOR_PINS_INIT() do{ANSELC &= 0xF0; TRISC |= 0x02; TRISC &= 0xF2;}while(0) // SCK RC0, SDI RC1, SDO RC2, CS RC3.
+#else
+#define NOR_PINS_INIT() do{TRISC |= 0x02; TRISC &= 0xF2;}while(0) // SCK RC0, SDI RC1, SDO RC2, CS RC3.
+#endif
+#define NOR_CS          LATCbits.LATC3
+
+#elif defined(_18F13K50) || defined(_18F14K50)
+#define NOR_SSPBUF      SSPBUF
+#define NOR_SSPSTAT     SSPSTAT
+#define NOR_SSPSTATbits SSPSTATbits
+#define NOR_SSPCON1     SSPCON1
+#define NOR_PINS_INIT() do{ANSELH &= 0xF8; TRISB |= 0x10; TRISB &= 0xBF; TRISC &= 0x3F;}while(0) // SDI RB4, SCK RB6, SDO RC7, CS RC6.
+#define NOR_CS          LATCbits.LATC6
+
+#elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+#define NOR_SSPBUF      SSP1BUF
+#define NOR_SSPSTAT     SSP1STAT
+#define NOR_SSPSTATbits SSP1STATbits
+#define NOR_SSPCON1     SSP1CON1
+#define NOR_PINS_INIT() do{ANSELB &= 0xFC; ANSELC &= 0x3F; TRISB |= 0x01; TRISB &= 0xFD; TRISC &= 0x3F;}while(0) // SDI RB0, SCK RB1, SDO RC7, CS RC6.
+#define NOR_CS          LATCbits.LATC6
+
+#elif defined(_18F4550_FAMILY_)
+#define NOR_SSPBUF      SSPBUF
+#define NOR_SSPSTAT     SSPSTAT
+#define NOR_SSPSTATbits SSPSTATbits
+#define NOR_SSPCON1     SSPCON1
+#define NOR_PINS_INIT() do{ADCON1 |= 0x0F; TRISB |= 0x01; TRISB &= 0xFD; TRISC &= 0x3F;}while(0) // SDI RB0, SCK RB1, SDO RC7, CS RC6.
+#define NOR_CS          LATCbits.LATC6
+
+#elif defined(__J_PART)
+#define NOR_SSPBUF      SSP1BUF
+#define NOR_SSPSTAT     SSP1STAT
+#define NOR_SSPSTATbits SSP1STATbits
+#define NOR_SSPCON1     SSP1CON1
+#define NOR_PINS_INIT() do{TRISB |= 0x20; TRISB &= 0xEF; TRISC &= 0x3F;}while(0) // SCK1 RB4, SDI1 RB5, SDO1 RC7, CS RC6.
+#define NOR_CS          LATCbits.LATC6
+
+#else
+#error "NOR SPI: This part has no MSSP, or its pins haven't been set up in nor_spi.h."
+#endif
+
+#define NOR_SPI_MODE_0 0x40 // CKE = 1, CKP = 0.
+#define NOR_SPI_INIT() do{NOR_SSPCON1 = 0; NOR_SSPSTAT = NOR_SPI_MODE_0; NOR_SSPCON1 = 0x20;}while(0) // Fosc/4.
+
+#define NOR_SCRATCH_UNITS 16 // 4KB units kept back at the top of the flash for read-modify-writes. They
+                             // are used in turn, so their erases are spread out (wear leveling).
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** NOR DEFINES ******************************* */
+/* ************************************************************************** */
+
+#define NOR_BLOCK_SIZE      512
+#define NOR_UNIT_SIZE       4096 // Erase unit.
+#define NOR_PAGE_SIZE       256  // Program unit.
+#define NOR_BLOCKS_PER_UNIT (NOR_UNIT_SIZE / NOR_BLOCK_SIZE)
+
+// nor_init() return values.
+#define NOR_OK          0
+#define NOR_ERR_NO_CHIP 1 // No JEDEC ID.
+#define NOR_ERR_SIZE    2 // Bigger than 16 MB (needs 4 byte addressing), or too small.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** NOR GLOBAL VARS ****************************** */
+/* ************************************************************************** */
+
+extern uint32_t g_nor_block_count; // Size of the volume in 512 byte blocks, scratch units not included.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** NOR GLOBAL FUNCTIONS ************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn uint8_t nor_init(void)
+ * 
+ * @brief Sets up the MSSP, and sizes the flash from its JEDEC ID.
+ * 
+ * Also picks up the scratch unit rotation from where it was left.
+ * 
+ * @return Returns NOR_OK if the flash can be used, otherwise an NOR_ERR_ value.
+ */
+uint8_t nor_init(void);
+
+/**
+ * @fn void nor_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads part of a block.
+ * 
+ * Blocks of the erase unit being written are read from wherever their latest
+ * copy is, so nor_flush() doesn't have to be called first.
+ * 
+ * @param[in] lba Block being read.
+ * @param[in] offset Byte of the block to start at.
+ * @param[out] p_data Buffer the data is read into.
+ * @param[in] len Amount of bytes to read.
+ */
+void nor_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn void nor_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len, uint32_t blocks_left)
+ * 
+ * @brief Writes part of a block.
+ * 
+ * Blocks are written in order, in parts starting from offset 0. The first 
+ * block written to a 4KB erase unit opens it: any of its blocks that the 
+ * transfer won't overwrite are first copied to a scratch unit, then the unit 
+ * is erased once. Blocks are then page programmed straight in as they arrive,
+ * so a transfer covering whole units runs at page program speed with one 
+ * erase per 8 blocks. The unit is closed (the kept blocks copied back) when a
+ * write moves to another unit, writes a block twice, or nor_flush() is called.
+ * 
+ * @param[in] lba Block being written.
+ * @param[in] offset Byte of the block to start at.
+ * @param[in] p_data Data to write.
+ * @param[in] len Amount of bytes to write.
+ * @param[in] blocks_left Blocks still to come in this transfer, counting lba.
+ * Use 1 if not known.
+ */
+void nor_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len, uint32_t blocks_left);
+
+/**
+ * @fn void nor_flush(void)
+ * 
+ * @brief Closes the erase unit being written.
+ * 
+ * Call it when the host goes idle (e.g. on TEST_UNIT_READY or 
+ * START_STOP_UNIT), until then some of the unit's blocks only exist in the 
+ * scratch unit.
+ */
+void nor_flush(void);
+
+/**
+ * @fn void nor_read_raw(uint32_t addr, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads flash straight from a byte address.
+ * 
+ * The raw functions skip the erase unit management, they're for log_vol.c, 
+ * which keeps the flash as a log instead of a block volume. Don't mix them 
+ * with nor_write() on the same units.
+ * 
+ * @param[in] addr Byte address.
+ * @param[out] p_data Buffer the data is read into.
+ * @param[in] len Amount of bytes to read.
+ */
+void nor_read_raw(uint32_t addr, uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn void nor_program_raw(uint32_t addr, const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Programs erased flash from a byte address.
+ * 
+ * Split into Page Programs at the 256 byte page boundaries.
+ * 
+ * @param[in] addr Byte address.
+ * @param[in] p_data Data to program.
+ * @param[in] len Amount of bytes to program.
+ */
+void nor_program_raw(uint32_t addr, const uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn void nor_erase_raw(uint16_t unit)
+ * 
+ * @brief Erases a 4KB unit, and waits for it to finish.
+ * 
+ * @param[in] unit Erase unit, 0 to (g_nor_block_count / NOR_BLOCKS_PER_UNIT) - 1.
+ */
+void nor_erase_raw(uint16_t unit);
+
+/* ************************************************************************** */
+
+#endif /* NOR_SPI_H */
\ No newline at end of file
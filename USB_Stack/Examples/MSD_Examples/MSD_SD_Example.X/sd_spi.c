@@ -0,0 +1,616 @@
+/**
+ * @file sd_spi.c
+ * @brief SD/MMC card driver, over SPI.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD SD Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sd_spi.h"
+
+/* ************************************************************************** */
+/* ***************************** SD COMMANDS ******************************** */
+/* ************************************************************************** */
+
+#define CMD0   0  // GO_IDLE_STATE
+#define CMD1   1  // SEND_OP_COND (MMC)
+#define CMD8   8  // SEND_IF_COND
+#define CMD9   9  // SEND_CSD
+#define CMD12  12 // STOP_TRANSMISSION
+#define CMD16  16 // SET_BLOCKLEN
+#define CMD18  18 // READ_MULTIPLE_BLOCK
+#define CMD25  25 // WRITE_MULTIPLE_BLOCK
+#define CMD55  55 // APP_CMD
+#define CMD58  58 // READ_OCR
+#define ACMD41 41 // SD_SEND_OP_COND
+
+#define R1_READY           0x00
+#define R1_IDLE_STATE      0x01
+#define R1_ILLEGAL_COMMAND 0x04
+
+#define TOKEN_START_BLOCK       0xFE // Single block writes, and every block that's read.
+#define TOKEN_START_BLOCK_MULTI 0xFC // CMD25 blocks.
+#define TOKEN_STOP_TRAN         0xFD // Ends CMD25.
+
+#define DATA_RESPONSE_MASK     0x1F
+#define DATA_RESPONSE_ACCEPTED 0x05
+
+#define OCR_CCS       0x40 // In the first OCR byte. Card uses block, not byte addressing.
+#define ACMD41_HCS    0x40000000UL
+#define CMD8_VHS_PATTERN 0x1AA // 2.7-3.6V, check pattern 0xAA.
+
+// Timeouts, counted in SPI bytes (~1.5us each at 12 MHz, with loop overhead).
+#define TOKEN_TIMEOUT 0xFFFF   // Read access, SD spec's limit is 100ms.
+#define BUSY_TIMEOUT  0x7FFFF  // Programming, SD spec's limit is 250ms (500ms for SDXC).
+#define INIT_TIMEOUT  1000     // ACMD41 attempts, 1ms apart.
+
+#define STREAM_NONE  0
+#define STREAM_READ  1
+#define STREAM_WRITE 2
+
+#ifdef SD_USE_DMA
+#define ASYNC_IDLE  0
+#define ASYNC_TOKEN 1 // Waiting on the Start Block token.
+#define ASYNC_DMA   2 // SPI DMA module is reading the block.
+#define ASYNC_DONE  3 // Finished, sd_tasks() hasn't reported it yet.
+
+// DMACON1 settings.
+#define DMA_RX 0x19 // Full duplex, RXINC, TX address fixed on a 0xFF byte, DMAEN.
+#define DMA_TX 0x25 // Half duplex transmit, TXINC, DMAEN.
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL VARS ******************************** */
+/* ************************************************************************** */
+
+uint32_t g_sd_block_count;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static bool     m_ready;
+static bool     m_block_addressing; // SDHC/SDXC take block numbers, older cards byte addresses.
+static bool     m_wr_protect;
+static uint8_t  m_stream;           // STREAM_NONE, STREAM_READ or STREAM_WRITE.
+static uint32_t m_stream_lba;       // Block the open stream will read/write next.
+#ifdef SD_USE_DMA
+static uint8_t  m_async_state;
+static uint8_t  *m_async_p_data;
+static uint16_t m_async_timeout;
+static uint8_t  m_dma_idle_byte = 0xFF; // Clocked out while the DMA module reads.
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+static uint8_t spi_xfer(uint8_t data);
+static void    select(void);
+static void    deselect(void);
+static bool    wait_ready(void);
+static bool    wait_start_token(void);
+static uint8_t send_command(uint8_t cmd, uint32_t arg);
+static void    stream_error(void);
+static bool    read_csd(bool mmc);
+static bool    open_read_stream(uint32_t lba);
+static void    end_read_block(void);
+static void    rx_bytes(uint8_t *p_data, uint16_t len);
+static void    tx_bytes(const uint8_t *p_data, uint16_t len);
+#ifdef SD_USE_DMA
+static void    dma_start(uint8_t *p_data, uint16_t len, uint8_t dmacon1);
+static void    dma_finish(void);
+static void    async_step(void);
+static void    finish_async(void);
+#endif
+
+/* ************************************************************************** */
+
+
+uint8_t sd_init(void)
+{
+    uint8_t  r1, i;
+    uint8_t  ocr[4];
+    uint16_t tries;
+    uint32_t acmd41_arg;
+    bool     v2, mmc;
+    
+    m_ready          = false;
+    m_stream         = STREAM_NONE;
+    g_sd_block_count = 0;
+    #ifdef SD_USE_DMA
+    DMACON1bits.DMAEN = 0;
+    m_async_state = ASYNC_IDLE;
+    #endif
+    
+    SD_CS = 1;
+    SD_PINS_INIT();
+    SD_SSPSTAT = SD_SPI_MODE_0;
+    SD_SPI_SLOW();
+    for(i = 0; i < 10; i++) spi_xfer(0xFF); // 80 clocks with CS high puts the card in SPI mode.
+    
+    for(tries = 0; send_command(CMD0, 0) != R1_IDLE_STATE; )
+    {
+        if(++tries == 10)
+        {
+            deselect();
+            return SD_ERR_NO_CARD;
+        }
+    }
+    
+    // SD v2 cards echo CMD8, SD v1 and MMC reject it as an illegal command.
+    v2  = false;
+    mmc = false;
+    acmd41_arg = 0;
+    if(send_command(CMD8, CMD8_VHS_PATTERN) == R1_IDLE_STATE)
+    {
+        for(i = 0; i < 4; i++) ocr[i] = spi_xfer(0xFF);
+        if((ocr[2] & 0x0F) != 0x01 || ocr[3] != 0xAA)
+        {
+            deselect();
+            return SD_ERR_UNSUPPORTED;
+        }
+        v2 = true;
+        acmd41_arg = ACMD41_HCS;
+    }
+    
+    for(tries = 0; ; tries++)
+    {
+        if(tries == INIT_TIMEOUT)
+        {
+            deselect();
+            return SD_ERR_TIMEOUT;
+        }
+        if(mmc) r1 = send_command(CMD1, 0);
+        else
+        {
+            send_command(CMD55, 0);
+            r1 = send_command(ACMD41, acmd41_arg);
+            if(!v2 && (r1 & R1_ILLEGAL_COMMAND))
+            {
+                mmc = true; // No ACMD41, try MMC's CMD1.
+                continue;
+            }
+        }
+        if(r1 == R1_READY) break;
+        if(r1 != R1_IDLE_STATE)
+        {
+            deselect();
+            return SD_ERR_UNSUPPORTED;
+        }
+        __delay_ms(1);
+    }
+    
+    m_block_addressing = false;
+    if(v2)
+    {
+        if(send_command(CMD58, 0) != R1_READY)
+        {
+            deselect();
+            return SD_ERR_UNSUPPORTED;
+        }
+        for(i = 0; i < 4; i++) ocr[i] = spi_xfer(0xFF);
+        m_block_addressing = (ocr[0] & OCR_CCS) != 0;
+    }
+    if(!m_block_addressing && send_command(CMD16, SD_BLOCK_SIZE) != R1_READY)
+    {
+        deselect();
+        return SD_ERR_UNSUPPORTED;
+    }
+    
+    SD_SPI_FAST();
+    
+    if(!read_csd(mmc))
+    {
+        deselect();
+        return SD_ERR_CSD;
+    }
+    deselect();
+    
+    m_ready = true;
+    return SD_OK;
+}
+
+bool sd_card_inserted(void)
+{
+    #ifdef SD_CD_PORT
+    #ifdef SD_CD_ACTIVE_LOW
+    if(!(SD_CD_PORT & (1 << SD_CD_PORT_BIT)))
+    #else
+    if(SD_CD_PORT & (1 << SD_CD_PORT_BIT))
+    #endif
+    {
+        return true;
+    }
+    SD_CS    = 1; // Card is gone, forget any stream without talking to it.
+    m_stream = STREAM_NONE;
+    m_ready  = false;
+    return false;
+    #else
+    return true;
+    #endif
+}
+
+bool sd_ready(void)
+{
+    return m_ready;
+}
+
+bool sd_wr_protected(void)
+{
+    return m_wr_protect;
+}
+
+bool sd_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    uint16_t i;
+    
+    #ifdef SD_USE_DMA
+    finish_async();
+    #endif
+    if(offset == 0)
+    {
+        if(!open_read_stream(lba) || !wait_start_token())
+        {
+            stream_error();
+            goto fill;
+        }
+    }
+    else if(m_stream != STREAM_READ) goto fill; // Stream was lost earlier in this block.
+    
+    rx_bytes(p_data, len);
+    if((offset + len) == SD_BLOCK_SIZE) end_read_block();
+    return true;
+    
+fill:
+    for(i = 0; i < len; i++) p_data[i] = 0;
+    return false;
+}
+
+#ifdef SD_USE_DMA
+bool sd_read_async(uint32_t lba, uint8_t *p_data)
+{
+    uint16_t i;
+    
+    finish_async();
+    m_async_p_data = p_data;
+    if(!open_read_stream(lba))
+    {
+        stream_error();
+        for(i = 0; i < SD_BLOCK_SIZE; i++) p_data[i] = 0;
+        m_async_state = ASYNC_DONE;
+        return false;
+    }
+    m_async_timeout = TOKEN_TIMEOUT;
+    m_async_state   = ASYNC_TOKEN;
+    async_step();
+    return true;
+}
+
+bool sd_tasks(void)
+{
+    if(m_async_state == ASYNC_TOKEN || m_async_state == ASYNC_DMA) async_step();
+    if(m_async_state == ASYNC_DONE)
+    {
+        m_async_state = ASYNC_IDLE;
+        return true;
+    }
+    return false;
+}
+#endif
+
+bool sd_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len)
+{
+    #ifdef SD_USE_DMA
+    finish_async();
+    #endif
+    if(offset == 0)
+    {
+        if(m_stream != STREAM_WRITE || m_stream_lba != lba) // Not carrying on from the last block written, (re)start the stream.
+        {
+            sd_stream_stop();
+            if(!m_ready || send_command(CMD25, m_block_addressing ? lba : (lba << 9)) != R1_READY)
+            {
+                stream_error();
+                return false;
+            }
+            m_stream     = STREAM_WRITE;
+            m_stream_lba = lba;
+        }
+        if(!wait_ready()) // Still programming the last block.
+        {
+            stream_error();
+            return false;
+        }
+        spi_xfer(TOKEN_START_BLOCK_MULTI);
+    }
+    else if(m_stream != STREAM_WRITE) return false; // Stream was lost earlier in this block.
+    
+    tx_bytes(p_data, len);
+    
+    if((offset + len) == SD_BLOCK_SIZE)
+    {
+        spi_xfer(0xFF); // CRC, ignored in SPI mode.
+        spi_xfer(0xFF);
+        if((spi_xfer(0xFF) & DATA_RESPONSE_MASK) != DATA_RESPONSE_ACCEPTED)
+        {
+            sd_stream_stop();
+            stream_error();
+            return false;
+        }
+        m_stream_lba++; // Card is now busy programming, the next call waits on it.
+    }
+    return true;
+}
+
+void sd_stream_stop(void)
+{
+    #ifdef SD_USE_DMA
+    finish_async();
+    #endif
+    if(m_stream == STREAM_READ)
+    {
+        send_command(CMD12, 0);
+        wait_ready();
+    }
+    else if(m_stream == STREAM_WRITE)
+    {
+        wait_ready();
+        spi_xfer(TOKEN_STOP_TRAN);
+        spi_xfer(0xFF); // Nbr, busy starts a byte after the token.
+        wait_ready();
+    }
+    else return;
+    
+    deselect();
+    m_stream = STREAM_NONE;
+}
+
+static uint8_t spi_xfer(uint8_t data)
+{
+    SD_SSPBUF = data;
+    while(!SD_SSPSTATbits.BF);
+    return SD_SSPBUF;
+}
+
+static void select(void)
+{
+    SD_CS = 0;
+    spi_xfer(0xFF);
+}
+
+static void deselect(void)
+{
+    SD_CS = 1;
+    spi_xfer(0xFF); // Extra clocks so the card lets go of DO.
+}
+
+static bool wait_ready(void)
+{
+    uint24_t timeout;
+    
+    for(timeout = BUSY_TIMEOUT; timeout; timeout--)
+    {
+        if(spi_xfer(0xFF) == 0xFF) return true;
+    }
+    return false;
+}
+
+static bool wait_start_token(void)
+{
+    uint16_t timeout;
+    uint8_t  token;
+    
+    for(timeout = TOKEN_TIMEOUT; timeout; timeout--)
+    {
+        token = spi_xfer(0xFF);
+        if(token != 0xFF) return token == TOKEN_START_BLOCK; // Anything else is a Data Error Token.
+    }
+    return false;
+}
+
+static uint8_t send_command(uint8_t cmd, uint32_t arg)
+{
+    uint8_t r1, i;
+    
+    if(cmd != CMD12) // CMD12 is sent while the card is still streaming data.
+    {
+        deselect();
+        select();
+        if(cmd != CMD0 && !wait_ready()) return 0xFF; // Nothing to wait on before CMD0, and DO may not be pulled up without a card.
+    }
+    
+    spi_xfer(0x40 | cmd);
+    spi_xfer((uint8_t)(arg >> 24));
+    spi_xfer((uint8_t)(arg >> 16));
+    spi_xfer((uint8_t)(arg >> 8));
+    spi_xfer((uint8_t)arg);
+    if(cmd == CMD0) spi_xfer(0x95);      // CRC is only checked for CMD0 and CMD8.
+    else if(cmd == CMD8) spi_xfer(0x87);
+    else spi_xfer(0x01);
+    
+    if(cmd == CMD12) spi_xfer(0xFF); // Skip the stuff byte.
+    
+    for(i = 0; i < 10; i++) // Response comes within 8 bytes.
+    {
+        r1 = spi_xfer(0xFF);
+        if(!(r1 & 0x80)) break;
+    }
+    return r1;
+}
+
+static void stream_error(void)
+{
+    deselect();
+    m_stream = STREAM_NONE;
+    m_ready  = false; // sd_init() has to be run again.
+}
+
+static bool read_csd(bool mmc)
+{
+    uint8_t  csd[16];
+    uint8_t  i, shift;
+    uint32_t c_size;
+    
+    if(send_command(CMD9, 0) != R1_READY || !wait_start_token()) return false;
+    for(i = 0; i < 16; i++) csd[i] = spi_xfer(0xFF);
+    spi_xfer(0xFF); // CRC
+    spi_xfer(0xFF);
+    
+    if(!mmc && (csd[0] >> 6) == 1) // CSD Version 2.0, SDHC/SDXC.
+    {
+        c_size = ((uint32_t)(csd[7] & 0x3F) << 16) | ((uint16_t)csd[8] << 8) | csd[9];
+        g_sd_block_count = (c_size + 1) << 10; // (C_SIZE + 1) * 512KB.
+    }
+    else if(mmc || (csd[0] >> 6) == 0) // CSD Version 1.0 layout, SDSC and MMC.
+    {
+        c_size = ((uint16_t)(csd[6] & 0x03) << 10) | ((uint16_t)csd[7] << 2) | (csd[8] >> 6);
+        shift  = (uint8_t)((((csd[9] & 0x03) << 1) | (csd[10] >> 7)) + 2 + (csd[5] & 0x0F) - 9); // C_SIZE_MULT + 2 + READ_BL_LEN, in 512 byte blocks.
+        g_sd_block_count = (c_size + 1) << shift;
+    }
+    else return false;
+    
+    m_wr_protect = (csd[14] & 0x30) != 0; // PERM_WRITE_PROTECT, TMP_WRITE_PROTECT.
+    return true;
+}
+
+static bool open_read_stream(uint32_t lba)
+{
+    if(m_stream == STREAM_READ && m_stream_lba == lba) return true; // Carrying on from the last block read.
+    
+    sd_stream_stop();
+    if(!m_ready || send_command(CMD18, m_block_addressing ? lba : (lba << 9)) != R1_READY) return false;
+    m_stream     = STREAM_READ;
+    m_stream_lba = lba;
+    return true;
+}
+
+static void end_read_block(void)
+{
+    spi_xfer(0xFF); // CRC, not checked.
+    spi_xfer(0xFF);
+    m_stream_lba++;
+    if(m_stream_lba == g_sd_block_count) sd_stream_stop(); // Don't let the card fetch past its last block.
+}
+
+static void rx_bytes(uint8_t *p_data, uint16_t len)
+{
+    uint16_t i;
+    
+    #ifdef SD_USE_DMA
+    if(len > 1)
+    {
+        dma_start(p_data, len, DMA_RX);
+        while(DMACON1bits.DMAEN);
+        dma_finish();
+        return;
+    }
+    #endif
+    for(i = 0; i < len; i++) p_data[i] = spi_xfer(0xFF);
+}
+
+static void tx_bytes(const uint8_t *p_data, uint16_t len)
+{
+    uint16_t i;
+    
+    #ifdef SD_USE_DMA
+    if(len > 1)
+    {
+        dma_start((uint8_t*)p_data, len, DMA_TX);
+        while(DMACON1bits.DMAEN);
+        dma_finish();
+        return;
+    }
+    #endif
+    for(i = 0; i < len; i++) spi_xfer(p_data[i]);
+}
+
+#ifdef SD_USE_DMA
+static void dma_start(uint8_t *p_data, uint16_t len, uint8_t dmacon1)
+{
+    uint16_t tx_addr;
+    
+    tx_addr = (dmacon1 == DMA_RX) ? (uint16_t)&m_dma_idle_byte : (uint16_t)p_data;
+    TXADDRH = (uint8_t)(tx_addr >> 8);
+    TXADDRL = (uint8_t)tx_addr;
+    RXADDRH = (uint8_t)((uint16_t)p_data >> 8);
+    RXADDRL = (uint8_t)(uint16_t)p_data;
+    DMABCH  = (uint8_t)((len - 1) >> 8); // Byte count is len - 1.
+    DMABCL  = (uint8_t)(len - 1);
+    DMACON2 = 0; // No delay between bytes.
+    DMACON1 = dmacon1;
+}
+
+static void dma_finish(void)
+{
+    (void)SD_SSPBUF; // Clear BF, left set by the last byte the module received.
+}
+
+static void async_step(void)
+{
+    uint8_t  token;
+    uint16_t i;
+    
+    if(m_async_state == ASYNC_TOKEN)
+    {
+        token = spi_xfer(0xFF);
+        if(token == 0xFF)
+        {
+            if(--m_async_timeout) return;
+        }
+        else if(token == TOKEN_START_BLOCK)
+        {
+            dma_start(m_async_p_data, SD_BLOCK_SIZE, DMA_RX);
+            m_async_state = ASYNC_DMA;
+            return;
+        }
+        stream_error(); // Timed out, or a Data Error Token.
+        for(i = 0; i < SD_BLOCK_SIZE; i++) m_async_p_data[i] = 0;
+        m_async_state = ASYNC_DONE;
+    }
+    else if(m_async_state == ASYNC_DMA)
+    {
+        if(DMACON1bits.DMAEN) return;
+        dma_finish();
+        m_async_state = ASYNC_DONE; // Before end_read_block(), it can call sd_stream_stop().
+        end_read_block();
+    }
+}
+
+static void finish_async(void)
+{
+    while(m_async_state == ASYNC_TOKEN || m_async_state == ASYNC_DMA) async_step();
+}
+#endif
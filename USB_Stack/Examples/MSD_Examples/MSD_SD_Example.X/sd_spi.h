@@ -0,0 +1,310 @@
+/**
+ * @file sd_spi.h
+ * @brief SD/MMC card driver, over SPI.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD SD Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SD_SPI_H
+#define SD_SPI_H
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* ***************************** SD SETTINGS ******************************** */
+/* ************************************************************************** */
+
+/*
+ * The card is driven with the MSSP in SPI mode 0. SD_SPI_SLOW() is used while
+ * the card is initialised (must be 100-400 kHz), SD_SPI_FAST() afterwards 
+ * (Fosc/4, 12 MHz at 48 MHz). Set SD_CS to any spare output.
+ * 
+ * Card Detect is optional, define SD_CD_PORT/SD_CD_PORT_BIT to use a socket's
+ * switch, otherwise the card is detected by trying to initialise it.
+ */
+#if defined(_16F1459)
+#define SD_SSPBUF      SSP1BUF
+#define SD_SSPSTAT     SSP1STAT
+#define SD_SSPSTATbits SSP1STATbits
+#define SD_SSPCON1     SSP1CON1
+#define SD_SSPADD      SSP1ADD
+#define SD_PINS_INIT() do{ANSELB &= 0xEF; ANSELC &= 0x3F; TRISB |= 0x10; TRISB &= 0xBF; TRISC &= 0x3F;}while(0) // SDI RB4, SCK RB6, SDO RC7, CS RC6.
+#define SD_CS          LATCbits.LATC6
+
+#elif defined(_16F1454) || defined(_16F1455)
+#define SD_SSPBUF      SSP1BUF
+#define SD_SSPSTAT     SSP1STAT
+#define SD_SSPSTATbits SSP1STATbits
+#define SD_SSPCON1     SSP1CON1
+#define SD_SSPADD      SSP1ADD
+#if defined(_16F1455)
+#define SD_PINS_INIT() do{ANSELC &= 0xF0; TRISC |= 0x02; TRISC &= 0xF2;}while(0) // SCK RC0, SDI RC1, SDO RC2, CS RC3.
+#else
+#define SD_PINS_INIT() do{TRISC |= 0x02; TRISC &= 0xF2;}while(0) // SCK RC0, SDI RC1, SDO RC2, CS RC3.
+#endif
+#define SD_CS          LATCbits.LATC3
+
+#elif defined(_18F13K50) || defined(_18F14K50)
+#define SD_SSPBUF      SSPBUF
+#define SD_SSPSTAT     SSPSTAT
+#define SD_SSPSTATbits SSPSTATbits
+#define SD_SSPCON1     SSPCON1
+#define SD_SSPADD      SSPADD
+#define SD_PINS_INIT() do{ANSELH &= 0xF8; TRISB |= 0x10; TRISB &= 0xBF; TRISC &= 0x3F;}while(0) // SDI RB4, SCK RB6, SDO RC7, CS RC6.
+#define SD_CS          LATCbits.LATC6
+
+#elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+#define SD_SSPBUF      SSP1BUF
+#define SD_SSPSTAT     SSP1STAT
+#define SD_SSPSTATbits SSP1STATbits
+#define SD_SSPCON1     SSP1CON1
+#define SD_SSPADD      SSP1ADD
+#define SD_PINS_INIT() do{ANSELB &= 0xFC; ANSELC &= 0x3F; TRISB |= 0x01; TRISB &= 0xFD; TRISC &= 0x3F;}while(0) // SDI RB0, SCK RB1, SDO RC7, CS RC6.
+#define SD_CS          LATCbits.LATC6
+
+#elif defined(_18F4550_FAMILY_)
+#define SD_SSPBUF      SSPBUF
+#define SD_SSPSTAT     SSPSTAT
+#define SD_SSPSTATbits SSPSTATbits
+#define SD_SSPCON1     SSPCON1
+#define SD_NO_SSPADD_CLOCK // MSSP can't use SSPADD as a baud rate generator in SPI mode.
+#define SD_PINS_INIT() do{ADCON1 |= 0x0F; TRISB |= 0x01; TRISB &= 0xFD; TRISC &= 0x3F;}while(0) // SDI RB0, SCK RB1, SDO RC7, CS RC6.
+#define SD_CS          LATCbits.LATC6
+
+#elif defined(__J_PART)
+#define SD_SSPBUF      SSP1BUF
+#define SD_SSPSTAT     SSP1STAT
+#define SD_SSPSTATbits SSP1STATbits
+#define SD_SSPCON1     SSP1CON1
+#define SD_SSPADD      SSP1ADD
+#define SD_PINS_INIT() do{TRISB |= 0x20; TRISB &= 0xEF; TRISC &= 0x3F;}while(0) // SCK1 RB4, SDI1 RB5, SDO1 RC7, CS RC6.
+#define SD_CS          LATCbits.LATC6
+#define SD_USE_DMA     // MSSP1's SPI DMA module moves whole blocks, see sd_read_async().
+
+#else
+#error "SD SPI: This part has no MSSP, or its pins haven't been set up in sd_spi.h."
+#endif
+
+//#define SD_CD_PORT      PORTC
+//#define SD_CD_PORT_BIT  5
+#define SD_CD_ACTIVE_LOW // Most sockets pull the switch to ground when a card is in.
+
+#define SD_SPI_MODE_0 0x40 // CKE = 1, CKP = 0.
+#ifdef SD_NO_SSPADD_CLOCK
+#define SD_SPI_SLOW() SD_SSPCON1 = 0x22 // Fosc/64, 750 kHz at 48 MHz, above spec but accepted by cards in practice.
+#else
+#define SD_SPI_SLOW() do{SD_SSPCON1 = 0; SD_SSPADD = 29; SD_SSPCON1 = 0x2A;}while(0) // Fosc/(4 * (29 + 1)), 400 kHz at 48 MHz.
+#endif
+#define SD_SPI_FAST() do{SD_SSPCON1 = 0; SD_SSPCON1 = 0x20;}while(0) // Fosc/4, 12 MHz at 48 MHz.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************* SD DEFINES ******************************* */
+/* ************************************************************************** */
+
+#define SD_BLOCK_SIZE 512
+
+// sd_init() return values.
+#define SD_OK              0
+#define SD_ERR_NO_CARD     1 // No response to CMD0.
+#define SD_ERR_UNSUPPORTED 2 // Rejected CMD8's voltage range, or not an SD/MMC card.
+#define SD_ERR_TIMEOUT     3 // Card never left the idle state.
+#define SD_ERR_CSD         4 // CSD couldn't be read.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** SD GLOBAL VARS ****************************** */
+/* ************************************************************************** */
+
+extern uint32_t g_sd_block_count; // Capacity of the card in 512 byte blocks, 0 when no card is ready.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** SD GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn uint8_t sd_init(void)
+ * 
+ * @brief Sets up the MSSP and initialises the card.
+ * 
+ * Goes through CMD0, CMD8, ACMD41 (CMD1 for MMC) and CMD58, then reads the 
+ * card's capacity from the CSD into g_sd_block_count. Can be called again 
+ * after a card is swapped, or after an error.
+ * 
+ * @return Returns SD_OK when the card is ready, otherwise an SD_ERR_ value.
+ */
+uint8_t sd_init(void);
+
+/**
+ * @fn bool sd_card_inserted(void)
+ * 
+ * @brief Reads the socket's Card Detect switch.
+ * 
+ * Always returns true when SD_CD_PORT isn't defined.
+ * 
+ * @return Returns true if a card is in the socket.
+ */
+bool sd_card_inserted(void);
+
+/**
+ * @fn bool sd_ready(void)
+ * 
+ * @brief Tells if sd_init() succeeded and no error has happened since.
+ * 
+ * @return Returns true if the card can be read and written.
+ */
+bool sd_ready(void);
+
+/**
+ * @fn bool sd_wr_protected(void)
+ * 
+ * @brief Reads the card's write protect bits, from the CSD.
+ * 
+ * @return Returns true if PERM_WRITE_PROTECT or TMP_WRITE_PROTECT is set.
+ */
+bool sd_wr_protected(void);
+
+/**
+ * @fn bool sd_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads part of a block.
+ * 
+ * Blocks are read through one CMD18 (READ_MULTIPLE_BLOCK) stream. The stream 
+ * is kept open for as long as the blocks asked for follow on from each other,
+ * so a whole READ_10 (and the next one, if the host carries on where it left 
+ * off) only costs one command. Each block must be read in order, in parts 
+ * starting from offset 0, until all 512 bytes have been read.
+ * 
+ * @param[in] lba Block being read.
+ * @param[in] offset Byte of the block to start at.
+ * @param[out] p_data Buffer the data is read into.
+ * @param[in] len Amount of bytes to read.
+ * 
+ * @return Returns false if the card responded with an error, p_data is then
+ * filled with 0s.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * sd_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE);
+ * @endcode
+ * </li></ul>
+ */
+bool sd_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn bool sd_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Writes part of a block.
+ * 
+ * The write version of sd_read(), blocks are written through one CMD25 
+ * (WRITE_MULTIPLE_BLOCK) stream. The card programs each block while the next
+ * one is being received over USB, sd_write() only waits on it before the next
+ * block's start token.
+ * 
+ * @param[in] lba Block being written.
+ * @param[in] offset Byte of the block to start at.
+ * @param[in] p_data Data to write.
+ * @param[in] len Amount of bytes to write.
+ * 
+ * @return Returns false if the card didn't accept the block.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * sd_write(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out, MSD_EP_SIZE);
+ * @endcode
+ * </li></ul>
+ */
+bool sd_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len);
+
+#ifdef SD_USE_DMA
+/**
+ * @fn bool sd_read_async(uint32_t lba, uint8_t *p_data)
+ * 
+ * @brief Starts reading a whole block in the background.
+ * 
+ * Carries on (or starts) the CMD18 stream like sd_read(), then returns while 
+ * the Start Block token is waited on and the SPI DMA module reads the block 
+ * into p_data. sd_tasks() moves it along and tells when it's finished. Any 
+ * other sd_ call first waits for it to finish.
+ * 
+ * @param[in] lba Block being read.
+ * @param[out] p_data Buffer the block is read into, 512 bytes of RAM.
+ * 
+ * @return Returns false if the stream couldn't be started, p_data is then 
+ * filled with 0s and sd_tasks() still reports the read as finished.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * sd_read_async(lba, p_sect_data);
+ * @endcode
+ * </li></ul>
+ */
+bool sd_read_async(uint32_t lba, uint8_t *p_data);
+
+/**
+ * @fn bool sd_tasks(void)
+ * 
+ * @brief Services a read started by sd_read_async().
+ * 
+ * Must be run frequently in your main program loop.
+ * 
+ * @return Returns true once, when the read has finished.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * if(sd_tasks()) msd_rx_sector_complete();
+ * @endcode
+ * </li></ul>
+ */
+bool sd_tasks(void);
+#endif
+
+/**
+ * @fn void sd_stream_stop(void)
+ * 
+ * @brief Closes an open CMD18/CMD25 stream.
+ * 
+ * Sends CMD12 for a read stream, or the Stop Tran token for a write stream, 
+ * and waits for the card to finish programming. Call it before the card is 
+ * removed or powered down, and when the host goes idle (e.g. on 
+ * TEST_UNIT_READY or START_STOP_UNIT).
+ */
+void sd_stream_stop(void);
+
+/* ************************************************************************** */
+
+#endif /* SD_SPI_H */
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+ * @file usb_msd_config.h
+ * @brief <i>Mass Storage Class</i> user settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - MSD Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_MSD_CONFIG
+#define USB_MSD_CONFIG
+
+#include <stdint.h>
+#include "usb_config.h"
+
+// External Media Support
+#define USE_EXTERNAL_MEDIA
+
+// Support SCSI Command
+#define USE_WRITE_10
+//#define USE_PREVENT_ALLOW_MEDIUM_REMOVAL
+//#define USE_VERIFY_10
+
+#define USE_WR_PROTECT
+#define USE_TEST_UNIT_READY
+#define USE_START_STOP_UNIT
+//#define USE_READ_CAPACITY   // if not defined use the constant defines for capacity below. 
+//#define USE_RW_12_16        // READ_12/16, WRITE_12/16 (with USE_WRITE_10) and READ_CAPACITY_16.
+
+// CAPACITY
+#define BYTES_PER_BLOCK_LE 0x200 // 512, SD cards are always accessed in 512 byte blocks.
+#define BYTES_PER_BLOCK_BE 0x00020000UL // Big-endian version
+extern uint32_t g_sd_block_count; // Read from the card's CSD by sd_init().
+#define VOL_CAPACITY_IN_BLOCKS g_sd_block_count
+#define LAST_BLOCK_LE (g_sd_block_count - 1)
+
+// MSD Endpoint HAL
+#define MSD_EP EP1
+#define MSD_EP_SIZE EP1_SIZE
+
+// MSD Buffer Descriptor HAL
+#define MSD_BD_OUT         BD1_OUT
+#define MSD_BD_OUT_EVEN    BD1_OUT_EVEN
+#define MSD_BD_OUT_ODD     BD1_OUT_ODD
+#define MSD_BD_IN          BD1_IN
+#define MSD_BD_IN_EVEN     BD1_IN_EVEN
+#define MSD_BD_IN_ODD      BD1_IN_ODD
+
+// MSD UEP1bits
+#define MSD_UEPbits UEP1bits
+
+// RAM Setting
+#if defined(_PIC14E) || defined(_18F14K50)
+#define MSD_LIMITED_RAM // PIC18F145X and PIC18F14K50 need this settings as RAM is tight on these parts.
+#warning "Please note: The msd library is using the MSD_LIMITED_RAM setting, as this part has a small amount of RAM. \
+Use R_W_10_Vars.LBA in combination with g_msd_byte_of_sect to find locations in the sector."
+#endif
+#if defined(__J_PART)
+#define MSD_READ_PREFETCH // J parts DMA the next sector in while the current one is sent, see sd_read_async().
+#else
+#define MSD_LIMITED_RAM // **HIGHLY RECOMMEND TRYING THIS SETTING.
+                        // Will reduce ROM and RAM size and speed up code, 
+                        // at the cost of slightly more complicated tracking 
+                        // of Sector locations using g_msd_rw_10_vars.LBA in combination 
+                        // with g_msd_byte_of_sect.
+#endif
+
+//#define MSD_READ_PREFETCH // Double buffers sectors during READ_10. The next sector is
+                          // fetched with msd_rx_sector_async() while the current one 
+                          // is sent, hiding slow media access. Needs an extra 512 bytes 
+                          // of RAM and MSD_LIMITED_RAM to be undefined.
+
+//#define MSD_WRITE_CACHE // Write behind cache for WRITE_10. Sectors are buffered in RAM
+                        // and the CSW is returned straight away, msd_flush_tasks() then 
+                        // commits them with msd_commit_sector(). Needs an extra 512 bytes 
+                        // of RAM, USE_WRITE_10 and MSD_LIMITED_RAM to be undefined.
+
+//#define MSD_DIRECT_WRITE // WRITE_10 packets are received straight into g_msd_sect_data by
+                         // re-pointing the OUT BD, instead of copying from the Endpoint. 
+                         // Needs g_msd_sect_data in SIE reachable RAM (falls back to 
+                         // copying if not), USE_WRITE_10, MSD_LIMITED_RAM and 
+                         // MSD_WRITE_CACHE undefined, and no ping-pong on MSD's Endpoints.
+
+//#define MSD_ASYNC_MEDIA // msd_rx_sector() and msd_tx_sector() may return MSD_MEDIA_PENDING
+                        // and finish later, calling msd_media_complete(). MSD's Endpoints
+                        // are left unarmed meanwhile (the host is NAKed), so EP0 and other
+                        // interfaces keep running during slow erases. Needs MSD_LIMITED_RAM,
+                        // MSD_READ_PREFETCH and MSD_WRITE_CACHE undefined.
+
+//#define MSD_ARENA // g_msd_sect_data, and the MSD_READ_PREFETCH and MSD_WRITE_CACHE buffers,
+                  // are the msd state of g_usb_arena (see usb.h), so RAM can be shared 
+                  // with states that never run alongside MSD, e.g. another configuration. 
+                  // Flush the write cache before leaving the state. Needs USE_ARENA, 
+                  // X(msd, 512) in USB_ARENA_STATES (512 more per extra buffer), and 
+                  // MSD_LIMITED_RAM undefined.
+
+//#define MSD_IMAGE_CRC // Keeps a CRC-32 of the sectors WRITE_10 receives and of the ones
+                      // VERIFY_10 reads back, for the vendor MSD_IMAGE_CRC_CMD (0xC0).
+                      // A flashing tool can then check an image with VERIFY_10 instead 
+                      // of reading it over USB. Uses 1KB of ROM for the CRC table,
+                      // the verify CRC needs USE_VERIFY_10.
+
+//#define MSD_MOUNT_STATS // Frames from the first CBW to the first READ, the commands failed 
+                        // meanwhile and the first unsupported opcodes, read with msd_get_mount_stats().
+
+//#define MSD_TASK_QUEUE_SIZE 8 // Endpoint transactions msd_add_task() can queue for msd_tasks(),
+                              // a power of two (default 4). Raise it if g_msd_task_overflows
+                              // counts, e.g. when the main loop is slow to call msd_tasks().
+
+#endif
\ No newline at end of file
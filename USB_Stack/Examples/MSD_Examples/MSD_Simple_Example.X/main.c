@@ -118,7 +118,14 @@
 #include "config.h"
 #include "usb.h"
 #include "usb_msd.h"
+#ifdef MSD_RAM_DISK
+#include "ram_disk.h"
+#endif
+#ifdef MSD_ROM_IMAGE
+#include "rom_image.h" // Volume built from the Volume folder by Tools/FAT_Image.
+#endif
 
+#ifndef MSD_ROM_IMAGE
 /** Boot Sector */
 typedef struct
 {
@@ -226,12 +233,19 @@ static const ROOT_DIR_t root =
         sizeof(file)
     }
 };
+#endif
 
 static void example_init(void);
 #ifdef USE_BOOT_LED
 static void flash_led(void);
 #endif
 static void __interrupt() isr(void);
+#ifndef MSD_LIMITED_RAM
+static void load_sector(uint32_t lba, uint8_t* p_sect_data);
+#endif
+#ifdef MSD_RAM_DISK
+static void save_sector_part(uint32_t lba, uint16_t offset, const uint8_t* p_data, uint16_t len);
+#endif
 
 void main(void)
 {
@@ -242,15 +256,30 @@ void main(void)
     flash_led();
 	#endif
     
+    #ifdef MSD_RAM_DISK
+    ram_disk_init();
+    #endif
     usb_init();
+    #ifndef USE_POLLING
     INTCONbits.PEIE = 1;
     USB_INTERRUPT_FLAG = 0;
     USB_INTERRUPT_ENABLE = 1;
     INTCONbits.GIE = 1;
-    while(usb_get_state() != STATE_CONFIGURED){}
+    #endif
+    while(usb_get_state() != STATE_CONFIGURED)
+    {
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+    }
     while(1)
     {
-        //usb_tasks();
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
         msd_tasks();
     }
     
@@ -395,6 +424,12 @@ void msd_rx_sector(void)
     #define RSC_EP_ADDRESS g_msd_ep_in
     #endif
     
+    #ifdef MSD_RAM_DISK
+    if(ram_disk_read((uint16_t)g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, RSC_EP_ADDRESS, 64)) return; // Written by the host.
+    #endif
+    #ifdef MSD_ROM_IMAGE
+    rom_image_read((uint16_t)g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, RSC_EP_ADDRESS, 64);
+    #else
     usb_ram_set(0, RSC_EP_ADDRESS, 64);
     
     if(g_msd_rw_10_vars.LBA == BOOT_SECT_ADDR)  // If PC is reading the Boot Sector.
@@ -428,38 +463,100 @@ void msd_rx_sector(void)
             if(g_msd_byte_of_sect == 0) usb_rom_copy(file, RSC_EP_ADDRESS, sizeof(file));
         }
     }
+    #endif
     #else
-    usb_ram_set(0, g_msd_sect_data, 512); // Blank Regions of memory are read as zero.
+    load_sector(g_msd_rw_10_vars.LBA, g_msd_sect_data);
+    #endif
+}
 
-    if(g_msd_rw_10_vars.LBA == BOOT_SECT_ADDR)  // If PC is reading the Boot Sector.
+#ifdef MSD_READ_PREFETCH
+void msd_rx_sector_async(uint32_t lba, uint8_t* p_sect_data)
+{
+    load_sector(lba, p_sect_data); // ROM based volume, so the sector is ready straight away.
+    msd_rx_sector_complete();
+}
+#endif
+
+#ifndef MSD_LIMITED_RAM
+static void load_sector(uint32_t lba, uint8_t* p_sect_data)
+{
+    #ifdef MSD_RAM_DISK
+    if(ram_disk_read((uint16_t)lba, 0, p_sect_data, 512)) return; // Written by the host.
+    #endif
+    #ifdef MSD_ROM_IMAGE
+    rom_image_read((uint16_t)lba, 0, p_sect_data, 512);
+    #else
+    usb_ram_set(0, p_sect_data, 512); // Blank Regions of memory are read as zero.
+
+    if(lba == BOOT_SECT_ADDR)  // If PC is reading the Boot Sector.
     {
-        usb_rom_copy((const uint8_t*)(&boot16), g_msd_sect_data, sizeof(boot16));
-        g_msd_sect_data[510] = 0x55;
-        g_msd_sect_data[511] = 0xAA;
+        usb_rom_copy((const uint8_t*)(&boot16), p_sect_data, sizeof(boot16));
+        p_sect_data[510] = 0x55;
+        p_sect_data[511] = 0xAA;
     }
-    else if(g_msd_rw_10_vars.LBA == FAT_SECT_ADDR) // If PC is reading the FAT.
+    else if(lba == FAT_SECT_ADDR) // If PC is reading the FAT.
     {
-        g_msd_sect_data[0] = 0xF8;
-        g_msd_sect_data[1] = 0xFF;
-        g_msd_sect_data[2] = 0xFF;
-        g_msd_sect_data[3] = 0xFF;
-        g_msd_sect_data[4] = 0x0F;
+        p_sect_data[0] = 0xF8;
+        p_sect_data[1] = 0xFF;
+        p_sect_data[2] = 0xFF;
+        p_sect_data[3] = 0xFF;
+        p_sect_data[4] = 0x0F;
     }
-    else if(g_msd_rw_10_vars.LBA == ROOT_SECT_ADDR) // If PC is reading the Root Sector.
+    else if(lba == ROOT_SECT_ADDR) // If PC is reading the Root Sector.
     {
-        usb_rom_copy((const uint8_t*)(&root), g_msd_sect_data, 64);
+        usb_rom_copy((const uint8_t*)(&root), p_sect_data, 64);
     }
-    else if(g_msd_rw_10_vars.LBA >= DATA_SECT_ADDR) // If PC is reading the Data Sector.
+    else if(lba >= DATA_SECT_ADDR) // If PC is reading the Data Sector.
     {
-        if(g_msd_rw_10_vars.LBA == FILE_SECT_ADDR) // If PC is reading ABOUT file data.
+        if(lba == FILE_SECT_ADDR) // If PC is reading ABOUT file data.
         {
-            usb_rom_copy(file, g_msd_sect_data, sizeof(file));
+            usb_rom_copy(file, p_sect_data, sizeof(file));
         }
     }
     #endif
 }
+#endif
 
 void msd_tx_sector(void)
 {
+    #ifdef MSD_RAM_DISK
+    #ifdef MSD_LIMITED_RAM
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    if(g_usb_ep_stat[MSD_EP][OUT].Last_PPB == ODD) save_sector_part(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out_odd, 64);
+    else save_sector_part(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out_even, 64);
+    #else
+    save_sector_part(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out, 64);
+    #endif
+    #else
+    save_sector_part(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, 512);
+    #endif
+    #endif
+}
 
-}
\ No newline at end of file
+#ifdef MSD_WRITE_CACHE
+void msd_commit_sector(uint32_t lba, uint8_t* p_sect_data)
+{
+    #ifdef MSD_RAM_DISK
+    save_sector_part(lba, 0, p_sect_data, 512);
+    #endif
+}
+#endif
+
+#ifdef MSD_RAM_DISK
+bool msd_wr_protect(void)
+{
+    return ram_disk_full(); // Once a sector has been dropped, stop the host writing more.
+}
+
+static void save_sector_part(uint32_t lba, uint16_t offset, const uint8_t* p_data, uint16_t len)
+{
+    ram_disk_write((uint16_t)lba, offset, p_data, len); // On a full pool the data is dropped, and ram_disk_full() is set.
+    
+    // Sectors the ROM volume hasn't got read as zero, so a zeroed one doesn't need its slot.
+    #ifdef MSD_ROM_IMAGE
+    if((offset + len) == 512 && rom_image_blank((uint16_t)lba)) ram_disk_release_blank((uint16_t)lba);
+    #else
+    if((offset + len) == 512 && lba > FILE_SECT_ADDR) ram_disk_release_blank((uint16_t)lba);
+    #endif
+}
+#endif
\ No newline at end of file
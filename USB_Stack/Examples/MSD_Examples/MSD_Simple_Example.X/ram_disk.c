@@ -0,0 +1,163 @@
+/**
+ * @file ram_disk.c
+ * @brief Sparse RAM disk, holds only the sectors the host has written.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD Simple Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb_msd_config.h"
+
+#ifdef MSD_RAM_DISK // Only built for the MSD_RAM_DISK setting.
+#include "ram_disk.h"
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+#define FREE_LBA 0xFFFF
+
+static uint8_t  m_pool[RAM_DISK_SLOTS][512];
+static uint16_t m_slot_lba[RAM_DISK_SLOTS]; // LBA -> slot index, FREE_LBA when unused.
+static uint8_t  m_last_slot;                // Slot of the last hit, READ/WRITE_10 hit it 8 times a sector.
+static bool     m_full;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************** LOCAL FUNCTION PROTOTYPES ************************* */
+/* ************************************************************************** */
+
+/**
+ * @fn uint8_t find_slot(uint16_t lba)
+ * 
+ * @brief Looks the sector up in the index.
+ * 
+ * @param[in] lba Sector to find.
+ * @return Returns the slot, or RAM_DISK_NO_SLOT.
+ */
+static uint8_t find_slot(uint16_t lba);
+
+/**
+ * @fn void copy_bytes(const uint8_t *p_src, uint8_t *p_dst, uint16_t len)
+ * 
+ * @brief Copies RAM to RAM, usb_ram_copy() only does up to 255 bytes.
+ * 
+ * @param[in] p_src Source.
+ * @param[out] p_dst Destination.
+ * @param[in] len Amount of bytes.
+ */
+static void copy_bytes(const uint8_t *p_src, uint8_t *p_dst, uint16_t len);
+
+/* ************************************************************************** */
+
+
+void ram_disk_init(void)
+{
+    for(uint8_t i = 0; i < RAM_DISK_SLOTS; i++) m_slot_lba[i] = FREE_LBA;
+    m_last_slot = 0;
+    m_full      = false;
+}
+
+
+bool ram_disk_read(uint16_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    uint8_t slot = find_slot(lba);
+    
+    if(slot == RAM_DISK_NO_SLOT) return false;
+    copy_bytes(&m_pool[slot][offset], p_data, len);
+    return true;
+}
+
+
+bool ram_disk_write(uint16_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len)
+{
+    uint8_t slot = find_slot(lba);
+    
+    if(slot == RAM_DISK_NO_SLOT)
+    {
+        slot = find_slot(FREE_LBA);
+        if(slot == RAM_DISK_NO_SLOT)
+        {
+            m_full = true;
+            return false;
+        }
+        m_slot_lba[slot] = lba;
+    }
+    copy_bytes(p_data, &m_pool[slot][offset], len);
+    return true;
+}
+
+
+void ram_disk_release_blank(uint16_t lba)
+{
+    uint8_t slot = find_slot(lba);
+    
+    if(slot == RAM_DISK_NO_SLOT) return;
+    for(uint16_t i = 0; i < 512; i++)
+    {
+        if(m_pool[slot][i]) return;
+    }
+    m_slot_lba[slot] = FREE_LBA;
+}
+
+
+bool ram_disk_full(void)
+{
+    return m_full;
+}
+
+
+uint8_t* ram_disk_slot(uint8_t slot, uint16_t *p_lba)
+{
+    if(m_slot_lba[slot] == FREE_LBA) return NULL;
+    *p_lba = m_slot_lba[slot];
+    return m_pool[slot];
+}
+
+
+static uint8_t find_slot(uint16_t lba)
+{
+    if(m_slot_lba[m_last_slot] == lba) return m_last_slot;
+    for(uint8_t i = 0; i < RAM_DISK_SLOTS; i++)
+    {
+        if(m_slot_lba[i] == lba)
+        {
+            m_last_slot = i;
+            return i;
+        }
+    }
+    return RAM_DISK_NO_SLOT;
+}
+
+
+static void copy_bytes(const uint8_t *p_src, uint8_t *p_dst, uint16_t len)
+{
+    while(len--) *p_dst++ = *p_src++;
+}
+
+#endif /* MSD_RAM_DISK */
@@ -0,0 +1,154 @@
+/**
+ * @file ram_disk.h
+ * @brief Sparse RAM disk, holds only the sectors the host has written.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD Simple Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RAM_DISK_H
+#define RAM_DISK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* ************************** RAM DISK SETTINGS ***************************** */
+/* ************************************************************************** */
+
+/*
+ * Sectors written by the host are kept in a pool of RAM_DISK_SLOTS 512 byte 
+ * slots, found by LBA through a small index. Anything not in the pool reads as
+ * the constant ROM volume, and blank sectors are zero. A slot is handed back 
+ * when its sector is written with all zeros again, over a blank part of the 
+ * volume.
+ */
+#ifndef RAM_DISK_SLOTS
+#if defined(__J_PART)
+#define RAM_DISK_SLOTS 4 // 2KB of the 3.8KB.
+#elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+#define RAM_DISK_SLOTS 2 // 1KB of the 2KB.
+#else
+#error "RAM Disk: This part hasn't got the RAM for a pool, set RAM_DISK_SLOTS yourself."
+#endif
+#endif
+
+#define RAM_DISK_NO_SLOT 0xFF
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** RAM DISK GLOBAL FUNCTIONS ************************ */
+/* ************************************************************************** */
+
+/**
+ * @fn void ram_disk_init(void)
+ * 
+ * @brief Empties the pool.
+ */
+void ram_disk_init(void);
+
+/**
+ * @fn bool ram_disk_read(uint16_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads part of a sector, if it's in the pool.
+ * 
+ * @param[in] lba Sector to read.
+ * @param[in] offset Byte offset in the sector.
+ * @param[out] p_data Where to put the bytes.
+ * @param[in] len Amount of bytes, offset + len must be within the sector.
+ * @return Returns false if the sector isn't in the pool, p_data is untouched.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * if(ram_disk_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE)) return;
+ * @endcode
+ * </li></ul>
+ */
+bool ram_disk_read(uint16_t lba, uint16_t offset, uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn bool ram_disk_write(uint16_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Writes part of a sector into the pool.
+ * 
+ * A slot is taken for the sector the first time it's written. WRITE_10 always
+ * covers whole sectors, so the new slot doesn't need the ROM volume's data.
+ * 
+ * @param[in] lba Sector to write.
+ * @param[in] offset Byte offset in the sector.
+ * @param[in] p_data The bytes.
+ * @param[in] len Amount of bytes, offset + len must be within the sector.
+ * @return Returns false if the pool is full, the bytes are dropped.
+ */
+bool ram_disk_write(uint16_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn void ram_disk_release_blank(uint16_t lba)
+ * 
+ * @brief Frees the sector's slot if it only holds zeros.
+ * 
+ * Only call this for sectors that read as zero outside the pool.
+ * 
+ * @param[in] lba Sector that has just been written.
+ */
+void ram_disk_release_blank(uint16_t lba);
+
+/**
+ * @fn bool ram_disk_full(void)
+ * 
+ * @brief Tells if a write has been dropped because the pool was full.
+ * 
+ * Stays set until ram_disk_init(), so the volume can be reported write 
+ * protected from then on.
+ * 
+ * @return Returns true once a write has been dropped.
+ */
+bool ram_disk_full(void);
+
+/**
+ * @fn uint8_t* ram_disk_slot(uint8_t slot, uint16_t *p_lba)
+ * 
+ * @brief Gets a slot's sector, so firmware can commit it somewhere later.
+ * 
+ * @param[in] slot Slot number, 0 to RAM_DISK_SLOTS - 1.
+ * @param[out] p_lba The sector's LBA.
+ * @return Returns the slot's 512 bytes, or NULL if the slot is free.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * for(uint8_t i = 0; i < RAM_DISK_SLOTS; i++)
+ * {
+ *     if((p_sect = ram_disk_slot(i, &lba)) != NULL) save_sector(lba, p_sect);
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* ram_disk_slot(uint8_t slot, uint16_t *p_lba);
+
+/* ************************************************************************** */
+
+#endif /* RAM_DISK_H */
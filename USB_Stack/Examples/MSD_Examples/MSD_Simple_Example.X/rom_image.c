@@ -0,0 +1,159 @@
+/**
+ * @file rom_image.c
+ * @brief Reads sectors from a compressed ROM volume made by Tools/FAT_Image.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD Simple Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb_msd_config.h"
+
+#ifdef MSD_ROM_IMAGE // Only built for the MSD_ROM_IMAGE setting.
+#include "rom_image.h"
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static uint16_t m_last_run; // READ_10 asks for the same run over and over.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************** LOCAL FUNCTION PROTOTYPES ************************* */
+/* ************************************************************************** */
+
+/**
+ * @fn const uint8_t* find_sector(uint16_t lba)
+ * 
+ * @brief Finds a stored sector.
+ * 
+ * @param[in] lba Sector to find.
+ * @return Returns the sector's chunk lengths, or NULL for a blank sector.
+ */
+static const uint8_t* find_sector(uint16_t lba);
+
+/**
+ * @fn void decode_chunk(const uint8_t *p_src, uint8_t src_len, uint8_t *p_dst)
+ * 
+ * @brief Decodes a 64 byte chunk.
+ * 
+ * @param[in] p_src The chunk's tokens.
+ * @param[in] src_len Amount of token bytes, 0 for a blank chunk.
+ * @param[out] p_dst Where the 64 bytes go.
+ */
+static void decode_chunk(const uint8_t *p_src, uint8_t src_len, uint8_t *p_dst);
+
+/* ************************************************************************** */
+
+
+void rom_image_read(uint16_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    const uint8_t *p_lens = find_sector(lba);
+    const uint8_t *p_src;
+    uint8_t chunk = (uint8_t)(offset / ROM_IMAGE_CHUNK_SIZE);
+    
+    if(p_lens == NULL)
+    {
+        while(len--) *p_data++ = 0;
+        return;
+    }
+    
+    p_src = p_lens + 8;
+    for(uint8_t i = 0; i < chunk; i++) p_src += p_lens[i]; // Skip to the chunk asked for.
+    
+    while(len)
+    {
+        decode_chunk(p_src, p_lens[chunk], p_data);
+        p_src  += p_lens[chunk++];
+        p_data += ROM_IMAGE_CHUNK_SIZE;
+        len    -= ROM_IMAGE_CHUNK_SIZE;
+    }
+}
+
+
+bool rom_image_blank(uint16_t lba)
+{
+    return find_sector(lba) == NULL;
+}
+
+
+static const uint8_t* find_sector(uint16_t lba)
+{
+    uint16_t low, high, mid;
+    
+    if((uint16_t)(lba - g_rom_image_runs[m_last_run].lba) >= g_rom_image_runs[m_last_run].count) // Not in the last run, binary search.
+    {
+        low  = 0;
+        high = ROM_IMAGE_RUNS;
+        while(low < high)
+        {
+            mid = (low + high) / 2;
+            if(lba < g_rom_image_runs[mid].lba) high = mid;
+            else if((uint16_t)(lba - g_rom_image_runs[mid].lba) >= g_rom_image_runs[mid].count) low = mid + 1;
+            else break;
+        }
+        if(low >= high) return NULL;
+        m_last_run = mid;
+    }
+    return &g_rom_image_data[g_rom_image_sects[g_rom_image_runs[m_last_run].first_sect + (lba - g_rom_image_runs[m_last_run].lba)]];
+}
+
+
+static void decode_chunk(const uint8_t *p_src, uint8_t src_len, uint8_t *p_dst)
+{
+    const uint8_t *p_end = p_src + src_len;
+    uint8_t token, n;
+    
+    if(src_len == 0)
+    {
+        for(n = 0; n < ROM_IMAGE_CHUNK_SIZE; n++) p_dst[n] = 0;
+        return;
+    }
+    
+    while(p_src != p_end)
+    {
+        token = *p_src++;
+        if(token & 0x80) // Match, copied a byte at a time as it can overlap itself.
+        {
+            n = (uint8_t)(token - 0x80 + 3);
+            token = *p_src++; // Distance.
+            while(n--)
+            {
+                *p_dst = *(p_dst - token);
+                p_dst++;
+            }
+        }
+        else // Literal
+        {
+            n = (uint8_t)(token + 1);
+            while(n--) *p_dst++ = *p_src++;
+        }
+    }
+}
+
+#endif /* MSD_ROM_IMAGE */
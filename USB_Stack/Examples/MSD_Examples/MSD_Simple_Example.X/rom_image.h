@@ -0,0 +1,115 @@
+/**
+ * @file rom_image.h
+ * @brief Reads sectors from a compressed ROM volume made by Tools/FAT_Image.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD Simple Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ROM_IMAGE_H
+#define ROM_IMAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* ************************** ROM IMAGE FORMAT ****************************** */
+/* ************************************************************************** */
+
+/*
+ * Blank sectors aren't stored. The rest are grouped into runs of consecutive
+ * LBAs, g_rom_image_runs[], each run pointing at its first entry in 
+ * g_rom_image_sects[], the offset of the sector in g_rom_image_data[].
+ * 
+ * A stored sector starts with the compressed length of each of its eight 64 
+ * byte chunks (0 for a blank chunk), followed by the chunks. A chunk is a list
+ * of tokens:
+ *   0x00-0x7F  Literal, the next (token + 1) bytes are copied out.
+ *   0x80-0xFF  Match, (token - 0x80 + 3) bytes are copied from the distance 
+ *              in the next byte back, within the same chunk.
+ * Chunks only look back into themselves, so a chunk decodes straight into an
+ * EP buffer. MSD_LIMITED_RAM reads each IN packet without a sector buffer.
+ */
+
+#define ROM_IMAGE_CHUNK_SIZE 64
+
+/** A run of consecutive stored sectors. */
+typedef struct
+{
+    uint16_t lba;        ///< First LBA of the run.
+    uint16_t count;      ///< Amount of sectors.
+    uint16_t first_sect; ///< g_rom_image_sects[] index of lba.
+}rom_image_run_t;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************** GLOBAL VARS FROM: rom_image_data.c ****************** */
+/* ************************************************************************** */
+
+#include "rom_image_data.h"
+
+extern const rom_image_run_t g_rom_image_runs[ROM_IMAGE_RUNS];
+extern const uint32_t        g_rom_image_sects[ROM_IMAGE_SECTS];
+extern const uint8_t         g_rom_image_data[ROM_IMAGE_BYTES];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** ROM IMAGE GLOBAL FUNCTIONS *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void rom_image_read(uint16_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Decodes part of a sector.
+ * 
+ * @param[in] lba Sector to read.
+ * @param[in] offset Byte offset in the sector, a multiple of 64.
+ * @param[out] p_data Where to put the bytes.
+ * @param[in] len Amount of bytes, a multiple of 64.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * rom_image_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in, 64);
+ * @endcode
+ * </li></ul>
+ */
+void rom_image_read(uint16_t lba, uint16_t offset, uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn bool rom_image_blank(uint16_t lba)
+ * 
+ * @brief Tells if a sector isn't stored, so reads as zero.
+ * 
+ * @param[in] lba Sector to check.
+ * @return Returns true for a blank sector.
+ */
+bool rom_image_blank(uint16_t lba);
+
+/* ************************************************************************** */
+
+#endif /* ROM_IMAGE_H */
@@ -0,0 +1,79 @@
+// Generated by Tools/FAT_Image from Volume, don't edit.
+// 256 blocks, 7 stored, 860 bytes compressed from 3584.
+
+#include <stdint.h>
+#include "usb_msd_config.h"
+
+#ifdef MSD_ROM_IMAGE
+#include "rom_image.h"
+#include "rom_image_data.h"
+
+const rom_image_run_t g_rom_image_runs[ROM_IMAGE_RUNS] =
+{
+    {0, 7, 0},
+};
+
+const uint32_t g_rom_image_sects[ROM_IMAGE_SECTS] =
+{
+    0, 73, 90, 186, 257, 543, 567,
+};
+
+const uint8_t g_rom_image_data[ROM_IMAGE_BYTES] =
+{
+    0x3A,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x15,0xEB,0x3C,0x90,0x4D,0x53,0x44,0x4F,
+    0x53,0x35,0x2E,0x30,0x00,0x02,0x01,0x01,0x00,0x01,0x10,0x00,0x00,0x01,0xF8,0x80,
+    0x08,0x80,0x02,0x85,0x01,0x1B,0x80,0x00,0x29,0x86,0xE8,0xA3,0x56,0x55,0x53,0x42,
+    0x20,0x44,0x52,0x49,0x56,0x45,0x20,0x20,0x46,0x41,0x54,0x31,0x32,0x20,0x20,0x20,
+    0x00,0x00,0x00,0x00,0xBA,0x01,0x01,0x55,0xAA,0x09,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x01,0xF8,0xFF,0x84,0x01,0x00,0x00,0xB3,0x01,0x2B,0x2D,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x13,0x55,0x53,0x42,0x20,0x44,0x52,0x49,0x56,0x45,0x20,0x20,0x08,0x00,
+    0x00,0x7D,0x5F,0x6E,0x59,0x6E,0x59,0x83,0x08,0x00,0x00,0x82,0x01,0x04,0x44,0x4F,
+    0x43,0x53,0x20,0x83,0x01,0x00,0x10,0x8B,0x20,0x00,0x02,0x82,0x20,0x13,0x48,0x45,
+    0x4C,0x4C,0x4F,0x20,0x20,0x20,0x54,0x58,0x54,0x20,0x00,0x00,0x7D,0x5F,0x6E,0x59,
+    0x6E,0x59,0x83,0x08,0x0B,0x04,0x00,0x0C,0x00,0x00,0x00,0x52,0x45,0x41,0x44,0x4D,
+    0x45,0x91,0x20,0x05,0x05,0x00,0x1F,0x01,0x00,0x00,0x20,0x1F,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x01,0x2E,0x20,0x86,0x01,0x08,0x10,0x00,0x00,0x7D,0x5F,0x6E,0x59,0x6E,
+    0x59,0x83,0x08,0x01,0x02,0x00,0x81,0x01,0x00,0x2E,0x87,0x21,0x8C,0x20,0x82,0x1F,
+    0x00,0x00,0x13,0x46,0x4F,0x52,0x4D,0x41,0x54,0x20,0x20,0x54,0x58,0x54,0x20,0x00,
+    0x00,0x7D,0x5F,0x6E,0x59,0x6E,0x59,0x83,0x08,0x04,0x03,0x00,0x1A,0x01,0x00,0x9E,
+    0x01,0x35,0x41,0x41,0x41,0x1E,0x00,0x00,0x00,0x11,0x52,0x4F,0x4D,0x20,0x69,0x6D,
+    0x61,0x67,0x65,0x20,0x66,0x6F,0x72,0x6D,0x61,0x74,0x0A,0x3D,0x8C,0x01,0x17,0x0A,
+    0x0A,0x42,0x6C,0x61,0x6E,0x6B,0x20,0x73,0x65,0x63,0x74,0x6F,0x72,0x73,0x20,0x61,
+    0x72,0x65,0x6E,0x27,0x74,0x20,0x73,0x80,0x0D,0x03,0x65,0x64,0x2E,0x20,0x33,0x54,
+    0x68,0x65,0x20,0x6F,0x74,0x68,0x65,0x72,0x73,0x20,0x61,0x72,0x65,0x20,0x6B,0x65,
+    0x70,0x74,0x20,0x61,0x73,0x20,0x65,0x69,0x67,0x68,0x74,0x20,0x36,0x34,0x20,0x62,
+    0x79,0x74,0x65,0x20,0x63,0x68,0x75,0x6E,0x6B,0x73,0x2C,0x0A,0x65,0x61,0x63,0x68,
+    0x20,0x6F,0x6E,0x80,0x11,0x08,0x6F,0x6D,0x70,0x72,0x65,0x73,0x73,0x65,0x64,0x3F,
+    0x20,0x6F,0x6E,0x20,0x69,0x74,0x73,0x20,0x6F,0x77,0x6E,0x20,0x77,0x69,0x74,0x68,
+    0x20,0x6C,0x69,0x74,0x65,0x72,0x61,0x6C,0x20,0x72,0x75,0x6E,0x73,0x20,0x61,0x6E,
+    0x64,0x20,0x73,0x68,0x6F,0x72,0x74,0x20,0x62,0x61,0x63,0x6B,0x20,0x72,0x65,0x66,
+    0x65,0x72,0x65,0x6E,0x63,0x65,0x73,0x2C,0x0A,0x73,0x6F,0x20,0x61,0x20,0x63,0x68,
+    0x20,0x75,0x6E,0x6B,0x20,0x63,0x61,0x6E,0x20,0x62,0x65,0x20,0x64,0x65,0x63,0x6F,
+    0x64,0x65,0x64,0x20,0x73,0x74,0x72,0x61,0x69,0x67,0x68,0x74,0x20,0x69,0x6E,0x74,
+    0x6F,0x20,0x80,0x1C,0x07,0x49,0x4E,0x20,0x65,0x6E,0x64,0x70,0x6F,0x80,0x10,0x10,
+    0x20,0x62,0x75,0x66,0x66,0x65,0x72,0x2E,0x0A,0x0A,0x53,0x65,0x65,0x20,0x72,0x6F,
+    0x6D,0x1A,0x5F,0x69,0x6D,0x61,0x67,0x65,0x2E,0x68,0x20,0x66,0x6F,0x72,0x20,0x74,
+    0x68,0x65,0x20,0x64,0x65,0x74,0x61,0x69,0x6C,0x73,0x2E,0x0A,0x00,0xA2,0x01,0x10,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0C,0x48,0x65,0x6C,0x6C,0x6F,0x20,0x57,0x6F,
+    0x72,0x6C,0x64,0x21,0x00,0xB0,0x01,0x3E,0x3E,0x3F,0x3F,0x23,0x00,0x00,0x00,0x0B,
+    0x54,0x68,0x69,0x73,0x20,0x76,0x6F,0x6C,0x75,0x6D,0x65,0x20,0x80,0x0A,0x0F,0x62,
+    0x75,0x69,0x6C,0x74,0x20,0x66,0x72,0x6F,0x6D,0x20,0x74,0x68,0x65,0x20,0x56,0x83,
+    0x19,0x1A,0x66,0x6F,0x6C,0x64,0x65,0x72,0x20,0x62,0x79,0x20,0x54,0x6F,0x6F,0x6C,
+    0x73,0x2F,0x46,0x41,0x54,0x5F,0x49,0x6D,0x61,0x67,0x65,0x2E,0x0A,0x19,0x0A,0x50,
+    0x75,0x74,0x20,0x74,0x68,0x65,0x20,0x66,0x69,0x6C,0x65,0x73,0x20,0x79,0x6F,0x75,
+    0x20,0x77,0x61,0x6E,0x74,0x20,0x6F,0x6E,0x82,0x16,0x0F,0x64,0x72,0x69,0x76,0x65,
+    0x20,0x69,0x6E,0x20,0x56,0x6F,0x6C,0x75,0x6D,0x65,0x2C,0x81,0x15,0x0C,0x6E,0x20,
+    0x72,0x75,0x6E,0x3A,0x0A,0x20,0x20,0x66,0x61,0x74,0x5F,0x18,0x69,0x6D,0x61,0x67,
+    0x65,0x20,0x56,0x6F,0x6C,0x75,0x6D,0x65,0x20,0x2D,0x2D,0x62,0x6C,0x6F,0x63,0x6B,
+    0x73,0x20,0x32,0x35,0x36,0x80,0x0D,0x07,0x6F,0x75,0x74,0x20,0x72,0x6F,0x6D,0x5F,
+    0x82,0x24,0x16,0x5F,0x64,0x61,0x74,0x61,0x0A,0x0A,0x54,0x68,0x65,0x20,0x73,0x65,
+    0x63,0x74,0x6F,0x72,0x73,0x20,0x61,0x72,0x65,0x20,0x0E,0x73,0x74,0x6F,0x72,0x65,
+    0x64,0x20,0x63,0x6F,0x6D,0x70,0x72,0x65,0x73,0x73,0x80,0x0B,0x0F,0x69,0x6E,0x20,
+    0x52,0x4F,0x4D,0x20,0x61,0x6E,0x64,0x20,0x64,0x65,0x63,0x6F,0x64,0x80,0x13,0x0F,
+    0x61,0x73,0x20,0x74,0x68,0x65,0x20,0x68,0x6F,0x73,0x74,0x20,0x72,0x65,0x61,0x64,
+    0x82,0x0F,0x05,0x6D,0x2C,0x0A,0x62,0x6C,0x61,0x1F,0x6E,0x6B,0x20,0x73,0x65,0x63,
+    0x74,0x6F,0x72,0x73,0x20,0x74,0x61,0x6B,0x65,0x20,0x6E,0x6F,0x20,0x52,0x4F,0x4D,
+    0x20,0x61,0x74,0x20,0x61,0x6C,0x6C,0x2E,0x0A,0x00,0x9D,0x01,
+};
+
+#endif /* MSD_ROM_IMAGE */
@@ -0,0 +1,11 @@
+// Generated by Tools/FAT_Image from Volume, don't edit.
+
+#ifndef ROM_IMAGE_DATA_H
+#define ROM_IMAGE_DATA_H
+
+#define ROM_IMAGE_BLOCKS 256
+#define ROM_IMAGE_RUNS   1
+#define ROM_IMAGE_SECTS  7
+#define ROM_IMAGE_BYTES  860
+
+#endif /* ROM_IMAGE_DATA_H */
@@ -34,7 +34,19 @@
 // External Media Support
 //#define USE_EXTERNAL_MEDIA
 
+// ROM Image
+//#define MSD_ROM_IMAGE // Serve the compressed volume in rom_image_data.c instead of the hard-coded one.
+                        // Rebuild it with Tools/FAT_Image from the Volume folder (see rom_image.h).
+
+// RAM Disk
+//#define MSD_RAM_DISK // Sectors the host writes are kept in a sparse RAM pool (see ram_disk.h),
+                       // on top of the ROM volume. Parts with 2KB+ of RAM only.
+
 // Support SCSI Command
+#ifdef MSD_RAM_DISK
+#define USE_WRITE_10
+#define USE_WR_PROTECT // Reported once the pool has filled.
+#endif
 //#define USE_WRITE_10
 //#define USE_PREVENT_ALLOW_MEDIUM_REMOVAL
 //#define USE_VERIFY_10
@@ -43,16 +55,24 @@
 //#define USE_TEST_UNIT_READY
 //#define USE_START_STOP_UNIT
 //#define USE_READ_CAPACITY   // if not defined use the constant defines for capacity below. 
+//#define USE_RW_12_16        // READ_12/16, WRITE_12/16 (with USE_WRITE_10) and READ_CAPACITY_16.
 
 // CAPACITY
 #define BYTES_PER_BLOCK_LE 0x200 // 512
 #define BYTES_PER_BLOCK_BE 0x00020000UL // Big-endian version
 
+#ifdef MSD_ROM_IMAGE
+#include "rom_image_data.h" // Capacity comes with the image.
+#define VOL_CAPACITY_IN_BYTES  ((uint32_t)ROM_IMAGE_BLOCKS * BYTES_PER_BLOCK_LE)
+#define VOL_CAPACITY_IN_BLOCKS ROM_IMAGE_BLOCKS
+
+#define LAST_BLOCK_LE (ROM_IMAGE_BLOCKS - 1)
+#else
 #define VOL_CAPACITY_IN_BYTES 0x20000UL // 128KB
 #define VOL_CAPACITY_IN_BLOCKS 0x100 // 256
 
 #define LAST_BLOCK_LE 0xFF // 255 (VOL_CAPACITY_IN_BLOCKS - 1)
-#define LAST_BLOCK_BE 0xFF000000UL // Big-endian version
+#endif
 
 // MSD Endpoint HAL
 #define MSD_EP EP1
@@ -81,4 +101,46 @@ Use R_W_10_Vars.LBA in combination with g_msd_byte_of_sect to find locations in
                         // of Sector locations using g_msd_rw_10_vars.LBA in combination 
                         // with g_msd_byte_of_sect.
 
+//#define MSD_READ_PREFETCH // Double buffers sectors during READ_10. The next sector is
+                          // fetched with msd_rx_sector_async() while the current one 
+                          // is sent, hiding slow media access. Needs an extra 512 bytes 
+                          // of RAM and MSD_LIMITED_RAM to be undefined.
+
+//#define MSD_WRITE_CACHE // Write behind cache for WRITE_10. Sectors are buffered in RAM
+                        // and the CSW is returned straight away, msd_flush_tasks() then 
+                        // commits them with msd_commit_sector(). Needs an extra 512 bytes 
+                        // of RAM, USE_WRITE_10 and MSD_LIMITED_RAM to be undefined.
+
+//#define MSD_DIRECT_WRITE // WRITE_10 packets are received straight into g_msd_sect_data by
+                         // re-pointing the OUT BD, instead of copying from the Endpoint. 
+                         // Needs g_msd_sect_data in SIE reachable RAM (falls back to 
+                         // copying if not), USE_WRITE_10, MSD_LIMITED_RAM and 
+                         // MSD_WRITE_CACHE undefined, and no ping-pong on MSD's Endpoints.
+
+//#define MSD_ASYNC_MEDIA // msd_rx_sector() and msd_tx_sector() may return MSD_MEDIA_PENDING
+                        // and finish later, calling msd_media_complete(). MSD's Endpoints
+                        // are left unarmed meanwhile (the host is NAKed), so EP0 and other
+                        // interfaces keep running during slow erases. Needs MSD_LIMITED_RAM,
+                        // MSD_READ_PREFETCH and MSD_WRITE_CACHE undefined.
+
+//#define MSD_ARENA // g_msd_sect_data, and the MSD_READ_PREFETCH and MSD_WRITE_CACHE buffers,
+                  // are the msd state of g_usb_arena (see usb.h), so RAM can be shared 
+                  // with states that never run alongside MSD, e.g. another configuration. 
+                  // Flush the write cache before leaving the state. Needs USE_ARENA, 
+                  // X(msd, 512) in USB_ARENA_STATES (512 more per extra buffer), and 
+                  // MSD_LIMITED_RAM undefined.
+
+//#define MSD_IMAGE_CRC // Keeps a CRC-32 of the sectors WRITE_10 receives and of the ones
+                      // VERIFY_10 reads back, for the vendor MSD_IMAGE_CRC_CMD (0xC0).
+                      // A flashing tool can then check an image with VERIFY_10 instead 
+                      // of reading it over USB. Uses 1KB of ROM for the CRC table,
+                      // the verify CRC needs USE_VERIFY_10.
+
+//#define MSD_MOUNT_STATS // Frames from the first CBW to the first READ, the commands failed 
+                        // meanwhile and the first unsupported opcodes, read with msd_get_mount_stats().
+
+//#define MSD_TASK_QUEUE_SIZE 8 // Endpoint transactions msd_add_task() can queue for msd_tasks(),
+                              // a power of two (default 4). Raise it if g_msd_task_overflows
+                              // counts, e.g. when the main loop is slow to call msd_tasks().
+
 #endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+ * @file eeprom.c
+ * @brief EEPROM.BIN, the data EEPROM as a file of the virtual volume.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD VFAT Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_msd_config.h"
+#ifdef MSD_EEPROM
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_msd.h"
+#include "eeprom.h"
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+#ifdef MSD_ASYNC_MEDIA
+static const uint8_t *m_p_src; // Rest of the data being written, m_left bytes of it.
+static uint8_t       m_addr;   // EEPROM address of *m_p_src.
+static uint16_t      m_left;
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+static uint8_t read_byte(uint8_t addr);
+static void    start_write(uint8_t addr, uint8_t data);
+#ifdef MSD_ASYNC_MEDIA
+static bool    start_next(void);
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void eeprom_read(uint32_t offset, uint8_t *p_data, uint16_t len)
+{
+    uint8_t addr = (uint8_t)offset;
+
+    while(len--) *p_data++ = read_byte(addr++);
+}
+
+uint8_t eeprom_write(uint32_t offset, const uint8_t *p_data, uint16_t len)
+{
+    #ifdef MSD_ASYNC_MEDIA
+    m_p_src = p_data;
+    m_addr  = (uint8_t)offset;
+    m_left  = len;
+    if(!start_next()) return MSD_MEDIA_DONE; // Nothing changed.
+    EEPROM_INTERRUPT_FLAG   = 0;
+    EEPROM_INTERRUPT_ENABLE = 1;
+    return MSD_MEDIA_PENDING;
+    #else
+    uint8_t addr = (uint8_t)offset;
+
+    for(; len; len--, p_data++, addr++)
+    {
+        if(read_byte(addr) == *p_data) continue;
+        start_write(addr, *p_data);
+        while(EECON1bits.WR);
+    }
+    EECON1bits.WREN = 0;
+    EEPROM_INTERRUPT_FLAG = 0;
+    return MSD_MEDIA_DONE;
+    #endif
+}
+
+void eeprom_tasks(void)
+{
+    #ifdef MSD_ASYNC_MEDIA
+    if(!(EEPROM_INTERRUPT_ENABLE && EEPROM_INTERRUPT_FLAG)) return;
+    EEPROM_INTERRUPT_FLAG = 0;
+    if(start_next()) return;
+    EEPROM_INTERRUPT_ENABLE = 0;
+    msd_media_complete();
+    #endif
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+static uint8_t read_byte(uint8_t addr)
+{
+    EECON1 = 0x00; // EEPROM.
+    EEADR  = addr;
+    EECON1bits.RD = 1;
+    return EEDATA;
+}
+
+static void start_write(uint8_t addr, uint8_t data)
+{
+    bool gie = INTCONbits.GIE;
+
+    EEADR  = addr;
+    EEDATA = data;
+    EECON1 = 0x04; // EEPROM, WREN.
+    INTCONbits.GIE = 0;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+    INTCONbits.GIE = gie;
+}
+
+#ifdef MSD_ASYNC_MEDIA
+/*
+ * Starts writing the next byte that differs, returns false once there are
+ * none left.
+ */
+static bool start_next(void)
+{
+    uint8_t data;
+
+    for(; m_left; m_left--, m_addr++)
+    {
+        data = *m_p_src++;
+        if(read_byte(m_addr) == data) continue;
+        start_write(m_addr++, data);
+        m_left--;
+        return true;
+    }
+    EECON1bits.WREN = 0;
+    return false;
+}
+#endif
+
+/* ************************************************************************** */
+
+#endif /* MSD_EEPROM */
@@ -0,0 +1,108 @@
+/**
+ * @file eeprom.h
+ * @brief EEPROM.BIN, the data EEPROM as a file of the virtual volume.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD VFAT Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* **************************** EEPROM SETTINGS ***************************** */
+/* ************************************************************************** */
+
+/*
+ * A byte write takes about 4ms, so a saved file is compared with the EEPROM
+ * and only the bytes that changed are written, which also saves their wear.
+ * With MSD_ASYNC_MEDIA the writes run in the background: msd_tx_sector()
+ * returns MSD_MEDIA_PENDING, each write complete interrupt starts the next
+ * changed byte, and the last one calls msd_media_complete(). Otherwise they're
+ * written one after the other before msd_tx_sector() returns.
+ * 
+ * The host has to save the file in place, a new file written elsewhere on the
+ * volume is dropped.
+ */
+#if !defined(_EEPROMSIZE) || _EEPROMSIZE == 0
+#error "EEPROM: This part has no data EEPROM, undefine MSD_EEPROM."
+#endif
+
+#define EEPROM_SIZE _EEPROMSIZE // Size of EEPROM.BIN.
+
+#define EEPROM_INTERRUPT_FLAG   PIR2bits.EEIF
+#define EEPROM_INTERRUPT_ENABLE PIE2bits.EEIE
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ EEPROM GLOBAL FUNCTIONS ************************* */
+/* ************************************************************************** */
+
+/**
+ * @fn void eeprom_read(uint32_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads EEPROM.BIN, a vfat_read_t callback.
+ * 
+ * @param[in] offset Byte of the file to start at.
+ * @param[out] p_data Buffer the data is read into.
+ * @param[in] len Amount of bytes to read.
+ */
+void eeprom_read(uint32_t offset, uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn uint8_t eeprom_write(uint32_t offset, const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Writes EEPROM.BIN, a vfat_write_t callback.
+ * 
+ * Only bytes that differ from the EEPROM are written. With MSD_ASYNC_MEDIA
+ * p_data has to stay put until msd_media_complete() is called, which
+ * g_msd_sect_data does.
+ * 
+ * @param[in] offset Byte of the file to start at.
+ * @param[in] p_data Data to write.
+ * @param[in] len Amount of bytes to write.
+ * 
+ * @return Returns MSD_MEDIA_PENDING if bytes are still being written,
+ * otherwise MSD_MEDIA_DONE.
+ */
+uint8_t eeprom_write(uint32_t offset, const uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn void eeprom_tasks(void)
+ * 
+ * @brief Moves on to the next changed byte once a write has finished.
+ * 
+ * Call it from the interrupt, or from the main loop with USE_POLLING. It
+ * returns straight away unless the write complete flag is set.
+ */
+void eeprom_tasks(void);
+
+/* ************************************************************************** */
+
+#endif /* EEPROM_H */
@@ -0,0 +1,400 @@
+/**
+ * @file main.c
+ * @brief Main C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD VFAT Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include "fuses.h"
+#include "config.h"
+#include "usb.h"
+#include "usb_msd.h"
+#include "vfat.h"
+#ifdef MSD_UF2
+#include "uf2.h"
+#endif
+#ifdef MSD_EEPROM
+#include "eeprom.h"
+#endif
+
+/*
+ * Virtual FAT volume, see vfat.h. Only the file table below is stored, the 
+ * boot sector, FAT and root directory are made up as they're read, and each 
+ * file's data comes from its read callback straight into the Endpoint buffer.
+ * PATTERN.BIN shows a file far bigger than the part's flash, every 32-bit 
+ * word of it holds its own offset so a host can check what it reads.
+ * 
+ * With MSD_UF2 it works like a UF2 bootloader instead. CURRENT.UF2 reads the
+ * application's flash back as UF2 blocks, and a UF2 file copied to the drive
+ * is programmed block by block as it's written. Once every block is in, the 
+ * part restarts.
+ * 
+ * With MSD_EEPROM there's also EEPROM.BIN, which can be edited and saved in
+ * place. Only the bytes that changed are written to the EEPROM.
+ */
+
+#if _HTC_EDITION_ == 0
+#error "Use optimization level 2 and above."
+#endif
+
+static void example_init(void);
+#ifdef USE_BOOT_LED
+static void flash_led(void);
+#endif
+static void read_readme(uint32_t offset, uint8_t *p_data, uint16_t len);
+#ifndef MSD_UF2
+static void read_pattern(uint32_t offset, uint8_t *p_data, uint16_t len);
+#else
+static void restart(void);
+#endif
+static void __interrupt() isr(void);
+
+#ifdef MSD_UF2
+static const uint8_t m_readme[] = "UF2 Bootloader\r\n"
+                                  "Model: USB uC MSD VFAT Example\r\n";
+
+const vfat_file_t g_vfat_files[VFAT_NUM_FILES] =
+{
+    {{'I','N','F','O','_','U','F','2','T','X','T'}, VFAT_ATTR_READ_ONLY, sizeof(m_readme) - 1, read_readme, NULL},
+    {{'C','U','R','R','E','N','T',' ','U','F','2'}, VFAT_ATTR_READ_ONLY, UF2_CURRENT_SIZE, uf2_read_current, NULL}
+};
+#else
+static const uint8_t m_readme[] = "Virtual FAT volume.\r\n"
+                                  "Nothing on this drive is stored, it's all made up as it's read.\r\n";
+
+const vfat_file_t g_vfat_files[VFAT_NUM_FILES] =
+{
+    {{'R','E','A','D','M','E',' ',' ','T','X','T'}, VFAT_ATTR_READ_ONLY, sizeof(m_readme) - 1, read_readme, NULL},
+    {{'P','A','T','T','E','R','N',' ','B','I','N'}, VFAT_ATTR_READ_ONLY, 0x100000UL, read_pattern, NULL}, // 1 MB
+    #ifdef MSD_EEPROM
+    {{'E','E','P','R','O','M',' ',' ','B','I','N'}, VFAT_ATTR_ARCHIVE, EEPROM_SIZE, eeprom_read, eeprom_write}
+    #endif
+};
+#endif
+
+void main(void)
+{
+    example_init();
+    #ifdef USE_BOOT_LED
+    LED_OFF();
+    LED_OUPUT();
+    flash_led();
+    #endif
+    
+    vfat_init();
+    
+    usb_init();
+    #ifndef USE_POLLING
+    INTCONbits.PEIE = 1;
+    USB_INTERRUPT_FLAG = 0;
+    USB_INTERRUPT_ENABLE = 1;
+    INTCONbits.GIE = 1;
+    #endif
+    
+    while(usb_get_state() != STATE_CONFIGURED)
+    {
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+    }
+    while(1)
+    {
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+        #ifdef USE_DEFERRED_TASKS
+        usb_deferred_tasks();
+        #endif
+        msd_tasks();
+        #ifdef MSD_WRITE_CACHE
+        msd_flush_tasks();
+        #endif
+        #ifdef MSD_UF2
+        if(uf2_done()) restart();
+        #endif
+        #if defined(MSD_EEPROM) && defined(USE_POLLING)
+        eeprom_tasks();
+        #endif
+    }
+}
+
+static void __interrupt() isr(void)
+{
+    if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
+    {
+        usb_tasks();
+        USB_INTERRUPT_FLAG = 0;
+    }
+    #ifdef MSD_EEPROM
+    eeprom_tasks(); // Next changed byte of EEPROM.BIN.
+    #endif
+}
+
+static void example_init(void)
+{
+    // Oscillator Settings.
+    // PIC16F145X.
+    #if defined(_PIC14E)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 0xF;
+    #endif
+    #if XTAL_USED != MHz_12
+    OSCCONbits.SPLLMULT = 1;
+    #endif
+    OSCCONbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18FX450, PIC18FX550, and PIC18FX455.
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F14K50.
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    OSCTUNEbits.SPLLEN = 1;
+    PLL_STARTUP_DELAY();
+    
+    // PIC18F2XK50.
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    #if XTAL_USED == NO_XTAL
+    OSCCONbits.IRCF = 7;
+    #endif
+    #if (XTAL_USED != MHz_12)
+    OSCTUNEbits.SPLLMULT = 1;
+    #endif
+    OSCCON2bits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #if XTAL_USED == NO_XTAL
+    ACTCONbits.ACTSRC = 1;
+    ACTCONbits.ACTEN = 1;
+    #endif
+
+    // PIC18F2XJ53 and PIC18F4XJ53.
+    #elif defined(__J_PART)
+    OSCTUNEbits.PLLEN = 1;
+    PLL_STARTUP_DELAY();
+    #endif
+
+    
+    // Make boot pin digital.
+    #if defined(BUTTON_ANSEL) 
+    BUTTON_ANSEL &= ~(1<<BUTTON_ANSEL_BIT);
+    #elif defined(BUTTON_ANCON)
+    BUTTON_ANCON |= (1<<BUTTON_ANCON_BIT);
+    #endif
+
+
+    // Apply pull-up.
+    #ifdef BUTTON_WPU
+    #if defined(_PIC14E)
+    WPUA = 0;
+    #if defined(_16F1459)
+    WPUB = 0;
+    #endif
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    OPTION_REGbits.nWPUEN = 0;
+    
+    #elif defined(_18F4450_FAMILY_) || defined(_18F4550_FAMILY_)
+    LATB = 0;
+    LATD = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    #if BUTTON_RXPU_REG == INTCON2
+    INTCON2 &= 7F;
+    #else
+    PORTE |= 80;
+    #endif
+    
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    WPUA = 0;
+    WPUB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRABPU = 0;
+    
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    WPUB = 0;
+    TRISE &= 0x7F;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    INTCON2bits.nRBPU = 0;
+    
+    #elif defined(_18F24J50) || defined(_18F25J50) || defined(_18F26J50) || defined(_18F26J53) || defined(_18F27J53)
+    LATB = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    
+    #elif defined(_18F44J50) || defined(_18F45J50) || defined(_18F46J50) || defined(_18F46J53) || defined(_18F47J53)
+    LATB = 0;
+    LATD = 0;
+    LATE = 0;
+    BUTTON_WPU |= (1 << BUTTON_WPU_BIT);
+    BUTTON_RXPU_REG &= ~(1 << BUTTON_RXPU_BIT);
+    #endif
+    #endif
+}
+
+#ifdef USE_BOOT_LED
+static void flash_led(void)
+{
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        LED_ON();
+        __delay_ms(500);
+        LED_OFF();
+        __delay_ms(500);
+    }
+}
+#endif
+
+#ifdef MSD_ASYNC_MEDIA
+uint8_t msd_rx_sector(void)
+{
+    vfat_read(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, BYTES_PER_BLOCK_LE);
+    return MSD_MEDIA_DONE; // Made up on the spot.
+}
+#else
+void msd_rx_sector(void)
+{
+    #ifdef MSD_LIMITED_RAM
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    if(MSD_EP_IN_LAST_PPB == ODD) vfat_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in_odd, MSD_EP_SIZE);
+    else vfat_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in_even, MSD_EP_SIZE);
+    #else
+    vfat_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE);
+    #endif
+    #else
+    vfat_read(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, BYTES_PER_BLOCK_LE);
+    #endif
+}
+#endif
+
+#ifdef MSD_READ_PREFETCH
+void msd_rx_sector_async(uint32_t lba, uint8_t* p_sect_data)
+{
+    vfat_read(lba, 0, p_sect_data, BYTES_PER_BLOCK_LE); // Made up on the spot, so ready straight away.
+    msd_rx_sector_complete();
+}
+#endif
+
+#ifdef MSD_ASYNC_MEDIA
+uint8_t msd_tx_sector(void)
+{
+    #ifdef MSD_UF2
+    uf2_write(0, g_msd_sect_data, BYTES_PER_BLOCK_LE);
+    return MSD_MEDIA_DONE;
+    #else
+    return vfat_write(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, BYTES_PER_BLOCK_LE); // EEPROM.BIN finishes from its interrupt.
+    #endif
+}
+#else
+void msd_tx_sector(void)
+{
+    #ifdef MSD_UF2
+    #ifdef MSD_LIMITED_RAM
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    if(MSD_EP_OUT_LAST_PPB == ODD) uf2_write(g_msd_byte_of_sect, g_msd_ep_out_odd, MSD_EP_SIZE);
+    else uf2_write(g_msd_byte_of_sect, g_msd_ep_out_even, MSD_EP_SIZE);
+    #else
+    uf2_write(g_msd_byte_of_sect, g_msd_ep_out, MSD_EP_SIZE);
+    #endif
+    #else
+    uf2_write(0, g_msd_sect_data, BYTES_PER_BLOCK_LE);
+    #endif
+    #elif defined(MSD_EEPROM)
+    #ifdef MSD_LIMITED_RAM
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    if(MSD_EP_OUT_LAST_PPB == ODD) vfat_write(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out_odd, MSD_EP_SIZE);
+    else vfat_write(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out_even, MSD_EP_SIZE);
+    #else
+    vfat_write(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_out, MSD_EP_SIZE);
+    #endif
+    #else
+    vfat_write(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, BYTES_PER_BLOCK_LE);
+    #endif
+    #endif
+    // Otherwise a read only volume.
+}
+#endif
+
+#if defined(MSD_EEPROM) && defined(MSD_WRITE_CACHE)
+void msd_commit_sector(uint32_t lba, uint8_t* p_sect_data)
+{
+    vfat_write(lba, 0, p_sect_data, BYTES_PER_BLOCK_LE);
+}
+#endif
+
+#ifdef MSD_UF2
+#ifdef MSD_WRITE_CACHE
+void msd_commit_sector(uint32_t lba, uint8_t* p_sect_data)
+{
+    uf2_write(0, p_sect_data, BYTES_PER_BLOCK_LE); // Where the host puts the block doesn't matter.
+}
+#endif
+
+uint8_t msd_test_unit_ready(void)
+{
+    uf2_flush(); // Host has gone idle.
+    return 0;
+}
+
+/*
+ * Lets the last CSW go out, then restarts. A bootloader would now start the
+ * new application.
+ */
+static void restart(void)
+{
+    for(uint8_t i = 0; i < 100; i++)
+    {
+        #ifdef USE_POLLING
+        usb_tasks();
+        #endif
+        msd_tasks();
+        __delay_ms(1);
+    }
+    RESET();
+}
+#endif
+
+static void read_readme(uint32_t offset, uint8_t *p_data, uint16_t len)
+{
+    const uint8_t *p_src = &m_readme[offset];
+    
+    while(len--) *p_data++ = *p_src++;
+}
+
+#ifndef MSD_UF2
+static void read_pattern(uint32_t offset, uint8_t *p_data, uint16_t len)
+{
+    for(; len >= 4; len -= 4, offset += 4) // Offsets are 32 byte aligned, and the size is a multiple of 4.
+    {
+        *p_data++ = (uint8_t)offset;
+        *p_data++ = (uint8_t)(offset >> 8);
+        *p_data++ = (uint8_t)(offset >> 16);
+        *p_data++ = (uint8_t)(offset >> 24);
+    }
+}
+#endif
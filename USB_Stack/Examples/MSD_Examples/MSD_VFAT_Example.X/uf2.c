@@ -0,0 +1,282 @@
+/**
+ * @file uf2.c
+ * @brief UF2 firmware update C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD VFAT Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_msd_config.h"
+
+#ifdef MSD_UF2
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "flash.h"
+#include "uf2.h"
+
+/* ************************************************************************** */
+/* ****************************** UF2 FORMAT ******************************** */
+/* ************************************************************************** */
+
+#define MAGIC_START0 0x0A324655UL // "UF2\n"
+#define MAGIC_START1 0x9E5D5157UL
+#define MAGIC_END    0x0AB16F30UL
+
+// Header, little-endian 32-bit words.
+#define HDR_MAGIC0   0
+#define HDR_MAGIC1   4
+#define HDR_FLAGS    8
+#define HDR_ADDR     12
+#define HDR_SIZE     16
+#define HDR_BLOCK_NO 20
+#define HDR_BLOCKS   24
+#define HDR_FAMILY   28
+#define HDR_LEN      32
+
+#define DATA_MAX     476
+#define MAGIC_END_AT 508
+
+#define FLAG_NOT_MAIN_FLASH 0x00000001UL
+#define FLAG_FILE_CONTAINER 0x00001000UL
+#define FLAG_FAMILY_ID      0x00002000UL
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** FLASH DEFINES ****************************** */
+/* ************************************************************************** */
+
+#if defined(_PIC14E)
+#define ARRAY_ERASE_SIZE (_FLASH_ERASE_SIZE * 2)  // Two bytes per word.
+#define FLASH_ADDR(byte) ((uint16_t)((byte) >> 1))
+#else
+#define ARRAY_ERASE_SIZE _FLASH_ERASE_SIZE
+#define FLASH_ADDR(byte) ((uint24_t)(byte))
+#endif
+
+#define SEEN_BLOCKS (((UF2_APP_BLOCKS + 7) / 8) * 8) // Block numbers tracked in m_seen.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static bool     m_block_ok;   // Block being written is one we're taking.
+static uint32_t m_target;     // Its payload address, size and number.
+static uint16_t m_payload;
+static uint32_t m_block_no;
+static uint32_t m_num_blocks; // Of the UF2 file being written.
+static uint32_t m_blocks_seen;
+static uint8_t  m_seen[SEEN_BLOCKS / 8];
+static bool     m_done;
+
+static uint32_t m_stage_addr; // Erase block gathered in m_stage, 0 for none (below UF2_APP_START).
+static bool     m_stage_dirty;
+static uint8_t  m_stage[ARRAY_ERASE_SIZE];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** LOCAL FUNCTION DECLARATIONS ********************** */
+/* ************************************************************************** */
+
+static uint32_t get_u32(const uint8_t *p_data);
+static void     put_u32(uint8_t *p_data, uint32_t val);
+static bool     take_header(const uint8_t *p_data);
+static void     block_written(void);
+static void     stage(uint32_t addr, uint8_t data);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void uf2_write(uint16_t offset, const uint8_t *p_data, uint16_t len)
+{
+    uint16_t end = offset + len;
+    uint16_t from;
+    uint16_t to;
+    
+    if(offset == 0) m_block_ok = take_header(p_data);
+    if(!m_block_ok) return; // FAT, directory, or someone else's block.
+    
+    // Payload bytes in this part.
+    from = offset < HDR_LEN ? HDR_LEN : offset;
+    to = HDR_LEN + m_payload;
+    if(to > end) to = end;
+    for(; from < to; from++) stage(m_target + (from - HDR_LEN), p_data[from - offset]);
+    
+    if(end == UF2_BLOCK_SIZE) block_written();
+}
+
+bool uf2_done(void)
+{
+    return m_done;
+}
+
+void uf2_flush(void)
+{
+    if(!m_stage_dirty) return;
+    Flash_UpdateBlocks(FLASH_ADDR(m_stage_addr), FLASH_ADDR(m_stage_addr) + _FLASH_ERASE_SIZE, m_stage);
+    m_stage_dirty = false;
+}
+
+void uf2_read_current(uint32_t offset, uint8_t *p_data, uint16_t len)
+{
+    uint32_t block;
+    uint16_t at;
+    uint8_t  i;
+    
+    for(; len; len -= 32, offset += 32, p_data += 32)
+    {
+        block = offset / UF2_BLOCK_SIZE;
+        at = (uint16_t)offset & (UF2_BLOCK_SIZE - 1);
+        
+        if(at == 0)
+        {
+            put_u32(p_data + HDR_MAGIC0, MAGIC_START0);
+            put_u32(p_data + HDR_MAGIC1, MAGIC_START1);
+            #ifdef UF2_FAMILY_ID
+            put_u32(p_data + HDR_FLAGS, FLAG_FAMILY_ID);
+            put_u32(p_data + HDR_FAMILY, UF2_FAMILY_ID);
+            #else
+            put_u32(p_data + HDR_FLAGS, 0);
+            put_u32(p_data + HDR_FAMILY, 0);
+            #endif
+            put_u32(p_data + HDR_ADDR, UF2_APP_START + (block * UF2_PAYLOAD_SIZE));
+            put_u32(p_data + HDR_SIZE, UF2_PAYLOAD_SIZE);
+            put_u32(p_data + HDR_BLOCK_NO, block);
+            put_u32(p_data + HDR_BLOCKS, UF2_APP_BLOCKS);
+        }
+        else if(at < HDR_LEN + UF2_PAYLOAD_SIZE)
+        {
+            Flash_ReadBytes(FLASH_ADDR(UF2_APP_START + (block * UF2_PAYLOAD_SIZE) + (at - HDR_LEN)), 32, p_data);
+        }
+        else
+        {
+            for(i = 0; i < 32; i++) p_data[i] = 0;
+            if(at == (UF2_BLOCK_SIZE - 32)) put_u32(p_data + (MAGIC_END_AT - (UF2_BLOCK_SIZE - 32)), MAGIC_END);
+        }
+    }
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+static uint32_t get_u32(const uint8_t *p_data)
+{
+    return p_data[0] | ((uint32_t)p_data[1] << 8) | ((uint32_t)p_data[2] << 16) | ((uint32_t)p_data[3] << 24);
+}
+
+static void put_u32(uint8_t *p_data, uint32_t val)
+{
+    p_data[0] = (uint8_t)val;
+    p_data[1] = (uint8_t)(val >> 8);
+    p_data[2] = (uint8_t)(val >> 16);
+    p_data[3] = (uint8_t)(val >> 24);
+}
+
+/*
+ * Checks the header of the block starting to be written. Only the start magic
+ * words are checked, the end one comes in the last packet, after the payload 
+ * has been taken.
+ */
+static bool take_header(const uint8_t *p_data)
+{
+    uint32_t flags;
+    uint32_t size;
+    uint32_t blocks;
+    
+    if(get_u32(p_data + HDR_MAGIC0) != MAGIC_START0 || get_u32(p_data + HDR_MAGIC1) != MAGIC_START1) return false;
+    flags = get_u32(p_data + HDR_FLAGS);
+    if(flags & (FLAG_NOT_MAIN_FLASH | FLAG_FILE_CONTAINER)) return false;
+    #ifdef UF2_FAMILY_ID
+    if((flags & FLAG_FAMILY_ID) && get_u32(p_data + HDR_FAMILY) != UF2_FAMILY_ID) return false;
+    #endif
+    
+    m_target = get_u32(p_data + HDR_ADDR);
+    size     = get_u32(p_data + HDR_SIZE);
+    if(size > DATA_MAX || m_target < UF2_APP_START || m_target > UF2_APP_END || size > (UF2_APP_END - m_target)) return false;
+    m_payload  = (uint16_t)size;
+    m_block_no = get_u32(p_data + HDR_BLOCK_NO);
+    
+    blocks = get_u32(p_data + HDR_BLOCKS);
+    if(blocks != m_num_blocks || m_done) // Another file.
+    {
+        m_num_blocks  = blocks;
+        m_blocks_seen = 0;
+        m_done        = false;
+        for(uint8_t i = 0; i < sizeof(m_seen); i++) m_seen[i] = 0;
+    }
+    return true;
+}
+
+/*
+ * Counts the block once, the host can write the same block more than once
+ * (e.g. when it rewrites a cluster).
+ */
+static void block_written(void)
+{
+    uint8_t bit;
+    
+    if(m_block_no < SEEN_BLOCKS)
+    {
+        bit = (uint8_t)(1 << (m_block_no & 7));
+        if(m_seen[m_block_no >> 3] & bit) return;
+        m_seen[m_block_no >> 3] |= bit;
+    }
+    if(++m_blocks_seen == m_num_blocks)
+    {
+        uf2_flush();
+        m_done = true;
+    }
+}
+
+static void stage(uint32_t addr, uint8_t data)
+{
+    uint32_t block = addr & ~(uint32_t)(ARRAY_ERASE_SIZE - 1);
+    
+    if(block != m_stage_addr)
+    {
+        uf2_flush();
+        m_stage_addr = block;
+        Flash_ReadBytes(FLASH_ADDR(block), ARRAY_ERASE_SIZE, m_stage); // Whatever the payloads don't cover is kept.
+    }
+    m_stage[(uint16_t)(addr - block)] = data;
+    m_stage_dirty = true;
+}
+
+/* ************************************************************************** */
+
+#endif /* MSD_UF2 */
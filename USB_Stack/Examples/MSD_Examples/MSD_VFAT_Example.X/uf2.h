@@ -0,0 +1,140 @@
+/**
+ * @file uf2.h
+ * @brief UF2 firmware update header file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD VFAT Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef UF2_H
+#define UF2_H
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* ***************************** UF2 SETTINGS ******************************* */
+/* ************************************************************************** */
+
+/*
+ * Each 512 byte UF2 block carries its own flash address, so blocks are 
+ * programmed as they arrive, in whatever order the host writes them and to
+ * whatever LBA. Sectors that aren't UF2 blocks (the host's FAT and directory
+ * updates) are dropped. Addresses are byte addresses, as in the hex file, so 
+ * on PIC16F145X each word takes 2 bytes.
+ * 
+ * Blocks outside UF2_APP_START to UF2_APP_END are ignored, which keeps the 
+ * bootloader and the Config Words safe.
+ */
+#if defined(_PIC14E)
+#define UF2_APP_START 0x2000UL             // Word 0x1000.
+#define UF2_APP_END   (_ROMSIZE * 2UL)
+#elif defined(__J_PART)
+#define UF2_APP_START 0x2000UL
+#define UF2_APP_END   (_ROMSIZE - _FLASH_ERASE_SIZE) // Last page holds the Config Words.
+#else
+#define UF2_APP_START 0x2000UL
+#define UF2_APP_END   _ROMSIZE
+#endif
+
+//#define UF2_FAMILY_ID 0x00000000UL // Only take blocks tagged with this family ID (flag 0x2000).
+                                     // Untagged blocks are always taken.
+
+#define UF2_PAYLOAD_SIZE 256 // Used for CURRENT.UF2, and to size the block tracking.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** UF2 DEFINES ******************************* */
+/* ************************************************************************** */
+
+#define UF2_BLOCK_SIZE   512
+#define UF2_APP_BLOCKS   ((UF2_APP_END - UF2_APP_START) / UF2_PAYLOAD_SIZE)
+#define UF2_CURRENT_SIZE (UF2_APP_BLOCKS * UF2_BLOCK_SIZE) // Size of CURRENT.UF2.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** UF2 GLOBAL FUNCTIONS ************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void uf2_write(uint16_t offset, const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Takes part of a block the host is writing.
+ * 
+ * Parts come in order, the one at offset 0 holding at least the 32 byte 
+ * header. The payload is gathered a flash erase block at a time, and written
+ * with Flash_UpdateBlocks() once the payload moves on to another erase block.
+ * 
+ * <b>Code Example:</b>
+ * <code>
+ * uf2_write(g_msd_byte_of_sect, g_msd_ep_out, MSD_EP_SIZE); // MSD_LIMITED_RAM.
+ * </code>
+ * 
+ * @param[in] offset Byte of the block the part starts at.
+ * @param[in] p_data The part.
+ * @param[in] len Amount of bytes.
+ */
+void uf2_write(uint16_t offset, const uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn bool uf2_done(void)
+ * 
+ * @brief Checks if every block of the UF2 file has been programmed.
+ * 
+ * The last erase block is written by the time it returns true.
+ * 
+ * @return Returns true once all the blocks have been seen.
+ */
+bool uf2_done(void);
+
+/**
+ * @fn void uf2_flush(void)
+ * 
+ * @brief Writes the erase block still being gathered.
+ * 
+ * Call it when the host goes idle (e.g. on TEST_UNIT_READY), in case a file
+ * didn't finish.
+ */
+void uf2_flush(void);
+
+/**
+ * @fn void uf2_read_current(uint32_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads CURRENT.UF2, the application's flash as UF2 blocks.
+ * 
+ * A vfat_read_t callback, offset and len are multiples of 32.
+ * 
+ * @param[in] offset Byte of the file to start at.
+ * @param[out] p_data Buffer the data is read into.
+ * @param[in] len Amount of bytes to read.
+ */
+void uf2_read_current(uint32_t offset, uint8_t *p_data, uint16_t len);
+
+/* ************************************************************************** */
+
+#endif /* UF2_H */
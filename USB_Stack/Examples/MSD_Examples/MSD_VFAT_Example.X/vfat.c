@@ -0,0 +1,406 @@
+/**
+ * @file vfat.c
+ * @brief Virtual FAT volume C file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD VFAT Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_msd_config.h"
+#include "vfat.h"
+
+/* ************************************************************************** */
+/* **************************** VOLUME LAYOUT ******************************* */
+/* ************************************************************************** */
+
+/*
+ * BOOT SECT | FAT | ROOT DIR | DATA
+ * 
+ * The FAT is sized from the clusters the volume would have without it, so it 
+ * can be a little bigger than needed, which FAT allows. The type then goes by
+ * the clusters that are left, as the host works it out.
+ */
+#define BLOCK_SIZE     512
+#define DIR_ENTRY_SIZE 32
+#define CLUSTER_BYTES  ((uint32_t)VFAT_SECTS_PER_CLUSTER * BLOCK_SIZE)
+
+#define ROOT_SECTS  ((VFAT_ROOT_ENTRIES * DIR_ENTRY_SIZE + (BLOCK_SIZE - 1)) / BLOCK_SIZE)
+#define ROUGH_DATA  (VFAT_BLOCKS - 1 - ROOT_SECTS) // FAT and data sectors.
+#define ROUGH_CLUS  (ROUGH_DATA / VFAT_SECTS_PER_CLUSTER)
+#define FAT12_SECTS (((((ROUGH_CLUS + 2) * 3) + 1) / 2 + (BLOCK_SIZE - 1)) / BLOCK_SIZE)
+#define FAT16_SECTS ((((ROUGH_CLUS + 2) * 2) + (BLOCK_SIZE - 1)) / BLOCK_SIZE)
+
+#if ((ROUGH_DATA - FAT12_SECTS) / VFAT_SECTS_PER_CLUSTER) < 4085
+#define FAT16     0
+#define FAT_SECTS FAT12_SECTS
+#define FAT_MEDIA 0x0FF8
+#define FAT_EOC   0x0FFF // End of chain.
+#else
+#define FAT16     1
+#define FAT_SECTS FAT16_SECTS
+#define FAT_MEDIA 0xFFF8
+#define FAT_EOC   0xFFFF
+#endif
+
+#define CLUSTERS  ((ROUGH_DATA - FAT_SECTS) / VFAT_SECTS_PER_CLUSTER)
+#define LAST_CLUS (CLUSTERS + 1) // Clusters are numbered from 2.
+
+#if FAT16 && CLUSTERS < 4085
+#error "VFAT: The volume falls between FAT12 and FAT16, change VFAT_BLOCKS or VFAT_SECTS_PER_CLUSTER."
+#elif CLUSTERS > 65524
+#error "VFAT: Too many clusters for FAT16, make VFAT_SECTS_PER_CLUSTER bigger."
+#endif
+
+#define FAT_START  1
+#define ROOT_START (FAT_START + FAT_SECTS)
+#define DATA_START (ROOT_START + ROOT_SECTS)
+
+#define ATTR_VOLUME_ID 0x08
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** BOOT SECTOR ******************************** */
+/* ************************************************************************** */
+
+/** Boot Sector */
+typedef struct
+{
+    uint8_t  jmpBoot[3];
+    uint8_t  OEMName[8];
+    uint16_t BytesPerSec;
+    uint8_t  SecPerClus;
+    uint16_t RsvdSecCnt;
+    uint8_t  NumFATs;
+    uint16_t RootEntCnt;
+    uint16_t TotSec16;
+    uint8_t  Media;
+    uint16_t FATSz16;
+    uint16_t SecPerTrk;
+    uint16_t NumHeads;
+    uint32_t HiddSec;
+    uint32_t TotSec32;
+    uint8_t  DrvNum;
+    uint8_t  Reserved1;
+    uint8_t  BootSig;
+    uint8_t  VolID[4];
+    uint8_t  VolLab[11];
+    uint8_t  FilSysType[8];
+}BOOT_t;
+
+static const BOOT_t m_boot =
+{
+    {0xEB,0x3C,0x90},
+    {'M','S','D','O','S','5','.','0'},
+    BLOCK_SIZE,
+    VFAT_SECTS_PER_CLUSTER,
+    FAT_START,
+    1,
+    VFAT_ROOT_ENTRIES,
+    (VFAT_BLOCKS < 0x10000UL) ? (uint16_t)VFAT_BLOCKS : 0,
+    0xF8,
+    FAT_SECTS,
+    1,
+    1,
+    0,
+    (VFAT_BLOCKS < 0x10000UL) ? 0 : VFAT_BLOCKS,
+    0x80,
+    0,
+    0x29,
+    {0x86,0xE8,0xA3,0x57},
+    VFAT_LABEL,
+    #if FAT16
+    {'F','A','T','1','6',' ',' ',' '}
+    #else
+    {'F','A','T','1','2',' ',' ',' '}
+    #endif
+};
+
+/** Directory Entry Structure */
+typedef struct
+{
+    uint8_t  Name[11];
+    uint8_t  Attr;
+    uint8_t  NTRes;
+    uint8_t  CrtTimeTenth;
+    uint16_t CrtTime;
+    uint16_t CrtDate;
+    uint16_t LstAccDate;
+    uint16_t FstClusHI;
+    uint16_t WrtTime;
+    uint16_t WrtDate;
+    uint16_t FstClusLO;
+    uint32_t FileSize;
+}DIR_ENTRY_t;
+
+static const uint8_t m_label[11] = VFAT_LABEL;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static uint16_t m_first_clus[VFAT_NUM_FILES]; // 0 for an empty file, or one that didn't fit.
+static uint16_t m_last_clus[VFAT_NUM_FILES];
+static uint8_t  m_file; // File find_file() last found, reads walk through a file in order.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** LOCAL FUNCTION DECLARATIONS ********************** */
+/* ************************************************************************** */
+
+static uint8_t  find_file(uint16_t clus);
+static uint16_t fat_entry(uint16_t clus);
+static void     read_boot(uint16_t offset, uint8_t *p_data, uint16_t len);
+static void     read_fat(uint32_t byte, uint8_t *p_data, uint16_t len);
+static void     read_root(uint16_t entry, uint8_t *p_data, uint16_t len);
+static bool     read_data(uint32_t block, uint16_t offset, uint8_t *p_data, uint16_t len);
+static uint8_t  file_pos(uint32_t block, uint16_t offset, uint32_t *p_pos);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+bool vfat_init(void)
+{
+    uint16_t clus = 2;
+    uint32_t count;
+    bool     fitted = true;
+    
+    for(uint8_t i = 0; i < VFAT_NUM_FILES; i++)
+    {
+        m_first_clus[i] = 0;
+        count = (g_vfat_files[i].size + (CLUSTER_BYTES - 1)) / CLUSTER_BYTES;
+        if(count == 0) continue;
+        if(count > (uint32_t)(LAST_CLUS + 1 - clus))
+        {
+            fitted = false;
+            continue;
+        }
+        m_first_clus[i] = clus;
+        clus += (uint16_t)count;
+        m_last_clus[i] = clus - 1;
+    }
+    m_file = 0;
+    return fitted;
+}
+
+void vfat_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    if(lba >= DATA_START)
+    {
+        if(lba < VFAT_BLOCKS && read_data(lba - DATA_START, offset, p_data, len)) return;
+        usb_ram_set(0, p_data, len); // Free cluster, or past the end of a file.
+        return;
+    }
+    
+    usb_ram_set(0, p_data, len);
+    if(lba == 0) read_boot(offset, p_data, len);
+    else if(lba < ROOT_START) read_fat(((lba - FAT_START) * BLOCK_SIZE) + offset, p_data, len);
+    else read_root((uint16_t)((lba - ROOT_START) * (BLOCK_SIZE / DIR_ENTRY_SIZE)) + (offset / DIR_ENTRY_SIZE), p_data, len);
+}
+
+uint8_t vfat_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len)
+{
+    uint32_t pos;
+    uint32_t left;
+    uint8_t  i;
+    
+    if(lba < DATA_START || lba >= VFAT_BLOCKS) return 0;
+    i = file_pos(lba - DATA_START, offset, &pos);
+    if(i == VFAT_NUM_FILES || g_vfat_files[i].write == NULL) return 0;
+    
+    left = g_vfat_files[i].size - pos;
+    if(left < len) len = (uint16_t)left;
+    return g_vfat_files[i].write(pos, p_data, len);
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+/*
+ * Index of the file holding cluster clus, or VFAT_NUM_FILES if it's free.
+ */
+static uint8_t find_file(uint16_t clus)
+{
+    uint8_t i = m_file;
+    
+    do
+    {
+        if(m_first_clus[i] && clus >= m_first_clus[i] && clus <= m_last_clus[i])
+        {
+            m_file = i;
+            return i;
+        }
+        if(++i == VFAT_NUM_FILES) i = 0;
+    }while(i != m_file);
+    return VFAT_NUM_FILES;
+}
+
+static uint16_t fat_entry(uint16_t clus)
+{
+    uint8_t i;
+    
+    if(clus == 0) return FAT_MEDIA;
+    if(clus == 1) return FAT_EOC;
+    i = find_file(clus);
+    if(i == VFAT_NUM_FILES) return 0;        // Free.
+    if(clus == m_last_clus[i]) return FAT_EOC;
+    return clus + 1;                         // Files are contiguous.
+}
+
+static void read_boot(uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    for(; len; len--, offset++, p_data++)
+    {
+        if(offset < sizeof(m_boot)) *p_data = ((const uint8_t*)&m_boot)[offset];
+        else if(offset == 510) *p_data = 0x55;
+        else if(offset == 511) *p_data = 0xAA;
+    }
+}
+
+static void read_fat(uint32_t byte, uint8_t *p_data, uint16_t len)
+{
+    #if FAT16
+    uint16_t clus = (uint16_t)(byte >> 1);
+    uint16_t entry;
+    
+    for(; len >= 2; len -= 2)
+    {
+        entry = fat_entry(clus++);
+        *p_data++ = (uint8_t)entry;
+        *p_data++ = (uint8_t)(entry >> 8);
+    }
+    #else
+    // Two 12-bit entries to every 3 bytes: [even 7:0] [odd 3:0|even 11:8] [odd 11:4].
+    uint16_t pair = (uint16_t)(byte / 3);
+    uint8_t  part = (uint8_t)(byte - ((uint32_t)pair * 3));
+    uint16_t even = fat_entry(pair << 1);
+    uint16_t odd  = fat_entry((pair << 1) + 1);
+    
+    for(; len; len--, p_data++)
+    {
+        if(part == 0) *p_data = (uint8_t)even;
+        else if(part == 1) *p_data = (uint8_t)((even >> 8) | (odd << 4));
+        else *p_data = (uint8_t)(odd >> 4);
+        
+        if(++part == 3)
+        {
+            part = 0;
+            pair++;
+            even = fat_entry(pair << 1);
+            odd  = fat_entry((pair << 1) + 1);
+        }
+    }
+    #endif
+}
+
+static void read_root(uint16_t entry, uint8_t *p_data, uint16_t len)
+{
+    DIR_ENTRY_t *p_entry;
+    const vfat_file_t *p_file;
+    uint8_t i;
+    
+    for(; len >= DIR_ENTRY_SIZE; len -= DIR_ENTRY_SIZE, p_data += DIR_ENTRY_SIZE, entry++)
+    {
+        if(entry > VFAT_NUM_FILES) break; // The rest are unused (zero).
+        p_entry = (DIR_ENTRY_t*)p_data;
+        
+        if(entry == 0)
+        {
+            for(i = 0; i < 11; i++) p_entry->Name[i] = m_label[i];
+            p_entry->Attr = ATTR_VOLUME_ID;
+        }
+        else
+        {
+            i = (uint8_t)(entry - 1);
+            p_file = &g_vfat_files[i];
+            if(p_file->size && m_first_clus[i] == 0) continue; // Didn't fit, left as a free entry.
+            
+            for(i = 0; i < 11; i++) p_entry->Name[i] = p_file->name[i];
+            p_entry->Attr       = p_file->attr;
+            p_entry->CrtTime    = VFAT_TIME;
+            p_entry->CrtDate    = VFAT_DATE;
+            p_entry->LstAccDate = VFAT_DATE;
+            p_entry->FstClusLO  = m_first_clus[entry - 1];
+            p_entry->FileSize   = p_file->size;
+        }
+        p_entry->WrtTime = VFAT_TIME;
+        p_entry->WrtDate = VFAT_DATE;
+    }
+}
+
+/*
+ * Hands the read to the file's callback. Returns false if block isn't part
+ * of a file, otherwise anything past the end of the file is zeroed here.
+ */
+static bool read_data(uint32_t block, uint16_t offset, uint8_t *p_data, uint16_t len)
+{
+    uint32_t pos;
+    uint32_t left;
+    uint8_t  i = file_pos(block, offset, &pos);
+    
+    if(i == VFAT_NUM_FILES) return false;
+    
+    left = g_vfat_files[i].size - pos;
+    if(left < len)
+    {
+        usb_ram_set(0, p_data + left, len - (uint16_t)left);
+        len = (uint16_t)left;
+    }
+    g_vfat_files[i].read(pos, p_data, len);
+    return true;
+}
+
+/*
+ * Index of the file holding block of the data area, with the byte of the
+ * file at offset in *p_pos. Returns VFAT_NUM_FILES if block isn't part of a
+ * file, or is slack at the end of its last cluster.
+ */
+static uint8_t file_pos(uint32_t block, uint16_t offset, uint32_t *p_pos)
+{
+    uint8_t i = find_file((uint16_t)(block / VFAT_SECTS_PER_CLUSTER) + 2);
+    
+    if(i == VFAT_NUM_FILES) return VFAT_NUM_FILES;
+    *p_pos = ((block - ((uint32_t)(m_first_clus[i] - 2) * VFAT_SECTS_PER_CLUSTER)) * BLOCK_SIZE) + offset;
+    if(*p_pos >= g_vfat_files[i].size) return VFAT_NUM_FILES;
+    return i;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,190 @@
+/**
+ * @file vfat.h
+ * @brief Virtual FAT volume header file.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * MSD VFAT Example.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VFAT_H
+#define VFAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ************************************************************************** */
+/* **************************** VFAT SETTINGS ******************************* */
+/* ************************************************************************** */
+
+/*
+ * Nothing about the volume is stored. The boot sector, FAT and root directory
+ * are worked out from g_vfat_files[] as the host reads them, and file data 
+ * comes from each file's read callback. FAT12 or FAT16 is picked from the 
+ * amount of clusters, like a formatter would.
+ */
+#define VFAT_BLOCKS            16384UL // 8 MB volume, 512 byte blocks.
+#define VFAT_SECTS_PER_CLUSTER 8       // 4KB clusters, a power of 2.
+#define VFAT_ROOT_ENTRIES      16      // Multiple of 16, the volume label takes one.
+#ifdef MSD_EEPROM
+#define VFAT_NUM_FILES         3       // Entries in g_vfat_files[], EEPROM.BIN as well.
+#else
+#define VFAT_NUM_FILES         2       // Entries in g_vfat_files[].
+#endif
+
+#define VFAT_LABEL {'V','I','R','T','U','A','L',' ','F','A','T'}
+#define VFAT_DATE  0x596E // 2024-11-14, ((Year - 1980) << 9) | (Month << 5) | Day.
+#define VFAT_TIME  0x6000 // 12:00:00, (Hours << 11) | (Minutes << 5) | (Seconds / 2).
+
+#if VFAT_NUM_FILES >= VFAT_ROOT_ENTRIES
+#error "VFAT: VFAT_ROOT_ENTRIES needs one more entry than VFAT_NUM_FILES, for the volume label."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** VFAT TYPES ********************************* */
+/* ************************************************************************** */
+
+/**
+ * Reads part of a file.
+ * 
+ * p_data points straight at the MSD Endpoint buffer (or the sector buffer), so
+ * the file's data is produced in place. offset is a multiple of 32, and len 
+ * never goes past the end of the file.
+ */
+typedef void (*vfat_read_t)(uint32_t offset, uint8_t *p_data, uint16_t len);
+
+/**
+ * Writes part of a file, the host saving it in place.
+ * 
+ * offset and len are as for vfat_read_t. Returns what msd_tx_sector() 
+ * returns with MSD_ASYNC_MEDIA, MSD_MEDIA_DONE or MSD_MEDIA_PENDING.
+ */
+typedef uint8_t (*vfat_write_t)(uint32_t offset, const uint8_t *p_data, uint16_t len);
+
+/** File of the virtual volume. */
+typedef struct
+{
+    uint8_t      name[11]; ///< 8.3 name, space padded, e.g. "README  TXT".
+    uint8_t      attr;     ///< VFAT_ATTR_ bits.
+    uint32_t     size;     ///< Size in bytes, any length up to the volume size.
+    vfat_read_t  read;     ///< Data callback.
+    vfat_write_t write;    ///< Write callback, NULL for a file that can't be written.
+}vfat_file_t;
+
+#define VFAT_ATTR_READ_ONLY 0x01
+#define VFAT_ATTR_HIDDEN    0x02
+#define VFAT_ATTR_SYSTEM    0x04
+#define VFAT_ATTR_ARCHIVE   0x20
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** VFAT GLOBAL VARS ***************************** */
+/* ************************************************************************** */
+
+/**
+ * Files of the volume, defined by the application. Its clusters are given out
+ * in table order by vfat_init().
+ * 
+ * <b>Code Example:</b>
+ * <code>
+ * const vfat_file_t g_vfat_files[VFAT_NUM_FILES] =
+ * {
+ *     {{'R','E','A','D','M','E',' ',' ','T','X','T'}, VFAT_ATTR_READ_ONLY, sizeof(m_readme) - 1, read_readme, NULL},
+ *     {{'P','A','T','T','E','R','N',' ','B','I','N'}, VFAT_ATTR_READ_ONLY, 0x100000, read_pattern, NULL}
+ * };
+ * </code>
+ */
+extern const vfat_file_t g_vfat_files[VFAT_NUM_FILES];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************* VFAT GLOBAL FUNCTIONS ************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn bool vfat_init(void)
+ * 
+ * @brief Gives out the clusters of g_vfat_files[].
+ * 
+ * Call it before usb_init().
+ * 
+ * @return Returns true if every file fitted. Files that don't fit are left 
+ * out of the directory.
+ */
+bool vfat_init(void);
+
+/**
+ * @fn void vfat_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Reads part of a block of the volume.
+ * 
+ * offset and len need to be multiples of 32 (a directory entry), which the 
+ * MSD library's EP sized and full sector reads are.
+ * 
+ * <b>Code Example:</b>
+ * <code>
+ * vfat_read(g_msd_rw_10_vars.LBA, g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE); // MSD_LIMITED_RAM.
+ * </code>
+ * 
+ * @param[in] lba Block being read.
+ * @param[in] offset Byte of the block to start at.
+ * @param[out] p_data Buffer the data is read into.
+ * @param[in] len Amount of bytes to read.
+ */
+void vfat_read(uint32_t lba, uint16_t offset, uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn uint8_t vfat_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Writes part of a block of the volume.
+ * 
+ * Only the data of files with a write callback can be written, the part of
+ * the block past the end of the file and anything else the host writes (its
+ * FAT and directory updates) is dropped. offset and len are as for 
+ * vfat_read().
+ * 
+ * <b>Code Example:</b>
+ * <code>
+ * return vfat_write(g_msd_rw_10_vars.LBA, 0, g_msd_sect_data, BYTES_PER_BLOCK_LE); // MSD_ASYNC_MEDIA.
+ * </code>
+ * 
+ * @param[in] lba Block being written.
+ * @param[in] offset Byte of the block to start at.
+ * @param[in] p_data Data to write.
+ * @param[in] len Amount of bytes to write.
+ * 
+ * @return Returns the file's write callback result, or MSD_MEDIA_DONE (0) if
+ * the data was dropped.
+ */
+uint8_t vfat_write(uint32_t lba, uint16_t offset, const uint8_t *p_data, uint16_t len);
+
+/* ************************************************************************** */
+
+#endif /* VFAT_H */
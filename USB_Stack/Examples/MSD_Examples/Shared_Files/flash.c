@@ -26,11 +26,17 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <xc.h>
 #include "flash.h"
 
 #define LOOPS _FLASH_ERASE_SIZE/_FLASH_WRITE_SIZE
 
+// Flash_UpdateBlocks() block states.
+#define BLOCK_SAME    0 // Flash already holds the data.
+#define BLOCK_PROGRAM 1 // Only 1->0 bit changes, can be written without an erase.
+#define BLOCK_ERASE   2 // Needs an erase before writing.
+
 #if defined(_PIC14E)
 #define _EECON1 PMCON1
 #define _EECON1bits PMCON1bits
@@ -236,4 +242,89 @@ void Flash_WriteBlock(uint24_t start_addr, uint8_t *flash_array)
 }
 #else
 #error FLASH - DEVICE NOT YET SUPPORTED
-#endif
\ No newline at end of file
+#endif
+
+#if defined(_PIC14)||defined(_PIC14E)
+typedef uint16_t flash_addr_t;
+#define ARRAY_ERASE_SIZE (_FLASH_ERASE_SIZE*2) // Two array bytes per word.
+#define ARRAY_WRITE_SIZE (_FLASH_WRITE_SIZE*2)
+#define ADDR_STEP        1
+#else
+typedef uint24_t flash_addr_t;
+#define ARRAY_ERASE_SIZE _FLASH_ERASE_SIZE
+#define ARRAY_WRITE_SIZE _FLASH_WRITE_SIZE
+#define ADDR_STEP        2
+#endif
+
+static uint8_t block_state(flash_addr_t start_addr, flash_addr_t end_addr, uint8_t *flash_array)
+{
+    uint8_t  state = BLOCK_SAME;
+    uint16_t old_word, new_word;
+    uint8_t  current[2];
+    
+    for(; start_addr < end_addr; start_addr += ADDR_STEP, flash_array += 2)
+    {
+        Flash_ReadBytes(start_addr, 2, current);
+        old_word = current[0] | ((uint16_t)current[1] << 8);
+        new_word = flash_array[0] | ((uint16_t)flash_array[1] << 8);
+        #if defined(_PIC14)||defined(_PIC14E)
+        old_word &= 0x3FFF; // Only 14 bits are implemented.
+        new_word &= 0x3FFF;
+        #endif
+        if(old_word == new_word) continue;
+        if((old_word & new_word) != new_word) return BLOCK_ERASE; // A 0->1 change needs an erase.
+        state = BLOCK_PROGRAM;
+    }
+    return state;
+}
+
+static void erase_write_run(flash_addr_t start_addr, flash_addr_t end_addr, uint8_t *flash_array)
+{
+    Flash_Erase(start_addr, end_addr); // One erase pass for the whole run of blocks.
+    for(; start_addr < end_addr; start_addr += _FLASH_WRITE_SIZE, flash_array += ARRAY_WRITE_SIZE)
+    {
+        Flash_WriteBlock(start_addr, flash_array);
+    }
+}
+
+// Writes whole erase blocks from start_addr to end_addr, only erasing where it's needed.
+// Blocks that match are skipped, blocks needing only 1->0 changes are programmed without
+// an erase, and neighbouring blocks that need erasing share one Flash_Erase() pass.
+void Flash_UpdateBlocks(flash_addr_t start_addr, flash_addr_t end_addr, uint8_t *flash_array)
+{
+    flash_addr_t run_addr;
+    uint8_t      *run_array;
+    bool         run = false;
+    flash_addr_t write_addr;
+    uint8_t      *write_array;
+    
+    for(; start_addr < end_addr; start_addr += _FLASH_ERASE_SIZE, flash_array += ARRAY_ERASE_SIZE)
+    {
+        switch(block_state(start_addr, start_addr + _FLASH_ERASE_SIZE, flash_array))
+        {
+            case BLOCK_ERASE:
+                if(!run)
+                {
+                    run_addr  = start_addr;
+                    run_array = flash_array;
+                    run = true;
+                }
+                continue;
+            case BLOCK_PROGRAM:
+                // Program without erasing, skipping write blocks that already match.
+                for(write_addr = start_addr, write_array = flash_array; write_addr < start_addr + _FLASH_ERASE_SIZE; write_addr += _FLASH_WRITE_SIZE, write_array += ARRAY_WRITE_SIZE)
+                {
+                    if(block_state(write_addr, write_addr + _FLASH_WRITE_SIZE, write_array) != BLOCK_SAME) Flash_WriteBlock(write_addr, write_array);
+                }
+                break;
+            default: // BLOCK_SAME
+                break;
+        }
+        if(run)
+        {
+            erase_write_run(run_addr, start_addr, run_array);
+            run = false;
+        }
+    }
+    if(run) erase_write_run(run_addr, end_addr, run_array);
+}
\ No newline at end of file
@@ -35,12 +35,14 @@ void Flash_ReadBytes(uint16_t start_addr, uint16_t bytes, uint8_t *flash_array);
 void Flash_Erase(uint16_t start_addr, uint16_t end_addr);
 void Flash_EraseWriteBlock(uint16_t start_addr, uint8_t *flash_array);
 void Flash_WriteBlock(uint16_t start_addr, uint8_t *flash_array);
+void Flash_UpdateBlocks(uint16_t start_addr, uint16_t end_addr, uint8_t *flash_array);
 #else
 void Flash_ReadBytes(uint24_t start_addr, uint24_t bytes, uint8_t *flash_array);
 void Flash_Erase(uint24_t start_addr, uint24_t end_addr);
 void Flash_EraseWriteBlock(uint24_t start_addr, uint8_t *flash_array);
 void Flash_WriteBlock(uint24_t start_addr, uint8_t *flash_array);
 void Flash_WriteConfigBlock(uint8_t *flash_array);
+void Flash_UpdateBlocks(uint24_t start_addr, uint24_t end_addr, uint8_t *flash_array);
 #endif /* _PIC18 */
 
 #endif /* FLASH_H */
\ No newline at end of file
@@ -32,6 +32,15 @@
 #include "usb_msd.h"
 
 
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [MSD_EP][OUT] = msd_add_task,
+    [MSD_EP][IN]  = msd_add_task
+};
+#endif
+
+
 bool usb_service_class_request(void)
 {
     return msd_class_request();
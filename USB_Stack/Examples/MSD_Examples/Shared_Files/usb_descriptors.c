@@ -112,6 +112,14 @@ const uint16_t g_config_descriptors[] =
     (uint16_t)&config_descriptor0
 };
 
+#ifdef USE_FAST_ENUMERATION
+/** Configuration Descriptor Lengths Array */
+const uint16_t g_config_descriptor_lengths[] =
+{
+    sizeof(config_descriptor0)
+};
+#endif
+
 /** String Zero Descriptor Structure */
 typedef struct
 {
@@ -0,0 +1,335 @@
+/**
+ * @file gadget_zero.c
+ * @brief Gadget Zero source/sink and loopback functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Gadget Zero Example (vendor class source/sink and loopback).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+ 
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb.h"
+#include "usb_ch9.h"
+#include "gadget_zero.h"
+
+/* ************************************************************************** */
+/* ******************************** TYPES *********************************** */
+/* ************************************************************************** */
+
+/** Endpoint State Type */
+typedef struct
+{
+    uint8_t Mode;
+    uint8_t Source_Cnt;   // IN packet length in GZ_MODE_SOURCE_SINK.
+    uint8_t Out_PPB;      // Oldest received OUT buffer.
+    uint8_t Out_Pending;  // OUT buffers received but not armed again yet.
+    uint8_t In_PPB;       // Next IN buffer to arm.
+    uint8_t In_Armed;     // IN buffers owned by the SIE.
+    uint8_t In_Dirty;     // IN buffers (bit per PPB) that need the pattern written again.
+}gz_ep_t;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ GADGET ZERO ENDPOINTS *************************** */
+/* ************************************************************************** */
+
+static uint8_t m_ep_buffers[GZ_NUM_EP][2][GZ_NUM_BUFFERS][GZ_EP_SIZE] __at(GZ_EP_BUFFERS_BASE_ADDR);
+
+#define EP_BUFFER(ep, dir, ppb) (m_ep_buffers[(ep) - 1][dir][ppb])
+
+#if GZ_NUM_BUFFERS == 2
+#define PPB_ADD(ppb, n) ((ppb) ^ ((n) & 1))
+#else
+#define PPB_ADD(ppb, n) 0
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+static gz_ep_t m_ep[GZ_NUM_EP];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************** LOCAL FUNCTION DECLARATIONS *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void fill_pattern(uint8_t* p_buffer)
+ * 
+ * @brief Writes the source pattern (0, 1, 2, ...) into an IN buffer.
+ */
+static void fill_pattern(uint8_t* p_buffer);
+
+/**
+ * @fn void service_ep(uint8_t ep)
+ * 
+ * @brief Arms every IN and OUT buffer an Endpoint can arm right now.
+ * 
+ * The Data Toggle is flipped every time a buffer is armed, not on completion, 
+ * so both buffers can be owned by the SIE at once.
+ */
+static void service_ep(uint8_t ep);
+
+/**
+ * @fn void reset_ep(uint8_t ep, uint8_t dir)
+ * 
+ * @brief Takes back an Endpoint direction's buffers, and arms them again from DATA0.
+ * 
+ * The SIE's ping-pong pointer isn't reset, so the next buffer used is the 
+ * first one that wasn't completed.
+ */
+static void reset_ep(uint8_t ep, uint8_t dir);
+
+/**
+ * @fn void set_mode(uint8_t ep, uint8_t mode, uint8_t source_cnt)
+ * 
+ * @brief Changes an Endpoint's mode.
+ */
+static void set_mode(uint8_t ep, uint8_t mode, uint8_t source_cnt);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ GADGET ZERO FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void gz_init(void)
+{
+    for(uint8_t ep = 1; ep <= GZ_NUM_EP; ep++)
+    {
+        for(uint8_t dir = OUT; dir <= IN; dir++)
+        {
+            for(uint8_t ppb = 0; ppb < GZ_NUM_BUFFERS; ppb++)
+            {
+                g_usb_bd_table[EP_BD_INDEX(ep, dir, ppb)].STAT = 0;
+                g_usb_bd_table[EP_BD_INDEX(ep, dir, ppb)].ADR  = (uint16_t)EP_BUFFER(ep, dir, ppb);
+            }
+            g_usb_ep_stat[ep][dir].Halt = 0;
+            g_usb_ep_stat[ep][dir].Data_Toggle_Val = 0;
+        }
+        m_ep[ep - 1].Out_PPB     = EVEN;
+        m_ep[ep - 1].Out_Pending = GZ_NUM_BUFFERS; // All free, service_ep() arms them.
+        m_ep[ep - 1].In_PPB      = EVEN;
+        m_ep[ep - 1].In_Armed    = 0;
+        m_ep[ep - 1].Mode        = GZ_DEFAULT_MODE;
+        m_ep[ep - 1].Source_Cnt  = GZ_EP_SIZE;
+        m_ep[ep - 1].In_Dirty    = (1 << GZ_NUM_BUFFERS) - 1;
+    }
+    
+    // EP Settings, handshaking, IN and OUT enabled, no SETUP.
+    UEP1 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #if GZ_NUM_EP > 1
+    UEP2 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if GZ_NUM_EP > 2
+    UEP3 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if GZ_NUM_EP > 3
+    UEP4 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if GZ_NUM_EP > 4
+    UEP5 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if GZ_NUM_EP > 5
+    UEP6 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if GZ_NUM_EP > 6
+    UEP7 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    
+    for(uint8_t ep = 1; ep <= GZ_NUM_EP; ep++) service_ep(ep);
+}
+
+void gz_tasks(void)
+{
+    if(TRANSACTION_DIR == IN) gz_in_tasks();
+    else gz_out_tasks();
+}
+
+void gz_in_tasks(void)
+{
+    m_ep[TRANSACTION_EP - 1].In_Armed--;
+    service_ep(TRANSACTION_EP);
+}
+
+void gz_out_tasks(void)
+{
+    m_ep[TRANSACTION_EP - 1].Out_Pending++;
+    service_ep(TRANSACTION_EP);
+}
+
+bool gz_vendor_request(void)
+{
+    uint8_t ep = (uint8_t)g_usb_setup.wIndex;
+    
+    if(g_usb_setup.bmRequestType_bits.Type != VENDOR) return false;
+    if(g_usb_setup.wIndex > GZ_NUM_EP) return false;
+    
+    switch(g_usb_setup.bRequest)
+    {
+        case GZ_REQUEST_SET_MODE:
+            if((uint8_t)g_usb_setup.wValue > GZ_MODE_LOOPBACK) return false;
+            if((g_usb_setup.wValue >> 8) > GZ_EP_SIZE) return false;
+            
+            if(ep == 0)
+            {
+                for(ep = 1; ep <= GZ_NUM_EP; ep++) set_mode(ep, (uint8_t)g_usb_setup.wValue, (uint8_t)(g_usb_setup.wValue >> 8));
+            }
+            else set_mode(ep, (uint8_t)g_usb_setup.wValue, (uint8_t)(g_usb_setup.wValue >> 8));
+            usb_set_control_stage(STATUS_IN_STAGE);
+            usb_arm_in_status();
+            return true;
+        case GZ_REQUEST_GET_MODE:
+            if(ep == 0 || g_usb_setup.wLength == 0) return false;
+            
+            usb_set_ram_ptr(&m_ep[ep - 1].Mode);
+            usb_setup_in_control_transfer(RAM, 1, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        default:
+            return false;
+    }
+}
+
+void gz_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+{
+    if(ep == 0 || ep > GZ_NUM_EP) return;
+    
+    g_usb_ep_stat[ep][dir].Halt = 0;
+    reset_ep(ep, dir);
+    service_ep(ep);
+}
+
+void gz_reset_ep_toggle(void)
+{
+    for(uint8_t ep = 1; ep <= GZ_NUM_EP; ep++)
+    {
+        reset_ep(ep, OUT);
+        reset_ep(ep, IN);
+        service_ep(ep);
+    }
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** LOCAL FUNCTIONS ******************************* */
+/* ************************************************************************** */
+
+static void fill_pattern(uint8_t* p_buffer)
+{
+    for(uint8_t i = 0; i < GZ_EP_SIZE; i++) p_buffer[i] = i;
+}
+
+static void service_ep(uint8_t ep)
+{
+    gz_ep_t* p_ep = &m_ep[ep - 1];
+    uint8_t  cnt;
+    
+    if(g_usb_ep_stat[ep][OUT].Halt || g_usb_ep_stat[ep][IN].Halt) return;
+    
+    if(p_ep->Mode == GZ_MODE_SOURCE_SINK)
+    {
+        // Sink, arm received buffers straight away.
+        while(p_ep->Out_Pending)
+        {
+            usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(ep, OUT, p_ep->Out_PPB)], &g_usb_ep_stat[ep][OUT], GZ_EP_SIZE);
+            USB_NEXT_TOGGLE(g_usb_ep_stat[ep][OUT].Data_Toggle_Val);
+            p_ep->Out_PPB = PPB_ADD(p_ep->Out_PPB, 1);
+            p_ep->Out_Pending--;
+        }
+        
+        // Source, the pattern is only written after a loopback used the buffer.
+        while(p_ep->In_Armed < GZ_NUM_BUFFERS)
+        {
+            if(p_ep->In_Dirty & (1 << p_ep->In_PPB))
+            {
+                fill_pattern(EP_BUFFER(ep, IN, p_ep->In_PPB));
+                p_ep->In_Dirty &= ~(1 << p_ep->In_PPB);
+            }
+            usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(ep, IN, p_ep->In_PPB)], &g_usb_ep_stat[ep][IN], p_ep->Source_Cnt);
+            USB_NEXT_TOGGLE(g_usb_ep_stat[ep][IN].Data_Toggle_Val);
+            p_ep->In_PPB = PPB_ADD(p_ep->In_PPB, 1);
+            p_ep->In_Armed++;
+        }
+    }
+    else
+    {
+        // Loopback, an OUT buffer is armed again once its data is in an IN buffer.
+        while(p_ep->Out_Pending && p_ep->In_Armed < GZ_NUM_BUFFERS)
+        {
+            cnt = g_usb_bd_table[EP_BD_INDEX(ep, OUT, p_ep->Out_PPB)].CNT;
+            usb_ram_copy(EP_BUFFER(ep, OUT, p_ep->Out_PPB), EP_BUFFER(ep, IN, p_ep->In_PPB), cnt);
+            p_ep->In_Dirty |= (1 << p_ep->In_PPB);
+            
+            usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(ep, IN, p_ep->In_PPB)], &g_usb_ep_stat[ep][IN], cnt);
+            USB_NEXT_TOGGLE(g_usb_ep_stat[ep][IN].Data_Toggle_Val);
+            p_ep->In_PPB = PPB_ADD(p_ep->In_PPB, 1);
+            p_ep->In_Armed++;
+            
+            usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(ep, OUT, p_ep->Out_PPB)], &g_usb_ep_stat[ep][OUT], GZ_EP_SIZE);
+            USB_NEXT_TOGGLE(g_usb_ep_stat[ep][OUT].Data_Toggle_Val);
+            p_ep->Out_PPB = PPB_ADD(p_ep->Out_PPB, 1);
+            p_ep->Out_Pending--;
+        }
+    }
+}
+
+static void reset_ep(uint8_t ep, uint8_t dir)
+{
+    gz_ep_t* p_ep = &m_ep[ep - 1];
+    
+    for(uint8_t ppb = 0; ppb < GZ_NUM_BUFFERS; ppb++) g_usb_bd_table[EP_BD_INDEX(ep, dir, ppb)].STAT = 0;
+    g_usb_ep_stat[ep][dir].Data_Toggle_Val = 0;
+    
+    if(dir == OUT)
+    {
+        // Buffers still armed were never completed, the SIE uses the first of them next.
+        p_ep->Out_PPB     = PPB_ADD(p_ep->Out_PPB, p_ep->Out_Pending);
+        p_ep->Out_Pending = GZ_NUM_BUFFERS;
+    }
+    else
+    {
+        p_ep->In_PPB   = PPB_ADD(p_ep->In_PPB, p_ep->In_Armed);
+        p_ep->In_Armed = 0;
+    }
+}
+
+static void set_mode(uint8_t ep, uint8_t mode, uint8_t source_cnt)
+{
+    m_ep[ep - 1].Mode       = mode;
+    m_ep[ep - 1].Source_Cnt = source_cnt ? source_cnt : GZ_EP_SIZE;
+    service_ep(ep);
+}
+
+/* ************************************************************************** */
\ No newline at end of file
@@ -0,0 +1,185 @@
+/**
+ * @file gadget_zero.h
+ * @brief Gadget Zero settings and function declarations.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Gadget Zero Example (vendor class source/sink and loopback).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GADGET_ZERO_H
+#define GADGET_ZERO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_hal.h"
+#include "usb.h"
+
+/* ************************************************************************** */
+/* ******************************** SETTINGS ******************************** */
+/* ************************************************************************** */
+
+// Every Endpoint from EP1 to EP(NUM_ENDPOINTS - 1) has an IN and an OUT.
+// Odd Endpoints are bulk, even Endpoints are interrupt.
+#define GZ_NUM_EP       (NUM_ENDPOINTS - 1)
+#define GZ_EP_SIZE      EP1_SIZE // All Endpoints are the same size.
+#define GZ_INT_INTERVAL 1        // bInterval of the interrupt Endpoints (ms).
+
+// Mode each Endpoint starts in after SET_CONFIGURATION.
+#define GZ_DEFAULT_MODE GZ_MODE_SOURCE_SINK
+
+#if GZ_NUM_EP < 1 || GZ_NUM_EP > 7
+#error "Gadget Zero uses EP1 to EP7, NUM_ENDPOINTS must be 2 to 8."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************* GADGET ZERO REQUESTS *************************** */
+/* ************************************************************************** */
+
+/*
+ * Vendor requests, on the device or the interface:
+ * GZ_REQUEST_SET_MODE bmRequestType 0x40/0x41, wValue low byte the mode, wValue 
+ * high byte the IN packet length for GZ_MODE_SOURCE_SINK (0 = GZ_EP_SIZE), 
+ * wIndex the Endpoint number or 0 for all of them.
+ * GZ_REQUEST_GET_MODE bmRequestType 0xC0/0xC1, wIndex the Endpoint number, 
+ * returns the mode (1 byte).
+ * 
+ * Stop traffic on an Endpoint before changing its mode, IN packets already 
+ * armed are still sent.
+ */
+#define GZ_REQUEST_SET_MODE 0x01
+#define GZ_REQUEST_GET_MODE 0x02
+
+#define GZ_MODE_SOURCE_SINK 0 // IN always sends the pattern, OUT is thrown away.
+#define GZ_MODE_LOOPBACK    1 // Every OUT packet is sent back on the same Endpoint's IN.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ GADGET ZERO EP BUFFERS ************************** */
+/* ************************************************************************** */
+
+#if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
+#define GZ_NUM_BUFFERS 1
+#else
+#define GZ_NUM_BUFFERS 2
+#endif
+
+// PIC16 EP0 buffers are at the top of USB RAM, the EP buffers start in bank 1 (or after the BDT).
+// PIC18 EP buffers come from the allocator in usb_hal.h, EP2_SIZE to EP7_SIZE are set to EP1_SIZE.
+#ifdef _PIC14E
+#if BDT_SIZE <= 0x50
+#define GZ_EP_BUFFERS_BASE_ADDR 0x2050
+#else
+#define GZ_EP_BUFFERS_BASE_ADDR (BDT_BASE_ADDR + BDT_SIZE)
+#endif
+#else
+#define GZ_EP_BUFFERS_BASE_ADDR EP_OUT_EVEN_BUFFER_ADDR(EP1)
+#endif
+
+#define GZ_EP_BUFFERS_SIZE (GZ_NUM_EP * 2 * GZ_NUM_BUFFERS * GZ_EP_SIZE)
+
+#if defined(_PIC14E) && ((GZ_EP_BUFFERS_BASE_ADDR + GZ_EP_BUFFERS_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "Gadget Zero's EP buffers overlap the EP0 buffers, reduce NUM_ENDPOINTS, EP1_SIZE or EP0_SIZE."
+#elif !defined(_PIC14E) && ((GZ_EP_BUFFERS_BASE_ADDR + GZ_EP_BUFFERS_SIZE) != EP_BUFFERS_END_ADDR)
+#error "Gadget Zero's EP buffers don't match the allocator, set EP2_SIZE to EP7_SIZE to EP1_SIZE in usb_config.h."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** GADGET ZERO FUNCTIONS ************************* */
+/* ************************************************************************** */
+
+/**
+ * @fn void gz_init(void)
+ * 
+ * @brief Sets up EP1 to EP(NUM_ENDPOINTS - 1) and starts them in GZ_DEFAULT_MODE.
+ * 
+ * Every OUT buffer is armed, and in GZ_MODE_SOURCE_SINK every IN buffer is too.
+ */
+void gz_init(void);
+
+/**
+ * @fn void gz_tasks(void)
+ * 
+ * @brief Services a completed transaction on any Gadget Zero Endpoint.
+ */
+void gz_tasks(void);
+
+/**
+ * @fn void gz_in_tasks(void)
+ * 
+ * @brief Services a completed IN transaction, TRANSACTION_EP gives the Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void gz_in_tasks(void);
+
+/**
+ * @fn void gz_out_tasks(void)
+ * 
+ * @brief Services a completed OUT transaction, TRANSACTION_EP gives the Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void gz_out_tasks(void);
+
+/**
+ * @fn bool gz_vendor_request(void)
+ * 
+ * @brief Used to service the Gadget Zero vendor requests.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+bool gz_vendor_request(void);
+
+/**
+ * @fn void gz_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+ * 
+ * @brief Clears a halt/stall condition on a Gadget Zero Endpoint.
+ * 
+ * @param[in] bdt_index Buffer Descriptor Index.
+ * @param[in] ep Endpoint number.
+ * @param[in] dir Endpoint direction.
+ * 
+ * The Endpoint's Data Toggle goes back to DATA0 and its buffers are armed 
+ * again.
+ */
+void gz_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir);
+
+/**
+ * @fn void gz_reset_ep_toggle(void)
+ * 
+ * @brief Puts every Gadget Zero Endpoint back to DATA0, used for SET_INTERFACE.
+ */
+void gz_reset_ep_toggle(void);
+
+/* ************************************************************************** */
+
+#endif /* GADGET_ZERO_H */
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * @file usb_app.c
+ * @brief Contains application specific functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Application file (This file is for the Gadget Zero Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+ 
+#include <stdbool.h>
+#include "usb.h"
+#include "usb_app.h"
+#include "gadget_zero.h"
+
+
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [EP1][OUT] = gz_out_tasks,
+    [EP1][IN]  = gz_in_tasks,
+    #if GZ_NUM_EP > 1
+    [EP2][OUT] = gz_out_tasks,
+    [EP2][IN]  = gz_in_tasks,
+    #endif
+    #if GZ_NUM_EP > 2
+    [EP3][OUT] = gz_out_tasks,
+    [EP3][IN]  = gz_in_tasks,
+    #endif
+    #if GZ_NUM_EP > 3
+    [EP4][OUT] = gz_out_tasks,
+    [EP4][IN]  = gz_in_tasks,
+    #endif
+    #if GZ_NUM_EP > 4
+    [EP5][OUT] = gz_out_tasks,
+    [EP5][IN]  = gz_in_tasks,
+    #endif
+    #if GZ_NUM_EP > 5
+    [EP6][OUT] = gz_out_tasks,
+    [EP6][IN]  = gz_in_tasks,
+    #endif
+    #if GZ_NUM_EP > 6
+    [EP7][OUT] = gz_out_tasks,
+    [EP7][IN]  = gz_in_tasks
+    #endif
+};
+#endif
+
+
+bool usb_service_class_request(void)
+{
+    return gz_vendor_request();
+}
+
+bool usb_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+{
+    return false;
+}
+
+
+void usb_app_init(void)
+{
+    gz_init();
+}
+
+
+void usb_app_tasks(void)
+{
+    gz_tasks(); // Every EP after EP0 belongs to Gadget Zero.
+}
+
+
+void usb_app_clear_halt(uint8_t bd_table_index, uint8_t ep, uint8_t dir)
+{
+    gz_clear_halt(bd_table_index, ep, dir);
+}
+
+
+bool usb_app_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    if(alternate_setting != 0 || interface != 0) return false;
+
+    gz_reset_ep_toggle();
+    return true;
+}
+
+
+bool usb_app_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    return false;
+}
+
+
+bool usb_out_control_finished(void)
+{
+    return false;
+}
\ No newline at end of file
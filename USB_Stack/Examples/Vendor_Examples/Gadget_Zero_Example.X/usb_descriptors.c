@@ -0,0 +1,191 @@
+/**
+ * @file usb_descriptors.c
+ * @brief Contains core USB stack descriptors stored in ROM.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Stack (This file is for the Gadget Zero Example).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_config.h"
+#include "usb_ch9.h"
+#include "gadget_zero.h"
+
+/** Device Descriptor */
+const ch9_device_descriptor_t g_device_descriptor =
+{
+    0x12,           // bLength:8 -  Size of descriptor in bytes
+    DEVICE_DESC,    // bDescriptorType:8  - Device descriptor type
+    0x0200,         // bcdUSB:16 -  USB in BCD (2.0H)
+    0x00,           // bDeviceClass:8
+    0x00,           // bDeviceSubClass:8
+    0x00,           // bDeviceProtocol:8
+    EP0_SIZE,       // bMaxPacketSize0:8 - Maximum packet size
+    0x04D8,         // idVendor:16 - Microchip VID = 0x04D8
+    0x0053,         // idProduct:16 - Product ID (PID) = 0x0053
+    0x0100,         // bcdDevice:16 - Device release number in BCD
+    0x01,           // iManufacturer:8 - Manufacturer string index
+    0x02,           // iProduct:8 - Product string index
+    0x00,           // iSerialNumber:8 - Device serial number string index
+    0x01            // bNumConfigurations:8 - Number of possible configurations
+};
+
+/** Endpoint Descriptors for one Gadget Zero Endpoint, IN then OUT */
+#define GZ_EP_DESCRIPTORS(ep, attributes, interval) \
+    {7, ENDPOINT_DESC, 0x80 | (ep), (attributes), GZ_EP_SIZE, (interval)}, \
+    {7, ENDPOINT_DESC, (ep),        (attributes), GZ_EP_SIZE, (interval)}
+
+#define BULK      0x02
+#define INTERRUPT 0x03
+
+/** Configuration Descriptor Structure */
+typedef struct
+{
+    ch9_configutarion_descriptor_t      configuration0_descriptor;
+    ch9_standard_interface_descriptor_t interface0_descriptor;
+    ch9_standard_endpoint_descriptor_t  ep_descriptors[GZ_NUM_EP * 2];
+}config_descriptor_t;
+
+/** Configuration Descriptor */
+static const config_descriptor_t config_descriptor0 =
+{
+    // Configuration Descriptor
+    {
+        9,                          // bLength:8 - Size of configuration descriptor in bytes
+        CONFIGURATION_DESC,         // bDescriptorType:8 - Configuration descriptor type
+        sizeof(config_descriptor0), // wTotalLength:16 - Total amount of bytes in descriptors belonging to this configuration
+        0x01,                       // bNumInterfaces:8 - Number of interfaces in this configuration
+        0x01,                       // bConfigurationValue:8 - Index value for this configuration
+        0x00,                       // iConfiguration:8 - Index of string describing this configuration
+        0xC0,                       // bmAttributes:8 {0:5,RemoteWakeup:1,SelfPowered:1,1:1} - Self Powered
+        50                          // bMaxPower:8 - 100mA power allowed (increments of 2mA)
+    },
+
+    // Interface Descriptor
+    {
+        9,              // bLength:8 - Size of interface descriptor in bytes           
+        INTERFACE_DESC, // bDescriptorType:8 - Interface descriptor type
+        0x00,           // bInterfaceNumber:8 - Index number of interface
+        0x00,           // bAlternateSetting:8 - Value used to select alternate setting
+        GZ_NUM_EP * 2,  // bNumEndpoints:8 - Number of endpoints used in this interface
+        VENDOR_CLASS,   // bInterfaceClass:8 - Class Code (Assigned by USB Org)
+        0,              // bInterfaceSubClass:8 - Subclass Code (Assigned by USB Org)
+        0,              // bInterfaceProtocol:8 - Protocol Code (Assigned by USB Org)
+        0x00            // iInterface:8 - Index of String Descriptor Describing this interface
+    },
+
+    // Endpoint Descriptors, odd Endpoints are bulk and even ones interrupt.
+    {
+        GZ_EP_DESCRIPTORS(EP1, BULK, 0)
+        #if GZ_NUM_EP > 1
+        , GZ_EP_DESCRIPTORS(EP2, INTERRUPT, GZ_INT_INTERVAL)
+        #endif
+        #if GZ_NUM_EP > 2
+        , GZ_EP_DESCRIPTORS(EP3, BULK, 0)
+        #endif
+        #if GZ_NUM_EP > 3
+        , GZ_EP_DESCRIPTORS(EP4, INTERRUPT, GZ_INT_INTERVAL)
+        #endif
+        #if GZ_NUM_EP > 4
+        , GZ_EP_DESCRIPTORS(EP5, BULK, 0)
+        #endif
+        #if GZ_NUM_EP > 5
+        , GZ_EP_DESCRIPTORS(EP6, INTERRUPT, GZ_INT_INTERVAL)
+        #endif
+        #if GZ_NUM_EP > 6
+        , GZ_EP_DESCRIPTORS(EP7, BULK, 0)
+        #endif
+    }
+};
+
+/** Configuration Descriptor Addresses Array */
+const uint16_t g_config_descriptors[] = 
+{
+    (uint16_t)&config_descriptor0
+};
+
+#ifdef USE_FAST_ENUMERATION
+/** Configuration Descriptor Lengths Array */
+const uint16_t g_config_descriptor_lengths[] =
+{
+    sizeof(config_descriptor0)
+};
+#endif
+
+/** String Zero Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t wLANGID[1];
+}string_zero_descriptor_t;
+
+/** Vendor String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[6];
+}vendor_string_descriptor_t;
+
+/** Product String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[11];
+}product_string_descriptor_t;
+    
+/** String Zero Descriptor */
+static const string_zero_descriptor_t string_zero_descriptor =
+{
+    sizeof(string_zero_descriptor_t),
+    STRING_DESC,
+    {0x0409}
+};
+
+/** Vendor String Descriptor */
+static const vendor_string_descriptor_t vendor_string_descriptor =
+{
+    sizeof(vendor_string_descriptor_t),
+    STRING_DESC,
+    {'J','o','h','n','n','y'}
+};
+
+/** Product String Descriptor */
+static const product_string_descriptor_t product_string_descriptor =
+{
+    sizeof(product_string_descriptor_t),
+    STRING_DESC,
+    {'G','a','d','g','e','t',' ','Z','e','r','o'}
+};
+
+/** String Descriptor Addresses Array */
+const uint16_t g_string_descriptors[] =
+{
+    (uint16_t)&string_zero_descriptor,
+    (uint16_t)&vendor_string_descriptor,
+    (uint16_t)&product_string_descriptor
+};
+
+/** String Descriptor Addresses Array Size */
+const uint8_t g_size_of_sd = sizeof(g_string_descriptors);
\ No newline at end of file
@@ -0,0 +1,364 @@
+/**
+ * @file bridge.c
+ * @brief SPI and I2C command lists run from Vendor bulk transfers.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Vendor Bridge Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_vendor.h"
+#include "bridge.h"
+
+/* ************************************************************************** */
+/* ***************************** LOCAL DEFINES ****************************** */
+/* ************************************************************************** */
+
+#define MODE_SPI 0
+#define MODE_I2C 1
+
+// SSPCON2 bits.
+#define I2C_SEN     0x01
+#define I2C_RSEN    0x02
+#define I2C_PEN     0x04
+#define I2C_RCEN    0x08
+#define I2C_ACKEN   0x10
+#define I2C_ACKDT   0x20
+#define I2C_ACKSTAT 0x40
+
+#define SSPSTAT_BF  0x01
+#define SSPSTAT_RW  0x04 // Master mode: a byte is being sent.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static uint8_t *m_p_out;   // OUT packet the list is read from, m_out_cnt bytes.
+static uint8_t  m_out_cnt;
+static uint8_t  m_out_pos;
+static bool     m_out_last; // m_p_out is the short packet that ends the list.
+static uint8_t *m_p_in;     // IN buffer results go in, NULL until one is needed.
+static uint8_t  m_in_cnt;
+static bool     m_lost;     // No longer configured, the list is dropped.
+static uint8_t  m_mode;
+static bool     m_i2c_held; // The last I2C op was BRIDGE_I2C_NO_STOP.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+static uint8_t run_op(uint8_t op);
+static uint8_t i2c_op(uint8_t op);
+static void    spi_config(uint8_t mode, uint8_t clock);
+static void    i2c_config(uint8_t speed);
+static uint8_t spi_xfer(uint8_t data);
+static bool    i2c_idle(void);
+static uint8_t i2c_send(uint8_t data);
+static uint8_t i2c_stop(uint8_t status);
+static bool    get_byte(uint8_t *p_data);
+static void    put_byte(uint8_t data);
+static void    end_in(void);
+static bool    wait_usb(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void bridge_init(void)
+{
+    BRIDGE_PINS_INIT();
+    spi_config(0, 0);
+}
+
+void bridge_tasks(void)
+{
+    uint8_t  op;
+    uint8_t  status = BRIDGE_OK;
+    uint16_t done = 0;
+
+    if((m_p_out = vendor_peek_out(&m_out_cnt)) == NULL) return;
+    m_out_pos = 0;
+    m_out_last = m_out_cnt < VENDOR_EP_SIZE;
+    m_p_in = NULL;
+    m_lost = false;
+
+    while(get_byte(&op))
+    {
+        if((status = run_op(op)) != BRIDGE_OK) break;
+        done++;
+    }
+    if(m_i2c_held) status = i2c_stop(status); // The list ended holding the bus.
+    while(get_byte(&op)){} // The rest of a failed list.
+    if(m_lost) return;
+
+    put_byte(status);
+    put_byte((uint8_t)done);
+    put_byte((uint8_t)(done >> 8));
+    end_in();
+    if(!m_lost) vendor_release_out();
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+static uint8_t run_op(uint8_t op)
+{
+    uint8_t  n, data, arg;
+    uint16_t us;
+
+    switch(op)
+    {
+        case BRIDGE_SPI_CONFIG:
+            if(!get_byte(&n) || !get_byte(&arg)) return BRIDGE_ERR_SHORT;
+            if(n > 3 || arg > 2) return BRIDGE_ERR_ARG;
+            if(m_i2c_held) return BRIDGE_ERR_MODE;
+            spi_config(n, arg);
+            return BRIDGE_OK;
+
+        case BRIDGE_SPI_CS:
+            if(!get_byte(&arg)) return BRIDGE_ERR_SHORT;
+            BRIDGE_CS = arg ? 1 : 0;
+            return BRIDGE_OK;
+
+        case BRIDGE_SPI_WRITE:
+        case BRIDGE_SPI_READ:
+        case BRIDGE_SPI_XFER:
+            if(!get_byte(&n)) return BRIDGE_ERR_SHORT;
+            if(m_mode != MODE_SPI) return BRIDGE_ERR_MODE;
+            for(; n; n--)
+            {
+                data = 0xFF;
+                if(op != BRIDGE_SPI_READ && !get_byte(&data)) return BRIDGE_ERR_SHORT;
+                data = spi_xfer(data);
+                if(op != BRIDGE_SPI_WRITE) put_byte(data);
+            }
+            return BRIDGE_OK;
+
+        case BRIDGE_I2C_CONFIG:
+            if(!get_byte(&arg)) return BRIDGE_ERR_SHORT;
+            if(arg > 1) return BRIDGE_ERR_ARG;
+            if(m_i2c_held) return BRIDGE_ERR_MODE;
+            i2c_config(arg);
+            return BRIDGE_OK;
+
+        case BRIDGE_I2C_WRITE:
+        case BRIDGE_I2C_READ:
+        case BRIDGE_I2C_WRITE | BRIDGE_I2C_NO_STOP:
+        case BRIDGE_I2C_READ | BRIDGE_I2C_NO_STOP:
+            return i2c_op(op);
+
+        case BRIDGE_DELAY_US:
+            if(!get_byte(&n) || !get_byte(&arg)) return BRIDGE_ERR_SHORT;
+            for(us = ((uint16_t)arg << 8) | n; us; us--) __delay_us(1);
+            return BRIDGE_OK;
+    }
+    return BRIDGE_ERR_OPCODE;
+}
+
+static uint8_t i2c_op(uint8_t op)
+{
+    bool    read = (op & ~BRIDGE_I2C_NO_STOP) == BRIDGE_I2C_READ;
+    uint8_t addr, n, data, status;
+
+    if(!get_byte(&addr) || !get_byte(&n)) return BRIDGE_ERR_SHORT;
+    if(m_mode != MODE_I2C) return BRIDGE_ERR_MODE;
+    if(addr > 0x7F) return BRIDGE_ERR_ARG;
+
+    BRIDGE_SSPCON2 |= m_i2c_held ? I2C_RSEN : I2C_SEN;
+    m_i2c_held = true;
+    if(!i2c_idle()) return i2c_stop(BRIDGE_ERR_BUS);
+    if((status = i2c_send((uint8_t)(addr << 1) | read)) != BRIDGE_OK) return i2c_stop(status);
+    for(; n; n--)
+    {
+        if(read)
+        {
+            BRIDGE_SSPCON2 |= I2C_RCEN;
+            if(!i2c_idle()) return i2c_stop(BRIDGE_ERR_BUS);
+            put_byte(BRIDGE_SSPBUF);
+            if(n == 1) BRIDGE_SSPCON2 |= I2C_ACKDT; // NACK the last byte.
+            else BRIDGE_SSPCON2 &= ~I2C_ACKDT;
+            BRIDGE_SSPCON2 |= I2C_ACKEN;
+            if(!i2c_idle()) return i2c_stop(BRIDGE_ERR_BUS);
+        }
+        else
+        {
+            if(!get_byte(&data)) return i2c_stop(BRIDGE_ERR_SHORT);
+            if((status = i2c_send(data)) != BRIDGE_OK) return i2c_stop(status);
+        }
+    }
+    return (op & BRIDGE_I2C_NO_STOP) ? BRIDGE_OK : i2c_stop(BRIDGE_OK);
+}
+
+static void spi_config(uint8_t mode, uint8_t clock)
+{
+    BRIDGE_SSPCON1 = 0;
+    BRIDGE_SPI_PINS();
+    BRIDGE_SSPSTAT = (mode & 1) ? 0x00 : 0x40;          // CKE, data changes on the active to idle edge in modes 0 and 2.
+    BRIDGE_SSPCON1 = 0x20 | ((mode & 2) << 3) | clock; // SSPEN, CKP, SSPM 0 to 2.
+    m_mode = MODE_SPI;
+}
+
+static void i2c_config(uint8_t speed)
+{
+    BRIDGE_SSPCON1 = 0;
+    BRIDGE_I2C_PINS();
+    BRIDGE_SSPADD  = speed ? BRIDGE_I2C_400K : BRIDGE_I2C_100K;
+    BRIDGE_SSPSTAT = speed ? 0x00 : 0x80; // SMP, slew rate control off at 100 kHz.
+    BRIDGE_SSPCON2 = 0;
+    BRIDGE_SSPCON1 = 0x28; // SSPEN, I2C Master.
+    m_mode = MODE_I2C;
+}
+
+static uint8_t spi_xfer(uint8_t data)
+{
+    BRIDGE_SSPBUF = data;
+    while(!(BRIDGE_SSPSTAT & SSPSTAT_BF));
+    return BRIDGE_SSPBUF;
+}
+
+/*
+ * Waits for a start, stop, receive, acknowledge or sent byte to finish.
+ * Returns false if it doesn't, a slave holding SCL low for too long.
+ */
+static bool i2c_idle(void)
+{
+    uint16_t timeout = BRIDGE_I2C_TIMEOUT;
+
+    while((BRIDGE_SSPCON2 & (I2C_SEN | I2C_RSEN | I2C_PEN | I2C_RCEN | I2C_ACKEN)) || (BRIDGE_SSPSTAT & SSPSTAT_RW))
+    {
+        if(!--timeout) return false;
+    }
+    return true;
+}
+
+static uint8_t i2c_send(uint8_t data)
+{
+    BRIDGE_SSPBUF = data;
+    if(!i2c_idle()) return BRIDGE_ERR_BUS;
+    return (BRIDGE_SSPCON2 & I2C_ACKSTAT) ? BRIDGE_ERR_NACK : BRIDGE_OK;
+}
+
+/*
+ * Ends the transfer with a stop and gives back status, or BRIDGE_ERR_BUS if
+ * the stop doesn't finish.
+ */
+static uint8_t i2c_stop(uint8_t status)
+{
+    m_i2c_held = false;
+    BRIDGE_SSPCON2 |= I2C_PEN;
+    if(!i2c_idle() && status == BRIDGE_OK) return BRIDGE_ERR_BUS;
+    return status;
+}
+
+/*
+ * Next byte of the list, moving on to the next OUT packet when one runs out.
+ * Returns false at the end of the list.
+ */
+static bool get_byte(uint8_t *p_data)
+{
+    while(m_out_pos == m_out_cnt)
+    {
+        if(m_out_last || m_lost) return false;
+        vendor_release_out();
+        while((m_p_out = vendor_peek_out(&m_out_cnt)) == NULL)
+        {
+            if(!wait_usb()) return false;
+        }
+        m_out_pos = 0;
+        m_out_last = m_out_cnt < VENDOR_EP_SIZE;
+    }
+    *p_data = m_p_out[m_out_pos++];
+    return true;
+}
+
+/*
+ * Adds a result byte, each full IN buffer is armed straight away so the host
+ * reads while the list carries on.
+ */
+static void put_byte(uint8_t data)
+{
+    if(m_p_in == NULL)
+    {
+        while((m_p_in = vendor_acquire_in()) == NULL)
+        {
+            if(!wait_usb()) return;
+        }
+        m_in_cnt = 0;
+    }
+    m_p_in[m_in_cnt++] = data;
+    if(m_in_cnt == VENDOR_EP_SIZE)
+    {
+        vendor_commit_in(VENDOR_EP_SIZE);
+        m_p_in = NULL;
+    }
+}
+
+// Arms what's left as a short packet, or a zero length one, to end the IN transfer.
+static void end_in(void)
+{
+    if(m_p_in == NULL)
+    {
+        while((m_p_in = vendor_acquire_in()) == NULL)
+        {
+            if(!wait_usb()) return;
+        }
+        m_in_cnt = 0;
+    }
+    vendor_commit_in(m_in_cnt);
+    m_p_in = NULL;
+}
+
+/*
+ * Lets the USB stack run while waiting on a buffer. Returns false, and sets
+ * m_lost, once the device is no longer configured.
+ */
+static bool wait_usb(void)
+{
+    #ifdef USE_POLLING
+    usb_tasks();
+    #endif
+    #ifdef USE_DEFERRED_TASKS
+    usb_deferred_tasks();
+    #endif
+    if(usb_get_state() != STATE_CONFIGURED) m_lost = true;
+    return !m_lost;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,192 @@
+/**
+ * @file bridge.h
+ * @brief SPI and I2C command lists run from Vendor bulk transfers.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Vendor Bridge Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ************************************************************************** */
+/* *************************** BRIDGE SETTINGS ****************************** */
+/* ************************************************************************** */
+
+/*
+ * The MSSP is used for both buses, so SCK is also SCL and SDI is also SDA.
+ * BRIDGE_SPI_CONFIG and BRIDGE_I2C_CONFIG switch it and its pins over. CS is
+ * a plain output, high until a BRIDGE_SPI_CS lowers it.
+ */
+#if defined(_16F1459)
+#define BRIDGE_SSPBUF   SSP1BUF
+#define BRIDGE_SSPSTAT  SSP1STAT
+#define BRIDGE_SSPCON1  SSP1CON1
+#define BRIDGE_SSPCON2  SSP1CON2
+#define BRIDGE_SSPADD   SSP1ADD
+#define BRIDGE_PINS_INIT() do{ANSELB &= 0xEF; ANSELC &= 0x3F; LATCbits.LATC6 = 1; TRISC &= 0xBF;}while(0) // SDI/SDA RB4, SCK/SCL RB6, SDO RC7, CS RC6.
+#define BRIDGE_SPI_PINS()  do{TRISB |= 0x10; TRISB &= 0xBF; TRISC &= 0x7F;}while(0)
+#define BRIDGE_I2C_PINS()  do{TRISB |= 0x50; TRISC |= 0x80;}while(0)
+#define BRIDGE_CS          LATCbits.LATC6
+
+#elif defined(_16F1454) || defined(_16F1455)
+#define BRIDGE_SSPBUF   SSP1BUF
+#define BRIDGE_SSPSTAT  SSP1STAT
+#define BRIDGE_SSPCON1  SSP1CON1
+#define BRIDGE_SSPCON2  SSP1CON2
+#define BRIDGE_SSPADD   SSP1ADD
+#if defined(_16F1455)
+#define BRIDGE_PINS_INIT() do{ANSELC &= 0xF0; LATCbits.LATC3 = 1; TRISC &= 0xF7;}while(0) // SCK/SCL RC0, SDI/SDA RC1, SDO RC2, CS RC3.
+#else
+#define BRIDGE_PINS_INIT() do{LATCbits.LATC3 = 1; TRISC &= 0xF7;}while(0) // SCK/SCL RC0, SDI/SDA RC1, SDO RC2, CS RC3.
+#endif
+#define BRIDGE_SPI_PINS()  do{TRISC |= 0x02; TRISC &= 0xFA;}while(0)
+#define BRIDGE_I2C_PINS()  do{TRISC |= 0x07;}while(0)
+#define BRIDGE_CS          LATCbits.LATC3
+
+#elif defined(_18F13K50) || defined(_18F14K50)
+#define BRIDGE_SSPBUF   SSPBUF
+#define BRIDGE_SSPSTAT  SSPSTAT
+#define BRIDGE_SSPCON1  SSPCON1
+#define BRIDGE_SSPCON2  SSPCON2
+#define BRIDGE_SSPADD   SSPADD
+#define BRIDGE_PINS_INIT() do{ANSELH &= 0xF8; LATCbits.LATC6 = 1; TRISC &= 0xBF;}while(0) // SDI/SDA RB4, SCK/SCL RB6, SDO RC7, CS RC6.
+#define BRIDGE_SPI_PINS()  do{TRISB |= 0x10; TRISB &= 0xBF; TRISC &= 0x7F;}while(0)
+#define BRIDGE_I2C_PINS()  do{TRISB |= 0x50; TRISC |= 0x80;}while(0)
+#define BRIDGE_CS          LATCbits.LATC6
+
+#elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+#define BRIDGE_SSPBUF   SSP1BUF
+#define BRIDGE_SSPSTAT  SSP1STAT
+#define BRIDGE_SSPCON1  SSP1CON1
+#define BRIDGE_SSPCON2  SSP1CON2
+#define BRIDGE_SSPADD   SSP1ADD
+#define BRIDGE_PINS_INIT() do{ANSELB &= 0xFC; ANSELC &= 0x3F; LATCbits.LATC6 = 1; TRISC &= 0xBF;}while(0) // SDI/SDA RB0, SCK/SCL RB1, SDO RC7, CS RC6.
+#define BRIDGE_SPI_PINS()  do{TRISB |= 0x01; TRISB &= 0xFD; TRISC &= 0x7F;}while(0)
+#define BRIDGE_I2C_PINS()  do{TRISB |= 0x03; TRISC |= 0x80;}while(0)
+#define BRIDGE_CS          LATCbits.LATC6
+
+#elif defined(_18F4550_FAMILY_) || defined(_18F4450_FAMILY_)
+#define BRIDGE_SSPBUF   SSPBUF
+#define BRIDGE_SSPSTAT  SSPSTAT
+#define BRIDGE_SSPCON1  SSPCON1
+#define BRIDGE_SSPCON2  SSPCON2
+#define BRIDGE_SSPADD   SSPADD
+#define BRIDGE_PINS_INIT() do{ADCON1 |= 0x0F; LATCbits.LATC6 = 1; TRISC &= 0xBF;}while(0) // SDI/SDA RB0, SCK/SCL RB1, SDO RC7, CS RC6.
+#define BRIDGE_SPI_PINS()  do{TRISB |= 0x01; TRISB &= 0xFD; TRISC &= 0x7F;}while(0)
+#define BRIDGE_I2C_PINS()  do{TRISB |= 0x03; TRISC |= 0x80;}while(0)
+#define BRIDGE_CS          LATCbits.LATC6
+
+#elif defined(__J_PART)
+#define BRIDGE_SSPBUF   SSP1BUF
+#define BRIDGE_SSPSTAT  SSP1STAT
+#define BRIDGE_SSPCON1  SSP1CON1
+#define BRIDGE_SSPCON2  SSP1CON2
+#define BRIDGE_SSPADD   SSP1ADD
+#define BRIDGE_PINS_INIT() do{LATCbits.LATC6 = 1; TRISC &= 0xBF;}while(0) // SCK1/SCL1 RB4, SDI1/SDA1 RB5, SDO1 RC7, CS RC6.
+#define BRIDGE_SPI_PINS()  do{TRISB |= 0x20; TRISB &= 0xEF; TRISC &= 0x7F;}while(0)
+#define BRIDGE_I2C_PINS()  do{TRISB |= 0x30; TRISC |= 0x80;}while(0)
+#define BRIDGE_CS          LATCbits.LATC6
+
+#else
+#error "Bridge: This part has no MSSP, or its pins haven't been set up in bridge.h."
+#endif
+
+#define BRIDGE_I2C_100K    ((_XTAL_FREQ / 400000UL) - 1)  // SSPADD for 100 kHz.
+#define BRIDGE_I2C_400K    ((_XTAL_FREQ / 1600000UL) - 1) // SSPADD for 400 kHz.
+#define BRIDGE_I2C_TIMEOUT 50000 // Polls of the MSSP before a held SCL is a bus error, tens of ms.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** BRIDGE DEFINES ***************************** */
+/* ************************************************************************** */
+
+/*
+ * A command list is one OUT transfer of ops back to back, ended by a short
+ * packet (a zero length one if it fills its last packet). The ops run as their
+ * bytes arrive, and everything they read comes back in one IN transfer,
+ * in order, followed by [status][ops done LSB][ops done MSB]. The first op
+ * that fails ends the list, its status says why, and the rest is skipped.
+ * 
+ * Full IN packets are armed as they fill, so the host has to start reading
+ * before it sends the list: a long list's results fill both IN buffers well
+ * before the rest of the list has arrived (Tools/Bus_Bridge does this).
+ */
+#define BRIDGE_SPI_CONFIG  0x01 // [mode 0 to 3][clock 0 to 2: Fosc/4, Fosc/16, Fosc/64]
+#define BRIDGE_SPI_CS      0x02 // [level], 0 selects.
+#define BRIDGE_SPI_WRITE   0x03 // [n][n bytes], what comes back is dropped.
+#define BRIDGE_SPI_READ    0x04 // [n], n 0xFF bytes out, n bytes back.
+#define BRIDGE_SPI_XFER    0x05 // [n][n bytes], n bytes back.
+#define BRIDGE_I2C_CONFIG  0x08 // [speed 0: 100 kHz, 1: 400 kHz]
+#define BRIDGE_I2C_WRITE   0x09 // [7 bit address][n][n bytes]
+#define BRIDGE_I2C_READ    0x0A // [7 bit address][n], n bytes back.
+#define BRIDGE_DELAY_US    0x10 // [us LSB][us MSB], at least that long.
+#define BRIDGE_I2C_NO_STOP 0x80 // Or'd with BRIDGE_I2C_WRITE or BRIDGE_I2C_READ, the bus is kept and 
+                                // the next I2C op starts with a repeated start.
+
+// List status.
+#define BRIDGE_OK          0x00
+#define BRIDGE_ERR_OPCODE  0x01 // Unknown op.
+#define BRIDGE_ERR_ARG     0x02 // An argument out of range.
+#define BRIDGE_ERR_MODE    0x03 // An SPI op with the MSSP in I2C mode, or the other way around.
+#define BRIDGE_ERR_SHORT   0x04 // The list ended part way into an op.
+#define BRIDGE_ERR_NACK    0x05 // An I2C address or data byte wasn't acknowledged.
+#define BRIDGE_ERR_BUS     0x06 // I2C timed out, SCL or SDA is held low.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ BRIDGE GLOBAL FUNCTIONS ************************* */
+/* ************************************************************************** */
+
+/**
+ * @fn void bridge_init(void)
+ * 
+ * @brief Sets up the pins, the MSSP starts off in SPI mode 0 at Fosc/4.
+ * 
+ * Call it before usb_init().
+ */
+void bridge_init(void);
+
+/**
+ * @fn void bridge_tasks(void)
+ * 
+ * @brief Runs a command list if one has started to arrive.
+ * 
+ * Call it from the main loop while the device is configured. It returns once
+ * the whole list has been run and its results are armed, or the device is no
+ * longer configured. While it waits for packets it calls usb_tasks() with
+ * USE_POLLING and usb_deferred_tasks() with USE_DEFERRED_TASKS.
+ */
+void bridge_tasks(void);
+
+/* ************************************************************************** */
+
+#endif /* BRIDGE_H */
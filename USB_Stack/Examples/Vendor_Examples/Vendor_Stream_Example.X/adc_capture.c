@@ -0,0 +1,157 @@
+/**
+ * @file adc_capture.c
+ * @brief Timer triggered ADC capture, written straight into the Vendor IN buffers.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Vendor Stream Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_vendor_config.h"
+#ifdef VENDOR_ADC
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_vendor.h"
+#include "adc_capture.h"
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static uint8_t *m_p_packet; // IN buffer being filled, NULL until the next sample.
+static uint8_t  m_pos;      // Next byte of *m_p_packet.
+static uint8_t  m_seq;      // Sequence number of the next packet.
+static uint8_t  m_dropped;  // Samples dropped since the last packet.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void adc_capture_init(void)
+{
+    // Setup analog pin.
+    #if defined(_18F13K50) || defined(_18F14K50)
+    ADCON0bits.CHS = 10; // AN10 (RB4).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    ADCON0bits.CHS = 0; // AN0 (RA0).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    #elif defined(_18F4550_FAMILY_) || defined(_18F4450_FAMILY_)
+    ADCON1bits.PCFG = 1; // RA0 analog pin
+    ADCON0bits.CHS = 0; // AN0 (RA0).
+    ADCON2bits.ADCS = 0b110;
+    ADCON2bits.ACQT = 0b011;
+    #elif defined(__J_PART)
+    ADCON0bits.CHS = 8; // AN8 (RB2).
+    ADCON1bits.ADCS = 0b110;
+    ADCON1bits.ACQT = 0b011;
+    #endif
+    
+    #ifdef ADC_CAPTURE_8_BIT
+    ADC_CAPTURE_ADFM = 0;
+    #else
+    ADC_CAPTURE_ADFM = 1;
+    #endif
+    ADCON0bits.ADON = 1;
+    
+    // Timer1 on Fosc/4, reset by the trigger.
+    T1CON = 0x00;
+    ADC_CAPTURE_CCPCON = 0;
+    ADC_CAPTURE_CCPRL  = (uint8_t)(ADC_CAPTURE_PERIOD - 1);
+    ADC_CAPTURE_CCPRH  = (uint8_t)((ADC_CAPTURE_PERIOD - 1) >> 8);
+    ADC_INTERRUPT_ENABLE = 0;
+}
+
+void adc_capture_start(void)
+{
+    m_p_packet = NULL;
+    m_seq      = 0;
+    m_dropped  = 0;
+    
+    TMR1H = 0;
+    TMR1L = 0;
+    ADC_INTERRUPT_FLAG   = 0;
+    ADC_INTERRUPT_ENABLE = 1;
+    ADC_CAPTURE_CCPCON   = ADC_CAPTURE_SPECIAL_EVENT;
+    T1CONbits.TMR1ON     = 1;
+}
+
+void adc_capture_stop(void)
+{
+    T1CONbits.TMR1ON     = 0;
+    ADC_CAPTURE_CCPCON   = 0;
+    ADC_INTERRUPT_ENABLE = 0;
+    ADC_INTERRUPT_FLAG   = 0;
+    m_p_packet = NULL;
+}
+
+void adc_capture_tasks(void)
+{
+    if(!(ADC_INTERRUPT_ENABLE && ADC_INTERRUPT_FLAG)) return;
+    ADC_INTERRUPT_FLAG = 0;
+    
+    // A bus reset can come before the main loop stops the capture.
+    if(usb_get_state() != STATE_CONFIGURED)
+    {
+        m_p_packet = NULL;
+        return;
+    }
+    
+    if(m_p_packet == NULL)
+    {
+        if((m_p_packet = ADC_CAPTURE_ACQUIRE()) == NULL)
+        {
+            if(m_dropped != 0xFF) m_dropped++; // Both IN buffers are still armed.
+            return;
+        }
+        m_p_packet[0] = m_seq++;
+        m_p_packet[1] = m_dropped;
+        m_pos     = ADC_CAPTURE_HEADER_SIZE;
+        m_dropped = 0;
+    }
+    
+    #ifdef ADC_CAPTURE_8_BIT
+    m_p_packet[m_pos++] = ADRESH;
+    #else
+    m_p_packet[m_pos++] = ADRESL;
+    m_p_packet[m_pos++] = ADRESH;
+    #endif
+    
+    if(m_pos == ADC_CAPTURE_EP_SIZE)
+    {
+        ADC_CAPTURE_COMMIT(ADC_CAPTURE_EP_SIZE);
+        m_p_packet = NULL;
+    }
+}
+
+/* ************************************************************************** */
+
+#endif /* VENDOR_ADC */
@@ -0,0 +1,156 @@
+/**
+ * @file adc_capture.h
+ * @brief Timer triggered ADC capture, written straight into the Vendor IN buffers.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Vendor Stream Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ADC_CAPTURE_H
+#define ADC_CAPTURE_H
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_vendor_config.h"
+
+/* ************************************************************************** */
+/* ************************* ADC CAPTURE SETTINGS *************************** */
+/* ************************************************************************** */
+
+/*
+ * Timer1 counts Fosc/4 and a CCP module in compare mode with its special event
+ * trigger resets it every ADC_CAPTURE_PERIOD counts and starts a conversion,
+ * so the sample clock has no software jitter. The ADC interrupt then writes
+ * the result straight into the free Vendor IN buffer (vendor_acquire_in()),
+ * and commits it once ADC_CAPTURE_EP_SIZE bytes are in, there's no staging
+ * buffer or copy from the main loop.
+ * 
+ * Each packet starts with a header: a sequence number that goes up by one
+ * per packet, and the samples dropped (up to 255) since the last packet
+ * because both IN buffers were still waiting for the host. Samples follow,
+ * 2 bytes little endian (10 bits right justified), or 1 byte (the top 8 bits)
+ * with ADC_CAPTURE_8_BIT.
+ * 
+ * The ADC interrupt has to share the single interrupt vector with USB, so it
+ * never runs in the middle of the Vendor library. The trigger resets Timer1,
+ * it can't be TRACE_TIMER or TIMESTAMP_TIMER. PIC16F145X parts have no CCP
+ * module to trigger the ADC.
+ */
+#define ADC_CAPTURE_RATE 10000 // Samples per second.
+//#define ADC_CAPTURE_8_BIT    // 1 byte samples, ADRESH of a left justified result.
+
+#define ADC_CAPTURE_HEADER_SIZE 2 // Sequence number, dropped samples.
+#define ADC_CAPTURE_EP_SIZE     VENDOR_EP_SIZE
+#define ADC_CAPTURE_ACQUIRE()   vendor_acquire_in()
+#define ADC_CAPTURE_COMMIT(cnt) vendor_commit_in(cnt)
+
+#ifdef ADC_CAPTURE_8_BIT
+#define ADC_CAPTURE_SAMPLE_SIZE 1
+#else
+#define ADC_CAPTURE_SAMPLE_SIZE 2
+#endif
+
+// Timer1 counts between samples.
+#define ADC_CAPTURE_PERIOD ((_XTAL_FREQ / 4) / ADC_CAPTURE_RATE)
+
+#ifdef VENDOR_LOG
+#error "ADC CAPTURE: VENDOR_LOG and VENDOR_ADC both fill the IN buffers, define one of them."
+#endif
+
+#if defined(_PIC14E)
+#error "ADC CAPTURE: PIC16F145X parts have no CCP special event trigger, undefine VENDOR_ADC."
+#endif
+
+#if (ADC_CAPTURE_PERIOD < 300) || (ADC_CAPTURE_PERIOD > 65535)
+#error "ADC CAPTURE: ADC_CAPTURE_RATE is out of range, a conversion takes about 23us and Timer1 has 16 bits."
+#endif
+
+#if (ADC_CAPTURE_EP_SIZE - ADC_CAPTURE_HEADER_SIZE) % ADC_CAPTURE_SAMPLE_SIZE
+#error "ADC CAPTURE: The samples have to fill ADC_CAPTURE_EP_SIZE after the header."
+#endif
+
+// CCP HAL, the module whose special event trigger starts the ADC.
+#if defined(_18F13K50) || defined(_18F14K50)
+#define ADC_CAPTURE_CCPCON CCP1CON
+#define ADC_CAPTURE_CCPRL  CCPR1L
+#define ADC_CAPTURE_CCPRH  CCPR1H
+#else
+#define ADC_CAPTURE_CCPCON CCP2CON
+#define ADC_CAPTURE_CCPRL  CCPR2L
+#define ADC_CAPTURE_CCPRH  CCPR2H
+#endif
+#define ADC_CAPTURE_SPECIAL_EVENT 0x0B // CCPxM = 1011, compare with special event trigger.
+
+#if defined(__J_PART)
+#define ADC_CAPTURE_ADFM ADCON1bits.ADFM
+#else
+#define ADC_CAPTURE_ADFM ADCON2bits.ADFM
+#endif
+
+#define ADC_INTERRUPT_FLAG   PIR1bits.ADIF
+#define ADC_INTERRUPT_ENABLE PIE1bits.ADIE
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************* ADC CAPTURE GLOBAL FUNCTIONS *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void adc_capture_init(void)
+ * 
+ * @brief Sets up the analog pin, the ADC, Timer1 and the CCP module, with the 
+ * trigger stopped.
+ */
+void adc_capture_init(void);
+
+/**
+ * @fn void adc_capture_start(void)
+ * 
+ * @brief Starts sampling, call it once the device is configured.
+ */
+void adc_capture_start(void);
+
+/**
+ * @fn void adc_capture_stop(void)
+ * 
+ * @brief Stops sampling, a part filled packet is dropped.
+ */
+void adc_capture_stop(void);
+
+/**
+ * @fn void adc_capture_tasks(void)
+ * 
+ * @brief Stores a finished conversion in the IN buffer, and commits the 
+ * buffer once it's full.
+ * 
+ * Call it from the interrupt. It returns straight away unless the ADC 
+ * interrupt flag is set.
+ */
+void adc_capture_tasks(void);
+
+/* ************************************************************************** */
+
+#endif /* ADC_CAPTURE_H */
@@ -0,0 +1,152 @@
+/**
+ * @file bin_log.c
+ * @brief Deferred binary log, records packed into full Vendor IN packets.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Vendor Stream Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_vendor_config.h"
+#ifdef VENDOR_LOG
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_vendor.h"
+#include "bin_log.h"
+
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+static uint8_t          m_ring[BIN_LOG_RING_SIZE];
+static volatile uint8_t m_head;       // Free running, only bin_log() moves it.
+static volatile uint8_t m_tail;       // Free running, only bin_log_tasks() moves it.
+static uint8_t          m_sync_count; // Records until the next sync record, 0 sends one first.
+static uint8_t          m_dropped;    // Records dropped, not yet sent in a BIN_LOG_DROPPED record.
+
+static const uint8_t m_sync_args[3] = {'B', 'L', BIN_LOG_NUM_IDS};
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+static bool put(uint8_t id, const uint8_t *p_args, uint8_t len);
+static bool put_sync(void);
+static bool put_dropped(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void bin_log_init(void)
+{
+    m_head = 0;
+    m_tail = 0;
+    m_sync_count = 0;
+    m_dropped = 0;
+}
+
+bool bin_log(uint8_t id, const void *p_args, uint8_t len)
+{
+    bool gie = INTCONbits.GIE;
+    bool ok;
+
+    INTCONbits.GIE = 0;
+    ok = (m_sync_count || put_sync()) && (!m_dropped || put_dropped()) && put(id, p_args, len);
+    if(ok) m_sync_count--;
+    else if(m_dropped != 255) m_dropped++;
+    INTCONbits.GIE = gie;
+    return ok;
+}
+
+void bin_log_tasks(void)
+{
+    uint8_t *p_data;
+    uint8_t cnt;
+    uint8_t tail;
+    uint8_t i;
+
+    if(usb_get_state() != STATE_CONFIGURED) return;
+
+    while(1)
+    {
+        // A short packet only when nothing else is waiting for the host.
+        cnt = m_head - m_tail;
+        if(cnt < VENDOR_EP_SIZE && (!cnt || !vendor_in_idle())) return;
+        if((p_data = vendor_acquire_in()) == NULL) return;
+        if(cnt > VENDOR_EP_SIZE) cnt = VENDOR_EP_SIZE;
+        tail = m_tail;
+        for(i = 0; i < cnt; i++) p_data[i] = m_ring[(uint8_t)(tail + i) & (BIN_LOG_RING_SIZE - 1)];
+        m_tail = tail + cnt;
+        vendor_commit_in(cnt);
+    }
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** LOCAL FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+/*
+ * Copies a whole record in at the head, or nothing if it doesn't fit. GIE is
+ * clear.
+ */
+static bool put(uint8_t id, const uint8_t *p_args, uint8_t len)
+{
+    uint8_t head = m_head;
+
+    if((uint8_t)(BIN_LOG_RING_SIZE - (uint8_t)(head - m_tail)) <= len) return false;
+    m_ring[head++ & (BIN_LOG_RING_SIZE - 1)] = id;
+    while(len--) m_ring[head++ & (BIN_LOG_RING_SIZE - 1)] = *p_args++;
+    m_head = head;
+    return true;
+}
+
+static bool put_sync(void)
+{
+    if(!put(BIN_LOG_SYNC, m_sync_args, sizeof(m_sync_args))) return false;
+    m_sync_count = BIN_LOG_SYNC_EVERY;
+    return true;
+}
+
+static bool put_dropped(void)
+{
+    if(!put(BIN_LOG_DROPPED, &m_dropped, 1)) return false;
+    m_dropped = 0;
+    return true;
+}
+
+/* ************************************************************************** */
+
+#endif /* VENDOR_LOG */
@@ -0,0 +1,152 @@
+/**
+ * @file bin_log.h
+ * @brief Deferred binary log, records packed into full Vendor IN packets.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Vendor Stream Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BIN_LOG_H
+#define BIN_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb_vendor_config.h"
+#include "bin_log_ids.h"
+
+/* ************************************************************************** */
+/* *************************** BIN LOG SETTINGS ***************************** */
+/* ************************************************************************** */
+
+/*
+ * A log call only copies its ID and raw arguments into a RAM ring, there's no
+ * formatting on the device. bin_log_tasks() in the main loop moves the ring
+ * into VENDOR_EP_SIZE IN packets, and only sends a short one once the host
+ * has read everything else, so under load every packet is full. Records run
+ * on across packets, and the host formats them with the strings of
+ * bin_log_ids.h.
+ * 
+ * bin_log() can be called from the main loop and the interrupt. Only it moves
+ * the head and only bin_log_tasks() moves the tail, so the reader never locks.
+ * The two writers are kept apart by clearing GIE for the few bytes of a
+ * record. A record that doesn't fit is dropped and counted; the count is sent
+ * as a BIN_LOG_DROPPED record once there's room again.
+ * 
+ * Every BIN_LOG_SYNC_EVERY records there's a BIN_LOG_SYNC record, 0x00 'B' 'L'
+ * and the amount of IDs, so a host that starts reading mid stream finds the
+ * record boundaries and can tell that its table is out of date.
+ */
+#define BIN_LOG_RING_SIZE  128 // Bytes, a power of 2 from VENDOR_EP_SIZE up to 128.
+#define BIN_LOG_SYNC_EVERY 64  // Records between sync records, 1 to 255.
+
+#if (BIN_LOG_RING_SIZE & (BIN_LOG_RING_SIZE - 1)) || (BIN_LOG_RING_SIZE > 128) || (BIN_LOG_RING_SIZE < VENDOR_EP_SIZE)
+#error "BIN_LOG_RING_SIZE must be a power of 2, from VENDOR_EP_SIZE up to 128."
+#endif
+
+#if (BIN_LOG_SYNC_EVERY < 1) || (BIN_LOG_SYNC_EVERY > 255)
+#error "BIN_LOG_SYNC_EVERY must be 1 to 255."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************* BIN LOG IDS ****************************** */
+/* ************************************************************************** */
+
+#define BIN_LOG_ENUM(name, format) name,
+
+enum
+{
+    BIN_LOG_SYNC,    // 'B' 'L' and BIN_LOG_NUM_IDS.
+    BIN_LOG_DROPPED, // Records dropped since the last one, 1 byte, 255 at most.
+    BIN_LOG_IDS(BIN_LOG_ENUM)
+    BIN_LOG_END
+};
+
+#define BIN_LOG_FIRST_ID (BIN_LOG_DROPPED + 1)            // ID of the first entry of bin_log_ids.h.
+#define BIN_LOG_NUM_IDS  (BIN_LOG_END - BIN_LOG_FIRST_ID) // Entries of bin_log_ids.h.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** BIN LOG MACROS **************************** */
+/* ************************************************************************** */
+
+// A record with no arguments, or one argument of 1, 2 or 4 bytes. For more, 
+// pass bin_log() a struct of them (XC8 doesn't pad structs).
+#define BIN_LOG(id)       bin_log(id, NULL, 0)
+#define BIN_LOG_8(id, a)  do{uint8_t  arg_ = (a); bin_log(id, &arg_, 1);}while(0)
+#define BIN_LOG_16(id, a) do{uint16_t arg_ = (a); bin_log(id, &arg_, 2);}while(0)
+#define BIN_LOG_32(id, a) do{uint32_t arg_ = (a); bin_log(id, &arg_, 4);}while(0)
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ BIN LOG GLOBAL FUNCTIONS ************************ */
+/* ************************************************************************** */
+
+/**
+ * @fn void bin_log_init(void)
+ * 
+ * @brief Empties the ring, the next record is preceded by a sync record.
+ * 
+ * Call it before usb_init() and before any interrupt logs.
+ */
+void bin_log_init(void);
+
+/**
+ * @fn bool bin_log(uint8_t id, const void *p_args, uint8_t len)
+ * 
+ * @brief Adds a record to the ring.
+ * 
+ * <b>Code Example:</b>
+ * <code>
+ * struct {uint8_t Bytes; uint8_t First;} out_pkt = {cnt, p_data[0]};
+ * bin_log(LOG_OUT_PACKET, &out_pkt, sizeof(out_pkt));
+ * </code>
+ * 
+ * @param[in] id Entry of bin_log_ids.h.
+ * @param[in] p_args Arguments, in the order and sizes of the format string.
+ * @param[in] len Size of the arguments in bytes.
+ * 
+ * @return Returns false if the ring was full and the record was dropped.
+ */
+bool bin_log(uint8_t id, const void *p_args, uint8_t len);
+
+/**
+ * @fn void bin_log_tasks(void)
+ * 
+ * @brief Moves the ring into free Vendor IN buffers.
+ * 
+ * Call it from the main loop in place of the Application's own IN data. It
+ * does nothing until the device is configured.
+ */
+void bin_log_tasks(void);
+
+/* ************************************************************************** */
+
+#endif /* BIN_LOG_H */
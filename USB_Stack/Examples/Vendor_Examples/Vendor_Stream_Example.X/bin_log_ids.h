@@ -0,0 +1,49 @@
+/**
+ * @file bin_log_ids.h
+ * @brief Format strings of the binary log, read by the firmware and by Tools/Bin_Log.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * Vendor Stream Example.
+ * Copyright (C) 2017-2024 John Izzard
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BIN_LOG_IDS_H
+#define BIN_LOG_IDS_H
+
+/*
+ * One X(NAME, "format") line per log message, in ID order. The firmware only
+ * gets the names as IDs (bin_log.h), the strings never reach the flash. The
+ * host tool reads this file for the same table, so keep each entry on one
+ * line, and only add new ones at the end or rebuild both sides. There can be up
+to 254 entries, their IDs start at 2.
+ * 
+ * The conversions give the size of each argument, little endian and in order:
+ * %hhd %hhu %hhx %c are 1 byte, %d %u %x (an XC8 int) are 2, and %ld %lu %lx
+ * are 4. %% prints a %.
+ */
+#define BIN_LOG_IDS(X) \
+    X(LOG_BOOT,       "Boot") \
+    X(LOG_CONFIGURED, "Configured") \
+    X(LOG_OUT_PACKET, "OUT packet, %hhu bytes, first 0x%02hhx") \
+    X(LOG_SECOND,     "%lu s since boot")
+
+#endif /* BIN_LOG_IDS_H */
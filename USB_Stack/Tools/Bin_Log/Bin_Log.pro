@@ -0,0 +1,37 @@
+#-------------------------------------------------
+# Bin Log, decodes the deferred binary log
+# of the Vendor Stream Example (VENDOR_LOG).
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = bin_log
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += bin_log.cpp
+
+#-------------------------------------------------
+# libusb-1.0
+#-------------------------------------------------
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += libusb-1.0
+win32: LIBS += -lusb-1.0
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
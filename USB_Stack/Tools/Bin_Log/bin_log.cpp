@@ -0,0 +1,364 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <libusb.h>
+
+// bin_log.h in the Vendor Stream Example.
+#define BIN_LOG_SYNC     0x00
+#define BIN_LOG_DROPPED  0x01
+#define BIN_LOG_FIRST_ID 0x02
+#define TIMEOUT_MS       100
+
+struct Arg
+{
+    std::string spec; // The conversion as written, e.g. "%02hhx".
+    char        conv;
+    unsigned    size;
+};
+
+struct Entry
+{
+    std::string      name;
+    std::string      format;
+    std::vector<Arg> args;
+    unsigned         size; // Bytes of the arguments.
+};
+
+struct Options
+{
+    uint16_t    vid = 0x04D8;
+    uint16_t    pid = 0x0056;
+    uint8_t     ep = 0x81;     // EP_IN_ADDR(VENDOR_EP).
+    uint8_t     interface = 0; // VENDOR_INT.
+    std::string in;            // Decode a capture instead of a device.
+    std::string raw;           // Also save what was read.
+    bool        table = false;
+};
+
+static void die(const char *msg, const std::string &what = "")
+{
+    fprintf(stderr, "bin_log: %s%s%s\n", msg, what.empty() ? "" : ": ", what.c_str());
+    exit(1);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  bin_log <bin_log_ids.h> [--pid 0056] [--vid 04d8] [--ep 0x81] [--raw file]\n"
+            "  bin_log <bin_log_ids.h> --in file\n"
+            "  bin_log <bin_log_ids.h> --table\n"
+            "Reads the deferred binary log of a device built with VENDOR_LOG from its\n"
+            "Vendor IN Endpoint (or a capture saved with --raw) and prints one line\n"
+            "per record, formatted with the strings of bin_log_ids.h. --table prints\n"
+            "the IDs and argument sizes the header gives.\n");
+}
+
+static uint32_t number(const char *s)
+{
+    char *end;
+    uint32_t val = (uint32_t)strtoul(s, &end, 0);
+
+    if(*s == 0 || *end != 0) die("not a number", s);
+    return val;
+}
+
+// Works out the arguments of a format, XC8 sizes: int is 2 bytes, long 4.
+static bool parse_format(Entry &e, std::string &err)
+{
+    const std::string &f = e.format;
+
+    e.size = 0;
+    for(size_t i = 0; i < f.size(); i++)
+    {
+        Arg arg;
+        size_t start = i;
+        unsigned size = 2;
+
+        if(f[i] != '%') continue;
+        if(++i < f.size() && f[i] == '%') continue;
+        while(i < f.size() && strchr("-+ #0123456789.", f[i])) i++;
+        if(f.compare(i, 2, "hh") == 0) { size = 1; i += 2; }
+        else if(i < f.size() && f[i] == 'h') i++;
+        else if(i < f.size() && f[i] == 'l') { size = 4; i++; }
+        if(i >= f.size() || !strchr("diuxXoc", f[i]))
+        {
+            err = "unsupported conversion in \"" + f + "\"";
+            return false;
+        }
+        arg.conv = f[i];
+        arg.size = arg.conv == 'c' ? 1 : size;
+        arg.spec = f.substr(start, i + 1 - start);
+        e.args.push_back(arg);
+        e.size += arg.size;
+    }
+    return true;
+}
+
+// Every X(NAME, "format") after "BIN_LOG_IDS(X)", in order.
+static std::vector<Entry> read_table(const std::string &path)
+{
+    std::vector<Entry> table;
+    std::string text, err;
+    FILE *f = fopen(path.c_str(), "rb");
+    size_t start;
+    int c;
+
+    if(!f) die("can't open", path);
+    while((c = fgetc(f)) != EOF) text += (char)c;
+    fclose(f);
+    if((start = text.find("BIN_LOG_IDS(X)")) == std::string::npos) die("no BIN_LOG_IDS(X) in", path);
+
+    for(size_t i = text.find("X(", start + strlen("BIN_LOG_IDS(X)")); i != std::string::npos; i = text.find("X(", i))
+    {
+        Entry e;
+        size_t q;
+
+        i += 2;
+        if(i > 2 && (isalnum((unsigned char)text[i - 3]) || text[i - 3] == '_')) continue; // Part of a name.
+        while(i < text.size() && (isalnum((unsigned char)text[i]) || text[i] == '_')) e.name += text[i++];
+        while(i < text.size() && (text[i] == ' ' || text[i] == ',')) i++;
+        if(e.name.empty() || i >= text.size() || text[i] != '"') continue;
+        for(q = i + 1; q < text.size() && text[q] != '"'; q++)
+        {
+            if(text[q] != '\\' || q + 1 >= text.size()) e.format += text[q];
+            else if(text[++q] == 'n') e.format += '\n';
+            else if(text[q] == 't') e.format += '\t';
+            else e.format += text[q];
+        }
+        i = q;
+        if(!parse_format(e, err)) die(err.c_str(), e.name);
+        table.push_back(e);
+    }
+    if(table.empty()) die("no X(NAME, \"format\") entries in", path);
+    if(table.size() > 256 - BIN_LOG_FIRST_ID) die("too many entries in", path);
+    return table;
+}
+
+static void print_record(const Entry &e, const uint8_t *p_args)
+{
+    const std::string &f = e.format;
+    std::string out;
+    size_t a = 0;
+    char buf[64];
+
+    for(size_t i = 0; i < f.size(); i++)
+    {
+        if(f[i] != '%')
+        {
+            out += f[i];
+            continue;
+        }
+        if(f[i + 1] == '%')
+        {
+            out += '%';
+            i++;
+            continue;
+        }
+
+        const Arg &arg = e.args[a++];
+        uint32_t val = 0;
+        std::string spec = arg.spec;
+
+        for(unsigned b = 0; b < arg.size; b++) val |= (uint32_t)p_args[b] << (8 * b);
+        p_args += arg.size;
+        i += spec.size() - 1;
+
+        // Same flags and width, printed from a long long of the right sign.
+        spec.erase(spec.find_first_of("hlc" "diuxXo"));
+        if(arg.conv == 'c') snprintf(buf, sizeof(buf), (spec + "c").c_str(), (int)val);
+        else if(arg.conv == 'd' || arg.conv == 'i')
+        {
+            long long s = arg.size == 1 ? (int8_t)val : arg.size == 2 ? (int16_t)val : (long long)(int32_t)val;
+            snprintf(buf, sizeof(buf), (spec + "lld").c_str(), s);
+        }
+        else snprintf(buf, sizeof(buf), (spec + "ll" + arg.conv).c_str(), (unsigned long long)val);
+        out += buf;
+    }
+    printf("%s\n", out.c_str());
+}
+
+// The stream of records, fed as the bytes come in.
+class Decoder
+{
+public:
+    explicit Decoder(const std::vector<Entry> &table) : m_table(table) {}
+
+    void feed(const uint8_t *p_data, size_t len)
+    {
+        m_buf.insert(m_buf.end(), p_data, p_data + len);
+        while(step()) {}
+        m_buf.erase(m_buf.begin(), m_buf.begin() + m_pos);
+        m_pos = 0;
+    }
+
+    void finish() const
+    {
+        if(m_buf.size() - m_pos) fprintf(stderr, "bin_log: %u bytes of a record left at the end\n", (unsigned)(m_buf.size() - m_pos));
+    }
+
+private:
+    const std::vector<Entry> &m_table;
+    std::vector<uint8_t>     m_buf;
+    size_t                   m_pos = 0;
+    bool                     m_synced = false;
+    bool                     m_warned = false;
+
+    size_t left() const { return m_buf.size() - m_pos; }
+
+    // Looks for 0x00 'B' 'L', the only place a record boundary is known for sure.
+    bool find_sync()
+    {
+        for(; left() >= 4; m_pos++)
+        {
+            if(m_buf[m_pos] == BIN_LOG_SYNC && m_buf[m_pos + 1] == 'B' && m_buf[m_pos + 2] == 'L') return true;
+        }
+        return false;
+    }
+
+    // Decodes one record, false if more bytes are needed.
+    bool step()
+    {
+        uint8_t id;
+
+        if(!m_synced)
+        {
+            if(!find_sync()) return false;
+            m_synced = true;
+        }
+        if(!left()) return false;
+        id = m_buf[m_pos];
+        if(id == BIN_LOG_SYNC)
+        {
+            if(left() < 4) return false;
+            if(m_buf[m_pos + 1] != 'B' || m_buf[m_pos + 2] != 'L') return lost();
+            if(m_buf[m_pos + 3] != m_table.size() && !m_warned)
+            {
+                fprintf(stderr, "bin_log: the firmware has %u IDs, the table %u, it's out of date\n",
+                        m_buf[m_pos + 3], (unsigned)m_table.size());
+                m_warned = true;
+            }
+            m_pos += 4;
+            return true;
+        }
+        if(id == BIN_LOG_DROPPED)
+        {
+            if(left() < 2) return false;
+            printf("-- %u records dropped --\n", m_buf[m_pos + 1]);
+            m_pos += 2;
+            return true;
+        }
+        if((size_t)(id - BIN_LOG_FIRST_ID) >= m_table.size()) return lost();
+
+        const Entry &e = m_table[id - BIN_LOG_FIRST_ID];
+
+        if(left() < 1 + e.size) return false;
+        print_record(e, &m_buf[m_pos + 1]);
+        m_pos += 1 + e.size;
+        return true;
+    }
+
+    bool lost()
+    {
+        printf("-- lost sync --\n");
+        m_synced = false;
+        m_pos++;
+        return true;
+    }
+};
+
+static void decode_file(const Options &opt, Decoder &dec)
+{
+    FILE *f = fopen(opt.in.c_str(), "rb");
+    uint8_t buf[4096];
+    size_t n;
+
+    if(!f) die("can't open", opt.in);
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0) dec.feed(buf, n);
+    fclose(f);
+    dec.finish();
+}
+
+// Reads until the device goes away, a timeout just means the log is quiet.
+static void decode_device(const Options &opt, Decoder &dec)
+{
+    libusb_context *ctx;
+    libusb_device_handle *dev;
+    FILE *raw = NULL;
+    uint8_t buf[4096];
+    int r, got;
+
+    if(libusb_init(&ctx) != 0) die("libusb_init failed");
+    dev = libusb_open_device_with_vid_pid(ctx, opt.vid, opt.pid);
+    if(!dev) die("device not found (or no permission)");
+    libusb_set_auto_detach_kernel_driver(dev, 1);
+    if((r = libusb_claim_interface(dev, opt.interface)) != 0) die("can't claim the interface", libusb_error_name(r));
+    if(!opt.raw.empty() && !(raw = fopen(opt.raw.c_str(), "wb"))) die("can't write", opt.raw);
+
+    while(1)
+    {
+        r = libusb_bulk_transfer(dev, opt.ep, buf, sizeof(buf), &got, TIMEOUT_MS);
+        if(r != 0 && r != LIBUSB_ERROR_TIMEOUT) break;
+        if(got <= 0) continue;
+        if(raw) fwrite(buf, 1, got, raw);
+        dec.feed(buf, got);
+        fflush(stdout);
+    }
+    fprintf(stderr, "bin_log: %s\n", libusb_error_name(r));
+    if(raw) fclose(raw);
+    libusb_release_interface(dev, opt.interface);
+    libusb_close(dev);
+    libusb_exit(ctx);
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    std::vector<Entry> table;
+
+    if(argc < 2 || argv[1][0] == '-')
+    {
+        usage();
+        return 1;
+    }
+    for(int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--vid" && has_value) opt.vid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--pid" && has_value) opt.pid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--ep" && has_value) opt.ep = (uint8_t)number(argv[++i]);
+        else if(arg == "--interface" && has_value) opt.interface = (uint8_t)number(argv[++i]);
+        else if(arg == "--in" && has_value) opt.in = argv[++i];
+        else if(arg == "--raw" && has_value) opt.raw = argv[++i];
+        else if(arg == "--table") opt.table = true;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    table = read_table(argv[1]);
+    if(opt.table)
+    {
+        for(size_t i = 0; i < table.size(); i++)
+        {
+            printf("0x%02X %-24s %u bytes  \"%s\"\n", (unsigned)(i + BIN_LOG_FIRST_ID), table[i].name.c_str(),
+                   table[i].size, table[i].format.c_str());
+        }
+        return 0;
+    }
+
+    Decoder dec(table);
+    if(!opt.in.empty()) decode_file(opt, dec);
+    else decode_device(opt, dec);
+    return 0;
+}
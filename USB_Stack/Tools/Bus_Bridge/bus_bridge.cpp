@@ -0,0 +1,208 @@
+#include "bus_bridge.h"
+
+#include <algorithm>
+
+#include <libusb.h>
+
+#define VENDOR_INT 0
+#define SPI_CHUNK  255 // Most bytes one op takes.
+
+void BridgeList::op(uint8_t code, std::initializer_list<uint8_t> args)
+{
+    ops.push_back(code);
+    ops.insert(ops.end(), args.begin(), args.end());
+    op_count++;
+}
+
+void BridgeList::spi(uint8_t code, const uint8_t *data, size_t n)
+{
+    while(n)
+    {
+        uint8_t len = (uint8_t)std::min<size_t>(n, SPI_CHUNK);
+
+        op(code, {len});
+        if(data)
+        {
+            ops.insert(ops.end(), data, data + len);
+            data += len;
+        }
+        if(code != BRIDGE_SPI_WRITE) result_bytes += len;
+        n -= len;
+    }
+}
+
+BridgeList &BridgeList::spi_config(uint8_t mode, uint8_t clock)
+{
+    if(mode > 3 || clock > 2) bad = true;
+    op(BRIDGE_SPI_CONFIG, {mode, clock});
+    return *this;
+}
+
+BridgeList &BridgeList::cs(bool level)
+{
+    op(BRIDGE_SPI_CS, {(uint8_t)level});
+    return *this;
+}
+
+BridgeList &BridgeList::spi_write(const std::vector<uint8_t> &data)
+{
+    spi(BRIDGE_SPI_WRITE, data.data(), data.size());
+    return *this;
+}
+
+BridgeList &BridgeList::spi_read(size_t n)
+{
+    spi(BRIDGE_SPI_READ, NULL, n);
+    return *this;
+}
+
+BridgeList &BridgeList::spi_xfer(const std::vector<uint8_t> &data)
+{
+    spi(BRIDGE_SPI_XFER, data.data(), data.size());
+    return *this;
+}
+
+BridgeList &BridgeList::i2c_config(bool fast)
+{
+    op(BRIDGE_I2C_CONFIG, {(uint8_t)fast});
+    return *this;
+}
+
+// An I2C transfer can't be split without a new start, so it's 255 bytes at most.
+BridgeList &BridgeList::i2c_write(uint8_t addr, const std::vector<uint8_t> &data, bool stop)
+{
+    if(addr > 0x7F || data.size() > SPI_CHUNK) bad = true;
+    op(BRIDGE_I2C_WRITE | (stop ? 0 : BRIDGE_I2C_NO_STOP), {addr, (uint8_t)data.size()});
+    ops.insert(ops.end(), data.begin(), data.end());
+    return *this;
+}
+
+BridgeList &BridgeList::i2c_read(uint8_t addr, size_t n, bool stop)
+{
+    if(addr > 0x7F || n > SPI_CHUNK) bad = true;
+    op(BRIDGE_I2C_READ | (stop ? 0 : BRIDGE_I2C_NO_STOP), {addr, (uint8_t)n});
+    result_bytes += n;
+    return *this;
+}
+
+BridgeList &BridgeList::delay_us(uint16_t us)
+{
+    op(BRIDGE_DELAY_US, {(uint8_t)us, (uint8_t)(us >> 8)});
+    return *this;
+}
+
+BusBridge::BusBridge()
+{
+    ctx = NULL;
+    dev = NULL;
+    ep_out = 0x01;
+    ep_in = 0x81;
+    ep_size = 64;
+}
+
+BusBridge::~BusBridge()
+{
+    close();
+}
+
+bool BusBridge::open(uint16_t vid, uint16_t pid)
+{
+    int r;
+
+    close();
+    if(libusb_init(&ctx) != 0)
+    {
+        ctx = NULL;
+        return fail("libusb_init failed");
+    }
+    dev = libusb_open_device_with_vid_pid(ctx, vid, pid);
+    if(!dev) return fail("device not found (or no permission)");
+    libusb_set_auto_detach_kernel_driver(dev, 1);
+    if((r = libusb_claim_interface(dev, VENDOR_INT)) != 0) return fail(std::string("can't claim the interface: ") + libusb_error_name(r));
+    if((r = libusb_get_max_packet_size(libusb_get_device(dev), ep_in)) > 0) ep_size = r;
+    return true;
+}
+
+void BusBridge::close()
+{
+    if(dev)
+    {
+        libusb_release_interface(dev, VENDOR_INT);
+        libusb_close(dev);
+        dev = NULL;
+    }
+    if(ctx)
+    {
+        libusb_exit(ctx);
+        ctx = NULL;
+    }
+}
+
+static void LIBUSB_CALL in_done(libusb_transfer *transfer)
+{
+    *(int *)transfer->user_data = 1;
+}
+
+bool BusBridge::run(const BridgeList &list, BridgeResult &result, int timeout_ms)
+{
+    const std::vector<uint8_t> &ops = list.bytes();
+    std::vector<uint8_t> in;
+    size_t want = list.results() + 3; // The reads, then [status][ops done LSB][ops done MSB].
+    libusb_transfer *transfer;
+    int r, got, completed = 0;
+
+    if(!dev) return fail("not open");
+    if(!list.ok()) return fail("an argument of the list is out of range");
+    if(ops.empty()) return fail("empty list");
+
+    // The IN transfer goes first: a long list's results fill the device's IN
+    // buffers before the rest of the list has gone out. Asking for more than
+    // want means it ends on the short packet after the results.
+    in.resize((want / ep_size + 1) * ep_size);
+    if(!(transfer = libusb_alloc_transfer(0))) return fail("libusb_alloc_transfer failed");
+    libusb_fill_bulk_transfer(transfer, dev, ep_in, in.data(), (int)in.size(), in_done, &completed, timeout_ms);
+    if((r = libusb_submit_transfer(transfer)) != 0)
+    {
+        libusb_free_transfer(transfer);
+        return fail(std::string("IN transfer failed: ") + libusb_error_name(r));
+    }
+
+    // The list ends with a short packet, a zero length one if it fills its last packet.
+    r = libusb_bulk_transfer(dev, ep_out, const_cast<uint8_t *>(ops.data()), (int)ops.size(), &got, timeout_ms);
+    if(r == 0 && got == (int)ops.size() && ops.size() % ep_size == 0) r = libusb_bulk_transfer(dev, ep_out, NULL, 0, &got, timeout_ms);
+    if(r != 0) libusb_cancel_transfer(transfer);
+    while(!completed) libusb_handle_events_completed(ctx, &completed);
+    got = transfer->actual_length;
+    if(r == 0 && transfer->status != LIBUSB_TRANSFER_COMPLETED) r = LIBUSB_ERROR_IO;
+    libusb_free_transfer(transfer);
+    if(r != 0) return fail(std::string("transfer failed: ") + libusb_error_name(r));
+    if(got < 3) return fail("results too short");
+    in.resize(got);
+
+    result.status = in[got - 3];
+    result.ops_done = (uint16_t)(in[got - 2] | (in[got - 1] << 8));
+    result.data.assign(in.begin(), in.end() - 3);
+    if(result.status == BRIDGE_OK && result.data.size() != list.results()) return fail("results don't match the list");
+    return true;
+}
+
+const char *BusBridge::status_name(uint8_t status)
+{
+    switch(status)
+    {
+        case BRIDGE_OK:         return "ok";
+        case BRIDGE_ERR_OPCODE: return "unknown op";
+        case BRIDGE_ERR_ARG:    return "argument out of range";
+        case BRIDGE_ERR_MODE:   return "op for the other bus";
+        case BRIDGE_ERR_SHORT:  return "list ended part way into an op";
+        case BRIDGE_ERR_NACK:   return "I2C NACK";
+        case BRIDGE_ERR_BUS:    return "I2C bus held low";
+    }
+    return "unknown status";
+}
+
+bool BusBridge::fail(const std::string &msg)
+{
+    error = msg;
+    return false;
+}
@@ -0,0 +1,102 @@
+#ifndef BUS_BRIDGE_H
+#define BUS_BRIDGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+struct libusb_context;
+struct libusb_device_handle;
+
+// Ops and status codes shared with the Vendor Bridge Example (bridge.h).
+#define BRIDGE_SPI_CONFIG  0x01
+#define BRIDGE_SPI_CS      0x02
+#define BRIDGE_SPI_WRITE   0x03
+#define BRIDGE_SPI_READ    0x04
+#define BRIDGE_SPI_XFER    0x05
+#define BRIDGE_I2C_CONFIG  0x08
+#define BRIDGE_I2C_WRITE   0x09
+#define BRIDGE_I2C_READ    0x0A
+#define BRIDGE_DELAY_US    0x10
+#define BRIDGE_I2C_NO_STOP 0x80
+
+#define BRIDGE_OK          0x00
+#define BRIDGE_ERR_OPCODE  0x01
+#define BRIDGE_ERR_ARG     0x02
+#define BRIDGE_ERR_MODE    0x03
+#define BRIDGE_ERR_SHORT   0x04
+#define BRIDGE_ERR_NACK    0x05
+#define BRIDGE_ERR_BUS     0x06
+
+// A command list, built up with the calls below and sent with BusBridge::run().
+// Each call adds one op (SPI ones of more than 255 bytes add one per 255), and
+// results() is how many bytes its reads will give back.
+class BridgeList
+{
+public:
+    BridgeList() : bad(false), result_bytes(0), op_count(0) {}
+
+    BridgeList &spi_config(uint8_t mode, uint8_t clock = 0); // Mode 0 to 3, clock 0 to 2: Fosc/4, /16, /64.
+    BridgeList &cs(bool level);
+    BridgeList &spi_write(const std::vector<uint8_t> &data);
+    BridgeList &spi_read(size_t n);
+    BridgeList &spi_xfer(const std::vector<uint8_t> &data);
+    BridgeList &i2c_config(bool fast);                        // 100 kHz, or 400 kHz.
+    BridgeList &i2c_write(uint8_t addr, const std::vector<uint8_t> &data, bool stop = true);
+    BridgeList &i2c_read(uint8_t addr, size_t n, bool stop = true);
+    BridgeList &delay_us(uint16_t us);
+
+    const std::vector<uint8_t> &bytes() const { return ops; }
+    size_t results() const { return result_bytes; }
+    size_t count() const { return op_count; }
+    bool   ok() const { return !bad; } // False if an argument was out of range.
+
+private:
+    void op(uint8_t code, std::initializer_list<uint8_t> args);
+    void spi(uint8_t code, const uint8_t *data, size_t n);
+
+    std::vector<uint8_t> ops;
+    bool                 bad;
+    size_t               result_bytes;
+    size_t               op_count;
+};
+
+struct BridgeResult
+{
+    uint8_t              status;   // BRIDGE_OK, or why the op after the last done one failed.
+    uint16_t             ops_done;
+    std::vector<uint8_t> data;     // What the reads gave back, in list order.
+};
+
+// Runs command lists on a Vendor Bridge device: the list goes out as one bulk
+// OUT transfer and its results come back as one IN transfer, so a whole list
+// costs one round trip however many bus transactions it holds.
+class BusBridge
+{
+public:
+    BusBridge();
+    ~BusBridge();
+
+    bool open(uint16_t vid = 0x04D8, uint16_t pid = 0x005B);
+    void close();
+
+    // Sends list and waits up to timeout_ms for all of its results.
+    bool run(const BridgeList &list, BridgeResult &result, int timeout_ms = 1000);
+
+    static const char *status_name(uint8_t status);
+
+    std::string error;
+
+private:
+    bool fail(const std::string &msg);
+
+    libusb_context       *ctx;
+    libusb_device_handle *dev;
+    uint8_t               ep_out;
+    uint8_t               ep_in;
+    int                   ep_size;
+};
+
+#endif // BUS_BRIDGE_H
@@ -0,0 +1,310 @@
+#include "cdc_rpc.h"
+
+#include <string.h>
+#include <chrono>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#endif
+
+#define READ_CHUNK 4096
+
+CdcRpc::CdcRpc()
+{
+    #ifdef _WIN32
+    handle = INVALID_HANDLE_VALUE;
+    #else
+    fd = -1;
+    #endif
+    next_seq = 0;
+    bad_frames = 0;
+}
+
+CdcRpc::~CdcRpc()
+{
+    close();
+}
+
+bool CdcRpc::open(const std::string &port)
+{
+    close();
+    #ifdef _WIN32
+    std::string name = "\\\\.\\" + port;
+    DCB dcb;
+    COMMTIMEOUTS timeouts;
+
+    handle = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if(handle == INVALID_HANDLE_VALUE) return fail("can't open " + port);
+    memset(&dcb, 0, sizeof(dcb));
+    dcb.DCBlength = sizeof(dcb);
+    if(!GetCommState(handle, &dcb)) return fail("GetCommState failed");
+    dcb.BaudRate = 115200;
+    dcb.ByteSize = 8;
+    dcb.Parity = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.fBinary = TRUE;
+    dcb.fOutX = FALSE;
+    dcb.fInX = FALSE;
+    dcb.fDtrControl = DTR_CONTROL_ENABLE;
+    dcb.fRtsControl = RTS_CONTROL_ENABLE;
+    if(!SetCommState(handle, &dcb)) return fail("SetCommState failed");
+    // Reads return whatever has arrived, read_some() sets the wait for the first byte.
+    memset(&timeouts, 0, sizeof(timeouts));
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    if(!SetCommTimeouts(handle, &timeouts)) return fail("SetCommTimeouts failed");
+    PurgeComm(handle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+    #else
+    struct termios tio;
+
+    fd = ::open(port.c_str(), O_RDWR | O_NOCTTY);
+    if(fd < 0) return fail("can't open " + port);
+    if(tcgetattr(fd, &tio) < 0) return fail("tcgetattr failed");
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if(tcsetattr(fd, TCSANOW, &tio) < 0) return fail("tcsetattr failed");
+    tcflush(fd, TCIOFLUSH);
+    #endif
+    in.clear();
+    pending.clear();
+    out.clear();
+    return true;
+}
+
+void CdcRpc::close()
+{
+    #ifdef _WIN32
+    if(handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+    handle = INVALID_HANDLE_VALUE;
+    #else
+    if(fd >= 0) ::close(fd);
+    fd = -1;
+    #endif
+}
+
+bool CdcRpc::call(uint8_t command, const std::vector<uint8_t> &data, CdcRpcResponse &response, int timeout_ms)
+{
+    std::vector<CdcRpcRequest> requests(1);
+    std::vector<CdcRpcResponse> responses;
+
+    requests[0].command = command;
+    requests[0].data = data;
+    if(!call_many(requests, responses, 1, timeout_ms)) return false;
+    response = responses[0];
+    return true;
+}
+
+bool CdcRpc::call_many(const std::vector<CdcRpcRequest> &requests, std::vector<CdcRpcResponse> &responses,
+                       unsigned window, int timeout_ms)
+{
+    size_t sent = 0;
+    uint8_t first_seq = next_seq;
+
+    if(window == 0) window = 1;
+    if(window > 128) window = 128; // Half the seq space, so a late response can't be taken for a new one.
+    responses.clear();
+    responses.reserve(requests.size());
+    while(responses.size() < requests.size())
+    {
+        // Top the window up, all of it in one write.
+        while(sent < requests.size() && sent - responses.size() < window)
+        {
+            if(requests[sent].data.size() > CDC_RPC_MAX_DATA) return fail("request data over 249 bytes");
+            queue((uint8_t)(first_seq + sent), requests[sent]);
+            sent++;
+        }
+        if(!write_out()) return false;
+
+        CdcRpcResponse response;
+        uint8_t seq;
+        if(!receive(&seq, response, timeout_ms)) return false;
+        if(seq != (uint8_t)(first_seq + responses.size())) return fail("response out of order (lost request?)");
+        responses.push_back(response);
+    }
+    next_seq = (uint8_t)(first_seq + requests.size());
+    return true;
+}
+
+uint16_t CdcRpc::crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    while(len--)
+    {
+        uint8_t x = (uint8_t)(crc >> 8) ^ *data++;
+        x ^= x >> 4;
+        crc = (uint16_t)((crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x);
+    }
+    return crc;
+}
+
+void CdcRpc::cobs_encode(const std::vector<uint8_t> &frame, std::vector<uint8_t> &out)
+{
+    size_t code_pos = out.size();
+    uint8_t code = 1;
+
+    out.push_back(0);
+    for(size_t i = 0; i < frame.size(); i++)
+    {
+        if(frame[i] == 0)
+        {
+            out[code_pos] = code;
+            code_pos = out.size();
+            out.push_back(0);
+            code = 1;
+            continue;
+        }
+        out.push_back(frame[i]);
+        if(++code == 0xFF && i + 1 < frame.size())
+        {
+            out[code_pos] = code;
+            code_pos = out.size();
+            out.push_back(0);
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+    out.push_back(0);
+}
+
+bool CdcRpc::cobs_decode(const uint8_t *data, size_t len, std::vector<uint8_t> &frame)
+{
+    size_t i = 0;
+
+    frame.clear();
+    while(i < len)
+    {
+        uint8_t code = data[i++];
+        if(code == 0 || len - i < (size_t)(code - 1)) return false;
+        frame.insert(frame.end(), data + i, data + i + code - 1);
+        i += code - 1;
+        if(code != 0xFF && i < len) frame.push_back(0);
+    }
+    return true;
+}
+
+void CdcRpc::queue(uint8_t seq, const CdcRpcRequest &request)
+{
+    std::vector<uint8_t> frame;
+    uint16_t crc;
+
+    frame.push_back(seq);
+    frame.push_back(request.command);
+    frame.insert(frame.end(), request.data.begin(), request.data.end());
+    crc = crc16(frame.data(), frame.size());
+    frame.push_back((uint8_t)crc);
+    frame.push_back((uint8_t)(crc >> 8));
+    cobs_encode(frame, out);
+}
+
+bool CdcRpc::write_out()
+{
+    size_t done = 0;
+
+    while(done < out.size())
+    {
+        #ifdef _WIN32
+        DWORD n = 0;
+        if(!WriteFile(handle, &out[done], (DWORD)(out.size() - done), &n, NULL) || n == 0) return fail("write failed");
+        #else
+        ssize_t n = write(fd, &out[done], out.size() - done);
+        if(n <= 0) return fail("write failed");
+        #endif
+        done += (size_t)n;
+    }
+    out.clear();
+    return true;
+}
+
+// The next response with a good CRC, frames that fail are counted and skipped.
+bool CdcRpc::receive(uint8_t *seq, CdcRpcResponse &response, int timeout_ms)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::vector<uint8_t> frame;
+
+    while(1)
+    {
+        size_t i;
+        for(i = 0; i < pending.size() && pending[i] != 0; i++) {}
+        in.insert(in.end(), pending.begin(), pending.begin() + i);
+        if(i == pending.size())
+        {
+            uint8_t buf[READ_CHUNK];
+            int left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            int n;
+
+            pending.clear();
+            if(left <= 0) return fail("response timed out");
+            n = read_some(buf, sizeof(buf), left);
+            if(n < 0) return false;
+            pending.assign(buf, buf + n);
+            continue;
+        }
+        pending.erase(pending.begin(), pending.begin() + i + 1);
+
+        bool ok = cobs_decode(in.data(), in.size(), frame) && frame.size() >= CDC_RPC_OVERHEAD;
+        in.clear();
+        if(ok)
+        {
+            uint16_t crc = crc16(frame.data(), frame.size() - 2);
+            ok = frame[frame.size() - 2] == (uint8_t)crc && frame[frame.size() - 1] == (uint8_t)(crc >> 8);
+        }
+        if(!ok)
+        {
+            bad_frames++;
+            continue;
+        }
+        *seq = frame[0];
+        response.status = frame[1];
+        response.data.assign(frame.begin() + 2, frame.end() - 2);
+        return true;
+    }
+}
+
+// Returns the bytes read, 0 on timeout, -1 on an error.
+int CdcRpc::read_some(uint8_t *buf, size_t len, int timeout_ms)
+{
+    #ifdef _WIN32
+    COMMTIMEOUTS timeouts;
+    DWORD done = 0;
+
+    memset(&timeouts, 0, sizeof(timeouts));
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = (DWORD)timeout_ms;
+    SetCommTimeouts(handle, &timeouts);
+    if(!ReadFile(handle, buf, (DWORD)len, &done, NULL))
+    {
+        fail("read failed");
+        return -1;
+    }
+    return (int)done;
+    #else
+    struct pollfd pfd;
+    ssize_t done;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, timeout_ms) <= 0) return 0;
+    done = read(fd, buf, len);
+    if(done < 0)
+    {
+        fail("read failed");
+        return -1;
+    }
+    return (int)done;
+    #endif
+}
+
+bool CdcRpc::fail(const std::string &msg)
+{
+    error = msg;
+    return false;
+}
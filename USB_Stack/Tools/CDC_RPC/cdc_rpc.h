@@ -0,0 +1,79 @@
+#ifndef CDC_RPC_H
+#define CDC_RPC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Frame layout shared with the CDC RPC firmware (USB/usb_cdc_rpc.h):
+// COBS([seq][command or status][data][CRC LSB][CRC MSB]) 0x00.
+#define CDC_RPC_MAX_DATA     249 // CDC_RPC_MAX_PAYLOAD can't be set higher.
+#define CDC_RPC_OVERHEAD     4
+#define CDC_RPC_ERR_COMMAND  0xF0
+#define CDC_RPC_ERR_LENGTH   0xF1
+
+struct CdcRpcRequest
+{
+    uint8_t              command;
+    std::vector<uint8_t> data;
+};
+
+struct CdcRpcResponse
+{
+    uint8_t              status;
+    std::vector<uint8_t> data;
+};
+
+// Binary requests to a CDC RPC device over its virtual COM port. call_many()
+// keeps up to window requests in flight, written back to back so they go out
+// in full packets, and matches the responses up by seq, so the throughput is
+// bound by the bulk bandwidth instead of one round trip per command.
+class CdcRpc
+{
+public:
+    CdcRpc();
+    ~CdcRpc();
+
+    bool open(const std::string &port);
+    void close();
+
+    // One request, waits up to timeout_ms for its response.
+    bool call(uint8_t command, const std::vector<uint8_t> &data, CdcRpcResponse &response, int timeout_ms = 1000);
+
+    // Every request with up to window in flight, responses come back in the
+    // same order. Returns false if a response doesn't arrive within timeout_ms
+    // of the one before, or doesn't match its request's seq.
+    bool call_many(const std::vector<CdcRpcRequest> &requests, std::vector<CdcRpcResponse> &responses,
+                   unsigned window = 16, int timeout_ms = 1000);
+
+    static uint16_t crc16(const uint8_t *data, size_t len);
+    static void     cobs_encode(const std::vector<uint8_t> &frame, std::vector<uint8_t> &out);
+    static bool     cobs_decode(const uint8_t *data, size_t len, std::vector<uint8_t> &frame);
+
+    uint32_t    bad_frames; // Responses dropped for a bad CRC or COBS code.
+    std::string error;
+
+private:
+    void queue(uint8_t seq, const CdcRpcRequest &request);
+    bool write_out();
+    bool receive(uint8_t *seq, CdcRpcResponse &response, int timeout_ms);
+    int  read_some(uint8_t *buf, size_t len, int timeout_ms);
+    bool fail(const std::string &msg);
+
+    #ifdef _WIN32
+    HANDLE handle;
+    #else
+    int fd;
+    #endif
+    uint8_t              next_seq;
+    std::vector<uint8_t> out;     // Encoded requests not written yet.
+    std::vector<uint8_t> in;      // Encoded bytes of the next response.
+    std::vector<uint8_t> pending; // Read but not looked at yet.
+};
+
+#endif // CDC_RPC_H
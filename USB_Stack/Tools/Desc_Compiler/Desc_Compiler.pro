@@ -0,0 +1,30 @@
+#-------------------------------------------------
+# Descriptor Compiler, turns a descriptor spec into
+# usb_descriptors.c and usb_descriptors.h.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = desc_compiler
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += desc_compiler.cpp
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
@@ -0,0 +1,857 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define MAX_ENDPOINTS     16
+#define MAX_STRING_CHARS  126 // bLength is 8 bits, 2 + (2 * 126) = 254.
+#define MAX_CONFIG_LENGTH 0xFFFF
+
+#define DEVICE_DESC                 0x01
+#define CONFIGURATION_DESC          0x02
+#define STRING_DESC                 0x03
+#define INTERFACE_DESC              0x04
+#define ENDPOINT_DESC               0x05
+#define INTERFACE_ASSOCIATION_DESC  0x0B
+#define HID_DESC                    0x21
+#define HID_REPORT_DESC             0x22
+
+#define EP_ISOCHRONOUS 1
+#define EP_BULK        2
+#define EP_INTERRUPT   3
+
+struct Options
+{
+    std::string spec;
+    std::string out = "usb_descriptors";
+};
+
+// A spec line split into words. Quoted words keep their spaces, the quotes
+// are dropped, and key=value words are options.
+struct Line
+{
+    int                                num;
+    std::vector<std::string>           words;
+    std::vector<bool>                  quoted; // Per word, "text" in a class line is a string.
+    std::map<std::string, std::string> options;
+};
+
+// One descriptor inside a configuration, for the comments in the output.
+struct Desc
+{
+    size_t      offset;
+    size_t      length;
+    std::string comment;
+};
+
+// A byte that can only be filled in once the whole spec is read.
+struct Patch
+{
+    size_t      config;
+    size_t      offset;
+    std::string name;  // Interface name, $name in a class line.
+    int         line;
+};
+
+// A pointer into a configuration that the class libraries look up, e.g. g_hid_descriptor.
+struct Export
+{
+    std::string symbol;
+    size_t      config;
+    size_t      offset;
+};
+
+struct Config
+{
+    std::vector<uint8_t> bytes;
+    std::vector<Desc>    descs;
+    uint8_t              interfaces = 0;
+    size_t               interface_at = 0; // Offset of the open interface descriptor.
+    bool                 interface_open = false;
+    uint8_t              last_alt = 0;
+    uint8_t              alt_settings = 0;     // Interface descriptors with bAlternateSetting > 0.
+    size_t               iad_at = 0;
+    bool                 iad_open = false;
+    int                  iad_line = 0;
+    // Interface and alternate setting that uses each Endpoint address.
+    std::map<uint8_t, std::pair<uint8_t, uint8_t>> endpoints;
+};
+
+struct Spec
+{
+    uint16_t bcd_usb = 0x0200;
+    uint8_t  device_class = 0, device_subclass = 0, device_protocol = 0;
+    uint8_t  ep0_size = 8;
+    uint16_t vid = 0, pid = 0, release = 0x0100;
+    uint8_t  manufacturer = 0, product = 0, serial = 0;
+    bool     has_device = false;
+    uint16_t language = 0x0409;
+
+    std::vector<Config>       configs;
+    std::vector<std::u16string> strings;   // Index 0 is the language ID, not stored here.
+    std::vector<Patch>        patches;
+    std::vector<Export>       exports;
+
+    uint8_t  num_interfaces = 0;
+    uint8_t  num_alt_interfaces = 0;
+    uint16_t ep_size[MAX_ENDPOINTS][2] = {};  // [EP][OUT/IN], largest in any configuration.
+    bool     ep_used[MAX_ENDPOINTS][2] = {};
+    size_t   ep_in_config[MAX_ENDPOINTS] = {};  // 1 + the first configuration using the IN EP, 0 for none.
+    uint16_t ep_in_config_size[MAX_ENDPOINTS] = {};
+
+    std::map<std::string, uint8_t> interface_names;
+    std::map<std::string, uint8_t> endpoint_names;
+};
+
+static std::string g_spec_path;
+
+static void die(const char *msg, const std::string &what = "")
+{
+    fprintf(stderr, "desc_compiler: %s%s%s\n", msg, what.empty() ? "" : ": ", what.c_str());
+    exit(1);
+}
+
+static void die_at(int line, const std::string &msg)
+{
+    fprintf(stderr, "%s:%d: %s\n", g_spec_path.c_str(), line, msg.c_str());
+    exit(1);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  desc_compiler <spec> [--out usb_descriptors]\n"
+            "Compiles a device/configuration/interface/endpoint spec into packed\n"
+            "ROM descriptors, <out>.c, and the configuration macros the stack and\n"
+            "class libraries need, <out>.h. See README.txt for the spec format.\n");
+}
+
+/* ************************************************************************** */
+/* ******************************* PARSING ********************************** */
+/* ************************************************************************** */
+
+static std::vector<Line> read_spec(const std::string &path)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    std::vector<Line> lines;
+    char buf[1024];
+    int num = 0;
+
+    if(f == NULL) die("can't open", path);
+    while(fgets(buf, sizeof(buf), f))
+    {
+        std::string text = buf, word;
+        Line line;
+        bool quoted = false, in_word = false, was_quoted = false;
+
+        num++;
+        line.num = num;
+        for(size_t i = 0; i <= text.size(); i++)
+        {
+            char c = i < text.size() ? text[i] : '\n';
+            if(!quoted && c == '#') c = '\n';
+            if(c == '"')
+            {
+                quoted = !quoted;
+                in_word = true;
+                was_quoted = true;
+            }
+            else if(!quoted && isspace((unsigned char)c))
+            {
+                if(in_word)
+                {
+                    size_t eq = word.find('=');
+                    if(eq != std::string::npos && eq != 0) line.options[word.substr(0, eq)] = word.substr(eq + 1);
+                    else
+                    {
+                        line.words.push_back(word);
+                        line.quoted.push_back(was_quoted);
+                    }
+                }
+                word.clear();
+                in_word = false;
+                was_quoted = false;
+                if(c == '\n') break;
+            }
+            else
+            {
+                word += c;
+                in_word = true;
+            }
+        }
+        if(quoted) die_at(num, "missing closing quote");
+        if(!line.words.empty()) lines.push_back(line);
+        else if(!line.options.empty()) die_at(num, "options without a statement");
+    }
+    fclose(f);
+    return lines;
+}
+
+static uint32_t number(const Line &line, const std::string &text, uint32_t max)
+{
+    static const std::map<std::string, uint32_t> names =
+    {
+        {"audio", 0x01}, {"cdc", 0x02}, {"hid", 0x03}, {"msd", 0x08}, {"cdc_data", 0x0A},
+        {"misc", 0xEF}, {"app", 0xFE}, {"vendor", 0xFF},
+        {"cs_interface", 0x24}, {"cs_endpoint", 0x25}
+    };
+    char *end;
+    unsigned long val;
+    auto it = names.find(text);
+
+    if(it != names.end()) return it->second;
+    val = strtoul(text.c_str(), &end, 0);
+    if(text.empty() || *end != 0) die_at(line.num, "not a number: " + text);
+    if(val > max) die_at(line.num, text + " is larger than " + std::to_string(max));
+    return (uint32_t)val;
+}
+
+static uint32_t option(const Line &line, const char *key, uint32_t def, uint32_t max)
+{
+    auto it = line.options.find(key);
+    if(it == line.options.end()) return def;
+    return number(line, it->second, max);
+}
+
+static void check_options(const Line &line, const std::vector<std::string> &allowed)
+{
+    for(const auto &o : line.options)
+    {
+        bool ok = false;
+        for(const std::string &a : allowed) ok |= o.first == a;
+        if(!ok) die_at(line.num, "unknown option " + o.first + " for " + line.words[0]);
+    }
+}
+
+static bool identifier(const std::string &name)
+{
+    if(name.empty() || isdigit((unsigned char)name[0])) return false;
+    for(char c : name) if(!isalnum((unsigned char)c) && c != '_') return false;
+    return true;
+}
+
+// UTF-8 to UTF-16, the Basic Multilingual Plane is all a string descriptor needs.
+static std::u16string utf16(const Line &line, const std::string &text)
+{
+    std::u16string out;
+
+    for(size_t i = 0; i < text.size(); )
+    {
+        uint8_t  c = (uint8_t)text[i];
+        uint32_t cp;
+        int      extra;
+
+        if(c < 0x80)                { cp = c;        extra = 0; }
+        else if((c & 0xE0) == 0xC0) { cp = c & 0x1F; extra = 1; }
+        else if((c & 0xF0) == 0xE0) { cp = c & 0x0F; extra = 2; }
+        else die_at(line.num, "string has a character outside the Basic Multilingual Plane");
+        if(extra && i + extra >= text.size()) die_at(line.num, "string isn't valid UTF-8");
+        for(int j = 1; j <= extra; j++) cp = (cp << 6) | ((uint8_t)text[i + j] & 0x3F);
+        out += (char16_t)cp;
+        i += extra + 1;
+    }
+    if(out.size() > MAX_STRING_CHARS) die_at(line.num, "string longer than 126 characters");
+    return out;
+}
+
+// Index of a string descriptor, the same text always gets the same index.
+static uint8_t string_index(Spec &spec, const Line &line, const std::string &text)
+{
+    std::u16string s = utf16(line, text);
+
+    if(text.empty()) return 0;
+    for(size_t i = 0; i < spec.strings.size(); i++)
+    {
+        if(spec.strings[i] == s) return (uint8_t)(i + 1);
+    }
+    if(spec.strings.size() == 254) die_at(line.num, "more than 254 strings");
+    spec.strings.push_back(s);
+    return (uint8_t)spec.strings.size();
+}
+
+static uint8_t string_option(Spec &spec, const Line &line)
+{
+    auto it = line.options.find("string");
+    return it == line.options.end() ? 0 : string_index(spec, line, it->second);
+}
+
+static void name_option(std::map<std::string, uint8_t> &names, const Line &line, uint8_t val)
+{
+    auto it = line.options.find("name");
+    if(it == line.options.end()) return;
+    if(!identifier(it->second)) die_at(line.num, "name isn't a C identifier: " + it->second);
+    auto found = names.find(it->second);
+    if(found != names.end() && found->second != val) die_at(line.num, "name " + it->second + " is already used for a different number");
+    names[it->second] = val;
+}
+
+static Config &current(Spec &spec, const Line &line)
+{
+    if(spec.configs.empty()) die_at(line.num, line.words[0] + " before the first configuration");
+    return spec.configs.back();
+}
+
+static void put8(Config &c, uint32_t val)
+{
+    c.bytes.push_back((uint8_t)val);
+}
+
+static void put16(Config &c, uint32_t val)
+{
+    put8(c, val);
+    put8(c, val >> 8);
+}
+
+static void add_desc(Config &c, size_t start, const std::string &comment)
+{
+    c.descs.push_back({start, c.bytes.size() - start, comment});
+}
+
+static void close_interface(Config &c)
+{
+    if(!c.interface_open) return;
+    uint8_t endpoints = 0;
+    for(const Desc &d : c.descs)
+    {
+        if(d.offset > c.interface_at && c.bytes[d.offset + 1] == ENDPOINT_DESC) endpoints++;
+    }
+    c.bytes[c.interface_at + 4] = endpoints; // bNumEndpoints
+    c.interface_open = false;
+}
+
+static void close_config(Config &c, int line)
+{
+    close_interface(c);
+    if(c.iad_open && c.bytes[c.iad_at + 2] + c.bytes[c.iad_at + 3] > c.interfaces) die_at(c.iad_line, "association count runs past the last interface");
+    if(c.bytes.size() > MAX_CONFIG_LENGTH) die_at(line, "configuration longer than 65535 bytes");
+    c.bytes[2] = (uint8_t)c.bytes.size();        // wTotalLength
+    c.bytes[3] = (uint8_t)(c.bytes.size() >> 8);
+    c.bytes[4] = c.interfaces;                   // bNumInterfaces
+}
+
+static void parse_device(Spec &spec, const Line &line)
+{
+    check_options(line, {"vid", "pid", "release", "class", "subclass", "protocol", "ep0", "usb"});
+    if(spec.has_device) die_at(line.num, "more than one device");
+    if(!line.options.count("vid") || !line.options.count("pid")) die_at(line.num, "device needs vid= and pid=");
+    spec.has_device      = true;
+    spec.vid             = (uint16_t)option(line, "vid", 0, 0xFFFF);
+    spec.pid             = (uint16_t)option(line, "pid", 0, 0xFFFF);
+    spec.release         = (uint16_t)option(line, "release", 0x0100, 0xFFFF);
+    spec.device_class    = (uint8_t)option(line, "class", 0, 0xFF);
+    spec.device_subclass = (uint8_t)option(line, "subclass", 0, 0xFF);
+    spec.device_protocol = (uint8_t)option(line, "protocol", 0, 0xFF);
+    spec.ep0_size        = (uint8_t)option(line, "ep0", 8, 64);
+    spec.bcd_usb         = (uint16_t)option(line, "usb", 0x0200, 0xFFFF);
+    if(spec.ep0_size != 8 && spec.ep0_size != 16 && spec.ep0_size != 32 && spec.ep0_size != 64) die_at(line.num, "ep0 must be 8, 16, 32 or 64");
+}
+
+static void parse_configuration(Spec &spec, const Line &line)
+{
+    uint32_t ma, attributes = 0x80;
+    Config c;
+
+    check_options(line, {"power", "string"});
+    for(size_t i = 1; i < line.words.size(); i++)
+    {
+        if(line.words[i] == "self_powered") attributes |= 0x40;
+        else if(line.words[i] == "remote_wakeup") attributes |= 0x20;
+        else die_at(line.num, "unknown configuration attribute " + line.words[i]);
+    }
+    ma = option(line, "power", 100, 500);
+    if(!spec.configs.empty()) close_config(spec.configs.back(), line.num);
+    if(spec.configs.size() == 255) die_at(line.num, "more than 255 configurations");
+
+    put8(c, 9);
+    put8(c, CONFIGURATION_DESC);
+    put16(c, 0);                            // wTotalLength, filled in by close_config().
+    put8(c, 0);                             // bNumInterfaces, filled in by close_config().
+    put8(c, (uint32_t)spec.configs.size() + 1);
+    put8(c, string_option(spec, line));
+    put8(c, attributes);
+    put8(c, (ma + 1) / 2);
+    add_desc(c, 0, "Configuration " + std::to_string(spec.configs.size() + 1) + ", " + std::to_string(ma) + "mA");
+    spec.configs.push_back(c);
+}
+
+static void parse_association(Spec &spec, const Line &line)
+{
+    Config &c = current(spec, line);
+    size_t start = c.bytes.size();
+
+    check_options(line, {"count", "class", "subclass", "protocol", "string"});
+    if(line.words.size() != 1) die_at(line.num, "association only takes options");
+    if(!line.options.count("count")) die_at(line.num, "association needs count=");
+    close_interface(c);
+    if(c.iad_open && c.bytes[c.iad_at + 2] + c.bytes[c.iad_at + 3] > c.interfaces) die_at(c.iad_line, "association count runs past the next association");
+    c.iad_open = true;
+    c.iad_at   = start;
+    c.iad_line = line.num;
+    put8(c, 8);
+    put8(c, INTERFACE_ASSOCIATION_DESC);
+    put8(c, c.interfaces);                  // bFirstInterface, the next one.
+    put8(c, option(line, "count", 0, 0xFF));
+    put8(c, option(line, "class", 0, 0xFF));
+    put8(c, option(line, "subclass", 0, 0xFF));
+    put8(c, option(line, "protocol", 0, 0xFF));
+    put8(c, string_option(spec, line));
+    if(c.bytes[start + 3] == 0) die_at(line.num, "association count must be at least 1");
+    add_desc(c, start, "Interface Association, interfaces " + std::to_string(c.interfaces) + " to " + std::to_string(c.interfaces + c.bytes[start + 3] - 1));
+}
+
+static void parse_interface(Spec &spec, const Line &line)
+{
+    Config &c = current(spec, line);
+    size_t start = c.bytes.size();
+    uint8_t alt = (uint8_t)option(line, "alt", 0, 0xFF);
+    uint8_t number;
+    std::string comment;
+
+    check_options(line, {"class", "subclass", "protocol", "alt", "string", "name"});
+    if(line.words.size() != 1) die_at(line.num, "interface only takes options");
+    close_interface(c);
+    if(alt == 0)
+    {
+        if(c.interfaces == 0xFF) die_at(line.num, "more than 255 interfaces");
+        number = c.interfaces++;
+    }
+    else
+    {
+        if(c.interfaces == 0 || alt != c.last_alt + 1) die_at(line.num, "alt=" + std::to_string(alt) + " doesn't follow alternate setting " + std::to_string(c.last_alt) + " of an interface");
+        number = (uint8_t)(c.interfaces - 1);
+        c.alt_settings++;
+        if(c.alt_settings > spec.num_alt_interfaces) spec.num_alt_interfaces = c.alt_settings;
+    }
+    c.last_alt       = alt;
+    c.interface_at   = start;
+    c.interface_open = true;
+    name_option(spec.interface_names, line, number);
+
+    put8(c, 9);
+    put8(c, INTERFACE_DESC);
+    put8(c, number);
+    put8(c, alt);
+    put8(c, 0);                             // bNumEndpoints, filled in by close_interface().
+    put8(c, option(line, "class", 0, 0xFF));
+    put8(c, option(line, "subclass", 0, 0xFF));
+    put8(c, option(line, "protocol", 0, 0xFF));
+    put8(c, string_option(spec, line));
+    comment = "Interface " + std::to_string(number);
+    if(alt) comment += " alternate setting " + std::to_string(alt);
+    if(line.options.count("name")) comment += " (" + line.options.at("name") + ")";
+    add_desc(c, start, comment);
+    if(c.interfaces > spec.num_interfaces) spec.num_interfaces = c.interfaces;
+}
+
+static void parse_endpoint(Spec &spec, const Line &line)
+{
+    Config &c = current(spec, line);
+    size_t start = c.bytes.size();
+    uint8_t addr, ep, dir, type, attributes, interface, alt;
+    uint32_t size, interval;
+    bool audio = false;
+
+    check_options(line, {"interval", "sync", "usage", "refresh", "synch_address", "name"});
+    if(line.words.size() < 4) die_at(line.num, "endpoint needs <address> <bulk|interrupt|isochronous> <size>");
+    if(!c.interface_open) die_at(line.num, "endpoint outside an interface");
+    addr = (uint8_t)number(line, line.words[1], 0xFF);
+    ep   = addr & 0x0F;
+    dir  = (addr & 0x80) ? 1 : 0;
+    if((addr & 0x70) || ep == 0) die_at(line.num, "endpoint address must be 0x01 to 0x0F (OUT) or 0x81 to 0x8F (IN)");
+
+    if(line.words[2] == "bulk") type = EP_BULK;
+    else if(line.words[2] == "interrupt") type = EP_INTERRUPT;
+    else if(line.words[2] == "isochronous") type = EP_ISOCHRONOUS;
+    else die_at(line.num, "endpoint type must be bulk, interrupt or isochronous");
+    size = number(line, line.words[3], 1023);
+    for(size_t i = 4; i < line.words.size(); i++)
+    {
+        if(line.words[i] == "audio" && type == EP_ISOCHRONOUS) audio = true;
+        else die_at(line.num, "unknown endpoint flag " + line.words[i]);
+    }
+
+    // Full speed limits, USB 2.0 chapter 5.
+    if(type == EP_BULK && size != 8 && size != 16 && size != 32 && size != 64) die_at(line.num, "bulk endpoints must be 8, 16, 32 or 64 bytes");
+    if(type == EP_INTERRUPT && (size == 0 || size > 64)) die_at(line.num, "interrupt endpoints must be 1 to 64 bytes");
+    interval = option(line, "interval", type == EP_BULK ? 0 : 1, 0xFF);
+    if(type == EP_INTERRUPT && interval == 0) die_at(line.num, "interrupt interval must be 1 to 255 frames");
+    if(type == EP_ISOCHRONOUS && (interval == 0 || interval > 16)) die_at(line.num, "isochronous interval must be 1 to 16");
+
+    attributes = type;
+    if(type == EP_ISOCHRONOUS)
+    {
+        static const char *syncs[]  = {"none", "async", "adaptive", "sync"};
+        static const char *usages[] = {"data", "feedback", "implicit"};
+        std::string sync  = line.options.count("sync") ? line.options.at("sync") : "none";
+        std::string usage = line.options.count("usage") ? line.options.at("usage") : "data";
+        int s = -1, u = -1;
+        for(int i = 0; i < 4; i++) if(sync == syncs[i]) s = i;
+        for(int i = 0; i < 3; i++) if(usage == usages[i]) u = i;
+        if(s < 0) die_at(line.num, "sync must be none, async, adaptive or sync");
+        if(u < 0) die_at(line.num, "usage must be data, feedback or implicit");
+        attributes |= (uint8_t)((s << 2) | (u << 4));
+    }
+    else if(line.options.count("sync") || line.options.count("usage")) die_at(line.num, "sync= and usage= are for isochronous endpoints");
+    if(!audio && (line.options.count("refresh") || line.options.count("synch_address"))) die_at(line.num, "refresh= and synch_address= need the audio flag");
+
+    // The same address may only come back in another alternate setting of the same interface.
+    interface = c.bytes[c.interface_at + 2];
+    alt       = c.bytes[c.interface_at + 3];
+    auto used = c.endpoints.find(addr);
+    if(used != c.endpoints.end() && (used->second.first != interface || used->second.second == alt))
+    {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "endpoint 0x%02X is already used by interface %u", addr, used->second.first);
+        die_at(line.num, msg);
+    }
+    c.endpoints[addr] = {interface, alt};
+    // The classes send EPn_SIZE packets whichever configuration is set, an OUT buffer can just be bigger.
+    if(dir == 1 && spec.ep_in_config[ep] && spec.ep_in_config[ep] != spec.configs.size() && spec.ep_in_config_size[ep] != size)
+    {
+        char msg[112];
+        snprintf(msg, sizeof(msg), "endpoint 0x%02X is %u bytes in configuration %u, give this configuration its own IN endpoint", addr, spec.ep_in_config_size[ep], (unsigned)spec.ep_in_config[ep]);
+        die_at(line.num, msg);
+    }
+    if(dir == 1 && !spec.ep_in_config[ep])
+    {
+        spec.ep_in_config[ep] = spec.configs.size();
+        spec.ep_in_config_size[ep] = (uint16_t)size;
+    }
+    name_option(spec.endpoint_names, line, ep);
+    spec.ep_used[ep][dir] = true;
+    if(size > spec.ep_size[ep][dir]) spec.ep_size[ep][dir] = (uint16_t)size;
+
+    put8(c, audio ? 9 : 7);
+    put8(c, ENDPOINT_DESC);
+    put8(c, addr);
+    put8(c, attributes);
+    put16(c, size);
+    put8(c, interval);
+    if(audio)
+    {
+        put8(c, option(line, "refresh", 0, 0xFF));
+        put8(c, option(line, "synch_address", 0, 0xFF));
+    }
+    add_desc(c, start, std::string("Endpoint ") + std::to_string(ep) + (dir ? " IN, " : " OUT, ") + line.words[2] + " " + std::to_string(size));
+}
+
+// Class specific descriptor: <type> then the bytes after bDescriptorType, bLength
+// is counted. w:N is 16 bits, t:N 24 bits, d:N 32 bits (all little endian),
+// $name is the number of a named interface and a "quoted" word a string index.
+static void parse_class(Spec &spec, const Line &line)
+{
+    Config &c = current(spec, line);
+    size_t start = c.bytes.size();
+
+    check_options(line, {"export"});
+    if(line.words.size() < 2) die_at(line.num, "class needs a descriptor type");
+    put8(c, 0);
+    put8(c, number(line, line.words[1], 0xFF));
+    for(size_t i = 2; i < line.words.size(); i++)
+    {
+        const std::string &w = line.words[i];
+        if(w[0] == '$')
+        {
+            spec.patches.push_back({spec.configs.size() - 1, c.bytes.size(), w.substr(1), line.num});
+            put8(c, 0);
+        }
+        else if(w.size() > 2 && w[1] == ':' && (w[0] == 'w' || w[0] == 't' || w[0] == 'd'))
+        {
+            int bytes = w[0] == 'w' ? 2 : (w[0] == 't' ? 3 : 4);
+            uint32_t val = number(line, w.substr(2), bytes == 4 ? 0xFFFFFFFF : (1u << (bytes * 8)) - 1);
+            for(int b = 0; b < bytes; b++) put8(c, val >> (b * 8));
+        }
+        else if(line.quoted[i]) put8(c, string_index(spec, line, w));
+        else put8(c, number(line, w, 0xFF));
+    }
+    if(c.bytes.size() - start > 0xFF) die_at(line.num, "descriptor longer than 255 bytes");
+    c.bytes[start] = (uint8_t)(c.bytes.size() - start);
+    if(line.options.count("export"))
+    {
+        if(!identifier(line.options.at("export"))) die_at(line.num, "export isn't a C identifier");
+        spec.exports.push_back({line.options.at("export"), spec.configs.size() - 1, start});
+    }
+    char comment[48];
+    snprintf(comment, sizeof(comment), "Class specific 0x%02X", c.bytes[start + 1]);
+    if(c.bytes.size() - start > 2) snprintf(comment + strlen(comment), sizeof(comment) - strlen(comment), ", subtype 0x%02X", c.bytes[start + 2]);
+    add_desc(c, start, comment);
+}
+
+// HID descriptor with one report descriptor, exported as g_hid_descriptor for usb_hid.c.
+static void parse_hid(Spec &spec, const Line &line)
+{
+    Config &c = current(spec, line);
+    size_t start = c.bytes.size();
+    std::string symbol = line.options.count("export") ? line.options.at("export") : "g_hid_descriptor";
+
+    check_options(line, {"report_size", "country", "export"});
+    if(!line.options.count("report_size")) die_at(line.num, "hid needs report_size=");
+    if(!c.interface_open) die_at(line.num, "hid outside an interface");
+    if(!identifier(symbol)) die_at(line.num, "export isn't a C identifier");
+    put8(c, 9);
+    put8(c, HID_DESC);
+    put16(c, 0x0111);
+    put8(c, option(line, "country", 0, 0xFF));
+    put8(c, 1);
+    put8(c, HID_REPORT_DESC);
+    put16(c, option(line, "report_size", 0, 0xFFFF));
+    spec.exports.push_back({symbol, spec.configs.size() - 1, start});
+    add_desc(c, start, "HID, " + line.options.at("report_size") + " byte report descriptor");
+}
+
+static void parse(Spec &spec, const std::vector<Line> &lines)
+{
+    int last = 0;
+
+    for(const Line &line : lines)
+    {
+        const std::string &cmd = line.words[0];
+        last = line.num;
+
+        if(cmd == "device") parse_device(spec, line);
+        else if(cmd == "language")
+        {
+            if(line.words.size() != 2) die_at(line.num, "language needs one LANGID");
+            spec.language = (uint16_t)number(line, line.words[1], 0xFFFF);
+        }
+        else if(cmd == "manufacturer" || cmd == "product" || cmd == "serial")
+        {
+            if(line.words.size() != 2) die_at(line.num, cmd + " needs one quoted string");
+            uint8_t index = string_index(spec, line, line.words[1]);
+            if(cmd == "manufacturer") spec.manufacturer = index;
+            else if(cmd == "product") spec.product = index;
+            else spec.serial = index;
+        }
+        else if(cmd == "configuration") parse_configuration(spec, line);
+        else if(cmd == "association") parse_association(spec, line);
+        else if(cmd == "interface") parse_interface(spec, line);
+        else if(cmd == "endpoint") parse_endpoint(spec, line);
+        else if(cmd == "class") parse_class(spec, line);
+        else if(cmd == "hid") parse_hid(spec, line);
+        else die_at(line.num, "unknown statement " + cmd);
+    }
+    if(!spec.has_device) die("the spec has no device");
+    if(spec.configs.empty()) die("the spec has no configuration");
+    close_config(spec.configs.back(), last);
+
+    for(const Patch &p : spec.patches)
+    {
+        auto it = spec.interface_names.find(p.name);
+        if(it == spec.interface_names.end()) die_at(p.line, "no interface named " + p.name);
+        spec.configs[p.config].bytes[p.offset] = it->second;
+    }
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************* OUTPUT *********************************** */
+/* ************************************************************************** */
+
+static std::string base_name(const std::string &path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static std::string printable(const std::u16string &s)
+{
+    std::string out;
+    for(char16_t c : s) out += (c >= 0x20 && c < 0x7F && c != '\\') ? (char)c : '?';
+    return out;
+}
+
+static void define(FILE *f, const std::string &name, unsigned val, const char *comment = "")
+{
+    fprintf(f, "#define %-18s %u%s%s\n", name.c_str(), val, *comment ? " // " : "", comment);
+}
+
+static void write_h(const Spec &spec, const Options &opt)
+{
+    std::string base = base_name(opt.out), guard;
+    FILE *f = fopen((opt.out + ".h").c_str(), "w");
+    uint8_t num_endpoints = 1;
+
+    if(f == NULL) die("can't write", opt.out + ".h");
+    for(char c : base) guard += isalnum((unsigned char)c) ? (char)toupper((unsigned char)c) : '_';
+    guard += "_H";
+    for(int ep = 1; ep < MAX_ENDPOINTS; ep++)
+    {
+        if(spec.ep_used[ep][0] || spec.ep_used[ep][1]) num_endpoints = (uint8_t)(ep + 1);
+    }
+
+    fprintf(f, "// Generated by Tools/Desc_Compiler from %s, don't edit.\n", base_name(g_spec_path).c_str());
+    fprintf(f, "// Include it from usb_config.h in place of the hand written counts and sizes.\n\n");
+    fprintf(f, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+    define(f, "NUM_CONFIGURATIONS", (unsigned)spec.configs.size());
+    define(f, "NUM_INTERFACES", spec.num_interfaces);
+    define(f, "NUM_ALT_INTERFACES", spec.num_alt_interfaces);
+    define(f, "NUM_ENDPOINTS", num_endpoints);
+    define(f, "EP0_SIZE", spec.ep0_size);
+    for(int ep = 1; ep < num_endpoints; ep++)
+    {
+        std::string name = "EP" + std::to_string(ep);
+        uint16_t out = spec.ep_size[ep][0], in = spec.ep_size[ep][1];
+        uint16_t size = out > in ? out : in;
+
+        // An Endpoint number that's skipped still gets a size of 0 for usb_hal.h.
+        define(f, name + "_SIZE", size);
+        if(out != size) define(f, name + "_OUT_SIZE", out, out ? "" : "IN only.");
+        if(in != size)  define(f, name + "_IN_SIZE", in, in ? "" : "OUT only.");
+    }
+    define(f, "NUM_STRINGS", (unsigned)spec.strings.size() + 1);
+    fprintf(f, "\n");
+
+    if(!spec.interface_names.empty() || !spec.endpoint_names.empty())
+    {
+        fprintf(f, "// For the class config headers.\n");
+        for(const auto &n : spec.interface_names) fprintf(f, "#define %s_INT %u\n", n.first.c_str(), n.second);
+        for(const auto &n : spec.endpoint_names)
+        {
+            fprintf(f, "#define %s_EP EP%u\n", n.first.c_str(), n.second);
+            fprintf(f, "#define %s_EP_SIZE EP%u_SIZE\n", n.first.c_str(), n.second);
+        }
+        fprintf(f, "\n");
+    }
+
+    fprintf(f, "#ifndef USE_FAST_ENUMERATION\n");
+    fprintf(f, "#define USE_FAST_ENUMERATION // g_config_descriptor_lengths[] is always generated.\n");
+    fprintf(f, "#endif\n\n");
+    fprintf(f, "#endif /* %s */\n", guard.c_str());
+    fclose(f);
+}
+
+// One line of the Device Descriptor initializer, the comments lined up.
+static void field(FILE *f, const char *format, unsigned a, unsigned b, unsigned c, const char *comment)
+{
+    char text[64];
+    snprintf(text, sizeof(text), format, a, b, c);
+    fprintf(f, "    %-32s // %s\n", text, comment);
+}
+
+static void write_c(const Spec &spec, const Options &opt)
+{
+    FILE *f = fopen((opt.out + ".c").c_str(), "w");
+    std::vector<size_t> string_offsets;
+    size_t rom = 18, string_bytes = 4;
+
+    if(f == NULL) die("can't write", opt.out + ".c");
+    for(const Config &c : spec.configs) rom += c.bytes.size() + 4;
+    for(const std::u16string &s : spec.strings) string_bytes += 2 + (s.size() * 2);
+    rom += string_bytes + ((spec.strings.size() + 1) * 2) + 1;
+
+    fprintf(f, "// Generated by Tools/Desc_Compiler from %s, don't edit.\n", base_name(g_spec_path).c_str());
+    fprintf(f, "// %u configuration(s), %u string(s), %u bytes of ROM.\n\n", (unsigned)spec.configs.size(), (unsigned)spec.strings.size() + 1, (unsigned)rom);
+    fprintf(f, "#include <stdint.h>\n#include \"usb_config.h\"\n#include \"usb_hal.h\"\n#include \"usb_ch9.h\"\n\n");
+
+    fprintf(f, "/** Device Descriptor */\n");
+    fprintf(f, "const ch9_device_descriptor_t g_device_descriptor =\n{\n");
+    field(f, "0x12, DEVICE_DESC, 0x%04X,", spec.bcd_usb, 0, 0, "bLength, bDescriptorType, bcdUSB");
+    field(f, "0x%02X, 0x%02X, 0x%02X,", spec.device_class, spec.device_subclass, spec.device_protocol, "bDeviceClass, bDeviceSubClass, bDeviceProtocol");
+    field(f, "EP0_SIZE,", 0, 0, 0, "bMaxPacketSize0");
+    field(f, "0x%04X, 0x%04X, 0x%04X,", spec.vid, spec.pid, spec.release, "idVendor, idProduct, bcdDevice");
+    field(f, "%u, %u, %u,", spec.manufacturer, spec.product, spec.serial, "iManufacturer, iProduct, iSerialNumber");
+    field(f, "NUM_CONFIGURATIONS", 0, 0, 0, "bNumConfigurations");
+    fprintf(f, "};\n\n");
+
+    for(size_t i = 0; i < spec.configs.size(); i++)
+    {
+        const Config &c = spec.configs[i];
+        fprintf(f, "/** Configuration Descriptor %u */\n", (unsigned)i);
+        fprintf(f, "static const uint8_t config_descriptor%u[%u] =\n{\n", (unsigned)i, (unsigned)c.bytes.size());
+        for(const Desc &d : c.descs)
+        {
+            fprintf(f, "    // %s\n   ", d.comment.c_str());
+            for(size_t b = 0; b < d.length; b++)
+            {
+                bool last = d.offset + b + 1 == c.bytes.size();
+                fprintf(f, "%s0x%02X%s", (b && b % 16 == 0) ? "\n    " : " ", c.bytes[d.offset + b], last ? "" : ",");
+            }
+            fprintf(f, "\n");
+        }
+        fprintf(f, "};\n\n");
+    }
+
+    fprintf(f, "/** Configuration Descriptor Addresses Array */\n");
+    fprintf(f, "const usb_desc_addr_t g_config_descriptors[] =\n{\n");
+    for(size_t i = 0; i < spec.configs.size(); i++) fprintf(f, "    (usb_desc_addr_t)config_descriptor%u%s\n", (unsigned)i, i + 1 < spec.configs.size() ? "," : "");
+    fprintf(f, "};\n\n");
+    fprintf(f, "/** Configuration Descriptor Lengths Array */\n");
+    fprintf(f, "const uint16_t g_config_descriptor_lengths[] =\n{\n");
+    for(size_t i = 0; i < spec.configs.size(); i++) fprintf(f, "    sizeof(config_descriptor%u)%s\n", (unsigned)i, i + 1 < spec.configs.size() ? "," : "");
+    fprintf(f, "};\n\n");
+
+    for(const Export &e : spec.exports)
+    {
+        fprintf(f, "const uint8_t* %s = &config_descriptor%u[%u];\n", e.symbol.c_str(), (unsigned)e.config, (unsigned)e.offset);
+    }
+    if(!spec.exports.empty()) fprintf(f, "\n");
+
+    // Every string descriptor in one array, a text used twice is only stored once.
+    fprintf(f, "/** String Descriptors */\n");
+    fprintf(f, "static const uint8_t string_descriptors[%u] =\n{\n", (unsigned)string_bytes);
+    fprintf(f, "    // 0: LANGID\n    0x04, STRING_DESC, 0x%02X, 0x%02X%s\n", spec.language & 0xFF, spec.language >> 8, spec.strings.empty() ? "" : ",");
+    string_offsets.push_back(0);
+    size_t offset = 4;
+    for(size_t i = 0; i < spec.strings.size(); i++)
+    {
+        const std::u16string &s = spec.strings[i];
+        string_offsets.push_back(offset);
+        fprintf(f, "    // %u: \"%s\"\n    0x%02X, STRING_DESC", (unsigned)i + 1, printable(s).c_str(), (unsigned)(2 + s.size() * 2));
+        for(size_t j = 0; j < s.size(); j++)
+        {
+            if(s[j] >= 0x20 && s[j] < 0x7F && s[j] != '\'' && s[j] != '\\' && s[j] != '\t') fprintf(f, ",%s'%c',0", (j % 8 == 0) ? "\n    " : " ", (char)s[j]);
+            else fprintf(f, ",%s0x%02X,0x%02X", (j % 8 == 0) ? "\n    " : " ", s[j] & 0xFF, s[j] >> 8);
+        }
+        fprintf(f, "%s\n", i + 1 < spec.strings.size() ? "," : "");
+        offset += 2 + (s.size() * 2);
+    }
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "/** String Descriptor Addresses Array */\n");
+    fprintf(f, "const usb_desc_addr_t g_string_descriptors[NUM_STRINGS] =\n{\n");
+    for(size_t i = 0; i < string_offsets.size(); i++) fprintf(f, "    (usb_desc_addr_t)&string_descriptors[%u]%s\n", (unsigned)string_offsets[i], i + 1 < string_offsets.size() ? "," : "");
+    fprintf(f, "};\n\n");
+    fprintf(f, "/** String Descriptor Addresses Array Size */\n");
+    fprintf(f, "const uint8_t g_size_of_sd = NUM_STRINGS;\n");
+    fclose(f);
+}
+
+/* ************************************************************************** */
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    Spec    spec;
+
+    if(argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    opt.spec = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--out" && has_value) opt.out = argv[++i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    g_spec_path = opt.spec;
+
+    parse(spec, read_spec(opt.spec));
+    write_h(spec, opt);
+    write_c(spec, opt);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#-------------------------------------------------
+# FAT Image, turns a folder into a compressed
+# FAT12 volume for the MSD examples' ROM.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = fat_image
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+SOURCES += fat_image.cpp
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
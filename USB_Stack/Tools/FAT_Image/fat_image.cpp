@@ -0,0 +1,486 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+#define SECTOR_SIZE   512
+#define CHUNK_SIZE    64  // Sectors are compressed in EP sized chunks, see rom_image.c.
+#define CHUNKS        (SECTOR_SIZE / CHUNK_SIZE)
+#define MIN_MATCH     3
+#define MAX_MATCH     (0x7F + MIN_MATCH)
+#define MAX_LITERALS  0x80
+#define FAT12_MAX_CLUSTERS 4084
+
+#define ATTR_READ_ONLY 0x01
+#define ATTR_VOLUME_ID 0x08
+#define ATTR_DIRECTORY 0x10
+#define ATTR_ARCHIVE   0x20
+
+struct Options
+{
+    std::string dir;
+    std::string out = "rom_image_data";
+    std::string label = "USB DRIVE";
+    std::string raw;
+    uint32_t    blocks = 256;
+    uint32_t    root_entries = 16;
+    bool        read_only = false;
+};
+
+// One file or directory, with the clusters it's been given.
+struct Node
+{
+    fs::path          path;
+    uint8_t           name[11];
+    bool              is_dir;
+    uint32_t          size;
+    uint16_t          date;
+    uint16_t          time;
+    uint32_t          first_cluster;
+    uint32_t          clusters;
+    std::vector<Node> children;
+};
+
+// The laid out volume.
+struct Volume
+{
+    uint32_t blocks;
+    uint32_t spc;        // Sectors per cluster.
+    uint32_t fat_sects;
+    uint32_t root_sects;
+    uint32_t data_start; // First sector of cluster 2.
+    uint32_t clusters;
+    uint32_t next_cluster;
+    std::vector<uint8_t> image;
+};
+
+static void die(const char *msg, const std::string &what = "")
+{
+    fprintf(stderr, "fat_image: %s%s%s\n", msg, what.empty() ? "" : ": ", what.c_str());
+    exit(1);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  fat_image <dir> [--out rom_image_data] [--blocks 256] [--label \"USB DRIVE\"]\n"
+            "            [--root-entries 16] [--read-only] [--raw volume.img]\n"
+            "Puts the files in <dir> on a FAT12 volume and writes it compressed as\n"
+            "<out>.c and <out>.h, for rom_image.c to read back in msd_rx_sector().\n"
+            "Names must already fit 8.3.\n");
+}
+
+static void put16(uint8_t *p, uint32_t val)
+{
+    p[0] = (uint8_t)val;
+    p[1] = (uint8_t)(val >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t val)
+{
+    put16(p, val);
+    put16(p + 2, val >> 16);
+}
+
+static void short_name(const std::string &name, uint8_t out[11])
+{
+    std::string base = name, ext;
+    size_t dot = name.rfind('.');
+
+    if(dot != std::string::npos && dot != 0)
+    {
+        base = name.substr(0, dot);
+        ext  = name.substr(dot + 1);
+    }
+    if(base.empty() || base.size() > 8 || ext.size() > 3) die("name doesn't fit 8.3", name);
+
+    memset(out, ' ', 11);
+    for(size_t i = 0; i < base.size(); i++) out[i] = (uint8_t)toupper((unsigned char)base[i]);
+    for(size_t i = 0; i < ext.size(); i++) out[8 + i] = (uint8_t)toupper((unsigned char)ext[i]);
+    for(int i = 0; i < 11; i++)
+    {
+        if(out[i] < 0x20 || strchr("\"*+,./:;<=>?[\\]|", out[i])) die("name has a character FAT can't hold", name);
+    }
+}
+
+static void fat_time(const fs::path &path, uint16_t *p_date, uint16_t *p_time)
+{
+    std::error_code ec;
+    auto ftime = fs::last_write_time(path, ec);
+    time_t t = 0;
+    struct tm *tm;
+
+    if(!ec)
+    {
+        auto sys = std::chrono::time_point_cast<std::chrono::system_clock::duration>(ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+        t = std::chrono::system_clock::to_time_t(sys);
+    }
+    tm = localtime(&t);
+    if(!tm || tm->tm_year < 80)
+    {
+        *p_date = (0 << 9) | (1 << 5) | 1; // 1980-01-01
+        *p_time = 0;
+        return;
+    }
+    *p_date = (uint16_t)(((tm->tm_year - 80) << 9) | ((tm->tm_mon + 1) << 5) | tm->tm_mday);
+    *p_time = (uint16_t)((tm->tm_hour << 11) | (tm->tm_min << 5) | (tm->tm_sec / 2));
+}
+
+static void scan(const fs::path &dir, Node &parent)
+{
+    std::vector<fs::directory_entry> entries;
+
+    for(auto &e : fs::directory_iterator(dir)) entries.push_back(e);
+    std::sort(entries.begin(), entries.end(), [](const fs::directory_entry &a, const fs::directory_entry &b) { return a.path().filename() < b.path().filename(); });
+
+    for(auto &e : entries)
+    {
+        Node n = {};
+
+        if(!e.is_directory() && !e.is_regular_file()) continue;
+        n.path   = e.path();
+        n.is_dir = e.is_directory();
+        n.size   = n.is_dir ? 0 : (uint32_t)e.file_size();
+        short_name(e.path().filename().string(), n.name);
+        fat_time(e.path(), &n.date, &n.time);
+        for(auto &c : parent.children)
+        {
+            if(!memcmp(c.name, n.name, 11)) die("two names are the same in 8.3", e.path().string());
+        }
+        if(n.is_dir) scan(e.path(), n);
+        parent.children.push_back(n);
+    }
+}
+
+static void layout(Volume &vol, const Options &opt)
+{
+    vol.blocks     = opt.blocks;
+    vol.root_sects = (opt.root_entries * 32 + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    for(vol.spc = 1; vol.spc <= 128; vol.spc <<= 1)
+    {
+        vol.fat_sects = 1;
+        for(int i = 0; i < 4; i++) // Settles in a couple of passes.
+        {
+            uint32_t data = vol.blocks - 1 - vol.fat_sects - vol.root_sects;
+            vol.clusters  = data / vol.spc;
+            vol.fat_sects = (((vol.clusters + 2) * 3 + 1) / 2 + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        }
+        if(vol.clusters <= FAT12_MAX_CLUSTERS) break;
+    }
+    if(vol.spc > 128) die("too many blocks for FAT12");
+    vol.data_start   = 1 + vol.fat_sects + vol.root_sects;
+    vol.next_cluster = 2;
+    vol.image.assign((size_t)vol.blocks * SECTOR_SIZE, 0);
+}
+
+static uint32_t cluster_sect(const Volume &vol, uint32_t cluster)
+{
+    return vol.data_start + (cluster - 2) * vol.spc;
+}
+
+static void set_fat(Volume &vol, uint32_t cluster, uint32_t val)
+{
+    uint8_t *p = &vol.image[SECTOR_SIZE + cluster + cluster / 2];
+
+    if(cluster & 1)
+    {
+        p[0] = (uint8_t)((p[0] & 0x0F) | (val << 4));
+        p[1] = (uint8_t)(val >> 4);
+    }
+    else
+    {
+        p[0] = (uint8_t)val;
+        p[1] = (uint8_t)((p[1] & 0xF0) | ((val >> 8) & 0x0F));
+    }
+}
+
+static void allocate(Volume &vol, Node &n)
+{
+    uint32_t bytes = n.is_dir ? (uint32_t)(n.children.size() + 2) * 32 : n.size;
+    uint32_t cluster_bytes = vol.spc * SECTOR_SIZE;
+
+    n.clusters = (bytes + cluster_bytes - 1) / cluster_bytes;
+    if(n.clusters)
+    {
+        if(vol.next_cluster + n.clusters > vol.clusters + 2) die("files don't fit, use more --blocks", n.path.string());
+        n.first_cluster = vol.next_cluster;
+        vol.next_cluster += n.clusters;
+        for(uint32_t i = 0; i < n.clusters; i++) set_fat(vol, n.first_cluster + i, i + 1 == n.clusters ? 0xFFF : n.first_cluster + i + 1);
+    }
+    for(auto &c : n.children) allocate(vol, c);
+}
+
+static void dir_entry(uint8_t *p, const uint8_t name[11], uint8_t attr, uint16_t date, uint16_t time, uint32_t cluster, uint32_t size)
+{
+    memcpy(p, name, 11);
+    p[11] = attr;
+    put16(&p[14], time);  // CrtTime
+    put16(&p[16], date);  // CrtDate
+    put16(&p[18], date);  // LstAccDate
+    put16(&p[22], time);  // WrtTime
+    put16(&p[24], date);  // WrtDate
+    put16(&p[26], cluster);
+    put32(&p[28], size);
+}
+
+static void write_dir(Volume &vol, const Node &dir, uint8_t *p, uint32_t parent_cluster, const Options &opt)
+{
+    uint8_t file_attr = ATTR_ARCHIVE | (opt.read_only ? ATTR_READ_ONLY : 0);
+
+    if(parent_cluster != UINT32_MAX) // Not the root.
+    {
+        const uint8_t dot[11]    = {'.',' ',' ',' ',' ',' ',' ',' ',' ',' ',' '};
+        const uint8_t dotdot[11] = {'.','.',' ',' ',' ',' ',' ',' ',' ',' ',' '};
+
+        dir_entry(p, dot, ATTR_DIRECTORY, dir.date, dir.time, dir.first_cluster, 0);
+        dir_entry(p + 32, dotdot, ATTR_DIRECTORY, dir.date, dir.time, parent_cluster, 0);
+        p += 64;
+    }
+    for(auto &c : dir.children)
+    {
+        dir_entry(p, c.name, c.is_dir ? ATTR_DIRECTORY : file_attr, c.date, c.time, c.first_cluster, c.size);
+        p += 32;
+    }
+    for(auto &c : dir.children)
+    {
+        uint8_t *p_data;
+
+        if(!c.clusters) continue; // Empty file.
+        p_data = &vol.image[(size_t)cluster_sect(vol, c.first_cluster) * SECTOR_SIZE];
+        if(c.is_dir) write_dir(vol, c, p_data, parent_cluster == UINT32_MAX ? 0 : dir.first_cluster, opt);
+        else
+        {
+            std::ifstream f(c.path, std::ios::binary);
+            if(!f.read((char*)p_data, c.size)) die("can't read", c.path.string());
+        }
+    }
+}
+
+static void build(Volume &vol, Node &root, const Options &opt)
+{
+    uint8_t *p = vol.image.data();
+    uint8_t  label[11];
+    uint16_t date, time;
+    size_t   root_used = root.children.size() + 1;
+
+    if(root_used > opt.root_entries) die("too many files in the root, use more --root-entries");
+    for(auto &c : root.children) allocate(vol, c);
+
+    // Boot sector
+    memcpy(p, "\xEB\x3C\x90" "MSDOS5.0", 11);
+    put16(&p[11], SECTOR_SIZE);
+    p[13] = (uint8_t)vol.spc;
+    put16(&p[14], 1);                // RsvdSecCnt
+    p[16] = 1;                       // NumFATs
+    put16(&p[17], opt.root_entries);
+    if(vol.blocks < 0x10000) put16(&p[19], vol.blocks);
+    else put32(&p[32], vol.blocks);
+    p[21] = 0xF8;                    // Media
+    put16(&p[22], vol.fat_sects);
+    put16(&p[24], 1);                // SecPerTrk
+    put16(&p[26], 1);                // NumHeads
+    p[36] = 0x80;                    // DrvNum
+    p[38] = 0x29;                    // BootSig
+    put32(&p[39], 0x56A3E886);       // VolID
+    memset(label, ' ', 11);
+    for(size_t i = 0; i < opt.label.size() && i < 11; i++) label[i] = (uint8_t)toupper((unsigned char)opt.label[i]);
+    memcpy(&p[43], label, 11);
+    memcpy(&p[54], "FAT12   ", 8);
+    p[510] = 0x55;
+    p[511] = 0xAA;
+
+    // FAT
+    set_fat(vol, 0, 0xFF8);
+    set_fat(vol, 1, 0xFFF);
+
+    // Root
+    fat_time(opt.dir, &date, &time);
+    p = &vol.image[(size_t)(1 + vol.fat_sects) * SECTOR_SIZE];
+    dir_entry(p, label, ATTR_VOLUME_ID, date, time, 0, 0);
+    write_dir(vol, root, p + 32, UINT32_MAX, opt);
+}
+
+// Greedy LZ within the chunk, matches only look back inside the chunk so the
+// decoder needs no more RAM than the chunk it's writing.
+static std::vector<uint8_t> compress_chunk(const uint8_t *p)
+{
+    std::vector<uint8_t> out;
+    size_t lit_start = 0, i = 0;
+
+    auto flush_literals = [&](size_t end)
+    {
+        while(lit_start < end)
+        {
+            size_t n = std::min(end - lit_start, (size_t)MAX_LITERALS);
+            out.push_back((uint8_t)(n - 1));
+            out.insert(out.end(), p + lit_start, p + lit_start + n);
+            lit_start += n;
+        }
+    };
+
+    while(i < CHUNK_SIZE)
+    {
+        size_t best_len = 0, best_dist = 0;
+
+        for(size_t d = 1; d <= i; d++)
+        {
+            size_t len = 0;
+            while(i + len < CHUNK_SIZE && len < MAX_MATCH && p[i + len] == p[i + len - d]) len++;
+            if(len > best_len)
+            {
+                best_len  = len;
+                best_dist = d;
+            }
+        }
+        if(best_len >= MIN_MATCH)
+        {
+            flush_literals(i);
+            out.push_back((uint8_t)(0x80 | (best_len - MIN_MATCH)));
+            out.push_back((uint8_t)best_dist);
+            i += best_len;
+            lit_start = i;
+        }
+        else i++;
+    }
+    flush_literals(CHUNK_SIZE);
+    return out;
+}
+
+static void write_c(const Volume &vol, const Options &opt)
+{
+    std::vector<uint8_t>  data;
+    std::vector<uint32_t> sect_offsets;
+    std::vector<uint32_t> run_lba, run_count, run_first;
+    std::string base = fs::path(opt.out).filename().string();
+    FILE *f;
+
+    for(uint32_t lba = 0; lba < vol.blocks; lba++)
+    {
+        const uint8_t *p = &vol.image[(size_t)lba * SECTOR_SIZE];
+        uint8_t lens[CHUNKS];
+        std::vector<uint8_t> chunks;
+
+        if(std::all_of(p, p + SECTOR_SIZE, [](uint8_t b) { return b == 0; })) continue; // Blank sectors aren't stored.
+
+        for(int c = 0; c < CHUNKS; c++)
+        {
+            const uint8_t *pc = p + c * CHUNK_SIZE;
+            std::vector<uint8_t> z;
+
+            if(std::all_of(pc, pc + CHUNK_SIZE, [](uint8_t b) { return b == 0; }))
+            {
+                lens[c] = 0;
+                continue;
+            }
+            z = compress_chunk(pc);
+            lens[c] = (uint8_t)z.size();
+            chunks.insert(chunks.end(), z.begin(), z.end());
+        }
+
+        if(!run_lba.empty() && run_lba.back() + run_count.back() == lba) run_count.back()++;
+        else
+        {
+            run_lba.push_back(lba);
+            run_count.push_back(1);
+            run_first.push_back((uint32_t)sect_offsets.size());
+        }
+        sect_offsets.push_back((uint32_t)data.size());
+        data.insert(data.end(), lens, lens + CHUNKS);
+        data.insert(data.end(), chunks.begin(), chunks.end());
+    }
+    if(run_lba.empty()) // Can't happen, the boot sector is never blank, but keep the arrays non empty.
+    {
+        run_lba.push_back(0);
+        run_count.push_back(0);
+        run_first.push_back(0);
+    }
+
+    f = fopen((opt.out + ".h").c_str(), "w");
+    if(!f) die("can't write", opt.out + ".h");
+    fprintf(f, "// Generated by Tools/FAT_Image from %s, don't edit.\n\n", opt.dir.c_str());
+    fprintf(f, "#ifndef ROM_IMAGE_DATA_H\n#define ROM_IMAGE_DATA_H\n\n");
+    fprintf(f, "#define ROM_IMAGE_BLOCKS %u\n", vol.blocks);
+    fprintf(f, "#define ROM_IMAGE_RUNS   %u\n", (unsigned)run_lba.size());
+    fprintf(f, "#define ROM_IMAGE_SECTS  %u\n", (unsigned)sect_offsets.size());
+    fprintf(f, "#define ROM_IMAGE_BYTES  %u\n\n", (unsigned)data.size());
+    fprintf(f, "#endif /* ROM_IMAGE_DATA_H */\n");
+    fclose(f);
+
+    f = fopen((opt.out + ".c").c_str(), "w");
+    if(!f) die("can't write", opt.out + ".c");
+    fprintf(f, "// Generated by Tools/FAT_Image from %s, don't edit.\n", opt.dir.c_str());
+    fprintf(f, "// %u blocks, %u stored, %u bytes compressed from %u.\n\n", vol.blocks, (unsigned)sect_offsets.size(), (unsigned)data.size(), (unsigned)sect_offsets.size() * SECTOR_SIZE);
+    fprintf(f, "#include <stdint.h>\n#include \"usb_msd_config.h\"\n\n#ifdef MSD_ROM_IMAGE\n");
+    fprintf(f, "#include \"rom_image.h\"\n#include \"%s.h\"\n\n", base.c_str());
+
+    fprintf(f, "const rom_image_run_t g_rom_image_runs[ROM_IMAGE_RUNS] =\n{\n");
+    for(size_t i = 0; i < run_lba.size(); i++) fprintf(f, "    {%u, %u, %u},\n", run_lba[i], run_count[i], run_first[i]);
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "const uint32_t g_rom_image_sects[ROM_IMAGE_SECTS] =\n{");
+    for(size_t i = 0; i < sect_offsets.size(); i++) fprintf(f, "%s%u,", i % 8 ? " " : "\n    ", sect_offsets[i]);
+    fprintf(f, "\n};\n\n");
+
+    fprintf(f, "const uint8_t g_rom_image_data[ROM_IMAGE_BYTES] =\n{");
+    for(size_t i = 0; i < data.size(); i++) fprintf(f, "%s0x%02X,", i % 16 ? "" : "\n    ", data[i]);
+    fprintf(f, "\n};\n\n#endif /* MSD_ROM_IMAGE */\n");
+    fclose(f);
+
+    printf("%u blocks, %u stored in %u runs, %u bytes compressed from %u.\n", vol.blocks, (unsigned)sect_offsets.size(), (unsigned)run_lba.size(), (unsigned)data.size(), (unsigned)sect_offsets.size() * SECTOR_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    Volume  vol;
+    Node    root = {};
+
+    if(argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    opt.dir = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--out" && has_value) opt.out = argv[++i];
+        else if(arg == "--blocks" && has_value) opt.blocks = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--label" && has_value) opt.label = argv[++i];
+        else if(arg == "--root-entries" && has_value) opt.root_entries = ((uint32_t)strtoul(argv[++i], NULL, 0) + 15) & ~15u;
+        else if(arg == "--raw" && has_value) opt.raw = argv[++i];
+        else if(arg == "--read-only") opt.read_only = true;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if(!fs::is_directory(opt.dir)) die("not a directory", opt.dir);
+    if(opt.blocks < 8 || opt.blocks > 0xFFFF) die("--blocks must be 8 to 65535");
+    if(opt.root_entries == 0) opt.root_entries = 16;
+
+    scan(opt.dir, root);
+    layout(vol, opt);
+    build(vol, root, opt);
+    write_c(vol, opt);
+
+    if(!opt.raw.empty())
+    {
+        std::ofstream f(opt.raw, std::ios::binary);
+        f.write((const char*)vol.image.data(), (std::streamsize)vol.image.size());
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#-------------------------------------------------
+# HID Report Compiler, turns a report descriptor into
+# the report tables and structs.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = hid_report_compiler
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += hid_report_compiler.cpp
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
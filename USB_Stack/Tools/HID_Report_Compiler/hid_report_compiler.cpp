@@ -0,0 +1,923 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#define REPORT_INPUT   0
+#define REPORT_OUTPUT  1
+#define REPORT_FEATURE 2
+
+// Item prefixes with the size bits masked off (HID 1.11 6.2.2).
+#define TAG_INPUT          0x80
+#define TAG_OUTPUT         0x90
+#define TAG_FEATURE        0xB0
+#define TAG_COLLECTION     0xA0
+#define TAG_END_COLLECTION 0xC0
+#define TAG_USAGE_PAGE     0x04
+#define TAG_LOGIC_MIN      0x14
+#define TAG_LOGIC_MAX      0x24
+#define TAG_PHYSICAL_MIN   0x34
+#define TAG_PHYSICAL_MAX   0x44
+#define TAG_UNIT_EXPONENT  0x54
+#define TAG_REPORT_SIZE    0x74
+#define TAG_REPORT_ID      0x84
+#define TAG_REPORT_COUNT   0x94
+#define TAG_PUSH           0xA4
+#define TAG_POP            0xB4
+#define TAG_USAGE          0x08
+#define TAG_USAGE_MIN      0x18
+#define TAG_USAGE_MAX      0x28
+
+struct Options
+{
+    std::string spec;
+    std::string out = "usb_hid_reports_gen";
+    std::string usb = "../../USB";
+};
+
+// A macro from usb_hid_report_defines.h, e.g. Logic_Maximum2(x).
+struct ItemDef
+{
+    uint8_t prefix;
+    uint8_t bytes; // Data bytes, 0, 1, 2 or 4.
+};
+
+// Global items, what Push and Pop save.
+struct Globals
+{
+    int32_t  logic_min = 0, logic_max = 0;
+    uint32_t report_size = 0, report_count = 0;
+    uint8_t  report_id = 0;
+    bool     has_size = false, has_count = false;
+};
+
+struct Usage
+{
+    uint32_t    value;
+    std::string symbol; // The argument when it was a single name, e.g. CONSUMER_MUTE.
+};
+
+struct Report
+{
+    int                      type;
+    uint8_t                  id;
+    std::string              name;
+    unsigned                 bits = 0;
+    unsigned                 reserved = 0; // Reserved<n> members so far.
+    unsigned                 data = 0;     // Data<n> members so far.
+    std::vector<std::string> members;
+    std::set<std::string>    names;
+    int                      line = 0;
+};
+
+struct Byte
+{
+    std::vector<uint8_t> bytes;
+    std::string          text;
+};
+
+struct Spec
+{
+    std::map<std::string, int64_t>  constants;
+    std::map<std::string, ItemDef>  items;
+    std::vector<Byte>               descriptor;
+    size_t                          descriptor_size = 0;
+    std::map<std::pair<int, uint8_t>, Report> reports;
+    std::map<uint8_t, std::string>  report_names; // From Report_ID(n) name lines.
+    bool                            uses_ids = false;
+    bool                            data_without_id = false;
+    int                             depth = 0;
+};
+
+static const char *g_type_names[] = {"in", "out", "feature"};
+static const char *g_type_upper[] = {"IN", "OUT", "FEATURE"};
+static const char *g_type_items[] = {"Input", "Output", "Feature"};
+
+static std::string g_spec_path;
+
+static void die(const char *msg, const std::string &what = "")
+{
+    fprintf(stderr, "hid_report_compiler: %s%s%s\n", msg, what.empty() ? "" : ": ", what.c_str());
+    exit(1);
+}
+
+static void die_at(int line, const std::string &msg)
+{
+    fprintf(stderr, "%s:%d: %s\n", g_spec_path.c_str(), line, msg.c_str());
+    exit(1);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  hid_report_compiler <spec> [--out usb_hid_reports_gen] [--usb ../../USB]\n"
+            "Compiles a HID report descriptor, written with the usb_hid_report_defines.h\n"
+            "macros and usb_hid_pages.h names, into the descriptor ROM array, the\n"
+            "report size tables and report structs, <out>.c, and the HID_NUM_ values\n"
+            "and struct definitions, <out>.h. --usb is where the two headers are.\n");
+}
+
+/* ************************************************************************** */
+/* ***************************** EXPRESSIONS ******************************** */
+/* ************************************************************************** */
+
+// A small recursive descent evaluator for the macro arguments: numbers, names
+// from the headers or define lines, ( ), unary - ~ and | & << >> + - * /.
+class Expr
+{
+public:
+    Expr(const Spec &spec, const std::string &text, int line) : spec(spec), s(text), line(line), pos(0) {}
+
+    bool eval(int64_t *val, bool quiet = false)
+    {
+        this->quiet = quiet;
+        failed = false;
+        *val = parse_or();
+        skip();
+        if(!failed && pos != s.size()) error("unexpected '" + s.substr(pos) + "'");
+        return !failed;
+    }
+
+private:
+    void error(const std::string &msg)
+    {
+        if(!failed && !quiet) die_at(line, msg + " in '" + s + "'");
+        failed = true;
+    }
+
+    void skip()
+    {
+        while(pos < s.size() && isspace((unsigned char)s[pos])) pos++;
+    }
+
+    bool take(const char *op)
+    {
+        size_t len = strlen(op);
+        skip();
+        if(s.compare(pos, len, op) != 0) return false;
+        // "<" isn't "<<", and "|" isn't "||".
+        if(len == 1 && pos + 1 < s.size() && s[pos + 1] == op[0] && (op[0] == '|' || op[0] == '&')) return false;
+        pos += len;
+        return true;
+    }
+
+    int64_t parse_or()
+    {
+        int64_t v = parse_and();
+        while(!failed && take("|")) v |= parse_and();
+        return v;
+    }
+
+    int64_t parse_and()
+    {
+        int64_t v = parse_shift();
+        while(!failed && take("&")) v &= parse_shift();
+        return v;
+    }
+
+    int64_t parse_shift()
+    {
+        int64_t v = parse_add();
+        while(!failed)
+        {
+            if(take("<<")) v <<= parse_add();
+            else if(take(">>")) v >>= parse_add();
+            else break;
+        }
+        return v;
+    }
+
+    int64_t parse_add()
+    {
+        int64_t v = parse_mul();
+        while(!failed)
+        {
+            if(take("+")) v += parse_mul();
+            else if(take("-")) v -= parse_mul();
+            else break;
+        }
+        return v;
+    }
+
+    int64_t parse_mul()
+    {
+        int64_t v = parse_unary();
+        while(!failed)
+        {
+            if(take("*")) v *= parse_unary();
+            else if(take("/"))
+            {
+                int64_t d = parse_unary();
+                if(d == 0)
+                {
+                    error("divide by 0");
+                    return 0;
+                }
+                v /= d;
+            }
+            else break;
+        }
+        return v;
+    }
+
+    int64_t parse_unary()
+    {
+        if(take("-")) return -parse_unary();
+        if(take("~")) return ~parse_unary();
+        if(take("("))
+        {
+            int64_t v = parse_or();
+            if(!take(")")) error("missing )");
+            return v;
+        }
+        skip();
+        if(pos < s.size() && isdigit((unsigned char)s[pos]))
+        {
+            char *end;
+            int64_t v = (int64_t)strtoull(s.c_str() + pos, &end, 0);
+            pos = (size_t)(end - s.c_str());
+            while(pos < s.size() && (s[pos] == 'u' || s[pos] == 'U' || s[pos] == 'l' || s[pos] == 'L')) pos++;
+            return v;
+        }
+        if(pos < s.size() && (isalpha((unsigned char)s[pos]) || s[pos] == '_'))
+        {
+            size_t start = pos;
+            while(pos < s.size() && (isalnum((unsigned char)s[pos]) || s[pos] == '_')) pos++;
+            auto it = spec.constants.find(s.substr(start, pos - start));
+            if(it == spec.constants.end())
+            {
+                error("unknown name " + s.substr(start, pos - start));
+                return 0;
+            }
+            return it->second;
+        }
+        error("expected a number");
+        return 0;
+    }
+
+    const Spec       &spec;
+    const std::string s;
+    int               line;
+    size_t            pos;
+    bool              quiet = false;
+    bool              failed = false;
+};
+
+/* ************************************************************************** */
+/* ******************************* HEADERS ********************************** */
+/* ************************************************************************** */
+
+static std::string trim(const std::string &s)
+{
+    size_t a = 0, b = s.size();
+    while(a < b && isspace((unsigned char)s[a])) a++;
+    while(b > a && isspace((unsigned char)s[b - 1])) b--;
+    return s.substr(a, b - a);
+}
+
+static std::string strip_comment(const std::string &s)
+{
+    size_t c = s.find("//");
+    size_t b = s.find("/*");
+    if(b < c) c = b;
+    return c == std::string::npos ? s : s.substr(0, c);
+}
+
+// Reads the #define lines of one of the stack's HID headers. NAME value lines
+// become constants, Name(x) prefix, x... lines become items.
+static void read_header(Spec &spec, const std::string &path)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    char buf[1024];
+
+    if(f == NULL) die("can't open (use --usb)", path);
+    while(fgets(buf, sizeof(buf), f))
+    {
+        std::string text = trim(strip_comment(buf)), name, value;
+        size_t i = 0;
+
+        if(text.compare(0, 7, "#define") != 0) continue;
+        text = trim(text.substr(7));
+        while(i < text.size() && (isalnum((unsigned char)text[i]) || text[i] == '_')) i++;
+        name = text.substr(0, i);
+        value = text.substr(i);
+        if(name.empty()) continue;
+
+        if(!value.empty() && value[0] == '(')
+        {
+            size_t close = value.find(')');
+            std::string body, first;
+            int64_t prefix;
+
+            if(close == std::string::npos) continue;
+            body = trim(value.substr(close + 1));
+            first = trim(body.substr(0, body.find(',')));
+            if(!Expr(spec, first, 0).eval(&prefix, true)) continue;
+            ItemDef def;
+            def.prefix = (uint8_t)prefix;
+            def.bytes = (uint8_t)((prefix & 3) == 3 ? 4 : (prefix & 3));
+            spec.items[name] = def;
+        }
+        else
+        {
+            int64_t val;
+            value = trim(value);
+            if(value.empty() || !Expr(spec, value, 0).eval(&val, true)) continue;
+            spec.constants[name] = val;
+        }
+    }
+    fclose(f);
+}
+
+/* ************************************************************************** */
+/* ******************************* REPORTS ********************************** */
+/* ************************************************************************** */
+
+static bool identifier(const std::string &name)
+{
+    if(name.empty() || isdigit((unsigned char)name[0])) return false;
+    for(char c : name) if(!isalnum((unsigned char)c) && c != '_') return false;
+    return true;
+}
+
+static std::string unique(Report &r, const std::string &name, int line)
+{
+    if(name == "Report_ID" || r.names.count(name)) die_at(line, "two fields named " + name + " in one report");
+    r.names.insert(name);
+    return name;
+}
+
+static void add_padding(Report &r, unsigned bits)
+{
+    while(bits)
+    {
+        unsigned n;
+        if(r.bits % 8 || bits < 8)
+        {
+            n = 8 - r.bits % 8;
+            if(n > bits) n = bits;
+            r.members.push_back("unsigned :" + std::to_string(n) + ";");
+        }
+        else
+        {
+            std::string name = "Reserved" + (r.reserved ? std::to_string(r.reserved) : "");
+            n = bits & ~7u;
+            r.reserved++;
+            if(n == 8) r.members.push_back("uint8_t " + name + ";");
+            else r.members.push_back("uint8_t " + name + "[" + std::to_string(n / 8) + "];");
+            r.names.insert(name);
+        }
+        r.bits += n;
+        bits -= n;
+    }
+}
+
+// One C member for count fields of size bits, the type picked by where the
+// field lands in the report.
+static void add_member(Report &r, const std::string &name, unsigned size, unsigned count, bool is_signed,
+                       unsigned first, int line)
+{
+    bool aligned = r.bits % 8 == 0;
+    std::string dim = count > 1 ? "[" + std::to_string(count) + "]" : "";
+
+    if(aligned && (size == 8 || size == 16 || size == 32))
+    {
+        r.members.push_back(std::string(is_signed ? "int" : "uint") + std::to_string(size) + "_t " +
+                            unique(r, name, line) + dim + ";");
+    }
+    else if(aligned && size == 1 && count % 8 == 0)
+    {
+        // A bitmap, e.g. one bit per key.
+        if(count == 8) r.members.push_back("uint8_t " + unique(r, name, line) + "; // 8 one bit fields.");
+        else r.members.push_back("uint8_t " + unique(r, name, line) + "[" + std::to_string(count / 8) + "]; // " +
+                                 std::to_string(count) + " bits, bit (n & 7) of " + name + "[n >> 3].");
+    }
+    else if(size < 8)
+    {
+        for(unsigned i = 0; i < count; i++)
+        {
+            if(r.bits % 8 + size > 8)
+            {
+                die_at(line, std::to_string(size) + " bit field at bit " + std::to_string(r.bits) +
+                       " would straddle a byte, XC8 bit-fields can't, add a Constant item to move it");
+            }
+            std::string n = count > 1 ? name + std::to_string(first + i) : name;
+            r.members.push_back(std::string(is_signed ? "signed " : "unsigned ") + unique(r, n, line) + " :" +
+                                std::to_string(size) + ";");
+            r.bits += size;
+        }
+        return;
+    }
+    else if(aligned && (size * count) % 8 == 0)
+    {
+        r.members.push_back("uint8_t " + unique(r, name, line) + "[" + std::to_string(size * count / 8) + "]; // " +
+                            std::to_string(count) + " x " + std::to_string(size) + " bits, packed.");
+    }
+    else
+    {
+        die_at(line, std::to_string(size) + " bit field at bit " + std::to_string(r.bits) +
+               " isn't a C type, add a Constant item to start it on a byte");
+    }
+    r.bits += size * count;
+}
+
+static Report &report(Spec &spec, int type, const Globals &g, int line)
+{
+    auto key = std::make_pair(type, g.report_id);
+    auto it = spec.reports.find(key);
+
+    if(it == spec.reports.end())
+    {
+        Report r;
+        r.type = type;
+        r.id = g.report_id;
+        r.bits = g.report_id ? 8 : 0; // The Report_ID byte.
+        it = spec.reports.insert(std::make_pair(key, r)).first;
+    }
+    it->second.line = line;
+    return it->second;
+}
+
+static void main_item(Spec &spec, int type, int64_t flags, const Globals &g, const std::vector<Usage> &usages,
+                      const std::string &name, int line)
+{
+    unsigned size = g.report_size, count = g.report_count;
+    bool is_signed = g.logic_min < 0;
+
+    if(!g.has_size || !g.has_count) die_at(line, "Report_Size and Report_Count come before the first main item");
+    if(size == 0 || count == 0) return;
+    if(size > 32) die_at(line, "Report_Size over 32 bits");
+    if(g.report_id == 0) spec.data_without_id = true;
+    if(spec.uses_ids && g.report_id == 0) die_at(line, "main item without a Report_ID, every report needs one once any has");
+
+    Report &r = report(spec, type, g, line);
+
+    if(flags & 0x01) // Constant.
+    {
+        if(!name.empty()) die_at(line, "Constant items are padding, they don't take a name");
+        add_padding(r, size * count);
+        return;
+    }
+    if(!name.empty() && !identifier(name)) die_at(line, "not a C name: " + name);
+
+    bool named_usages = usages.size() == count && count > 1;
+    for(const Usage &u : usages) if(u.symbol.empty()) named_usages = false;
+    if(!(flags & 0x02)) named_usages = false; // Array items hold usage values, not one field per usage.
+
+    if(named_usages && !name.empty() && size == 1 && count == 8 && r.bits % 8 == 0)
+    {
+        // The byte and its bits, like the hand written report structs.
+        std::string m = "union\n    {\n        uint8_t " + unique(r, name, line) + ";\n        struct\n        {\n";
+        for(const Usage &u : usages) m += "            unsigned " + unique(r, u.symbol, line) + " :1;\n";
+        m += "        };\n    };";
+        r.members.push_back(m);
+        r.bits += 8;
+    }
+    else if(named_usages && name.empty())
+    {
+        for(const Usage &u : usages) add_member(r, u.symbol, size, 1, is_signed, 0, line);
+    }
+    else
+    {
+        std::string n = name;
+        unsigned first = 0;
+        if(n.empty()) n = "Data" + std::to_string(r.data++);
+        if(usages.size() == 1 && usages[0].symbol.empty() && usages[0].value < 0x10000) first = usages[0].value;
+        add_member(r, n, size, count, is_signed, first, line);
+    }
+}
+
+/* ************************************************************************** */
+/* ******************************* PARSING ********************************** */
+/* ************************************************************************** */
+
+static void check_range(const ItemDef &def, int64_t val, bool is_signed, const std::string &text, int line)
+{
+    int64_t lo, hi;
+
+    if(def.bytes == 4) return;
+    if(is_signed)
+    {
+        hi = def.bytes == 1 ? 127 : 32767;
+        lo = -hi - 1;
+    }
+    else
+    {
+        hi = def.bytes == 1 ? 255 : 65535;
+        lo = 0;
+    }
+    if(val < lo || val > hi)
+    {
+        std::string more = is_signed && val > hi && val <= hi * 2 + 1 ? ", the host reads it as negative" : "";
+        die_at(line, text + " doesn't fit in " + std::to_string(def.bytes) + " byte(s)" + more +
+               ", use the 2 or 4 byte form");
+    }
+}
+
+static void add_item(Spec &spec, const std::string &macro, const std::string &arg, const std::string &name,
+                     std::vector<Globals> &stack, std::vector<Usage> &usages, int line)
+{
+    auto it = spec.items.find(macro);
+    std::string text = macro + "(" + arg + ")";
+    int64_t val = 0;
+    Globals &g = stack.back();
+    Byte b;
+
+    if(it == spec.items.end()) die_at(line, "not a usb_hid_report_defines.h item: " + macro);
+    const ItemDef &def = it->second;
+    uint8_t tag = def.prefix & 0xFC;
+    bool is_signed = tag == TAG_LOGIC_MIN || tag == TAG_LOGIC_MAX || tag == TAG_PHYSICAL_MIN ||
+                     tag == TAG_PHYSICAL_MAX || tag == TAG_UNIT_EXPONENT;
+
+    if(def.bytes)
+    {
+        if(trim(arg).empty()) die_at(line, macro + " needs a value");
+        Expr(spec, arg, line).eval(&val);
+        check_range(def, val, is_signed, text, line);
+    }
+    else if(!trim(arg).empty()) die_at(line, macro + " doesn't take a value");
+
+    bool is_main = tag == TAG_INPUT || tag == TAG_OUTPUT || tag == TAG_FEATURE;
+    if(!name.empty() && !is_main && tag != TAG_REPORT_ID) die_at(line, "only Input, Output, Feature and Report_ID take a name");
+
+    b.bytes.push_back(def.prefix);
+    for(unsigned i = 0; i < def.bytes; i++) b.bytes.push_back((uint8_t)(val >> (8 * i)));
+    b.text = text + (name.empty() ? "" : " " + name);
+    spec.descriptor_size += b.bytes.size();
+    spec.descriptor.push_back(b);
+
+    switch(tag)
+    {
+        case TAG_LOGIC_MIN:    g.logic_min = (int32_t)val; break;
+        case TAG_LOGIC_MAX:    g.logic_max = (int32_t)val; break;
+        case TAG_REPORT_SIZE:  g.report_size = (uint32_t)val; g.has_size = true; break;
+        case TAG_REPORT_COUNT: g.report_count = (uint32_t)val; g.has_count = true; break;
+        case TAG_REPORT_ID:
+            if(val == 0) die_at(line, "Report_ID 0 is reserved");
+            if(spec.data_without_id) die_at(line, "Report_ID after main items without one");
+            g.report_id = (uint8_t)val;
+            spec.uses_ids = true;
+            if(!name.empty())
+            {
+                if(!identifier(name)) die_at(line, "not a C name: " + name);
+                spec.report_names[g.report_id] = name;
+            }
+            break;
+        case TAG_PUSH: stack.push_back(g); break;
+        case TAG_POP:
+            if(stack.size() < 2) die_at(line, "Pop without a Push");
+            stack.pop_back();
+            break;
+        case TAG_USAGE:
+        {
+            Usage u;
+            u.value = (uint32_t)val;
+            if(identifier(trim(arg)) && !isdigit((unsigned char)trim(arg)[0])) u.symbol = trim(arg);
+            usages.push_back(u);
+            break;
+        }
+        case TAG_USAGE_MIN:
+        {
+            Usage u;
+            u.value = (uint32_t)val;
+            usages.push_back(u);
+            break;
+        }
+        case TAG_COLLECTION: spec.depth++; break;
+        case TAG_END_COLLECTION:
+            if(spec.depth == 0) die_at(line, "End_Collection without a Collection");
+            spec.depth--;
+            break;
+        default: break;
+    }
+
+    if(is_main)
+    {
+        int type = tag == TAG_INPUT ? REPORT_INPUT : tag == TAG_OUTPUT ? REPORT_OUTPUT : REPORT_FEATURE;
+        if(g.logic_max < g.logic_min) die_at(line, "Logic_Maximum is less than Logic_Minimum");
+        main_item(spec, type, val, g, usages, name, line);
+    }
+    if(is_main || tag == TAG_COLLECTION || tag == TAG_END_COLLECTION) usages.clear();
+}
+
+// Each line holds items written the way they are in a usb_descriptors.c
+// array, Name(value), with an optional trailing comma. A C name after an
+// Input, Output, Feature or Report_ID names the field or the report.
+static void parse(Spec &spec, const std::string &path)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    std::vector<Globals> stack(1);
+    std::vector<Usage> usages;
+    char buf[1024];
+    int line = 0;
+
+    if(f == NULL) die("can't open", path);
+    while(fgets(buf, sizeof(buf), f))
+    {
+        std::string text = trim(strip_comment(buf));
+        size_t pos = 0;
+
+        line++;
+        if(!text.empty() && text[0] == '#')
+        {
+            static const char *pp[] = {"#if", "#else", "#elif", "#endif", "#define", "#include", "#undef"};
+            for(const char *p : pp)
+            {
+                if(text.compare(0, strlen(p), p) == 0) die_at(line, "preprocessor lines aren't read, use define NAME value and one branch");
+            }
+            continue;
+        }
+        if(text.find('#') != std::string::npos) text = trim(text.substr(0, text.find('#')));
+
+        if(text.compare(0, 7, "define ") == 0)
+        {
+            std::string rest = trim(text.substr(7));
+            size_t sp = 0;
+            int64_t val;
+            while(sp < rest.size() && !isspace((unsigned char)rest[sp])) sp++;
+            if(!identifier(rest.substr(0, sp))) die_at(line, "define NAME value");
+            Expr(spec, trim(rest.substr(sp)), line).eval(&val);
+            spec.constants[rest.substr(0, sp)] = val;
+            continue;
+        }
+
+        while(pos < text.size())
+        {
+            std::string macro, arg, name;
+            size_t start = pos;
+            int depth = 0;
+
+            while(pos < text.size() && (isalnum((unsigned char)text[pos]) || text[pos] == '_')) pos++;
+            macro = text.substr(start, pos - start);
+            while(pos < text.size() && isspace((unsigned char)text[pos])) pos++;
+            if(macro.empty() || pos >= text.size() || text[pos] != '(') die_at(line, "expected Item(value): " + text.substr(start));
+            start = ++pos;
+            for(depth = 1; pos < text.size() && depth; pos++)
+            {
+                if(text[pos] == '(') depth++;
+                else if(text[pos] == ')') depth--;
+            }
+            if(depth) die_at(line, "missing )");
+            arg = text.substr(start, pos - start - 1);
+
+            while(pos < text.size() && (isspace((unsigned char)text[pos]) || text[pos] == ',')) pos++;
+            // A name is a word that isn't followed by (.
+            start = pos;
+            while(pos < text.size() && (isalnum((unsigned char)text[pos]) || text[pos] == '_')) pos++;
+            if(pos > start)
+            {
+                size_t after = pos;
+                while(after < text.size() && isspace((unsigned char)text[after])) after++;
+                if(after < text.size() && text[after] == '(') pos = start;
+                else name = text.substr(start, pos - start);
+            }
+            while(pos < text.size() && (isspace((unsigned char)text[pos]) || text[pos] == ',')) pos++;
+
+            add_item(spec, macro, arg, name, stack, usages, line);
+        }
+    }
+    fclose(f);
+    if(spec.depth) die_at(line, "Collection without an End_Collection");
+
+    for(auto &r : spec.reports)
+    {
+        auto name = spec.report_names.find(r.second.id);
+        if(name != spec.report_names.end()) r.second.name = name->second;
+    }
+
+    // usb_hid.c finds report N of each type at Report_ID N + 1.
+    for(int t = 0; t < 3; t++)
+    {
+        unsigned n = 0;
+        for(auto &r : spec.reports)
+        {
+            if(r.first.first != t) continue;
+            if(r.second.bits % 8)
+            {
+                die_at(r.second.line, std::string(g_type_items[t]) + " report" +
+                       (r.second.id ? " " + std::to_string(r.second.id) : "") + " is " + std::to_string(r.second.bits) +
+                       " bits, pad it to a whole byte with a Constant item");
+            }
+            if(spec.uses_ids && r.second.id != n + 1)
+            {
+                die_at(r.second.line, std::string(g_type_items[t]) + " Report_IDs have to be 1, 2, 3... in order " +
+                       "(usb_hid.c indexes reports by Report_ID - 1), found " + std::to_string(r.second.id) +
+                       (n ? " after " + std::to_string(n) : " first"));
+            }
+            n++;
+        }
+    }
+}
+
+/* ************************************************************************** */
+/* ******************************** OUTPUT ********************************** */
+/* ************************************************************************** */
+
+static std::string base_name(const std::string &path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static void define(FILE *f, const std::string &name, unsigned val, const std::string &comment = "")
+{
+    fprintf(f, "#define %-26s %u%s%s\n", name.c_str(), val, comment.empty() ? "" : " // ", comment.c_str());
+}
+
+static std::vector<const Report*> reports_of(const Spec &spec, int type)
+{
+    std::vector<const Report*> list;
+    for(auto &r : spec.reports) if(r.first.first == type) list.push_back(&r.second);
+    return list;
+}
+
+static std::string struct_name(int type, size_t i)
+{
+    return "hid_" + std::string(g_type_names[type]) + "_report" + std::to_string(i + 1) + "_t";
+}
+
+static std::string var_name(int type, size_t i)
+{
+    return "g_hid_" + std::string(g_type_names[type]) + "_report" + std::to_string(i + 1);
+}
+
+static void write_h(const Spec &spec, const Options &opt)
+{
+    std::string base = base_name(opt.out), guard;
+    FILE *f = fopen((opt.out + ".h").c_str(), "w");
+    unsigned max_id = 0;
+
+    if(f == NULL) die("can't write", opt.out + ".h");
+    for(char c : base) guard += isalnum((unsigned char)c) ? (char)toupper((unsigned char)c) : '_';
+    guard += "_H";
+    for(auto &r : spec.reports) if(r.second.id > max_id) max_id = r.second.id;
+
+    fprintf(f, "// Generated by Tools/HID_Report_Compiler from %s, don't edit.\n", base_name(g_spec_path).c_str());
+    fprintf(f, "// Include it from usb_hid_config.h in place of the hand written report counts,\n");
+    fprintf(f, "// and from usb_hid_reports.h in place of the report structs.\n\n");
+    fprintf(f, "#ifndef %s\n#define %s\n\n#include <stdint.h>\n\n", guard.c_str(), guard.c_str());
+
+    fprintf(f, "/* NUMBER OF REPORTS */\n");
+    for(int t = 0; t < 3; t++) define(f, "HID_NUM_" + std::string(g_type_upper[t]) + "_REPORTS", (unsigned)reports_of(spec, t).size());
+    define(f, "HID_USE_REPORT_IDS", spec.uses_ids ? 1 : 0);
+    define(f, "HID_NUM_REPORT_IDS", max_id);
+    define(f, "HID_REPORT_DESCRIPTOR_SIZE", (unsigned)spec.descriptor_size, "For the HID descriptor's wDescriptorLength.");
+    fprintf(f, "\n");
+
+    fprintf(f, "/* REPORT SIZES, Report_ID included */\n");
+    for(int t = 0; t < 3; t++)
+    {
+        auto list = reports_of(spec, t);
+        unsigned max = 0;
+        if(list.empty()) continue;
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            unsigned bytes = list[i]->bits / 8;
+            if(bytes > max) max = bytes;
+            define(f, "HID_" + std::string(g_type_upper[t]) + "_REPORT" + std::to_string(i) + "_SIZE", bytes);
+        }
+        define(f, "HID_" + std::string(g_type_upper[t]) + "_REPORT_MAX_SIZE", max);
+    }
+    fprintf(f, "\n");
+
+    bool named = false;
+    for(auto &r : spec.reports) if(!r.second.name.empty()) named = true;
+    if(named)
+    {
+        fprintf(f, "/* REPORT NUMBERS, for hid_send_report(), hid_out() and hid_set_feature() */\n");
+        for(int t = 0; t < 3; t++)
+        {
+            auto list = reports_of(spec, t);
+            for(size_t i = 0; i < list.size(); i++)
+            {
+                if(list[i]->name.empty()) continue;
+                std::string upper;
+                for(char c : list[i]->name) upper += (char)toupper((unsigned char)c);
+                define(f, "HID_" + std::string(g_type_upper[t]) + "_REPORT_" + upper, (unsigned)i,
+                       "Report_ID " + std::to_string(list[i]->id));
+            }
+        }
+        fprintf(f, "\n");
+    }
+
+    for(int t = 0; t < 3; t++)
+    {
+        auto list = reports_of(spec, t);
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            fprintf(f, "typedef struct\n{\n");
+            if(list[i]->id) fprintf(f, "    uint8_t Report_ID;\n");
+            for(const std::string &m : list[i]->members) fprintf(f, "    %s\n", m.c_str());
+            fprintf(f, "}%s;\n\n", struct_name(t, i).c_str());
+        }
+    }
+
+    for(int t = 0; t < 3; t++)
+    {
+        auto list = reports_of(spec, t);
+        if(list.empty()) continue;
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            fprintf(f, "extern volatile %-24s %s;\n", struct_name(t, i).c_str(), var_name(t, i).c_str());
+        }
+        fprintf(f, "extern const    %-24s g_hid_%s_reports[];\n", "uint16_t", g_type_names[t]);
+        fprintf(f, "extern const    %-24s g_hid_%s_report_size[];\n\n", "uint8_t", g_type_names[t]);
+    }
+    fprintf(f, "#endif /* %s */\n", guard.c_str());
+    fclose(f);
+}
+
+static void write_c(const Spec &spec, const Options &opt)
+{
+    FILE *f = fopen((opt.out + ".c").c_str(), "w");
+    size_t n = 0;
+
+    if(f == NULL) die("can't write", opt.out + ".c");
+    fprintf(f, "// Generated by Tools/HID_Report_Compiler from %s, don't edit.\n", base_name(g_spec_path).c_str());
+    fprintf(f, "// %u report(s), %u bytes of report descriptor.\n\n", (unsigned)spec.reports.size(), (unsigned)spec.descriptor_size);
+    fprintf(f, "#include <stdint.h>\n#include \"%s.h\"\n\n", base_name(opt.out).c_str());
+
+    fprintf(f, "/** Report Descriptor */\n");
+    fprintf(f, "const uint8_t g_hid_report_descriptor[%u] =\n{\n", (unsigned)spec.descriptor_size);
+    for(const Byte &b : spec.descriptor)
+    {
+        std::string bytes;
+        char hex[8];
+        for(uint8_t v : b.bytes)
+        {
+            n++;
+            snprintf(hex, sizeof(hex), "0x%02X%s", v, n < spec.descriptor_size ? ", " : "");
+            bytes += hex;
+        }
+        fprintf(f, "    %-30s // %s\n", bytes.c_str(), b.text.c_str());
+    }
+    fprintf(f, "};\n\n");
+    fprintf(f, "const uint16_t g_hid_report_descriptor_size = sizeof(g_hid_report_descriptor);\n\n");
+
+    for(int t = 0; t < 3; t++)
+    {
+        auto list = reports_of(spec, t);
+        if(list.empty()) continue;
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            if(list[i]->id) fprintf(f, "volatile %s %s = {%u};\n", struct_name(t, i).c_str(), var_name(t, i).c_str(), list[i]->id);
+            else fprintf(f, "volatile %s %s;\n", struct_name(t, i).c_str(), var_name(t, i).c_str());
+        }
+        fprintf(f, "\nconst uint16_t g_hid_%s_reports[] =\n{\n", g_type_names[t]);
+        for(size_t i = 0; i < list.size(); i++) fprintf(f, "    (uint16_t)&%s%s\n", var_name(t, i).c_str(), i + 1 < list.size() ? "," : "");
+        fprintf(f, "};\n\nconst uint8_t g_hid_%s_report_size[] =\n{\n", g_type_names[t]);
+        for(size_t i = 0; i < list.size(); i++) fprintf(f, "    sizeof(%s)%s\n", var_name(t, i).c_str(), i + 1 < list.size() ? "," : "");
+        fprintf(f, "};\n\n");
+        // Fails to compile if the compiler laid a struct out differently to the descriptor.
+        for(size_t i = 0; i < list.size(); i++)
+        {
+            fprintf(f, "typedef char %s_check[(sizeof(%s) == HID_%s_REPORT%u_SIZE) ? 1 : -1];\n",
+                    struct_name(t, i).substr(0, struct_name(t, i).size() - 2).c_str(), struct_name(t, i).c_str(),
+                    g_type_upper[t], (unsigned)i);
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    Spec    spec;
+
+    if(argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    opt.spec = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--out" && has_value) opt.out = argv[++i];
+        else if(arg == "--usb" && has_value) opt.usb = argv[++i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    g_spec_path = opt.spec;
+
+    read_header(spec, opt.usb + "/usb_hid_report_defines.h");
+    read_header(spec, opt.usb + "/usb_hid_pages.h");
+    if(spec.items.empty()) die("no items in", opt.usb + "/usb_hid_report_defines.h");
+    parse(spec, opt.spec);
+    write_h(spec, opt);
+    write_c(spec, opt);
+    return 0;
+}
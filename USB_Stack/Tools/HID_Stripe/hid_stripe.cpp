@@ -0,0 +1,194 @@
+#include "hid_stripe.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#define READER_POLL_MS 100
+
+HidStripe::HidStripe()
+{
+    running = false;
+    read_failed = false;
+    out_seq = 0;
+    out_ch = 0;
+    in_seq = 0;
+    partial_pos = 0;
+}
+
+HidStripe::~HidStripe()
+{
+    close();
+}
+
+bool HidStripe::open(uint16_t vid, uint16_t pid)
+{
+    std::vector<std::pair<int, std::string> > paths;
+    struct hid_device_info *devices, *cur;
+
+    close();
+    devices = hid_enumerate(vid, pid);
+    for(cur = devices; cur != NULL; cur = cur->next) paths.push_back(std::make_pair(cur->interface_number, std::string(cur->path)));
+    hid_free_enumeration(devices);
+    std::sort(paths.begin(), paths.end());
+
+    for(size_t i = 0; i < paths.size(); i++)
+    {
+        hid_device *dev = hid_open_path(paths[i].second.c_str());
+
+        if(dev == NULL)
+        {
+            fprintf(stderr, "hid_stripe: can't open interface %d of %04x:%04x\n", paths[i].first, vid, pid);
+            close();
+            return false;
+        }
+        devs.push_back(dev);
+    }
+    if(devs.empty()) return false;
+
+    restart();
+    running = true;
+    for(size_t ch = 0; ch < devs.size(); ch++) readers.push_back(std::thread(&HidStripe::reader, this, ch));
+    return true;
+}
+
+void HidStripe::close()
+{
+    running = false;
+    for(size_t i = 0; i < readers.size(); i++) readers[i].join();
+    readers.clear();
+    for(size_t i = 0; i < devs.size(); i++) hid_close(devs[i]);
+    devs.clear();
+    read_failed = false;
+}
+
+bool HidStripe::write(const uint8_t *data, size_t len)
+{
+    std::vector<std::vector<uint8_t> > reports(devs.size());
+    std::vector<std::thread> writers;
+    std::vector<int> failed(devs.size(), 0);
+    uint8_t report[HID_STRIPE_REPORT_SIZE + 1];   // Report ID + report
+
+    if(devs.empty()) return false;
+
+    // Each channel gets its reports in seq order, the firmware takes the next
+    // seq from the front of whichever channel has it.
+    while(len)
+    {
+        size_t cnt = std::min(len, (size_t)HID_STRIPE_PAYLOAD_SIZE);
+
+        memset(report, 0, sizeof(report));
+        report[0] = 0;     // The reports don't use IDs.
+        report[1] = (uint8_t)out_seq;
+        report[2] = (uint8_t)(out_seq >> 8);
+        report[3] = (uint8_t)cnt;
+        memcpy(&report[1 + HID_STRIPE_HEADER_SIZE], data, cnt);
+        reports[out_ch].insert(reports[out_ch].end(), report, report + sizeof(report));
+
+        data += cnt;
+        len -= cnt;
+        out_seq++;
+        if(++out_ch == devs.size()) out_ch = 0;
+    }
+
+    for(size_t ch = 0; ch < devs.size(); ch++)
+    {
+        if(reports[ch].empty()) continue;
+        writers.push_back(std::thread([this, ch, &reports, &failed]()
+        {
+            for(size_t pos = 0; pos < reports[ch].size(); pos += HID_STRIPE_REPORT_SIZE + 1)
+            {
+                if(hid_write(devs[ch], &reports[ch][pos], HID_STRIPE_REPORT_SIZE + 1) < 0)
+                {
+                    failed[ch] = 1;
+                    return;
+                }
+            }
+        }));
+    }
+    for(size_t i = 0; i < writers.size(); i++) writers[i].join();
+
+    for(size_t ch = 0; ch < devs.size(); ch++)
+    {
+        if(failed[ch])
+        {
+            fprintf(stderr, "hid_stripe: write failed on channel %u\n", (unsigned)ch);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HidStripe::read(uint8_t *data, size_t len, int timeout_ms)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while(len)
+    {
+        if(partial_pos < partial.size())
+        {
+            size_t cnt = std::min(len, partial.size() - partial_pos);
+
+            memcpy(data, &partial[partial_pos], cnt);
+            partial_pos += cnt;
+            data += cnt;
+            len -= cnt;
+            continue;
+        }
+
+        std::map<uint16_t, std::vector<uint8_t> >::iterator it = pending.find(in_seq);
+        if(it == pending.end())
+        {
+            if(!arrived.wait_for(guard, std::chrono::milliseconds(timeout_ms), [this]() { return read_failed || pending.count(in_seq) != 0; })) return false;
+            if(read_failed) return false;
+            continue;
+        }
+        partial.swap(it->second);
+        partial_pos = 0;
+        pending.erase(it);
+        in_seq++;
+    }
+    return true;
+}
+
+void HidStripe::restart()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    out_seq = 0;
+    out_ch = 0;
+    in_seq = 0;
+    pending.clear();
+    partial.clear();
+    partial_pos = 0;
+}
+
+void HidStripe::reader(size_t ch)
+{
+    uint8_t report[HID_STRIPE_REPORT_SIZE];
+
+    while(running)
+    {
+        int n = hid_read_timeout(devs[ch], report, sizeof(report), READER_POLL_MS);
+        uint16_t seq;
+        size_t cnt;
+
+        if(n < 0)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            read_failed = true;
+            arrived.notify_all();
+            return;
+        }
+        if(n < HID_STRIPE_HEADER_SIZE) continue;
+
+        seq = report[0] | ((uint16_t)report[1] << 8);
+        cnt = std::min((size_t)report[2], (size_t)(n - HID_STRIPE_HEADER_SIZE));
+
+        std::lock_guard<std::mutex> guard(lock);
+        pending[seq].assign(&report[HID_STRIPE_HEADER_SIZE], &report[HID_STRIPE_HEADER_SIZE] + cnt);
+        arrived.notify_all();
+    }
+}
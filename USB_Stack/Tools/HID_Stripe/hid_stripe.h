@@ -0,0 +1,66 @@
+#ifndef HID_STRIPE_H
+#define HID_STRIPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "hidapi.h"
+
+// Report layout shared with the HID Stream firmware: [seq LSB][seq MSB][length][payload].
+#define HID_STRIPE_REPORT_SIZE  64
+#define HID_STRIPE_HEADER_SIZE  3
+#define HID_STRIPE_PAYLOAD_SIZE (HID_STRIPE_REPORT_SIZE - HID_STRIPE_HEADER_SIZE)
+
+// Moves one byte stream over every HID interface of a HID Stream device. Each
+// interface is opened as its own hid_device, OUT reports are striped across them
+// round-robin in seq order, and IN reports are put back in seq order. Each channel carries one report per direction per frame,
+// so the throughput scales with the number of interfaces.
+class HidStripe
+{
+public:
+    HidStripe();
+    ~HidStripe();
+
+    // Opens every interface of vid:pid, ordered by interface number, and starts a
+    // reader thread on each. hid_init() must have been called.
+    bool open(uint16_t vid, uint16_t pid);
+    void close();
+    size_t channels() const { return devs.size(); }
+
+    // Sends len bytes, one writer thread per channel. Returns false if a write failed.
+    bool write(const uint8_t *data, size_t len);
+
+    // Reads len bytes of the IN stream in order. Returns false if a report doesn't
+    // arrive within timeout_ms, or a reader failed.
+    bool read(uint8_t *data, size_t len, int timeout_ms);
+
+    // Both directions start again from seq 0, the firmware restarts its IN seq
+    // when it receives OUT seq 0.
+    void restart();
+
+private:
+    void reader(size_t ch);
+
+    std::vector<hid_device*> devs;
+    std::vector<std::thread> readers;
+    std::atomic<bool>        running;
+    uint16_t                 out_seq;
+    size_t                   out_ch;  // Channel of the next OUT report.
+
+    // Reorder buffer, IN payloads wait here by seq until in_seq reaches them.
+    std::mutex                               lock;
+    std::condition_variable                  arrived;
+    std::map<uint16_t, std::vector<uint8_t>> pending;
+    uint16_t                                 in_seq;
+    bool                                     read_failed;
+    std::vector<uint8_t>                     partial;     // Payload read() has only taken part of.
+    size_t                                   partial_pos;
+};
+
+#endif // HID_STRIPE_H
@@ -0,0 +1,31 @@
+#-------------------------------------------------
+# MSD Flasher, programs MSD_Internal_Example
+# drives in parallel from a HEX file.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = msd_flasher
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG += thread
+
+SOURCES += msd_flasher.cpp
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
@@ -0,0 +1,602 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef __APPLE__
+#include <sys/disk.h>
+#else
+#include <linux/fs.h>
+#include <scsi/sg.h>
+#endif
+#endif
+
+#define SECTOR_SIZE 512
+#define ALIGNMENT   4096
+#define MAX_DISK    (16UL * 1024 * 1024) // Anything bigger isn't one of ours without --force.
+
+// SCSI opcodes for --device-verify, MSD_IMAGE_CRC_CMD is from usb_msd.h.
+#define VERIFY_10           0x2F
+#define MSD_IMAGE_CRC_CMD   0xC0
+#define MSD_IMAGE_CRC_RESET 0x01
+
+struct Options
+{
+    std::string              hex;
+    std::vector<std::string> devices;
+    uint32_t                 base = 0x2000;   // FLASH_SPACE_START, LBA 0.
+    uint32_t                 end = 0x20000;   // END_OF_FLASH or above, config words are past it.
+    uint32_t                 chunk = 65536;   // Bytes per write/read.
+    uint16_t                 vid = 0x04D8;
+    uint16_t                 pid = 0x0009;
+    unsigned                 jobs = 0;        // 0 is one per drive.
+    unsigned                 count = 0;       // Drives to wait for with --all.
+    bool                     all = false;
+    bool                     verify = true;
+    bool                     device_verify = false; // VERIFY_10 and MSD_IMAGE_CRC_CMD, no read back.
+    bool                     force = false;
+};
+
+// A run of whole sectors the HEX file touches, as offsets on the disk.
+struct Run
+{
+    uint64_t offset;
+    uint32_t bytes;
+};
+
+// The disk image the HEX file describes. Bytes the file doesn't set are 0xFF,
+// what the flash holds once it's been programmed with it.
+struct Image
+{
+    std::vector<uint8_t> data;
+    std::vector<bool>    touched; // Per sector.
+    std::vector<Run>     runs;
+};
+
+struct Result
+{
+    std::string device;
+    bool        ok;
+    std::string error;
+    double      seconds;
+};
+
+static void die(const char *msg, const std::string &what = "")
+{
+    fprintf(stderr, "msd_flasher: %s%s%s\n", msg, what.empty() ? "" : ": ", what.c_str());
+    exit(1);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  msd_flasher <file.hex> <device>... [--base 0x2000] [--end 0x20000] [--jobs N]\n"
+            "              [--chunk 65536] [--no-verify | --device-verify] [--force]\n"
+            "  msd_flasher <file.hex> --all [--vid 04d8] [--pid 0009] [--count N] ...\n"
+            "Writes the sectors <file.hex> covers straight to every MSD_Internal_Example\n"
+            "drive in parallel, then reads them back (--device-verify has the drive\n"
+            "check them itself, Linux). --base is the flash address of LBA 0 and --end\n"
+            "where the flash space ends. --all finds the drives by VID/PID (Linux),\n"
+            "--count waits for N of them. The drives must not be mounted.\n");
+}
+
+static uint32_t hex_byte(const std::string &line, size_t pos, bool *ok)
+{
+    char s[3] = {0, 0, 0};
+    char *end;
+    uint32_t val;
+
+    if(pos + 2 > line.size())
+    {
+        *ok = false;
+        return 0;
+    }
+    s[0] = line[pos];
+    s[1] = line[pos + 1];
+    val = (uint32_t)strtoul(s, &end, 16);
+    if(*end != '\0') *ok = false;
+    return val;
+}
+
+// Intel HEX to a disk image. Records outside the flash space (config words,
+// EEPROM, the code below --base) aren't part of the disk and are skipped.
+static void load_hex(const Options &opt, Image &img)
+{
+    std::ifstream f(opt.hex);
+    std::string   line;
+    uint32_t      upper = 0;
+    uint32_t      line_no = 0;
+    uint32_t      skipped = 0;
+    bool          done = false;
+
+    if(!f) die("can't open", opt.hex);
+    while(!done && std::getline(f, line))
+    {
+        uint32_t len, addr, type, sum;
+        bool ok = true;
+
+        line_no++;
+        while(!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if(line.empty()) continue;
+        if(line[0] != ':') die("not an Intel HEX record on line", std::to_string(line_no));
+
+        len  = hex_byte(line, 1, &ok);
+        addr = (hex_byte(line, 3, &ok) << 8) | hex_byte(line, 5, &ok);
+        type = hex_byte(line, 7, &ok);
+        sum  = len + (addr >> 8) + (addr & 0xFF) + type;
+        for(uint32_t i = 0; i <= len; i++) sum += hex_byte(line, 9 + i * 2, &ok);
+        if(!ok) die("bad HEX record on line", std::to_string(line_no));
+        if(sum & 0xFF) die("checksum error on line", std::to_string(line_no));
+
+        switch(type)
+        {
+            case 0x00:
+                for(uint32_t i = 0; i < len; i++)
+                {
+                    uint32_t flash = upper + addr + i;
+                    uint64_t offset;
+
+                    if(flash < opt.base || flash >= opt.end)
+                    {
+                        skipped++;
+                        continue;
+                    }
+                    offset = flash - opt.base;
+                    if(offset >= img.data.size())
+                    {
+                        size_t sects = (size_t)(offset / SECTOR_SIZE) + 1;
+                        img.data.resize(sects * SECTOR_SIZE, 0xFF);
+                        img.touched.resize(sects, false);
+                    }
+                    img.data[offset] = (uint8_t)hex_byte(line, 9 + i * 2, &ok);
+                    img.touched[offset / SECTOR_SIZE] = true;
+                }
+                break;
+            case 0x01:
+                done = true;
+                break;
+            case 0x02:
+                upper = ((hex_byte(line, 9, &ok) << 8) | hex_byte(line, 11, &ok)) << 4;
+                break;
+            case 0x04:
+                upper = ((hex_byte(line, 9, &ok) << 8) | hex_byte(line, 11, &ok)) << 16;
+                break;
+            default: // 03 and 05 are start addresses, nothing to write.
+                break;
+        }
+    }
+    if(img.data.empty()) die("nothing in the flash space, check --base", opt.hex);
+    if(skipped) printf("%u bytes outside the flash space skipped\n", skipped);
+
+    // Consecutive touched sectors are written together, a run never crosses
+    // a chunk boundary so every transfer stays aligned.
+    for(size_t s = 0; s < img.touched.size(); s++)
+    {
+        uint64_t offset = (uint64_t)s * SECTOR_SIZE;
+
+        if(!img.touched[s]) continue;
+        if(!img.runs.empty() && img.runs.back().offset + img.runs.back().bytes == offset &&
+           img.runs.back().bytes + SECTOR_SIZE <= opt.chunk && offset % opt.chunk != 0)
+            img.runs.back().bytes += SECTOR_SIZE;
+        else
+            img.runs.push_back({offset, SECTOR_SIZE});
+    }
+}
+
+// Raw block access with the OS cache bypassed, so nothing goes through the
+// file system and the read back comes from the device.
+class RawDisk
+{
+public:
+    RawDisk()
+    {
+        #ifdef _WIN32
+        handle = INVALID_HANDLE_VALUE;
+        #else
+        fd = -1;
+        #endif
+    }
+
+    ~RawDisk()
+    {
+        #ifdef _WIN32
+        if(handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+        #else
+        if(fd >= 0) close(fd);
+        #endif
+    }
+
+    bool open_device(const std::string &path)
+    {
+        #ifdef _WIN32
+        handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                             NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, NULL);
+        return handle != INVALID_HANDLE_VALUE;
+        #elif defined(__APPLE__)
+        fd = open(path.c_str(), O_RDWR);
+        if(fd >= 0) fcntl(fd, F_NOCACHE, 1);
+        return fd >= 0;
+        #else
+        fd = open(path.c_str(), O_RDWR | O_DIRECT | O_SYNC);
+        return fd >= 0;
+        #endif
+    }
+
+    uint64_t size_bytes()
+    {
+        #ifdef _WIN32
+        GET_LENGTH_INFORMATION info;
+        DWORD returned;
+        if(!DeviceIoControl(handle, IOCTL_DISK_GET_LENGTH_INFO, NULL, 0, &info, sizeof(info), &returned, NULL)) return 0;
+        return (uint64_t)info.Length.QuadPart;
+        #elif defined(__APPLE__)
+        uint64_t count = 0;
+        uint32_t size = 0;
+        if(ioctl(fd, DKIOCGETBLOCKCOUNT, &count) < 0 || ioctl(fd, DKIOCGETBLOCKSIZE, &size) < 0) return 0;
+        return count * size;
+        #else
+        uint64_t bytes = 0;
+        if(ioctl(fd, BLKGETSIZE64, &bytes) < 0)
+        {
+            // A disk image file rather than a drive.
+            off_t end = lseek(fd, 0, SEEK_END);
+            return end > 0 ? (uint64_t)end : 0;
+        }
+        return bytes;
+        #endif
+    }
+
+    #if !defined(_WIN32) && !defined(__APPLE__)
+    // A command straight to the drive through SG_IO, true if it passed.
+    bool scsi(const uint8_t *cdb, uint8_t cdb_len, uint8_t *buf, uint32_t bytes)
+    {
+        sg_io_hdr_t io;
+        uint8_t sense[32];
+
+        memset(&io, 0, sizeof(io));
+        io.interface_id    = 'S';
+        io.cmdp            = (unsigned char*)cdb;
+        io.cmd_len         = cdb_len;
+        io.dxferp          = buf;
+        io.dxfer_len       = bytes;
+        io.dxfer_direction = bytes ? SG_DXFER_FROM_DEV : SG_DXFER_NONE;
+        io.sbp             = sense;
+        io.mx_sb_len       = sizeof(sense);
+        io.timeout         = 20000; // ms, VERIFY_10 reads the whole range before the CSW.
+        if(ioctl(fd, SG_IO, &io) < 0) return false;
+        return io.status == 0 && io.host_status == 0 && io.driver_status == 0;
+    }
+    #endif
+
+    bool transfer(bool write, uint64_t offset, uint8_t *buf, uint32_t bytes)
+    {
+        #ifdef _WIN32
+        LARGE_INTEGER pos;
+        DWORD done = 0;
+        pos.QuadPart = (LONGLONG)offset;
+        if(!SetFilePointerEx(handle, pos, NULL, FILE_BEGIN)) return false;
+        if(write) return WriteFile(handle, buf, bytes, &done, NULL) && done == bytes;
+        return ReadFile(handle, buf, bytes, &done, NULL) && done == bytes;
+        #else
+        ssize_t done = write ? pwrite(fd, buf, bytes, (off_t)offset) : pread(fd, buf, bytes, (off_t)offset);
+        return done == (ssize_t)bytes;
+        #endif
+    }
+
+private:
+    #ifdef _WIN32
+    HANDLE handle;
+    #else
+    int fd;
+    #endif
+};
+
+static uint8_t* aligned_buffer(uint32_t bytes)
+{
+    #ifdef _WIN32
+    return (uint8_t*)_aligned_malloc(bytes, ALIGNMENT);
+    #else
+    void *p = NULL;
+    if(posix_memalign(&p, ALIGNMENT, bytes) != 0) return NULL;
+    return (uint8_t*)p;
+    #endif
+}
+
+static void aligned_free(uint8_t *p)
+{
+    #ifdef _WIN32
+    _aligned_free(p);
+    #else
+    free(p);
+    #endif
+}
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+static bool read_hex_file(const std::string &path, uint16_t *val)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    unsigned v;
+    bool ok;
+
+    if(!f) return false;
+    ok = fscanf(f, "%x", &v) == 1;
+    fclose(f);
+    *val = (uint16_t)v;
+    return ok;
+}
+
+// Block devices whose USB device has the VID/PID. The sd's sysfs device is an
+// interface's SCSI target, idVendor/idProduct are a few parents up.
+static std::vector<std::string> find_drives(uint16_t vid, uint16_t pid)
+{
+    std::vector<std::string> found;
+    DIR *dir = opendir("/sys/block");
+    struct dirent *e;
+
+    if(!dir) return found;
+    while((e = readdir(dir)) != NULL)
+    {
+        char real[PATH_MAX];
+        std::string path;
+
+        if(strncmp(e->d_name, "sd", 2) != 0) continue;
+        if(!realpath(("/sys/block/" + std::string(e->d_name) + "/device").c_str(), real)) continue;
+        for(path = real; path.size() > 1; path = path.substr(0, path.rfind('/')))
+        {
+            uint16_t v, p;
+
+            if(read_hex_file(path + "/idVendor", &v) && read_hex_file(path + "/idProduct", &p))
+            {
+                if(v == vid && p == pid) found.push_back("/dev/" + std::string(e->d_name));
+                break;
+            }
+        }
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end());
+    return found;
+}
+#else
+static std::vector<std::string> find_drives(uint16_t vid, uint16_t pid)
+{
+    (void)vid;
+    (void)pid;
+    die("--all only finds drives on Linux, list the devices instead");
+    return std::vector<std::string>();
+}
+#endif
+
+static uint32_t crc32(uint32_t crc, const uint8_t *p, size_t len)
+{
+    crc = ~crc;
+    while(len--)
+    {
+        crc ^= *p++;
+        for(int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static bool fail(Result &r, const std::string &msg)
+{
+    r.ok = false;
+    r.error = msg;
+    return false;
+}
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+// The drive reads every run with VERIFY_10, CRCing the sectors as it goes, and 
+// only the CRC comes back. Needs firmware built with USE_VERIFY_10 and 
+// MSD_IMAGE_CRC.
+static bool device_verify(RawDisk &disk, const Image &img, Result &r)
+{
+    uint8_t  cdb[10];
+    uint8_t  resp[16];
+    uint32_t crc = 0;
+    uint32_t sectors = 0;
+
+    memset(cdb, 0, sizeof(cdb));
+    cdb[0] = MSD_IMAGE_CRC_CMD;
+    cdb[1] = MSD_IMAGE_CRC_RESET;
+    if(!disk.scsi(cdb, sizeof(cdb), resp, sizeof(resp))) return fail(r, "MSD_IMAGE_CRC_CMD refused, firmware built without MSD_IMAGE_CRC?");
+    for(const Run &run : img.runs)
+    {
+        uint32_t lba = (uint32_t)(run.offset / SECTOR_SIZE);
+        uint16_t blocks = (uint16_t)(run.bytes / SECTOR_SIZE);
+
+        memset(cdb, 0, sizeof(cdb));
+        cdb[0] = VERIFY_10;
+        cdb[2] = (uint8_t)(lba >> 24);
+        cdb[3] = (uint8_t)(lba >> 16);
+        cdb[4] = (uint8_t)(lba >> 8);
+        cdb[5] = (uint8_t)lba;
+        cdb[7] = (uint8_t)(blocks >> 8);
+        cdb[8] = (uint8_t)blocks;
+        if(!disk.scsi(cdb, sizeof(cdb), NULL, 0)) return fail(r, "VERIFY_10 failed at LBA " + std::to_string(lba));
+        crc = crc32(crc, &img.data[run.offset], run.bytes);
+        sectors += blocks;
+    }
+    memset(cdb, 0, sizeof(cdb));
+    cdb[0] = MSD_IMAGE_CRC_CMD;
+    if(!disk.scsi(cdb, sizeof(cdb), resp, sizeof(resp))) return fail(r, "MSD_IMAGE_CRC_CMD failed");
+    if(get_be32(&resp[12]) != sectors) return fail(r, "drive verified " + std::to_string(get_be32(&resp[12])) + " sectors, not " + std::to_string(sectors));
+    if(get_be32(&resp[8]) != crc) return fail(r, "verify CRC doesn't match the image");
+    return true;
+}
+#endif
+
+// One drive: every run written, then every run read back and compared.
+static bool flash_drive(const Options &opt, const Image &img, Result &r)
+{
+    RawDisk disk;
+    uint64_t size;
+    uint8_t *buf;
+    bool ok = true;
+
+    if(!disk.open_device(r.device)) return fail(r, "can't open (raw access usually needs root/administrator)");
+    size = disk.size_bytes();
+    if(size < img.data.size()) return fail(r, "image is bigger than the drive");
+    if(size > MAX_DISK && !opt.force) return fail(r, "bigger than 16MB, not an MSD_Internal_Example drive? (--force)");
+
+    buf = aligned_buffer(opt.chunk);
+    if(!buf) return fail(r, "out of memory");
+    for(const Run &run : img.runs)
+    {
+        memcpy(buf, &img.data[run.offset], run.bytes);
+        if(!disk.transfer(true, run.offset, buf, run.bytes))
+        {
+            ok = fail(r, "write failed at LBA " + std::to_string(run.offset / SECTOR_SIZE));
+            break;
+        }
+    }
+    #if !defined(_WIN32) && !defined(__APPLE__)
+    if(ok && opt.device_verify) ok = device_verify(disk, img, r);
+    else
+    #endif
+    if(ok && opt.verify)
+    {
+        for(const Run &run : img.runs)
+        {
+            if(!disk.transfer(false, run.offset, buf, run.bytes))
+            {
+                ok = fail(r, "read back failed at LBA " + std::to_string(run.offset / SECTOR_SIZE));
+                break;
+            }
+            if(memcmp(buf, &img.data[run.offset], run.bytes) != 0)
+            {
+                uint32_t i = 0;
+                while(buf[i] == img.data[run.offset + i]) i++;
+                ok = fail(r, "verify failed at LBA " + std::to_string((run.offset + i) / SECTOR_SIZE));
+                break;
+            }
+        }
+    }
+    aligned_free(buf);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    Image img;
+    std::vector<Result> results;
+    std::vector<std::thread> pool;
+    std::atomic<size_t> next(0);
+    std::mutex print_mutex;
+    uint64_t bytes = 0;
+    unsigned failed = 0;
+
+    if(argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    opt.hex = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--base" && has_value) opt.base = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--end" && has_value) opt.end = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--chunk" && has_value) opt.chunk = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--jobs" && has_value) opt.jobs = (unsigned)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--count" && has_value) opt.count = (unsigned)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--vid" && has_value) opt.vid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--pid" && has_value) opt.pid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--all") opt.all = true;
+        else if(arg == "--no-verify") opt.verify = false;
+        else if(arg == "--device-verify") opt.device_verify = true;
+        else if(arg == "--force") opt.force = true;
+        else if(arg.compare(0, 2, "--") != 0) opt.devices.push_back(arg);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if(opt.end <= opt.base || opt.end - opt.base > MAX_DISK) die("--end must be above --base and within 16MB of it");
+    if(opt.chunk < ALIGNMENT || opt.chunk % ALIGNMENT) die("--chunk must be a multiple of 4096");
+    if(opt.all == !opt.devices.empty()) die("give either the devices or --all");
+    #if defined(_WIN32) || defined(__APPLE__)
+    if(opt.device_verify) die("--device-verify needs SG_IO, it's only on Linux");
+    #endif
+
+    load_hex(opt, img);
+    for(const Run &run : img.runs) bytes += run.bytes;
+    printf("%s: %llu bytes in %u runs, LBA 0 to %u\n", opt.hex.c_str(), (unsigned long long)bytes,
+           (unsigned)img.runs.size(), (unsigned)(img.data.size() / SECTOR_SIZE - 1));
+
+    if(opt.all)
+    {
+        opt.devices = find_drives(opt.vid, opt.pid);
+        while(opt.devices.size() < opt.count)
+        {
+            printf("\r%u of %u drives", (unsigned)opt.devices.size(), opt.count);
+            fflush(stdout);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            opt.devices = find_drives(opt.vid, opt.pid);
+        }
+        if(opt.count) printf("\n");
+        if(opt.devices.empty()) die("no drives found with that VID/PID");
+    }
+
+    // Drives are handed out to the pool one at a time, so --jobs below the
+    // drive count still keeps every worker busy.
+    results.resize(opt.devices.size());
+    for(size_t i = 0; i < opt.devices.size(); i++) results[i].device = opt.devices[i];
+    if(opt.jobs == 0 || opt.jobs > results.size()) opt.jobs = (unsigned)results.size();
+
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned j = 0; j < opt.jobs; j++)
+    {
+        pool.emplace_back([&]()
+        {
+            size_t i;
+            while((i = next++) < results.size())
+            {
+                Result &r = results[i];
+                auto t = std::chrono::steady_clock::now();
+
+                r.ok = true;
+                flash_drive(opt, img, r);
+                r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+
+                std::lock_guard<std::mutex> lock(print_mutex);
+                if(r.ok) printf("%s: OK %.2fs\n", r.device.c_str(), r.seconds);
+                else printf("%s: FAILED, %s\n", r.device.c_str(), r.error.c_str());
+            }
+        });
+    }
+    for(std::thread &t : pool) t.join();
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for(const Result &r : results) if(!r.ok) failed++;
+    printf("%u of %u drives OK in %.2fs, %.1f KB/s total\n", (unsigned)results.size() - failed,
+           (unsigned)results.size(), total, total > 0 ? (double)bytes * (results.size() - failed) / total / 1024 : 0.0);
+    return failed ? 1 : 0;
+}
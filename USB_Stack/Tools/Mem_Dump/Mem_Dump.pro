@@ -0,0 +1,37 @@
+#-------------------------------------------------
+# Mem Dump, reads and writes device memory
+# with the USE_MEM_REQUEST vendor request.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = mem_dump
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += mem_dump.cpp
+
+#-------------------------------------------------
+# libusb-1.0
+#-------------------------------------------------
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += libusb-1.0
+win32: LIBS += -lusb-1.0
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <libusb.h>
+
+// USE_MEM_REQUEST in usb.h.
+#define MEM_SPACE_RAM 0x00
+#define MEM_SPACE_ROM    0x01
+#define MEM_SPACE_EEPROM 0x02
+#define TIMEOUT_MS       1000
+#define EEPROM_WRITE_MS  5 // Per byte, the device waits for each one in the data stage.
+
+struct Options
+{
+    uint16_t    vid = 0x04D8;
+    uint16_t    pid = 0;
+    uint8_t     code = 0xE1;   // MEM_REQUEST_CODE.
+    uint16_t    space = MEM_SPACE_RAM;
+    uint32_t    chunk = 4096;  // wLength per request, usbfs and WinUSB take up to 4096.
+    std::string file;
+};
+
+static void die(const char *msg, const std::string &what = "")
+{
+    fprintf(stderr, "mem_dump: %s%s%s\n", msg, what.empty() ? "" : ": ", what.c_str());
+    exit(1);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  mem_dump read <address> <bytes> --pid <pid> [--vid 04d8] [--rom | --eeprom] [--out file]\n"
+            "  mem_dump write <address> <byte>... --pid <pid> [--vid 04d8] [--eeprom]\n"
+            "  mem_dump write <address> --in file --pid <pid> [--vid 04d8] [--eeprom]\n"
+            "Reads data memory (program memory with --rom, data EEPROM with --eeprom) of\n"
+            "a device built with USE_MEM_REQUEST, or writes data memory or EEPROM, with\n"
+            "MEM_REQUEST_CODE vendor requests on EP0 (--code 0xe1). Addresses are 16\n"
+            "bits. A read is printed as a hex dump unless --out is given. --chunk sets\n"
+            "the bytes per request.\n");
+}
+
+static uint32_t number(const char *s)
+{
+    char *end;
+    uint32_t val = (uint32_t)strtoul(s, &end, 0);
+
+    if(*s == 0 || *end != 0) die("not a number", s);
+    return val;
+}
+
+static void hex_dump(uint32_t address, const std::vector<uint8_t> &data)
+{
+    for(size_t i = 0; i < data.size(); i += 16)
+    {
+        printf("%04X ", (unsigned)(address + i));
+        for(size_t j = i; j < i + 16; j++)
+        {
+            if(j < data.size()) printf(" %02X", data[j]);
+            else printf("   ");
+        }
+        printf("  ");
+        for(size_t j = i; j < i + 16 && j < data.size(); j++) putchar(data[j] >= 0x20 && data[j] < 0x7F ? data[j] : '.');
+        putchar('\n');
+    }
+}
+
+// One request per chunk, each a single control transfer with a multi-packet data stage.
+static void transfer(libusb_device_handle *dev, const Options &opt, bool in, uint32_t address, std::vector<uint8_t> &data)
+{
+    for(uint32_t done = 0; done < data.size();)
+    {
+        uint16_t len = (uint16_t)std::min<size_t>(opt.chunk, data.size() - done);
+        unsigned timeout = TIMEOUT_MS + (!in && opt.space == MEM_SPACE_EEPROM ? len * EEPROM_WRITE_MS : 0);
+        int r = libusb_control_transfer(dev, in ? 0xC0 : 0x40, opt.code, (uint16_t)(address + done), opt.space,
+                                        &data[done], len, timeout);
+
+        if(r < 0) die("control transfer failed", libusb_error_name(r));
+        if(r != len) die("short transfer, is the address range right?");
+        done += len;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    std::vector<uint8_t> data;
+    libusb_context *ctx;
+    libusb_device_handle *dev;
+    std::string cmd;
+    uint32_t address, bytes = 0;
+    bool in;
+    int i;
+
+    if(argc < 3)
+    {
+        usage();
+        return 1;
+    }
+    cmd = argv[1];
+    address = number(argv[2]);
+    if(cmd == "read" && argc > 3) bytes = number(argv[3]);
+    else if(cmd != "write")
+    {
+        usage();
+        return 1;
+    }
+    in = cmd == "read";
+    for(i = in ? 4 : 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--vid" && has_value) opt.vid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--pid" && has_value) opt.pid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--code" && has_value) opt.code = (uint8_t)number(argv[++i]);
+        else if(arg == "--chunk" && has_value) opt.chunk = number(argv[++i]);
+        else if((arg == "--out" && in && has_value) || (arg == "--in" && !in && has_value)) opt.file = argv[++i];
+        else if(arg == "--rom" && in) opt.space = MEM_SPACE_ROM;
+        else if(arg == "--eeprom") opt.space = MEM_SPACE_EEPROM;
+        else if(!in && arg.compare(0, 2, "--") != 0) data.push_back((uint8_t)number(argv[i]));
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if(opt.pid == 0) die("--pid is needed");
+    if(opt.chunk == 0 || opt.chunk > 0xFFFF) die("--chunk must be 1 to 65535");
+
+    if(!in && !opt.file.empty())
+    {
+        FILE *f = fopen(opt.file.c_str(), "rb");
+        int c;
+
+        if(!f) die("can't open", opt.file);
+        while((c = fgetc(f)) != EOF) data.push_back((uint8_t)c);
+        fclose(f);
+    }
+    if(in) data.resize(bytes);
+    if(data.empty()) die("nothing to transfer");
+    if(address + data.size() > 0x10000) die("the range goes past 0xFFFF");
+
+    if(libusb_init(&ctx) != 0) die("libusb_init failed");
+    dev = libusb_open_device_with_vid_pid(ctx, opt.vid, opt.pid);
+    if(!dev) die("device not found (or no permission)");
+
+    auto start = std::chrono::steady_clock::now();
+    transfer(dev, opt, in, address, data);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    libusb_close(dev);
+    libusb_exit(ctx);
+
+    if(in && !opt.file.empty())
+    {
+        FILE *f = fopen(opt.file.c_str(), "wb");
+
+        if(!f || fwrite(data.data(), 1, data.size(), f) != data.size()) die("can't write", opt.file);
+        fclose(f);
+    }
+    else if(in) hex_dump(address, data);
+    fprintf(stderr, "%u bytes %s 0x%04X in %.3f s (%.1f KB/s)\n", (unsigned)data.size(), in ? "from" : "to",
+            (unsigned)address, seconds, seconds > 0 ? data.size() / seconds / 1024 : 0.0);
+    return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file firmware.c
+ * @brief The device the SIE Simulator runs, a CDC echo port and a RAM disk.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - SIE Simulator Firmware.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb.h"
+#include "usb_app.h"
+#include "usb_cdc.h"
+#include "usb_msd.h"
+
+/*
+ * The same functions as the Composite Example without HID: interfaces 0 and 1 
+ * (EP1 and EP2) are a CDC ACM port that echoes what it receives, interface 2 
+ * (EP3) is a 128KB read/write RAM disk. main() is replaced by firmware_init(), 
+ * firmware_isr() and one pass of the main loop in firmware_loop(), which the 
+ * simulator calls in the order the PIC would run them.
+ * 
+ * Every usb_config.h option can be built in, the callbacks the options need 
+ * are here and do nothing. With USE_EVENTS the main loop is usb_event_tasks().
+ */
+
+static uint8_t m_disk[VOL_CAPACITY_IN_BYTES];
+
+static void serial_echo(void);
+
+#ifdef USE_EVENTS
+const usb_event_handler_t g_usb_event_handlers[NUM_EVENTS] =
+{
+    [EVENT_EP(CDC_DAT_EP)] = serial_echo,
+    [EVENT_EP(MSD_EP)]     = msd_tasks
+};
+#endif
+
+void firmware_init(void)
+{
+    usb_init();
+    #ifndef USE_POLLING
+    INTCONbits.PEIE = 1;
+    USB_INTERRUPT_FLAG = 0;
+    USB_INTERRUPT_ENABLE = 1;
+    INTCONbits.GIE = 1;
+    #endif
+}
+
+void firmware_isr(void)
+{
+    if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
+    {
+        usb_tasks();
+        USB_INTERRUPT_FLAG = 0;
+    }
+}
+
+void firmware_loop(void)
+{
+    #ifdef USE_EVENTS
+    usb_event_tasks(); // Runs the deferred tasks too.
+    #else
+    #ifdef USE_POLLING
+    usb_tasks();
+    #endif
+    #ifdef USE_DEFERRED_TASKS
+    usb_deferred_tasks();
+    #endif
+    if(usb_get_state() < STATE_CONFIGURED) return; // Pause if not configured or suspended.
+    
+    msd_tasks();
+    serial_echo();
+    #endif
+}
+
+static void serial_echo(void)
+{
+    uint8_t buffer[CDC_DAT_EP_SIZE];
+    uint8_t cnt = cdc_read(buffer, sizeof(buffer));
+    if(cnt) cdc_write(buffer, cnt); // Sent by cdc_service_sof() once the host stops sending.
+}
+
+void cdc_set_control_line_state(void)
+{
+}
+
+bool cdc_set_line_coding(void)
+{
+    return true;
+}
+
+void cdc_notification(void)
+{
+}
+
+void usb_sof(void)
+{
+    cdc_service_sof();
+}
+
+#ifdef USE_RESET
+void usb_reset(void)
+{
+}
+#endif
+
+#ifdef USE_ERROR
+void usb_error(void)
+{
+    UEIR = 0; // The stack only counts the flags (USE_EP_STATS), the application clears them.
+}
+#endif
+
+#ifdef USE_IDLE
+void usb_idle(void)
+{
+}
+#endif
+
+#ifdef USE_ACTIVITY
+void usb_activity(void)
+{
+}
+#endif
+
+// A packet at a time from and to the EP buffer the last transaction used.
+void msd_rx_sector(void)
+{
+    uint8_t *p_sect = &m_disk[(g_msd_rw_10_vars.LBA * BYTES_PER_BLOCK_LE) + g_msd_byte_of_sect];
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    usb_ram_copy(p_sect, MSD_EP_IN_LAST_PPB == ODD ? g_msd_ep_in_odd : g_msd_ep_in_even, MSD_EP_SIZE);
+    #else
+    usb_ram_copy(p_sect, g_msd_ep_in, MSD_EP_SIZE);
+    #endif
+}
+
+void msd_tx_sector(void)
+{
+    uint8_t *p_sect = &m_disk[(g_msd_rw_10_vars.LBA * BYTES_PER_BLOCK_LE) + g_msd_byte_of_sect];
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    usb_ram_copy(MSD_EP_OUT_LAST_PPB == ODD ? g_msd_ep_out_odd : g_msd_ep_out_even, p_sect, MSD_EP_SIZE);
+    #else
+    usb_ram_copy(g_msd_ep_out, p_sect, MSD_EP_SIZE);
+    #endif
+}
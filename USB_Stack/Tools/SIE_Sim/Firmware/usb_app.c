@@ -0,0 +1,153 @@
+/**
+ * @file usb_app.c
+ * @brief Contains application specific functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Application file (This file is for the SIE Simulator).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_app.h"
+#include "usb_cdc.h"
+#include "usb_msd.h"
+
+
+#ifdef USE_EP_HANDLER_TABLE
+const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+{
+    [CDC_COM_EP][IN]  = cdc_com_ep_in_tasks,
+    [CDC_DAT_EP][OUT] = cdc_dat_ep_out_tasks,
+    [CDC_DAT_EP][IN]  = cdc_dat_ep_in_tasks,
+    [MSD_EP][OUT]     = msd_add_task,
+    [MSD_EP][IN]      = msd_add_task
+};
+#endif
+
+
+#ifdef USE_IF_HANDLER_TABLE
+const usb_if_handler_t g_usb_if_handlers[NUM_INTERFACES] =
+{
+    [CDC_COM_INT] = {cdc_class_request, NULL, cdc_out_control_tasks},
+    [MSD_INT]     = {msd_class_request, NULL, NULL}
+};
+#endif
+
+
+bool usb_service_class_request(void)
+{
+    #ifndef USE_IF_HANDLER_TABLE
+    switch(g_usb_setup.wIndex)
+    {
+        case CDC_COM_INT:
+            return cdc_class_request();
+        case MSD_INT:
+            return msd_class_request();
+    }
+    #endif
+    return false; // With USE_IF_HANDLER_TABLE every Class Request is for an interface, see g_usb_if_handlers.
+}
+
+
+bool usb_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+{
+    return false;
+}
+
+
+void usb_app_init(void)
+{
+    cdc_init();
+    msd_init();
+}
+
+
+void usb_app_tasks(void)
+{
+    // Not used with USE_EP_HANDLER_TABLE.
+    switch(TRANSACTION_EP)
+    {
+        case CDC_COM_EP:
+        case CDC_DAT_EP:
+            cdc_tasks();
+            break;
+        case MSD_EP:
+            msd_add_task();
+            break;
+    }
+}
+
+
+void usb_app_clear_halt(uint8_t bd_table_index, uint8_t ep, uint8_t dir)
+{
+    switch(ep)
+    {
+        case MSD_EP:
+            msd_clear_halt(bd_table_index, ep, dir);
+            break;
+        default:
+            g_usb_ep_stat[ep][dir].Halt = 0;
+            g_usb_ep_stat[ep][dir].Data_Toggle_Val = 0;
+            g_usb_bd_table[bd_table_index].STAT = 0;
+            break;
+    }
+}
+
+
+bool usb_app_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    if(alternate_setting != 0) return false;
+    
+    switch(interface)
+    {
+        case CDC_COM_INT:
+            CDC_COM_EP_IN_DATA_TOGGLE_VAL = 0;
+            return true;
+        case CDC_COM_INT + 1:
+            CDC_DAT_EP_OUT_DATA_TOGGLE_VAL = 0;
+            CDC_DAT_EP_IN_DATA_TOGGLE_VAL = 0;
+            return true;
+        case MSD_INT:
+            msd_clear_ep_toggle();
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+bool usb_app_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    return false;
+}
+
+
+bool usb_out_control_finished(void)
+{
+    #ifdef USE_IF_HANDLER_TABLE
+    return false; // CDC's SET_LINE_CODING ends in cdc_out_control_tasks(), see g_usb_if_handlers.
+    #else
+    return cdc_out_control_tasks();
+    #endif
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+/**
+ * @file usb_descriptors.c
+ * @brief Contains core USB stack descriptors stored in ROM.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - USB Stack (This file is for the SIE Simulator).
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_config.h"
+#include "usb_cdc.h"
+#include "usb_msd.h"
+#include "usb_ch9.h"
+
+/** Device Descriptor */
+const ch9_device_descriptor_t g_device_descriptor =
+{
+    0x12,                 // bLength:8 -  Size of descriptor in bytes
+    DEVICE_DESC,          // bDescriptorType:8  - Device descriptor type
+    #ifdef USE_BOS
+    0x0201,               // bcdUSB:16 -  USB in BCD (2.01H), a BOS Descriptor is available
+    #else
+    0x0200,               // bcdUSB:16 -  USB in BCD (2.0H)
+    #endif
+    MISC_CLASS,           // bDeviceClass:8 - Functions are described by IADs
+    MISC_COMMON_SUBCLASS, // bDeviceSubClass:8
+    MISC_IAD_PROTOCOL,    // bDeviceProtocol:8
+    EP0_SIZE,             // bMaxPacketSize0:8 - Maximum packet size
+    0x04D8,               // idVendor:16 - Microchip VID = 0x04D8
+    0x0054,               // idProduct:16 - Product ID (PID) = 0x0054
+    0x0100,               // bcdDevice:16 - Device release number in BCD
+    0x01,                 // iManufacturer:8 - Manufacturer string index
+    0x02,                 // iProduct:8 - Product string index
+    0x03,                 // iSerialNumber:8 - Device serial number string index
+    0x01                  // bNumConfigurations:8 - Number of possible configurations
+};
+
+/** Configuration Descriptor Structure */
+typedef struct
+{
+    ch9_configutarion_descriptor_t configuration0_descriptor;
+    cdc_function_descriptors_t     cdc; // Interfaces 0 and 1, EP1 and EP2.
+    msd_function_descriptors_t     msd; // Interface 2, EP3.
+}config_descriptor_t;
+
+/** Configuration Descriptor */
+static const config_descriptor_t config_descriptor0 =
+{
+    CH9_CONFIGURATION_DESCRIPTOR(sizeof(config_descriptor0), NUM_INTERFACES, 1, 0xC0, 50), // Self Powered, 100mA.
+    CDC_FUNCTION_DESCRIPTORS(2),
+    MSD_FUNCTION_DESCRIPTORS()
+};
+
+/** Configuration Descriptor Addresses Array */
+const usb_desc_addr_t g_config_descriptors[] =
+{
+    (usb_desc_addr_t)&config_descriptor0
+};
+
+#ifdef USE_FAST_ENUMERATION
+/** Configuration Descriptor Lengths Array */
+const uint16_t g_config_descriptor_lengths[] =
+{
+    sizeof(config_descriptor0)
+};
+#endif
+
+/** String Zero Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t wLANGID[1];
+}string_zero_descriptor_t;
+
+/** Vendor String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[6];
+}vendor_string_descriptor_t;
+
+/** Product String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[14];
+}product_string_descriptor_t;
+
+/** Serial String Descriptor Structure */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bString[12];
+}serial_string_descriptor_t;
+
+/** String Zero Descriptor */
+static const string_zero_descriptor_t string_zero_descriptor =
+{
+    sizeof(string_zero_descriptor_t),
+    STRING_DESC,
+    {0x0409}
+};
+
+/** Vendor String Descriptor */
+static const vendor_string_descriptor_t vendor_string_descriptor =
+{
+    sizeof(vendor_string_descriptor_t),
+    STRING_DESC,
+    {'J','o','h','n','n','y'}
+};
+
+/** Product String Descriptor */
+static const product_string_descriptor_t product_string_descriptor =
+{
+    sizeof(product_string_descriptor_t),
+    STRING_DESC,
+    {'C','D','C',' ','M','S','D',' ','D','e','v','i','c','e'}
+};
+
+/** Serial String Descriptor */
+static const serial_string_descriptor_t serial_string_descriptor =
+{
+    sizeof(serial_string_descriptor_t),
+    STRING_DESC,
+    {'0','1','2','3','4','5','6','7','8','9','A','B'}
+};
+
+/** String Descriptor Addresses Array */
+const usb_desc_addr_t g_string_descriptors[] =
+{
+    (usb_desc_addr_t)&string_zero_descriptor,
+    (usb_desc_addr_t)&vendor_string_descriptor,
+    (usb_desc_addr_t)&product_string_descriptor,
+    (usb_desc_addr_t)&serial_string_descriptor
+};
+
+/** String Descriptor Addresses Array Size */
+const uint8_t g_size_of_sd = sizeof(g_string_descriptors) / sizeof(g_string_descriptors[0]);
+
+
+#ifdef USE_BOS
+#ifdef USE_MS_OS_20
+/** MS OS 2.0 Descriptor Set Structure, a header only, the classes need no Windows features */
+typedef struct
+{
+    ms_os_20_set_header_descriptor_t set_header;
+}ms_os_20_descriptor_set_t;
+
+/** MS OS 2.0 Descriptor Set */
+static const ms_os_20_descriptor_set_t ms_os_20_descriptor_set =
+{
+    MS_OS_20_SET_HEADER(sizeof(ms_os_20_descriptor_set_t))
+};
+
+/** BOS Descriptor Structure */
+typedef struct
+{
+    ch9_bos_descriptor_t               bos_descriptor;
+    ch9_ms_os_20_platform_descriptor_t ms_os_20_platform_descriptor;
+}bos_descriptor_t;
+
+/** BOS Descriptor */
+static const bos_descriptor_t bos_descriptor =
+{
+    CH9_BOS_DESCRIPTOR(sizeof(bos_descriptor_t), 1),
+    CH9_MS_OS_20_PLATFORM_DESCRIPTOR(sizeof(ms_os_20_descriptor_set_t), MS_OS_20_VENDOR_CODE)
+};
+
+const uint8_t* g_ms_os_20_descriptor_set = (const uint8_t*)&ms_os_20_descriptor_set;
+const uint16_t g_ms_os_20_descriptor_set_size = sizeof(ms_os_20_descriptor_set_t);
+#else
+/** BOS Descriptor Structure, no Device Capabilities */
+typedef struct
+{
+    ch9_bos_descriptor_t bos_descriptor;
+}bos_descriptor_t;
+
+/** BOS Descriptor */
+static const bos_descriptor_t bos_descriptor =
+{
+    CH9_BOS_DESCRIPTOR(sizeof(bos_descriptor_t), 0)
+};
+#endif
+
+const uint8_t* g_bos_descriptor = (const uint8_t*)&bos_descriptor;
+const uint16_t g_bos_descriptor_size = sizeof(bos_descriptor_t);
+#endif
\ No newline at end of file
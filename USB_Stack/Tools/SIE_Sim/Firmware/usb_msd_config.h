@@ -0,0 +1,83 @@
+/**
+ * @file usb_msd_config.h
+ * @brief <i>Mass Storage Class</i> user settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - MSD Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_MSD_CONFIG
+#define USB_MSD_CONFIG
+
+#include "usb_config.h"
+
+// External Media Support
+//#define USE_EXTERNAL_MEDIA
+
+// Support SCSI Command
+#define USE_WRITE_10
+//#define USE_PREVENT_ALLOW_MEDIUM_REMOVAL
+//#define USE_VERIFY_10
+
+//#define USE_WR_PROTECT
+//#define USE_TEST_UNIT_READY
+//#define USE_START_STOP_UNIT
+//#define USE_READ_CAPACITY   // if not defined use the constant defines for capacity below. 
+//#define USE_RW_12_16        // READ_12/16, WRITE_12/16 (with USE_WRITE_10) and READ_CAPACITY_16.
+
+// CAPACITY
+#define BYTES_PER_BLOCK_LE 0x200 // 512
+#define BYTES_PER_BLOCK_BE 0x00020000UL // Big-endian version
+
+#define VOL_CAPACITY_IN_BYTES 0x20000UL // 128KB
+#define VOL_CAPACITY_IN_BLOCKS 0x100 // 256
+
+#define LAST_BLOCK_LE 0xFF // 255 (VOL_CAPACITY_IN_BLOCKS - 1)
+
+// MSD Interface Number
+#define MSD_INT 2
+
+// MSD Endpoint HAL
+#define MSD_EP EP3
+#define MSD_EP_SIZE EP3_SIZE
+
+// MSD Buffer Decriptor HAL
+#define MSD_BD_OUT         EP_BD_INDEX(EP3, OUT, EVEN)
+#define MSD_BD_OUT_EVEN    EP_BD_INDEX(EP3, OUT, EVEN)
+#define MSD_BD_OUT_ODD     EP_BD_INDEX(EP3, OUT, ODD)
+#define MSD_BD_IN          EP_BD_INDEX(EP3, IN, EVEN)
+#define MSD_BD_IN_EVEN     EP_BD_INDEX(EP3, IN, EVEN)
+#define MSD_BD_IN_ODD      EP_BD_INDEX(EP3, IN, ODD)
+
+// MSD UEP3bits
+#define MSD_UEPbits UEP3bits
+
+// RAM Setting
+#define MSD_LIMITED_RAM // Sectors are made 64 bytes at a time straight into the IN EP, 
+                        // as on the Composite Example.
+
+//#define MSD_TASK_QUEUE_SIZE 8 // Endpoint transactions msd_add_task() can queue for msd_tasks(),
+                              // a power of two (default 4). Raise it if g_msd_task_overflows
+                              // counts, e.g. when the main loop is slow to call msd_tasks().
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef SIM_XC_H
+#define SIM_XC_H
+
+// Stands in for XC8's <xc.h> when the stack is built for the SIE Simulator.
+// Only the PIC18F25K50 SFRs the stack touches are here, each one is reached
+// through sim_sie() (see ../sie_regs.h) so the simulated SIE sees every access.
+
+#include <stdint.h>
+#include "../sie_regs.h"
+
+typedef uint32_t uint24_t;
+
+#define __at(addr)
+#define __interrupt(...)
+#define asm(x)
+#define NOP()
+#define SLEEP()
+#define CLRWDT()
+#define __delay_ms(x)
+#define __delay_us(x)
+
+/* ************************************************************************** */
+/* ****************************** SFR BITS ********************************** */
+/* ************************************************************************** */
+
+typedef union
+{
+    struct
+    {
+        uint8_t        :1;
+        uint8_t SUSPND :1;
+        uint8_t RESUME :1;
+        uint8_t USBEN  :1;
+        uint8_t PKTDIS :1;
+        uint8_t SE0    :1;
+        uint8_t PPBRST :1;
+        uint8_t        :1;
+    };
+}sim_UCONbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t PPB0  :1;
+        uint8_t PPB1  :1;
+        uint8_t FSEN  :1;
+        uint8_t       :1;
+        uint8_t UPUEN :1;
+        uint8_t       :2;
+        uint8_t UTEYE :1;
+    };
+}sim_UCFGbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t URSTIF  :1;
+        uint8_t UERRIF  :1;
+        uint8_t ACTVIF  :1;
+        uint8_t TRNIF   :1;
+        uint8_t IDLEIF  :1;
+        uint8_t STALLIF :1;
+        uint8_t SOFIF   :1;
+        uint8_t         :1;
+    };
+}sim_UIRbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t URSTIE  :1;
+        uint8_t UERRIE  :1;
+        uint8_t ACTVIE  :1;
+        uint8_t TRNIE   :1;
+        uint8_t IDLEIE  :1;
+        uint8_t STALLIE :1;
+        uint8_t SOFIE   :1;
+        uint8_t         :1;
+    };
+}sim_UIEbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t      :1;
+        uint8_t PPBI :1;
+        uint8_t DIR  :1;
+        uint8_t ENDP :4;
+        uint8_t      :1;
+    };
+}sim_USTATbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t EPSTALL  :1;
+        uint8_t EPINEN   :1;
+        uint8_t EPOUTEN  :1;
+        uint8_t EPCONDIS :1;
+        uint8_t EPHSHK   :1;
+        uint8_t          :3;
+    };
+}sim_UEPbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t      :6;
+        uint8_t PEIE :1;
+        uint8_t GIE  :1;
+    };
+}sim_INTCONbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t       :2;
+        uint8_t USBIE :1;
+        uint8_t       :5;
+    };
+}sim_PIE3bits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t       :2;
+        uint8_t USBIF :1;
+        uint8_t       :5;
+    };
+}sim_PIR3bits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t       :2;
+        uint8_t USBIP :1;
+        uint8_t       :5;
+    };
+}sim_IPR3bits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t       :7;
+        uint8_t IDLEN :1;
+    };
+}sim_OSCCONbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t        :4;
+        uint8_t PLLEN  :1;
+        uint8_t        :2;
+        uint8_t PLLRDY :1;
+    };
+}sim_OSCCON2bits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t        :6;
+        uint8_t PLLRDY :1;
+        uint8_t        :1;
+    };
+}sim_OSCSTATbits_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t       :7;
+        uint8_t ACTEN :1;
+    };
+}sim_ACTCONbits_t;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************** SFRS ************************************ */
+/* ************************************************************************** */
+
+#define SIM_SFR(reg)            (sim_sie()->reg)
+#define SIM_SFR_BITS(type, sfr) (*(type*)&(sfr))
+
+#define UCON    SIM_SFR(UCON)
+#define UCFG    SIM_SFR(UCFG)
+#define UIR     SIM_SFR(UIR)
+#define UIE     SIM_SFR(UIE)
+#define UEIR    SIM_SFR(UEIR)
+#define UEIE    SIM_SFR(UEIE)
+#define USTAT   SIM_SFR(USTAT)
+#define UADDR   SIM_SFR(UADDR)
+#define UFRML   SIM_SFR(UFRML)
+#define UFRMH   SIM_SFR(UFRMH)
+#define UEP0    SIM_SFR(UEP[0])
+#define UEP1    SIM_SFR(UEP[1])
+#define UEP2    SIM_SFR(UEP[2])
+#define UEP3    SIM_SFR(UEP[3])
+#define UEP4    SIM_SFR(UEP[4])
+#define UEP5    SIM_SFR(UEP[5])
+#define UEP6    SIM_SFR(UEP[6])
+#define UEP7    SIM_SFR(UEP[7])
+#define INTCON  SIM_SFR(INTCON)
+#define PIE3    SIM_SFR(PIE3)
+#define PIR3    SIM_SFR(PIR3)
+#define IPR3    SIM_SFR(IPR3)
+#define OSCCON  SIM_SFR(OSCCON)
+#define OSCCON2 SIM_SFR(OSCCON2)
+#define OSCSTAT SIM_SFR(OSCSTAT)
+#define ACTCON  SIM_SFR(ACTCON)
+#define TMR1    (*(uint16_t*)&SIM_SFR(TMR1L))
+#define T1CON   SIM_SFR(T1CON)
+
+#define UCONbits    SIM_SFR_BITS(sim_UCONbits_t, UCON)
+#define UCFGbits    SIM_SFR_BITS(sim_UCFGbits_t, UCFG)
+#define UIRbits     SIM_SFR_BITS(sim_UIRbits_t, UIR)
+#define UIEbits     SIM_SFR_BITS(sim_UIEbits_t, UIE)
+#define USTATbits   SIM_SFR_BITS(sim_USTATbits_t, USTAT)
+#define UEP0bits    SIM_SFR_BITS(sim_UEPbits_t, UEP0)
+#define UEP1bits    SIM_SFR_BITS(sim_UEPbits_t, UEP1)
+#define UEP2bits    SIM_SFR_BITS(sim_UEPbits_t, UEP2)
+#define UEP3bits    SIM_SFR_BITS(sim_UEPbits_t, UEP3)
+#define UEP4bits    SIM_SFR_BITS(sim_UEPbits_t, UEP4)
+#define UEP5bits    SIM_SFR_BITS(sim_UEPbits_t, UEP5)
+#define UEP6bits    SIM_SFR_BITS(sim_UEPbits_t, UEP6)
+#define UEP7bits    SIM_SFR_BITS(sim_UEPbits_t, UEP7)
+#define INTCONbits  SIM_SFR_BITS(sim_INTCONbits_t, INTCON)
+#define PIE3bits    SIM_SFR_BITS(sim_PIE3bits_t, PIE3)
+#define PIR3bits    SIM_SFR_BITS(sim_PIR3bits_t, PIR3)
+#define IPR3bits    SIM_SFR_BITS(sim_IPR3bits_t, IPR3)
+#define OSCCONbits  SIM_SFR_BITS(sim_OSCCONbits_t, OSCCON)
+#define OSCCON2bits SIM_SFR_BITS(sim_OSCCON2bits_t, OSCCON2)
+#define OSCSTATbits SIM_SFR_BITS(sim_OSCSTATbits_t, OSCSTAT)
+#define ACTCONbits  SIM_SFR_BITS(sim_ACTCONbits_t, ACTCON)
+
+/* ************************************************************************** */
+
+#endif /* SIM_XC_H */
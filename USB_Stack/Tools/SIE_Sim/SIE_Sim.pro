@@ -0,0 +1,57 @@
+#-------------------------------------------------
+# SIE Simulator, runs the stack on the host against
+# a model of the PIC18F25K50 SIE and counts the
+# work the firmware does for each USB transaction.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = sie_sim
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+        sie.cpp \
+        host.cpp \
+        Firmware/firmware.c \
+        Firmware/usb_app.c \
+        Firmware/usb_descriptors.c \
+        ../../USB/usb.c \
+        ../../USB/usb_cdc_acm.c \
+        ../../USB/usb_msd.c \
+        ../../Examples/MSD_Examples/Shared_Files/usb_scsi_inq.c
+
+HEADERS  += sie_regs.h \
+         sie.h \
+         host.h \
+         Firmware/xc.h \
+         Firmware/usb_config.h \
+         Firmware/usb_cdc_config.h \
+         Firmware/usb_msd_config.h
+
+#-------------------------------------------------
+# Firmware is built as a PIC18F25K50 with the
+# USB_SIM placements. Only the C files (the stack)
+# are instrumented, the counts are firmware only.
+#-------------------------------------------------
+DEFINES += USB_SIM _18F25K50
+INCLUDEPATH += Firmware ../../USB ../../Examples/MSD_Examples/Shared_Files
+QMAKE_CFLAGS += -std=gnu99 -fpack-struct -fsanitize-coverage=trace-pc,trace-cmp
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
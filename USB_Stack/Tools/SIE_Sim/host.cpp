@@ -0,0 +1,604 @@
+#include "host.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// A token NAKed this many times in a row is reported, the device has hung.
+#define NAK_LIMIT 10000
+
+// SOFs are sent every TOKENS_PER_FRAME tokens, about what fits in a full
+// speed frame with 64 byte bulk packets.
+#define TOKENS_PER_FRAME 16
+
+#define MAX_PACKET 1024
+
+#define STATS_REQUEST_CODE 0xE0 // Firmware/usb_config.h.
+
+static const char *handshake_name(SieHandshake hs)
+{
+    switch(hs)
+    {
+        case SIE_ACK:   return "ACK";
+        case SIE_NAK:   return "NAK";
+        case SIE_STALL: return "STALL";
+        default:        return "none";
+    }
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+Host::Host()
+{
+    verbose = false;
+    memset(&stats, 0, sizeof(stats));
+    address = 0;
+    ep0_size = 8;
+    tokens = 0;
+    memset(out_toggle, 0, sizeof(out_toggle));
+    memset(in_toggle, 0, sizeof(in_toggle));
+    memset(ep_count, 0, sizeof(ep_count));
+    configured = false;
+    cdc_com_interface = 0;
+    has_cdc = false;
+    cdc_out = cdc_in = HostEndpoint{0, 0};
+    has_msd = false;
+    msd_interface = 0;
+    msd_out = msd_in = HostEndpoint{0, 0};
+    msd_tag = 0;
+    cdc_pattern = 0;
+    msd_pattern = 0;
+}
+
+bool Host::fail(const std::string &msg)
+{
+    error = msg;
+    return false;
+}
+
+/* ************************************************************************** */
+/* ******************************** TOKENS ********************************** */
+/* ************************************************************************** */
+
+void Host::bus_time()
+{
+    if(++tokens % TOKENS_PER_FRAME) return;
+    g_sie.sof();
+    g_sie.run_firmware();
+}
+
+// Each token is followed by the firmware's response to it, a NAKed token is
+// retried with the firmware running in between, as a host controller would.
+#define RETRY_TOKEN(name, ep, dir, len, call)                                                \
+    SieHandshake hs = SIE_NAK;                                                               \
+    uint32_t     naks = 0;                                                                   \
+    uint64_t     blocks = g_sie.counters.blocks;                                             \
+    while(naks <= NAK_LIMIT)                                                                 \
+    {                                                                                        \
+        hs = call;                                                                           \
+        g_sie.run_firmware();                                                                \
+        bus_time();                                                                          \
+        if(hs != SIE_NAK) break;                                                             \
+        naks++;                                                                              \
+    }                                                                                        \
+    stats.naks += naks;                                                                      \
+    if(hs != SIE_NAK) stats.transactions++;                                                  \
+    if(hs == SIE_ACK) stats.bytes += (len);                                                  \
+    if(hs == SIE_ACK) ep_count[ep][dir].transactions++;                                      \
+    if(hs == SIE_ACK) ep_count[ep][dir].bytes += (len);                                      \
+    if(verbose) printf("    %-5s EP%-2u %4u bytes  %-5s %6llu blocks  %u NAKs\n", name, ep,  \
+                       (unsigned)((hs == SIE_ACK) ? (len) : 0), handshake_name(hs),          \
+                       (unsigned long long)(g_sie.counters.blocks - blocks), naks);         \
+    return hs
+
+SieHandshake Host::token_setup(const uint8_t *setup)
+{
+    RETRY_TOKEN("SETUP", 0, 0, 8, g_sie.setup(address, setup));
+}
+
+SieHandshake Host::token_out(uint8_t ep, const uint8_t *data, uint16_t len, uint8_t toggle)
+{
+    RETRY_TOKEN("OUT", ep, 0, len, g_sie.out(address, ep, toggle, data, len));
+}
+
+SieHandshake Host::token_in(uint8_t ep, uint8_t *data, uint16_t *len, uint8_t *toggle)
+{
+    *len = 0;
+    RETRY_TOKEN("IN", ep, 1, *len, g_sie.in(address, ep, data, len, toggle));
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** CONTROL TRANSFERS **************************** */
+/* ************************************************************************** */
+
+bool Host::control(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                   uint16_t wLength, std::vector<uint8_t> &data, bool *stalled)
+{
+    uint8_t      setup[8];
+    uint8_t      buf[MAX_PACKET];
+    uint16_t     len;
+    uint8_t      toggle;
+    SieHandshake hs;
+    bool         dir_in = (bmRequestType & 0x80) != 0;
+
+    if(stalled) *stalled = false;
+    setup[0] = bmRequestType;
+    setup[1] = bRequest;
+    setup[2] = (uint8_t)wValue;
+    setup[3] = (uint8_t)(wValue >> 8);
+    setup[4] = (uint8_t)wIndex;
+    setup[5] = (uint8_t)(wIndex >> 8);
+    setup[6] = (uint8_t)wLength;
+    setup[7] = (uint8_t)(wLength >> 8);
+    if(!dir_in && data.size() < wLength) return fail("control OUT with less data than wLength");
+
+    hs = token_setup(setup);
+    if(hs != SIE_ACK) return fail(std::string("SETUP answered with ") + handshake_name(hs));
+    out_toggle[0] = 1;
+    in_toggle[0] = 1;
+
+    // Data stage.
+    if(dir_in && wLength)
+    {
+        data.clear();
+        while(data.size() < wLength)
+        {
+            hs = token_in(0, buf, &len, &toggle);
+            if(hs == SIE_STALL) goto stall;
+            if(hs != SIE_ACK) return fail(std::string("control IN answered with ") + handshake_name(hs));
+            if(toggle != in_toggle[0]) return fail("control IN data toggle out of sequence");
+            in_toggle[0] ^= 1;
+            if(len > ep0_size) return fail("control IN packet larger than bMaxPacketSize0");
+            if(data.size() + len > wLength) return fail("control IN returned more than wLength");
+            data.insert(data.end(), buf, buf + len);
+            if(len < ep0_size) break;
+        }
+    }
+    else if(!dir_in)
+    {
+        for(uint16_t off = 0; off < wLength; off += len)
+        {
+            len = (wLength - off) < ep0_size ? (uint16_t)(wLength - off) : ep0_size;
+            hs = token_out(0, &data[off], len, out_toggle[0]);
+            if(hs == SIE_STALL) goto stall;
+            if(hs != SIE_ACK) return fail(std::string("control OUT answered with ") + handshake_name(hs));
+            out_toggle[0] ^= 1;
+        }
+    }
+
+    // Status stage, a zero length DATA1 packet the other way.
+    if(dir_in && wLength)
+    {
+        hs = token_out(0, NULL, 0, 1);
+        if(hs == SIE_STALL) goto stall;
+        if(hs != SIE_ACK) return fail(std::string("status OUT answered with ") + handshake_name(hs));
+    }
+    else
+    {
+        hs = token_in(0, buf, &len, &toggle);
+        if(hs == SIE_STALL) goto stall;
+        if(hs != SIE_ACK) return fail(std::string("status IN answered with ") + handshake_name(hs));
+        if(len != 0) return fail("status IN wasn't zero length");
+        if(toggle != 1) return fail("status IN wasn't DATA1");
+    }
+    return true;
+
+stall:
+    if(stalled)
+    {
+        *stalled = true;
+        return true;
+    }
+    return fail("control request STALLed");
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** ENUMERATION ******************************* */
+/* ************************************************************************** */
+
+bool Host::attach()
+{
+    g_sie.power_on();
+    firmware_init();
+    g_sie.run_firmware();
+    address = 0;
+    configured = false;
+    memset(ep_count, 0, sizeof(ep_count)); // usb_init() cleared the device's.
+    return bus_reset();
+}
+
+bool Host::bus_reset()
+{
+    g_sie.bus_reset();
+    g_sie.run_firmware();
+    address = 0;
+    configured = false;
+    memset(out_toggle, 0, sizeof(out_toggle));
+    memset(in_toggle, 0, sizeof(in_toggle));
+    return true;
+}
+
+bool Host::enumerate()
+{
+    std::vector<uint8_t> dev, config, str, none;
+    uint16_t total;
+
+    // The first read only needs bMaxPacketSize0, it's followed by another reset.
+    ep0_size = 64;
+    if(!control(0x80, 0x06, 0x0100, 0, 64, dev, NULL)) return false;
+    if(dev.size() < 8 || dev[1] != 0x01) return fail("bad device descriptor");
+    ep0_size = dev[7];
+    if(ep0_size != 8 && ep0_size != 16 && ep0_size != 32 && ep0_size != 64) return fail("bad bMaxPacketSize0");
+    if(!bus_reset()) return false;
+
+    if(!control(0x00, 0x05, 1, 0, 0, none, NULL)) return false; // SET_ADDRESS
+    address = 1;
+
+    if(!control(0x80, 0x06, 0x0100, 0, 18, dev, NULL)) return false;
+    if(dev.size() != 18 || dev[0] != 18) return fail("device descriptor isn't 18 bytes");
+
+    if(!control(0x80, 0x06, 0x0200, 0, 9, config, NULL)) return false;
+    if(config.size() != 9 || config[1] != 0x02) return fail("bad configuration descriptor");
+    total = config[2] | (config[3] << 8);
+    if(!control(0x80, 0x06, 0x0200, 0, total, config, NULL)) return false;
+    if(config.size() != total) return fail("configuration descriptor shorter than wTotalLength");
+
+    if(!control(0x80, 0x06, 0x0300, 0, 255, str, NULL)) return false;
+    if(str.size() < 4 || str[1] != 0x03) return fail("bad string descriptor zero");
+    for(int i = 14; i <= 16; i++)
+    {
+        if(dev[i] == 0) continue;
+        if(!control(0x80, 0x06, 0x0300 | dev[i], 0x0409, 255, str, NULL)) return false;
+        if(str.size() < 2 || str[0] != str.size() || str[1] != 0x03) return fail("bad string descriptor");
+    }
+
+    if(!parse_configuration(config)) return false;
+    if(!control(0x00, 0x09, config[5], 0, 0, none, NULL)) return false; // SET_CONFIGURATION
+    configured = true;
+
+    if(has_msd)
+    {
+        std::vector<uint8_t> max_lun;
+        if(!control(0xA1, 0xFE, 0, msd_interface, 1, max_lun, NULL)) return false; // GET_MAX_LUN
+        if(max_lun.size() != 1) return fail("GET_MAX_LUN didn't return a byte");
+    }
+    return true;
+}
+
+bool Host::parse_configuration(const std::vector<uint8_t> &config)
+{
+    uint8_t intf_class = 0, intf_num = 0;
+
+    has_cdc = has_msd = false;
+    for(size_t i = 0; i + 2 <= config.size(); i += config[i])
+    {
+        const uint8_t *d = &config[i];
+        if(d[0] < 2 || i + d[0] > config.size()) return fail("bad descriptor length in the configuration");
+        if(d[1] == 0x04 && d[0] >= 9) // Interface
+        {
+            intf_num = d[2];
+            intf_class = d[5];
+            if(intf_class == 0x02) cdc_com_interface = intf_num;
+            if(intf_class == 0x08) msd_interface = intf_num;
+        }
+        else if(d[1] == 0x05 && d[0] >= 7 && (d[3] & 0x03) == 0x02) // Bulk Endpoint
+        {
+            HostEndpoint ep = {(uint8_t)(d[2] & 0x0F), (uint16_t)(d[4] | (d[5] << 8))};
+            bool in = (d[2] & 0x80) != 0;
+            if(intf_class == 0x0A)
+            {
+                (in ? cdc_in : cdc_out) = ep;
+                has_cdc = cdc_in.ep && cdc_out.ep;
+            }
+            else if(intf_class == 0x08)
+            {
+                (in ? msd_in : msd_out) = ep;
+                has_msd = msd_in.ep && msd_out.ep;
+            }
+        }
+    }
+    return true;
+}
+
+bool Host::frames(uint32_t count)
+{
+    for(uint32_t i = 0; i < count; i++)
+    {
+        g_sie.sof();
+        g_sie.run_firmware();
+    }
+    return true;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** BULK TRANSFERS ***************************** */
+/* ************************************************************************** */
+
+bool Host::bulk_out(const HostEndpoint &ep, const uint8_t *data, uint32_t len)
+{
+    for(uint32_t off = 0; off < len; )
+    {
+        uint16_t     n = (len - off) < ep.size ? (uint16_t)(len - off) : ep.size;
+        SieHandshake hs = token_out(ep.ep, data + off, n, out_toggle[ep.ep]);
+        if(hs != SIE_ACK) return fail(std::string("bulk OUT answered with ") + handshake_name(hs));
+        out_toggle[ep.ep] ^= 1;
+        off += n;
+    }
+    return true;
+}
+
+bool Host::bulk_in(const HostEndpoint &ep, uint8_t *data, uint32_t max, uint32_t *actual)
+{
+    uint8_t  buf[MAX_PACKET];
+    uint16_t len;
+    uint8_t  toggle;
+
+    *actual = 0;
+    while(*actual < max)
+    {
+        SieHandshake hs = token_in(ep.ep, buf, &len, &toggle);
+        if(hs != SIE_ACK) return fail(std::string("bulk IN answered with ") + handshake_name(hs));
+        if(toggle != in_toggle[ep.ep]) return fail("bulk IN data toggle out of sequence");
+        in_toggle[ep.ep] ^= 1;
+        if(len > ep.size || *actual + len > max) return fail("bulk IN packet larger than expected");
+        memcpy(data + *actual, buf, len);
+        *actual += len;
+        if(len < ep.size) break;
+    }
+    return true;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************************* CDC ************************************ */
+/* ************************************************************************** */
+
+bool Host::cdc_line_coding(uint32_t baud)
+{
+    std::vector<uint8_t> coding(7, 0), check;
+
+    if(!configured || !has_cdc) return fail("no configured CDC function");
+    put_le32(&coding[0], baud);
+    coding[6] = 8;
+    if(!control(0x21, 0x20, 0, cdc_com_interface, 7, coding, NULL)) return false; // SET_LINE_CODING
+    if(!control(0xA1, 0x21, 0, cdc_com_interface, 7, check, NULL)) return false;  // GET_LINE_CODING
+    if(check != coding) return fail("GET_LINE_CODING doesn't match SET_LINE_CODING");
+    return true;
+}
+
+bool Host::cdc_line_state(uint16_t state)
+{
+    std::vector<uint8_t> none;
+
+    if(!configured || !has_cdc) return fail("no configured CDC function");
+    return control(0x21, 0x22, state, cdc_com_interface, 0, none, NULL); // SET_CONTROL_LINE_STATE
+}
+
+bool Host::cdc_write(uint32_t bytes)
+{
+    std::vector<uint8_t> data(bytes);
+
+    if(!configured || !has_cdc) return fail("no configured CDC function");
+    for(uint32_t i = 0; i < bytes; i++)
+    {
+        data[i] = cdc_pattern++;
+        cdc_expected.push_back(data[i]);
+    }
+    return bulk_out(cdc_out, data.data(), bytes);
+}
+
+bool Host::cdc_read(uint32_t bytes)
+{
+    std::vector<uint8_t> data(bytes + MAX_PACKET);
+    uint32_t got = 0, actual;
+
+    if(!configured || !has_cdc) return fail("no configured CDC function");
+    while(got < bytes)
+    {
+        // Ask for whole packets, the device decides where the transfer ends.
+        uint32_t want = ((bytes - got + cdc_in.size - 1) / cdc_in.size) * cdc_in.size;
+        if(!bulk_in(cdc_in, &data[got], want, &actual)) return false;
+        got += actual;
+    }
+    for(uint32_t i = 0; i < got; i++)
+    {
+        if(cdc_expected.empty()) return fail("CDC echoed more than was written");
+        if(data[i] != cdc_expected.front()) return fail("CDC echo doesn't match what was written");
+        cdc_expected.pop_front();
+    }
+    return true;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** MSD (BULK ONLY) ******************************* */
+/* ************************************************************************** */
+
+bool Host::msd_command(const uint8_t *cdb, uint8_t cdb_len, bool dir_in, uint8_t *data, uint32_t len, uint8_t *status)
+{
+    uint8_t  cbw[31] = {0};
+    uint8_t  csw[13];
+    uint32_t actual;
+
+    if(!configured || !has_msd) return fail("no configured MSD function");
+    put_le32(&cbw[0], 0x43425355); // "USBC"
+    put_le32(&cbw[4], ++msd_tag);
+    put_le32(&cbw[8], len);
+    cbw[12] = dir_in ? 0x80 : 0x00;
+    cbw[14] = cdb_len;
+    memcpy(&cbw[15], cdb, cdb_len);
+    if(!bulk_out(msd_out, cbw, sizeof(cbw))) return false;
+
+    if(len && dir_in)
+    {
+        if(!bulk_in(msd_in, data, len, &actual)) return false;
+        if(actual != len) return fail("MSD data phase was short");
+    }
+    else if(len)
+    {
+        if(!bulk_out(msd_out, data, len)) return false;
+    }
+
+    if(!bulk_in(msd_in, csw, sizeof(csw), &actual)) return false;
+    if(actual != sizeof(csw) || get_le32(&csw[0]) != 0x53425355) return fail("bad CSW");
+    if(get_le32(&csw[4]) != msd_tag) return fail("CSW tag doesn't match the CBW");
+    if(status)
+    {
+        *status = csw[12];
+        return true;
+    }
+    if(csw[12] != 0) return fail("CSW status isn't passed");
+    if(get_le32(&csw[8]) != 0) return fail("CSW residue isn't zero");
+    return true;
+}
+
+bool Host::msd_inquiry()
+{
+    uint8_t cdb[6] = {0x12, 0, 0, 0, 36, 0};
+    uint8_t data[36];
+
+    if(!msd_command(cdb, sizeof(cdb), true, data, sizeof(data), NULL)) return false;
+    if((data[0] & 0x1F) != 0x00) return fail("INQUIRY isn't a direct access device");
+    return true;
+}
+
+// The first TEST_UNIT_READY after a reset reports UNIT ATTENTION (medium may
+// have changed), a host reads the sense data and asks again.
+bool Host::msd_test_unit_ready()
+{
+    uint8_t cdb[6] = {0x00, 0, 0, 0, 0, 0};
+    uint8_t sense_cdb[6] = {0x03, 0, 0, 0, 18, 0};
+    uint8_t sense[18];
+    uint8_t status;
+
+    for(int tries = 0; tries < 2; tries++)
+    {
+        if(!msd_command(cdb, sizeof(cdb), true, NULL, 0, &status)) return false;
+        if(status == 0) return true;
+        if(!msd_command(sense_cdb, sizeof(sense_cdb), true, sense, sizeof(sense), NULL)) return false;
+        if((sense[2] & 0x0F) != 0x06) return fail("TEST_UNIT_READY failed without UNIT ATTENTION");
+    }
+    return fail("TEST_UNIT_READY still failing after UNIT ATTENTION");
+}
+
+bool Host::msd_read_capacity()
+{
+    uint8_t cdb[10] = {0x25, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    uint8_t data[8];
+
+    if(!msd_command(cdb, sizeof(cdb), true, data, sizeof(data), NULL)) return false;
+    if(get_be32(&data[4]) != 512) return fail("READ_CAPACITY block length isn't 512");
+    if(msd_shadow.size() < (get_be32(&data[0]) + 1) * 512) msd_shadow.resize((get_be32(&data[0]) + 1) * 512, 0);
+    return true;
+}
+
+bool Host::msd_read(uint32_t lba, uint16_t blocks)
+{
+    uint8_t              cdb[10] = {0x28, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    std::vector<uint8_t> data(blocks * 512);
+
+    put_be32(&cdb[2], lba);
+    cdb[7] = (uint8_t)(blocks >> 8);
+    cdb[8] = (uint8_t)blocks;
+    if(!msd_command(cdb, sizeof(cdb), true, data.data(), (uint32_t)data.size(), NULL)) return false;
+    if(msd_shadow.size() < (lba + blocks) * 512) msd_shadow.resize((lba + blocks) * 512, 0);
+    if(memcmp(data.data(), &msd_shadow[lba * 512], data.size()) != 0) return fail("READ_10 data doesn't match what was written");
+    return true;
+}
+
+bool Host::msd_write(uint32_t lba, uint16_t blocks)
+{
+    uint8_t              cdb[10] = {0x2A, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    std::vector<uint8_t> data(blocks * 512);
+
+    for(size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(msd_pattern++ * 7 + (i >> 9));
+    put_be32(&cdb[2], lba);
+    cdb[7] = (uint8_t)(blocks >> 8);
+    cdb[8] = (uint8_t)blocks;
+    if(!msd_command(cdb, sizeof(cdb), false, data.data(), (uint32_t)data.size(), NULL)) return false;
+    if(msd_shadow.size() < (lba + blocks) * 512) msd_shadow.resize((lba + blocks) * 512, 0);
+    memcpy(&msd_shadow[lba * 512], data.data(), data.size());
+    return true;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************* EP STATS ********************************* */
+/* ************************************************************************** */
+
+// Reads the usb_ep_counters_t of one Endpoint with the stats vendor request
+// (USE_EP_STATS and USE_STATS_REQUEST), clearing them, and checks them against
+// what this side saw ACKed. The device takes its copy when the request's SETUP
+// arrives, so that SETUP is in the EP0 OUT counts and the rest of the request
+// starts the next ones.
+bool Host::ep_stats(uint8_t ep_addr)
+{
+    uint8_t              ep = ep_addr & 0x0F, dir = (ep_addr & 0x80) ? 1 : 0;
+    HostEpCount          expected = ep_count[ep][dir];
+    std::vector<uint8_t> data;
+    uint32_t             bytes;
+    uint16_t             transactions;
+    char                 msg[160];
+
+    if(ep == 0 && dir == 0)
+    {
+        expected.transactions++;
+        expected.bytes += 8;
+    }
+    if(!control(0xC0, STATS_REQUEST_CODE, 1, ep_addr, 6, data, NULL)) return false;
+    if(data.size() != 6) return fail("stats request didn't return a usb_ep_counters_t");
+    bytes = get_le32(&data[0]);
+    transactions = (uint16_t)(data[4] | (data[5] << 8));
+
+    // What came after the copy was taken starts the next count.
+    ep_count[ep][dir].transactions -= expected.transactions;
+    ep_count[ep][dir].bytes -= expected.bytes;
+
+    if(bytes != expected.bytes || transactions != (uint16_t)expected.transactions)
+    {
+        snprintf(msg, sizeof(msg), "EP%u %s counted %u transactions, %u bytes, the bus had %u, %u", ep, dir ? "IN" : "OUT",
+                 transactions, bytes, (unsigned)expected.transactions, (unsigned)expected.bytes);
+        return fail(msg);
+    }
+    return true;
+}
+
+/* ************************************************************************** */
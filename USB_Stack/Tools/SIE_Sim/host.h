@@ -0,0 +1,103 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "sie.h"
+
+// Bus traffic for one script step, next to the firmware counters.
+struct HostStats
+{
+    uint64_t transactions; // Tokens that got ACK or STALL.
+    uint64_t naks;
+    uint64_t bytes;        // Data bytes moved either way, SETUP packets included.
+};
+
+// ACKed transactions and their data bytes on one Endpoint and direction, what
+// USE_EP_STATS should count for it.
+struct HostEpCount
+{
+    uint32_t transactions;
+    uint32_t bytes;
+};
+
+// A bulk Endpoint found in the configuration descriptor.
+struct HostEndpoint
+{
+    uint8_t  ep;
+    uint16_t size;
+};
+
+// The host side of the bus, a minimal USB host stack driving g_sie: control
+// transfers on EP0, enumeration, and the CDC ACM and Mass Storage (Bulk Only)
+// class protocols. Every call returns false with error set when the device
+// doesn't answer the way the USB and class specs say it should.
+class Host
+{
+public:
+    Host();
+
+    bool attach();
+    bool bus_reset();
+    bool enumerate();
+    bool frames(uint32_t count);
+
+    bool control(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex,
+                 uint16_t wLength, std::vector<uint8_t> &data, bool *stalled);
+
+    bool cdc_line_coding(uint32_t baud);
+    bool cdc_line_state(uint16_t state);
+    bool cdc_write(uint32_t bytes);
+    bool cdc_read(uint32_t bytes);
+
+    bool msd_inquiry();
+    bool msd_test_unit_ready();
+    bool msd_read_capacity();
+    bool msd_read(uint32_t lba, uint16_t blocks);
+    bool msd_write(uint32_t lba, uint16_t blocks);
+
+    bool ep_stats(uint8_t ep_addr);
+
+    bool        verbose;
+    HostStats   stats;
+    std::string error;
+
+private:
+    SieHandshake token_setup(const uint8_t *setup);
+    SieHandshake token_out(uint8_t ep, const uint8_t *data, uint16_t len, uint8_t toggle);
+    SieHandshake token_in(uint8_t ep, uint8_t *data, uint16_t *len, uint8_t *toggle);
+    void         bus_time();
+    bool         fail(const std::string &msg);
+
+    bool bulk_out(const HostEndpoint &ep, const uint8_t *data, uint32_t len);
+    bool bulk_in(const HostEndpoint &ep, uint8_t *data, uint32_t max, uint32_t *actual);
+    bool msd_command(const uint8_t *cdb, uint8_t cdb_len, bool dir_in, uint8_t *data, uint32_t len, uint8_t *status);
+    bool parse_configuration(const std::vector<uint8_t> &config);
+
+    uint8_t  address;
+    uint16_t ep0_size;
+    uint32_t tokens;
+    uint8_t  out_toggle[16];
+    uint8_t  in_toggle[16];
+
+    HostEpCount ep_count[16][2]; // [EP][0 OUT (SETUP included), 1 IN] since the last ep_stats.
+
+    bool         configured;
+    uint8_t      cdc_com_interface;
+    bool         has_cdc;
+    HostEndpoint cdc_out, cdc_in;
+    bool         has_msd;
+    uint8_t      msd_interface;
+    HostEndpoint msd_out, msd_in;
+    uint32_t     msd_tag;
+
+    std::deque<uint8_t>  cdc_expected; // Written and not read back yet.
+    uint8_t              cdc_pattern;
+    std::vector<uint8_t> msd_shadow;   // What the disk should hold.
+    uint32_t             msd_pattern;
+};
+
+#endif // HOST_H
@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "sie.h"
+#include "host.h"
+
+// One script line and what it cost.
+struct Step
+{
+    std::string name;
+    HostStats   bus;
+    uint64_t    blocks;
+    uint64_t    branches;
+};
+
+// A step from a --save file.
+struct BaselineStep
+{
+    std::string name;
+    uint64_t    blocks;
+    uint64_t    branches;
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  sie_sim [-v] [--save <file>] [--baseline <file>] [--tolerance N] <script>\n"
+            "options:\n"
+            "  -v                print every transaction\n"
+            "  --save <file>     write each step's counts as a baseline\n"
+            "  --baseline <file> compare with a saved baseline, exit 1 if a step got slower\n"
+            "  --tolerance N     percent a step's blocks may grow before it's a regression (0)\n"
+            "script commands, one per line, # starts a comment:\n"
+            "  attach | enumerate | reset | frames <n>\n"
+            "  control <bmRequestType> <bRequest> <wValue> <wIndex> <wLength> [data bytes...]\n"
+            "  control_stall <same as control>  the request must be STALLed\n"
+            "  cdc_line_coding <baud> | cdc_line_state <bits> | cdc_write <n> | cdc_read <n>\n"
+            "  msd_inquiry | msd_test_unit_ready | msd_read_capacity\n"
+            "  msd_read <lba> <blocks> | msd_write <lba> <blocks>\n"
+            "  ep_stats <ep address>  USE_EP_STATS counts match the bus, needs USE_STATS_REQUEST\n");
+}
+
+static std::vector<std::string> split(const std::string &line)
+{
+    std::vector<std::string> words;
+    size_t i = 0;
+
+    while(i < line.size())
+    {
+        if(line[i] == '#') break;
+        if(isspace((unsigned char)line[i]))
+        {
+            i++;
+            continue;
+        }
+        size_t j = i;
+        while(j < line.size() && !isspace((unsigned char)line[j])) j++;
+        words.push_back(line.substr(i, j - i));
+        i = j;
+    }
+    return words;
+}
+
+static uint32_t num(const std::vector<std::string> &w, size_t i)
+{
+    return (uint32_t)strtoul(w[i].c_str(), NULL, 0);
+}
+
+static bool run_command(Host &host, const std::vector<std::string> &w, std::string &error)
+{
+    const std::string &cmd = w[0];
+    size_t args = w.size() - 1;
+    bool ok = false;
+
+    if(cmd == "attach" && args == 0) ok = host.attach();
+    else if(cmd == "enumerate" && args == 0) ok = host.enumerate();
+    else if(cmd == "reset" && args == 0) ok = host.bus_reset();
+    else if(cmd == "frames" && args == 1) ok = host.frames(num(w, 1));
+    else if((cmd == "control" || cmd == "control_stall") && args >= 5)
+    {
+        std::vector<uint8_t> data;
+        bool stalled = false;
+        for(size_t i = 6; i < w.size(); i++) data.push_back((uint8_t)num(w, i));
+        ok = host.control((uint8_t)num(w, 1), (uint8_t)num(w, 2), (uint16_t)num(w, 3), (uint16_t)num(w, 4),
+                          (uint16_t)num(w, 5), data, &stalled);
+        if(ok && stalled != (cmd == "control_stall"))
+        {
+            host.error = stalled ? "control request STALLed" : "control request wasn't STALLed";
+            ok = false;
+        }
+    }
+    else if(cmd == "cdc_line_coding" && args == 1) ok = host.cdc_line_coding(num(w, 1));
+    else if(cmd == "cdc_line_state" && args == 1) ok = host.cdc_line_state((uint16_t)num(w, 1));
+    else if(cmd == "cdc_write" && args == 1) ok = host.cdc_write(num(w, 1));
+    else if(cmd == "cdc_read" && args == 1) ok = host.cdc_read(num(w, 1));
+    else if(cmd == "msd_inquiry" && args == 0) ok = host.msd_inquiry();
+    else if(cmd == "msd_test_unit_ready" && args == 0) ok = host.msd_test_unit_ready();
+    else if(cmd == "msd_read_capacity" && args == 0) ok = host.msd_read_capacity();
+    else if(cmd == "msd_read" && args == 2) ok = host.msd_read(num(w, 1), (uint16_t)num(w, 2));
+    else if(cmd == "msd_write" && args == 2) ok = host.msd_write(num(w, 1), (uint16_t)num(w, 2));
+    else if(cmd == "ep_stats" && args == 1) ok = host.ep_stats((uint8_t)num(w, 1));
+    else
+    {
+        error = "unknown command or wrong number of arguments";
+        return false;
+    }
+    if(!ok) error = host.error;
+    return ok;
+}
+
+static bool load_baseline(const char *path, std::vector<BaselineStep> &steps)
+{
+    FILE *f = fopen(path, "r");
+    char line[512];
+
+    if(f == NULL) return false;
+    while(fgets(line, sizeof(line), f))
+    {
+        BaselineStep s;
+        unsigned long long blocks, branches;
+        int name_at;
+        if(line[0] == '#') continue;
+        if(sscanf(line, "%llu %llu %n", &blocks, &branches, &name_at) < 2) continue;
+        s.blocks = blocks;
+        s.branches = branches;
+        s.name = line + name_at;
+        while(!s.name.empty() && (s.name.back() == '\n' || s.name.back() == '\r')) s.name.pop_back();
+        steps.push_back(s);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool save_baseline(const char *path, const std::vector<Step> &steps)
+{
+    FILE *f = fopen(path, "w");
+
+    if(f == NULL) return false;
+    fprintf(f, "# sie_sim baseline: blocks branches step\n");
+    for(const Step &s : steps) fprintf(f, "%llu %llu %s\n", (unsigned long long)s.blocks, (unsigned long long)s.branches, s.name.c_str());
+    fclose(f);
+    return true;
+}
+
+static void print_table(const std::vector<Step> &steps)
+{
+    Step total = {"total", {0, 0, 0}, 0, 0};
+
+    printf("%-32s %8s %8s %9s %10s %10s %10s\n", "step", "trans", "NAKs", "bytes", "blocks", "branches", "blocks/tr");
+    for(const Step &s : steps)
+    {
+        printf("%-32.32s %8llu %8llu %9llu %10llu %10llu %10.1f\n", s.name.c_str(),
+               (unsigned long long)s.bus.transactions, (unsigned long long)s.bus.naks, (unsigned long long)s.bus.bytes,
+               (unsigned long long)s.blocks, (unsigned long long)s.branches,
+               s.bus.transactions ? (double)s.blocks / s.bus.transactions : 0.0);
+        total.bus.transactions += s.bus.transactions;
+        total.bus.naks += s.bus.naks;
+        total.bus.bytes += s.bus.bytes;
+        total.blocks += s.blocks;
+        total.branches += s.branches;
+    }
+    printf("%-32s %8llu %8llu %9llu %10llu %10llu %10.1f\n", total.name.c_str(),
+           (unsigned long long)total.bus.transactions, (unsigned long long)total.bus.naks, (unsigned long long)total.bus.bytes,
+           (unsigned long long)total.blocks, (unsigned long long)total.branches,
+           total.bus.transactions ? (double)total.blocks / total.bus.transactions : 0.0);
+}
+
+// Counts are deterministic, so any growth past the tolerance is a real change.
+static int compare(const std::vector<Step> &steps, const std::vector<BaselineStep> &base, double tolerance)
+{
+    int regressions = 0;
+
+    if(steps.size() != base.size()) fprintf(stderr, "baseline has %zu steps, the script has %zu\n", base.size(), steps.size());
+    for(size_t i = 0; i < steps.size() && i < base.size(); i++)
+    {
+        double limit = (double)base[i].blocks * (1.0 + tolerance / 100.0);
+        if(steps[i].name != base[i].name)
+        {
+            fprintf(stderr, "step %zu is \"%s\" in the baseline, \"%s\" now\n", i + 1, base[i].name.c_str(), steps[i].name.c_str());
+            regressions++;
+        }
+        else if((double)steps[i].blocks > limit)
+        {
+            printf("REGRESSION %-32s %10llu -> %10llu blocks (%+.1f%%)\n", steps[i].name.c_str(),
+                   (unsigned long long)base[i].blocks, (unsigned long long)steps[i].blocks,
+                   base[i].blocks ? 100.0 * ((double)steps[i].blocks - base[i].blocks) / base[i].blocks : 100.0);
+            regressions++;
+        }
+        else if(steps[i].blocks < base[i].blocks)
+        {
+            printf("improved   %-32s %10llu -> %10llu blocks (%+.1f%%)\n", steps[i].name.c_str(),
+                   (unsigned long long)base[i].blocks, (unsigned long long)steps[i].blocks,
+                   100.0 * ((double)steps[i].blocks - base[i].blocks) / base[i].blocks);
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *script_path = NULL, *save_path = NULL, *baseline_path = NULL;
+    double tolerance = 0;
+    std::vector<Step> steps;
+    Host host;
+    FILE *script;
+    char line[1024];
+    int line_num = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "-v") host.verbose = true;
+        else if(arg == "--save" && has_value) save_path = argv[++i];
+        else if(arg == "--baseline" && has_value) baseline_path = argv[++i];
+        else if(arg == "--tolerance" && has_value) tolerance = strtod(argv[++i], NULL);
+        else if(arg[0] != '-' && script_path == NULL) script_path = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if(script_path == NULL)
+    {
+        usage();
+        return 1;
+    }
+    script = fopen(script_path, "r");
+    if(script == NULL)
+    {
+        fprintf(stderr, "can't open %s\n", script_path);
+        return 1;
+    }
+
+    while(fgets(line, sizeof(line), script))
+    {
+        std::vector<std::string> words = split(line);
+        std::string error;
+        Step step;
+
+        line_num++;
+        if(words.empty()) continue;
+        step.name = words[0];
+        for(size_t i = 1; i < words.size(); i++) step.name += " " + words[i];
+        if(host.verbose) printf("%s\n", step.name.c_str());
+
+        memset(&host.stats, 0, sizeof(host.stats));
+        step.blocks = g_sie.counters.blocks;
+        step.branches = g_sie.counters.branches;
+        if(!run_command(host, words, error))
+        {
+            fprintf(stderr, "%s:%d: %s: %s\n", script_path, line_num, step.name.c_str(), error.c_str());
+            fclose(script);
+            return 2;
+        }
+        step.bus = host.stats;
+        step.blocks = g_sie.counters.blocks - step.blocks;
+        step.branches = g_sie.counters.branches - step.branches;
+        steps.push_back(step);
+    }
+    fclose(script);
+
+    print_table(steps);
+
+    if(save_path && !save_baseline(save_path, steps))
+    {
+        fprintf(stderr, "can't write %s\n", save_path);
+        return 1;
+    }
+    if(baseline_path)
+    {
+        std::vector<BaselineStep> base;
+        if(!load_baseline(baseline_path, base))
+        {
+            fprintf(stderr, "can't open %s\n", baseline_path);
+            return 1;
+        }
+        if(compare(steps, base, tolerance)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include "sie.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// SFR bits the model acts on, the same positions as on the PIC.
+#define UCON_PPBRST  0x40
+#define UCON_SE0     0x20
+#define UCON_PKTDIS  0x10
+#define UIR_SOFIF    0x40
+#define UIR_STALLIF  0x20
+#define UIR_TRNIF    0x08
+#define UIR_URSTIF   0x01
+#define UEP_EPOUTEN  0x04
+#define UEP_EPINEN   0x02
+#define UEP_EPCONDIS 0x08
+#define UEP_EPSTALL  0x01
+#define INTCON_GIE   0x80
+#define INTCON_PEIE  0x40
+#define PIx3_USB     0x04
+#define OSCSTAT_PLLRDY 0x40
+#define OSCCON2_PLLRDY 0x80
+#define T1CON_TMR1ON   0x01
+
+// BD STAT bits.
+#define BD_UOWN   0x80
+#define BD_DTS    0x40
+#define BD_DTSEN  0x08
+#define BD_BSTALL 0x04
+
+#define PID_OUT   0x1
+#define PID_IN    0x9
+#define PID_SETUP 0xD
+
+#define USB_RAM_START 0x400
+#define USB_RAM_END   0x7FF
+
+#define PPB_DIS    0
+#define PPB_0_OUT  1
+#define PPB_ALL_EP 2
+#define PPB_1_15   3
+
+#define USTAT_FIFO_SIZE 4
+
+// Passes of the ISR in one run_firmware() before a stuck interrupt is reported.
+#define MAX_ISR_PASSES 64
+
+uint8_t g_usb_sim_ram[SIM_RAM_SIZE];
+Sie g_sie;
+
+static void fatal(const char *msg, int ep)
+{
+    fprintf(stderr, "SIE: %s (EP%d)\n", msg, ep);
+    exit(2);
+}
+
+Sie::Sie()
+{
+    counters.blocks = 0;
+    counters.branches = 0;
+    power_on();
+}
+
+void Sie::power_on()
+{
+    memset(&regs, 0, sizeof(regs));
+    memset(g_usb_sim_ram, 0, sizeof(g_usb_sim_ram));
+    memset(ppb, 0, sizeof(ppb));
+    ustat_fifo.clear();
+    ustat_latched = false;
+    frame = 0;
+}
+
+void Sie::bus_reset()
+{
+    regs.UADDR = 0;
+    regs.UIR &= ~UIR_TRNIF;
+    regs.UIR |= UIR_URSTIF;
+    ustat_fifo.clear();
+    ustat_latched = false;
+    memset(ppb, 0, sizeof(ppb));
+}
+
+void Sie::sof()
+{
+    frame = (frame + 1) & 0x7FF;
+    regs.UFRML = (uint8_t)frame;
+    regs.UFRMH = (uint8_t)(frame >> 8);
+    regs.UIR |= UIR_SOFIF;
+}
+
+// What the hardware does on its own between two firmware accesses.
+void Sie::update()
+{
+    if(regs.UCON & UCON_PPBRST) memset(ppb, 0, sizeof(ppb));
+
+    // Clearing TRNIF advances the USTAT FIFO, the next entry shows up straight away.
+    if(ustat_latched && !(regs.UIR & UIR_TRNIF))
+    {
+        ustat_fifo.pop_front();
+        ustat_latched = false;
+    }
+    if(!ustat_latched && !ustat_fifo.empty())
+    {
+        regs.USTAT = ustat_fifo.front();
+        regs.UIR |= UIR_TRNIF;
+        ustat_latched = true;
+    }
+
+    regs.UCON &= ~UCON_SE0;
+    regs.OSCSTAT |= OSCSTAT_PLLRDY;
+    regs.OSCCON2 |= OSCCON2_PLLRDY;
+
+    // TMR1 counts basic blocks, so USE_TRACE and USE_TIMESTAMP times are in the same unit as the counts.
+    if(regs.T1CON & T1CON_TMR1ON)
+    {
+        regs.TMR1L = (uint8_t)counters.blocks;
+        regs.TMR1H = (uint8_t)(counters.blocks >> 8);
+    }
+    if((regs.UIR & regs.UIE & 0x7F) || (regs.UEIR & regs.UEIE)) regs.PIR3 |= PIx3_USB;
+}
+
+void Sie::run_firmware()
+{
+    for(int i = 0; ; i++)
+    {
+        update();
+        if((regs.INTCON & (INTCON_GIE | INTCON_PEIE)) != (INTCON_GIE | INTCON_PEIE)) break;
+        if(!(regs.PIE3 & regs.PIR3 & PIx3_USB)) break;
+        if(i == MAX_ISR_PASSES) fatal("USB interrupt never cleared", 0);
+        firmware_isr();
+    }
+    firmware_loop();
+}
+
+int Sie::bd_index(uint8_t ep, uint8_t dir)
+{
+    uint8_t p = ppb[ep][dir];
+
+    switch(regs.UCFG & 0x03)
+    {
+        case PPB_DIS:
+            return (ep * 2) + dir;
+        case PPB_0_OUT:
+            if(ep == 0) return dir ? 2 : p;
+            return (ep * 2) + 1 + dir;
+        case PPB_ALL_EP:
+            return (ep * 4) + (dir * 2) + p;
+        default:
+            if(ep == 0) return dir;
+            return (ep * 4) + (dir * 2) + p - 2;
+    }
+}
+
+bool Sie::fifo_full() const
+{
+    return ustat_fifo.size() >= USTAT_FIFO_SIZE;
+}
+
+void Sie::complete(uint8_t ep, uint8_t dir, int bd, uint8_t pid, uint16_t cnt)
+{
+    uint8_t *p_bd = &g_usb_sim_ram[SIM_BDT_ADDR + (bd * 4)];
+    uint8_t  mode = regs.UCFG & 0x03;
+    bool     pingpong;
+
+    p_bd[0] = (uint8_t)((p_bd[0] & BD_DTS) | (pid << 2) | ((cnt >> 8) & 0x03)); // UOWN cleared.
+    p_bd[1] = (uint8_t)cnt;
+
+    ustat_fifo.push_back((uint8_t)((ep << 3) | (dir << 2) | (ppb[ep][dir] << 1)));
+
+    pingpong = (mode == PPB_ALL_EP) || (mode == PPB_1_15 && ep != 0) || (mode == PPB_0_OUT && ep == 0 && dir == 0);
+    if(pingpong) ppb[ep][dir] ^= 1;
+    update();
+}
+
+SieHandshake Sie::setup(uint8_t addr, const uint8_t *data)
+{
+    uint8_t *p_bd;
+    uint16_t adr;
+    int      bd;
+
+    if(addr != regs.UADDR || !(regs.UEP[0] & UEP_EPOUTEN) || (regs.UEP[0] & UEP_EPCONDIS)) return SIE_NONE;
+    if(fifo_full()) return SIE_NAK;
+    bd = bd_index(0, 0);
+    p_bd = &g_usb_sim_ram[SIM_BDT_ADDR + (bd * 4)];
+    if(!(p_bd[0] & BD_UOWN)) return SIE_NAK;
+    adr = p_bd[2] | (p_bd[3] << 8);
+    if(adr < USB_RAM_START || adr + 8 - 1 > USB_RAM_END) fatal("BD ADR outside USB RAM", 0);
+    memcpy(&g_usb_sim_ram[adr], data, 8);
+
+    // A SETUP clears a stalled EP0 IN and holds off EP0 until the firmware clears PKTDIS.
+    int in_bds = (regs.UCFG & 0x03) == PPB_ALL_EP ? 2 : 1;
+    int in_bd  = (regs.UCFG & 0x03) == PPB_ALL_EP ? 2 : bd_index(0, 1);
+    for(int i = in_bd; i < in_bd + in_bds; i++)
+    {
+        uint8_t *p_in = &g_usb_sim_ram[SIM_BDT_ADDR + (i * 4)];
+        if(p_in[0] & BD_BSTALL) p_in[0] = 0;
+    }
+    regs.UCON |= UCON_PKTDIS;
+
+    complete(0, 0, bd, PID_SETUP, 8);
+    return SIE_ACK;
+}
+
+SieHandshake Sie::out(uint8_t addr, uint8_t ep, uint8_t toggle, const uint8_t *data, uint16_t len)
+{
+    uint8_t *p_bd;
+    uint16_t adr, size;
+    int      bd;
+
+    if(addr != regs.UADDR || ep > 15 || !(regs.UEP[ep] & UEP_EPOUTEN)) return SIE_NONE;
+    if(regs.UEP[ep] & UEP_EPSTALL) return SIE_STALL;
+    if(ep == 0 && (regs.UCON & UCON_PKTDIS)) return SIE_NAK;
+    if(fifo_full()) return SIE_NAK;
+    bd = bd_index(ep, 0);
+    p_bd = &g_usb_sim_ram[SIM_BDT_ADDR + (bd * 4)];
+    if(!(p_bd[0] & BD_UOWN)) return SIE_NAK;
+    if(p_bd[0] & BD_BSTALL)
+    {
+        regs.UIR |= UIR_STALLIF;
+        return SIE_STALL;
+    }
+    if((p_bd[0] & BD_DTSEN) && ((p_bd[0] & BD_DTS) ? 1 : 0) != toggle) return SIE_ACK; // Resent packet, dropped.
+
+    size = p_bd[1] | ((p_bd[0] & 0x03) << 8);
+    if(len > size) fatal("OUT packet larger than the BD's buffer", ep);
+    adr = p_bd[2] | (p_bd[3] << 8);
+    if(len && (adr < USB_RAM_START || adr + len - 1 > USB_RAM_END)) fatal("BD ADR outside USB RAM", ep);
+    memcpy(&g_usb_sim_ram[adr], data, len);
+
+    complete(ep, 0, bd, PID_OUT, len);
+    return SIE_ACK;
+}
+
+SieHandshake Sie::in(uint8_t addr, uint8_t ep, uint8_t *data, uint16_t *len, uint8_t *toggle)
+{
+    uint8_t *p_bd;
+    uint16_t adr, cnt;
+    int      bd;
+
+    if(addr != regs.UADDR || ep > 15 || !(regs.UEP[ep] & UEP_EPINEN)) return SIE_NONE;
+    if(regs.UEP[ep] & UEP_EPSTALL) return SIE_STALL;
+    if(ep == 0 && (regs.UCON & UCON_PKTDIS)) return SIE_NAK;
+    if(fifo_full()) return SIE_NAK;
+    bd = bd_index(ep, 1);
+    p_bd = &g_usb_sim_ram[SIM_BDT_ADDR + (bd * 4)];
+    if(!(p_bd[0] & BD_UOWN)) return SIE_NAK;
+    if(p_bd[0] & BD_BSTALL)
+    {
+        regs.UIR |= UIR_STALLIF;
+        return SIE_STALL;
+    }
+
+    cnt = p_bd[1] | ((p_bd[0] & 0x03) << 8);
+    if(cnt > 1023) fatal("IN BD count over 1023", ep);
+    adr = p_bd[2] | (p_bd[3] << 8);
+    if(cnt && (adr < USB_RAM_START || adr + cnt - 1 > USB_RAM_END)) fatal("BD ADR outside USB RAM", ep);
+    memcpy(data, &g_usb_sim_ram[adr], cnt);
+    *len = cnt;
+    *toggle = (p_bd[0] & BD_DTS) ? 1 : 0;
+
+    complete(ep, 1, bd, PID_IN, cnt);
+    return SIE_ACK;
+}
+
+extern "C"
+{
+sie_regs_t* sim_sie(void)
+{
+    g_sie.update();
+    return &g_sie.regs;
+}
+
+// The firmware is built with -fsanitize-coverage=trace-pc,trace-cmp, the
+// compiler calls these from every basic block and every compare.
+void __sanitizer_cov_trace_pc(void)
+{
+    g_sie.counters.blocks++;
+}
+
+void __sanitizer_cov_trace_cmp1(uint8_t, uint8_t)   { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_cmp2(uint16_t, uint16_t) { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_cmp4(uint32_t, uint32_t) { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_cmp8(uint64_t, uint64_t) { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_const_cmp1(uint8_t, uint8_t)   { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_const_cmp2(uint16_t, uint16_t) { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_const_cmp4(uint32_t, uint32_t) { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_const_cmp8(uint64_t, uint64_t) { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_cmpf(float, float)   { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_cmpd(double, double) { g_sie.counters.branches++; }
+void __sanitizer_cov_trace_switch(uint64_t, uint64_t *) { g_sie.counters.branches++; }
+}
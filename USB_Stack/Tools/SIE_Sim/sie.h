@@ -0,0 +1,66 @@
+#ifndef SIE_H
+#define SIE_H
+
+#include <stdint.h>
+#include <deque>
+
+#include "sie_regs.h"
+
+// What the SIE answered a token with. NONE is no handshake at all (wrong
+// address, Endpoint not enabled, or the host sent something the device can't
+// take), the host model treats it as an error.
+enum SieHandshake
+{
+    SIE_ACK,
+    SIE_NAK,
+    SIE_STALL,
+    SIE_NONE
+};
+
+// Counted by the coverage hooks in sie.cpp while firmware code runs.
+struct SieCounters
+{
+    uint64_t blocks;   // Basic blocks entered (-fsanitize-coverage=trace-pc).
+    uint64_t branches; // Compares and switches (-fsanitize-coverage=trace-cmp).
+};
+
+// The PIC18F25K50 SIE as the stack sees it: the SFRs in sie_regs_t, the BDT
+// at SIM_BDT_ADDR and the 4 entry USTAT FIFO. Tokens from the host model are
+// answered the way the hardware would, from the BD the Endpoint's ping-pong
+// pointer selects.
+class Sie
+{
+public:
+    Sie();
+
+    void power_on();
+    void bus_reset();
+    void sof();
+
+    SieHandshake setup(uint8_t addr, const uint8_t *data);
+    SieHandshake out(uint8_t addr, uint8_t ep, uint8_t toggle, const uint8_t *data, uint16_t len);
+    SieHandshake in(uint8_t addr, uint8_t ep, uint8_t *data, uint16_t *len, uint8_t *toggle);
+
+    // Runs the ISR for as long as the USB interrupt is pending, then one pass
+    // of the main loop, like the PIC between two tokens.
+    void run_firmware();
+
+    void update();
+
+    sie_regs_t  regs;
+    SieCounters counters;
+    uint16_t    frame;
+
+private:
+    int  bd_index(uint8_t ep, uint8_t dir);
+    bool fifo_full() const;
+    void complete(uint8_t ep, uint8_t dir, int bd, uint8_t pid, uint16_t cnt);
+
+    uint8_t             ppb[16][2];
+    std::deque<uint8_t> ustat_fifo;
+    bool                ustat_latched;
+};
+
+extern Sie g_sie;
+
+#endif // SIE_H
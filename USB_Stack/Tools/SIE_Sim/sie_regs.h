@@ -0,0 +1,58 @@
+#ifndef SIE_REGS_H
+#define SIE_REGS_H
+
+#include <stdint.h>
+
+// The boundary between the firmware (C, built with the stack's headers) and
+// the simulator (C++, which only sees raw bytes). Firmware/xc.h maps the SFR
+// names onto sie_regs_t, the BDT and the EP buffers live in g_usb_sim_ram.
+
+#define SIM_RAM_SIZE 0x800 // PIC18F25K50 data memory, USB RAM is 0x400 to 0x7FF.
+#define SIM_BDT_ADDR 0x400
+
+typedef struct
+{
+    uint8_t UCON;
+    uint8_t UCFG;
+    uint8_t UIR;
+    uint8_t UIE;
+    uint8_t UEIR;
+    uint8_t UEIE;
+    uint8_t USTAT;
+    uint8_t UADDR;
+    uint8_t UFRML;
+    uint8_t UFRMH;
+    uint8_t UEP[16];
+    uint8_t INTCON;
+    uint8_t PIE3;
+    uint8_t PIR3;
+    uint8_t IPR3;
+    uint8_t OSCCON;
+    uint8_t OSCCON2;
+    uint8_t OSCSTAT;
+    uint8_t ACTCON;
+    uint8_t TMR1L; // TMR1H follows, Firmware/xc.h reads TMR1 as a uint16_t.
+    uint8_t TMR1H;
+    uint8_t T1CON;
+}sie_regs_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint8_t g_usb_sim_ram[SIM_RAM_SIZE];
+
+// Every SFR access from the firmware goes through here, so the SIE can apply
+// what the hardware would have done since the last access (USTAT FIFO, PPBRST).
+sie_regs_t* sim_sie(void);
+
+// Firmware/firmware.c
+void firmware_init(void);
+void firmware_isr(void);
+void firmware_loop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIE_REGS_H */
@@ -0,0 +1,42 @@
+#-------------------------------------------------
+# Stream Capture, streams a bulk or interrupt IN
+# Endpoint into a memory mapped ring file.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = stream_capture
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+        stream_capture.cpp \
+        stream_ring.cpp
+
+HEADERS  += stream_capture.h \
+         stream_ring.h
+
+#-------------------------------------------------
+# libusb-1.0
+#-------------------------------------------------
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += libusb-1.0
+win32: LIBS += -lusb-1.0
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
@@ -0,0 +1,196 @@
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "stream_capture.h"
+#include "stream_ring.h"
+
+struct Options
+{
+    CaptureOptions capture;
+    std::string    ring;
+    std::string    raw;         // --follow: also save the packets.
+    bool           follow = false;
+    bool           stats = false;
+    uint32_t       seconds = 0; // 0 runs until Ctrl+C.
+};
+
+static volatile sig_atomic_t m_quit = 0;
+
+static void on_signal(int)
+{
+    m_quit = 1;
+}
+
+static void die(const char *msg, const std::string &what = "")
+{
+    fprintf(stderr, "stream_capture: %s%s%s\n", msg, what.empty() ? "" : ": ", what.c_str());
+    exit(1);
+}
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  stream_capture <ring file> [--pid 0056] [--vid 04d8] [--ep 0x81] [--slots N]\n"
+            "                 [--transfers N] [--packets N] [--seq offset:bytes] [--seconds N]\n"
+            "  stream_capture <ring file> --follow [--raw file]\n"
+            "  stream_capture <ring file> --stats\n"
+            "Streams a bulk or interrupt IN Endpoint into a memory mapped ring file that\n"
+            "other processes read as it fills (RingReader in stream_ring.h). --transfers\n"
+            "are kept in flight, each --packets long, and the ring holds --slots packets.\n"
+            "--seq gives where each packet keeps a sequence number so gaps are counted,\n"
+            "0:1 for the ADC capture of the Vendor Stream Example (VENDOR_ADC).\n"
+            "--follow reads a ring another stream_capture is writing, --stats prints its\n"
+            "counters.\n");
+}
+
+static uint32_t number(const char *s)
+{
+    char *end;
+    uint32_t val = (uint32_t)strtoul(s, &end, 0);
+
+    if(*s == 0 || *end != 0) die("not a number", s);
+    return val;
+}
+
+// mb_per_s is left out if it's negative.
+static void print_stats(const RingHeader &hdr, double mb_per_s)
+{
+    printf("%llu packets", (unsigned long long)hdr.packets.load());
+    if(mb_per_s >= 0) printf(", %.3f MB/s", mb_per_s);
+    printf(", %llu gaps (%llu missing), %llu errors\n", (unsigned long long)hdr.gaps.load(),
+           (unsigned long long)hdr.missing.load(), (unsigned long long)hdr.errors.load());
+}
+
+static void capture(const Options &opt)
+{
+    StreamCapture cap;
+    auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    uint64_t last_bytes = 0;
+
+    if(!cap.open(opt.capture, opt.ring)) die(cap.error.c_str());
+    if(!cap.start()) die(cap.error.c_str());
+    while(!m_quit)
+    {
+        auto now = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(now - last).count();
+
+        if(!cap.poll(100)) break;
+        if(secs < 1.0) continue;
+        print_stats(cap.stats(), (cap.stats().bytes.load() - last_bytes) / secs / 1e6);
+        fflush(stdout);
+        last = now;
+        last_bytes = cap.stats().bytes.load();
+        if(opt.seconds && now - start >= std::chrono::seconds(opt.seconds)) break;
+    }
+    if(!cap.error.empty()) fprintf(stderr, "stream_capture: %s\n", cap.error.c_str());
+    cap.stop();
+    print_stats(cap.stats(), -1);
+}
+
+static void print_read(uint64_t packets, uint64_t torn, uint64_t skipped)
+{
+    printf("read %llu packets, %llu overwritten while read, %llu skipped behind\n", (unsigned long long)packets,
+           (unsigned long long)torn, (unsigned long long)skipped);
+    fflush(stdout);
+}
+
+// A reader of the ring, counting what it sees and saving it with --raw.
+static void follow(const Options &opt)
+{
+    RingReader reader;
+    const RingSlot *slot;
+    const uint8_t *data;
+    FILE *raw = NULL;
+    uint64_t packets = 0, torn = 0;
+    auto last = std::chrono::steady_clock::now();
+
+    if(!reader.open(opt.ring)) die(reader.error.c_str());
+    if(!opt.raw.empty() && !(raw = fopen(opt.raw.c_str(), "wb"))) die("can't write", opt.raw);
+    while(!m_quit)
+    {
+        auto now = std::chrono::steady_clock::now();
+        bool got = reader.next(slot, data);
+
+        if(got)
+        {
+            if(raw) fwrite(data, 1, slot->len, raw);
+            if(reader.valid()) packets++;
+            else torn++;
+        }
+        if(now - last >= std::chrono::seconds(1))
+        {
+            print_read(packets, torn, reader.overruns());
+            last = now;
+        }
+        if(!got)
+        {
+            if(!reader.running()) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    print_read(packets, torn, reader.overruns());
+    if(raw) fclose(raw);
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+
+    if(argc < 2 || argv[1][0] == '-')
+    {
+        usage();
+        return 1;
+    }
+    opt.ring = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--vid" && has_value) opt.capture.vid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--pid" && has_value) opt.capture.pid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--ep" && has_value) opt.capture.ep = (uint8_t)number(argv[++i]);
+        else if(arg == "--slots" && has_value) opt.capture.slots = number(argv[++i]);
+        else if(arg == "--transfers" && has_value) opt.capture.transfers = number(argv[++i]);
+        else if(arg == "--packets" && has_value) opt.capture.packets = number(argv[++i]);
+        else if(arg == "--seconds" && has_value) opt.seconds = number(argv[++i]);
+        else if(arg == "--raw" && has_value) opt.raw = argv[++i];
+        else if(arg == "--follow") opt.follow = true;
+        else if(arg == "--stats") opt.stats = true;
+        else if(arg == "--seq" && has_value)
+        {
+            std::string val = argv[++i];
+            size_t colon = val.find(':');
+
+            if(colon == std::string::npos) die("--seq takes offset:bytes", val);
+            opt.capture.seq_offset = number(val.substr(0, colon).c_str());
+            opt.capture.seq_bytes = number(val.substr(colon + 1).c_str());
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    if(opt.stats)
+    {
+        RingReader reader;
+
+        if(!reader.open(opt.ring)) die(reader.error.c_str());
+        print_stats(reader.header(), -1);
+    }
+    else if(opt.follow) follow(opt);
+    else capture(opt);
+    return 0;
+}
@@ -0,0 +1,251 @@
+#include "stream_capture.h"
+
+#include <chrono>
+
+#include <libusb.h>
+
+static void LIBUSB_CALL transfer_done(libusb_transfer *transfer)
+{
+    ((StreamCapture*)transfer->user_data)->completed(transfer);
+}
+
+StreamCapture::StreamCapture() : ctx(NULL), dev(NULL), interface(-1), slot_size(0), next_slot(0),
+                                 expected(0), have_seq(false), gone(false), in_flight(0)
+{
+}
+
+StreamCapture::~StreamCapture()
+{
+    close();
+}
+
+bool StreamCapture::fail(const std::string &msg)
+{
+    error = msg;
+    return false;
+}
+
+bool StreamCapture::open(const CaptureOptions &options, const std::string &path)
+{
+    uint8_t type;
+    int r;
+
+    close();
+    opt = options;
+    if(!opt.packets || (opt.packets & (opt.packets - 1))) return fail("packets per transfer must be a power of 2");
+    if(opt.seq_bytes > 4) return fail("a sequence number is 1 to 4 bytes");
+    if(!opt.transfers) return fail("at least one transfer has to be in flight");
+    if(libusb_init(&ctx) != 0) return fail("libusb_init failed");
+    dev = libusb_open_device_with_vid_pid(ctx, opt.vid, opt.pid);
+    if(!dev) return fail("device not found (or no permission)");
+    if(!find_endpoint(type, interface)) return false;
+    if(type != LIBUSB_TRANSFER_TYPE_BULK && type != LIBUSB_TRANSFER_TYPE_INTERRUPT) return fail("only bulk and interrupt Endpoints can be captured");
+    libusb_set_auto_detach_kernel_driver(dev, 1);
+    if((r = libusb_claim_interface(dev, interface)) != 0)
+    {
+        interface = -1;
+        return fail(std::string("can't claim the interface: ") + libusb_error_name(r));
+    }
+    if((r = libusb_get_max_packet_size(libusb_get_device(dev), opt.ep)) <= 0) return fail("no max packet size for the Endpoint");
+    slot_size = (uint32_t)r;
+
+    if(!ring.create(path, slot_size, opt.slots, opt.transfers * opt.packets)) return fail(ring.error);
+
+    xfers.resize(opt.transfers);
+    for(Xfer &x : xfers)
+    {
+        x.done = false;
+        if(!(x.transfer = libusb_alloc_transfer(0))) return fail("libusb_alloc_transfer failed");
+        if(type == LIBUSB_TRANSFER_TYPE_BULK) libusb_fill_bulk_transfer(x.transfer, dev, opt.ep, NULL, 0, transfer_done, this, 0);
+        else libusb_fill_interrupt_transfer(x.transfer, dev, opt.ep, NULL, 0, transfer_done, this, 0);
+    }
+    return true;
+}
+
+void StreamCapture::close()
+{
+    if(in_flight) stop();
+    for(Xfer &x : xfers) libusb_free_transfer(x.transfer);
+    xfers.clear();
+    order.clear();
+    ring.close();
+    if(dev)
+    {
+        if(interface >= 0) libusb_release_interface(dev, interface);
+        libusb_close(dev);
+    }
+    if(ctx) libusb_exit(ctx);
+    dev = NULL;
+    ctx = NULL;
+    interface = -1;
+}
+
+// The interface and type of opt.ep in the active configuration.
+bool StreamCapture::find_endpoint(uint8_t &type, int &number)
+{
+    libusb_config_descriptor *config;
+    bool found = false;
+
+    if(libusb_get_active_config_descriptor(libusb_get_device(dev), &config) != 0) return fail("can't read the configuration");
+    for(int i = 0; i < config->bNumInterfaces && !found; i++)
+    {
+        for(int a = 0; a < config->interface[i].num_altsetting && !found; a++)
+        {
+            const libusb_interface_descriptor &alt = config->interface[i].altsetting[a];
+
+            for(int e = 0; e < alt.bNumEndpoints; e++)
+            {
+                if(alt.endpoint[e].bEndpointAddress != opt.ep) continue;
+                type   = alt.endpoint[e].bmAttributes & 0x03;
+                number = alt.bInterfaceNumber;
+                found  = true;
+                break;
+            }
+        }
+    }
+    libusb_free_config_descriptor(config);
+    return found ? true : fail("the Endpoint isn't in the active configuration");
+}
+
+bool StreamCapture::start()
+{
+    RingHeader *hdr = ring.header();
+
+    if(!hdr) return fail("not open");
+    next_slot = hdr->head.load();
+    have_seq  = false;
+    gone      = false;
+    hdr->running.store(1, std::memory_order_release);
+    for(Xfer &x : xfers)
+    {
+        if(!submit(&x))
+        {
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+// The transfer reads into opt.packets slots of the ring, which never wrap
+// because the slot count is a multiple of it.
+bool StreamCapture::submit(Xfer *x)
+{
+    int r;
+
+    x->first = next_slot;
+    x->done  = false;
+    x->transfer->buffer = ring.data(next_slot);
+    x->transfer->length = (int)(opt.packets * slot_size);
+    if((r = libusb_submit_transfer(x->transfer)) != 0)
+    {
+        if(r == LIBUSB_ERROR_NO_DEVICE) gone = true;
+        return fail(std::string("libusb_submit_transfer: ") + libusb_error_name(r));
+    }
+    next_slot += opt.packets;
+    order.push_back(x);
+    in_flight++;
+    return true;
+}
+
+void StreamCapture::completed(libusb_transfer *transfer)
+{
+    for(Xfer &x : xfers)
+    {
+        if(x.transfer == transfer) x.done = true;
+    }
+    in_flight--;
+
+    // In order on one Endpoint, but a failed one can overtake, so publish oldest first.
+    while(!order.empty() && order.front()->done)
+    {
+        Xfer *front = order.front();
+        bool cancelled = front->transfer->status == LIBUSB_TRANSFER_CANCELLED;
+
+        order.pop_front();
+        if(front->transfer->status == LIBUSB_TRANSFER_NO_DEVICE) gone = true;
+        publish(front);
+        if(!cancelled && !gone && ring.header()->running.load()) submit(front);
+    }
+}
+
+// Fills in the slots of a finished transfer and moves head past them, a
+// transfer that ended at a short packet leaves the rest of its slots empty.
+void StreamCapture::publish(Xfer *x)
+{
+    RingHeader *hdr = ring.header();
+    libusb_transfer *t = x->transfer;
+    uint32_t left = t->actual_length > 0 ? (uint32_t)t->actual_length : 0;
+    uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count();
+    bool failed = t->status != LIBUSB_TRANSFER_COMPLETED && t->status != LIBUSB_TRANSFER_CANCELLED;
+    uint32_t count = 0;
+
+    if(failed) hdr->errors.fetch_add(1, std::memory_order_relaxed);
+    for(uint32_t i = 0; i < opt.packets; i++)
+    {
+        RingSlot *slot = ring.slot(x->first + i);
+
+        slot->time_ns = now;
+        slot->missing = 0;
+        slot->len     = (uint16_t)(left < slot_size ? left : slot_size);
+        slot->flags   = left ? (failed ? SLOT_ERROR : 0) : SLOT_EMPTY;
+        if(left)
+        {
+            track(slot, ring.data(x->first + i));
+            left -= slot->len;
+            count++;
+        }
+    }
+    hdr->packets.fetch_add(count, std::memory_order_relaxed);
+    hdr->bytes.fetch_add(t->actual_length > 0 ? (uint64_t)t->actual_length : 0, std::memory_order_relaxed);
+    hdr->head.store(x->first + opt.packets, std::memory_order_release);
+}
+
+// Checks the packet's sequence number follows the last one.
+void StreamCapture::track(RingSlot *slot, const uint8_t *data)
+{
+    uint32_t mask = opt.seq_bytes >= 4 ? 0xFFFFFFFF : (1UL << (8 * opt.seq_bytes)) - 1;
+    uint32_t seq = 0;
+    RingHeader *hdr = ring.header();
+
+    if(!opt.seq_bytes || slot->len < opt.seq_offset + opt.seq_bytes) return;
+    for(uint32_t b = 0; b < opt.seq_bytes; b++) seq |= (uint32_t)data[opt.seq_offset + b] << (8 * b);
+    if(have_seq && seq != expected)
+    {
+        slot->missing = (seq - expected) & mask;
+        slot->flags  |= SLOT_GAP;
+        hdr->gaps.fetch_add(1, std::memory_order_relaxed);
+        hdr->missing.fetch_add(slot->missing, std::memory_order_relaxed);
+    }
+    expected = (seq + 1) & mask;
+    have_seq = true;
+}
+
+bool StreamCapture::poll(int timeout_ms)
+{
+    struct timeval tv;
+    int r;
+
+    tv.tv_sec  = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    if((r = libusb_handle_events_timeout_completed(ctx, &tv, NULL)) != 0 && r != LIBUSB_ERROR_INTERRUPTED)
+    {
+        return fail(std::string("libusb_handle_events: ") + libusb_error_name(r));
+    }
+    if(gone) return fail("the device is gone");
+    if(!in_flight) return fail("no transfers left in flight");
+    return true;
+}
+
+void StreamCapture::stop()
+{
+    RingHeader *hdr = ring.header();
+
+    if(hdr) hdr->running.store(0, std::memory_order_release);
+    for(Xfer *x : order) libusb_cancel_transfer(x->transfer);
+    while(in_flight)
+    {
+        if(libusb_handle_events(ctx) != 0) break;
+    }
+}
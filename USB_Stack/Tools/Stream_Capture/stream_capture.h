@@ -0,0 +1,80 @@
+#ifndef STREAM_CAPTURE_H
+#define STREAM_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "stream_ring.h"
+
+struct libusb_context;
+struct libusb_device_handle;
+struct libusb_transfer;
+
+struct CaptureOptions
+{
+    uint16_t vid = 0x04D8;
+    uint16_t pid = 0x0056;    // Vendor Stream Example.
+    uint8_t  ep = 0x81;       // Bulk or interrupt IN Endpoint, its interface is found and claimed.
+    uint32_t transfers = 32;  // Kept in flight.
+    uint32_t packets = 32;    // Per transfer, power of 2.
+    uint32_t slots = 1 << 20; // Packets the ring holds, power of 2.
+    uint32_t seq_offset = 0;  // Byte of each packet the sequence number starts at.
+    uint32_t seq_bytes = 0;   // 1 to 4 bytes, little endian, 0 if the packets have none.
+};
+
+// Streams an IN Endpoint into a ring file. Every transfer reads straight into
+// the ring's packet slots, so a packet is never copied after libusb has it,
+// and transfers are only resubmitted, there's nothing per packet. Other
+// processes follow the ring with RingReader.
+class StreamCapture
+{
+public:
+    StreamCapture();
+    ~StreamCapture();
+
+    bool open(const CaptureOptions &opt, const std::string &path);
+    void close();
+
+    bool start();              // Submits every transfer.
+    bool poll(int timeout_ms); // Handles completions, false once the device is gone or it's stopped.
+    void stop();               // Cancels the transfers and waits for them.
+
+    const RingHeader &stats() const { return *ring.header(); }
+
+    void completed(libusb_transfer *transfer); // From the libusb callback.
+
+    std::string error;
+
+private:
+    struct Xfer
+    {
+        libusb_transfer *transfer;
+        uint64_t         first; // Free running count of its first slot.
+        bool             done;
+    };
+
+    bool submit(Xfer *x);
+    void publish(Xfer *x);
+    void track(RingSlot *slot, const uint8_t *data);
+    bool find_endpoint(uint8_t &type, int &interface);
+    bool fail(const std::string &msg);
+
+    CaptureOptions        opt;
+    RingFile              ring;
+    libusb_context       *ctx;
+    libusb_device_handle *dev;
+    int                   interface;
+    uint32_t              slot_size;
+    std::vector<Xfer>     xfers;
+    std::deque<Xfer*>     order;     // Submitted, oldest first, published in this order.
+    uint64_t              next_slot; // First slot of the next transfer submitted.
+    uint32_t              expected;  // Next sequence number.
+    bool                  have_seq;
+    bool                  gone;
+    int                   in_flight;
+};
+
+#endif // STREAM_CAPTURE_H
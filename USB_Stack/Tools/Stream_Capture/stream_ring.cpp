@@ -0,0 +1,193 @@
+#include "stream_ring.h"
+
+#include <string.h>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RingFile::RingFile() : base(NULL), size(0), hdr(NULL), slots(NULL), packets(NULL), mask(0)
+#ifdef _WIN32
+    , file(INVALID_HANDLE_VALUE), mapping(NULL)
+#else
+    , fd(-1)
+#endif
+{
+}
+
+RingFile::~RingFile()
+{
+    close();
+}
+
+bool RingFile::fail(const std::string &msg)
+{
+    error = msg;
+    close();
+    return false;
+}
+
+bool RingFile::create(const std::string &path, uint32_t slot_size, uint32_t num_slots, uint32_t reserve)
+{
+    uint64_t slots_offset = RING_HEADER_SIZE;
+    uint64_t data_offset = slots_offset + (uint64_t)num_slots * sizeof(RingSlot);
+
+    if(!num_slots || (num_slots & (num_slots - 1))) return fail("the slot count must be a power of 2");
+    if(!slot_size || reserve > num_slots / 2) return fail("the transfers in flight need more than half the ring");
+    if(!map(path, data_offset + (uint64_t)num_slots * slot_size, true)) return false;
+
+    memset(base, 0, RING_HEADER_SIZE);
+    hdr = new(base) RingHeader();
+    hdr->version      = RING_VERSION;
+    hdr->slot_size    = slot_size;
+    hdr->num_slots    = num_slots;
+    hdr->reserve      = reserve;
+    hdr->slots_offset = slots_offset;
+    hdr->data_offset  = data_offset;
+    hdr->head.store(0);
+    hdr->packets.store(0);
+    hdr->bytes.store(0);
+    hdr->gaps.store(0);
+    hdr->missing.store(0);
+    hdr->errors.store(0);
+    hdr->running.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(hdr->magic, RING_MAGIC, sizeof(hdr->magic)); // Last, a reader checks it first.
+
+    slots   = (RingSlot*)(base + slots_offset);
+    packets = base + data_offset;
+    mask    = num_slots - 1;
+    return true;
+}
+
+bool RingFile::open(const std::string &path)
+{
+    if(!map(path, 0, false)) return false;
+    hdr = (RingHeader*)base;
+    if(size < RING_HEADER_SIZE || memcmp(hdr->magic, RING_MAGIC, sizeof(hdr->magic)) != 0) return fail("not a ring file: " + path);
+    if(hdr->version != RING_VERSION) return fail("ring file version not supported: " + path);
+    if(hdr->data_offset + (uint64_t)hdr->num_slots * hdr->slot_size > size) return fail("ring file is cut short: " + path);
+
+    slots   = (RingSlot*)(base + hdr->slots_offset);
+    packets = base + hdr->data_offset;
+    mask    = hdr->num_slots - 1;
+    return true;
+}
+
+void RingFile::close()
+{
+    if(!base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    if(mapping) CloseHandle((HANDLE)mapping);
+    if(file != INVALID_HANDLE_VALUE) CloseHandle((HANDLE)file);
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+#else
+    munmap(base, size);
+    if(fd >= 0) ::close(fd);
+    fd = -1;
+#endif
+    base = NULL;
+    hdr = NULL;
+}
+
+// Maps the whole file, a size of 0 keeps the size it has.
+bool RingFile::map(const std::string &path, uint64_t bytes, bool write)
+{
+    close();
+#ifdef _WIN32
+    LARGE_INTEGER len;
+
+    file = CreateFileA(path.c_str(), write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, write ? CREATE_ALWAYS : OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) return fail("can't open " + path);
+    if(bytes) len.QuadPart = (LONGLONG)bytes;
+    else if(!GetFileSizeEx((HANDLE)file, &len)) return fail("can't size " + path);
+    mapping = CreateFileMappingA((HANDLE)file, NULL, write ? PAGE_READWRITE : PAGE_READONLY,
+                                 (DWORD)(len.QuadPart >> 32), (DWORD)len.QuadPart, NULL);
+    if(!mapping) return fail("can't map " + path);
+    base = (uint8_t*)MapViewOfFile((HANDLE)mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if(!base) return fail("can't map " + path);
+    size = (uint64_t)len.QuadPart;
+#else
+    struct stat st;
+    void *p;
+
+    fd = ::open(path.c_str(), write ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+    if(fd < 0) return fail("can't open " + path);
+    if(bytes && ftruncate(fd, (off_t)bytes) != 0) return fail("can't size " + path);
+    if(!bytes)
+    {
+        if(fstat(fd, &st) != 0) return fail("can't size " + path);
+        bytes = (uint64_t)st.st_size;
+    }
+    if(!bytes) return fail("empty file: " + path);
+    p = mmap(NULL, bytes, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED) return fail("can't map " + path);
+    base = (uint8_t*)p;
+    size = bytes;
+#endif
+    return true;
+}
+
+bool RingReader::open(const std::string &path, bool from_start)
+{
+    uint64_t head;
+
+    if(!file.open(path))
+    {
+        error = file.error;
+        return false;
+    }
+    head = file.header()->head.load(std::memory_order_acquire);
+    pos  = head;
+    lost = 0;
+    if(from_start)
+    {
+        const RingHeader *hdr = file.header();
+
+        pos = head + hdr->reserve > hdr->num_slots ? head + hdr->reserve - hdr->num_slots : 0;
+    }
+    return true;
+}
+
+bool RingReader::next(const RingSlot *&slot, const uint8_t *&data)
+{
+    const RingHeader *hdr = file.header();
+    uint64_t head = hdr->head.load(std::memory_order_acquire);
+
+    // Slots older than this are being filled again.
+    if(head + hdr->reserve > pos + hdr->num_slots)
+    {
+        uint64_t oldest = head + hdr->reserve - hdr->num_slots;
+
+        lost += oldest - pos;
+        pos = oldest;
+    }
+    for(; pos < head; pos++)
+    {
+        slot = file.slot(pos);
+        if(slot->flags & SLOT_EMPTY) continue;
+        data = file.data(pos++);
+        return true;
+    }
+    return false;
+}
+
+bool RingReader::valid() const
+{
+    const RingHeader *hdr = file.header();
+    uint64_t head;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    head = hdr->head.load(std::memory_order_acquire);
+    return pos - 1 + hdr->num_slots >= head + hdr->reserve;
+}
@@ -0,0 +1,114 @@
+#ifndef STREAM_RING_H
+#define STREAM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+// The processes sharing a ring only agree through these atomics.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring needs lock free 64 bit atomics");
+
+#define RING_MAGIC       "USBRING1"
+#define RING_VERSION     1
+#define RING_HEADER_SIZE 4096 // One page, the RingSlot table starts after it.
+
+// RingSlot flags.
+#define SLOT_EMPTY 0x0001 // The transfer was short, no packet got this far.
+#define SLOT_GAP   0x0002 // The sequence number skipped, missing says by how much.
+#define SLOT_ERROR 0x0004 // The transfer failed, the packet is what came before it did.
+
+// One per packet, in a table of its own so the packets are back to back.
+struct RingSlot
+{
+    uint64_t time_ns; // Steady clock when the transfer completed.
+    uint32_t missing; // Packets the sequence number skipped before this one.
+    uint16_t len;     // Bytes of the packet, up to slot_size.
+    uint16_t flags;
+};
+
+// The start of the file. Sizes are set once by the capture, the counters are
+// updated as it runs.
+struct RingHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t slot_size;    // Bytes per packet slot, the Endpoint's max packet size.
+    uint32_t num_slots;    // Power of 2.
+    uint32_t reserve;      // Slots past head that transfers in flight may be filling.
+    uint64_t slots_offset; // RingSlot[num_slots].
+    uint64_t data_offset;  // num_slots * slot_size bytes of packets.
+
+    std::atomic<uint64_t> head;    // Slots published, free running, head % num_slots is the next.
+    std::atomic<uint64_t> packets;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> gaps;    // Times the sequence number skipped.
+    std::atomic<uint64_t> missing; // Packets it skipped, the device's drops or lost transfers.
+    std::atomic<uint64_t> errors;  // Transfers that failed.
+    std::atomic<uint32_t> running; // 1 while a capture is writing.
+};
+
+// A ring file mapped into memory, created by the capture or opened by a reader.
+// Slot i of the free running count is slot(i) and its packet data(i).
+class RingFile
+{
+public:
+    RingFile();
+    ~RingFile();
+
+    bool create(const std::string &path, uint32_t slot_size, uint32_t num_slots, uint32_t reserve);
+    bool open(const std::string &path); // Read only.
+    void close();
+
+    RingHeader *header() const { return hdr; }
+    RingSlot   *slot(uint64_t i) const { return slots + (i & mask); }
+    uint8_t    *data(uint64_t i) const { return packets + (i & mask) * hdr->slot_size; }
+
+    std::string error;
+
+private:
+    bool map(const std::string &path, uint64_t size, bool write);
+    bool fail(const std::string &msg);
+
+    uint8_t    *base;
+    uint64_t    size;
+    RingHeader *hdr;
+    RingSlot   *slots;
+    uint8_t    *packets;
+    uint64_t    mask;
+#ifdef _WIN32
+    void       *file;
+    void       *mapping;
+#else
+    int         fd;
+#endif
+};
+
+// Follows a ring from another process. The packets are read where they are in
+// the mapping: next() gives the slot and its data, and valid() says afterwards
+// if the capture could have written over them in the meantime, which only
+// happens to a reader that has fallen most of a ring behind.
+class RingReader
+{
+public:
+    RingReader() : pos(0), lost(0) {}
+
+    bool open(const std::string &path, bool from_start = false); // Otherwise only new packets.
+    void close() { file.close(); }
+
+    bool next(const RingSlot *&slot, const uint8_t *&data); // False if there's nothing new.
+    bool valid() const;                                     // The last next() wasn't overwritten.
+    bool running() const { return file.header()->running.load(std::memory_order_acquire) != 0; }
+
+    const RingHeader &header() const { return *file.header(); }
+    uint64_t overruns() const { return lost; } // Packets skipped by falling behind.
+
+    std::string error;
+
+private:
+    RingFile file;
+    uint64_t pos;  // Free running count of the next slot.
+    uint64_t lost;
+};
+
+#endif // STREAM_RING_H
@@ -0,0 +1,61 @@
+#-------------------------------------------------
+# USB Benchmark, host side throughput and latency
+# tests for the MSD, CDC, HID, and HID Stream examples.
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = usb_benchmark
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += main.cpp \
+        bench.cpp \
+        msd_bench.cpp \
+        cdc_bench.cpp \
+        hid_bench.cpp \
+        hid_stream_bench.cpp \
+        ../HID_Stripe/hid_stripe.cpp
+
+HEADERS  += bench.h \
+         msd_bench.h \
+         cdc_bench.h \
+         hid_bench.h \
+         hid_stream_bench.h \
+         ../HID_Stripe/hid_stripe.h
+
+#-------------------------------------------------
+# Uses the Signal11's hidapi library built by
+# HID_Custom's HIDAPI.pro
+#-------------------------------------------------
+HIDAPI_DIR = ../../Examples/HID_Examples/HID_Custom/Application/src/HIDAPI
+INCLUDEPATH += $$HIDAPI_DIR ../HID_Stripe
+
+macx: LIBS += -L$$HIDAPI_DIR/mac -lHIDAPI
+win32: LIBS += -L$$HIDAPI_DIR/windows -lHIDAPI
+unix: !macx: LIBS += -L$$HIDAPI_DIR/linux -lHIDAPI
+
+#-------------------------------------------------
+# Required libraries or frameworks for hidapi
+#-------------------------------------------------
+macx: LIBS += -framework CoreFoundation -framework IOkit
+win32: LIBS += -lSetupAPI
+unix: !macx: LIBS += -lusb-1.0 -lpthread
+
+#-------------------------------------------------
+# Make sure output directory for object file and
+# executable is in the correct subdirectory
+#-------------------------------------------------
+macx {
+    DESTDIR = mac
+    OBJECTS_DIR = mac
+}
+unix: !macx {
+    DESTDIR = linux
+    OBJECTS_DIR = linux
+}
+win32 {
+    DESTDIR = windows
+    OBJECTS_DIR = windows
+}
@@ -0,0 +1,112 @@
+#include "bench.h"
+
+#include <chrono>
+
+double bench_now_us()
+{
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+BenchTimer::BenchTimer()
+{
+    begin_us = op_begin_us = end_us = 0;
+    min_us = 0;
+    max_us = 0;
+    total_op_us = 0;
+    bytes = 0;
+    ops = 0;
+}
+
+void BenchTimer::start()
+{
+    begin_us = bench_now_us();
+    end_us = begin_us;
+}
+
+void BenchTimer::op_start()
+{
+    op_begin_us = bench_now_us();
+}
+
+void BenchTimer::op_end(uint64_t op_bytes)
+{
+    double t = bench_now_us();
+    double op_us = t - op_begin_us;
+
+    if(ops == 0 || op_us < min_us) min_us = op_us;
+    if(op_us > max_us) max_us = op_us;
+    total_op_us += op_us;
+    bytes += op_bytes;
+    ops++;
+    end_us = t;
+}
+
+BenchResult BenchTimer::result(const std::string &test, const std::string &params) const
+{
+    BenchResult r;
+    r.test    = test;
+    r.params  = params;
+    r.bytes   = bytes;
+    r.ops     = ops;
+    r.seconds = (end_us - begin_us) / 1000000.0;
+    r.min_us  = min_us;
+    r.avg_us  = ops ? total_op_us / ops : 0;
+    r.max_us  = max_us;
+    return r;
+}
+
+CsvWriter::CsvWriter()
+{
+    file = NULL;
+}
+
+CsvWriter::~CsvWriter()
+{
+    if(file) fclose(file);
+}
+
+bool CsvWriter::open(const std::string &path, const std::string &build_label)
+{
+    label = build_label;
+    file = fopen(path.c_str(), "a");
+    if(file == NULL) return false;
+
+    fseek(file, 0, SEEK_END);
+    if(ftell(file) == 0) fprintf(file, "label,test,params,bytes,ops,seconds,kib_per_s,min_us,avg_us,max_us\n");
+    return true;
+}
+
+void CsvWriter::write(const BenchResult &r)
+{
+    if(file == NULL) return;
+
+    double kib_s = r.seconds > 0 ? (r.bytes / 1024.0) / r.seconds : 0;
+    fprintf(file, "%s,%s,%s,%llu,%u,%.6f,%.2f,%.1f,%.1f,%.1f\n", label.c_str(), r.test.c_str(), r.params.c_str(),
+            (unsigned long long)r.bytes, r.ops, r.seconds, kib_s, r.min_us, r.avg_us, r.max_us);
+    fflush(file);
+}
+
+void bench_print(const BenchResult &r)
+{
+    double kib_s = r.seconds > 0 ? (r.bytes / 1024.0) / r.seconds : 0;
+    printf("%-16s %-14s %10.2f KiB/s  ops %6u  min/avg/max %8.1f/%8.1f/%8.1f us\n",
+           r.test.c_str(), r.params.c_str(), kib_s, r.ops, r.min_us, r.avg_us, r.max_us);
+}
+
+// xorshift32, the same seed gives the same sequence on every host.
+uint32_t bench_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+void bench_fill_pattern(std::vector<uint8_t> &buf, uint32_t seed)
+{
+    uint32_t state = seed ? seed : 1;
+    for(size_t i = 0; i < buf.size(); i++) buf[i] = (uint8_t)bench_random(&state);
+}
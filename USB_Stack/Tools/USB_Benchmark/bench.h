@@ -0,0 +1,62 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// One row of results. Latency columns are 0 when a test only measures throughput.
+struct BenchResult
+{
+    std::string test;       // e.g. "msd_seq_read"
+    std::string params;     // e.g. "xfer=4096"
+    uint64_t    bytes;
+    uint32_t    ops;
+    double      seconds;
+    double      min_us;
+    double      avg_us;
+    double      max_us;
+};
+
+// Collects per-operation times and turns them into a BenchResult.
+class BenchTimer
+{
+public:
+    BenchTimer();
+    void start();
+    void op_start();
+    void op_end(uint64_t bytes);
+    BenchResult result(const std::string &test, const std::string &params) const;
+
+private:
+    double   begin_us;
+    double   op_begin_us;
+    double   end_us;
+    double   min_us;
+    double   max_us;
+    double   total_op_us;
+    uint64_t bytes;
+    uint32_t ops;
+};
+
+// Appends results as CSV, the header is only written to a new/empty file.
+class CsvWriter
+{
+public:
+    CsvWriter();
+    ~CsvWriter();
+    bool open(const std::string &path, const std::string &label);
+    void write(const BenchResult &r);
+
+private:
+    FILE       *file;
+    std::string label;
+};
+
+double bench_now_us();
+void   bench_print(const BenchResult &r);
+void   bench_fill_pattern(std::vector<uint8_t> &buf, uint32_t seed);
+uint32_t bench_random(uint32_t *state);
+
+#endif // BENCH_H
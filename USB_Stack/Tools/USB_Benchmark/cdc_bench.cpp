@@ -0,0 +1,241 @@
+#include "cdc_bench.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#endif
+
+#define READ_TIMEOUT_MS 1000
+
+static const uint32_t write_sizes[] = {1, 8, 63, 64, 512, 4096};
+
+// Raw mode serial port, the baud rate only matters when the firmware bridges to a UART.
+class SerialPort
+{
+public:
+    SerialPort()
+    {
+        #ifdef _WIN32
+        handle = INVALID_HANDLE_VALUE;
+        #else
+        fd = -1;
+        #endif
+    }
+
+    ~SerialPort()
+    {
+        #ifdef _WIN32
+        if(handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+        #else
+        if(fd >= 0) close(fd);
+        #endif
+    }
+
+    bool open_port(const std::string &path)
+    {
+        #ifdef _WIN32
+        std::string name = "\\\\.\\" + path;
+        DCB dcb;
+        COMMTIMEOUTS timeouts;
+
+        handle = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if(handle == INVALID_HANDLE_VALUE) return false;
+        memset(&dcb, 0, sizeof(dcb));
+        dcb.DCBlength = sizeof(dcb);
+        if(!GetCommState(handle, &dcb)) return false;
+        dcb.BaudRate = 115200;
+        dcb.ByteSize = 8;
+        dcb.Parity = NOPARITY;
+        dcb.StopBits = ONESTOPBIT;
+        dcb.fBinary = TRUE;
+        dcb.fOutX = FALSE;
+        dcb.fInX = FALSE;
+        dcb.fDtrControl = DTR_CONTROL_ENABLE;
+        dcb.fRtsControl = RTS_CONTROL_ENABLE;
+        if(!SetCommState(handle, &dcb)) return false;
+        // Return whatever has arrived, wait up to READ_TIMEOUT_MS for the first byte.
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant = READ_TIMEOUT_MS;
+        timeouts.WriteTotalTimeoutMultiplier = 0;
+        timeouts.WriteTotalTimeoutConstant = READ_TIMEOUT_MS;
+        if(!SetCommTimeouts(handle, &timeouts)) return false;
+        PurgeComm(handle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+        return true;
+        #else
+        struct termios tio;
+
+        fd = open(path.c_str(), O_RDWR | O_NOCTTY);
+        if(fd < 0) return false;
+        if(tcgetattr(fd, &tio) < 0) return false;
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        if(tcsetattr(fd, TCSANOW, &tio) < 0) return false;
+        tcflush(fd, TCIOFLUSH);
+        return true;
+        #endif
+    }
+
+    bool write_all(const uint8_t *buf, uint32_t bytes)
+    {
+        while(bytes)
+        {
+            #ifdef _WIN32
+            DWORD done = 0;
+            if(!WriteFile(handle, buf, bytes, &done, NULL) || done == 0) return false;
+            #else
+            ssize_t done = write(fd, buf, bytes);
+            if(done <= 0) return false;
+            #endif
+            buf += done;
+            bytes -= (uint32_t)done;
+        }
+        return true;
+    }
+
+    // Returns the number of bytes read, 0 on timeout.
+    uint32_t read_some(uint8_t *buf, uint32_t bytes)
+    {
+        #ifdef _WIN32
+        DWORD done = 0;
+        if(!ReadFile(handle, buf, bytes, &done, NULL)) return 0;
+        return done;
+        #else
+        struct pollfd pfd;
+        ssize_t done;
+
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if(poll(&pfd, 1, READ_TIMEOUT_MS) <= 0) return 0;
+        done = read(fd, buf, bytes);
+        return done > 0 ? (uint32_t)done : 0;
+        #endif
+    }
+
+    bool read_all(uint8_t *buf, uint32_t bytes)
+    {
+        while(bytes)
+        {
+            uint32_t done = read_some(buf, bytes);
+            if(done == 0) return false;
+            buf += done;
+            bytes -= done;
+        }
+        return true;
+    }
+
+private:
+    #ifdef _WIN32
+    HANDLE handle;
+    #else
+    int fd;
+    #endif
+};
+
+// Writes in chunks of xfer bytes while reading the echo back so neither side can fill up
+// and stall. Throughput counts bytes that made the round trip.
+static bool run_throughput(SerialPort &port, uint32_t xfer, const CdcOptions &opt, CsvWriter &csv)
+{
+    uint32_t total = opt.total_kib * 1024;
+    std::vector<uint8_t> tx, rx;
+    uint32_t sent = 0, received = 0;
+    BenchTimer timer;
+    double begin_us;
+    char params[32];
+
+    if(total < xfer) total = xfer;
+    total -= total % xfer;
+    tx.resize(total);
+    rx.resize(total);
+    bench_fill_pattern(tx, xfer);
+
+    begin_us = bench_now_us();
+    timer.start();
+    while(received < total)
+    {
+        // Keep at most 4 KiB in flight, the examples don't buffer much more than that.
+        if(sent < total && sent - received < 4096)
+        {
+            timer.op_start();
+            if(!port.write_all(&tx[sent], xfer)) return false;
+            timer.op_end(0);
+            sent += xfer;
+            continue;
+        }
+        uint32_t done = port.read_some(&rx[received], total - received);
+        if(done == 0)
+        {
+            fprintf(stderr, "cdc: timed out after %u of %u bytes echoed\n", received, total);
+            return false;
+        }
+        received += done;
+    }
+    snprintf(params, sizeof(params), "write=%u", xfer);
+    BenchResult r = timer.result("cdc_loopback", params);
+    // Min/avg/max are per write, the time span runs until the last byte is echoed back.
+    r.bytes = total;
+    r.seconds = (bench_now_us() - begin_us) / 1000000.0;
+    bench_print(r);
+    csv.write(r);
+    if(memcmp(&tx[0], &rx[0], total) != 0)
+    {
+        fprintf(stderr, "cdc: echoed data didn't match\n");
+        return false;
+    }
+    return true;
+}
+
+static bool run_latency(SerialPort &port, const CdcOptions &opt, CsvWriter &csv)
+{
+    BenchTimer timer;
+    uint8_t tx, rx;
+
+    timer.start();
+    for(uint32_t i = 0; i < opt.iters; i++)
+    {
+        tx = (uint8_t)i;
+        timer.op_start();
+        if(!port.write_all(&tx, 1) || !port.read_all(&rx, 1)) return false;
+        timer.op_end(1);
+        if(rx != tx)
+        {
+            fprintf(stderr, "cdc: echoed byte didn't match\n");
+            return false;
+        }
+    }
+    BenchResult r = timer.result("cdc_latency", "write=1");
+    bench_print(r);
+    csv.write(r);
+    return true;
+}
+
+int cdc_bench(const CdcOptions &opt, CsvWriter &csv)
+{
+    SerialPort port;
+
+    if(!port.open_port(opt.port))
+    {
+        fprintf(stderr, "cdc: can't open %s\n", opt.port.c_str());
+        return 1;
+    }
+    for(size_t i = 0; i < sizeof(write_sizes) / sizeof(write_sizes[0]); i++)
+    {
+        if(!run_throughput(port, write_sizes[i], opt, csv)) return 1;
+    }
+    if(!run_latency(port, opt, csv))
+    {
+        fprintf(stderr, "cdc: latency test failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef CDC_BENCH_H
+#define CDC_BENCH_H
+
+#include "bench.h"
+
+struct CdcOptions
+{
+    std::string port;       // /dev/ttyACM0, /dev/cu.usbmodemXXX, or COM5
+    uint32_t    total_kib;  // Per write size.
+    uint32_t    iters;      // Round trips for the latency test.
+};
+
+// Needs firmware that echoes everything back, e.g. CDC_Serial_Example's serial_echo()
+// or CDC_Serial_UART_Example with the UART TX and RX pins jumpered.
+int cdc_bench(const CdcOptions &opt, CsvWriter &csv);
+
+#endif // CDC_BENCH_H
@@ -0,0 +1,61 @@
+#include "hid_bench.h"
+
+#include <string.h>
+#include "hidapi.h"
+
+#define REPORT_SIZE        64
+#define CMD_BUTTON_STATUS  0x81
+#define READ_TIMEOUT_MS    1000
+
+int hid_bench(const HidOptions &opt, CsvWriter &csv)
+{
+    hid_device *dev;
+    uint8_t out[REPORT_SIZE + 1];   // Report ID + report
+    uint8_t in[REPORT_SIZE];
+    BenchTimer timer;
+    char params[32];
+    int result = 0;
+
+    if(hid_init() != 0) return 1;
+    dev = hid_open(opt.vid, opt.pid, NULL);
+    if(dev == NULL)
+    {
+        fprintf(stderr, "hid: can't open %04x:%04x\n", opt.vid, opt.pid);
+        hid_exit();
+        return 1;
+    }
+
+    memset(out, 0, sizeof(out));
+    out[0] = 0;     // The example doesn't use report IDs.
+    out[1] = CMD_BUTTON_STATUS;
+
+    timer.start();
+    for(uint32_t i = 0; i < opt.iters; i++)
+    {
+        timer.op_start();
+        if(hid_write(dev, out, sizeof(out)) < 0)
+        {
+            fprintf(stderr, "hid: write failed\n");
+            result = 1;
+            break;
+        }
+        if(hid_read_timeout(dev, in, sizeof(in), READ_TIMEOUT_MS) <= 0 || in[0] != CMD_BUTTON_STATUS)
+        {
+            fprintf(stderr, "hid: no reply to iteration %u\n", i);
+            result = 1;
+            break;
+        }
+        timer.op_end(sizeof(out) - 1 + sizeof(in));
+    }
+    if(result == 0)
+    {
+        snprintf(params, sizeof(params), "cmd=0x%02x", CMD_BUTTON_STATUS);
+        BenchResult r = timer.result("hid_round_trip", params);
+        bench_print(r);
+        csv.write(r);
+    }
+
+    hid_close(dev);
+    hid_exit();
+    return result;
+}
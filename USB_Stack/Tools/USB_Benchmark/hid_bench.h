@@ -0,0 +1,17 @@
+#ifndef HID_BENCH_H
+#define HID_BENCH_H
+
+#include "bench.h"
+
+struct HidOptions
+{
+    uint16_t vid;
+    uint16_t pid;
+    uint32_t iters;
+};
+
+// Round trip latency against HID_Custom, each iteration sends the get button status
+// command and waits for the reply.
+int hid_bench(const HidOptions &opt, CsvWriter &csv);
+
+#endif // HID_BENCH_H
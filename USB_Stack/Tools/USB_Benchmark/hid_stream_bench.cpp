@@ -0,0 +1,60 @@
+#include "hid_stream_bench.h"
+
+#include <string.h>
+#include "hid_stripe.h"
+
+#define READ_TIMEOUT_MS   1000
+#define REPORTS_PER_CHUNK 16    // Per channel, written before reading the chunk back.
+
+int hid_stream_bench(const HidStreamOptions &opt, CsvWriter &csv)
+{
+    HidStripe stripe;
+    std::vector<uint8_t> out, in;
+    uint64_t total = (uint64_t)opt.total_kib * 1024;
+    BenchTimer timer;
+    char params[32];
+    int result = 0;
+
+    if(hid_init() != 0) return 1;
+    if(!stripe.open(opt.vid, opt.pid))
+    {
+        fprintf(stderr, "hid_stream: can't open %04x:%04x\n", opt.vid, opt.pid);
+        hid_exit();
+        return 1;
+    }
+    printf("hid_stream: %u interfaces\n", (unsigned)stripe.channels());
+
+    out.resize(stripe.channels() * REPORTS_PER_CHUNK * HID_STRIPE_PAYLOAD_SIZE);
+    in.resize(out.size());
+
+    timer.start();
+    for(uint64_t done = 0; done < total; done += out.size())
+    {
+        bench_fill_pattern(out, (uint32_t)(done / out.size()) + 1);
+        timer.op_start();
+        if(!stripe.write(&out[0], out.size()) || !stripe.read(&in[0], in.size(), READ_TIMEOUT_MS))
+        {
+            fprintf(stderr, "hid_stream: transfer failed at byte %llu\n", (unsigned long long)done);
+            result = 1;
+            break;
+        }
+        timer.op_end(out.size() + in.size());
+        if(memcmp(&out[0], &in[0], out.size()) != 0)
+        {
+            fprintf(stderr, "hid_stream: loopback mismatch at byte %llu\n", (unsigned long long)done);
+            result = 1;
+            break;
+        }
+    }
+    if(result == 0)
+    {
+        snprintf(params, sizeof(params), "channels=%u", (unsigned)stripe.channels());
+        BenchResult r = timer.result("hid_stream_loopback", params);
+        bench_print(r);
+        csv.write(r);
+    }
+
+    stripe.close();
+    hid_exit();
+    return result;
+}
@@ -0,0 +1,17 @@
+#ifndef HID_STREAM_BENCH_H
+#define HID_STREAM_BENCH_H
+
+#include "bench.h"
+
+struct HidStreamOptions
+{
+    uint16_t vid;
+    uint16_t pid;
+    uint32_t total_kib;
+};
+
+// Loopback throughput against HID_Stream_Example, the data is striped across every
+// HID interface with HidStripe and everything sent is compared with what came back.
+int hid_stream_bench(const HidStreamOptions &opt, CsvWriter &csv);
+
+#endif // HID_STREAM_BENCH_H
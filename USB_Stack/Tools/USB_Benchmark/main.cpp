@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "msd_bench.h"
+#include "cdc_bench.h"
+#include "hid_bench.h"
+#include "hid_stream_bench.h"
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage:\n"
+            "  usb_benchmark msd <device> [--blocks N] [--mb N] [--ops N] [--write]\n"
+            "  usb_benchmark cdc <port> [--mb N] [--iters N]\n"
+            "  usb_benchmark hid [--vid 04d8] [--pid 003f] [--iters N]\n"
+            "  usb_benchmark hidstream [--vid 04d8] [--pid 0057] [--mb N]\n"
+            "common options:\n"
+            "  --csv <file>     append results to a CSV file\n"
+            "  --label <name>   label for the CSV rows, e.g. the firmware build\n"
+            "  --kib N          size per test in KiB instead of --mb\n"
+            "msd --write overwrites the medium!\n");
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mode, target, csv_path, label = "default";
+    uint32_t blocks = 0, total_kib = 0, ops = 1000, iters = 1000;
+    uint16_t vid = 0x04D8, pid = 0;
+    bool write = false;
+    CsvWriter csv;
+    int i;
+
+    if(argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    mode = argv[1];
+    i = 2;
+    if(mode != "hid" && mode != "hidstream")
+    {
+        if(argc < 3)
+        {
+            usage();
+            return 1;
+        }
+        target = argv[2];
+        i = 3;
+    }
+    for(; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "--write") write = true;
+        else if(arg == "--blocks" && has_value) blocks = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--mb" && has_value) total_kib = (uint32_t)strtoul(argv[++i], NULL, 0) * 1024;
+        else if(arg == "--kib" && has_value) total_kib = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--ops" && has_value) ops = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--iters" && has_value) iters = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if(arg == "--vid" && has_value) vid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--pid" && has_value) pid = (uint16_t)strtoul(argv[++i], NULL, 16);
+        else if(arg == "--csv" && has_value) csv_path = argv[++i];
+        else if(arg == "--label" && has_value) label = argv[++i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if(!csv_path.empty() && !csv.open(csv_path, label))
+    {
+        fprintf(stderr, "can't open %s\n", csv_path.c_str());
+        return 1;
+    }
+
+    if(mode == "msd")
+    {
+        MsdOptions opt;
+        opt.device = target;
+        opt.blocks = blocks;
+        opt.total_kib = total_kib ? total_kib : 16 * 1024;
+        opt.ops = ops;
+        opt.write = write;
+        return msd_bench(opt, csv);
+    }
+    if(mode == "cdc")
+    {
+        CdcOptions opt;
+        opt.port = target;
+        opt.total_kib = total_kib ? total_kib : 1024;
+        opt.iters = iters;
+        return cdc_bench(opt, csv);
+    }
+    if(mode == "hid")
+    {
+        HidOptions opt;
+        opt.vid = vid;
+        opt.pid = pid ? pid : 0x003F;
+        opt.iters = iters;
+        return hid_bench(opt, csv);
+    }
+    if(mode == "hidstream")
+    {
+        HidStreamOptions opt;
+        opt.vid = vid;
+        opt.pid = pid ? pid : 0x0057;
+        opt.total_kib = total_kib ? total_kib : 256;
+        return hid_stream_bench(opt, csv);
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,241 @@
+#include "msd_bench.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef __APPLE__
+#include <sys/disk.h>
+#else
+#include <linux/fs.h>
+#endif
+#endif
+
+#define SECTOR_SIZE 512
+#define ALIGNMENT  4096
+
+static const uint32_t seq_sizes[]  = {512, 4096, 16384, 65536};
+static const uint32_t rand_sizes[] = {512, 4096};
+
+// Raw block access with the OS cache bypassed, so every access reaches the device.
+class RawDisk
+{
+public:
+    RawDisk()
+    {
+        #ifdef _WIN32
+        handle = INVALID_HANDLE_VALUE;
+        #else
+        fd = -1;
+        #endif
+    }
+
+    ~RawDisk()
+    {
+        #ifdef _WIN32
+        if(handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+        #else
+        if(fd >= 0) close(fd);
+        #endif
+    }
+
+    bool open_device(const std::string &path, bool writable)
+    {
+        #ifdef _WIN32
+        handle = CreateFileA(path.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0), FILE_SHARE_READ | FILE_SHARE_WRITE,
+                             NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, NULL);
+        return handle != INVALID_HANDLE_VALUE;
+        #elif defined(__APPLE__)
+        fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if(fd >= 0) fcntl(fd, F_NOCACHE, 1);
+        return fd >= 0;
+        #else
+        fd = open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_DIRECT | O_SYNC);
+        return fd >= 0;
+        #endif
+    }
+
+    uint64_t size_bytes()
+    {
+        #ifdef _WIN32
+        GET_LENGTH_INFORMATION info;
+        DWORD returned;
+        if(!DeviceIoControl(handle, IOCTL_DISK_GET_LENGTH_INFO, NULL, 0, &info, sizeof(info), &returned, NULL)) return 0;
+        return (uint64_t)info.Length.QuadPart;
+        #elif defined(__APPLE__)
+        uint64_t count = 0;
+        uint32_t size = 0;
+        if(ioctl(fd, DKIOCGETBLOCKCOUNT, &count) < 0 || ioctl(fd, DKIOCGETBLOCKSIZE, &size) < 0) return 0;
+        return count * size;
+        #else
+        uint64_t bytes = 0;
+        if(ioctl(fd, BLKGETSIZE64, &bytes) < 0) return 0;
+        return bytes;
+        #endif
+    }
+
+    bool transfer(bool write, uint64_t offset, uint8_t *buf, uint32_t bytes)
+    {
+        #ifdef _WIN32
+        LARGE_INTEGER pos;
+        DWORD done = 0;
+        pos.QuadPart = (LONGLONG)offset;
+        if(!SetFilePointerEx(handle, pos, NULL, FILE_BEGIN)) return false;
+        if(write) return WriteFile(handle, buf, bytes, &done, NULL) && done == bytes;
+        return ReadFile(handle, buf, bytes, &done, NULL) && done == bytes;
+        #else
+        ssize_t done = write ? pwrite(fd, buf, bytes, (off_t)offset) : pread(fd, buf, bytes, (off_t)offset);
+        return done == (ssize_t)bytes;
+        #endif
+    }
+
+private:
+    #ifdef _WIN32
+    HANDLE handle;
+    #else
+    int fd;
+    #endif
+};
+
+static uint8_t* aligned_buffer(uint32_t bytes)
+{
+    #ifdef _WIN32
+    return (uint8_t*)_aligned_malloc(bytes, ALIGNMENT);
+    #else
+    void *p = NULL;
+    if(posix_memalign(&p, ALIGNMENT, bytes) != 0) return NULL;
+    return (uint8_t*)p;
+    #endif
+}
+
+static void aligned_free(uint8_t *p)
+{
+    #ifdef _WIN32
+    _aligned_free(p);
+    #else
+    free(p);
+    #endif
+}
+
+static std::string xfer_param(uint32_t bytes)
+{
+    char s[32];
+    snprintf(s, sizeof(s), "xfer=%u", bytes);
+    return s;
+}
+
+static bool run_seq(RawDisk &disk, bool write, uint32_t xfer, uint64_t disk_bytes, const MsdOptions &opt, uint8_t *buf, CsvWriter &csv)
+{
+    uint64_t total = (uint64_t)opt.total_kib * 1024;
+    BenchTimer timer;
+
+    if(total > disk_bytes) total = disk_bytes - (disk_bytes % xfer);
+    timer.start();
+    for(uint64_t offset = 0; offset + xfer <= total; offset += xfer)
+    {
+        timer.op_start();
+        if(!disk.transfer(write, offset, buf, xfer)) return false;
+        timer.op_end(xfer);
+    }
+    BenchResult r = timer.result(write ? "msd_seq_write" : "msd_seq_read", xfer_param(xfer));
+    bench_print(r);
+    csv.write(r);
+    return true;
+}
+
+static bool run_rand(RawDisk &disk, bool write, uint32_t xfer, uint64_t disk_bytes, const MsdOptions &opt, uint8_t *buf, CsvWriter &csv)
+{
+    uint64_t slots = disk_bytes / xfer;
+    uint32_t state = 0x1234567;
+    BenchTimer timer;
+
+    if(slots == 0) return false;
+    timer.start();
+    for(uint32_t i = 0; i < opt.ops; i++)
+    {
+        uint64_t offset = (bench_random(&state) % slots) * xfer;
+        timer.op_start();
+        if(!disk.transfer(write, offset, buf, xfer)) return false;
+        timer.op_end(xfer);
+    }
+    BenchResult r = timer.result(write ? "msd_rand_write" : "msd_rand_read", xfer_param(xfer));
+    bench_print(r);
+    csv.write(r);
+    return true;
+}
+
+// Writes then reads back the first blocks with a fresh pattern, so a fast but broken write path won't pass.
+static bool verify(RawDisk &disk, uint8_t *buf, uint32_t bytes)
+{
+    std::vector<uint8_t> pattern(bytes);
+
+    bench_fill_pattern(pattern, 2);
+    memcpy(buf, &pattern[0], bytes);
+    if(!disk.transfer(true, 0, buf, bytes)) return false;
+    memset(buf, 0, bytes);
+    if(!disk.transfer(false, 0, buf, bytes)) return false;
+    return memcmp(buf, &pattern[0], bytes) == 0;
+}
+
+int msd_bench(const MsdOptions &opt, CsvWriter &csv)
+{
+    RawDisk disk;
+    uint64_t disk_bytes;
+    uint8_t *buf;
+    std::vector<uint8_t> pattern(seq_sizes[3]);
+
+    if(!disk.open_device(opt.device, opt.write))
+    {
+        fprintf(stderr, "msd: can't open %s (raw access usually needs root/administrator)\n", opt.device.c_str());
+        return 1;
+    }
+    disk_bytes = opt.blocks ? (uint64_t)opt.blocks * SECTOR_SIZE : disk.size_bytes();
+    if(disk_bytes < SECTOR_SIZE)
+    {
+        fprintf(stderr, "msd: can't get the size of %s, use --blocks\n", opt.device.c_str());
+        return 1;
+    }
+    buf = aligned_buffer(seq_sizes[3]);
+    if(buf == NULL) return 1;
+    bench_fill_pattern(pattern, 1);
+    memcpy(buf, &pattern[0], pattern.size());
+
+    for(size_t i = 0; i < sizeof(seq_sizes) / sizeof(seq_sizes[0]); i++)
+    {
+        if(!run_seq(disk, false, seq_sizes[i], disk_bytes, opt, buf, csv)) goto failed;
+    }
+    for(size_t i = 0; i < sizeof(rand_sizes) / sizeof(rand_sizes[0]); i++)
+    {
+        if(!run_rand(disk, false, rand_sizes[i], disk_bytes, opt, buf, csv)) goto failed;
+    }
+    if(opt.write)
+    {
+        for(size_t i = 0; i < sizeof(seq_sizes) / sizeof(seq_sizes[0]); i++)
+        {
+            if(!run_seq(disk, true, seq_sizes[i], disk_bytes, opt, buf, csv)) goto failed;
+        }
+        for(size_t i = 0; i < sizeof(rand_sizes) / sizeof(rand_sizes[0]); i++)
+        {
+            if(!run_rand(disk, true, rand_sizes[i], disk_bytes, opt, buf, csv)) goto failed;
+        }
+        if(!verify(disk, buf, seq_sizes[3] <= disk_bytes ? seq_sizes[3] : SECTOR_SIZE))
+        {
+            fprintf(stderr, "msd: read back didn't match what was written\n");
+            aligned_free(buf);
+            return 1;
+        }
+    }
+    aligned_free(buf);
+    return 0;
+
+failed:
+    fprintf(stderr, "msd: transfer failed\n");
+    aligned_free(buf);
+    return 1;
+}
@@ -0,0 +1,18 @@
+#ifndef MSD_BENCH_H
+#define MSD_BENCH_H
+
+#include "bench.h"
+
+struct MsdOptions
+{
+    std::string device;     // /dev/sdX, /dev/rdiskN, or \\.\PhysicalDriveN
+    uint32_t    blocks;     // 0 = ask the OS.
+    uint32_t    total_kib;  // Per sequential test.
+    uint32_t    ops;        // Per random test.
+    bool        write;      // Write tests overwrite the medium.
+};
+
+// Sequential and random reads (READ_10), and with write, writes (WRITE_10).
+int msd_bench(const MsdOptions &opt, CsvWriter &csv);
+
+#endif // MSD_BENCH_H
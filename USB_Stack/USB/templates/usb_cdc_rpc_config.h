@@ -0,0 +1,38 @@
+/**
+ * @file usb_cdc_rpc_config.h
+ * @brief <i>CDC RPC</i> settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - CDC RPC Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_CDC_RPC_CONFIG_H
+#define USB_CDC_RPC_CONFIG_H
+
+#include "usb_config.h"
+
+/* SETTINGS */
+#define CDC_RPC_MAX_PAYLOAD  64 // Largest request or response data in bytes, 1 to 249.
+#define CDC_RPC_NUM_COMMANDS 8  // Entries in g_cdc_rpc_handlers[], commands 0 to CDC_RPC_NUM_COMMANDS - 1.
+
+#endif /* USB_CDC_RPC_CONFIG_H */
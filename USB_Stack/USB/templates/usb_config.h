@@ -67,15 +67,26 @@
 #define PINGPONG_0_OUT    1
 #define PINGPONG_ALL_EP   2
 #define PINGPONG_1_15     3
+#if defined(VENDOR_STREAM_EXAMPLE)
+#define PINGPONG_MODE     PINGPONG_1_15 // The Vendor library keeps both buffers of each direction armed.
+#elif defined(AUDIO_MICROPHONE_EXAMPLE)
+#define PINGPONG_MODE     PINGPONG_1_15 // Isochronous Endpoints need ping-pong buffers.
+#elif defined(CDC_NCM_EXAMPLE)
+#define PINGPONG_MODE     PINGPONG_1_15 // The CDC network library keeps both DATA buffers armed.
+#elif defined(CDC_MULTI_PORT_EXAMPLE)
+#define PINGPONG_MODE     PINGPONG_1_15 // The CDC ports library keeps both DATA buffers armed.
+#else
 #define PINGPONG_MODE     PINGPONG_0_OUT
+#endif
 
 #if defined(CDC_EXAMPLE)
 #define NUM_CONFIGURATIONS 1
 #define NUM_INTERFACES     2
 #define NUM_ALT_INTERFACES 0
 #define NUM_ENDPOINTS      3
-#define EP0_SIZE           8
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
 #define EP1_SIZE           10
+#define EP1_OUT_SIZE       0  // CDC COM is IN only.
 #define EP2_SIZE           64
 
 #elif defined(MSD_SIMPLE_EXAMPLE) || defined(MSD_INTERNAL_EXAMPLE) || defined(HID_CUSTOM_EXAMPLE)
@@ -83,7 +94,7 @@
 #define NUM_INTERFACES     1
 #define NUM_ALT_INTERFACES 0
 #define NUM_ENDPOINTS      2
-#define EP0_SIZE           8
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
 #define EP1_SIZE           64
 
 #elif defined(HID_KEYBOARD_EXAMPLE) || defined(HID_MOUSE_EXAMPLE)
@@ -91,10 +102,85 @@
 #define NUM_INTERFACES     1
 #define NUM_ALT_INTERFACES 0
 #define NUM_ENDPOINTS      2
-#define EP0_SIZE           8
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
 #define EP1_SIZE           16
+
+#elif defined(GADGET_ZERO_EXAMPLE)
+#define NUM_CONFIGURATIONS 1
+#define NUM_INTERFACES     1
+#define NUM_ALT_INTERFACES 0
+#define NUM_ENDPOINTS      3  // 2 to 8, Gadget Zero uses EP1 to EP(NUM_ENDPOINTS - 1).
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
+#define EP1_SIZE           64 // Size of every Gadget Zero Endpoint, 8, 16, 32 or 64.
+#define EP2_SIZE           EP1_SIZE
+#define EP3_SIZE           EP1_SIZE
+#define EP4_SIZE           EP1_SIZE
+#define EP5_SIZE           EP1_SIZE
+#define EP6_SIZE           EP1_SIZE
+#define EP7_SIZE           EP1_SIZE
+
+#elif defined(VENDOR_STREAM_EXAMPLE)
+#define NUM_CONFIGURATIONS 1
+#define NUM_INTERFACES     1
+#define NUM_ALT_INTERFACES 0
+#define NUM_ENDPOINTS      2
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
+#define EP1_SIZE           64 // Vendor bulk OUT and IN, 8, 16, 32 or 64.
+
+#elif defined(HID_STREAM_EXAMPLE)
+#define NUM_CONFIGURATIONS 1
+#define NUM_INTERFACES     (NUM_ENDPOINTS - 1) // One HID interface per HID Stream channel.
+#define NUM_ALT_INTERFACES 0
+#define NUM_ENDPOINTS      4  // 2 to 8, HID Stream uses EP1 to EP(NUM_ENDPOINTS - 1).
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
+#define EP1_SIZE           64 // Report size of every HID Stream channel, 8, 16, 32 or 64.
+#define EP2_SIZE           EP1_SIZE
+#define EP3_SIZE           EP1_SIZE
+#define EP4_SIZE           EP1_SIZE
+#define EP5_SIZE           EP1_SIZE
+#define EP6_SIZE           EP1_SIZE
+#define EP7_SIZE           EP1_SIZE
+
+#elif defined(AUDIO_MICROPHONE_EXAMPLE)
+#define NUM_CONFIGURATIONS 1
+#define NUM_INTERFACES     2  // Audio Control and Audio Streaming.
+#define NUM_ALT_INTERFACES 1  // Audio Streaming alternate setting 1 has the Endpoint.
+#define NUM_ENDPOINTS      2
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
+#define EP1_SIZE           18 // AUDIO_EP_SIZE, (8 + 1) samples of 2 bytes at 8kHz mono.
+#define EP1_OUT_SIZE       0  // Audio isochronous IN only.
+
+#elif defined(CDC_NCM_EXAMPLE)
+#define NUM_CONFIGURATIONS 1
+#define NUM_INTERFACES     2  // CDC COM and DATA.
+#define NUM_ALT_INTERFACES 1  // DATA alternate setting 1 has the bulk Endpoints.
+#define NUM_ENDPOINTS      3
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
+#define EP1_SIZE           16 // CDC COM notifications, CONNECTION_SPEED_CHANGE needs 16.
+#define EP1_OUT_SIZE       0  // CDC COM is IN only.
+#define EP2_SIZE           64 // CDC DATA bulk OUT and IN.
+#elif defined(CDC_MULTI_PORT_EXAMPLE)
+#define NUM_CONFIGURATIONS 1
+#define NUM_INTERFACES     4  // COM and DATA for 2 ports.
+#define NUM_ALT_INTERFACES 0
+#define NUM_ENDPOINTS      5  // (2 * CDC_NUM_PORTS) + 1.
+#define EP0_SIZE           8  // 8, 16, 32 or 64. Larger sizes take fewer transactions per control transfer.
+#define EP1_SIZE           10 // Port 0 CDC COM.
+#define EP1_OUT_SIZE       0  // CDC COM is IN only.
+#if defined(__J_PART)
+#define EP2_SIZE           32 // Port 0 CDC DATA bulk OUT and IN, J parts have 448 bytes of USB RAM.
+#else
+#define EP2_SIZE           64 // Port 0 CDC DATA bulk OUT and IN.
+#endif
+#define EP3_SIZE           EP1_SIZE // Port 1, every port has the same Endpoint sizes.
+#define EP3_OUT_SIZE       0
+#define EP4_SIZE           EP2_SIZE
 #else
 // MAKE YOUR OWN
+// EPn_SIZE sets both directions of EPn, EPn_OUT_SIZE or EPn_IN_SIZE override one (0 if it's unused).
+// usb_hal.h packs the buffers after the BDT, and stops the build if they don't fit in USB RAM.
+// Or write a spec for Tools/Desc_Compiler and #include the usb_descriptors.h it generates here,
+// it has these counts and sizes worked out from the descriptors themselves.
 #endif
 
 /* ************************************************************************** */
@@ -151,10 +237,71 @@
 //#define USE_OUT_CONTROL_FINISHED
 
 
+#elif defined(AUDIO_MICROPHONE_EXAMPLE)
+#define INTERRUPTS_MASK (_IDLEIE | _TRNIE | _ACTVIE | _URSTIE | _SOFIE)
+#define ERROR_INTERRUPT_MASK 0
+
+//#define USE_RESET
+//#define USE_ERROR
+//#define USE_IDLE
+//#define USE_ACTIVITY
+#define USE_SOF
+//#define USE_OUT_CONTROL_FINISHED
+
+
 #else
 // MAKE YOUR OWN
 #endif
 
+// USB TASKS SETTINGS
+//#define USE_USTAT_BATCH // usb_tasks() services every transaction in the USTAT FIFO before 
+                          // returning, instead of returning after the first non-EP0 one.
+//#define USE_POLLING     // usb_tasks() is called from the main loop, the USB interrupt 
+                          // isn't used and the class libraries won't enable it.
+//#define USE_SUSPEND_SLEEP // usb_sleep() puts the CPU to Sleep while the bus is suspended.
+//#define USE_CLOCK_SCALING // Runs from the internal oscillator at CLOCK_LOW_IRCF while suspended.
+//#define USE_EVENTS      // usb_tasks() posts events, usb_event_tasks() in the main loop calls 
+                          // g_usb_event_handlers[] and idles the CPU when none are pending.
+//#define USE_ISOCHRONOUS // usb_iso_ functions for isochronous Endpoints, needs PINGPONG_1_15 or PINGPONG_ALL_EP.
+//#define USE_DEFERRED_TASKS // usb_tasks() only queues the transactions of EP1 and up, their handlers run 
+                             // from usb_deferred_tasks() in the main loop or a low priority interrupt.
+#define DEFERRED_QUEUE_SIZE 8  // Queued transactions, power of 2, up to 128.
+//#define USE_NEAR_RAM    // The per-transaction state of usb.c and the classes goes in access RAM (PIC18) 
+                          // or common RAM (PIC16), needs XC8 Address Qualifiers set to request.
+//#define USE_BD_TOGGLE   // usb_arm_endpoint() takes the next toggle from the BD, the classes don't keep one. 
+                          // Needs PINGPONG_DIS or PINGPONG_0_OUT.
+//#define USE_EP_HANDLER_TABLE // usb_tasks() calls g_usb_ep_handlers[ENDP][DIR] from usb_app.c 
+                               // directly, instead of usb_app_tasks().
+//#define USE_IF_HANDLER_TABLE // Interface Class Requests and Get Descriptor Requests go to 
+                               // g_usb_if_handlers[wIndex] from usb_app.c, for composite devices.
+//#define USE_ENUM_STATS  // Frame numbers and counts for each enumeration stage, read with usb_get_stats().
+//#define USE_FAST_ENUMERATION // Configuration descriptor lengths come from g_config_descriptor_lengths[] 
+                               // in usb_descriptors.c, instead of being read from the descriptor.
+//#define USE_EP_STATS    // Per-EP transaction and byte counts, stalls, UEIR errors, and per-frame peaks.
+//#define USE_STATS_REQUEST // The host can read the stats with a vendor request, see usb.h.
+#define STATS_REQUEST_CODE 0xE0 // bRequest of the stats vendor request.
+//#define USE_MEM_REQUEST // The host can read RAM and program memory and write RAM with a vendor request, see usb.h.
+#define MEM_REQUEST_CODE 0xE1 // bRequest of the memory vendor request.
+//#define USE_BOS         // Get Descriptor(BOS) is answered with g_bos_descriptor from usb_descriptors.c (bcdUSB 0x0201).
+//#define USE_MS_OS_20    // The MS OS 2.0 Descriptor Set vendor request is answered with g_ms_os_20_descriptor_set, 
+                          // so Windows binds WinUSB without an INF. Needs USE_BOS.
+#define MS_OS_20_VENDOR_CODE 0x20 // bMS_VendorCode, bRequest of the MS OS 2.0 vendor request.
+//#define USE_TRACE       // usb_tasks(), process_setup() and the EP handlers record entry/exit times 
+                          // in a trace ring, read with usb_trace_read().
+#define TRACE_RING_SIZE       32             // Entries (4 bytes each), power of 2, up to 128.
+#define TRACE_TIMER           TMR1
+#define TRACE_TIMER_START()   T1CON = 0x01   // TMR1 on Fosc/4, one count per instruction cycle.
+//#define USE_TIMESTAMP   // usb_get_frame() and usb_timestamp() extend the frame number to 32 bits, 
+                          // with microseconds into the frame from a timer latched at each SOF. Needs USE_SOF.
+#define TIMESTAMP_TIMER           TMR1
+#define TIMESTAMP_TIMER_START()   T1CON = 0x01 // Can share TRACE_TIMER.
+#define TIMESTAMP_TICKS_PER_US    12           // Fosc/4 at 48MHz.
+//#define USE_ARENA       // Buffers of states that are never in use together share g_usb_arena, 
+                          // X(name, bytes) per state, sizeof(g_usb_arena) is the peak. See usb.h.
+#define USB_ARENA_STATES(X) X(msd, 512) /* MSD_ARENA sector buffer, 512 more each with MSD_READ_PREFETCH and MSD_WRITE_CACHE. */ \
+                            X(app, 64)  /* Application buffers, placed with USB_ARENA_AT(). */
+//#define USB_ARENA_BUDGET 256 // Fails the build if the largest state is bigger.
+
 /* ************************************************************************** */
 
 #endif /* USB_CONFIG_H */
\ No newline at end of file
@@ -0,0 +1,46 @@
+/**
+ * @file usb_hid_stream_config.h
+ * @brief <i>HID Class</i> multi-endpoint streaming settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - HID Stream Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_HID_STREAM_CONFIG_H
+#define USB_HID_STREAM_CONFIG_H
+
+#include "usb_config.h"
+
+/* SETTINGS */
+// Channel c is interface HID_STREAM_FIRST_INT + c, with an interrupt IN and OUT 
+// on EP(c + 1). Each channel moves one report per direction per frame.
+#define HID_STREAM_FIRST_INT 0
+#define HID_STREAM_NUM_CH    (NUM_ENDPOINTS - 1) // 1 to 7, every EP after EP0.
+#define HID_STREAM_EP_SIZE   EP1_SIZE            // Report size, EP2_SIZE to EP7_SIZE must match.
+#define HID_STREAM_INTERVAL  1                   // bInterval of every HID Stream Endpoint (ms).
+
+#ifdef _PIC14E
+#warning "HID Stream EP Buffer addresses have been manually set for PIC16 devices."
+#endif
+
+#endif /* USB_HID_STREAM_CONFIG_H */
@@ -0,0 +1,55 @@
+/**
+ * @file usb_vendor_config.h
+ * @brief <i>Vendor Class</i> bulk streaming settings.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Vendor Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_VENDOR_CONFIG_H
+#define USB_VENDOR_CONFIG_H
+
+#include "usb_config.h"
+
+/* SETTINGS */
+// Interface number of the Vendor interface.
+#define VENDOR_INT 0
+
+// Vendor Endpoint HAL
+#define VENDOR_EP      EP1
+#define VENDOR_EP_SIZE EP1_SIZE
+
+#ifdef _PIC14E
+#warning "Vendor EP Buffer addresses have been manually set for PIC16 devices."
+#endif
+
+// Vendor Buffer Descriptor HAL
+#define VENDOR_BD_OUT_EVEN EP_BD_INDEX(VENDOR_EP, OUT, EVEN)
+#define VENDOR_BD_OUT_ODD  EP_BD_INDEX(VENDOR_EP, OUT, ODD)
+#define VENDOR_BD_IN_EVEN  EP_BD_INDEX(VENDOR_EP, IN, EVEN)
+#define VENDOR_BD_IN_ODD   EP_BD_INDEX(VENDOR_EP, IN, ODD)
+
+// Vendor UEPbits
+#define VENDOR_UEPbits UEP1bits
+
+#endif /* USB_VENDOR_CONFIG_H */
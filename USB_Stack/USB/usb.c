@@ -29,6 +29,7 @@
 #include <xc.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "usb.h"
 #include "usb_app.h"
 
@@ -36,6 +37,7 @@
 #define ERROR_CONDITION_FLAG      UIRbits.UERRIF
 #define ACTIVITY_DETECT_FLAG      UIRbits.ACTVIF
 #define TRANSACTION_COMPLETE_FLAG UIRbits.TRNIF
+#define TRANSACTION_COMPLETE_ENABLE UIEbits.TRNIE
 #define IDLE_DETECT_FLAG          UIRbits.IDLEIF
 #define STALL_CONDITION_FLAG      UIRbits.STALLIF
 #define SOF_FLAG                  UIRbits.SOFIF
@@ -57,10 +59,42 @@
 #define USB_ERROR_INTERRUPT_STAT_REGISTER   UEIR
 #define USB_ERROR_INTERRUPT_ENABLE_REGISTER UEIE
 #define PACKET_TRANSFER_DISABLE             UCONbits.PKTDIS
+#define USB_FRAME_NUMBER                    (((uint16_t)UFRMH << 8) | UFRML)
 #define USB_MODULE_ENABLE                   UCONbits.USBEN
 #define SINGLR_ENDED_ZERO                   UCONbits.SE0
 #define PPB_RESET                           UCONbits.PPBRST
 #define USB_SUSPEND                         UCONbits.SUSPND
+#define USB_RESUME                          UCONbits.RESUME
+
+// Remote Wakeup timing (USB 2.0 7.1.7.7). The bus must have been idle for 5ms
+// before the device drives resume (IDLEIF comes after 3ms), which lasts 1ms to 15ms.
+#define REMOTE_WAKEUP_IDLE_MS   2
+#define REMOTE_WAKEUP_RESUME_MS 2
+
+#ifdef USE_EVENTS
+#define POST_EVENT(event) m_events |= (uint16_t)1 << (event)
+#else
+#define POST_EVENT(event)
+#endif
+
+#ifdef USE_DEFERRED_TASKS
+#define DEFERRED_PENDING() (m_deferred_head != m_deferred_tail)
+#else
+#define DEFERRED_PENDING() false
+#endif
+
+#ifdef USE_EP_HANDLER_TABLE
+#define EP_HANDLER() if(g_usb_ep_handlers[TRANSACTION_EP][TRANSACTION_DIR]) g_usb_ep_handlers[TRANSACTION_EP][TRANSACTION_DIR]()
+#else
+#define EP_HANDLER() usb_app_tasks()
+#endif
+
+// MEM_SPACE_EEPROM, on PIC18s with data EEPROM.
+#if defined(USE_MEM_REQUEST) && defined(_PIC18) && defined(_EEPROMSIZE) && (_EEPROMSIZE > 0) && !defined(USB_SIM)
+#define MEM_EEPROM
+#define DATA_EE 2 // usb_setup_in_control_transfer() source next to ROM and RAM.
+#define MEM_EEPROM_WRITE (g_usb_setup.bmRequestType == 0x40 && g_usb_setup.bRequest == MEM_REQUEST_CODE && g_usb_setup.wIndex == MEM_SPACE_EEPROM)
+#endif
 
 #if defined(_18F13K50) || defined(_18F14K50)
 struct // PIC18F14K50.h is outdated
@@ -76,21 +110,50 @@ struct // PIC18F14K50.h is outdated
 /* ************************* GLOBAL VARIABLES ******************************* */
 /* ************************************************************************** */
 
-usb_ustat_t             g_usb_last_USTAT;
+USB_NEAR usb_ustat_t    g_usb_last_USTAT;
+#ifndef USB_SIM // Placed by usb.h.
 ch9_setup_t             g_usb_setup             __at(SETUP_DATA_ADDR);
 ch9_get_descriptor_t    g_usb_get_descriptor    __at(SETUP_DATA_ADDR);
 ch9_set_configuration_t g_usb_set_configuration __at(SETUP_DATA_ADDR);
 ch9_set_interface_t     g_usb_set_interface     __at(SETUP_DATA_ADDR);
 ch9_get_interface_t     g_get_interface         __at(SETUP_DATA_ADDR);
+#endif
 
 usb_ep_stat_t           g_usb_ep_stat[NUM_ENDPOINTS][2];
+#ifdef USE_EP_STATS
+usb_ep_counters_t       g_usb_ep_counters[NUM_ENDPOINTS][2];
+#endif
+#ifdef USE_TRACE
+usb_trace_entry_t       g_usb_trace[TRACE_RING_SIZE];
+uint8_t                 g_usb_trace_head;
+uint8_t                 g_usb_trace_count;
+#endif
+#ifdef USE_ARENA
+usb_arena_t             g_usb_arena;
+#ifdef USB_ARENA_BUDGET
+USB_ARENA_ASSERT(budget, sizeof(usb_arena_t) <= USB_ARENA_BUDGET); // The largest state is over USB_ARENA_BUDGET.
+#endif
+#endif
+#ifndef USB_SIM
 bd_t                    g_usb_bd_table[NUM_BD] __at(BDT_BASE_ADDR);
+#endif
 
 // The following are from: usb_descriptors.c
 extern const ch9_device_descriptor_t g_device_descriptor;
-extern const uint16_t                g_config_descriptors[];
-extern const uint16_t                g_string_descriptors[];
+extern const usb_desc_addr_t         g_config_descriptors[];
+extern const usb_desc_addr_t         g_string_descriptors[];
 extern const uint8_t                 g_size_of_sd;
+#ifdef USE_FAST_ENUMERATION
+extern const uint16_t                g_config_descriptor_lengths[];
+#endif
+#ifdef USE_BOS
+extern const uint8_t*                g_bos_descriptor;
+extern const uint16_t                g_bos_descriptor_size;
+#endif
+#ifdef USE_MS_OS_20
+extern const uint8_t*                g_ms_os_20_descriptor_set;
+extern const uint16_t                g_ms_os_20_descriptor_set_size;
+#endif
 
 /* ************************************************************************** */
 
@@ -99,7 +162,14 @@ extern const uint8_t                 g_size_of_sd;
 /* ************************* LOCAL VARIABLES ******************************** */
 /* ************************************************************************** */
 
-#if (PINGPONG_MODE == PINGPONG_DIS) || (PINGPONG_MODE == PINGPONG_1_15)
+#if defined(USB_SIM)
+#define m_ep0_out      USB_SIM_AT_ARRAY(uint8_t, EP0_SIZE, EP0_OUT_BUFFER_BASE_ADDR)
+#define m_ep0_in       USB_SIM_AT_ARRAY(uint8_t, EP0_SIZE, EP0_IN_BUFFER_BASE_ADDR)
+#define m_ep0_out_even USB_SIM_AT_ARRAY(uint8_t, EP0_SIZE, EP0_OUT_EVEN_BUFFER_BASE_ADDR)
+#define m_ep0_out_odd  USB_SIM_AT_ARRAY(uint8_t, EP0_SIZE, EP0_OUT_ODD_BUFFER_BASE_ADDR)
+#define m_ep0_in_even  USB_SIM_AT_ARRAY(uint8_t, EP0_SIZE, EP0_IN_EVEN_BUFFER_BASE_ADDR)
+#define m_ep0_in_odd   USB_SIM_AT_ARRAY(uint8_t, EP0_SIZE, EP0_IN_ODD_BUFFER_BASE_ADDR)
+#elif (PINGPONG_MODE == PINGPONG_DIS) || (PINGPONG_MODE == PINGPONG_1_15)
 static uint8_t m_ep0_out[EP0_SIZE]      __at(EP0_OUT_BUFFER_BASE_ADDR);
 static uint8_t m_ep0_in[EP0_SIZE]       __at(EP0_IN_BUFFER_BASE_ADDR);
 
@@ -118,21 +188,73 @@ static uint8_t m_ep0_in_odd[EP0_SIZE]   __at(EP0_IN_ODD_BUFFER_BASE_ADDR);
 static usb_dev_settings_t  m_dev_settings;
 static uint8_t             m_saved_address;
 static bool                m_update_address;
-static uint8_t             m_usb_state = STATE_DETACHED;
-static uint8_t             m_control_stage;
+static USB_NEAR uint8_t    m_usb_state = STATE_DETACHED;
+static uint8_t             m_usb_state_prev; // State to go back to when leaving STATE_SUSPENDED.
+#ifdef USE_EVENTS
+static volatile uint16_t   m_events;         // Bit n set, event n waits for usb_event_tasks().
+#endif
+#ifdef USE_DEFERRED_TASKS
+static volatile uint8_t    m_deferred[DEFERRED_QUEUE_SIZE]; // USTAT of each transaction waiting for usb_deferred_tasks().
+static volatile uint8_t    m_deferred_head;  // Written by usb_tasks().
+static volatile uint8_t    m_deferred_tail;  // Written by usb_deferred_tasks().
+#endif
+static USB_NEAR uint8_t    m_control_stage;
 static uint8_t             m_current_configuration;
+#ifdef USE_TIMESTAMP
+static uint32_t            m_frame;          // usb_get_frame().
+static uint16_t            m_frame_last;     // 11 bit frame number at the last SOF.
+static uint16_t            m_frame_time;     // TIMESTAMP_TIMER at the last SOF.
+#endif
+#ifdef USE_CLOCK_SCALING
+static bool                m_clock_low;      // Running from CLOCK_LOW_IRCF, the registers below hold the full clock.
+static uint8_t             m_clock_osccon;
+#if !defined(_PIC14E) && !defined(_18F4450_FAMILY_) && !defined(_18F4550_FAMILY_)
+static bool                m_clock_pll;
+#endif
+#if defined(_PIC14E) || defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+static uint8_t             m_clock_actcon;
+#endif
+#endif
 
+#if defined(USB_SIM)
+#define m_get_status        USB_SIM_AT(ch9_get_status_t, SETUP_DATA_ADDR)
+#define m_set_address       USB_SIM_AT(ch9_set_address_t, SETUP_DATA_ADDR)
+#define m_set_clear_feature USB_SIM_AT(ch9_set_clear_feature_t, SETUP_DATA_ADDR)
+#else
 static ch9_get_status_t        m_get_status        __at(SETUP_DATA_ADDR);
 static ch9_set_address_t       m_set_address       __at(SETUP_DATA_ADDR);
 static ch9_set_clear_feature_t m_set_clear_feature __at(SETUP_DATA_ADDR);
+#endif
+
+static USB_ACCESS const uint8_t* m_rom_ptr;
+static USB_ACCESS uint8_t*       m_ram_ptr;
+static USB_ACCESS uint8_t        m_sending_from;
+#ifdef MEM_EEPROM
+static uint16_t                  m_eeprom_addr;
+#endif
+static bool                      m_send_short;
 
-static const uint8_t*      m_rom_ptr;
-static uint8_t*            m_ram_ptr;
-static uint8_t             m_sending_from;
-static bool                m_send_short;
+static USB_ACCESS uint16_t       m_bytes_2_recv;
+static USB_ACCESS uint16_t       m_bytes_2_send;
 
-static uint16_t            m_bytes_2_recv;
-static uint16_t            m_bytes_2_send;
+#ifdef USE_ENUM_STATS
+static usb_stats_t         m_stats;
+#endif
+#ifdef USE_EP_STATS
+static usb_bus_stats_t     m_bus_stats;
+#endif
+#ifdef USE_STATS_REQUEST
+static union
+{
+    #ifdef USE_ENUM_STATS
+    usb_stats_t       Enum;
+    #endif
+    #ifdef USE_EP_STATS
+    usb_bus_stats_t   Bus;
+    usb_ep_counters_t EP;
+    #endif
+}m_stats_snapshot; // Sent from here, the live stats can change during the transfer.
+#endif
 
 /* ************************************************************************** */
 
@@ -141,6 +263,16 @@ static uint16_t            m_bytes_2_send;
 /* ************************ LOCAL FUNCTION DECLARATIONS ********************* */
 /* ************************************************************************** */
 
+#if defined(USE_TRACE) || defined(USE_DEFERRED_TASKS)
+/**
+ * @fn void usb_service(void)
+ * 
+ * @brief The body of usb_tasks(), which wraps it in trace entries and, with 
+ * USE_DEFERRED_TASKS, keeps g_usb_last_USTAT for the handler it interrupted.
+ */
+static void usb_service(void);
+#endif
+
 /**
  * @fn void usb_restart(void);
  * 
@@ -172,6 +304,37 @@ static void arm_setup(void);
  */
 static void process_setup(void);
 
+/**
+ * @fn void standard_request(void)
+ * 
+ * @brief Runs the m_standard_requests entry of bRequest, if the recipient is 
+ * one the request can have.
+ */
+static void standard_request(void);
+
+/**
+ * @fn void class_request(void)
+ * 
+ * @brief Passes a Class Request to the interface's handler, or 
+ * usb_service_class_request().
+ */
+static void class_request(void);
+
+/**
+ * @fn void vendor_request(void)
+ * 
+ * @brief Answers the stack's own Vendor Requests, then passes the rest to the 
+ * interface's handler, or usb_service_class_request().
+ */
+static void vendor_request(void);
+
+/**
+ * @fn void reserved_request(void)
+ * 
+ * @brief Stalls a request with the reserved Type (3).
+ */
+static void reserved_request(void);
+
 /**
  * @fn void get_status(void)
  * 
@@ -235,6 +398,15 @@ static void get_configuration(void);
  */
 static void set_configuration(void);
 
+/**
+ * @fn void disable_app_endpoints(void)
+ * 
+ * @brief Disables EP1 to EP15 and takes their BDs back from the SIE, so the 
+ * Endpoints of the last configuration are gone before usb_app_init() sets up 
+ * the new one's. Data Toggles go back to DATA0 and Halts are cleared.
+ */
+static void disable_app_endpoints(void);
+
 /**
  * @fn void get_interface(void)
  * 
@@ -256,6 +428,137 @@ static void set_interface(void);
  */
 static void sync_frame(void);
 
+#ifdef USE_STATS_REQUEST
+/**
+ * @fn void stats_request(void)
+ * 
+ * @brief Sends the stats selected by wIndex for the STATS_REQUEST_CODE vendor request.
+ */
+static void stats_request(void);
+#endif
+
+#ifdef USE_MEM_REQUEST
+/**
+ * @fn void mem_request(void)
+ * 
+ * @brief Reads or writes the memory selected by wIndex and wValue for the 
+ * MEM_REQUEST_CODE vendor request.
+ */
+static void mem_request(void);
+#endif
+
+#ifdef MEM_EEPROM
+/**
+ * @fn void eeprom_read(uint8_t* dst, uint8_t bytes)
+ * 
+ * @brief Reads bytes of data EEPROM from m_eeprom_addr on.
+ * 
+ * @param[out] dst   EP0 IN buffer.
+ * @param[in]  bytes Bytes to read.
+ */
+static void eeprom_read(uint8_t* dst, uint8_t bytes);
+
+/**
+ * @fn void eeprom_write(const uint8_t* src, uint8_t bytes)
+ * 
+ * @brief Writes bytes of data EEPROM from m_eeprom_addr on, waiting for each 
+ * one. Bytes that already match aren't written.
+ * 
+ * @param[in] src   EP0 OUT buffer.
+ * @param[in] bytes Bytes to write.
+ */
+static void eeprom_write(const uint8_t* src, uint8_t bytes);
+#endif
+
+#ifdef USE_MS_OS_20
+/**
+ * @fn void ms_os_20_request(void)
+ * 
+ * @brief Sends the MS OS 2.0 Descriptor Set for the MS_OS_20_VENDOR_CODE vendor request.
+ */
+static void ms_os_20_request(void);
+#endif
+
+#ifdef USE_CLOCK_SCALING
+/**
+ * @fn void clock_low(void)
+ * 
+ * @brief Saves the clock settings, then runs the CPU from the internal 
+ * oscillator at CLOCK_LOW_IRCF with the PLL and ACT off.
+ */
+static void clock_low(void);
+
+/**
+ * @fn void clock_full(void)
+ * 
+ * @brief Puts back the clock settings clock_low() saved and waits for the 
+ * PLL, so the USB module has its 48MHz clock again.
+ */
+static void clock_full(void);
+#endif
+
+#ifdef USE_IF_HANDLER_TABLE
+/**
+ * @fn const usb_if_handler_t* if_handler(void)
+ * 
+ * @brief Finds the g_usb_if_handlers entry of the current Setup Packet.
+ * 
+ * @return Returns the entry selected by wIndex for an Interface recipient, 
+ * otherwise NULL.
+ */
+static const usb_if_handler_t* if_handler(void);
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** REQUEST TABLES ******************************** */
+/* ************************************************************************** */
+
+// Recipient bits of a usb_request_t.
+#define RCPT_DEVICE    (1 << DEVICE)
+#define RCPT_INTERFACE (1 << INTERFACE)
+#define RCPT_ENDPOINT  (1 << ENDPOINT)
+
+/** Standard Request Table Entry */
+typedef struct
+{
+    void  (*handler)(void);
+    uint8_t recipients;     ///< RCPT_ bits of the recipients USB 2.0 Table 9-3 allows.
+}usb_request_t;
+
+/** 
+ * Standard Requests indexed by bRequest. The first level is the request type, 
+ * m_request_types[], so any Setup Packet is two table lookups from its handler 
+ * whatever the request. Reserved values have no recipients.
+ */
+static const usb_request_t m_standard_requests[SYNC_FRAME + 1] =
+{
+    [GET_STATUS]        = {get_status,        RCPT_DEVICE | RCPT_INTERFACE | RCPT_ENDPOINT},
+    [CLEAR_FEATURE]     = {set_clear_feature, RCPT_DEVICE | RCPT_INTERFACE | RCPT_ENDPOINT},
+    [2]                 = {NULL,              0},
+    [SET_FEATURE]       = {set_clear_feature, RCPT_DEVICE | RCPT_INTERFACE | RCPT_ENDPOINT},
+    [4]                 = {NULL,              0},
+    [SET_ADDRESS]       = {set_address,       RCPT_DEVICE},
+    [GET_DESCRIPTOR]    = {get_descriptor,    RCPT_DEVICE | RCPT_INTERFACE}, // Interface for Class Descriptors (HID).
+    [SET_DESCRIPTOR]    = {set_descriptor,    RCPT_DEVICE},
+    [GET_CONFIGURATION] = {get_configuration, RCPT_DEVICE},
+    [SET_CONFIGURATION] = {set_configuration, RCPT_DEVICE},
+    [GET_INTERFACE]     = {get_interface,     RCPT_INTERFACE},
+    [SET_INTERFACE]     = {set_interface,     RCPT_INTERFACE},
+    [SYNC_FRAME]        = {sync_frame,        RCPT_ENDPOINT}
+};
+
+/** Request handlers indexed by the Type bits of bmRequestType (3 is reserved). */
+static void (* const m_request_types[4])(void) =
+{
+    standard_request,
+    class_request,
+    vendor_request,
+    reserved_request
+};
+
 /* ************************************************************************** */
 
 
@@ -265,6 +568,24 @@ static void sync_frame(void);
 
 void usb_init(void)
 {
+    #ifdef USE_TRACE
+    TRACE_TIMER_START();
+    #endif
+    #ifdef USE_TIMESTAMP
+    TIMESTAMP_TIMER_START();
+    m_frame = 0;
+    m_frame_last = 0;
+    #endif
+    #ifdef USE_ENUM_STATS
+    usb_ram_set(0, (uint8_t*)&m_stats, sizeof(m_stats));
+    #endif
+    #ifdef USE_EP_STATS
+    usb_ram_set(0, (uint8_t*)g_usb_ep_counters, sizeof(g_usb_ep_counters));
+    usb_ram_set(0, (uint8_t*)&m_bus_stats, sizeof(m_bus_stats));
+    #endif
+    #if defined(USE_DEFERRED_TASKS) && !defined(_PIC14E)
+    USB_INTERRUPT_PRIORITY = 1;
+    #endif
     USB_INTERRUPT_ENABLE_REGISTER = _URSTIE;
     RESET_CONDITION_FLAG = 1; // Force a reset so that initialization happens
                               // inside the interrupt context (if interrupts 
@@ -310,6 +631,9 @@ void usb_close(void)
     USB_ERROR_INTERRUPT_STAT_REGISTER = 0;
     
     m_usb_state = STATE_DETACHED;
+    #ifdef USE_CLOCK_SCALING
+    clock_full(); // Closed while suspended, the application carries on at the boot clock.
+    #endif
 }
 
 uint8_t usb_get_state(void)
@@ -322,15 +646,271 @@ uint8_t usb_get_configuration(void)
     return m_current_configuration;
 }
 
+bool usb_get_remote_wakeup(void)
+{
+    return m_dev_settings.Remote_Wakeup == REMOTE_WAKEUP_ON;
+}
+
+bool usb_remote_wakeup(void)
+{
+    if(m_usb_state != STATE_SUSPENDED || m_dev_settings.Remote_Wakeup == REMOTE_WAKEUP_OFF) return false;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    #ifdef USE_CLOCK_SCALING
+    clock_full(); // Before the delays too, they count at _XTAL_FREQ.
+    #endif
+    __delay_ms(REMOTE_WAKEUP_IDLE_MS);
+    USB_SUSPEND = 0;
+    USB_RESUME = 1;
+    __delay_ms(REMOTE_WAKEUP_RESUME_MS);
+    USB_RESUME = 0;
+    
+    // The host carries on the resume for 20ms, then SOFs start again. Our own
+    // signalling was the activity, so leave suspend here rather than in usb_tasks().
+    ACTIVITY_DETECT_ENABLE = 0;
+    while(ACTIVITY_DETECT_FLAG) ACTIVITY_DETECT_FLAG = 0;
+    m_usb_state = m_usb_state_prev;
+    POST_EVENT(EVENT_RESUME);
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    return true;
+}
+
+#ifdef USE_SUSPEND_SLEEP
+void usb_sleep(void)
+{
+    bool gie  = INTCONbits.GIE;
+    bool peie = INTCONbits.PEIE;
+    
+    // With GIE clear the USB interrupt can't slip in between the check and 
+    // SLEEP, a flag set meanwhile makes SLEEP return straight away.
+    INTCONbits.GIE = 0;
+    if(m_usb_state == STATE_SUSPENDED)
+    {
+        #ifdef USE_POLLING
+        USB_INTERRUPT_FLAG = 0;
+        #endif
+        INTCONbits.PEIE = 1;
+        USB_INTERRUPT_ENABLE = 1; // Wake up source (ACTVIE is set while suspended).
+        SLEEP();
+        NOP();
+        
+        // The USB module needs its 48MHz clock back before SUSPND is cleared. 
+        // The other parts hold the CPU in their start-up timers until the PLL locks. 
+        // With USE_CLOCK_SCALING the PLL is off, the activity brings it back.
+        #ifndef USE_CLOCK_SCALING
+        #if defined(_PIC14E)
+        while(!OSCSTATbits.PLLRDY){}
+        #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+        while(!OSCCON2bits.PLLRDY){}
+        #endif
+        #endif
+        
+        #ifdef USE_POLLING
+        USB_INTERRUPT_ENABLE = 0;
+        #endif
+        INTCONbits.PEIE = peie;
+    }
+    INTCONbits.GIE = gie; // With interrupts the activity is serviced here.
+}
+#endif
+
+#ifdef USE_EVENTS
+void usb_post_event(uint8_t event)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    POST_EVENT(event);
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+void usb_event_tasks(void)
+{
+    uint16_t events;
+    
+    #ifdef USE_DEFERRED_TASKS
+    usb_deferred_tasks();
+    #endif
+    
+    #ifdef USE_POLLING
+    usb_tasks();
+    #else
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    events = m_events;
+    m_events = 0;
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    
+    if(events == 0)
+    {
+        #ifdef USE_SUSPEND_SLEEP
+        usb_sleep();
+        #endif
+        
+        // Idle mode stops the CPU only, the USB module keeps its clock and 
+        // its next interrupt wakes the CPU. PIC16F145X has no Idle mode.
+        #if !defined(_PIC14E) && !defined(USE_POLLING)
+        bool gie = INTCONbits.GIE;
+        INTCONbits.GIE = 0;
+        if(m_events == 0 && !DEFERRED_PENDING())
+        {
+            OSCCONbits.IDLEN = 1;
+            SLEEP();
+            NOP();
+            OSCCONbits.IDLEN = 0;
+        }
+        INTCONbits.GIE = gie;
+        #endif
+        return;
+    }
+    
+    for(uint8_t event = 0; event < NUM_EVENTS; event++)
+    {
+        if((events & 1) && g_usb_event_handlers[event]) g_usb_event_handlers[event]();
+        events >>= 1;
+    }
+}
+#endif
+
 void usb_set_control_stage(uint8_t control_stage)
 {
     m_control_stage = control_stage;
 }
 
+#ifdef USE_ENUM_STATS
+void usb_get_stats(usb_stats_t* p_stats)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    *p_stats = m_stats;
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+void usb_clear_stats(void)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    usb_ram_set(0, (uint8_t*)&m_stats, sizeof(m_stats));
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+#endif
+
+#ifdef USE_EP_STATS
+void usb_get_ep_counters(uint8_t ep, uint8_t dir, usb_ep_counters_t* p_counters)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    *p_counters = g_usb_ep_counters[ep][dir];
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+void usb_get_bus_stats(usb_bus_stats_t* p_stats)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    *p_stats = m_bus_stats;
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+void usb_clear_ep_stats(void)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    usb_ram_set(0, (uint8_t*)g_usb_ep_counters, sizeof(g_usb_ep_counters));
+    usb_ram_set(0, (uint8_t*)&m_bus_stats, sizeof(m_bus_stats));
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+#endif
+
+#ifdef USE_TRACE
+uint8_t usb_trace_read(usb_trace_entry_t* p_entries, uint8_t max_entries)
+{
+    uint8_t entries;
+    uint8_t tail;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    entries = g_usb_trace_count < max_entries ? g_usb_trace_count : max_entries;
+    tail = (g_usb_trace_head - g_usb_trace_count) & (TRACE_RING_SIZE - 1);
+    g_usb_trace_count -= entries;
+    for(uint8_t i = 0; i < entries; i++)
+    {
+        p_entries[i] = g_usb_trace[tail];
+        tail = (tail + 1) & (TRACE_RING_SIZE - 1);
+    }
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    return entries;
+}
+#endif
+
+#ifdef USE_DEFERRED_TASKS
+void usb_deferred_tasks(void)
+{
+    if(!USB_INTERRUPT_ENABLE) return; // Interrupted a critical section.
+    
+    if(m_usb_state < STATE_ADDRESS) m_deferred_tail = m_deferred_head; // Reset, the transactions are stale.
+    
+    while(m_deferred_tail != m_deferred_head)
+    {
+        *((uint8_t*)&g_usb_last_USTAT) = m_deferred[m_deferred_tail & (DEFERRED_QUEUE_SIZE - 1)];
+        USB_TRACE_MAIN(TRACE_EP_HANDLER);
+        EP_HANDLER();
+        USB_TRACE_MAIN(TRACE_EP_HANDLER | TRACE_EXIT);
+        #ifdef USE_EVENTS
+        usb_post_event(EVENT_EP(TRANSACTION_EP));
+        #endif
+        m_deferred_tail++;
+    }
+    TRANSACTION_COMPLETE_ENABLE = 1; // In case the queue filled up.
+}
+#endif
+
+#if defined(USE_TRACE) || defined(USE_DEFERRED_TASKS)
 void usb_tasks(void)
 {
-    static uint8_t usb_state_prev;
+    #ifdef USE_DEFERRED_TASKS
+    uint8_t ustat = *((uint8_t*)&g_usb_last_USTAT);
+    #endif
     
+    USB_TRACE(TRACE_USB_TASKS);
+    usb_service();
+    USB_TRACE(TRACE_USB_TASKS | TRACE_EXIT);
+    #ifdef USE_DEFERRED_TASKS
+    *((uint8_t*)&g_usb_last_USTAT) = ustat;
+    #endif
+}
+
+static void usb_service(void)
+#else
+void usb_tasks(void)
+#endif
+{
     if(ACTIVITY_DETECT_FLAG && ACTIVITY_DETECT_ENABLE)
     {
         #ifdef USE_ACTIVITY
@@ -340,8 +920,12 @@ void usb_tasks(void)
         
         if(m_usb_state == STATE_SUSPENDED)
         {
+            #ifdef USE_CLOCK_SCALING
+            clock_full();
+            #endif
             USB_SUSPEND = 0;
-            m_usb_state = usb_state_prev;
+            m_usb_state = m_usb_state_prev;
+            POST_EVENT(EVENT_RESUME);
         }
         
         while(ACTIVITY_DETECT_FLAG) ACTIVITY_DETECT_FLAG = 0;
@@ -356,6 +940,7 @@ void usb_tasks(void)
         #ifdef USE_RESET
         usb_reset();
         #endif
+        POST_EVENT(EVENT_RESET);
         RESET_CONDITION_FLAG = 0;
     }
     
@@ -363,18 +948,33 @@ void usb_tasks(void)
     {
         ACTIVITY_DETECT_ENABLE = 1;
         USB_SUSPEND = 1;
-        usb_state_prev = m_usb_state;
+        #ifdef USE_CLOCK_SCALING
+        clock_low();
+        #endif
+        m_usb_state_prev = m_usb_state;
         m_usb_state = STATE_SUSPENDED;
         #ifdef USE_IDLE
         usb_idle();
         #endif
+        POST_EVENT(EVENT_SUSPEND);
         IDLE_DETECT_FLAG = 0;
     }
     
     #ifdef USE_SOF
     if(SOF_FLAG)
     {
+        #ifdef USE_TIMESTAMP
+        m_frame_time = TIMESTAMP_TIMER;
+        m_frame += (USB_FRAME_NUMBER - m_frame_last) & 0x7FF;
+        m_frame_last = (uint16_t)m_frame & 0x7FF;
+        #endif
+        #ifdef USE_EP_STATS
+        m_bus_stats.Frames++;
+        if(m_bus_stats.Frame_Transactions > m_bus_stats.Frame_Peak) m_bus_stats.Frame_Peak = m_bus_stats.Frame_Transactions;
+        m_bus_stats.Frame_Transactions = 0;
+        #endif
         usb_sof();
+        POST_EVENT(EVENT_SOF);
         SOF_FLAG = 0;
     }
     #endif
@@ -382,6 +982,15 @@ void usb_tasks(void)
     #ifdef USE_ERROR
     if(ERROR_CONDITION_FLAG)
     {
+        #ifdef USE_EP_STATS
+        uint8_t errors = USB_ERROR_INTERRUPT_STAT_REGISTER; // UEIR flags share the UEIE bit positions.
+        if(errors & _PIDEE)   m_bus_stats.PID_Errors++;
+        if(errors & _CRC5EE)  m_bus_stats.CRC5_Errors++;
+        if(errors & _CRC16EE) m_bus_stats.CRC16_Errors++;
+        if(errors & _DFN8EE)  m_bus_stats.DFN8_Errors++;
+        if(errors & _BTOEE)   m_bus_stats.Timeout_Errors++;
+        if(errors & _BTSEE)   m_bus_stats.Bit_Stuff_Errors++;
+        #endif
         usb_error();
         ERROR_CONDITION_FLAG = 0;
     }
@@ -391,25 +1000,59 @@ void usb_tasks(void)
     
     while(TRANSACTION_COMPLETE_FLAG)
     {
+        #ifdef USE_DEFERRED_TASKS
+        if((uint8_t)(m_deferred_head - m_deferred_tail) == DEFERRED_QUEUE_SIZE)
+        {
+            TRANSACTION_COMPLETE_ENABLE = 0; // Leave the rest in the USTAT FIFO until usb_deferred_tasks() catches up.
+            return;
+        }
+        #endif
         NOP();
         NOP();
         *((uint8_t*)&g_usb_last_USTAT) = USTAT;  // Save a copy of USTAT and clear the Transaction Complete Flag.
         TRANSACTION_COMPLETE_FLAG = 0;           // This is to advance the FIFO fast as possible.
         
+        #ifdef USE_EP_STATS
+        {
+            bd_t* p_bd = TRANSACTION_BD; // Read before anything re-arms it, BC9:BC8 are the top of the count.
+            g_usb_ep_counters[TRANSACTION_EP][TRANSACTION_DIR].Transactions++;
+            g_usb_ep_counters[TRANSACTION_EP][TRANSACTION_DIR].Bytes += p_bd->CNT | ((uint16_t)(p_bd->STAT & (_BC9 | _BC8)) << 8);
+        }
+        if(m_bus_stats.Frame_Transactions != 0xFF) m_bus_stats.Frame_Transactions++;
+        #endif
+        
         if(TRANSACTION_EP != EP0)
         {
-            usb_app_tasks();
+            #ifdef USE_DEFERRED_TASKS
+            m_deferred[m_deferred_head & (DEFERRED_QUEUE_SIZE - 1)] = *((uint8_t*)&g_usb_last_USTAT);
+            m_deferred_head++;
+            continue; // Keep draining the USTAT FIFO.
+            #else
+            USB_TRACE(TRACE_EP_HANDLER);
+            EP_HANDLER();
+            USB_TRACE(TRACE_EP_HANDLER | TRACE_EXIT);
+            POST_EVENT(EVENT_EP(TRANSACTION_EP));
+            #ifdef USE_USTAT_BATCH
+            continue; // Keep draining the USTAT FIFO.
+            #else
             return;
+            #endif
+            #endif
         }
         
         if(TRANSACTION_DIR == OUT)
         {
             #if PINGPONG_MODE == PINGPONG_0_OUT || PINGPONG_MODE == PINGPONG_ALL_EP
             EP0_OUT_LAST_PPB = PINGPONG_PARITY;
-            if(g_usb_bd_table[PINGPONG_PARITY].STATbits.PID == PID_SETUP_TOKEN) process_setup();
+            if(g_usb_bd_table[PINGPONG_PARITY].STATbits.PID == PID_SETUP_TOKEN)
             #else
-            if(g_usb_bd_table[BD0_OUT].STATbits.PID == PID_SETUP_TOKEN) process_setup();
+            if(g_usb_bd_table[BD0_OUT].STATbits.PID == PID_SETUP_TOKEN)
             #endif
+            {
+                USB_TRACE(TRACE_SETUP);
+                process_setup();
+                USB_TRACE(TRACE_SETUP | TRACE_EXIT);
+            }
             else
             {
                 if(m_control_stage == DATA_OUT_STAGE)
@@ -433,7 +1076,11 @@ void usb_tasks(void)
             else
             {
                 arm_setup();
+                #if defined(USE_USTAT_BATCH) || defined(USE_DEFERRED_TASKS)
+                if(!m_update_address) continue;
+                #else
                 if(!m_update_address) return;
+                #endif
                 
                 UADDR = m_saved_address;
                 if(m_usb_state == STATE_DEFAULT && m_saved_address != 0) m_usb_state = STATE_ADDRESS;
@@ -444,12 +1091,183 @@ void usb_tasks(void)
     }
 }
     
-void usb_arm_endpoint(bd_t* p_bd, usb_ep_stat_t* p_ep_stat, uint8_t cnt)
+void usb_arm_endpoint(bd_t* p_bd, usb_ep_stat_t* p_ep_stat, uint8_t cnt)
+{
+    #ifdef USE_BD_TOGGLE
+    // The SIE doesn't write DTS back, so the BD still has its last packet's toggle.
+    if(p_ep_stat->Data_Toggle_Val) p_bd->STAT = (p_bd->STAT & _DTS) ^ (_DTS | _DTSEN);
+    else
+    {
+        p_bd->STAT = _DTSEN; // DATA0 after a reset, Clear Halt or Set Interface.
+        p_ep_stat->Data_Toggle_Val = 1;
+    }
+    #else
+    p_bd->STAT  = p_ep_stat->Data_Toggle_Val ? _DTSEN | _DTS : _DTSEN;
+    #endif
+    p_bd->CNT   = cnt;
+    p_bd->STAT |= _UOWN;
+}
+
+#if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+#define NEXT_PPB(ep, dir) (g_usb_ep_stat[ep][dir].Last_PPB ^ 1)
+#define LAST_PPB(ep, dir) (g_usb_ep_stat[ep][dir].Last_PPB)
+#else
+#define NEXT_PPB(ep, dir) 0
+#define LAST_PPB(ep, dir) 0
+#endif
+
+bool usb_set_bd_buffer(bd_t* p_bd, uint8_t* p_buffer, uint16_t bytes)
+{
+    if(!USB_SIE_REACHABLE(p_buffer, bytes)) return false;
+    p_bd->ADR = USB_RAM_ADDR(p_buffer);
+    return true;
+}
+
+uint8_t* usb_ep_acquire_in(uint8_t ep)
+{
+    bd_t* p_bd = &g_usb_bd_table[EP_BD_INDEX(ep, IN, NEXT_PPB(ep, IN))];
+    
+    if(p_bd->STAT & _UOWN) return NULL;
+    return USB_RAM_PTR(p_bd->ADR);
+}
+
+void usb_ep_commit_in(uint8_t ep, uint8_t cnt)
+{
+    usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(ep, IN, NEXT_PPB(ep, IN))], &g_usb_ep_stat[ep][IN], cnt);
+}
+
+uint8_t* usb_ep_peek_out(uint8_t ep, uint8_t* p_cnt)
+{
+    bd_t* p_bd = &g_usb_bd_table[EP_BD_INDEX(ep, OUT, LAST_PPB(ep, OUT))];
+    
+    if(p_bd->STAT & _UOWN) return NULL;
+    *p_cnt = p_bd->CNT;
+    return USB_RAM_PTR(p_bd->ADR);
+}
+
+void usb_ep_release_out(uint8_t ep, uint8_t cnt)
+{
+    usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(ep, OUT, NEXT_PPB(ep, OUT))], &g_usb_ep_stat[ep][OUT], cnt);
+}
+
+uint16_t usb_get_frame_number(void)
+{
+    return USB_FRAME_NUMBER;
+}
+
+#ifdef USE_TIMESTAMP
+uint32_t usb_get_frame(void)
+{
+    uint32_t frame;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    frame = m_frame;
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    return frame;
+}
+
+void usb_timestamp(usb_timestamp_t* p_timestamp)
+{
+    uint16_t time;
+    uint16_t micros;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    time = TIMESTAMP_TIMER - m_frame_time;
+    p_timestamp->Frame = m_frame;
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    
+    micros = time / TIMESTAMP_TICKS_PER_US;
+    p_timestamp->Micros = (micros > 999) ? 999 : micros;
+}
+
+uint8_t usb_timestamp_header(uint8_t* p_buffer)
+{
+    usb_timestamp_t timestamp;
+    
+    usb_timestamp(&timestamp);
+    p_buffer[0] = (uint8_t)timestamp.Frame;
+    p_buffer[1] = (uint8_t)(timestamp.Frame >> 8);
+    p_buffer[2] = (uint8_t)(timestamp.Frame >> 16);
+    p_buffer[3] = (uint8_t)(timestamp.Frame >> 24);
+    p_buffer[4] = (uint8_t)timestamp.Micros;
+    p_buffer[5] = (uint8_t)(timestamp.Micros >> 8);
+    return TIMESTAMP_HEADER_SIZE;
+}
+#endif
+
+#ifdef USE_ISOCHRONOUS
+static void arm_iso(bd_t* p_bd, uint16_t cnt)
+{
+    p_bd->STAT  = (uint8_t)(cnt >> 8) & (_BC9 | _BC8); // No DTSEN, any DATA0/DATA1 is taken.
+    p_bd->CNT   = (uint8_t)cnt;
+    p_bd->STAT |= _UOWN;
+}
+
+void usb_iso_ep_init(uint8_t ep, uint8_t dir, uint16_t even_addr, uint16_t odd_addr, uint16_t size)
+{
+    bd_t* p_even = &g_usb_bd_table[EP_BD_INDEX(ep, dir, EVEN)];
+    bd_t* p_odd  = &g_usb_bd_table[EP_BD_INDEX(ep, dir, ODD)];
+    
+    p_even->STAT = 0;
+    p_even->ADR  = even_addr;
+    p_odd->STAT  = 0;
+    p_odd->ADR   = odd_addr;
+    g_usb_ep_stat[ep][dir].Next_PPB = EVEN; // The SIE's ping-pong pointer starts EVEN after a reset.
+    g_usb_ep_stat[ep][dir].Halt = 0;
+    if(dir == OUT)
+    {
+        arm_iso(p_even, size);
+        arm_iso(p_odd, size);
+    }
+    
+    // Handshake off, no SETUP. Both directions of one Endpoint number are isochronous.
+    USB_UEP(ep) = (USB_UEP(ep) & ~_EPHSHK) | _EPCONDIS | (dir == OUT ? _EPOUTEN : _EPINEN);
+}
+
+void usb_iso_ep_stop(uint8_t ep, uint8_t dir)
+{
+    USB_UEP(ep) &= ~(dir == OUT ? _EPOUTEN : _EPINEN);
+    g_usb_bd_table[EP_BD_INDEX(ep, dir, EVEN)].STAT = 0;
+    g_usb_bd_table[EP_BD_INDEX(ep, dir, ODD)].STAT  = 0;
+}
+
+uint8_t* usb_iso_acquire_in(uint8_t ep)
+{
+    bd_t* p_bd = &g_usb_bd_table[EP_BD_INDEX(ep, IN, g_usb_ep_stat[ep][IN].Next_PPB)];
+    
+    if(p_bd->STAT & _UOWN) return NULL;
+    return USB_RAM_PTR(p_bd->ADR);
+}
+
+void usb_iso_commit_in(uint8_t ep, uint16_t cnt)
+{
+    arm_iso(&g_usb_bd_table[EP_BD_INDEX(ep, IN, g_usb_ep_stat[ep][IN].Next_PPB)], cnt);
+    g_usb_ep_stat[ep][IN].Next_PPB ^= 1;
+}
+
+uint8_t* usb_iso_peek_out(uint8_t ep, uint16_t* p_cnt)
+{
+    bd_t* p_bd = &g_usb_bd_table[EP_BD_INDEX(ep, OUT, g_usb_ep_stat[ep][OUT].Next_PPB)];
+    
+    if(p_bd->STAT & _UOWN) return NULL;
+    *p_cnt = ((uint16_t)(p_bd->STAT & (_BC9 | _BC8)) << 8) | p_bd->CNT;
+    return USB_RAM_PTR(p_bd->ADR);
+}
+
+void usb_iso_release_out(uint8_t ep, uint16_t size)
 {
-    p_bd->STAT  = p_ep_stat->Data_Toggle_Val ? _DTSEN | _DTS : _DTSEN;
-    p_bd->CNT   = cnt;
-    p_bd->STAT |= _UOWN;
+    arm_iso(&g_usb_bd_table[EP_BD_INDEX(ep, OUT, g_usb_ep_stat[ep][OUT].Next_PPB)], size);
+    g_usb_ep_stat[ep][OUT].Next_PPB ^= 1;
 }
+#endif
 
 #if PINGPONG_MODE == PINGPONG_ALL_EP
 void usb_arm_ep0_in(uint8_t bd_table_index, uint8_t cnt)
@@ -486,6 +1304,9 @@ void usb_arm_in_status(void)
 
 void usb_stall_ep(bd_t* p_bd)
 {
+    #ifdef USE_EP_STATS
+    m_bus_stats.Stalls++;
+    #endif
     p_bd->STAT  = _BSTALL;
     p_bd->STAT |= _UOWN;
 }
@@ -531,16 +1352,22 @@ void usb_in_control_transfer(void)
     {
         if(m_sending_from == ROM)
         {
-            usb_rom_copy((const uint8_t*)((uint16_t)m_rom_ptr), p_ep, bytes);
+            usb_rom_copy(USB_PTR16(const uint8_t*, m_rom_ptr), p_ep, bytes);
             m_rom_ptr += bytes;
         }
+        #ifdef MEM_EEPROM
+        else if(m_sending_from == DATA_EE) eeprom_read(p_ep, bytes);
+        #endif
         else
         {
-            usb_ram_copy((uint8_t*)((uint16_t)m_ram_ptr), p_ep, bytes);
+            usb_ram_copy(USB_PTR16(uint8_t*, m_ram_ptr), p_ep, bytes);
             m_ram_ptr += bytes;
         }
         usb_arm_ep0_in(bd_table_index, bytes);
         m_bytes_2_send -= bytes;
+        #ifdef USE_ENUM_STATS
+        m_stats.EP0_In_Packets++;
+        #endif
         return;
     }
 
@@ -548,6 +1375,9 @@ void usb_in_control_transfer(void)
     {
         usb_arm_ep0_in(bd_table_index, 0);
         m_send_short = false;
+        #ifdef USE_ENUM_STATS
+        m_stats.EP0_In_Packets++;
+        #endif
     }
     
     #else
@@ -555,16 +1385,22 @@ void usb_in_control_transfer(void)
     {
         if(m_sending_from == ROM)
         {
-            usb_rom_copy((const uint8_t*)((uint16_t)m_rom_ptr), m_ep0_in, bytes);
+            usb_rom_copy(USB_PTR16(const uint8_t*, m_rom_ptr), m_ep0_in, bytes);
             m_rom_ptr += bytes;
         }
+        #ifdef MEM_EEPROM
+        else if(m_sending_from == DATA_EE) eeprom_read(m_ep0_in, bytes);
+        #endif
         else
         {
-            usb_ram_copy((uint8_t*)((uint16_t)m_ram_ptr), m_ep0_in, bytes);
+            usb_ram_copy(USB_PTR16(uint8_t*, m_ram_ptr), m_ep0_in, bytes);
             m_ram_ptr += bytes;
         }
         usb_arm_ep0_in(bytes);
         m_bytes_2_send -= bytes;
+        #ifdef USE_ENUM_STATS
+        m_stats.EP0_In_Packets++;
+        #endif
         return;
     }
 
@@ -572,8 +1408,28 @@ void usb_in_control_transfer(void)
     {
         usb_arm_ep0_in(0);
         m_send_short = false;
+        #ifdef USE_ENUM_STATS
+        m_stats.EP0_In_Packets++;
+        #endif
+    }
+    #endif
+}
+
+void usb_start_in_control_transfer(void)
+{
+    #if PINGPONG_MODE == PINGPONG_ALL_EP
+    EP0_IN_LAST_PPB ^= 1;
+    usb_in_control_transfer();
+    if(m_bytes_2_send || m_send_short) // Load the other buffer too, each completion then refills the one just sent.
+    {
+        EP0_IN_DATA_TOGGLE_VAL ^= 1;
+        EP0_IN_LAST_PPB ^= 1;
+        usb_in_control_transfer();
     }
+    #else
+    usb_in_control_transfer();
     #endif
+    m_control_stage = DATA_IN_STAGE;
 }
 
 void usb_out_control_transfer(void)
@@ -583,9 +1439,17 @@ void usb_out_control_transfer(void)
     if(m_bytes_2_recv > EP0_SIZE) bytes = EP0_SIZE;
 
     #if PINGPONG_MODE == PINGPONG_0_OUT || PINGPONG_MODE == PINGPONG_ALL_EP
+    #ifdef MEM_EEPROM
+    if(MEM_EEPROM_WRITE) eeprom_write(PINGPONG_PARITY == EVEN ? m_ep0_out_even : m_ep0_out_odd, bytes);
+    else
+    #endif
     if(PINGPONG_PARITY == EVEN) usb_ram_copy(m_ep0_out_even, m_ram_ptr, bytes);
     else usb_ram_copy(m_ep0_out_odd, m_ram_ptr, bytes);
     #else
+    #ifdef MEM_EEPROM
+    if(MEM_EEPROM_WRITE) eeprom_write(m_ep0_out, bytes);
+    else
+    #endif
     usb_ram_copy(m_ep0_out, m_ram_ptr, bytes);
     #endif
 
@@ -594,7 +1458,26 @@ void usb_out_control_transfer(void)
 
     if(m_bytes_2_recv != 0) return;
 
+    #if defined(USE_OUT_CONTROL_FINISHED) && defined(USE_MEM_REQUEST)
+    if(g_usb_setup.bmRequestType == 0x40 && g_usb_setup.bRequest == MEM_REQUEST_CODE)
+    {
+        usb_arm_in_status(); // The stack's own request, usb_out_control_finished() doesn't see it.
+        m_control_stage = STATUS_IN_STAGE;
+        return;
+    }
+    #endif
+    
     #ifdef USE_OUT_CONTROL_FINISHED
+    #ifdef USE_IF_HANDLER_TABLE
+    const usb_if_handler_t* p_if = if_handler();
+    
+    if(p_if && p_if->out_control_finished && g_usb_setup.bmRequestType_bits.Type == CLASS)
+    {
+        if(p_if->out_control_finished()) usb_arm_in_status();
+        else usb_request_error();
+    }
+    else
+    #endif
     if(usb_out_control_finished()) usb_arm_in_status();
     else usb_request_error();
     #else
@@ -613,19 +1496,102 @@ void usb_set_num_in_control_bytes(uint16_t bytes)
     m_bytes_2_send = bytes;
 }
 
+// The copy loops below walk pointers and move 8 bytes per pass, the 0-7 
+// left over bytes are done first by falling through the switch. XC8 turns the 
+// pointer walks into FSR post-increments (MOVIW/MOVWI FSRn++ on PIC16, 
+// POSTINCn on PIC18) instead of re-loading an FSR from an index every byte.
+// A 64 byte copy is about 300 cycles on PIC18 (TBLRD*+ and MOVFF, 4 a byte) 
+// and 230 on PIC16 (MOVIW from program memory and MOVWI, 3 a byte).
 void usb_rom_copy(const uint8_t* p_rom, uint8_t* p_ep, uint8_t bytes)
 {
-    for(uint8_t i = 0; i < bytes; i++) p_ep[i] = p_rom[i];
+    uint8_t passes = bytes >> 3;
+    
+    #if defined(_PIC18)
+    // Program memory is read straight through TBLPTR with TBLRD*+. This runs 
+    // in the USB interrupt (the EP0 IN stages), XC8 doesn't save TBLPTR and 
+    // TABLAT for inline asm, so they're put back for the code interrupted in 
+    // the middle of a table read (const data, Flash_ReadBytes()).
+    uint8_t tblptru = TBLPTRU;
+    uint8_t tblptrh = TBLPTRH;
+    uint8_t tblptrl = TBLPTRL;
+    uint8_t tablat  = TABLAT;
+    #if _ROMSIZE > 0x10000
+    TBLPTR = (uint24_t)p_rom;
+    #else
+    TBLPTRU = 0;
+    TBLPTRH = (uint8_t)((uint16_t)p_rom >> 8);
+    TBLPTRL = (uint8_t)((uint16_t)p_rom);
+    #endif
+    #define ROM_COPY_BYTE() asm("TBLRDPOSTINC"); *p_ep++ = TABLAT
+    #else
+    #define ROM_COPY_BYTE() *p_ep++ = *p_rom++
+    #endif
+    
+    switch(bytes & 7)
+    {
+        case 7: ROM_COPY_BYTE();
+        case 6: ROM_COPY_BYTE();
+        case 5: ROM_COPY_BYTE();
+        case 4: ROM_COPY_BYTE();
+        case 3: ROM_COPY_BYTE();
+        case 2: ROM_COPY_BYTE();
+        case 1: ROM_COPY_BYTE();
+    }
+    while(passes--)
+    {
+        ROM_COPY_BYTE(); ROM_COPY_BYTE(); ROM_COPY_BYTE(); ROM_COPY_BYTE();
+        ROM_COPY_BYTE(); ROM_COPY_BYTE(); ROM_COPY_BYTE(); ROM_COPY_BYTE();
+    }
+    #undef ROM_COPY_BYTE
+    
+    #if defined(_PIC18)
+    TBLPTRU = tblptru;
+    TBLPTRH = tblptrh;
+    TBLPTRL = tblptrl;
+    TABLAT  = tablat;
+    #endif
 }
 
 void usb_ram_copy(uint8_t* p_ram1, uint8_t* p_ram2, uint8_t bytes)
 {
-    for(uint8_t i = 0; i < bytes; i++) p_ram2[i] = p_ram1[i];
+    uint8_t passes = bytes >> 3;
+    
+    switch(bytes & 7)
+    {
+        case 7: *p_ram2++ = *p_ram1++;
+        case 6: *p_ram2++ = *p_ram1++;
+        case 5: *p_ram2++ = *p_ram1++;
+        case 4: *p_ram2++ = *p_ram1++;
+        case 3: *p_ram2++ = *p_ram1++;
+        case 2: *p_ram2++ = *p_ram1++;
+        case 1: *p_ram2++ = *p_ram1++;
+    }
+    while(passes--)
+    {
+        *p_ram2++ = *p_ram1++; *p_ram2++ = *p_ram1++; *p_ram2++ = *p_ram1++; *p_ram2++ = *p_ram1++;
+        *p_ram2++ = *p_ram1++; *p_ram2++ = *p_ram1++; *p_ram2++ = *p_ram1++; *p_ram2++ = *p_ram1++;
+    }
 }
 
 void usb_ram_set(uint8_t val, uint8_t* p_ram, uint16_t bytes)
 {
-    for(uint16_t i = 0; i < bytes; i++) p_ram[i] = val;
+    uint16_t passes = bytes >> 3;
+    
+    switch((uint8_t)bytes & 7)
+    {
+        case 7: *p_ram++ = val;
+        case 6: *p_ram++ = val;
+        case 5: *p_ram++ = val;
+        case 4: *p_ram++ = val;
+        case 3: *p_ram++ = val;
+        case 2: *p_ram++ = val;
+        case 1: *p_ram++ = val;
+    }
+    while(passes--)
+    {
+        *p_ram++ = val; *p_ram++ = val; *p_ram++ = val; *p_ram++ = val;
+        *p_ram++ = val; *p_ram++ = val; *p_ram++ = val; *p_ram++ = val;
+    }
 }
 
 void usb_set_ram_ptr(uint8_t* data)
@@ -719,6 +1685,11 @@ static void usb_restart(void)
     m_update_address = false;
     m_send_short = false;
     
+    #ifdef USE_ENUM_STATS
+    m_stats.Reset_Frame = USB_FRAME_NUMBER;
+    m_stats.Resets++;
+    #endif
+    
     m_current_configuration = 0;
     
     while(TRANSACTION_COMPLETE_FLAG) TRANSACTION_COMPLETE_FLAG = 0; // Clear USTAT
@@ -758,11 +1729,11 @@ static void usb_restart(void)
 static void arm_setup(void)
 {
     #if PINGPONG_MODE == PINGPONG_0_OUT || PINGPONG_MODE == PINGPONG_ALL_EP
-    g_usb_bd_table[EP0_OUT_LAST_PPB].CNT   = 8;
+    g_usb_bd_table[EP0_OUT_LAST_PPB].CNT   = EP0_SIZE; // Also receives OUT data stage packets.
     g_usb_bd_table[EP0_OUT_LAST_PPB].STAT  = 0;
     g_usb_bd_table[EP0_OUT_LAST_PPB].STAT |= _UOWN;
     #else
-    g_usb_bd_table[BD0_OUT].CNT   = 8;
+    g_usb_bd_table[BD0_OUT].CNT   = EP0_SIZE; // Also receives OUT data stage packets.
     g_usb_bd_table[BD0_OUT].STAT  = 0;
     g_usb_bd_table[BD0_OUT].STAT |= _UOWN;
     #endif
@@ -790,59 +1761,87 @@ static void process_setup(void)
     EP0_OUT_DATA_TOGGLE_VAL = 1; // First transfer after setup is always DATA1 type.
     EP0_IN_DATA_TOGGLE_VAL  = 1; // First transfer after setup is always DATA1 type.
     
-    // Now process the g_usb_setup.
-    if(g_usb_setup.bmRequestType_bits.Type == STANDARD)
+    #ifdef USE_ENUM_STATS
+    m_stats.Last_Setup_Frame = USB_FRAME_NUMBER;
+    if(m_stats.Setups++ == 0) m_stats.First_Setup_Frame = m_stats.Last_Setup_Frame;
+    #endif
+    
+    m_request_types[g_usb_setup.bmRequestType_bits.Type]();
+}
+
+static void standard_request(void)
+{
+    const usb_request_t* p_req;
+    
+    if(g_usb_setup.bRequest > SYNC_FRAME)
     {
-        switch(g_usb_setup.bRequest)
-        {
-            // Most common requests are checked first for speed.
-            case GET_DESCRIPTOR:
-                get_descriptor();
-                break;
-            case CLEAR_FEATURE:
-                set_clear_feature();
-                break;
-            case SET_ADDRESS:
-                set_address();
-                break;                
-            case SET_CONFIGURATION:
-                set_configuration();
-                break;
-                
-                
-            case GET_STATUS:
-                get_status();
-                break;
-            case SET_FEATURE:
-                set_clear_feature();
-                break;
-            case SET_DESCRIPTOR:
-                set_descriptor();
-                break;
-            case GET_CONFIGURATION:
-                get_configuration();
-                break;
-            case GET_INTERFACE:
-                get_interface();
-                break;
-            case SET_INTERFACE:
-                set_interface();
-                break;
-            case SYNC_FRAME:
-                sync_frame();
-                break;
-            default:
-                usb_request_error();
-                break;
-        }
+        usb_request_error();
+        return;
     }
-    else
+    p_req = &m_standard_requests[g_usb_setup.bRequest];
+    if(g_usb_setup.bmRequestType_bits.Recipient > ENDPOINT || !(p_req->recipients & (1 << g_usb_setup.bmRequestType_bits.Recipient)))
     {
-        if(usb_service_class_request() == false)
-        {
-            usb_request_error(); // Class Request wasn't recognized.
-        }
+        usb_request_error();
+        return;
+    }
+    p_req->handler();
+}
+
+static void class_request(void)
+{
+    #ifdef USE_IF_HANDLER_TABLE
+    const usb_if_handler_t* p_if = if_handler();
+    
+    if(p_if && p_if->class_request)
+    {
+        if(p_if->class_request() == false) usb_request_error(); // Class Request wasn't recognized.
+        return;
+    }
+    #endif
+    if(usb_service_class_request() == false) usb_request_error(); // Class Request wasn't recognized.
+}
+
+static void vendor_request(void)
+{
+    #ifdef USE_IF_HANDLER_TABLE
+    const usb_if_handler_t* p_if;
+    #endif
+    
+    #ifdef USE_STATS_REQUEST
+    if(g_usb_setup.bmRequestType == 0xC0 && g_usb_setup.bRequest == STATS_REQUEST_CODE)
+    {
+        stats_request();
+        return;
+    }
+    #endif
+    #ifdef USE_MEM_REQUEST
+    if((g_usb_setup.bmRequestType == 0xC0 || g_usb_setup.bmRequestType == 0x40) && g_usb_setup.bRequest == MEM_REQUEST_CODE)
+    {
+        mem_request();
+        return;
+    }
+    #endif
+    #ifdef USE_MS_OS_20
+    if(g_usb_setup.bmRequestType == 0xC0 && g_usb_setup.bRequest == MS_OS_20_VENDOR_CODE)
+    {
+        ms_os_20_request();
+        return;
+    }
+    #endif
+    #ifdef USE_IF_HANDLER_TABLE
+    p_if = if_handler();
+    if(p_if && p_if->vendor_request)
+    {
+        if(p_if->vendor_request() == false) usb_request_error(); // Vendor Request wasn't recognized.
+        return;
     }
+    #endif
+    if(usb_service_class_request() == false) usb_request_error(); // Vendor Request wasn't recognized.
+}
+
+static void reserved_request(void)
+{
+    usb_request_error();
 }
 
 static void get_status(void)
@@ -987,19 +1986,8 @@ static void set_clear_feature_epn(void)
 {
     uint8_t bd_table_index;
 
-    #if PINGPONG_MODE == PINGPONG_DIS
-    bd_table_index = (m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.EndpointNumber * 2u) + 
-                        m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.Direction;
-    #elif PINGPONG_MODE == PINGPONG_0_OUT
-    bd_table_index = (m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.EndpointNumber * 2u) + 1u + 
-                        m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.Direction;
-    #elif PINGPONG_MODE == PINGPONG_1_15
-    bd_table_index = (m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.EndpointNumber * 2u) + 1u + 
-                        m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.Direction;
-    #else
-    bd_table_index = (m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.EndpointNumber * 2u) + 2u + 
-                        (m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.Direction * 2u);
-    #endif
+    bd_table_index = EP_BD_INDEX(m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.EndpointNumber, 
+                                 m_set_clear_feature.ZeroInterfaceEndpoint_bits.Endpoint_bits.Direction, EVEN);
     if(g_usb_setup.bRequest == CLEAR_FEATURE)
     {
         usb_app_clear_halt(bd_table_index, 
@@ -1021,6 +2009,9 @@ static void set_address(void)
 {
     m_saved_address  = (uint8_t)m_set_address.DeviceAddress;
     m_update_address = true;
+    #ifdef USE_ENUM_STATS
+    m_stats.Set_Address_Frame = USB_FRAME_NUMBER;
+    #endif
     usb_arm_in_status();
     m_control_stage  = STATUS_IN_STAGE;
 }
@@ -1028,8 +2019,17 @@ static void set_address(void)
 static void get_descriptor(void)
 {
     bool perform_request_error = true;
+    #ifndef USE_FAST_ENUMERATION
     const uint16_t *ptr;
+    #endif
     uint16_t bytes_available = 0;
+    #ifdef USE_IF_HANDLER_TABLE
+    const usb_if_handler_t* p_if;
+    #endif
+    
+    #ifdef USE_ENUM_STATS
+    m_stats.Get_Descriptors++;
+    #endif
     
     switch(g_usb_get_descriptor.DescriptorType)
     {
@@ -1039,14 +2039,28 @@ static void get_descriptor(void)
             perform_request_error = false;
             break;
         case DEVICE_QUALIFIER_DESC:
+            break; // Full speed only, the request must be stalled.
+        #ifdef USE_BOS
+        case BOS_DESC:
+            m_rom_ptr             = g_bos_descriptor;
+            bytes_available       = g_bos_descriptor_size;
+            perform_request_error = false;
             break;
+        #endif
         case CONFIGURATION_DESC:
             if(g_usb_get_descriptor.DescriptorIndex >= NUM_CONFIGURATIONS) break;
 
             m_rom_ptr             = (const uint8_t*) g_config_descriptors[g_usb_get_descriptor.DescriptorIndex];
+            #ifdef USE_FAST_ENUMERATION
+            bytes_available       = g_config_descriptor_lengths[g_usb_get_descriptor.DescriptorIndex]; // sizeof() from usb_descriptors.c.
+            #else
             ptr                   = (const uint16_t*)g_config_descriptors[g_usb_get_descriptor.DescriptorIndex];
             bytes_available       = ptr[1];
+            #endif
             perform_request_error = false;
+            #ifdef USE_ENUM_STATS
+            m_stats.Config_Desc_Frame = USB_FRAME_NUMBER;
+            #endif
             break;
         case STRING_DESC:
             if(g_usb_get_descriptor.DescriptorIndex >= g_size_of_sd) break;
@@ -1056,6 +2070,14 @@ static void get_descriptor(void)
             perform_request_error = false;
             break;
         default:
+            #ifdef USE_IF_HANDLER_TABLE
+            p_if = if_handler();
+            if(p_if && p_if->get_class_descriptor)
+            {
+                if(p_if->get_class_descriptor(&m_rom_ptr, &bytes_available)) perform_request_error = false;
+            }
+            else
+            #endif
             if(usb_get_class_descriptor(&m_rom_ptr, &bytes_available)) perform_request_error = false;
             break;
     }
@@ -1063,20 +2085,7 @@ static void get_descriptor(void)
     else
     {
         usb_setup_in_control_transfer(ROM, bytes_available, g_usb_get_descriptor.DescriptorLength);
-        
-        #if PINGPONG_MODE == PINGPONG_ALL_EP
-        EP0_IN_LAST_PPB ^= 1;
-        usb_in_control_transfer();
-        if(m_bytes_2_send != 0)
-        {
-            EP0_IN_DATA_TOGGLE_VAL ^= 1;
-            EP0_IN_LAST_PPB ^= 1;
-            usb_in_control_transfer();
-        }
-        #else
-        usb_in_control_transfer();
-        #endif
-        m_control_stage = DATA_IN_STAGE;
+        usb_start_in_control_transfer();
     }
 }
 
@@ -1112,6 +2121,8 @@ static void set_configuration(void)
 {
     if((m_usb_state == STATE_ADDRESS || m_usb_state == STATE_CONFIGURED) && (g_usb_set_configuration.ConfigurationValue < NUM_CONFIGURATIONS + 1))
     {
+        disable_app_endpoints();
+        
         // Reset Ping-Pong Buffer Pointers to Even
         #if (PINGPONG_MODE != PINGPONG_DIS)
         PPB_RESET = 1;
@@ -1137,6 +2148,10 @@ static void set_configuration(void)
         {
             usb_app_init();
             m_usb_state = STATE_CONFIGURED;
+            POST_EVENT(EVENT_CONFIGURED);
+            #ifdef USE_ENUM_STATS
+            m_stats.Set_Configuration_Frame = USB_FRAME_NUMBER;
+            #endif
         }
         else m_usb_state = STATE_ADDRESS;
     }
@@ -1183,7 +2198,7 @@ static void get_interface(void)
         }
         #else
         m_ep0_in[0] = get_interface_return;
-        usb_arm_ep0_in(BD0_IN, 1);
+        usb_arm_ep0_in(1);
         #endif
     #endif
         m_control_stage = DATA_IN_STAGE;
@@ -1209,4 +2224,260 @@ static void sync_frame(void)
     usb_request_error();
 }
 
+#ifdef USE_STATS_REQUEST
+static void stats_request(void)
+{
+    uint8_t index = (uint8_t)g_usb_setup.wIndex;
+    uint8_t bytes;
+    
+    #ifdef USE_ENUM_STATS
+    if(index == STATS_INDEX_ENUM)
+    {
+        m_stats_snapshot.Enum = m_stats;
+        bytes = sizeof(usb_stats_t);
+        if(g_usb_setup.wValue & 1) usb_ram_set(0, (uint8_t*)&m_stats, sizeof(m_stats));
+    }
+    else
+    #endif
+    #ifdef USE_EP_STATS
+    if(index == STATS_INDEX_BUS)
+    {
+        m_stats_snapshot.Bus = m_bus_stats;
+        bytes = sizeof(usb_bus_stats_t);
+        if(g_usb_setup.wValue & 1) usb_ram_set(0, (uint8_t*)&m_bus_stats, sizeof(m_bus_stats));
+    }
+    else if(!(index & 0x70) && (index & 0x0F) < NUM_ENDPOINTS)
+    {
+        m_stats_snapshot.EP = g_usb_ep_counters[index & 0x0F][index >> 7];
+        bytes = sizeof(usb_ep_counters_t);
+        if(g_usb_setup.wValue & 1) usb_ram_set(0, (uint8_t*)&g_usb_ep_counters[index & 0x0F][index >> 7], sizeof(usb_ep_counters_t));
+    }
+    else
+    #endif
+    {
+        usb_request_error();
+        return;
+    }
+    
+    m_ram_ptr = (uint8_t*)&m_stats_snapshot;
+    usb_setup_in_control_transfer(RAM, bytes, g_usb_setup.wLength);
+    usb_start_in_control_transfer();
+}
+#endif
+
+#ifdef USE_MEM_REQUEST
+// Program memory is read only, writing it takes whole erase blocks. See 
+// usb.h for why it stops at 64K.
+static void mem_request(void)
+{
+    switch(g_usb_setup.wIndex)
+    {
+        case MEM_SPACE_RAM:
+            m_ram_ptr = USB_RAM_PTR(g_usb_setup.wValue);
+            if(g_usb_setup.bmRequestType == 0xC0)
+            {
+                usb_setup_in_control_transfer(RAM, g_usb_setup.wLength, g_usb_setup.wLength);
+                usb_start_in_control_transfer();
+            }
+            else if(g_usb_setup.wLength)
+            {
+                usb_set_num_out_control_bytes(g_usb_setup.wLength); // usb_out_control_transfer() writes it packet by packet.
+                m_control_stage = DATA_OUT_STAGE;
+            }
+            else usb_arm_in_status();
+            return;
+            
+        #ifndef USB_SIM
+        case MEM_SPACE_ROM:
+            if(g_usb_setup.bmRequestType != 0xC0) break;
+            #if defined(_PIC14E)
+            m_rom_ptr = (const uint8_t*)(0x8000 | g_usb_setup.wValue); // Through the FSRs, the low byte of each word.
+            #else
+            m_rom_ptr = (const uint8_t*)g_usb_setup.wValue;
+            #endif
+            usb_setup_in_control_transfer(ROM, g_usb_setup.wLength, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return;
+        #endif
+            
+        #ifdef MEM_EEPROM
+        case MEM_SPACE_EEPROM:
+            if(g_usb_setup.wValue >= _EEPROMSIZE || g_usb_setup.wLength > _EEPROMSIZE - g_usb_setup.wValue) break;
+            m_eeprom_addr = g_usb_setup.wValue;
+            if(g_usb_setup.bmRequestType == 0xC0)
+            {
+                usb_setup_in_control_transfer(DATA_EE, g_usb_setup.wLength, g_usb_setup.wLength);
+                usb_start_in_control_transfer();
+            }
+            else if(g_usb_setup.wLength)
+            {
+                usb_set_num_out_control_bytes(g_usb_setup.wLength); // usb_out_control_transfer() writes it with eeprom_write().
+                m_control_stage = DATA_OUT_STAGE;
+            }
+            else usb_arm_in_status();
+            return;
+        #endif
+            
+        default: // An unknown space.
+            break;
+    }
+    usb_request_error();
+}
+#endif
+
+#ifdef MEM_EEPROM
+static void eeprom_read(uint8_t* dst, uint8_t bytes)
+{
+    EECON1 = 0x00; // EEPGD = 0, CFGS = 0
+    while(bytes--)
+    {
+        #if _EEPROMSIZE > 256
+        EEADRH = (uint8_t)(m_eeprom_addr >> 8);
+        #endif
+        EEADR = (uint8_t)m_eeprom_addr++;
+        EECON1bits.RD = 1;
+        *dst++ = EEDATA;
+    }
+}
+
+static void eeprom_write(const uint8_t* src, uint8_t bytes)
+{
+    uint8_t gie;
+    
+    for(; bytes; bytes--, src++, m_eeprom_addr++)
+    {
+        #if _EEPROMSIZE > 256
+        EEADRH = (uint8_t)(m_eeprom_addr >> 8);
+        #endif
+        EEADR = (uint8_t)m_eeprom_addr;
+        EECON1 = 0x00; // EEPGD = 0, CFGS = 0
+        EECON1bits.RD = 1;
+        if(EEDATA == *src) continue; // Saves a write cycle, and wear.
+        
+        EEDATA = *src;
+        EECON1bits.WREN = 1;
+        gie = INTCONbits.GIE; // Only with USE_POLLING, in the interrupt it's off already.
+        INTCONbits.GIE = 0;
+        EECON2 = 0x55;
+        EECON2 = 0xAA;
+        EECON1bits.WR = 1;
+        INTCONbits.GIE = gie;
+        while(EECON1bits.WR); // About 4ms a byte.
+        EECON1bits.WREN = 0;
+    }
+}
+#endif
+
+#ifdef USE_MS_OS_20
+static void ms_os_20_request(void)
+{
+    if(g_usb_setup.wIndex != MS_OS_20_DESCRIPTOR_INDEX)
+    {
+        usb_request_error();
+        return;
+    }
+    
+    m_rom_ptr = g_ms_os_20_descriptor_set;
+    usb_setup_in_control_transfer(ROM, g_ms_os_20_descriptor_set_size, g_usb_setup.wLength);
+    usb_start_in_control_transfer();
+}
+#endif
+
+#ifdef USE_CLOCK_SCALING
+static void clock_low(void)
+{
+    if(m_clock_low) return;
+    m_clock_low = true;
+    m_clock_osccon = OSCCON;
+    
+    // Off the PLL first (SCS = internal), then the PLL off. ACT can't track 
+    // without SOFs, OSCTUNE keeps the tuned value while ACTEN is clear.
+    #if defined(_PIC14E)
+    m_clock_actcon = ACTCON;
+    ACTCONbits.ACTEN = 0;
+    OSCCON = (uint8_t)((m_clock_osccon & 0x40) | (CLOCK_LOW_IRCF << 2) | 0x03); // SPLLEN in here.
+    
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    m_clock_actcon = ACTCON;
+    ACTCONbits.ACTEN = 0;
+    m_clock_pll = OSCCON2bits.PLLEN;
+    OSCCON = (uint8_t)((OSCCON & 0x80) | (CLOCK_LOW_IRCF << 4) | 0x03);
+    OSCCON2bits.PLLEN = 0;
+    
+    #elif defined(_18F13K50) || defined(_18F14K50)
+    m_clock_pll = OSCTUNEbits.SPLLEN;
+    OSCCON = (uint8_t)((OSCCON & 0x80) | (CLOCK_LOW_IRCF << 4) | 0x03);
+    OSCTUNEbits.SPLLEN = 0;
+    
+    #elif defined(__J_PART)
+    m_clock_pll = OSCTUNEbits.PLLEN;
+    OSCCON = (uint8_t)((OSCCON & 0x80) | (CLOCK_LOW_IRCF << 4) | 0x03);
+    OSCTUNEbits.PLLEN = 0;
+    
+    #else // PIC18FX450, PIC18FX550, and PIC18FX455, the PLL stops with the primary oscillator.
+    OSCCON = (uint8_t)((OSCCON & 0x80) | (CLOCK_LOW_IRCF << 4) | 0x03);
+    #endif
+}
+
+static void clock_full(void)
+{
+    if(!m_clock_low) return;
+    USB_TRACE(TRACE_CLOCK);
+    
+    #if defined(_PIC14E)
+    OSCCON = m_clock_osccon;
+    while(!OSCSTATbits.PLLRDY){}
+    ACTCON = m_clock_actcon;
+    
+    #elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50)
+    OSCCON = (uint8_t)((OSCCON & 0x80) | (m_clock_osccon & 0x73));
+    OSCCON2bits.PLLEN = m_clock_pll;
+    if(m_clock_pll) while(!OSCCON2bits.PLLRDY){}
+    ACTCON = m_clock_actcon;
+    
+    #else
+    #if defined(_18F13K50) || defined(_18F14K50)
+    OSCTUNEbits.SPLLEN = m_clock_pll;
+    #elif defined(__J_PART)
+    OSCTUNEbits.PLLEN = m_clock_pll;
+    #endif
+    OSCCON = (uint8_t)((OSCCON & 0x80) | (m_clock_osccon & 0x73));
+    if((m_clock_osccon & 0x03) == 0) while(!OSCCONbits.OSTS){} // Primary oscillator start-up timer.
+    __delay_ms(CLOCK_PLL_LOCK_MS); // No PLL ready bit, the lock time is a datasheet maximum. Never in the ISR, see usb.h.
+    #endif
+    
+    m_clock_low = false;
+    USB_TRACE(TRACE_CLOCK | TRACE_EXIT);
+}
+#endif
+
+static void disable_app_endpoints(void)
+{
+    for(uint8_t ep = 1; ep < NUM_ENDPOINTS; ep++)
+    {
+        USB_UEP(ep) = 0;
+        g_usb_ep_stat[ep][OUT].Data_Toggle_Val = 0;
+        g_usb_ep_stat[ep][OUT].Halt = 0;
+        g_usb_ep_stat[ep][IN].Data_Toggle_Val = 0;
+        g_usb_ep_stat[ep][IN].Halt = 0;
+    }
+    for(uint8_t i = EP_BD_INDEX(1, OUT, EVEN); i < NUM_BD; i++) g_usb_bd_table[i].STAT = 0;
+}
+
+#ifdef USE_IF_HANDLER_TABLE
+static const usb_if_handler_t* if_handler(void)
+{
+    uint8_t interface = (uint8_t)g_usb_setup.wIndex;
+    
+    // One index into the table, however many classes there are.
+    if(g_usb_setup.bmRequestType_bits.Recipient != INTERFACE || interface >= NUM_INTERFACES) return NULL;
+    #if NUM_CONFIGURATIONS > 1
+    if(m_current_configuration == 0) return NULL;
+    return &g_usb_if_handlers[m_current_configuration - 1][interface];
+    #else
+    return &g_usb_if_handlers[interface];
+    #endif
+}
+#endif
+
 /* ************************************************************************** */
\ No newline at end of file
@@ -50,6 +50,24 @@
 /* ************************************************************************** */
 
 
+/* ************************************************************************** */
+/* ***************************** USB EVENTS ********************************* */
+/* ************************************************************************** */
+
+// Event numbers for usb_event_tasks(), index g_usb_event_handlers[]. Lower 
+// numbers are dispatched first.
+#define EVENT_CONFIGURED 0
+#define EVENT_EP(ep)     (ep)       // Transaction complete on EP1 to EP7, either direction.
+#define EVENT_RESET      8
+#define EVENT_SUSPEND    9
+#define EVENT_RESUME     10
+#define EVENT_SOF        11         // Needs USE_SOF.
+#define EVENT_APP(n)     (12 + (n)) // 0 to 3, posted by the application with usb_post_event().
+#define NUM_EVENTS       16
+
+/* ************************************************************************** */
+
+
 /* ************************************************************************** */
 /* ********************* CONTROL TRANSFER STAGES **************************** */
 /* ************************************************************************** */
@@ -98,6 +116,10 @@
 /* ************************* EP0 BUFFER BASE ADDRESSES ********************** */
 /* ************************************************************************** */
 
+#if (EP0_SIZE != 8) && (EP0_SIZE != 16) && (EP0_SIZE != 32) && (EP0_SIZE != 64)
+#error "EP0_SIZE must be 8, 16, 32, or 64."
+#endif
+
 #ifdef _PIC14E
 #warning "Control EP Buffer addresses have been manually set for PIC16 devices."
 #if (PINGPONG_MODE == PINGPONG_DIS) || (PINGPONG_MODE == PINGPONG_1_15)
@@ -155,29 +177,26 @@
 #define EP0_IN_ODD_BUFFER_BASE_ADDR   0x2190
 #endif
 #endif
-#else // PIC18 devices
-#if (PINGPONG_MODE == PINGPONG_DIS)
-#define EP0_BUFFER_BASE_ADDR     EP_BUFFERS_STARTING_ADDR
-#define EP0_OUT_BUFFER_BASE_ADDR EP0_BUFFER_BASE_ADDR
-#define EP0_IN_BUFFER_BASE_ADDR (EP0_BUFFER_BASE_ADDR + EP0_SIZE)
+#if (PINGPONG_MODE == PINGPONG_DIS) || (PINGPONG_MODE == PINGPONG_1_15)
+#define EP0_BUFFERS_LOW_ADDR EP0_OUT_BUFFER_BASE_ADDR // Class EP buffers must end below this.
+#else
+#define EP0_BUFFERS_LOW_ADDR EP0_OUT_EVEN_BUFFER_BASE_ADDR // Class EP buffers must end below this.
+#endif
+#else // PIC18 devices, placed by the allocator in usb_hal.h.
+#if (PINGPONG_MODE == PINGPONG_DIS) || (PINGPONG_MODE == PINGPONG_1_15)
+#define EP0_OUT_BUFFER_BASE_ADDR EP0_OUT_EVEN_BUFFER_ADDR
+#define EP0_IN_BUFFER_BASE_ADDR  EP0_IN_EVEN_BUFFER_ADDR
 
 #elif (PINGPONG_MODE == PINGPONG_0_OUT)
-#define EP0_BUFFER_BASE_ADDR          EP_BUFFERS_STARTING_ADDR
-#define EP0_OUT_EVEN_BUFFER_BASE_ADDR EP0_BUFFER_BASE_ADDR
-#define EP0_OUT_ODD_BUFFER_BASE_ADDR (EP0_BUFFER_BASE_ADDR + EP0_SIZE)
-#define EP0_IN_BUFFER_BASE_ADDR      (EP0_BUFFER_BASE_ADDR + (EP0_SIZE * 2))
-
-#elif (PINGPONG_MODE == PINGPONG_1_15)
-#define EP0_BUFFER_BASE_ADDR     EP_BUFFERS_STARTING_ADDR
-#define EP0_OUT_BUFFER_BASE_ADDR EP0_BUFFER_BASE_ADDR
-#define EP0_IN_BUFFER_BASE_ADDR (EP0_BUFFER_BASE_ADDR + EP0_SIZE)
+#define EP0_OUT_EVEN_BUFFER_BASE_ADDR EP0_OUT_EVEN_BUFFER_ADDR
+#define EP0_OUT_ODD_BUFFER_BASE_ADDR  EP0_OUT_ODD_BUFFER_ADDR
+#define EP0_IN_BUFFER_BASE_ADDR       EP0_IN_EVEN_BUFFER_ADDR
 
 #else
-#define EP0_BUFFER_BASE_ADDR EP_BUFFERS_STARTING_ADDR
-#define EP0_OUT_EVEN_BUFFER_BASE_ADDR EP0_BUFFER_BASE_ADDR
-#define EP0_OUT_ODD_BUFFER_BASE_ADDR (EP0_BUFFER_BASE_ADDR + EP0_SIZE)
-#define EP0_IN_EVEN_BUFFER_BASE_ADDR (EP0_BUFFER_BASE_ADDR + (EP0_SIZE * 2))
-#define EP0_IN_ODD_BUFFER_BASE_ADDR  (EP0_BUFFER_BASE_ADDR + (EP0_SIZE * 3))
+#define EP0_OUT_EVEN_BUFFER_BASE_ADDR EP0_OUT_EVEN_BUFFER_ADDR
+#define EP0_OUT_ODD_BUFFER_BASE_ADDR  EP0_OUT_ODD_BUFFER_ADDR
+#define EP0_IN_EVEN_BUFFER_BASE_ADDR  EP0_IN_EVEN_BUFFER_ADDR
+#define EP0_IN_ODD_BUFFER_BASE_ADDR   EP0_IN_ODD_BUFFER_ADDR
 #endif
 #endif
 
@@ -193,6 +212,17 @@
 #define EP0_OUT_DATA_TOGGLE_VAL g_usb_ep_stat[EP0][OUT].Data_Toggle_Val
 #define EP0_IN_DATA_TOGGLE_VAL  g_usb_ep_stat[EP0][IN].Data_Toggle_Val
 
+// The class libraries move an Endpoint's toggle on with USB_NEXT_TOGGLE() as 
+// each packet completes. With USE_BD_TOGGLE usb_arm_endpoint() flips the DTS 
+// the BD was last armed with instead, and Data_Toggle_Val only says whether 
+// that's valid: setting it to 0 (reset, Clear Halt, Set Interface) still 
+// makes the next packet DATA0.
+#ifdef USE_BD_TOGGLE
+#define USB_NEXT_TOGGLE(toggle)
+#else
+#define USB_NEXT_TOGGLE(toggle) (toggle) ^= 1
+#endif
+
 /* ************************************************************************** */
 
 
@@ -259,7 +289,8 @@ typedef struct
     unsigned Data_Toggle_Val :1;
     unsigned Halt            :1;
     unsigned Last_PPB        :1;
-    unsigned                 :5;
+    unsigned Next_PPB        :1; // Isochronous Endpoints, the buffer usb_iso_ functions use next.
+    unsigned                 :4;
 }usb_ep_stat_t;
 
 /** USTAT Type */
@@ -272,6 +303,172 @@ typedef struct
     unsigned      :1;
 }usb_ustat_t;
 
+#ifdef USE_ENUM_STATS
+/** Enumeration Stats Type, frames are SOF frame numbers (1ms each, 11 bits) */
+typedef struct
+{
+    uint16_t Reset_Frame;             // Last bus reset.
+    uint16_t First_Setup_Frame;       // First SETUP since usb_init() or usb_clear_stats().
+    uint16_t Last_Setup_Frame;
+    uint16_t Config_Desc_Frame;       // Last GET_DESCRIPTOR for a configuration descriptor.
+    uint16_t Set_Address_Frame;
+    uint16_t Set_Configuration_Frame; // Last non-zero SET_CONFIGURATION.
+    uint16_t EP0_In_Packets;          // Control IN data packets armed.
+    uint8_t  Resets;
+    uint8_t  Setups;
+    uint8_t  Get_Descriptors;
+}usb_stats_t;
+
+/** Frames from one usb_stats_t frame number to a later one, allowing for the 11 bit wrap. */
+#define USB_FRAMES_BETWEEN(from, to) ((uint16_t)((to) - (from)) & 0x7FF)
+#endif
+
+#ifdef USE_EP_STATS
+/** EP Counters Type */
+typedef struct
+{
+    uint32_t Bytes;
+    uint16_t Transactions;
+}usb_ep_counters_t;
+
+/** Bus Stats Type, the error counts need USE_ERROR and the frame counts need USE_SOF */
+typedef struct
+{
+    uint16_t Stalls;             // BDs armed with BSTALL.
+    uint16_t PID_Errors;
+    uint16_t CRC5_Errors;
+    uint16_t CRC16_Errors;
+    uint16_t DFN8_Errors;        // Data field not a multiple of 8 bits.
+    uint16_t Timeout_Errors;     // Bus turnaround timeout.
+    uint16_t Bit_Stuff_Errors;
+    uint16_t Frames;
+    uint8_t  Frame_Peak;         // Most transactions completed in one frame.
+    uint8_t  Frame_Transactions; // Transactions completed so far in this frame.
+}usb_bus_stats_t;
+#endif
+
+#if defined(USE_STATS_REQUEST) && !defined(USE_EP_STATS) && !defined(USE_ENUM_STATS)
+#error "USE_STATS_REQUEST needs USE_EP_STATS and/or USE_ENUM_STATS."
+#endif
+
+#if defined(USE_MS_OS_20) && !defined(USE_BOS)
+#error "USE_MS_OS_20 needs USE_BOS, Windows only asks for the Descriptor Set after reading the BOS."
+#endif
+
+#if defined(USE_ISOCHRONOUS) && (PINGPONG_MODE != PINGPONG_1_15) && (PINGPONG_MODE != PINGPONG_ALL_EP)
+#error "USE_ISOCHRONOUS needs PINGPONG_1_15 or PINGPONG_ALL_EP, one buffer is filled while the other is on the bus."
+#endif
+
+#if defined(USE_MS_OS_20) && defined(USE_STATS_REQUEST) && (MS_OS_20_VENDOR_CODE == STATS_REQUEST_CODE)
+#error "MS_OS_20_VENDOR_CODE and STATS_REQUEST_CODE must be different."
+#endif
+
+#if defined(USE_MEM_REQUEST) && ((defined(USE_STATS_REQUEST) && (MEM_REQUEST_CODE == STATS_REQUEST_CODE)) || \
+                                 (defined(USE_MS_OS_20) && (MEM_REQUEST_CODE == MS_OS_20_VENDOR_CODE)))
+#error "MEM_REQUEST_CODE must be different from STATS_REQUEST_CODE and MS_OS_20_VENDOR_CODE."
+#endif
+
+#if defined(USE_BD_TOGGLE) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP)
+#error "USE_BD_TOGGLE needs PINGPONG_DIS or PINGPONG_0_OUT, with two buffers armed on an Endpoint the next toggle isn't the BD's own."
+#endif
+
+#if defined(USE_DEFERRED_TASKS) && defined(USE_POLLING)
+#error "USE_DEFERRED_TASKS needs the USB interrupt, in polling mode the handlers already run from the main loop."
+#endif
+
+#if defined(USE_DEFERRED_TASKS) && ((DEFERRED_QUEUE_SIZE & (DEFERRED_QUEUE_SIZE - 1)) || (DEFERRED_QUEUE_SIZE > 128))
+#error "DEFERRED_QUEUE_SIZE must be a power of 2, up to 128."
+#endif
+
+#if defined(USE_ARENA) && !defined(USB_ARENA_STATES)
+#error "USE_ARENA needs USB_ARENA_STATES(X) in usb_config.h."
+#endif
+
+#if defined(USE_TIMESTAMP) && !defined(USE_SOF)
+#error "USE_TIMESTAMP needs USE_SOF, the frame count and the timer are taken at each SOF."
+#endif
+
+#ifdef USE_CLOCK_SCALING
+// With USE_CLOCK_SCALING the CPU drops to the internal oscillator at 
+// CLOCK_LOW_IRCF with the PLL off while suspended, and goes back to the boot 
+// clock on resume, remote wakeup or usb_close(). Code in the main loop runs 
+// slower meanwhile and __delay_x() is calibrated for _XTAL_FREQ. The resume 
+// waits for the PLL, from the datasheets:
+//   PIC16F145X, PIC18F2X/4XK50: until PLLRDY, 2 ms max.
+//   PIC18F13K50/14K50, J parts: CLOCK_PLL_LOCK_MS, no ready bit.
+//   PIC18FX455/X550:            OST (1024 Tosc) then CLOCK_PLL_LOCK_MS.
+// All well inside the 20 ms a host gives a resume. TRACE_CLOCK measures it on 
+// the target with TRACE_TIMER on a fixed clock. Parts without a ready bit wait 
+// with __delay_ms(), so the resume has to come from usb_tasks() in the main loop.
+#if !defined(USE_POLLING) && !defined(_PIC14E) && !defined(_18F24K50) && !defined(_18F25K50) && !defined(_18F45K50)
+#error "USE_CLOCK_SCALING needs USE_POLLING on parts without a PLL ready bit, the PLL lock delay can't run in the USB interrupt."
+#endif
+#ifndef CLOCK_LOW_IRCF
+#if defined(_PIC14E)
+#define CLOCK_LOW_IRCF 0b0111 // 500kHz MF.
+#elif defined(_18F24K50) || defined(_18F25K50) || defined(_18F45K50) || defined(_18F13K50) || defined(_18F14K50)
+#define CLOCK_LOW_IRCF 0b010  // 500kHz.
+#else
+#define CLOCK_LOW_IRCF 0b011  // 500kHz.
+#endif
+#endif
+#ifndef CLOCK_PLL_LOCK_MS
+#define CLOCK_PLL_LOCK_MS 2   // Parts without a PLL ready bit.
+#endif
+#endif
+
+#ifdef USE_TIMESTAMP
+/** Timestamp Type */
+typedef struct
+{
+    uint32_t Frame;  // Frames since usb_init(), the low 11 bits are the bus frame number.
+    uint16_t Micros; // Microseconds since that frame's SOF, 0 to 999.
+}usb_timestamp_t;
+
+#define TIMESTAMP_HEADER_SIZE 6 // usb_timestamp_header(), Frame then Micros, little endian.
+#endif
+
+#ifdef USE_TRACE
+/** Trace Entry Type */
+typedef struct
+{
+    uint8_t  Event;      // TRACE_x id, or'd with TRACE_EXIT on the way out.
+    uint8_t  Last_USTAT; // g_usb_last_USTAT when the entry was taken.
+    uint16_t Time;       // TRACE_TIMER.
+}usb_trace_entry_t;
+
+#if (TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) || (TRACE_RING_SIZE > 128)
+#error "TRACE_RING_SIZE must be a power of 2, up to 128."
+#endif
+#endif
+
+#ifdef USE_ARENA
+/** Scratch Arena Type, one member per USB_ARENA_STATES entry, all at offset 0 */
+#define USB_ARENA_MEMBER(name, bytes) uint8_t name[bytes];
+typedef union
+{
+    USB_ARENA_STATES(USB_ARENA_MEMBER)
+}usb_arena_t;
+#endif
+
+/** Trace Event IDs */
+#define TRACE_EXIT       0x01 // Or'd with an event id on exit.
+#define TRACE_USB_TASKS  0x10 // usb_tasks().
+#define TRACE_SETUP      0x20 // process_setup().
+#define TRACE_EP_HANDLER 0x30 // usb_app_tasks() or the g_usb_ep_handlers[] entry, USTAT gives the EP and direction.
+#define TRACE_CLOCK      0x40 // clock_full(), the PLL coming back on resume with USE_CLOCK_SCALING.
+#define TRACE_MSD_TASKS  0x50 // msd_tasks() servicing a queued MSD transaction, USTAT is the last one usb_tasks() saw.
+#define TRACE_USER       0x80 // 0x80 to 0xFE are free for the application.
+
+/** STATS_REQUEST_CODE wIndex values, other values are an EP address (0x00-0x0F OUT, 0x80-0x8F IN) */
+#define STATS_INDEX_BUS  0xFF
+#define STATS_INDEX_ENUM 0xFE
+
+/** MEM_REQUEST_CODE wIndex values */
+#define MEM_SPACE_RAM 0x00
+#define MEM_SPACE_ROM 0x01
+#define MEM_SPACE_EEPROM 0x02 // PIC18s with data EEPROM (_EEPROMSIZE), the 18F4550 and K50 parts.
+
 /* ************************************************************************** */
 
 
@@ -279,15 +476,105 @@ typedef struct
 /* ******************** GLOBAL VARIABLES FROM: usb.c ************************ */
 /* ************************************************************************** */
 
-extern usb_ustat_t             g_usb_last_USTAT;
+extern USB_NEAR usb_ustat_t    g_usb_last_USTAT;
 extern usb_ep_stat_t           g_usb_ep_stat[NUM_ENDPOINTS][2];
 
+#if defined(USB_SIM)
+#define g_usb_setup             USB_SIM_AT(ch9_setup_t, SETUP_DATA_ADDR)
+#define g_usb_get_descriptor    USB_SIM_AT(ch9_get_descriptor_t, SETUP_DATA_ADDR)
+#define g_usb_set_configuration USB_SIM_AT(ch9_set_configuration_t, SETUP_DATA_ADDR)
+#define g_usb_set_interface     USB_SIM_AT(ch9_set_interface_t, SETUP_DATA_ADDR)
+#define g_get_interface         USB_SIM_AT(ch9_get_interface_t, SETUP_DATA_ADDR)
+
+#define g_usb_bd_table          USB_SIM_AT_ARRAY(bd_t, NUM_BD, BDT_BASE_ADDR)
+#else
 extern ch9_setup_t             g_usb_setup             __at(SETUP_DATA_ADDR);
 extern ch9_get_descriptor_t    g_usb_get_descriptor    __at(SETUP_DATA_ADDR);
 extern ch9_set_configuration_t g_usb_set_configuration __at(SETUP_DATA_ADDR);
 extern ch9_set_interface_t     g_usb_set_interface     __at(SETUP_DATA_ADDR);
 
 extern bd_t                    g_usb_bd_table[NUM_BD] __at(BDT_BASE_ADDR);
+#endif
+
+#ifdef USE_EP_STATS
+extern usb_ep_counters_t       g_usb_ep_counters[NUM_ENDPOINTS][2];
+#endif
+#ifdef USE_TRACE
+extern usb_trace_entry_t       g_usb_trace[TRACE_RING_SIZE];
+extern uint8_t                 g_usb_trace_head;
+extern uint8_t                 g_usb_trace_count;
+#endif
+#ifdef USE_ARENA
+extern usb_arena_t             g_usb_arena;
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************** TRACE *********************************** */
+/* ************************************************************************** */
+
+// With USE_TRACE, USB_TRACE(event) records {event, USTAT, TRACE_TIMER} in the 
+// trace ring (the oldest entry is overwritten when full). The timer is read 
+// first so the entry's own cost isn't counted. Without USE_TRACE it's empty.
+// Use from the USB context, or with the USB interrupt disabled. From the 
+// main loop use USB_TRACE_MAIN(event), which masks the USB interrupt around 
+// the write so usb_tasks() can't take the same g_usb_trace_head slot.
+#ifdef USE_TRACE
+#define USB_TRACE(event) do{uint16_t time = TRACE_TIMER; \
+                            g_usb_trace[g_usb_trace_head].Time       = time; \
+                            g_usb_trace[g_usb_trace_head].Event      = (event); \
+                            g_usb_trace[g_usb_trace_head].Last_USTAT = *((uint8_t*)&g_usb_last_USTAT); \
+                            g_usb_trace_head = (g_usb_trace_head + 1) & (TRACE_RING_SIZE - 1); \
+                            if(g_usb_trace_count != TRACE_RING_SIZE) g_usb_trace_count++;}while(0)
+#else
+#define USB_TRACE(event)
+#endif
+#if defined(USE_TRACE) && !defined(USE_POLLING)
+#define USB_TRACE_MAIN(event) do{bool usb_ie = USB_INTERRUPT_ENABLE; \
+                                 USB_INTERRUPT_ENABLE = 0; \
+                                 USB_TRACE(event); \
+                                 USB_INTERRUPT_ENABLE = usb_ie;}while(0)
+#else
+#define USB_TRACE_MAIN(event) USB_TRACE(event) // With USE_POLLING usb_tasks() is in the main loop too.
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** SCRATCH ARENA ****************************** */
+/* ************************************************************************** */
+
+// With USE_ARENA, buffers that are never in use at the same time share 
+// g_usb_arena instead of each having their own RAM. USB_ARENA_STATES in 
+// usb_config.h names the states (say the MSD sector buffers of one 
+// configuration and HID feature report staging of another) and their sizes, 
+// each is a member of the union and starts at its first byte, so the arena is 
+// as big as the largest state. sizeof(g_usb_arena) is the peak, g_usb_arena 
+// is one symbol in the map file and memory summary, and USB_ARENA_BUDGET 
+// fails the build if the peak goes over it.
+// 
+// An owner places its buffers with USB_ARENA_AT(type, state, offset), or 
+// USB_ARENA_ARRAY(type, n, state, offset) so sizeof still works, usually by 
+// #defining its variable names to them. USB_ARENA_ASSERT(name, cond) fails the 
+// build when cond is false, e.g. when a state is smaller than its owner needs. 
+// Nothing stops two states being used at once, the owners have to keep to 
+// their state (the current configuration, a mode of the application).
+// 
+// The MSD sector buffers have an option of their own (MSD_ARENA). HID reports 
+// are the application's structs, which g_hid_in_reports[] and 
+// g_hid_out_reports[] point at, and the CDC examples' buffers are the 
+// application's too, so they're placed with USB_ARENA_AT() where there's a 
+// state for them. Every configuration can be a state, as only one is live at 
+// a time: CDC_MSD_HID_Example keeps its HID reports (configuration 1) and the 
+// line it echoes in configuration 2 in the arena.
+#ifdef USE_ARENA
+#define USB_ARENA_AT(type, state, offset)          (*(type*)&g_usb_arena.state[offset])
+#define USB_ARENA_ARRAY(type, n, state, offset)    (*(type(*)[n])&g_usb_arena.state[offset])
+#define USB_ARENA_ASSERT(name, cond) typedef char usb_arena_assert_##name[(cond) ? 1 : -1]
+#endif
 
 /* ************************************************************************** */
 
@@ -305,6 +592,10 @@ extern bd_t                    g_usb_bd_table[NUM_BD] __at(BDT_BASE_ADDR);
  * program loop to handle all USB tasks when polling method is used and run in 
  * ISR when interrupts are enabled. The function contains the USB Device state 
  * machine as seen in <i>Section 9.1.1</i> of the <i>USB Specification 2.0</i>.
+ * 
+ * Define USE_POLLING in usb_config.h when the main loop calls usb_tasks(), so 
+ * the class libraries leave the USB interrupt disabled. Define USE_USTAT_BATCH 
+ * to service every transaction waiting in the USTAT FIFO in one call.
  */
 void usb_tasks(void);
 
@@ -348,7 +639,146 @@ uint8_t usb_get_state(void);
  * 
  * @return configuration The current configuration.
  */
-uint8_t usb_get_configurationn(void);
+uint8_t usb_get_configuration(void);
+
+/** 
+ * @fn bool usb_get_remote_wakeup(void)
+ * 
+ * @brief Returns true if the host has enabled Remote Wakeup (SET_FEATURE 
+ * DEVICE_REMOTE_WAKEUP), starts as REMOTE_WAKEUP after each bus reset.
+ * 
+ * @return Returns true if usb_remote_wakeup() may signal resume.
+ */
+bool usb_get_remote_wakeup(void);
+
+/** 
+ * @fn bool usb_remote_wakeup(void)
+ * 
+ * @brief Wakes the host from suspend by driving resume signalling, call it 
+ * from the main loop when something happens the host should know about.
+ * 
+ * Only the configuration descriptor's RemoteWakeup bit (bmAttributes 0x20) lets 
+ * the host enable it. Blocks for about 4ms with the USB interrupt disabled, 
+ * the state is back to what it was before suspend when it returns.
+ * 
+ * @return Returns true if resume was signalled, false if not suspended or the 
+ * host hasn't enabled Remote Wakeup.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * if(usb_get_state() == STATE_SUSPENDED && BUTTON_PRESSED) usb_remote_wakeup();
+ * @endcode
+ * </li></ul>
+ */
+bool usb_remote_wakeup(void);
+
+#ifdef USE_SUSPEND_SLEEP
+/** 
+ * @fn void usb_sleep(void)
+ * 
+ * @brief Puts the CPU to Sleep while the bus is suspended, returns straight 
+ * away otherwise. Bus activity (resume or reset) wakes it.
+ * 
+ * Waits for the PLL to lock before returning, the USB interrupt then leaves 
+ * suspend. Other interrupts enabled also wake it, so check the state again. 
+ * On PIC18 set OSCCONbits.IDLEN first for Idle mode, peripherals keep their clock.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * while(usb_get_state() < STATE_CONFIGURED) usb_sleep();
+ * @endcode
+ * </li></ul>
+ */
+void usb_sleep(void);
+#endif
+
+#ifdef USE_EVENTS
+/** 
+ * @fn void usb_post_event(uint8_t event)
+ * 
+ * @brief Posts an event for usb_event_tasks() from the main loop, e.g. 
+ * EVENT_APP(0). usb_tasks() posts the USB events itself.
+ * 
+ * @param[in] event Event number, EVENT_CONFIGURED to EVENT_APP(3).
+ */
+void usb_post_event(uint8_t event);
+
+/** 
+ * @fn void usb_event_tasks(void)
+ * 
+ * @brief Run in the main loop, calls the g_usb_event_handlers[] entry (in 
+ * usb_app.h) of every event posted since the last call, lowest event 
+ * number first.
+ * 
+ * With nothing posted, PIC18s wait in Idle mode for the next interrupt, and 
+ * with USE_SUSPEND_SLEEP the CPU sleeps while suspended. Events posted while the 
+ * handlers run are dispatched on the next call, so one slow handler can hold 
+ * the others up by no more than its own run time. In polling mode usb_tasks() 
+ * is called first and the CPU doesn't idle.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * while(1) usb_event_tasks();
+ * @endcode
+ * </li></ul>
+ */
+void usb_event_tasks(void);
+#endif
+
+#ifdef USE_DEFERRED_TASKS
+/** 
+ * @fn void usb_deferred_tasks(void)
+ * 
+ * @brief Runs the EP handlers of the transactions usb_tasks() has queued, 
+ * oldest first.
+ * 
+ * With USE_DEFERRED_TASKS the USB interrupt only services EP0 and drains the 
+ * USTAT FIFO, so it's short enough to share the high priority vector with 
+ * the timing critical interrupts. The class handlers (msd_add_task(), 
+ * cdc_tasks(), hid_tasks()...) update their toggles and re-arm their BDs 
+ * from here instead, in the main loop or in a low priority interrupt that 
+ * fires often enough (a timer). A BD isn't used again until its handler 
+ * has re-armed it, so the SIE NAKs rather than overruns while the handlers 
+ * catch up. If the queue does fill, the Transaction Complete interrupt is 
+ * held off until this has emptied it.
+ * 
+ * Nothing is run while the USB interrupt is disabled, so the class 
+ * libraries' critical sections still keep the handlers out. With USE_TRACE 
+ * each handler is traced as TRACE_EP_HANDLER from here, the USB interrupt 
+ * masked for each entry.
+ * 
+ * On PIC18s usb_init() puts the USB interrupt on the high priority vector, 
+ * set RCONbits.IPEN and clear the IPRx bits of the low priority interrupts. 
+ * PIC16s have one vector, call this from the main loop.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * static void __interrupt(high_priority) isr(void)
+ * {
+ *     if(USB_INTERRUPT_ENABLE && USB_INTERRUPT_FLAG)
+ *     {
+ *         usb_tasks();
+ *         USB_INTERRUPT_FLAG = 0;
+ *     }
+ * }
+ * 
+ * static void __interrupt(low_priority) isr_low(void)
+ * {
+ *     if(PIE1bits.TMR2IE && PIR1bits.TMR2IF)
+ *     {
+ *         usb_deferred_tasks();
+ *         PIR1bits.TMR2IF = 0;
+ *     }
+ * }
+ * @endcode
+ * </li></ul>
+ */
+void usb_deferred_tasks(void);
+#endif
 
 /** 
  * @fn void usb_set_control_stage(uint8_t control_stage)
@@ -366,12 +796,149 @@ uint8_t usb_get_configurationn(void);
  */
 void usb_set_control_stage(uint8_t control_stage);
 
+#ifdef USE_ENUM_STATS
+/** 
+ * @fn void usb_get_stats(usb_stats_t* p_stats)
+ * 
+ * @brief Copies the enumeration stats (define USE_ENUM_STATS in usb_config.h).
+ * 
+ * The stats are taken inside process_setup(), get_descriptor(), set_address(), 
+ * set_configuration(), and on each bus reset. Compare frame numbers with USB_FRAMES_BETWEEN().
+ * 
+ * @param[out] p_stats Where to copy the stats.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * usb_stats_t stats;
+ * usb_get_stats(&stats);
+ * time_to_configured_ms = USB_FRAMES_BETWEEN(stats.First_Setup_Frame, stats.Set_Configuration_Frame);
+ * @endcode
+ * </li></ul>
+ */
+void usb_get_stats(usb_stats_t* p_stats);
+
+/** 
+ * @fn void usb_clear_stats(void)
+ * 
+ * @brief Clears the enumeration stats, usb_init() also clears them.
+ */
+void usb_clear_stats(void);
+#endif
+
+#ifdef USE_EP_STATS
+/** 
+ * @fn void usb_get_ep_counters(uint8_t ep, uint8_t dir, usb_ep_counters_t* p_counters)
+ * 
+ * @brief Copies the completed transaction and byte counts of an endpoint (define USE_EP_STATS in usb_config.h).
+ * 
+ * Counts are taken in usb_tasks() as each transaction leaves the USTAT FIFO.
+ * 
+ * @param[in] ep The endpoint number.
+ * @param[in] dir IN or OUT.
+ * @param[out] p_counters Where to copy the counts.
+ */
+void usb_get_ep_counters(uint8_t ep, uint8_t dir, usb_ep_counters_t* p_counters);
+
+/** 
+ * @fn void usb_get_bus_stats(usb_bus_stats_t* p_stats)
+ * 
+ * @brief Copies the stall, UEIR error and per-frame counts (define USE_EP_STATS in usb_config.h).
+ * 
+ * Errors are only counted with USE_ERROR and the bits set in ERROR_INTERRUPT_MASK. 
+ * Frames and Frame_Peak are only counted with USE_SOF.
+ * 
+ * @param[out] p_stats Where to copy the stats.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * usb_bus_stats_t bus;
+ * usb_get_bus_stats(&bus);
+ * if(bus.CRC16_Errors) check_cable();
+ * @endcode
+ * </li></ul>
+ */
+void usb_get_bus_stats(usb_bus_stats_t* p_stats);
+
+/** 
+ * @fn void usb_clear_ep_stats(void)
+ * 
+ * @brief Clears the EP counters and bus stats, usb_init() also clears them.
+ */
+void usb_clear_ep_stats(void);
+#endif
+
+#ifdef USE_TRACE
+/** 
+ * @fn uint8_t usb_trace_read(usb_trace_entry_t* p_entries, uint8_t max_entries)
+ * 
+ * @brief Takes the oldest entries out of the trace ring (define USE_TRACE in usb_config.h).
+ * 
+ * The difference between an event's entry and exit Time is its cost in TRACE_TIMER counts.
+ * 
+ * @param[out] p_entries Where to copy the entries.
+ * @param[in] max_entries Most entries to take.
+ * @return Number of entries taken.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * usb_trace_entry_t entries[8];
+ * uint8_t n = usb_trace_read(entries, 8);
+ * cdc_write((const uint8_t*)entries, n * sizeof(usb_trace_entry_t));
+ * @endcode
+ * </li></ul>
+ */
+uint8_t usb_trace_read(usb_trace_entry_t* p_entries, uint8_t max_entries);
+#endif
+
+/*
+ * With USE_STATS_REQUEST the host can read the stats with a vendor request:
+ * bmRequestType 0xC0, bRequest STATS_REQUEST_CODE, wValue 1 clears what was read, 
+ * wIndex STATS_INDEX_BUS (usb_bus_stats_t), STATS_INDEX_ENUM (usb_stats_t) or an 
+ * EP address (usb_ep_counters_t). Data is little endian, as laid out in the types above.
+ */
+
+/*
+ * With USE_MEM_REQUEST the host can read and write memory with a vendor request, 
+ * whatever the class: bRequest MEM_REQUEST_CODE, wValue the address, wLength the 
+ * bytes. bmRequestType 0xC0 reads wIndex MEM_SPACE_RAM (data memory, the FSR 
+ * address), MEM_SPACE_ROM (the first 64K of program memory, on PIC16 the low 
+ * byte of each word) or MEM_SPACE_EEPROM, 0x40 writes MEM_SPACE_RAM or 
+ * MEM_SPACE_EEPROM. The data stage is as long as wLength, EP0_SIZE bytes a 
+ * packet, so a 4K dump is one request. Any other wIndex, a write to program 
+ * memory or EEPROM out of _EEPROMSIZE stalls. 
+ * 
+ * Program memory is read only, writing it means erasing whole blocks first. 
+ * It stops at 64K as wValue and the pointers the EP0 copy uses are 16 bits: 
+ * that's all of it on every supported part but the 128K 18F27J53/47J53, and 
+ * leaves out the config words and IDs. EEPROM writes wait about 4ms a byte in 
+ * the interrupt, bytes that already match are skipped. The PIC16F145X and J 
+ * parts have no EEPROM. Reading an SFR that changes when read (POSTINCn, 
+ * RCREG, SSPBUF...) does what reading it always does, and nothing stops a 
+ * write landing on the stack's own variables. 
+ * It's a debug aid, leave it out of production builds. See Tools/Mem_Dump.
+ */
+
+/*
+ * With USE_BOS usb_descriptors.c gives g_bos_descriptor and g_bos_descriptor_size, 
+ * built from CH9_BOS_DESCRIPTOR() and its Device Capabilities (usb_ch9.h). With 
+ * USE_MS_OS_20 it also gives g_ms_os_20_descriptor_set and 
+ * g_ms_os_20_descriptor_set_size, sent for bmRequestType 0xC0, bRequest 
+ * MS_OS_20_VENDOR_CODE, wIndex MS_OS_20_DESCRIPTOR_INDEX. The BOS must hold 
+ * CH9_MS_OS_20_PLATFORM_DESCRIPTOR(g_ms_os_20_descriptor_set_size, MS_OS_20_VENDOR_CODE). 
+ * See the Vendor Stream Example.
+ */
+
 /**
  * @fn void usb_arm_endpoint(bd_t* p_bd, usb_ep_stat_t* p_ep_stat, uint16_t buffer_addr, uint8_t cnt)
  * 
  * @brief Arms any OUT/IN Endpoint for a transaction.
  * 
- * The function is used to arm any endpoint (OUT/IN) for a transaction.
+ * The function is used to arm any endpoint (OUT/IN) for a transaction. With 
+ * USE_BD_TOGGLE the DTS is the opposite of the BD's last one, unless 
+ * p_ep_stat->Data_Toggle_Val has been cleared, then it's DATA0.
  * 
  * @param[in] p_bd Buffer Descriptor pointer.
  * @param[in] p_ep_stat Endpoint status pointer.
@@ -386,6 +953,265 @@ void usb_set_control_stage(uint8_t control_stage);
  */
 void usb_arm_endpoint(bd_t* p_bd, usb_ep_stat_t* p_ep_stat, uint8_t cnt);
 
+/**
+ * @fn bool usb_set_bd_buffer(bd_t* p_bd, uint8_t* p_buffer, uint16_t bytes)
+ * 
+ * @brief Re-points a Buffer Descriptor's ADR at any buffer the SIE can reach.
+ * 
+ * Lets a transfer land in (or be sent from) an Application buffer with no copy, 
+ * e.g. a whole sector received across several packets. The buffer must be 
+ * inside USB_RAM_START to USB_RAM_END for the part (all of RAM on J50/J53 
+ * parts), or the BD is left alone. The BD must not be owned by the SIE, and 
+ * should be pointed back at its Endpoint buffer when the transfer is done.
+ * 
+ * @param[in] p_bd Buffer Descriptor pointer.
+ * @param[in] p_buffer Buffer to point ADR at.
+ * @param[in] bytes Size of the buffer.
+ * 
+ * @return Returns true if ADR was changed, false if the buffer is out of the 
+ * SIE's reach.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * if(usb_set_bd_buffer(&g_usb_bd_table[MSD_BD_OUT], g_msd_sect_data, 512)) msd_arm_ep_out();
+ * @endcode
+ * </li></ul>
+ */
+bool usb_set_bd_buffer(bd_t* p_bd, uint8_t* p_buffer, uint16_t bytes);
+
+/**
+ * @fn uint8_t* usb_ep_acquire_in(uint8_t ep)
+ * 
+ * @brief Gets the Endpoint buffer the next IN transaction will be sent from.
+ * 
+ * Lets a class driver or Application write an IN packet straight into USB RAM, 
+ * no staging buffer or copy needed. The buffer is the one after Last_PPB when 
+ * the Endpoint ping-pongs. As with usb_arm_endpoint(), the Endpoint's 
+ * Data_Toggle_Val and Last_PPB must be updated by the class when the 
+ * transaction completes. The Endpoint's BD ADR must already be set up 
+ * (normally by the class's init).
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * 
+ * @return Returns a pointer to the Endpoint buffer, or NULL if the SIE still 
+ * owns it.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t* p_ep = usb_ep_acquire_in(HID_EP);
+ * if(p_ep)
+ * {
+ *     p_ep[0] = buttons;
+ *     usb_ep_commit_in(HID_EP, 1);
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* usb_ep_acquire_in(uint8_t ep);
+
+/**
+ * @fn void usb_ep_commit_in(uint8_t ep, uint8_t cnt)
+ * 
+ * @brief Arms the buffer given by usb_ep_acquire_in() to send cnt bytes.
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[in] cnt Amount of bytes written into the buffer.
+ */
+void usb_ep_commit_in(uint8_t ep, uint8_t cnt);
+
+/**
+ * @fn uint8_t* usb_ep_peek_out(uint8_t ep, uint8_t* p_cnt)
+ * 
+ * @brief Gets the Endpoint buffer of the last completed OUT transaction.
+ * 
+ * The data can be used where it is, in USB RAM, then handed back with 
+ * usb_ep_release_out().
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[out] p_cnt Amount of bytes received.
+ * 
+ * @return Returns a pointer to the Endpoint buffer, or NULL if the SIE still 
+ * owns it.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t cnt;
+ * uint8_t* p_ep = usb_ep_peek_out(CDC_DAT_EP, &cnt);
+ * if(p_ep)
+ * {
+ *     uart_write(p_ep, cnt);
+ *     usb_ep_release_out(CDC_DAT_EP, CDC_DAT_EP_SIZE);
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* usb_ep_peek_out(uint8_t ep, uint8_t* p_cnt);
+
+/**
+ * @fn void usb_ep_release_out(uint8_t ep, uint8_t cnt)
+ * 
+ * @brief Arms the next OUT buffer to receive, once the data from 
+ * usb_ep_peek_out() has been used.
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[in] cnt Max amount of bytes to receive, normally the Endpoint size.
+ */
+void usb_ep_release_out(uint8_t ep, uint8_t cnt);
+
+/**
+ * @fn uint16_t usb_get_frame_number(void)
+ * 
+ * @brief Returns the 11 bit frame number of the last SOF.
+ */
+uint16_t usb_get_frame_number(void);
+
+#ifdef USE_TIMESTAMP
+/**
+ * @fn uint32_t usb_get_frame(void)
+ * 
+ * @brief Returns the number of frames since usb_init(), counted from the 
+ * 11 bit frame number at each SOF. The low 11 bits match the bus frame number, 
+ * frames missed while suspended (or by a slow poll) are still counted.
+ */
+uint32_t usb_get_frame(void);
+
+/**
+ * @fn void usb_timestamp(usb_timestamp_t* p_timestamp)
+ * 
+ * @brief Takes a timestamp, the frame of the last SOF and the microseconds 
+ * since, from TIMESTAMP_TIMER latched when the SOF was handled.
+ * 
+ * The host sees the same frame numbers, so samples from several devices line 
+ * up to well under a millisecond without a sync protocol. The latch is taken 
+ * at the start of the SOF handling, the interrupt latency is constant so it 
+ * cancels out between devices running the same firmware. In polling mode it's 
+ * as late as the poll. Micros stops at 999 if the next SOF hasn't been handled 
+ * yet. Callable from the main loop or the USB context.
+ * 
+ * @param[out] p_timestamp Where to put the timestamp.
+ */
+void usb_timestamp(usb_timestamp_t* p_timestamp);
+
+/**
+ * @fn uint8_t usb_timestamp_header(uint8_t* p_buffer)
+ * 
+ * @brief Takes a timestamp and writes it at p_buffer as an in-band header, 
+ * TIMESTAMP_HEADER_SIZE bytes, Frame (4) then Micros (2), little endian.
+ * 
+ * Put it at the start of a CDC write, a vendor packet or a HID report (as a 
+ * 48 bit field) so the host gets the time the data was taken with the data.
+ * 
+ * @param[out] p_buffer At least TIMESTAMP_HEADER_SIZE bytes.
+ * 
+ * @return Returns TIMESTAMP_HEADER_SIZE.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t n = usb_timestamp_header(p_ep);
+ * n += take_samples(&p_ep[n]);
+ * @endcode
+ * </li></ul>
+ */
+uint8_t usb_timestamp_header(uint8_t* p_buffer);
+#endif
+
+#ifdef USE_ISOCHRONOUS
+/**
+ * @fn void usb_iso_ep_init(uint8_t ep, uint8_t dir, uint16_t even_addr, uint16_t odd_addr, uint16_t size)
+ * 
+ * @brief Sets an Endpoint up for isochronous transfers, no handshake and no 
+ * data toggle sync, with both ping-pong buffers.
+ * 
+ * Call it when the Interface's alternate setting with the isochronous Endpoint 
+ * is selected. OUT Endpoints get both buffers armed to receive size bytes. An 
+ * isochronous packet is up to 1023 bytes, set EPn_OUT_SIZE/EPn_IN_SIZE to match 
+ * wMaxPacketSize.
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[in] dir OUT or IN.
+ * @param[in] even_addr Even buffer, e.g. EP_IN_EVEN_BUFFER_ADDR(EP1).
+ * @param[in] odd_addr Odd buffer, e.g. EP_IN_ODD_BUFFER_ADDR(EP1).
+ * @param[in] size wMaxPacketSize of the Endpoint.
+ */
+void usb_iso_ep_init(uint8_t ep, uint8_t dir, uint16_t even_addr, uint16_t odd_addr, uint16_t size);
+
+/**
+ * @fn void usb_iso_ep_stop(uint8_t ep, uint8_t dir)
+ * 
+ * @brief Disables an isochronous Endpoint, e.g. when the host selects the 
+ * zero bandwidth alternate setting. Both buffers are taken back from the SIE.
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[in] dir OUT or IN.
+ */
+void usb_iso_ep_stop(uint8_t ep, uint8_t dir);
+
+/**
+ * @fn uint8_t* usb_iso_acquire_in(uint8_t ep)
+ * 
+ * @brief Gets the buffer of the next isochronous IN packet.
+ * 
+ * The host takes one packet per frame (bInterval 1). Fill and commit one from 
+ * usb_sof() (or EVENT_SOF) so a packet is always armed for the next frame, 
+ * a frame the SIE has nothing armed for gets no data.
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * 
+ * @return Returns a pointer to the buffer, or NULL if both are armed.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * void usb_sof(void)
+ * {
+ *     uint8_t* p_ep = usb_iso_acquire_in(AUDIO_EP);
+ *     if(p_ep) usb_iso_commit_in(AUDIO_EP, audio_take_samples(p_ep));
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* usb_iso_acquire_in(uint8_t ep);
+
+/**
+ * @fn void usb_iso_commit_in(uint8_t ep, uint16_t cnt)
+ * 
+ * @brief Arms the buffer given by usb_iso_acquire_in() to send cnt bytes (0 to 1023).
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[in] cnt Amount of bytes written into the buffer.
+ */
+void usb_iso_commit_in(uint8_t ep, uint16_t cnt);
+
+/**
+ * @fn uint8_t* usb_iso_peek_out(uint8_t ep, uint16_t* p_cnt)
+ * 
+ * @brief Gets the oldest received isochronous OUT packet.
+ * 
+ * There is no retry, a damaged packet is simply missed, and so is a packet 
+ * the host sends while both buffers are full.
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[out] p_cnt Amount of bytes received.
+ * 
+ * @return Returns a pointer to the buffer, or NULL if nothing has arrived.
+ */
+uint8_t* usb_iso_peek_out(uint8_t ep, uint16_t* p_cnt);
+
+/**
+ * @fn void usb_iso_release_out(uint8_t ep, uint16_t size)
+ * 
+ * @brief Arms the buffer given by usb_iso_peek_out() to receive again.
+ * 
+ * @param[in] ep Endpoint number (EP1 to EP15).
+ * @param[in] size wMaxPacketSize of the Endpoint.
+ */
+void usb_iso_release_out(uint8_t ep, uint16_t size);
+#endif
+
 
 #if PINGPONG_MODE == PINGPONG_ALL_EP
 /**
@@ -508,11 +1334,36 @@ void usb_out_control_status(void);
  */
 void usb_in_control_transfer(void);
 
+/**
+ * @fn void usb_start_in_control_transfer(void)
+ * 
+ * @brief Starts the data stage of an IN Control transfer set up by usb_setup_in_control_transfer().
+ * 
+ * With PINGPONG_ALL_EP both EP0 IN buffers are loaded, so the host can take the next packet while 
+ * the one it just took is refilled. Otherwise only the first packet is loaded. The control stage 
+ * is set to DATA_IN_STAGE.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * usb_set_ram_ptr((uint8_t*)&g_cdc_get_line_coding_return);
+ * usb_setup_in_control_transfer(RAM, 7, g_cdc_set_get_line_coding.Size_of_Structure);
+ * usb_start_in_control_transfer();
+ * @endcode
+ * </li></ul>
+ */
+void usb_start_in_control_transfer(void);
+
 /**
  * @fn void usb_rom_copy(const uint8_t* p_rom, uint8_t* p_ep, uint8_t bytes)
  * 
  * @brief Copy values from ROM and place in endpoint.
  * 
+ * On PIC18 the copy reads program memory with TBLRD*+ and uses TBLPTR, 
+ * p_rom must point to program memory (e.g. a const descriptor). TBLPTR and 
+ * TABLAT are restored before it returns, so it's safe from the USB interrupt 
+ * while the main loop is reading program memory.
+ * 
  * @param[in] *p_rom Pointer to the address in ROM to copy from.
  * @param[in] *p_ep Pointer to the endpoint address in RAM to copy to.
  * @param[in] bytes Amount of bytes to copy.
@@ -555,8 +1406,7 @@ void usb_ram_set(uint8_t val, uint8_t* p_ram, uint16_t bytes);
  * <ul style="list-style-type:none"><li>
  * @code
  * usb_setup_in_control_transfer(RAM, bytes_available, m_get_set_report.Report_Length);
- * usb_in_control_transfer();
- * usb_set_control_stage(DATA_IN_STAGE);
+ * usb_start_in_control_transfer();
  * @endcode
  * </li></ul>
  */
@@ -31,6 +31,117 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "usb_config.h"
+
+
+/* ************************************************************************** */
+/* ************************** APP TYPES ************************************* */
+/* ************************************************************************** */
+
+/** Endpoint Transaction Handler Type */
+typedef void (*usb_ep_handler_t)(void);
+
+/** Event Handler Type */
+typedef void (*usb_event_handler_t)(void);
+
+/** Interface Request Handlers Type, unused members are NULL */
+typedef struct
+{
+    bool (*class_request)(void);                                              ///< As usb_service_class_request().
+    bool (*get_class_descriptor)(const uint8_t** descriptor, uint16_t* size); ///< As usb_get_class_descriptor().
+    bool (*out_control_finished)(void);                                       ///< As usb_out_control_finished().
+    bool (*vendor_request)(void);                                             ///< As usb_service_class_request(), for Vendor Requests.
+}usb_if_handler_t;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** APP VARIABLES ********************************* */
+/* ************************************************************************** */
+
+#ifdef USE_EP_HANDLER_TABLE
+/**
+ * @var g_usb_ep_handlers
+ * @brief Endpoint Transaction Handler Table, indexed by [ENDP][DIR].
+ * 
+ * Defined by the Application in place of usb_app_tasks(). usb_tasks() calls 
+ * the handler for the endpoint and direction in USTAT straight away, 
+ * TRANSACTION_BD gives the Buffer Descriptor used. Unused entries are NULL.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2] =
+ * {
+ *     [MSD_EP][OUT] = msd_add_task,
+ *     [MSD_EP][IN]  = msd_add_task
+ * };
+ * @endcode
+ * </li></ul>
+ */
+extern const usb_ep_handler_t g_usb_ep_handlers[NUM_ENDPOINTS][2];
+#endif
+
+#ifdef USE_EVENTS
+/**
+ * @var g_usb_event_handlers
+ * @brief Event Handler Table, indexed by event number (EVENT_SOF etc. in usb.h).
+ * 
+ * Defined by the Application. usb_event_tasks() calls the handler of each 
+ * posted event from the main loop, unused entries are NULL.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * const usb_event_handler_t g_usb_event_handlers[NUM_EVENTS] =
+ * {
+ *     [EVENT_EP(CDC_DAT_EP)] = vcp_tasks,
+ *     [EVENT_SOF]            = button_tasks
+ * };
+ * @endcode
+ * </li></ul>
+ */
+extern const usb_event_handler_t g_usb_event_handlers[NUM_EVENTS];
+#endif
+
+#ifdef USE_IF_HANDLER_TABLE
+/**
+ * @var g_usb_if_handlers
+ * @brief Interface Request Handler Table, indexed by Interface Number.
+ * 
+ * Defined by the Application, so each class of a composite device only sees 
+ * the requests for its own interfaces. Class and Vendor Requests, Get 
+ * Descriptor Requests and the end of OUT Class Requests with an Interface 
+ * recipient use the entry in the low byte of wIndex. Requests for other 
+ * recipients, and interfaces without a handler, still use 
+ * usb_service_class_request(), usb_get_class_descriptor() and 
+ * usb_out_control_finished(). vendor_request can be left out of the 
+ * initializer when there are no Vendor Requests.
+ * 
+ * With more than one configuration the table has a row per configuration, 
+ * [0] for bConfigurationValue 1, as interface numbers start at 0 in each.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * const usb_if_handler_t g_usb_if_handlers[NUM_INTERFACES] =
+ * {
+ *     [CDC_COM_INT] = {cdc_class_request, NULL, cdc_out_control_tasks},
+ *     [MSD_INT]     = {msd_class_request, NULL, NULL},
+ *     [HID_INT]     = {hid_class_request, hid_get_class_descriptor, NULL}
+ * };
+ * @endcode
+ * </li></ul>
+ */
+#if NUM_CONFIGURATIONS > 1
+extern const usb_if_handler_t g_usb_if_handlers[NUM_CONFIGURATIONS][NUM_INTERFACES];
+#else
+extern const usb_if_handler_t g_usb_if_handlers[NUM_INTERFACES];
+#endif
+#endif
+
+/* ************************************************************************** */
 
 
 /* ************************************************************************** */
@@ -62,6 +173,24 @@ bool usb_get_class_descriptor(const uint8_t** descriptor, uint16_t* size);
  * @fn void usb_app_init(void)
  * 
  * @brief Used to initialize class libraries.
+ * 
+ * Called on SET_CONFIGURATION with every Endpoint but EP0 disabled, 
+ * usb_get_configuration() already returns the new configuration. With more 
+ * than one, initialize the classes of that one only. EP buffers are placed 
+ * at build time for the largest size any configuration gives an Endpoint, 
+ * so the configurations' Endpoints share the USB RAM, and PINGPONG_MODE is 
+ * the same for all of them.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * void usb_app_init(void)
+ * {
+ *     if(usb_get_configuration() == 1) hid_init(); // 100mA, interrupt EP1.
+ *     else vendor_init();                          // 500mA, bulk EP2.
+ * }
+ * @endcode
+ * </li></ul>
  */
 void usb_app_init(void);
 
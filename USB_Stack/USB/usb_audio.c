@@ -0,0 +1,170 @@
+/**
+ * @file usb_audio.c
+ * @brief <i>Audio Class</i> 1.0 microphone.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Audio Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_audio.h"
+#include "usb_ch9.h"
+
+/* ************************************************************************** */
+/* ************************** AUDIO EP BUFFERS ****************************** */
+/* ************************************************************************** */
+
+uint8_t g_audio_ep_in_even[AUDIO_EP_SIZE] __at(AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR);
+uint8_t g_audio_ep_in_odd[AUDIO_EP_SIZE]  __at(AUDIO_EP_IN_ODD_BUFFER_BASE_ADDR);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+static uint8_t  m_mute;       // Feature Unit master Mute, written by SET_CUR.
+static uint8_t  m_alt;        // Audio Streaming interface's Alternate Setting.
+static uint8_t* m_p_fill;     // Packet being filled, NULL if none is free.
+static uint16_t m_fill_cnt;   // Bytes in the packet being filled.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void stop_stream(void)
+ * 
+ * @brief Disables the isochronous Endpoint and drops the packet being filled.
+ */
+static void stop_stream(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** AUDIO FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+void audio_init(void)
+{
+    m_mute = 0;
+    stop_stream();
+}
+
+bool audio_class_request(void)
+{
+    // Only the master Mute of the Feature Unit is implemented.
+    if(g_usb_setup.bmRequestType_bits.Recipient != INTERFACE) return false;
+    if((uint8_t)g_usb_setup.wIndex != AUDIO_AC_INT) return false;
+    if((uint8_t)(g_usb_setup.wIndex >> 8) != AUDIO_FEATURE_UNIT_ID) return false;
+    if(g_usb_setup.wValue != (AUDIO_MUTE_CONTROL << 8)) return false;
+    if(g_usb_setup.wLength != 1) return false;
+    
+    switch(g_usb_setup.bRequest)
+    {
+        case AUDIO_GET_CUR:
+            usb_set_ram_ptr(&m_mute);
+            usb_setup_in_control_transfer(RAM, 1, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        case AUDIO_SET_CUR:
+            usb_set_ram_ptr(&m_mute);
+            usb_set_num_out_control_bytes(1);
+            usb_set_control_stage(DATA_OUT_STAGE);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool audio_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    if(interface == AUDIO_AC_INT) return alternate_setting == 0;
+    if(interface != AUDIO_AS_INT || alternate_setting > 1) return false;
+    
+    stop_stream();
+    if(alternate_setting == 1)
+    {
+        usb_iso_ep_init(AUDIO_EP, IN, AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR, AUDIO_EP_IN_ODD_BUFFER_BASE_ADDR, AUDIO_EP_SIZE);
+        m_p_fill = usb_iso_acquire_in(AUDIO_EP);
+        m_alt = 1;
+    }
+    return true;
+}
+
+bool audio_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    if(interface == AUDIO_AC_INT) *alternate_setting_result = 0;
+    else if(interface == AUDIO_AS_INT) *alternate_setting_result = m_alt;
+    else return false;
+    return true;
+}
+
+void audio_sof(void)
+{
+    if(m_alt == 0) return;
+    
+    // Send what came in during the last frame, the host adjusts to the count.
+    if(m_p_fill != NULL) usb_iso_commit_in(AUDIO_EP, m_fill_cnt);
+    m_p_fill = usb_iso_acquire_in(AUDIO_EP);
+    m_fill_cnt = 0;
+}
+
+void audio_put_sample(int16_t sample)
+{
+    if(m_p_fill == NULL || m_fill_cnt > (AUDIO_EP_SIZE - AUDIO_SUBFRAME_SIZE)) return;
+    if(m_mute) sample = 0;
+    
+    m_p_fill[m_fill_cnt++] = (uint8_t)sample;
+    m_p_fill[m_fill_cnt++] = (uint8_t)((uint16_t)sample >> 8);
+}
+
+bool audio_streaming(void)
+{
+    return m_alt != 0;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static void stop_stream(void)
+{
+    usb_iso_ep_stop(AUDIO_EP, IN);
+    m_alt = 0;
+    m_p_fill = NULL;
+    m_fill_cnt = 0;
+}
+
+/* ************************************************************************** */
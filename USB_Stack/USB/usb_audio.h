@@ -0,0 +1,392 @@
+/**
+ * @file usb_audio.h
+ * @brief <i>Audio Class</i> 1.0 microphone.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Audio Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_AUDIO_H
+#define USB_AUDIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_hal.h"
+#include "usb.h"
+#include "usb_ch9.h"
+#include "usb_audio_config.h"
+
+/*
+ * USB Audio Class 1.0 microphone: Input Terminal -> Feature Unit (Mute) -> 
+ * USB Streaming Output Terminal. The Audio Streaming interface has the zero 
+ * bandwidth alternate setting 0, and alternate setting 1 with an asynchronous 
+ * isochronous IN Endpoint on AUDIO_EP.
+ * 
+ * Samples go straight into the IN packet in USB RAM. audio_put_sample() (e.g. 
+ * from an ADC interrupt) writes into the packet being filled, and audio_sof() 
+ * (from usb_sof()) arms it and starts filling the other ping-pong buffer. 
+ * Each packet holds however many samples came in during a frame, so the host 
+ * tracks the device's sample clock from the packet sizes and no feedback 
+ * Endpoint is needed.
+ */
+
+/* ************************************************************************** */
+/* ************************** WARNING FOR AUDIO ***************************** */
+/* ************************************************************************** */
+
+#ifndef USE_ISOCHRONOUS
+#error "The Audio library needs USE_ISOCHRONOUS in usb_config.h."
+#endif
+
+#ifndef USE_SOF
+#error "The Audio library arms a packet every SOF, USE_SOF must be defined and _SOFIE set in INTERRUPTS_MASK."
+#endif
+
+#if NUM_ALT_INTERFACES == 0
+#error "The Audio Streaming interface has an alternate setting, NUM_ALT_INTERFACES must be at least 1."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** AUDIO DEFINES ******************************* */
+/* ************************************************************************** */
+
+#define AUDIO_CLASS                 0x01
+#define AUDIO_SUBCLASS_CONTROL      0x01
+#define AUDIO_SUBCLASS_STREAMING    0x02
+
+#define AUDIO_CS_INTERFACE          0x24
+#define AUDIO_CS_ENDPOINT           0x25
+
+// Audio Control Interface Descriptor Subtypes
+#define AUDIO_HEADER                0x01
+#define AUDIO_INPUT_TERMINAL        0x02
+#define AUDIO_OUTPUT_TERMINAL       0x03
+#define AUDIO_FEATURE_UNIT          0x06
+
+// Audio Streaming Interface Descriptor Subtypes
+#define AUDIO_AS_GENERAL            0x01
+#define AUDIO_FORMAT_TYPE           0x02
+#define AUDIO_EP_GENERAL            0x01
+
+#define AUDIO_FORMAT_TYPE_I         0x01
+#define AUDIO_FORMAT_PCM            0x0001
+
+// Terminal Types
+#define AUDIO_TERMINAL_USB_STREAMING 0x0101
+#define AUDIO_TERMINAL_MICROPHONE    0x0201
+
+// Class Requests
+#define AUDIO_SET_CUR               0x01
+#define AUDIO_GET_CUR               0x81
+
+// Feature Unit Control Selectors
+#define AUDIO_MUTE_CONTROL          0x01
+
+// Entity IDs
+#define AUDIO_INPUT_TERMINAL_ID     1
+#define AUDIO_FEATURE_UNIT_ID       2
+#define AUDIO_OUTPUT_TERMINAL_ID    3
+
+#define AUDIO_SUBFRAME_SIZE 2  // Bytes per sample.
+#define AUDIO_FRAME_SIZE    (AUDIO_CHANNELS * AUDIO_SUBFRAME_SIZE)
+
+// Samples per frame plus one, the device clock can run a little fast.
+#define AUDIO_EP_SIZE (((AUDIO_SAMPLE_RATE + 999) / 1000 + 1) * AUDIO_FRAME_SIZE)
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** AUDIO EP ADDRESSES *************************** */
+/* ************************************************************************** */
+
+#ifdef _PIC14E
+#if BDT_SIZE <= 0x50
+#define AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR 0x2050
+#else
+#define AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR (BDT_BASE_ADDR + BDT_SIZE)
+#endif
+#define AUDIO_EP_IN_ODD_BUFFER_BASE_ADDR  (AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR + AUDIO_EP_SIZE)
+#else
+#define AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR EP_IN_EVEN_BUFFER_ADDR(AUDIO_EP)
+#define AUDIO_EP_IN_ODD_BUFFER_BASE_ADDR  EP_IN_ODD_BUFFER_ADDR(AUDIO_EP)
+#endif
+
+#if defined(_PIC14E) && ((AUDIO_EP_IN_ODD_BUFFER_BASE_ADDR + AUDIO_EP_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "Audio's EP buffers overlap the EP0 buffers, reduce EP0_SIZE or AUDIO_SAMPLE_RATE."
+#elif !defined(_PIC14E) && ((AUDIO_EP_IN_ODD_BUFFER_BASE_ADDR - AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR) < AUDIO_EP_SIZE)
+#error "Audio's EP buffers are too small, set the AUDIO_EP IN size in usb_config.h to AUDIO_EP_SIZE."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************************* TYPES ********************************** */
+/* ************************************************************************** */
+
+/// Audio Control Header Descriptor, one Audio Streaming interface.
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint16_t bcdADC;
+    uint16_t wTotalLength;
+    uint8_t  bInCollection;
+    uint8_t  baInterfaceNr;
+}audio_ac_header_descriptor_t;
+
+/// Input Terminal Descriptor
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint8_t  bTerminalID;
+    uint16_t wTerminalType;
+    uint8_t  bAssocTerminal;
+    uint8_t  bNrChannels;
+    uint16_t wChannelConfig;
+    uint8_t  iChannelNames;
+    uint8_t  iTerminal;
+}audio_input_terminal_descriptor_t;
+
+/// Feature Unit Descriptor, one byte of controls for the master and each channel.
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint8_t  bUnitID;
+    uint8_t  bSourceID;
+    uint8_t  bControlSize;
+    uint8_t  bmaControls[AUDIO_CHANNELS + 1];
+    uint8_t  iFeature;
+}audio_feature_unit_descriptor_t;
+
+/// Output Terminal Descriptor
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint8_t  bTerminalID;
+    uint16_t wTerminalType;
+    uint8_t  bAssocTerminal;
+    uint8_t  bSourceID;
+    uint8_t  iTerminal;
+}audio_output_terminal_descriptor_t;
+
+/// Audio Streaming General Descriptor
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint8_t  bTerminalLink;
+    uint8_t  bDelay;
+    uint16_t wFormatTag;
+}audio_as_general_descriptor_t;
+
+/// Type I Format Descriptor, one discrete sample rate.
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint8_t  bFormatType;
+    uint8_t  bNrChannels;
+    uint8_t  bSubframeSize;
+    uint8_t  bBitResolution;
+    uint8_t  bSamFreqType;
+    uint8_t  tSamFreq[3];
+}audio_format_type_i_descriptor_t;
+
+/// Standard Audio Endpoint Descriptor, ch9's with bRefresh and bSynchAddress added.
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bEndpointAddress;
+    uint8_t  bmAttributes;
+    uint16_t wMaxPacketSize;
+    uint8_t  bInterval;
+    uint8_t  bRefresh;
+    uint8_t  bSynchAddress;
+}audio_endpoint_descriptor_t;
+
+/// Class-Specific Audio Streaming Endpoint Descriptor
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint8_t  bmAttributes;
+    uint8_t  bLockDelayUnits;
+    uint16_t wLockDelay;
+}audio_cs_endpoint_descriptor_t;
+
+/// Audio Control interface and its class-specific descriptors.
+typedef struct
+{
+    audio_ac_header_descriptor_t       header;
+    audio_input_terminal_descriptor_t  input_terminal;
+    audio_feature_unit_descriptor_t    feature_unit;
+    audio_output_terminal_descriptor_t output_terminal;
+}audio_ac_descriptors_t;
+
+/// Audio function, the Audio Control interface and both Audio Streaming alternate settings.
+typedef struct
+{
+    ch9_standard_interface_descriptor_t ac_interface;
+    audio_ac_descriptors_t              ac;
+    ch9_standard_interface_descriptor_t as_interface_alt0;
+    ch9_standard_interface_descriptor_t as_interface_alt1;
+    audio_as_general_descriptor_t       as_general;
+    audio_format_type_i_descriptor_t    format;
+    audio_endpoint_descriptor_t         ep_in;
+    audio_cs_endpoint_descriptor_t      cs_ep_in;
+}audio_function_descriptors_t;
+
+#if AUDIO_CHANNELS == 1
+#define AUDIO_CHANNEL_CONFIG 0x0000 // Mono, no spatial location.
+#define AUDIO_FU_CONTROLS    AUDIO_MUTE_CONTROL, 0
+#else
+#define AUDIO_CHANNEL_CONFIG 0x0003 // Left Front, Right Front.
+#define AUDIO_FU_CONTROLS    AUDIO_MUTE_CONTROL, 0, 0
+#endif
+
+#define AUDIO_FUNCTION_DESCRIPTORS() \
+{ \
+    CH9_INTERFACE_DESCRIPTOR(AUDIO_AC_INT, 0, 0, AUDIO_CLASS, AUDIO_SUBCLASS_CONTROL, 0), \
+    { \
+        {sizeof(audio_ac_header_descriptor_t), AUDIO_CS_INTERFACE, AUDIO_HEADER, 0x0100, sizeof(audio_ac_descriptors_t), 1, AUDIO_AS_INT}, \
+        {sizeof(audio_input_terminal_descriptor_t), AUDIO_CS_INTERFACE, AUDIO_INPUT_TERMINAL, AUDIO_INPUT_TERMINAL_ID, \
+            AUDIO_TERMINAL_MICROPHONE, 0, AUDIO_CHANNELS, AUDIO_CHANNEL_CONFIG, 0, 0}, \
+        {sizeof(audio_feature_unit_descriptor_t), AUDIO_CS_INTERFACE, AUDIO_FEATURE_UNIT, AUDIO_FEATURE_UNIT_ID, \
+            AUDIO_INPUT_TERMINAL_ID, 1, {AUDIO_FU_CONTROLS}, 0}, \
+        {sizeof(audio_output_terminal_descriptor_t), AUDIO_CS_INTERFACE, AUDIO_OUTPUT_TERMINAL, AUDIO_OUTPUT_TERMINAL_ID, \
+            AUDIO_TERMINAL_USB_STREAMING, 0, AUDIO_FEATURE_UNIT_ID, 0} \
+    }, \
+    CH9_INTERFACE_DESCRIPTOR(AUDIO_AS_INT, 0, 0, AUDIO_CLASS, AUDIO_SUBCLASS_STREAMING, 0), \
+    CH9_INTERFACE_DESCRIPTOR(AUDIO_AS_INT, 1, 1, AUDIO_CLASS, AUDIO_SUBCLASS_STREAMING, 0), \
+    {sizeof(audio_as_general_descriptor_t), AUDIO_CS_INTERFACE, AUDIO_AS_GENERAL, AUDIO_OUTPUT_TERMINAL_ID, 1, AUDIO_FORMAT_PCM}, \
+    {sizeof(audio_format_type_i_descriptor_t), AUDIO_CS_INTERFACE, AUDIO_FORMAT_TYPE, AUDIO_FORMAT_TYPE_I, AUDIO_CHANNELS, \
+        AUDIO_SUBFRAME_SIZE, 16, 1, {(uint8_t)AUDIO_SAMPLE_RATE, (uint8_t)(AUDIO_SAMPLE_RATE >> 8), (uint8_t)(AUDIO_SAMPLE_RATE >> 16)}}, \
+    {sizeof(audio_endpoint_descriptor_t), ENDPOINT_DESC, EP_IN_ADDR(AUDIO_EP), EP_ISOCHRONOUS | EP_ASYNCHRONOUS, AUDIO_EP_SIZE, 1, 0, 0}, \
+    {sizeof(audio_cs_endpoint_descriptor_t), AUDIO_CS_ENDPOINT, AUDIO_EP_GENERAL, 0, 0, 0} \
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ VARS FROM: usb_audio.c ************************** */
+/* ************************************************************************** */
+
+extern uint8_t g_audio_ep_in_even[AUDIO_EP_SIZE] __at(AUDIO_EP_IN_EVEN_BUFFER_BASE_ADDR);
+extern uint8_t g_audio_ep_in_odd[AUDIO_EP_SIZE]  __at(AUDIO_EP_IN_ODD_BUFFER_BASE_ADDR);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** AUDIO FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void audio_init(void)
+ * 
+ * @brief Used to initialize the Audio library, the stream starts stopped 
+ * (alternate setting 0).
+ */
+void audio_init(void);
+
+/**
+ * @fn bool audio_class_request(void)
+ * 
+ * @brief Services the Feature Unit's Mute SET_CUR and GET_CUR requests.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+bool audio_class_request(void);
+
+/**
+ * @fn bool audio_set_interface(uint8_t alternate_setting, uint8_t interface)
+ * 
+ * @brief Services SET_INTERFACE for the Audio interfaces, alternate setting 1 
+ * of the Audio Streaming interface starts the stream and 0 stops it.
+ * 
+ * @param alternate_setting Alternate Setting to change to.
+ * @param interface Interface the request is directed at.
+ * @return Returns true if successful and false if unsuccessful.
+ */
+bool audio_set_interface(uint8_t alternate_setting, uint8_t interface);
+
+/**
+ * @fn bool audio_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+ * 
+ * @brief Services GET_INTERFACE for the Audio interfaces.
+ * 
+ * @param alternate_setting_result Alternate Setting return.
+ * @param interface Interface the request is directed at.
+ * @return Returns true if successful and false if unsuccessful.
+ */
+bool audio_get_interface(uint8_t* alternate_setting_result, uint8_t interface);
+
+/**
+ * @fn void audio_sof(void)
+ * 
+ * @brief Arms the packet filled during the last frame and starts filling the 
+ * other buffer, call it from usb_sof().
+ */
+void audio_sof(void);
+
+/**
+ * @fn void audio_put_sample(int16_t sample)
+ * 
+ * @brief Writes one sample (one channel) into the packet being filled.
+ * 
+ * Call it from the same interrupt as usb_tasks(), or with the USB interrupt 
+ * disabled, at AUDIO_SAMPLE_RATE per channel. Samples are dropped while the 
+ * stream is stopped or the packet is full, and written as 0 while muted.
+ * 
+ * @param[in] sample Signed 16 bit sample.
+ */
+void audio_put_sample(int16_t sample);
+
+/**
+ * @fn bool audio_streaming(void)
+ * 
+ * @brief Returns true while the host has the stream open (alternate setting 1).
+ */
+bool audio_streaming(void);
+
+/* ************************************************************************** */
+
+#endif /* USB_AUDIO_H */
@@ -34,6 +34,7 @@
 #include "usb_config.h"
 #include "usb_cdc_config.h"
 #include "usb_hal.h"
+#include "usb.h"
 
 /* ************************************************************************** */
 /* ******************** SET LINE CODING SETTING DEFINES ********************* */
@@ -65,12 +66,18 @@
 /* ************************** WARNING FOR PIC14 ***************************** */
 /* ************************************************************************** */
 
-#if PINGPONG_MODE == PINGPONG_DIS
-#define CDC_EP_BUFFERS_STARTING_ADDR (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE*2))
-#elif PINGPONG_MODE == PINGPONG_0_OUT
-#define CDC_EP_BUFFERS_STARTING_ADDR  (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE*3))
-#else
-#error "No point to pingpong buffering CDC's DATA EP. As transfer length is not known beforhand, there's no advantage. PINGPONG_0_OUT is recommended."
+#if (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP) && defined(_PIC14E)
+#error "There isn't enough USB RAM to pingpong buffer CDC's DATA EP on PIC16 devices. PINGPONG_0_OUT is recommended."
+#elif (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP) && !defined(USE_CDC_RINGS) && !defined(USE_CDC_PORTS) && !defined(USE_CDC_NCM) && !defined(USE_CDC_ECM)
+#error "Pingpong buffering CDC's DATA EP needs USE_CDC_RINGS, so both buffers can be kept armed. Otherwise PINGPONG_0_OUT is recommended."
+#endif
+
+#if defined(USE_CDC_RINGS) && ((CDC_RX_RING_SIZE & (CDC_RX_RING_SIZE - 1)) || (CDC_TX_RING_SIZE & (CDC_TX_RING_SIZE - 1)) || \
+    (CDC_RX_RING_SIZE < CDC_DAT_EP_SIZE) || (CDC_TX_RING_SIZE < CDC_DAT_EP_SIZE) || (CDC_RX_RING_SIZE > 128) || (CDC_TX_RING_SIZE > 128))
+#error "CDC_RX_RING_SIZE and CDC_TX_RING_SIZE must be a power of 2, from CDC_DAT_EP_SIZE to 128."
+#endif
+#if defined(USE_CDC_RINGS) && defined(USE_SOF) && (CDC_TX_FLUSH_FRAMES < 1)
+#error "CDC_TX_FLUSH_FRAMES must be 1 or more."
 #endif
 
 
@@ -78,14 +85,28 @@
 /* ************************** CDC EP ADDRESSES ****************************** */
 /* ************************************************************************** */
 
-#ifdef _PIC14E
+#if defined(_PIC14E) && (EP0_SIZE == 64) // Packed to leave room for the EP0 buffers.
+#define CDC_COM_EP_IN_BUFFER_BASE_ADDR  0x2050
+#define CDC_DAT_EP_OUT_BUFFER_BASE_ADDR (0x2050 + CDC_COM_EP_SIZE)
+#define CDC_DAT_EP_IN_BUFFER_BASE_ADDR  (0x2050 + CDC_COM_EP_SIZE + CDC_DAT_EP_SIZE)
+#elif defined(_PIC14E)
 #define CDC_COM_EP_IN_BUFFER_BASE_ADDR  0x2050
 #define CDC_DAT_EP_OUT_BUFFER_BASE_ADDR 0x20A0
 #define CDC_DAT_EP_IN_BUFFER_BASE_ADDR  0x20F0
-#else
-#define CDC_COM_EP_IN_BUFFER_BASE_ADDR   CDC_EP_BUFFERS_STARTING_ADDR
-#define CDC_DAT_EP_OUT_BUFFER_BASE_ADDR (CDC_EP_BUFFERS_STARTING_ADDR + CDC_COM_EP_SIZE)
-#define CDC_DAT_EP_IN_BUFFER_BASE_ADDR  (CDC_EP_BUFFERS_STARTING_ADDR + CDC_COM_EP_SIZE + CDC_DAT_EP_SIZE)
+#elif PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
+#define CDC_COM_EP_IN_BUFFER_BASE_ADDR  EP_IN_BUFFER_ADDR(CDC_COM_EP)
+#define CDC_DAT_EP_OUT_BUFFER_BASE_ADDR EP_OUT_BUFFER_ADDR(CDC_DAT_EP)
+#define CDC_DAT_EP_IN_BUFFER_BASE_ADDR  EP_IN_BUFFER_ADDR(CDC_DAT_EP)
+#else // PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+#define CDC_COM_EP_IN_BUFFER_BASE_ADDR       EP_IN_EVEN_BUFFER_ADDR(CDC_COM_EP) // Shared by both COM BDs.
+#define CDC_DAT_EP_OUT_EVEN_BUFFER_BASE_ADDR EP_OUT_EVEN_BUFFER_ADDR(CDC_DAT_EP)
+#define CDC_DAT_EP_OUT_ODD_BUFFER_BASE_ADDR  EP_OUT_ODD_BUFFER_ADDR(CDC_DAT_EP)
+#define CDC_DAT_EP_IN_EVEN_BUFFER_BASE_ADDR  EP_IN_EVEN_BUFFER_ADDR(CDC_DAT_EP)
+#define CDC_DAT_EP_IN_ODD_BUFFER_BASE_ADDR   EP_IN_ODD_BUFFER_ADDR(CDC_DAT_EP)
+#endif
+
+#if defined(_PIC14E) && ((CDC_DAT_EP_IN_BUFFER_BASE_ADDR + CDC_DAT_EP_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "CDC's EP buffers overlap the EP0 buffers, reduce EP0_SIZE."
 #endif
 
 /* ************************************************************************** */
@@ -98,6 +119,7 @@
 #define CDC_COM_EP_IN_DATA_TOGGLE_VAL  g_usb_ep_stat[CDC_COM_EP][IN].Data_Toggle_Val
 #define CDC_DAT_EP_OUT_DATA_TOGGLE_VAL g_usb_ep_stat[CDC_DAT_EP][OUT].Data_Toggle_Val
 #define CDC_DAT_EP_IN_DATA_TOGGLE_VAL  g_usb_ep_stat[CDC_DAT_EP][IN].Data_Toggle_Val
+#define CDC_COM_EP_IN_LAST_PPB         g_usb_ep_stat[CDC_COM_EP][IN].Last_PPB
 
 /* ************************************************************************** */
 
@@ -120,6 +142,7 @@
 #define CIC_CAPI_CM  0x05
 #define CIC_ENCM     0x06
 #define CIC_ATM_NCM  0x07
+#define CIC_NCM      0x0D
 
 // Communication Interface Class Control Protocol Codes
 #define CIC_V25TER 0x01
@@ -130,6 +153,7 @@
 
 // Data Interface Class Protocol Codes
 #define DIC_NONE        0x00
+#define DIC_NCM_NTB     0x01
 #define DIC_I430        0x30
 #define DIC_HDLC        0x31
 #define DIC_TRANSPARENT 0x32
@@ -173,6 +197,7 @@
 #define DESC_SUB_CAPI_CM 0x0E
 #define DESC_SUB_EN      0x0F
 #define DESC_SUB_ATM_N   0x10
+#define DESC_SUB_NCM     0x1A
 
 /* ************************************************************************** */
 
@@ -217,6 +242,17 @@
 #define GET_ATM_DEVICE_STATISTIC   0x51
 #define SET_ATM_DEFAULT_VC         0x52
 #define GET_ATM_VC_STATISTICS      0x53
+#define GET_NTB_PARAMETERS         0x80
+#define GET_NET_ADDRESS            0x81
+#define SET_NET_ADDRESS            0x82
+#define GET_NTB_FORMAT             0x83
+#define SET_NTB_FORMAT             0x84
+#define GET_NTB_INPUT_SIZE         0x85
+#define SET_NTB_INPUT_SIZE         0x86
+#define GET_MAX_DATAGRAM_SIZE      0x87
+#define SET_MAX_DATAGRAM_SIZE      0x88
+#define GET_CRC_MODE               0x89
+#define SET_CRC_MODE               0x8A
 
 /* ************************************************************************** */
 
@@ -422,6 +458,76 @@ typedef struct
     uint16_t wMaxVC;
 }cdc_atm_networking_functional_descriptor_t;
 
+// NCM Functional Descriptor
+typedef struct
+{
+    uint8_t  bFunctionLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubtype;
+    uint16_t bcdNcmVersion;
+    uint8_t  bmNetworkCapabilities;
+}cdc_ncm_functional_descriptor_t;
+
+// NCM GET_NTB_PARAMETERS Return
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t bmNtbFormatsSupported;
+    uint32_t dwNtbInMaxSize;
+    uint16_t wNdpInDivisor;
+    uint16_t wNdpInPayloadRemainder;
+    uint16_t wNdpInAlignment;
+    uint16_t wReserved;
+    uint32_t dwNtbOutMaxSize;
+    uint16_t wNdpOutDivisor;
+    uint16_t wNdpOutPayloadRemainder;
+    uint16_t wNdpOutAlignment;
+    uint16_t wNtbOutMaxDatagrams;
+}cdc_ncm_ntb_parameters_t;
+
+// NCM 16 bit Transfer Header (NTH16)
+#define NCM_NTH16_SIGNATURE 0x484D434EUL // "NCMH"
+typedef struct
+{
+    uint32_t dwSignature;
+    uint16_t wHeaderLength;
+    uint16_t wSequence;
+    uint16_t wBlockLength;
+    uint16_t wNdpIndex;
+}cdc_ncm_nth16_t;
+
+// NCM 16 bit Datagram Pointer Table (NDP16), followed by wDatagramIndex/wDatagramLength pairs
+#define NCM_NDP16_SIGNATURE 0x304D434EUL // "NCM0", no CRC
+typedef struct
+{
+    uint32_t dwSignature;
+    uint16_t wLength;
+    uint16_t wNextNdpIndex;
+}cdc_ncm_ndp16_t;
+
+typedef struct
+{
+    uint16_t wDatagramIndex;
+    uint16_t wDatagramLength;
+}cdc_ncm_dpe16_t;
+
+// NETWORK_CONNECTION and CONNECTION_SPEED_CHANGE Notifications
+typedef struct
+{
+    uint8_t  bmRequestType;
+    uint8_t  bNotification;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+}cdc_notification_header_t;
+
+typedef struct
+{
+    cdc_notification_header_t header;
+    uint32_t DLBitRate;
+    uint32_t ULBitRate;
+}cdc_speed_change_notification_t;
+
 typedef struct
 {
     uint32_t dwDTERate;
@@ -489,14 +595,76 @@ typedef union
 /* ************************************************************************** */
 
 
+/* ************************************************************************** */
+/* ************************ CDC FUNCTION DESCRIPTORS ************************ */
+/* ************************************************************************** */
+
+/// ACM Function Descriptors, from the IAD to the DATA Interface Endpoints.
+typedef struct
+{
+    ch9_interface_association_descriptor_t iad;
+    ch9_standard_interface_descriptor_t    com_interface;
+    cdc_header_functional_descriptor_t     header;
+    cdc_acm_functional_descriptor_t        acm;
+    cdc_union_functional_descriptor_t      cdc_union;
+    cdc_cm_functional_descriptor_t         cm;
+    ch9_standard_endpoint_descriptor_t     com_ep_in;
+    ch9_standard_interface_descriptor_t    dat_interface;
+    ch9_standard_endpoint_descriptor_t     dat_ep_out;
+    ch9_standard_endpoint_descriptor_t     dat_ep_in;
+}cdc_function_descriptors_t;
+
+/*
+ * Initializer for cdc_function_descriptors_t, see the DESCRIPTOR BUILDER in 
+ * usb_ch9.h. Uses interfaces CDC_COM_INT and CDC_COM_INT + 1, and the 
+ * Endpoints from usb_cdc_config.h. com_interval is the COM EP's bInterval.
+ */
+#define CDC_FUNCTION_DESCRIPTORS(com_interval) \
+{ \
+    CH9_INTERFACE_ASSOCIATION_DESCRIPTOR(CDC_COM_INT, 2, CIC_CODE, CIC_ACM, CIC_V25TER), \
+    CH9_INTERFACE_DESCRIPTOR(CDC_COM_INT, 0, 1, CIC_CODE, CIC_ACM, CIC_V25TER), \
+    {5, CS_INTERFACE, DESC_SUB_HEADER, 0x0110}, \
+    {4, CS_INTERFACE, DESC_SUB_ACM, 0x02}, \
+    {5, CS_INTERFACE, DESC_SUB_UNION, CDC_COM_INT, {CDC_COM_INT + 1}}, \
+    {5, CS_INTERFACE, DESC_SUB_CM, 0x00, CDC_COM_INT + 1}, \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(CDC_COM_EP), EP_INTERRUPT, CDC_COM_EP_SIZE, (com_interval)), \
+    CH9_INTERFACE_DESCRIPTOR(CDC_COM_INT + 1, 0, 2, DIC_CODE, 0x00, DIC_NONE), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_OUT_ADDR(CDC_DAT_EP), EP_BULK, CDC_DAT_EP_SIZE, 0), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(CDC_DAT_EP), EP_BULK, CDC_DAT_EP_SIZE, 0) \
+}
+
+/* ************************************************************************** */
+
+
 /* ************************************************************************** */
 /* ******************** VARIABLES FROM: usb_cdc_acm.c *********************** */
 /* ************************************************************************** */
 
 // Glabal Variables To Share From usb_cdc_acm.c
+#if defined(USB_SIM)
+#define g_cdc_com_ep_in       USB_SIM_AT_ARRAY(uint8_t, CDC_COM_EP_SIZE, CDC_COM_EP_IN_BUFFER_BASE_ADDR)
+#define g_cdc_dat_ep_out      USB_SIM_AT_ARRAY(uint8_t, CDC_DAT_EP_SIZE, CDC_DAT_EP_OUT_BUFFER_BASE_ADDR)
+#define g_cdc_dat_ep_in       USB_SIM_AT_ARRAY(uint8_t, CDC_DAT_EP_SIZE, CDC_DAT_EP_IN_BUFFER_BASE_ADDR)
+#define g_cdc_dat_ep_out_even USB_SIM_AT_ARRAY(uint8_t, CDC_DAT_EP_SIZE, CDC_DAT_EP_OUT_EVEN_BUFFER_BASE_ADDR)
+#define g_cdc_dat_ep_out_odd  USB_SIM_AT_ARRAY(uint8_t, CDC_DAT_EP_SIZE, CDC_DAT_EP_OUT_ODD_BUFFER_BASE_ADDR)
+#define g_cdc_dat_ep_in_even  USB_SIM_AT_ARRAY(uint8_t, CDC_DAT_EP_SIZE, CDC_DAT_EP_IN_EVEN_BUFFER_BASE_ADDR)
+#define g_cdc_dat_ep_in_odd   USB_SIM_AT_ARRAY(uint8_t, CDC_DAT_EP_SIZE, CDC_DAT_EP_IN_ODD_BUFFER_BASE_ADDR)
+#define g_cdc_set_get_line_coding    USB_SIM_AT(cdc_set_get_line_coding_t, SETUP_DATA_ADDR)
+#define g_cdc_set_control_line_state USB_SIM_AT(cdc_set_control_line_state_t, SETUP_DATA_ADDR)
+#define g_cdc_serial_state           USB_SIM_AT(cdc_serial_state_t, CDC_COM_EP_IN_BUFFER_BASE_ADDR)
+extern cdc_get_line_coding_return_t g_cdc_get_line_coding_return;
+extern cdc_set_line_coding_t        g_cdc_set_line_coding;
+#else
 extern uint8_t g_cdc_com_ep_in[CDC_COM_EP_SIZE]  __at(CDC_COM_EP_IN_BUFFER_BASE_ADDR);
+#if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+extern uint8_t g_cdc_dat_ep_out_even[CDC_DAT_EP_SIZE] __at(CDC_DAT_EP_OUT_EVEN_BUFFER_BASE_ADDR);
+extern uint8_t g_cdc_dat_ep_out_odd[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_OUT_ODD_BUFFER_BASE_ADDR);
+extern uint8_t g_cdc_dat_ep_in_even[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_IN_EVEN_BUFFER_BASE_ADDR);
+extern uint8_t g_cdc_dat_ep_in_odd[CDC_DAT_EP_SIZE]   __at(CDC_DAT_EP_IN_ODD_BUFFER_BASE_ADDR);
+#else
 extern uint8_t g_cdc_dat_ep_out[CDC_DAT_EP_SIZE] __at(CDC_DAT_EP_OUT_BUFFER_BASE_ADDR);
 extern uint8_t g_cdc_dat_ep_in[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_IN_BUFFER_BASE_ADDR);
+#endif
 
 extern cdc_set_get_line_coding_t    g_cdc_set_get_line_coding       __at(SETUP_DATA_ADDR);
 extern cdc_set_control_line_state_t g_cdc_set_control_line_state    __at(SETUP_DATA_ADDR);
@@ -505,6 +673,7 @@ extern cdc_set_line_coding_t        g_cdc_set_line_coding;
 #if defined(USE_DTR)||defined(USE_RTS)
 extern cdc_serial_state_t           g_cdc_serial_state              __at(CDC_COM_EP_IN_BUFFER_BASE_ADDR);
 #endif
+#endif
 
 extern volatile bool    g_cdc_set_line_coding_wait;
 extern volatile uint8_t g_cdc_num_data_out;
@@ -539,11 +708,16 @@ bool cdc_class_request(void);
 void cdc_init(void);
 void cdc_clear_ep_toggle(void);
 bool cdc_out_control_tasks(void);
-void cdc_set_line_coding(void);
+bool cdc_set_line_coding(void);  // false refuses the rate (Status Stage STALLed), GET_LINE_CODING keeps the last one.
 void cdc_set_control_line_state(void);
 void cdc_tasks(void);
+void cdc_com_ep_in_tasks(void);  // Per endpoint handlers of cdc_tasks(), for g_usb_ep_handlers.
+void cdc_dat_ep_out_tasks(void);
+void cdc_dat_ep_in_tasks(void);
+#ifndef USE_CDC_RINGS
 void cdc_data_out(void);
 void cdc_data_in(void);
+#endif
 void cdc_notification(void);
 
 /**
@@ -564,6 +738,99 @@ void cdc_notification(void);
  */
 void cdc_arm_com_ep_in(void);
 
+#ifdef USE_CDC_RINGS
+/**
+ * @fn uint8_t cdc_available(void)
+ * 
+ * @brief Gets the amount of bytes received from the host, waiting in the RX ring.
+ * 
+ * With USE_CDC_RINGS the CDC library owns the DATA Endpoints. Received packets 
+ * are moved into the RX ring, and both OUT buffers are kept armed while the 
+ * ring has room (the host is NAKed otherwise, so no data is lost). 
+ * cdc_data_out() and cdc_data_in() aren't used.
+ * 
+ * @return Returns the amount of bytes in the RX ring.
+ */
+uint8_t cdc_available(void);
+
+/**
+ * @fn uint8_t cdc_read(uint8_t* p_data, uint8_t len)
+ * 
+ * @brief Takes up to len bytes from the RX ring.
+ * 
+ * @param[out] p_data Where to place the data.
+ * @param[in] len Max amount of bytes to take.
+ * 
+ * @return Returns the amount of bytes taken.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t buffer[16];
+ * uint8_t cnt = cdc_read(buffer, sizeof(buffer));
+ * @endcode
+ * </li></ul>
+ */
+uint8_t cdc_read(uint8_t* p_data, uint8_t len);
+
+/**
+ * @fn uint8_t cdc_write(const uint8_t* p_data, uint8_t len)
+ * 
+ * @brief Places up to len bytes in the TX ring.
+ * 
+ * Full packets (CDC_DAT_EP_SIZE) are sent as soon as an IN buffer is free. 
+ * Use cdc_flush() to send what's left over as a short packet.
+ * 
+ * @param[in] p_data Data to send.
+ * @param[in] len Amount of bytes to send.
+ * 
+ * @return Returns the amount of bytes placed in the TX ring, less than len 
+ * if the ring was full.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * cdc_write((const uint8_t*)"Hello\r\n", 7);
+ * cdc_flush();
+ * @endcode
+ * </li></ul>
+ */
+uint8_t cdc_write(const uint8_t* p_data, uint8_t len);
+
+/**
+ * @fn void cdc_flush(void)
+ * 
+ * @brief Sends everything in the TX ring, ending with a short packet.
+ * 
+ * If the last packet was a full one, a Zero Length Packet ends the transfer, 
+ * so the host doesn't wait for more data.
+ */
+void cdc_flush(void);
+
+#ifdef USE_SOF
+/**
+ * @fn void cdc_service_sof(void)
+ * 
+ * @brief Flushes the TX ring once nothing has been written for 
+ * CDC_TX_FLUSH_FRAMES frames.
+ * 
+ * Place in usb_sof(). Bytes written with cdc_write() are then coalesced into 
+ * full packets while data keeps coming, with no need to call cdc_flush().
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * void usb_sof(void)
+ * {
+ *     cdc_service_sof();
+ * }
+ * @endcode
+ * </li></ul>
+ */
+void cdc_service_sof(void);
+#endif
+
+#else
 /**
  * @fn cdc_arm_data_ep_out(void)
  * 
@@ -598,6 +865,7 @@ void cdc_arm_data_ep_out(void);
  * </li></ul>
  */
 void cdc_arm_data_ep_in(uint8_t cnt);
+#endif
 
 /* ************************************************************************** */
 
@@ -35,9 +35,34 @@
 /* **************************** CDC ENDPOINTS ******************************* */
 /* ************************************************************************** */
 
+#ifndef USB_SIM // Placed by usb_cdc.h.
 uint8_t g_cdc_com_ep_in[CDC_COM_EP_SIZE]  __at(CDC_COM_EP_IN_BUFFER_BASE_ADDR);
+#endif
+#if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+#ifndef USB_SIM
+uint8_t g_cdc_dat_ep_out_even[CDC_DAT_EP_SIZE] __at(CDC_DAT_EP_OUT_EVEN_BUFFER_BASE_ADDR);
+uint8_t g_cdc_dat_ep_out_odd[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_OUT_ODD_BUFFER_BASE_ADDR);
+uint8_t g_cdc_dat_ep_in_even[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_IN_EVEN_BUFFER_BASE_ADDR);
+uint8_t g_cdc_dat_ep_in_odd[CDC_DAT_EP_SIZE]   __at(CDC_DAT_EP_IN_ODD_BUFFER_BASE_ADDR);
+#endif
+
+#define CDC_DAT_NUM_BUFFERS      2
+#define CDC_DAT_BD_OUT_PPB(ppb)  (CDC_DAT_BD_OUT_EVEN + (ppb))
+#define CDC_DAT_BD_IN_PPB(ppb)   (CDC_DAT_BD_IN_EVEN + (ppb))
+#define CDC_DAT_EP_OUT_PPB(ppb)  ((ppb) ? g_cdc_dat_ep_out_odd : g_cdc_dat_ep_out_even)
+#define CDC_DAT_EP_IN_PPB(ppb)   ((ppb) ? g_cdc_dat_ep_in_odd : g_cdc_dat_ep_in_even)
+#else
+#ifndef USB_SIM
 uint8_t g_cdc_dat_ep_out[CDC_DAT_EP_SIZE] __at(CDC_DAT_EP_OUT_BUFFER_BASE_ADDR);
 uint8_t g_cdc_dat_ep_in[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_IN_BUFFER_BASE_ADDR);
+#endif
+
+#define CDC_DAT_NUM_BUFFERS      1
+#define CDC_DAT_BD_OUT_PPB(ppb)  CDC_DAT_BD_OUT
+#define CDC_DAT_BD_IN_PPB(ppb)   CDC_DAT_BD_IN
+#define CDC_DAT_EP_OUT_PPB(ppb)  g_cdc_dat_ep_out
+#define CDC_DAT_EP_IN_PPB(ppb)   g_cdc_dat_ep_in
+#endif
 
 /* ************************************************************************** */
 
@@ -46,12 +71,14 @@ uint8_t g_cdc_dat_ep_in[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_IN_BUFFER_BASE_ADDR);
 /* ***************************** GLOBAL VARS ******************************** */
 /* ************************************************************************** */
 
+#ifndef USB_SIM
 cdc_set_get_line_coding_t    g_cdc_set_get_line_coding     __at(SETUP_DATA_ADDR);
 cdc_set_control_line_state_t g_cdc_set_control_line_state  __at(SETUP_DATA_ADDR);
+#endif
 cdc_get_line_coding_return_t g_cdc_get_line_coding_return;
 cdc_set_line_coding_t        g_cdc_set_line_coding;
 
-#if defined(USE_DTR) || defined(USE_RTS)
+#if (defined(USE_DTR) || defined(USE_RTS)) && !defined(USB_SIM)
 cdc_serial_state_t           g_cdc_serial_state            __at(CDC_COM_EP_IN_BUFFER_BASE_ADDR);
 #endif
 
@@ -69,16 +96,154 @@ bool g_cdc_has_set_rts = false;
 /* ************************************************************************** */
 
 
+/* ************************************************************************** */
+/* ***************************** LOCAL VARS ********************************* */
+/* ************************************************************************** */
+
+#ifdef USE_CDC_RINGS
+// Ring indexes are free running, used = head - tail.
+static uint8_t          m_rx_ring[CDC_RX_RING_SIZE];
+static volatile uint8_t m_rx_head;    // Written when a packet is moved in.
+static volatile uint8_t m_rx_tail;    // Written by cdc_read().
+static volatile uint8_t m_rx_pending; // OUT packets received, but not yet moved into m_rx_ring.
+static uint8_t          m_rx_ppb;     // Buffer holding the oldest pending OUT packet.
+
+static uint8_t          m_tx_ring[CDC_TX_RING_SIZE];
+static volatile uint8_t m_tx_head;    // Written by cdc_write().
+static volatile uint8_t m_tx_tail;    // Written when a packet is armed.
+static volatile uint8_t m_tx_armed;   // IN buffers owned by the SIE.
+static uint8_t          m_tx_ppb;     // Next IN buffer to arm.
+static volatile bool    m_tx_flush;   // Send short packets until the TX ring is empty.
+static bool             m_tx_zlp;     // Last packet armed was full, a flush must end with a ZLP.
+#ifdef USE_SOF
+static uint8_t          m_tx_idle_frames;
+#endif
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION DECLARATIONS ********************* */
+/* ************************************************************************** */
+
+#ifdef USE_CDC_RINGS
+/**
+ * @fn void rx_drain(void)
+ * 
+ * @brief Moves pending OUT packets into m_rx_ring, oldest first, and re-arms 
+ * their buffers. Stops when a packet doesn't fit, the host is NAKed until 
+ * cdc_read() makes room.
+ */
+static void rx_drain(void);
+
+/**
+ * @fn void tx_fill(void)
+ * 
+ * @brief Arms any free IN buffers from m_tx_ring. Only full packets are sent 
+ * unless m_tx_flush is set.
+ */
+static void tx_fill(void);
+#endif
+
+/* ************************************************************************** */
+
+
 /* ************************************************************************** */
 /* *************************** CDC FUNCTIONS ******************************** */
 /* ************************************************************************** */
 
 void cdc_arm_com_ep_in(void)
 {
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    usb_arm_endpoint(&g_usb_bd_table[CDC_COM_BD_IN_EVEN + (CDC_COM_EP_IN_LAST_PPB ^ 1)], &g_usb_ep_stat[CDC_COM_EP][IN], 10);
+    #else
     usb_arm_endpoint(&g_usb_bd_table[CDC_COM_BD_IN], &g_usb_ep_stat[CDC_COM_EP][IN], 10);
+    #endif
+}
+
+
+#ifdef USE_CDC_RINGS
+uint8_t cdc_available(void)
+{
+    return (uint8_t)(m_rx_head - m_rx_tail);
+}
+
+
+uint8_t cdc_read(uint8_t* p_data, uint8_t len)
+{
+    uint8_t used = (uint8_t)(m_rx_head - m_rx_tail);
+    
+    if(len > used) len = used;
+    for(uint8_t i = 0; i < len; i++) p_data[i] = m_rx_ring[(uint8_t)(m_rx_tail + i) & (CDC_RX_RING_SIZE - 1)];
+    m_rx_tail += len;
+    
+    if(m_rx_pending)
+    {
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 0;
+        #endif
+        rx_drain();
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 1;
+        #endif
+    }
+    return len;
+}
+
+
+uint8_t cdc_write(const uint8_t* p_data, uint8_t len)
+{
+    uint8_t space = CDC_TX_RING_SIZE - (uint8_t)(m_tx_head - m_tx_tail);
+    
+    if(len > space) len = space;
+    for(uint8_t i = 0; i < len; i++) m_tx_ring[(uint8_t)(m_tx_head + i) & (CDC_TX_RING_SIZE - 1)] = p_data[i];
+    m_tx_head += len;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    #ifdef USE_SOF
+    m_tx_idle_frames = 0;
+    #endif
+    tx_fill();
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    return len;
+}
+
+
+void cdc_flush(void)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    m_tx_flush = true;
+    tx_fill();
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+
+#ifdef USE_SOF
+void cdc_service_sof(void)
+{
+    if(usb_get_state() != STATE_CONFIGURED || m_tx_flush) return;
+    if((m_tx_head == m_tx_tail) && !m_tx_zlp) return;
+    
+    if(++m_tx_idle_frames >= CDC_TX_FLUSH_FRAMES)
+    {
+        m_tx_idle_frames = 0;
+        m_tx_flush = true;
+        tx_fill();
+    }
 }
+#endif
 
 
+#else
 void cdc_arm_data_ep_out(void)
 {
     usb_arm_endpoint(&g_usb_bd_table[CDC_DAT_BD_OUT], &g_usb_ep_stat[CDC_DAT_EP][OUT], CDC_DAT_EP_SIZE);
@@ -89,6 +254,7 @@ void cdc_arm_data_ep_in(uint8_t cnt)
 {
     usb_arm_endpoint(&g_usb_bd_table[CDC_DAT_BD_IN], &g_usb_ep_stat[CDC_DAT_EP][IN], cnt);
 }
+#endif
 
 bool cdc_class_request(void)
 {
@@ -101,8 +267,7 @@ bool cdc_class_request(void)
         case GET_LINE_CODING:
             usb_set_ram_ptr((uint8_t*)&g_cdc_get_line_coding_return);
             usb_setup_in_control_transfer(RAM, 7, g_cdc_set_get_line_coding.Size_of_Structure);
-            usb_in_control_transfer();
-            usb_set_control_stage(DATA_IN_STAGE);
+            usb_start_in_control_transfer();
             return true;
         #endif
         #ifdef USE_SET_LINE_CODING
@@ -130,8 +295,7 @@ bool cdc_class_request(void)
         case GET_ENCAPSULATED_RESPONSE:
             usb_set_ram_ptr(dummy_buffer);
             usb_setup_in_control_transfer(RAM, 8, g_usb_setup.wLength);
-            usb_in_control_transfer();
-            usb_set_control_stage(DATA_IN_STAGE);
+            usb_start_in_control_transfer();
             return true;
         default:
             return false;
@@ -176,12 +340,27 @@ void cdc_init(void)
     #endif
 
     // BD settings
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    g_usb_bd_table[CDC_COM_BD_IN_EVEN].STAT  = 0;
+    g_usb_bd_table[CDC_COM_BD_IN_EVEN].ADR   = CDC_COM_EP_IN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_COM_BD_IN_ODD].STAT   = 0;
+    g_usb_bd_table[CDC_COM_BD_IN_ODD].ADR    = CDC_COM_EP_IN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_OUT_EVEN].STAT = 0;
+    g_usb_bd_table[CDC_DAT_BD_OUT_EVEN].ADR  = CDC_DAT_EP_OUT_EVEN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_OUT_ODD].STAT  = 0;
+    g_usb_bd_table[CDC_DAT_BD_OUT_ODD].ADR   = CDC_DAT_EP_OUT_ODD_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_IN_EVEN].STAT  = 0;
+    g_usb_bd_table[CDC_DAT_BD_IN_EVEN].ADR   = CDC_DAT_EP_IN_EVEN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_IN_ODD].STAT   = 0;
+    g_usb_bd_table[CDC_DAT_BD_IN_ODD].ADR    = CDC_DAT_EP_IN_ODD_BUFFER_BASE_ADDR;
+    #else
     g_usb_bd_table[CDC_COM_BD_IN].STAT  = 0;
     g_usb_bd_table[CDC_COM_BD_IN].ADR   = CDC_COM_EP_IN_BUFFER_BASE_ADDR;
     g_usb_bd_table[CDC_DAT_BD_OUT].STAT = 0;
     g_usb_bd_table[CDC_DAT_BD_OUT].ADR  = CDC_DAT_EP_OUT_BUFFER_BASE_ADDR;
     g_usb_bd_table[CDC_DAT_BD_IN].STAT  = 0;
     g_usb_bd_table[CDC_DAT_BD_IN].ADR   = CDC_DAT_EP_IN_BUFFER_BASE_ADDR;
+    #endif
     
     // EP Settings
     CDC_COM_UEPbits.EPHSHK   = 1; // Handshaking enabled 
@@ -195,7 +374,30 @@ void cdc_init(void)
     g_usb_ep_stat[CDC_DAT_EP][OUT].Halt = 0;
     g_usb_ep_stat[CDC_DAT_EP][IN].Halt  = 0;
     cdc_clear_ep_toggle();
+    #ifdef USE_CDC_RINGS
+    m_rx_head    = 0;
+    m_rx_tail    = 0;
+    m_rx_pending = 0;
+    m_rx_ppb     = EVEN;
+    m_tx_head    = 0;
+    m_tx_tail    = 0;
+    m_tx_armed   = 0;
+    m_tx_ppb     = EVEN;
+    m_tx_flush   = false;
+    m_tx_zlp     = false;
+    #ifdef USE_SOF
+    m_tx_idle_frames = 0;
+    #endif
+    
+    // Arm every OUT buffer. The data toggle is flipped every time a buffer is armed, not on completion.
+    for(uint8_t ppb = 0; ppb < CDC_DAT_NUM_BUFFERS; ppb++)
+    {
+        usb_arm_endpoint(&g_usb_bd_table[CDC_DAT_BD_OUT_PPB(ppb)], &g_usb_ep_stat[CDC_DAT_EP][OUT], CDC_DAT_EP_SIZE);
+        USB_NEXT_TOGGLE(CDC_DAT_EP_OUT_DATA_TOGGLE_VAL);
+    }
+    #else
     cdc_arm_data_ep_out();
+    #endif
     
     #if defined(USE_DTR) || defined(USE_DCD)
     cdc_arm_com_ep_in();
@@ -215,25 +417,51 @@ void cdc_tasks(void)
     switch(TRANSACTION_EP)
     {
         case CDC_COM_EP:
-            CDC_COM_EP_IN_DATA_TOGGLE_VAL ^= 1;
-            cdc_notification();
+            cdc_com_ep_in_tasks();
             break;
         case CDC_DAT_EP:
-            if(TRANSACTION_DIR == OUT)
-            {
-                CDC_DAT_EP_OUT_DATA_TOGGLE_VAL ^= 1;
-                g_cdc_num_data_out = g_usb_bd_table[CDC_DAT_BD_OUT].CNT;
-                cdc_data_out();
-            }
-            else
-            {
-                CDC_DAT_EP_IN_DATA_TOGGLE_VAL ^= 1;
-                cdc_data_in();
-            }
+            if(TRANSACTION_DIR == OUT) cdc_dat_ep_out_tasks();
+            else cdc_dat_ep_in_tasks();
             break;
     }
 }
 
+void cdc_com_ep_in_tasks(void)
+{
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    CDC_COM_EP_IN_LAST_PPB = PINGPONG_PARITY;
+    #endif
+    USB_NEXT_TOGGLE(CDC_COM_EP_IN_DATA_TOGGLE_VAL);
+    cdc_notification();
+}
+
+#ifdef USE_CDC_RINGS
+void cdc_dat_ep_out_tasks(void)
+{
+    m_rx_pending++;
+    rx_drain();
+}
+
+void cdc_dat_ep_in_tasks(void)
+{
+    m_tx_armed--;
+    tx_fill();
+}
+#else
+void cdc_dat_ep_out_tasks(void)
+{
+    USB_NEXT_TOGGLE(CDC_DAT_EP_OUT_DATA_TOGGLE_VAL);
+    g_cdc_num_data_out = g_usb_bd_table[CDC_DAT_BD_OUT].CNT;
+    cdc_data_out();
+}
+
+void cdc_dat_ep_in_tasks(void)
+{
+    USB_NEXT_TOGGLE(CDC_DAT_EP_IN_DATA_TOGGLE_VAL);
+    cdc_data_in();
+}
+#endif
+
 bool cdc_out_control_tasks(void)
 {
     #ifdef USE_SET_LINE_CODING
@@ -243,13 +471,12 @@ bool cdc_out_control_tasks(void)
         if((g_cdc_set_line_coding.bCharFormat != 0)
             || (g_cdc_set_line_coding.bParityType != 0)
             || (g_cdc_set_line_coding.bDataBits   != 8)) return false;
+        if(!cdc_set_line_coding()) return false;
         
         g_cdc_get_line_coding_return.dwDTERate   = g_cdc_set_line_coding.dwDTERate;
         g_cdc_get_line_coding_return.bCharFormat = g_cdc_set_line_coding.bCharFormat;
         g_cdc_get_line_coding_return.bParityType = g_cdc_set_line_coding.bParityType;
         g_cdc_get_line_coding_return.bDataBits   = g_cdc_set_line_coding.bDataBits;
-        
-        cdc_set_line_coding();
         return true;
     }
     #endif
@@ -268,4 +495,70 @@ void cdc_notification_tasks(void)
 }
 #endif
 
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** LOCAL FUNCTIONS ******************************* */
+/* ************************************************************************** */
+
+#ifdef USE_CDC_RINGS
+static void rx_drain(void)
+{
+    uint8_t  cnt;
+    uint8_t* p_ep;
+    
+    while(m_rx_pending)
+    {
+        cnt = g_usb_bd_table[CDC_DAT_BD_OUT_PPB(m_rx_ppb)].CNT;
+        if((uint8_t)(CDC_RX_RING_SIZE - (uint8_t)(m_rx_head - m_rx_tail)) < cnt) return;
+        
+        p_ep = CDC_DAT_EP_OUT_PPB(m_rx_ppb);
+        for(uint8_t i = 0; i < cnt; i++) m_rx_ring[(uint8_t)(m_rx_head + i) & (CDC_RX_RING_SIZE - 1)] = p_ep[i];
+        m_rx_head += cnt;
+        
+        usb_arm_endpoint(&g_usb_bd_table[CDC_DAT_BD_OUT_PPB(m_rx_ppb)], &g_usb_ep_stat[CDC_DAT_EP][OUT], CDC_DAT_EP_SIZE);
+        USB_NEXT_TOGGLE(CDC_DAT_EP_OUT_DATA_TOGGLE_VAL);
+        #if CDC_DAT_NUM_BUFFERS == 2
+        m_rx_ppb ^= 1;
+        #endif
+        m_rx_pending--;
+    }
+}
+
+static void tx_fill(void)
+{
+    uint8_t  cnt;
+    uint8_t* p_ep;
+    
+    while(m_tx_armed < CDC_DAT_NUM_BUFFERS)
+    {
+        cnt = (uint8_t)(m_tx_head - m_tx_tail);
+        if(cnt == 0)
+        {
+            if(!m_tx_flush || !m_tx_zlp)
+            {
+                m_tx_flush = false;
+                return;
+            }
+            // Transfer ended on a full packet, send a ZLP.
+        }
+        else if(cnt > CDC_DAT_EP_SIZE) cnt = CDC_DAT_EP_SIZE;
+        else if(cnt < CDC_DAT_EP_SIZE && !m_tx_flush) return; // Wait for a full packet or cdc_flush().
+        
+        p_ep = CDC_DAT_EP_IN_PPB(m_tx_ppb);
+        for(uint8_t i = 0; i < cnt; i++) p_ep[i] = m_tx_ring[(uint8_t)(m_tx_tail + i) & (CDC_TX_RING_SIZE - 1)];
+        m_tx_tail += cnt;
+        m_tx_zlp   = (cnt == CDC_DAT_EP_SIZE);
+        
+        usb_arm_endpoint(&g_usb_bd_table[CDC_DAT_BD_IN_PPB(m_tx_ppb)], &g_usb_ep_stat[CDC_DAT_EP][IN], cnt);
+        USB_NEXT_TOGGLE(CDC_DAT_EP_IN_DATA_TOGGLE_VAL);
+        #if CDC_DAT_NUM_BUFFERS == 2
+        m_tx_ppb ^= 1;
+        #endif
+        m_tx_armed++;
+    }
+}
+#endif
+
 /* ************************************************************************** */
\ No newline at end of file
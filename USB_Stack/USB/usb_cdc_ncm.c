@@ -0,0 +1,736 @@
+/**
+ * @file usb_cdc_ncm.c
+ * @brief <i>Communications Device Class</i> NCM/ECM network function.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - CDC Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_cdc_ncm.h"
+#include "usb_hal.h"
+#include "usb_ch9.h"
+
+/* ************************************************************************** */
+/* **************************** CDC ENDPOINTS ******************************* */
+/* ************************************************************************** */
+
+uint8_t g_cdc_com_ep_in[CDC_COM_EP_SIZE]       __at(CDC_COM_EP_IN_BUFFER_BASE_ADDR);
+uint8_t g_cdc_dat_ep_out_even[CDC_DAT_EP_SIZE] __at(CDC_DAT_EP_OUT_EVEN_BUFFER_BASE_ADDR);
+uint8_t g_cdc_dat_ep_out_odd[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_OUT_ODD_BUFFER_BASE_ADDR);
+uint8_t g_cdc_dat_ep_in_even[CDC_DAT_EP_SIZE]  __at(CDC_DAT_EP_IN_EVEN_BUFFER_BASE_ADDR);
+uint8_t g_cdc_dat_ep_in_odd[CDC_DAT_EP_SIZE]   __at(CDC_DAT_EP_IN_ODD_BUFFER_BASE_ADDR);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** GLOBAL VARS ******************************** */
+/* ************************************************************************** */
+
+uint8_t g_cdc_net_rx_buffer[CDC_NET_RX_SIZE];
+uint8_t g_cdc_net_tx_buffer[CDC_NET_TX_SIZE];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL DEFINES ******************************* */
+/* ************************************************************************** */
+
+#define RESTART_OUT 0x01
+#define RESTART_IN  0x02
+#define RESTART_COM 0x04
+
+#define NOTIFY_SPEED   0x01
+#define NOTIFY_CONNECT 0x02
+
+#define NCM_ALIGN(index) (((index) + (NCM_ALIGNMENT - 1)) & ~(uint16_t)(NCM_ALIGNMENT - 1))
+
+#ifdef USE_CDC_NCM
+#define TX_EMPTY_LEN sizeof(cdc_ncm_nth16_t) // Datagrams follow the NTH16.
+#else
+#define TX_EMPTY_LEN 0
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+static volatile uint8_t m_alt;     // DATA interface's Alternate Setting.
+static volatile uint8_t m_restart; // Pipes the main loop resets next, set from usb_tasks().
+static volatile uint8_t m_notify;  // Notifications waiting to be sent.
+
+static uint8_t  m_out_ppb;     // Next OUT buffer to gather.
+static uint8_t  m_in_ppb;      // Next IN buffer to fill.
+static uint8_t  m_com_ppb;     // Next COM buffer to arm.
+
+static uint16_t m_rx_len;      // Bytes gathered into g_cdc_net_rx_buffer.
+static bool     m_rx_overflow; // Transfer didn't fit, dropped at its end.
+static bool     m_rx_ready;    // Transfer complete, frames are handed out.
+
+static uint16_t m_tx_len;      // Bytes in g_cdc_net_tx_buffer.
+static uint16_t m_tx_sent;     // Bytes copied into IN packets.
+static bool     m_tx_sending;  // Transfer in progress, no new frames.
+static bool     m_tx_zlp;      // Transfer ends with a Zero Length Packet if the last is full.
+
+#ifdef USE_CDC_NCM
+static uint16_t m_rx_ndp;      // Index of the NDP16 being walked.
+static uint16_t m_rx_ndp_end;  // End of its entries.
+static uint16_t m_rx_next_ndp; // wNextNdpIndex of it.
+static uint16_t m_rx_dpe;      // Index of the current datagram pointer entry.
+
+static uint8_t         m_tx_count;    // Datagrams in the NTB being built.
+static uint16_t        m_tx_index;    // Where the acquired datagram goes.
+static uint16_t        m_tx_sequence; // wSequence of the next NTH16.
+static cdc_ncm_dpe16_t m_tx_dpe[CDC_NET_TX_MAX_DATAGRAMS];
+
+static const cdc_ncm_ntb_parameters_t m_ntb_parameters =
+{
+    sizeof(cdc_ncm_ntb_parameters_t),
+    0x0001,                    // NTB16 only.
+    CDC_NET_TX_SIZE,           // dwNtbInMaxSize
+    NCM_ALIGNMENT,             // wNdpInDivisor
+    0,                         // wNdpInPayloadRemainder
+    NCM_ALIGNMENT,             // wNdpInAlignment
+    0,
+    CDC_NET_RX_SIZE,           // dwNtbOutMaxSize
+    NCM_ALIGNMENT,             // wNdpOutDivisor
+    0,                         // wNdpOutPayloadRemainder
+    NCM_ALIGNMENT,             // wNdpOutAlignment
+    0                          // wNtbOutMaxDatagrams, no limit.
+};
+
+static struct
+{
+    uint32_t dwNtbInMaxSize;
+    uint16_t wNtbInMaxDatagrams;
+    uint16_t wReserved;
+}m_ntb_input_size; // Set by the host with SET_NTB_INPUT_SIZE.
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void arm_out(uint8_t ppb)
+ * 
+ * @brief Arms a DATA OUT buffer, the Data Toggle is moved on straight away as 
+ * both buffers are owned by the SIE at once.
+ * 
+ * @param[in] ppb EVEN or ODD buffer.
+ */
+static void arm_out(uint8_t ppb);
+
+/**
+ * @fn void arm_in(uint8_t ppb, uint8_t cnt)
+ * 
+ * @brief Arms a DATA IN buffer, the Data Toggle is moved on straight away as 
+ * both buffers are owned by the SIE at once.
+ * 
+ * @param[in] ppb EVEN or ODD buffer.
+ * @param[in] cnt Amount of bytes to send.
+ */
+static void arm_in(uint8_t ppb, uint8_t cnt);
+
+/**
+ * @fn void restart(uint8_t pipes)
+ * 
+ * @brief Drops whatever the pipes were doing and starts them again from DATA0. 
+ * The OUT buffers are only armed in alternate setting 1.
+ * 
+ * @param[in] pipes RESTART_OUT, RESTART_IN and/or RESTART_COM.
+ */
+static void restart(uint8_t pipes);
+
+/**
+ * @fn void rx_tasks(void)
+ * 
+ * @brief Gathers received packets into g_cdc_net_rx_buffer until the transfer 
+ * ends, then checks it and hands its frames out.
+ */
+static void rx_tasks(void);
+
+/**
+ * @fn bool rx_check(void)
+ * 
+ * @brief Checks the transfer in g_cdc_net_rx_buffer (its NTH16 and first NDP16 for NCM).
+ * 
+ * @return Returns true if it has frames to hand out.
+ */
+static bool rx_check(void);
+
+/**
+ * @fn bool rx_seek(void)
+ * 
+ * @brief Moves to the next good datagram, the transfer is finished with once 
+ * none are left.
+ * 
+ * @return Returns true if a frame is waiting.
+ */
+static bool rx_seek(void);
+
+#ifdef USE_CDC_NCM
+/**
+ * @fn bool rx_ndp(uint16_t index)
+ * 
+ * @brief Starts walking the NDP16 at index.
+ * 
+ * @param[in] index Index of the NDP16 in g_cdc_net_rx_buffer.
+ * 
+ * @return Returns false if index doesn't point at a good NDP16.
+ */
+static bool rx_ndp(uint16_t index);
+
+/**
+ * @fn uint16_t tx_max(void)
+ * 
+ * @brief Returns the largest NTB that can be sent, the TX buffer or the 
+ * host's input size if that's smaller.
+ */
+static uint16_t tx_max(void);
+#endif
+
+/**
+ * @fn void rx_done(void)
+ * 
+ * @brief Frees g_cdc_net_rx_buffer for the next transfer.
+ */
+static void rx_done(void);
+
+/**
+ * @fn void tx_start(void)
+ * 
+ * @brief Starts sending m_tx_len bytes of g_cdc_net_tx_buffer.
+ */
+static void tx_start(void);
+
+/**
+ * @fn void tx_tasks(void)
+ * 
+ * @brief Copies the transfer being sent into every free IN buffer.
+ */
+static void tx_tasks(void);
+
+/**
+ * @fn void tx_done(void)
+ * 
+ * @brief Frees g_cdc_net_tx_buffer for new frames.
+ */
+static void tx_done(void);
+
+/**
+ * @fn void notification_tasks(void)
+ * 
+ * @brief Sends the next pending notification once the COM Endpoint is idle.
+ */
+static void notification_tasks(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** NET FUNCTIONS ****************************** */
+/* ************************************************************************** */
+
+void cdc_net_init(void)
+{
+    // Both COM BDs share one buffer, a notification is only armed when both are idle.
+    g_usb_bd_table[CDC_COM_BD_IN_EVEN].STAT  = 0;
+    g_usb_bd_table[CDC_COM_BD_IN_EVEN].ADR   = CDC_COM_EP_IN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_COM_BD_IN_ODD].STAT   = 0;
+    g_usb_bd_table[CDC_COM_BD_IN_ODD].ADR    = CDC_COM_EP_IN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_OUT_EVEN].STAT = 0;
+    g_usb_bd_table[CDC_DAT_BD_OUT_EVEN].ADR  = CDC_DAT_EP_OUT_EVEN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_OUT_ODD].STAT  = 0;
+    g_usb_bd_table[CDC_DAT_BD_OUT_ODD].ADR   = CDC_DAT_EP_OUT_ODD_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_IN_EVEN].STAT  = 0;
+    g_usb_bd_table[CDC_DAT_BD_IN_EVEN].ADR   = CDC_DAT_EP_IN_EVEN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[CDC_DAT_BD_IN_ODD].STAT   = 0;
+    g_usb_bd_table[CDC_DAT_BD_IN_ODD].ADR    = CDC_DAT_EP_IN_ODD_BUFFER_BASE_ADDR;
+    
+    // EP Settings
+    CDC_COM_UEPbits.EPHSHK   = 1; // Handshaking enabled 
+    CDC_COM_UEPbits.EPINEN   = 1; // EP input enabled
+    CDC_DAT_UEPbits.EPHSHK   = 1; // Handshaking enabled 
+    CDC_DAT_UEPbits.EPCONDIS = 0; // Don't allow SETUP
+    CDC_DAT_UEPbits.EPOUTEN  = 1; // EP output enabled
+    CDC_DAT_UEPbits.EPINEN   = 1; // EP input enabled
+    
+    g_usb_ep_stat[CDC_COM_EP][IN].Halt  = 0;
+    g_usb_ep_stat[CDC_DAT_EP][OUT].Halt = 0;
+    g_usb_ep_stat[CDC_DAT_EP][IN].Halt  = 0;
+    
+    m_alt = 0;
+    m_notify = 0;
+    #ifdef USE_CDC_NCM
+    m_ntb_input_size.dwNtbInMaxSize = CDC_NET_TX_SIZE;
+    m_ntb_input_size.wNtbInMaxDatagrams = 0;
+    #endif
+    m_restart = RESTART_OUT | RESTART_IN | RESTART_COM;
+}
+
+bool cdc_net_class_request(void)
+{
+    if(g_usb_setup.bmRequestType_bits.Recipient != INTERFACE) return false;
+    if(g_usb_setup.wIndex != CDC_COM_INT) return false;
+    
+    switch(g_usb_setup.bRequest)
+    {
+        case SET_ETHERNET_PACKET_FILTER:
+            // Every frame is handed to the Application, it filters them itself.
+            usb_set_control_stage(STATUS_IN_STAGE);
+            usb_arm_in_status();
+            return true;
+        #ifdef USE_CDC_NCM
+        case GET_NTB_PARAMETERS:
+            usb_set_rom_ptr((const uint8_t*)&m_ntb_parameters);
+            usb_setup_in_control_transfer(ROM, sizeof(cdc_ncm_ntb_parameters_t), g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        case GET_NTB_INPUT_SIZE:
+            usb_set_ram_ptr((uint8_t*)&m_ntb_input_size);
+            usb_setup_in_control_transfer(RAM, 4, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        case SET_NTB_INPUT_SIZE:
+            // dwNtbInMaxSize, then wNtbInMaxDatagrams if the host sends 8 bytes.
+            if(g_usb_setup.wLength != 4 && g_usb_setup.wLength != 8) return false;
+            usb_set_ram_ptr((uint8_t*)&m_ntb_input_size);
+            usb_set_num_out_control_bytes(g_usb_setup.wLength);
+            usb_set_control_stage(DATA_OUT_STAGE);
+            return true;
+        #endif
+        default:
+            return false;
+    }
+}
+
+bool cdc_net_set_interface(uint8_t alternate_setting, uint8_t interface)
+{
+    if(interface == CDC_COM_INT) return alternate_setting == 0;
+    if(interface != (CDC_COM_INT + 1) || alternate_setting > 1) return false;
+    
+    m_alt = alternate_setting;
+    m_restart |= RESTART_OUT | RESTART_IN;
+    m_notify = alternate_setting ? (NOTIFY_SPEED | NOTIFY_CONNECT) : NOTIFY_CONNECT;
+    return true;
+}
+
+bool cdc_net_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+{
+    if(interface == CDC_COM_INT) *alternate_setting_result = 0;
+    else if(interface == (CDC_COM_INT + 1)) *alternate_setting_result = m_alt;
+    else return false;
+    return true;
+}
+
+void cdc_net_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+{
+    g_usb_ep_stat[ep][dir].Halt = 0;
+    if(ep == CDC_COM_EP) m_restart |= RESTART_COM;
+    else if(ep == CDC_DAT_EP) m_restart |= (dir == OUT) ? RESTART_OUT : RESTART_IN;
+}
+
+void cdc_net_ep_tasks(void)
+{
+    // Only completed transactions move the SIE on, kept for restart().
+    g_usb_ep_stat[TRANSACTION_EP][TRANSACTION_DIR].Last_PPB = PINGPONG_PARITY;
+}
+
+void cdc_net_tasks(void)
+{
+    uint8_t pipes;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    pipes = m_restart;
+    m_restart = 0;
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    if(pipes) restart(pipes);
+    
+    notification_tasks();
+    if(m_alt == 0) return;
+    
+    if(m_rx_ready) rx_seek();
+    rx_tasks();
+    #ifdef USE_CDC_NCM
+    // Replies to a batch of received frames go out in one NTB.
+    if(!m_rx_ready && m_tx_count) cdc_net_tx_flush();
+    #endif
+    tx_tasks();
+}
+
+bool cdc_net_connected(void)
+{
+    return m_alt != 0;
+}
+
+uint8_t* cdc_net_rx_frame(uint16_t* p_len)
+{
+    if(!m_rx_ready || !rx_seek()) return NULL;
+    
+    #ifdef USE_CDC_NCM
+    cdc_ncm_dpe16_t* p_dpe = (cdc_ncm_dpe16_t*)&g_cdc_net_rx_buffer[m_rx_dpe];
+    *p_len = p_dpe->wDatagramLength;
+    return &g_cdc_net_rx_buffer[p_dpe->wDatagramIndex];
+    #else
+    *p_len = m_rx_len;
+    return g_cdc_net_rx_buffer;
+    #endif
+}
+
+void cdc_net_rx_release(void)
+{
+    if(!m_rx_ready) return;
+    #ifdef USE_CDC_NCM
+    m_rx_dpe += sizeof(cdc_ncm_dpe16_t);
+    #else
+    rx_done();
+    #endif
+}
+
+uint8_t* cdc_net_tx_acquire(uint16_t max_len)
+{
+    if(m_alt == 0 || m_tx_sending || max_len > CDC_NET_MAX_SEGMENT_SIZE) return NULL;
+    
+    #ifdef USE_CDC_NCM
+    uint16_t index = NCM_ALIGN(m_tx_len);
+    uint16_t ntb_len = NCM_ALIGN(index + max_len) + sizeof(cdc_ncm_ndp16_t) + ((m_tx_count + 2) * sizeof(cdc_ncm_dpe16_t));
+    
+    if(m_tx_count == CDC_NET_TX_MAX_DATAGRAMS || ntb_len > tx_max() ||
+      (m_ntb_input_size.wNtbInMaxDatagrams && m_tx_count == m_ntb_input_size.wNtbInMaxDatagrams))
+    {
+        cdc_net_tx_flush(); // Full, it goes out and the next frame starts a new NTB.
+        return NULL;
+    }
+    m_tx_index = index;
+    return &g_cdc_net_tx_buffer[index];
+    #else
+    return g_cdc_net_tx_buffer;
+    #endif
+}
+
+void cdc_net_tx_commit(uint16_t len)
+{
+    if(m_alt == 0 || m_tx_sending) return;
+    
+    #ifdef USE_CDC_NCM
+    m_tx_dpe[m_tx_count].wDatagramIndex  = m_tx_index;
+    m_tx_dpe[m_tx_count].wDatagramLength = len;
+    m_tx_count++;
+    m_tx_len = m_tx_index + len;
+    #else
+    m_tx_len = len;
+    tx_start();
+    #endif
+}
+
+void cdc_net_tx_flush(void)
+{
+    #ifdef USE_CDC_NCM
+    cdc_ncm_nth16_t* p_nth = (cdc_ncm_nth16_t*)g_cdc_net_tx_buffer;
+    cdc_ncm_ndp16_t* p_ndp;
+    cdc_ncm_dpe16_t* p_dpe;
+    uint16_t ndp_index;
+    
+    if(m_tx_sending || m_tx_count == 0) return;
+    
+    // NDP16 after the datagrams, ended by a null entry.
+    ndp_index = NCM_ALIGN(m_tx_len);
+    p_ndp = (cdc_ncm_ndp16_t*)&g_cdc_net_tx_buffer[ndp_index];
+    p_dpe = (cdc_ncm_dpe16_t*)&g_cdc_net_tx_buffer[ndp_index + sizeof(cdc_ncm_ndp16_t)];
+    p_ndp->dwSignature   = NCM_NDP16_SIGNATURE;
+    p_ndp->wLength       = sizeof(cdc_ncm_ndp16_t) + ((m_tx_count + 1) * sizeof(cdc_ncm_dpe16_t));
+    p_ndp->wNextNdpIndex = 0;
+    for(uint8_t i = 0; i < m_tx_count; i++) p_dpe[i] = m_tx_dpe[i];
+    p_dpe[m_tx_count].wDatagramIndex  = 0;
+    p_dpe[m_tx_count].wDatagramLength = 0;
+    m_tx_len = ndp_index + p_ndp->wLength;
+    
+    p_nth->dwSignature   = NCM_NTH16_SIGNATURE;
+    p_nth->wHeaderLength = sizeof(cdc_ncm_nth16_t);
+    p_nth->wSequence     = m_tx_sequence++;
+    p_nth->wBlockLength  = m_tx_len;
+    p_nth->wNdpIndex     = ndp_index;
+    tx_start();
+    #endif
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static void arm_out(uint8_t ppb)
+{
+    usb_arm_endpoint(&g_usb_bd_table[CDC_DAT_BD_OUT_EVEN + ppb], &g_usb_ep_stat[CDC_DAT_EP][OUT], CDC_DAT_EP_SIZE);
+    USB_NEXT_TOGGLE(CDC_DAT_EP_OUT_DATA_TOGGLE_VAL);
+}
+
+static void arm_in(uint8_t ppb, uint8_t cnt)
+{
+    usb_arm_endpoint(&g_usb_bd_table[CDC_DAT_BD_IN_EVEN + ppb], &g_usb_ep_stat[CDC_DAT_EP][IN], cnt);
+    USB_NEXT_TOGGLE(CDC_DAT_EP_IN_DATA_TOGGLE_VAL);
+}
+
+static void restart(uint8_t pipes)
+{
+    // The SIE uses the buffer after the last completed one.
+    if(pipes & RESTART_OUT)
+    {
+        g_usb_bd_table[CDC_DAT_BD_OUT_EVEN].STAT = 0;
+        g_usb_bd_table[CDC_DAT_BD_OUT_ODD].STAT  = 0;
+        CDC_DAT_EP_OUT_DATA_TOGGLE_VAL = 0;
+        m_out_ppb = g_usb_ep_stat[CDC_DAT_EP][OUT].Last_PPB ^ 1;
+        rx_done();
+        if(m_alt)
+        {
+            arm_out(m_out_ppb);
+            arm_out(m_out_ppb ^ 1);
+        }
+    }
+    if(pipes & RESTART_IN)
+    {
+        g_usb_bd_table[CDC_DAT_BD_IN_EVEN].STAT = 0;
+        g_usb_bd_table[CDC_DAT_BD_IN_ODD].STAT  = 0;
+        CDC_DAT_EP_IN_DATA_TOGGLE_VAL = 0;
+        m_in_ppb = g_usb_ep_stat[CDC_DAT_EP][IN].Last_PPB ^ 1;
+        #ifdef USE_CDC_NCM
+        m_tx_sequence = 0;
+        #endif
+        tx_done();
+    }
+    if(pipes & RESTART_COM)
+    {
+        g_usb_bd_table[CDC_COM_BD_IN_EVEN].STAT = 0;
+        g_usb_bd_table[CDC_COM_BD_IN_ODD].STAT  = 0;
+        CDC_COM_EP_IN_DATA_TOGGLE_VAL = 0;
+        m_com_ppb = CDC_COM_EP_IN_LAST_PPB ^ 1;
+    }
+}
+
+static void rx_tasks(void)
+{
+    bd_t*   p_bd;
+    uint8_t cnt;
+    
+    if(g_usb_ep_stat[CDC_DAT_EP][OUT].Halt) return;
+    
+    while(!m_rx_ready)
+    {
+        p_bd = &g_usb_bd_table[CDC_DAT_BD_OUT_EVEN + m_out_ppb];
+        if(p_bd->STAT & _UOWN) return;
+        
+        cnt = p_bd->CNT;
+        if((m_rx_len + cnt) > CDC_NET_RX_SIZE) m_rx_overflow = true;
+        if(!m_rx_overflow && cnt)
+        {
+            usb_ram_copy(USB_RAM_PTR(p_bd->ADR), &g_cdc_net_rx_buffer[m_rx_len], cnt);
+            m_rx_len += cnt;
+        }
+        arm_out(m_out_ppb);
+        m_out_ppb ^= 1;
+        
+        // A short packet ends the transfer, for NCM so does filling dwNtbOutMaxSize.
+        #ifdef USE_CDC_NCM
+        if(cnt == CDC_DAT_EP_SIZE && m_rx_len != CDC_NET_RX_SIZE) continue;
+        #else
+        if(cnt == CDC_DAT_EP_SIZE) continue;
+        #endif
+        if(!m_rx_overflow && rx_check()) m_rx_ready = true;
+        else rx_done();
+    }
+}
+
+static bool rx_check(void)
+{
+    #ifdef USE_CDC_NCM
+    cdc_ncm_nth16_t* p_nth = (cdc_ncm_nth16_t*)g_cdc_net_rx_buffer;
+    
+    if(m_rx_len < sizeof(cdc_ncm_nth16_t)) return false;
+    if(p_nth->dwSignature != NCM_NTH16_SIGNATURE) return false;
+    if(p_nth->wHeaderLength != sizeof(cdc_ncm_nth16_t)) return false;
+    if(p_nth->wBlockLength > m_rx_len) return false;
+    if(p_nth->wBlockLength) m_rx_len = p_nth->wBlockLength;
+    m_rx_ndp = 0;
+    return rx_ndp(p_nth->wNdpIndex);
+    #else
+    return m_rx_len != 0;
+    #endif
+}
+
+static bool rx_seek(void)
+{
+    #ifdef USE_CDC_NCM
+    cdc_ncm_dpe16_t* p_dpe;
+    
+    while(1)
+    {
+        // Entries that point outside the NTB are skipped.
+        while((m_rx_dpe + sizeof(cdc_ncm_dpe16_t)) <= m_rx_ndp_end)
+        {
+            p_dpe = (cdc_ncm_dpe16_t*)&g_cdc_net_rx_buffer[m_rx_dpe];
+            if(p_dpe->wDatagramIndex == 0 || p_dpe->wDatagramLength == 0) break; // Null entry ends the NDP16.
+            if((p_dpe->wDatagramIndex + p_dpe->wDatagramLength) <= m_rx_len) return true;
+            m_rx_dpe += sizeof(cdc_ncm_dpe16_t);
+        }
+        if(!rx_ndp(m_rx_next_ndp)) break;
+    }
+    rx_done();
+    return false;
+    #else
+    return m_rx_ready;
+    #endif
+}
+
+#ifdef USE_CDC_NCM
+static bool rx_ndp(uint16_t index)
+{
+    cdc_ncm_ndp16_t* p_ndp = (cdc_ncm_ndp16_t*)&g_cdc_net_rx_buffer[index];
+    
+    // Only forward links are followed, so a bad chain can't loop.
+    if(index <= m_rx_ndp || (index & (NCM_ALIGNMENT - 1))) return false;
+    if((index + sizeof(cdc_ncm_ndp16_t)) > m_rx_len) return false;
+    if(p_ndp->dwSignature != NCM_NDP16_SIGNATURE) return false;
+    if((index + p_ndp->wLength) > m_rx_len) return false;
+    
+    m_rx_ndp      = index;
+    m_rx_ndp_end  = index + p_ndp->wLength;
+    m_rx_next_ndp = p_ndp->wNextNdpIndex;
+    m_rx_dpe      = index + sizeof(cdc_ncm_ndp16_t);
+    return true;
+}
+
+static uint16_t tx_max(void)
+{
+    if(m_ntb_input_size.dwNtbInMaxSize < CDC_NET_TX_SIZE) return (uint16_t)m_ntb_input_size.dwNtbInMaxSize;
+    return CDC_NET_TX_SIZE;
+}
+#endif
+
+static void rx_done(void)
+{
+    m_rx_len = 0;
+    m_rx_overflow = false;
+    m_rx_ready = false;
+}
+
+static void tx_start(void)
+{
+    m_tx_sent = 0;
+    m_tx_sending = true;
+    
+    // The host's read ends on a short packet, or for NCM also on a full dwNtbInMaxSize.
+    #ifdef USE_CDC_NCM
+    m_tx_zlp = (m_tx_len != tx_max());
+    #else
+    m_tx_zlp = true;
+    #endif
+}
+
+static void tx_tasks(void)
+{
+    bd_t*    p_bd;
+    uint16_t left;
+    uint8_t  cnt;
+    
+    if(g_usb_ep_stat[CDC_DAT_EP][IN].Halt) return;
+    
+    while(m_tx_sending)
+    {
+        p_bd = &g_usb_bd_table[CDC_DAT_BD_IN_EVEN + m_in_ppb];
+        if(p_bd->STAT & _UOWN) return;
+        
+        left = m_tx_len - m_tx_sent;
+        cnt  = (left > CDC_DAT_EP_SIZE) ? CDC_DAT_EP_SIZE : (uint8_t)left;
+        if(cnt) usb_ram_copy(&g_cdc_net_tx_buffer[m_tx_sent], USB_RAM_PTR(p_bd->ADR), cnt);
+        m_tx_sent += cnt;
+        arm_in(m_in_ppb, cnt);
+        m_in_ppb ^= 1;
+        
+        // Everything is in USB RAM, the TX buffer is free again.
+        if(m_tx_sent == m_tx_len && !(cnt == CDC_DAT_EP_SIZE && m_tx_zlp)) tx_done();
+    }
+}
+
+static void tx_done(void)
+{
+    m_tx_len = TX_EMPTY_LEN;
+    m_tx_sending = false;
+    #ifdef USE_CDC_NCM
+    m_tx_count = 0;
+    #endif
+}
+
+static void notification_tasks(void)
+{
+    cdc_speed_change_notification_t* p_notification = (cdc_speed_change_notification_t*)g_cdc_com_ep_in;
+    uint8_t cnt;
+    
+    if(m_notify == 0 || g_usb_ep_stat[CDC_COM_EP][IN].Halt) return;
+    if(g_usb_bd_table[CDC_COM_BD_IN_EVEN].STAT & _UOWN) return;
+    if(g_usb_bd_table[CDC_COM_BD_IN_ODD].STAT & _UOWN) return;
+    
+    p_notification->header.bmRequestType = 0xA1;
+    p_notification->header.wIndex = CDC_COM_INT;
+    if(m_notify & NOTIFY_SPEED)
+    {
+        m_notify &= ~NOTIFY_SPEED;
+        p_notification->header.bNotification = CONNECTION_SPEED_CHANGE;
+        p_notification->header.wValue  = 0;
+        p_notification->header.wLength = 8;
+        p_notification->DLBitRate = CDC_NET_BIT_RATE;
+        p_notification->ULBitRate = CDC_NET_BIT_RATE;
+        cnt = sizeof(cdc_speed_change_notification_t);
+    }
+    else
+    {
+        m_notify &= ~NOTIFY_CONNECT;
+        p_notification->header.bNotification = NETWORK_CONNECTION;
+        p_notification->header.wValue  = m_alt; // Connected in alternate setting 1.
+        p_notification->header.wLength = 0;
+        cnt = sizeof(cdc_notification_header_t);
+    }
+    
+    usb_arm_endpoint(&g_usb_bd_table[CDC_COM_BD_IN_EVEN + m_com_ppb], &g_usb_ep_stat[CDC_COM_EP][IN], cnt);
+    USB_NEXT_TOGGLE(CDC_COM_EP_IN_DATA_TOGGLE_VAL);
+    m_com_ppb ^= 1;
+}
+
+/* ************************************************************************** */
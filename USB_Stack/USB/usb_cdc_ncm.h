@@ -0,0 +1,341 @@
+/**
+ * @file usb_cdc_ncm.h
+ * @brief <i>Communications Device Class</i> NCM/ECM network function.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - CDC Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_CDC_NCM_H
+#define USB_CDC_NCM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_hal.h"
+#include "usb.h"
+#include "usb_ch9.h"
+#include "usb_cdc.h"
+
+/*
+ * USB Ethernet adapter, CDC-NCM with USE_CDC_NCM or CDC-ECM with USE_CDC_ECM. 
+ * The COM interface (CDC_COM_INT) has the notification Endpoint, the DATA 
+ * interface (CDC_COM_INT + 1) has alternate setting 0 (no Endpoints) and 
+ * alternate setting 1 with the bulk OUT and IN Endpoints, both ping-ponged.
+ * 
+ * RX: the host's transfer is gathered into the RX buffer, an NTB holding one 
+ *     or more frames (NCM), or a single frame (ECM). cdc_net_rx_frame() points 
+ *     at each frame in place, cdc_net_rx_release() moves on to the next one. 
+ *     OUT is NAKed until every frame of the NTB has been released.
+ * TX: cdc_net_tx_acquire() gives room for a frame in the TX buffer and 
+ *     cdc_net_tx_commit() adds it. NCM keeps adding frames to the same NTB, 
+ *     and cdc_net_tasks() sends it once every received frame has been 
+ *     released, so replies to a batch of frames go out in one NTB. ECM sends 
+ *     each frame on commit.
+ * 
+ * Frames are never copied by the Application, an IP stack parses and builds 
+ * them straight in the two buffers. cdc_net_tasks() moves the data between 
+ * the buffers and USB RAM from the main loop.
+ */
+
+/* ************************************************************************** */
+/* *************************** WARNING FOR NET ****************************** */
+/* ************************************************************************** */
+
+#if defined(USE_CDC_NCM) && defined(USE_CDC_ECM)
+#error "Define only one of USE_CDC_NCM or USE_CDC_ECM."
+#elif !defined(USE_CDC_NCM) && !defined(USE_CDC_ECM)
+#error "The CDC network library needs USE_CDC_NCM or USE_CDC_ECM in usb_cdc_config.h."
+#endif
+
+#ifdef _PIC14E
+#error "There isn't enough RAM for the CDC network buffers on PIC16 devices."
+#endif
+
+#if (PINGPONG_MODE != PINGPONG_1_15) && (PINGPONG_MODE != PINGPONG_ALL_EP)
+#error "The CDC network library keeps both ping-pong buffers of CDC_DAT_EP armed, PINGPONG_1_15 or PINGPONG_ALL_EP must be used."
+#endif
+
+#if NUM_ALT_INTERFACES == 0
+#error "The DATA interface has an alternate setting, NUM_ALT_INTERFACES must be at least 1."
+#endif
+
+#if CDC_COM_EP_SIZE < 16
+#error "CDC_COM_EP_SIZE must be 16 or more, CONNECTION_SPEED_CHANGE is sent in one packet."
+#endif
+
+#if (CDC_NET_RX_SIZE < CDC_NET_MAX_SEGMENT_SIZE) || (CDC_NET_TX_SIZE < CDC_NET_MAX_SEGMENT_SIZE)
+#error "CDC_NET_RX_SIZE and CDC_NET_TX_SIZE must hold at least one CDC_NET_MAX_SEGMENT_SIZE frame."
+#endif
+
+#if defined(USE_CDC_NCM) && ((CDC_NET_RX_SIZE < (CDC_NET_MAX_SEGMENT_SIZE + 32)) || (CDC_NET_TX_SIZE < (CDC_NET_MAX_SEGMENT_SIZE + 32)))
+#error "CDC_NET_RX_SIZE and CDC_NET_TX_SIZE need 32 bytes more than CDC_NET_MAX_SEGMENT_SIZE for the NTH16 and NDP16."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** NET DEFINES ******************************* */
+/* ************************************************************************** */
+
+#define NCM_ALIGNMENT 4 // Datagram and NDP alignment of the NTBs made by the device.
+
+// Ethernet Packet Filter bits (SET_ETHERNET_PACKET_FILTER wValue)
+#define PACKET_TYPE_PROMISCUOUS   0x01
+#define PACKET_TYPE_ALL_MULTICAST 0x02
+#define PACKET_TYPE_DIRECTED      0x04
+#define PACKET_TYPE_BROADCAST     0x08
+#define PACKET_TYPE_MULTICAST     0x10
+
+#define CDC_NET_BIT_RATE 12000000UL // Full Speed, reported by CONNECTION_SPEED_CHANGE.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ NET FUNCTION DESCRIPTORS ************************ */
+/* ************************************************************************** */
+
+#ifdef USE_CDC_NCM
+#define CDC_NET_SUBCLASS     CIC_NCM
+#define CDC_NET_DAT_PROTOCOL DIC_NCM_NTB
+#else
+#define CDC_NET_SUBCLASS     CIC_ENCM
+#define CDC_NET_DAT_PROTOCOL DIC_NONE
+#endif
+
+/// Network Function Descriptors, from the IAD to the DATA Interface Endpoints.
+typedef struct
+{
+    ch9_interface_association_descriptor_t iad;
+    ch9_standard_interface_descriptor_t    com_interface;
+    cdc_header_functional_descriptor_t     header;
+    cdc_union_functional_descriptor_t      cdc_union;
+    cdc_en_functional_descriptor_t         ethernet;
+    #ifdef USE_CDC_NCM
+    cdc_ncm_functional_descriptor_t        ncm;
+    #endif
+    ch9_standard_endpoint_descriptor_t     com_ep_in;
+    ch9_standard_interface_descriptor_t    dat_interface_alt0;
+    ch9_standard_interface_descriptor_t    dat_interface_alt1;
+    ch9_standard_endpoint_descriptor_t     dat_ep_out;
+    ch9_standard_endpoint_descriptor_t     dat_ep_in;
+}cdc_net_function_descriptors_t;
+
+#ifdef USE_CDC_NCM
+#define CDC_NET_NCM_DESCRIPTOR {6, CS_INTERFACE, DESC_SUB_NCM, 0x0100, 0x20}, // GET/SET_NTB_INPUT_SIZE
+#else
+#define CDC_NET_NCM_DESCRIPTOR
+#endif
+
+/*
+ * Initializer for cdc_net_function_descriptors_t, see the DESCRIPTOR BUILDER 
+ * in usb_ch9.h. Uses interfaces CDC_COM_INT and CDC_COM_INT + 1, and the 
+ * Endpoints from usb_cdc_config.h. com_interval is the COM EP's bInterval.
+ */
+#define CDC_NET_FUNCTION_DESCRIPTORS(com_interval) \
+{ \
+    CH9_INTERFACE_ASSOCIATION_DESCRIPTOR(CDC_COM_INT, 2, CIC_CODE, CDC_NET_SUBCLASS, 0x00), \
+    CH9_INTERFACE_DESCRIPTOR(CDC_COM_INT, 0, 1, CIC_CODE, CDC_NET_SUBCLASS, 0x00), \
+    {5, CS_INTERFACE, DESC_SUB_HEADER, 0x0120}, \
+    {5, CS_INTERFACE, DESC_SUB_UNION, CDC_COM_INT, {CDC_COM_INT + 1}}, \
+    {13, CS_INTERFACE, DESC_SUB_EN, CDC_NET_MAC_STRING, 0, CDC_NET_MAX_SEGMENT_SIZE, 0, 0}, \
+    CDC_NET_NCM_DESCRIPTOR \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(CDC_COM_EP), EP_INTERRUPT, CDC_COM_EP_SIZE, (com_interval)), \
+    CH9_INTERFACE_DESCRIPTOR(CDC_COM_INT + 1, 0, 0, DIC_CODE, 0x00, CDC_NET_DAT_PROTOCOL), \
+    CH9_INTERFACE_DESCRIPTOR(CDC_COM_INT + 1, 1, 2, DIC_CODE, 0x00, CDC_NET_DAT_PROTOCOL), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_OUT_ADDR(CDC_DAT_EP), EP_BULK, CDC_DAT_EP_SIZE, 0), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(CDC_DAT_EP), EP_BULK, CDC_DAT_EP_SIZE, 0) \
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************* VARIABLES FROM: usb_cdc_ncm.c ********************** */
+/* ************************************************************************** */
+
+extern uint8_t g_cdc_net_rx_buffer[CDC_NET_RX_SIZE];
+extern uint8_t g_cdc_net_tx_buffer[CDC_NET_TX_SIZE];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** NET FUNCTIONS ****************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void cdc_net_init(void)
+ * 
+ * @brief Used to initialize the CDC network library.
+ * 
+ * BDs and Endpoints are setup, the DATA interface starts in alternate 
+ * setting 0 with nothing armed.
+ */
+void cdc_net_init(void);
+
+/**
+ * @fn bool cdc_net_class_request(void)
+ * 
+ * @brief Services the network Class Requests sent to CDC_COM_INT.
+ * 
+ * SET_ETHERNET_PACKET_FILTER is accepted, NCM also answers 
+ * GET_NTB_PARAMETERS, GET_NTB_INPUT_SIZE and SET_NTB_INPUT_SIZE.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+bool cdc_net_class_request(void);
+
+/**
+ * @fn bool cdc_net_set_interface(uint8_t alternate_setting, uint8_t interface)
+ * 
+ * @brief Services SET_INTERFACE for both interfaces of the function.
+ * 
+ * Alternate setting 1 of the DATA interface resets both pipes, arms the OUT 
+ * buffers and queues the CONNECTION_SPEED_CHANGE and NETWORK_CONNECTION 
+ * notifications. Alternate setting 0 disconnects.
+ * 
+ * @param alternate_setting Alternate Setting to change to.
+ * @param interface Interface the request is directed at.
+ * @return Returns true if successful and false if unsuccessful.
+ */
+bool cdc_net_set_interface(uint8_t alternate_setting, uint8_t interface);
+
+/**
+ * @fn bool cdc_net_get_interface(uint8_t* alternate_setting_result, uint8_t interface)
+ * 
+ * @brief Services GET_INTERFACE for both interfaces of the function.
+ * 
+ * @param alternate_setting_result Alternate Setting return.
+ * @param interface Interface the request is directed at.
+ * @return Returns true if successful and false if unsuccessful.
+ */
+bool cdc_net_get_interface(uint8_t* alternate_setting_result, uint8_t interface);
+
+/**
+ * @fn void cdc_net_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+ * 
+ * @brief Clears a halt on one of the function's Endpoints.
+ * 
+ * A DATA OUT halt drops the transfer being received, a DATA IN halt drops 
+ * the one being sent.
+ * 
+ * @param[in] bdt_index Buffer Descriptor Index.
+ * @param[in] ep Endpoint number.
+ * @param[in] dir Endpoint direction.
+ */
+void cdc_net_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir);
+
+/**
+ * @fn void cdc_net_ep_tasks(void)
+ * 
+ * @brief Call from usb_app_tasks() for the TRANSACTION_EP of CDC_COM_EP and 
+ * CDC_DAT_EP. Records the ping-pong buffer the transaction used, the data 
+ * itself is handled by cdc_net_tasks().
+ */
+void cdc_net_ep_tasks(void);
+
+/**
+ * @fn void cdc_net_tasks(void)
+ * 
+ * @brief Moves received packets into the RX buffer, the TX buffer into IN 
+ * packets, and sends pending notifications. Call it from the main loop.
+ */
+void cdc_net_tasks(void);
+
+/**
+ * @fn bool cdc_net_connected(void)
+ * 
+ * @brief Returns true while the host has the DATA interface in alternate setting 1.
+ */
+bool cdc_net_connected(void);
+
+/**
+ * @fn uint8_t* cdc_net_rx_frame(uint16_t* p_len)
+ * 
+ * @brief Gets the oldest received Ethernet frame, in place in g_cdc_net_rx_buffer.
+ * 
+ * @param[out] p_len Length of the frame.
+ * 
+ * @return Returns a pointer to the frame, or NULL if none is waiting.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint16_t len;
+ * uint8_t* p_frame;
+ * while((p_frame = cdc_net_rx_frame(&len)) != NULL)
+ * {
+ *     ip_input(p_frame, len);
+ *     cdc_net_rx_release();
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* cdc_net_rx_frame(uint16_t* p_len);
+
+/**
+ * @fn void cdc_net_rx_release(void)
+ * 
+ * @brief Drops the frame from cdc_net_rx_frame(). Once the last frame of an 
+ * NTB is released the RX buffer takes the next transfer.
+ */
+void cdc_net_rx_release(void);
+
+/**
+ * @fn uint8_t* cdc_net_tx_acquire(uint16_t max_len)
+ * 
+ * @brief Gets room for a frame of up to max_len bytes in g_cdc_net_tx_buffer.
+ * 
+ * @param[in] max_len Largest frame that will be committed, at most 
+ * CDC_NET_MAX_SEGMENT_SIZE.
+ * 
+ * @return Returns a pointer to write the frame into, or NULL if the NTB is 
+ * full or being sent.
+ */
+uint8_t* cdc_net_tx_acquire(uint16_t max_len);
+
+/**
+ * @fn void cdc_net_tx_commit(uint16_t len)
+ * 
+ * @brief Adds the frame written at cdc_net_tx_acquire() to the TX buffer.
+ * 
+ * ECM sends it straight away. NCM sends the NTB from cdc_net_tasks() once no 
+ * received frames are waiting, or when cdc_net_tx_flush() is called.
+ * 
+ * @param[in] len Length of the frame, at most the max_len acquired.
+ */
+void cdc_net_tx_commit(uint16_t len);
+
+/**
+ * @fn void cdc_net_tx_flush(void)
+ * 
+ * @brief Closes the NTB being built and starts sending it (NCM).
+ */
+void cdc_net_tx_flush(void);
+
+/* ************************************************************************** */
+
+#endif /* USB_CDC_NCM_H */
@@ -0,0 +1,529 @@
+/**
+ * @file usb_cdc_ports.c
+ * @brief <i>Communications Device Class</i> multiple virtual COM ports.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - CDC Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb.h"
+#include "usb_cdc_ports.h"
+#include "usb_hal.h"
+#include "usb_ch9.h"
+
+/* ************************************************************************** */
+/* *************************** CDC PORT BUFFERS ***************************** */
+/* ************************************************************************** */
+
+#define NUM_BUFFERS EPN_NUM_BUFFERS
+
+#if NUM_BUFFERS == 2
+#define PPB_NEXT(ppb) ((ppb) ^ 1)
+#else
+#define PPB_NEXT(ppb) 0
+#endif
+
+// EP buffers come from the allocator in usb_hal.h, which needs literal Endpoint numbers.
+#define PORT_BUFFERS(com, dat) \
+    {EP_IN_EVEN_BUFFER_ADDR(com), {{EP_OUT_EVEN_BUFFER_ADDR(dat), EP_OUT_ODD_BUFFER_ADDR(dat)}, {EP_IN_EVEN_BUFFER_ADDR(dat), EP_IN_ODD_BUFFER_ADDR(dat)}}}
+
+typedef struct
+{
+    uint16_t com;
+    uint16_t dat[2][2]; // [dir][ppb]
+}port_buffers_t;
+
+static const port_buffers_t m_port_buffers[CDC_NUM_PORTS] =
+{
+    PORT_BUFFERS(1, 2),
+    #if CDC_NUM_PORTS > 1
+    PORT_BUFFERS(3, 4),
+    #endif
+    #if CDC_NUM_PORTS > 2
+    PORT_BUFFERS(5, 6),
+    #endif
+};
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+typedef struct
+{
+    // Ring indexes are free running, used = head - tail.
+    uint8_t          rx_ring[CDC_RX_RING_SIZE];
+    volatile uint8_t rx_head;    // Written when a packet is moved in.
+    volatile uint8_t rx_tail;    // Written by cdc_port_read().
+    volatile uint8_t rx_pending; // OUT packets received, but not yet moved into rx_ring.
+    uint8_t          rx_ppb;     // Buffer holding the oldest pending OUT packet.
+    
+    uint8_t          tx_ring[CDC_TX_RING_SIZE];
+    volatile uint8_t tx_head;    // Written by cdc_port_write().
+    volatile uint8_t tx_tail;    // Written when a packet is armed.
+    volatile uint8_t tx_armed;   // IN buffers owned by the SIE.
+    uint8_t          tx_ppb;     // Next IN buffer to arm.
+    volatile bool    tx_flush;   // Send short packets until tx_ring is empty.
+    bool             tx_zlp;     // Last packet armed was full, a flush must end with a ZLP.
+    #ifdef USE_SOF
+    uint8_t          tx_idle_frames;
+    #endif
+    
+    cdc_get_line_coding_return_t line_coding;
+    volatile bool                line_coding_changed;
+    volatile uint8_t             control_line_state;
+}port_t;
+
+static port_t m_ports[CDC_NUM_PORTS];
+
+static cdc_set_line_coding_t m_set_line_coding;      // SET_LINE_CODING data stage.
+static volatile uint8_t      m_set_line_coding_port; // Port it's for, CDC_NUM_PORTS if none.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void rx_reset(uint8_t port)
+ * 
+ * @brief Drops the port's pending OUT packets and arms every OUT buffer again 
+ * from DATA0, starting with the buffer the SIE uses next.
+ * 
+ * @param[in] port Port number.
+ */
+static void rx_reset(uint8_t port);
+
+/**
+ * @fn void tx_reset(uint8_t port)
+ * 
+ * @brief Drops the port's IN packets not sent yet, the next one armed is the 
+ * buffer the SIE uses next.
+ * 
+ * @param[in] port Port number.
+ */
+static void tx_reset(uint8_t port);
+
+/**
+ * @fn void rx_drain(uint8_t port)
+ * 
+ * @brief Moves the port's pending OUT packets into its RX ring, oldest first, 
+ * and re-arms their buffers. Stops when a packet doesn't fit, the host is 
+ * NAKed until cdc_port_read() makes room.
+ * 
+ * @param[in] port Port number.
+ */
+static void rx_drain(uint8_t port);
+
+/**
+ * @fn void tx_fill(uint8_t port)
+ * 
+ * @brief Arms the port's free IN buffers from its TX ring. Only full packets 
+ * are sent unless tx_flush is set.
+ * 
+ * @param[in] port Port number.
+ */
+static void tx_fill(uint8_t port);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** PORT FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+void cdc_port_init(void)
+{
+    for(uint8_t port = 0; port < CDC_NUM_PORTS; port++)
+    {
+        port_t* p_port = &m_ports[port];
+        uint8_t com_ep = CDC_PORT_COM_EP(port);
+        uint8_t dat_ep = CDC_PORT_DAT_EP(port);
+        
+        // Both COM BDs share one buffer, no notifications are sent.
+        for(uint8_t ppb = 0; ppb < NUM_BUFFERS; ppb++)
+        {
+            g_usb_bd_table[EP_BD_INDEX(com_ep, IN, ppb)].STAT = 0;
+            g_usb_bd_table[EP_BD_INDEX(com_ep, IN, ppb)].ADR  = m_port_buffers[port].com;
+            for(uint8_t dir = OUT; dir <= IN; dir++)
+            {
+                g_usb_bd_table[EP_BD_INDEX(dat_ep, dir, ppb)].STAT = 0;
+                g_usb_bd_table[EP_BD_INDEX(dat_ep, dir, ppb)].ADR  = m_port_buffers[port].dat[dir][ppb];
+            }
+        }
+        g_usb_ep_stat[com_ep][IN].Halt = 0;
+        g_usb_ep_stat[com_ep][IN].Data_Toggle_Val = 0;
+        g_usb_ep_stat[dat_ep][OUT].Halt = 0;
+        g_usb_ep_stat[dat_ep][IN].Halt  = 0;
+        
+        p_port->line_coding.dwDTERate   = STARTING_BAUD;
+        p_port->line_coding.bCharFormat = STARTING_STOP_BITS;
+        p_port->line_coding.bParityType = STARTING_PARITY;
+        p_port->line_coding.bDataBits   = STARTING_DATA_BITS;
+        p_port->line_coding_changed = false;
+        p_port->control_line_state  = 0;
+        p_port->rx_head = 0;
+        p_port->rx_tail = 0;
+        p_port->tx_head = 0;
+        p_port->tx_tail = 0;
+        #ifdef USE_SOF
+        p_port->tx_idle_frames = 0;
+        #endif
+    }
+    m_set_line_coding_port = CDC_NUM_PORTS;
+    
+    // EP Settings, handshaking and no SETUP. COM is IN only, DATA is OUT and IN.
+    UEP1 = _EPHSHK | _EPCONDIS | _EPINEN;
+    UEP2 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #if CDC_NUM_PORTS > 1
+    UEP3 = _EPHSHK | _EPCONDIS | _EPINEN;
+    UEP4 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if CDC_NUM_PORTS > 2
+    UEP5 = _EPHSHK | _EPCONDIS | _EPINEN;
+    UEP6 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    
+    // Reset from the EVEN buffers, the SIE does the same after a bus reset.
+    for(uint8_t port = 0; port < CDC_NUM_PORTS; port++)
+    {
+        g_usb_ep_stat[CDC_PORT_DAT_EP(port)][OUT].Last_PPB = NUM_BUFFERS - 1;
+        g_usb_ep_stat[CDC_PORT_DAT_EP(port)][IN].Last_PPB  = NUM_BUFFERS - 1;
+        rx_reset(port);
+        tx_reset(port);
+    }
+}
+
+void cdc_port_tasks(void)
+{
+    if(TRANSACTION_EP & 1) cdc_port_com_ep_in_tasks();
+    else if(TRANSACTION_DIR == OUT) cdc_port_dat_ep_out_tasks();
+    else cdc_port_dat_ep_in_tasks();
+}
+
+void cdc_port_com_ep_in_tasks(void)
+{
+    g_usb_ep_stat[TRANSACTION_EP][IN].Last_PPB = PINGPONG_PARITY;
+}
+
+void cdc_port_dat_ep_out_tasks(void)
+{
+    uint8_t port = CDC_EP_PORT(TRANSACTION_EP);
+    
+    // Data Toggle was moved on when armed, only the SIE's position is kept.
+    g_usb_ep_stat[TRANSACTION_EP][OUT].Last_PPB = PINGPONG_PARITY;
+    m_ports[port].rx_pending++;
+    rx_drain(port);
+}
+
+void cdc_port_dat_ep_in_tasks(void)
+{
+    uint8_t port = CDC_EP_PORT(TRANSACTION_EP);
+    
+    g_usb_ep_stat[TRANSACTION_EP][IN].Last_PPB = PINGPONG_PARITY;
+    m_ports[port].tx_armed--;
+    tx_fill(port);
+}
+
+bool cdc_port_class_request(void)
+{
+    uint8_t intf = (uint8_t)g_usb_setup.wIndex - CDC_COM_INT;
+    uint8_t port = intf >> 1;
+    
+    // Requests go to a port's COM interface, interfaces below CDC_COM_INT wrap past the last port.
+    if(g_usb_setup.bmRequestType_bits.Recipient != INTERFACE) return false;
+    if((intf & 1) || port >= CDC_NUM_PORTS) return false;
+    
+    switch(g_usb_setup.bRequest)
+    {
+        case GET_LINE_CODING:
+            usb_set_ram_ptr((uint8_t*)&m_ports[port].line_coding);
+            usb_setup_in_control_transfer(RAM, 7, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        case SET_LINE_CODING:
+            if(g_usb_setup.wLength > 7) return false;
+            usb_set_ram_ptr((uint8_t*)&m_set_line_coding);
+            usb_set_num_out_control_bytes(g_usb_setup.wLength);
+            m_set_line_coding_port = port;
+            usb_set_control_stage(DATA_OUT_STAGE);
+            return true;
+        case SET_CONTROL_LINE_STATE:
+            m_ports[port].control_line_state = (uint8_t)g_usb_setup.wValue & (CDC_PORT_DTR | CDC_PORT_RTS);
+            usb_set_control_stage(STATUS_IN_STAGE);
+            usb_arm_in_status();
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool cdc_port_out_control_tasks(void)
+{
+    port_t* p_port;
+    
+    if(m_set_line_coding_port >= CDC_NUM_PORTS) return false;
+    
+    p_port = &m_ports[m_set_line_coding_port];
+    m_set_line_coding_port = CDC_NUM_PORTS;
+    p_port->line_coding.dwDTERate   = m_set_line_coding.dwDTERate;
+    p_port->line_coding.bCharFormat = m_set_line_coding.bCharFormat;
+    p_port->line_coding.bParityType = m_set_line_coding.bParityType;
+    p_port->line_coding.bDataBits   = m_set_line_coding.bDataBits;
+    p_port->line_coding_changed = true;
+    return true;
+}
+
+void cdc_port_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+{
+    uint8_t port = CDC_EP_PORT(ep);
+    
+    if(ep == EP0 || port >= CDC_NUM_PORTS) return;
+    
+    g_usb_ep_stat[ep][dir].Halt = 0;
+    if(ep & 1)
+    {
+        for(uint8_t ppb = 0; ppb < NUM_BUFFERS; ppb++) g_usb_bd_table[EP_BD_INDEX(ep, IN, ppb)].STAT = 0;
+        g_usb_ep_stat[ep][IN].Data_Toggle_Val = 0;
+    }
+    else if(dir == OUT) rx_reset(port);
+    else tx_reset(port);
+}
+
+uint8_t cdc_port_available(uint8_t port)
+{
+    return (uint8_t)(m_ports[port].rx_head - m_ports[port].rx_tail);
+}
+
+uint8_t cdc_port_read(uint8_t port, uint8_t* p_data, uint8_t len)
+{
+    port_t* p_port = &m_ports[port];
+    uint8_t used = (uint8_t)(p_port->rx_head - p_port->rx_tail);
+    
+    if(len > used) len = used;
+    for(uint8_t i = 0; i < len; i++) p_data[i] = p_port->rx_ring[(uint8_t)(p_port->rx_tail + i) & (CDC_RX_RING_SIZE - 1)];
+    p_port->rx_tail += len;
+    
+    if(p_port->rx_pending)
+    {
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 0;
+        #endif
+        rx_drain(port);
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 1;
+        #endif
+    }
+    return len;
+}
+
+uint8_t cdc_port_write(uint8_t port, const uint8_t* p_data, uint8_t len)
+{
+    port_t* p_port = &m_ports[port];
+    uint8_t space = CDC_TX_RING_SIZE - (uint8_t)(p_port->tx_head - p_port->tx_tail);
+    
+    if(len > space) len = space;
+    for(uint8_t i = 0; i < len; i++) p_port->tx_ring[(uint8_t)(p_port->tx_head + i) & (CDC_TX_RING_SIZE - 1)] = p_data[i];
+    p_port->tx_head += len;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    #ifdef USE_SOF
+    p_port->tx_idle_frames = 0;
+    #endif
+    tx_fill(port);
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    return len;
+}
+
+uint8_t cdc_port_tx_space(uint8_t port)
+{
+    return CDC_TX_RING_SIZE - (uint8_t)(m_ports[port].tx_head - m_ports[port].tx_tail);
+}
+
+void cdc_port_flush(uint8_t port)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    m_ports[port].tx_flush = true;
+    tx_fill(port);
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+#ifdef USE_SOF
+void cdc_port_service_sof(void)
+{
+    if(usb_get_state() != STATE_CONFIGURED) return;
+    
+    for(uint8_t port = 0; port < CDC_NUM_PORTS; port++)
+    {
+        port_t* p_port = &m_ports[port];
+        
+        if(p_port->tx_flush) continue;
+        if((p_port->tx_head == p_port->tx_tail) && !p_port->tx_zlp) continue;
+        
+        if(++p_port->tx_idle_frames >= CDC_TX_FLUSH_FRAMES)
+        {
+            p_port->tx_idle_frames = 0;
+            p_port->tx_flush = true;
+            tx_fill(port);
+        }
+    }
+}
+#endif
+
+bool cdc_port_line_coding(uint8_t port, cdc_get_line_coding_return_t* p_line_coding)
+{
+    bool changed;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    *p_line_coding = m_ports[port].line_coding;
+    changed = m_ports[port].line_coding_changed;
+    m_ports[port].line_coding_changed = false;
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    return changed;
+}
+
+uint8_t cdc_port_control_line_state(uint8_t port)
+{
+    return m_ports[port].control_line_state;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static void rx_reset(uint8_t port)
+{
+    port_t* p_port = &m_ports[port];
+    uint8_t ep = CDC_PORT_DAT_EP(port);
+    
+    for(uint8_t ppb = 0; ppb < NUM_BUFFERS; ppb++) g_usb_bd_table[EP_BD_INDEX(ep, OUT, ppb)].STAT = 0;
+    g_usb_ep_stat[ep][OUT].Data_Toggle_Val = 0;
+    p_port->rx_pending = 0;
+    p_port->rx_ppb = PPB_NEXT(g_usb_ep_stat[ep][OUT].Last_PPB);
+    
+    // The Data Toggle is flipped every time a buffer is armed, not on completion.
+    for(uint8_t i = 0, ppb = p_port->rx_ppb; i < NUM_BUFFERS; i++, ppb = PPB_NEXT(ppb))
+    {
+        usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(ep, OUT, ppb)], &g_usb_ep_stat[ep][OUT], CDC_DAT_EP_SIZE);
+        USB_NEXT_TOGGLE(g_usb_ep_stat[ep][OUT].Data_Toggle_Val);
+    }
+}
+
+static void tx_reset(uint8_t port)
+{
+    port_t* p_port = &m_ports[port];
+    uint8_t ep = CDC_PORT_DAT_EP(port);
+    
+    for(uint8_t ppb = 0; ppb < NUM_BUFFERS; ppb++) g_usb_bd_table[EP_BD_INDEX(ep, IN, ppb)].STAT = 0;
+    g_usb_ep_stat[ep][IN].Data_Toggle_Val = 0;
+    p_port->tx_armed = 0;
+    p_port->tx_ppb   = PPB_NEXT(g_usb_ep_stat[ep][IN].Last_PPB);
+    p_port->tx_flush = false;
+    p_port->tx_zlp   = false;
+}
+
+static void rx_drain(uint8_t port)
+{
+    port_t*  p_port = &m_ports[port];
+    uint8_t  ep = CDC_PORT_DAT_EP(port);
+    bd_t*    p_bd;
+    uint8_t  cnt;
+    uint8_t* p_ep;
+    
+    while(p_port->rx_pending)
+    {
+        p_bd = &g_usb_bd_table[EP_BD_INDEX(ep, OUT, p_port->rx_ppb)];
+        cnt  = p_bd->CNT;
+        if((uint8_t)(CDC_RX_RING_SIZE - (uint8_t)(p_port->rx_head - p_port->rx_tail)) < cnt) return;
+        
+        p_ep = USB_RAM_PTR(p_bd->ADR);
+        for(uint8_t i = 0; i < cnt; i++) p_port->rx_ring[(uint8_t)(p_port->rx_head + i) & (CDC_RX_RING_SIZE - 1)] = p_ep[i];
+        p_port->rx_head += cnt;
+        
+        usb_arm_endpoint(p_bd, &g_usb_ep_stat[ep][OUT], CDC_DAT_EP_SIZE);
+        USB_NEXT_TOGGLE(g_usb_ep_stat[ep][OUT].Data_Toggle_Val);
+        p_port->rx_ppb = PPB_NEXT(p_port->rx_ppb);
+        p_port->rx_pending--;
+    }
+}
+
+static void tx_fill(uint8_t port)
+{
+    port_t*  p_port = &m_ports[port];
+    uint8_t  ep = CDC_PORT_DAT_EP(port);
+    bd_t*    p_bd;
+    uint8_t  cnt;
+    uint8_t* p_ep;
+    
+    if(g_usb_ep_stat[ep][IN].Halt) return;
+    
+    while(p_port->tx_armed < NUM_BUFFERS)
+    {
+        cnt = (uint8_t)(p_port->tx_head - p_port->tx_tail);
+        if(cnt == 0)
+        {
+            if(!p_port->tx_flush || !p_port->tx_zlp)
+            {
+                p_port->tx_flush = false;
+                return;
+            }
+            // Transfer ended on a full packet, send a ZLP.
+        }
+        else if(cnt > CDC_DAT_EP_SIZE) cnt = CDC_DAT_EP_SIZE;
+        else if(cnt < CDC_DAT_EP_SIZE && !p_port->tx_flush) return; // Wait for a full packet or cdc_port_flush().
+        
+        p_bd = &g_usb_bd_table[EP_BD_INDEX(ep, IN, p_port->tx_ppb)];
+        p_ep = USB_RAM_PTR(p_bd->ADR);
+        for(uint8_t i = 0; i < cnt; i++) p_ep[i] = p_port->tx_ring[(uint8_t)(p_port->tx_tail + i) & (CDC_TX_RING_SIZE - 1)];
+        p_port->tx_tail += cnt;
+        p_port->tx_zlp   = (cnt == CDC_DAT_EP_SIZE);
+        
+        usb_arm_endpoint(p_bd, &g_usb_ep_stat[ep][IN], cnt);
+        USB_NEXT_TOGGLE(g_usb_ep_stat[ep][IN].Data_Toggle_Val);
+        p_port->tx_ppb = PPB_NEXT(p_port->tx_ppb);
+        p_port->tx_armed++;
+    }
+}
+
+/* ************************************************************************** */
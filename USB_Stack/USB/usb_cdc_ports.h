@@ -0,0 +1,305 @@
+/**
+ * @file usb_cdc_ports.h
+ * @brief <i>Communications Device Class</i> multiple virtual COM ports.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - CDC Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_CDC_PORTS_H
+#define USB_CDC_PORTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_hal.h"
+#include "usb.h"
+#include "usb_ch9.h"
+#include "usb_cdc.h"
+
+/*
+ * CDC_NUM_PORTS ACM functions in one device. Port p has:
+ *   COM interface  CDC_COM_INT + 2p,     COM Endpoint  EP(1 + 2p) IN
+ *   DATA interface CDC_COM_INT + 2p + 1, DATA Endpoint EP(2 + 2p) OUT and IN
+ * 
+ * Every port has its own RX/TX rings and line coding in a cdc_port_t, found 
+ * straight from the Endpoint number (CDC_EP_PORT()) or interface number 
+ * (CDC_INT_PORT()), so the work per transaction doesn't grow with the ports.
+ * Class Requests are routed to the port by wIndex.
+ */
+
+/* ************************************************************************** */
+/* ************************** WARNING FOR PORTS ***************************** */
+/* ************************************************************************** */
+
+#if CDC_NUM_PORTS < 1 || CDC_NUM_PORTS > 3
+#error "CDC_NUM_PORTS must be 1 to 3."
+#endif
+
+#if (CDC_COM_EP != EP1) || (CDC_DAT_EP != EP2)
+#error "CDC ports use EP1 to EP(2 * CDC_NUM_PORTS), CDC_COM_EP must be EP1 and CDC_DAT_EP EP2."
+#endif
+
+#if NUM_ENDPOINTS < ((2 * CDC_NUM_PORTS) + 1)
+#error "NUM_ENDPOINTS must be at least (2 * CDC_NUM_PORTS) + 1."
+#endif
+
+#if NUM_INTERFACES < (CDC_COM_INT + (2 * CDC_NUM_PORTS))
+#error "Every CDC port has two interfaces, NUM_INTERFACES is too small."
+#endif
+
+#ifdef _PIC14E
+#error "There isn't enough RAM for more than one CDC port on PIC16 devices, use usb_cdc_acm.c."
+#endif
+
+#if (CDC_RX_RING_SIZE & (CDC_RX_RING_SIZE - 1)) || (CDC_TX_RING_SIZE & (CDC_TX_RING_SIZE - 1)) || \
+    (CDC_RX_RING_SIZE < CDC_DAT_EP_SIZE) || (CDC_TX_RING_SIZE < CDC_DAT_EP_SIZE) || (CDC_RX_RING_SIZE > 128) || (CDC_TX_RING_SIZE > 128)
+#error "CDC_RX_RING_SIZE and CDC_TX_RING_SIZE must be a power of 2, from CDC_DAT_EP_SIZE to 128."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** PORT DEFINES ****************************** */
+/* ************************************************************************** */
+
+#define CDC_PORT_COM_EP(port)  (EP1 + ((port) << 1))
+#define CDC_PORT_DAT_EP(port)  (EP2 + ((port) << 1))
+#define CDC_PORT_COM_INT(port) (CDC_COM_INT + ((port) << 1))
+#define CDC_EP_PORT(ep)        (((ep) - 1) >> 1)
+#define CDC_INT_PORT(intf)     (((intf) - CDC_COM_INT) >> 1)
+
+// cdc_port_control_line_state() bits, from SET_CONTROL_LINE_STATE wValue.
+#define CDC_PORT_DTR 0x01
+#define CDC_PORT_RTS 0x02
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ PORT FUNCTION DESCRIPTORS *********************** */
+/* ************************************************************************** */
+
+/*
+ * Initializer for the cdc_function_descriptors_t of port, see 
+ * CDC_FUNCTION_DESCRIPTORS() in usb_cdc.h. com_interval is the COM EP's bInterval.
+ */
+#define CDC_PORT_FUNCTION_DESCRIPTORS(port, com_interval) \
+{ \
+    CH9_INTERFACE_ASSOCIATION_DESCRIPTOR(CDC_PORT_COM_INT(port), 2, CIC_CODE, CIC_ACM, CIC_V25TER), \
+    CH9_INTERFACE_DESCRIPTOR(CDC_PORT_COM_INT(port), 0, 1, CIC_CODE, CIC_ACM, CIC_V25TER), \
+    {5, CS_INTERFACE, DESC_SUB_HEADER, 0x0110}, \
+    {4, CS_INTERFACE, DESC_SUB_ACM, 0x02}, \
+    {5, CS_INTERFACE, DESC_SUB_UNION, CDC_PORT_COM_INT(port), {CDC_PORT_COM_INT(port) + 1}}, \
+    {5, CS_INTERFACE, DESC_SUB_CM, 0x00, CDC_PORT_COM_INT(port) + 1}, \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(CDC_PORT_COM_EP(port)), EP_INTERRUPT, CDC_COM_EP_SIZE, (com_interval)), \
+    CH9_INTERFACE_DESCRIPTOR(CDC_PORT_COM_INT(port) + 1, 0, 2, DIC_CODE, 0x00, DIC_NONE), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_OUT_ADDR(CDC_PORT_DAT_EP(port)), EP_BULK, CDC_DAT_EP_SIZE, 0), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(CDC_PORT_DAT_EP(port)), EP_BULK, CDC_DAT_EP_SIZE, 0) \
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** PORT FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void cdc_port_init(void)
+ * 
+ * @brief Used to initialize every CDC port.
+ * 
+ * BDs and Endpoints are setup, the rings emptied, the line coding set to 
+ * STARTING_BAUD/STOP_BITS/PARITY/DATA_BITS, and the OUT buffers armed.
+ */
+void cdc_port_init(void);
+
+/**
+ * @fn void cdc_port_tasks(void)
+ * 
+ * @brief Services the transaction on TRANSACTION_EP, place in usb_app_tasks().
+ */
+void cdc_port_tasks(void);
+
+/**
+ * @fn void cdc_port_com_ep_in_tasks(void)
+ * 
+ * @brief COM Endpoint handler of every port, for g_usb_ep_handlers.
+ */
+void cdc_port_com_ep_in_tasks(void);
+
+/**
+ * @fn void cdc_port_dat_ep_out_tasks(void)
+ * 
+ * @brief DATA OUT Endpoint handler of every port, for g_usb_ep_handlers.
+ */
+void cdc_port_dat_ep_out_tasks(void);
+
+/**
+ * @fn void cdc_port_dat_ep_in_tasks(void)
+ * 
+ * @brief DATA IN Endpoint handler of every port, for g_usb_ep_handlers.
+ */
+void cdc_port_dat_ep_in_tasks(void);
+
+/**
+ * @fn bool cdc_port_class_request(void)
+ * 
+ * @brief Services the ACM Class Requests, for the port of the COM interface 
+ * in wIndex.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+bool cdc_port_class_request(void);
+
+/**
+ * @fn bool cdc_port_out_control_tasks(void)
+ * 
+ * @brief Finishes SET_LINE_CODING once its data stage is in, place in 
+ * usb_out_control_finished().
+ * 
+ * @return Returns true if the data stage was for a CDC port.
+ */
+bool cdc_port_out_control_tasks(void);
+
+/**
+ * @fn void cdc_port_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+ * 
+ * @brief Clears a halt on one of the ports' Endpoints.
+ * 
+ * A DATA OUT halt drops the received packets not yet in the RX ring, a DATA 
+ * IN halt drops the packets armed but not sent.
+ * 
+ * @param[in] bdt_index Buffer Descriptor Index.
+ * @param[in] ep Endpoint number.
+ * @param[in] dir Endpoint direction.
+ */
+void cdc_port_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir);
+
+/**
+ * @fn uint8_t cdc_port_available(uint8_t port)
+ * 
+ * @brief Gets the amount of bytes waiting in the port's RX ring.
+ * 
+ * @param[in] port Port number, 0 to CDC_NUM_PORTS - 1.
+ */
+uint8_t cdc_port_available(uint8_t port);
+
+/**
+ * @fn uint8_t cdc_port_read(uint8_t port, uint8_t* p_data, uint8_t len)
+ * 
+ * @brief Takes up to len bytes from the port's RX ring.
+ * 
+ * @param[in] port Port number.
+ * @param[out] p_data Where to place the data.
+ * @param[in] len Max amount of bytes to take.
+ * 
+ * @return Returns the amount of bytes taken.
+ */
+uint8_t cdc_port_read(uint8_t port, uint8_t* p_data, uint8_t len);
+
+/**
+ * @fn uint8_t cdc_port_write(uint8_t port, const uint8_t* p_data, uint8_t len)
+ * 
+ * @brief Places up to len bytes in the port's TX ring.
+ * 
+ * Full packets are sent as soon as an IN buffer is free, cdc_port_flush() 
+ * sends what's left over.
+ * 
+ * @param[in] port Port number.
+ * @param[in] p_data Data to send.
+ * @param[in] len Amount of bytes to send.
+ * 
+ * @return Returns the amount of bytes placed in the TX ring.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t buffer[CDC_DAT_EP_SIZE];
+ * uint8_t cnt = cdc_port_tx_space(1);
+ * if(cnt > sizeof(buffer)) cnt = sizeof(buffer);
+ * cnt = cdc_port_read(0, buffer, cnt); // Port 0 to port 1.
+ * cdc_port_write(1, buffer, cnt);
+ * cdc_port_flush(1);
+ * @endcode
+ * </li></ul>
+ */
+uint8_t cdc_port_write(uint8_t port, const uint8_t* p_data, uint8_t len);
+
+/**
+ * @fn uint8_t cdc_port_tx_space(uint8_t port)
+ * 
+ * @brief Gets the amount of bytes cdc_port_write() can take on the port now.
+ * 
+ * @param[in] port Port number.
+ */
+uint8_t cdc_port_tx_space(uint8_t port);
+
+/**
+ * @fn void cdc_port_flush(uint8_t port)
+ * 
+ * @brief Sends everything in the port's TX ring, ending with a short packet 
+ * (a Zero Length Packet if the last one was full).
+ * 
+ * @param[in] port Port number.
+ */
+void cdc_port_flush(uint8_t port);
+
+#ifdef USE_SOF
+/**
+ * @fn void cdc_port_service_sof(void)
+ * 
+ * @brief Flushes each port's TX ring once nothing has been written to it for 
+ * CDC_TX_FLUSH_FRAMES frames. Place in usb_sof().
+ */
+void cdc_port_service_sof(void);
+#endif
+
+/**
+ * @fn bool cdc_port_line_coding(uint8_t port, cdc_get_line_coding_return_t* p_line_coding)
+ * 
+ * @brief Gets the port's line coding, last set by SET_LINE_CODING.
+ * 
+ * @param[in] port Port number.
+ * @param[out] p_line_coding Where to place the line coding.
+ * 
+ * @return Returns true if the host has changed it since the last call, e.g. 
+ * to set a bridged UART's baud rate.
+ */
+bool cdc_port_line_coding(uint8_t port, cdc_get_line_coding_return_t* p_line_coding);
+
+/**
+ * @fn uint8_t cdc_port_control_line_state(uint8_t port)
+ * 
+ * @brief Gets the port's CDC_PORT_DTR and CDC_PORT_RTS bits, last set by 
+ * SET_CONTROL_LINE_STATE.
+ * 
+ * @param[in] port Port number.
+ */
+uint8_t cdc_port_control_line_state(uint8_t port);
+
+/* ************************************************************************** */
+
+#endif /* USB_CDC_PORTS_H */
@@ -0,0 +1,281 @@
+/**
+ * @file usb_cdc_rpc.c
+ * @brief Contains <i>CDC RPC</i> framing functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - CDC RPC Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_cdc.h"
+#include "usb_cdc_rpc.h"
+
+/* ************************************************************************** */
+/* ****************************** LOCAL DEFINES ***************************** */
+/* ************************************************************************** */
+
+#define FRAME_SIZE   (CDC_RPC_MAX_PAYLOAD + CDC_RPC_OVERHEAD) // Decoded, up to 253.
+#define ENCODED_SIZE (FRAME_SIZE + 1)                         // One COBS code byte, the frame is one block.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** GLOBAL VARS ******************************* */
+/* ************************************************************************** */
+
+uint16_t g_cdc_rpc_errors;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+static uint8_t m_rx[ENCODED_SIZE + 1]; // Encoded bytes of the next request and its 0x00, decoded in place.
+static uint8_t m_rx_len;
+static uint8_t m_rx_scanned;           // Bytes of m_rx already checked for the 0x00.
+static bool    m_rx_skip;              // Overflowed, dropping bytes up to the next 0x00.
+static uint8_t m_tx[ENCODED_SIZE + 1]; // Response, encoded in place, with the 0x00.
+static uint8_t m_tx_len;               // Bytes of m_tx not yet in the TX ring.
+static uint8_t m_tx_pos;
+static bool    m_tx_unflushed;         // Responses written since the last cdc_flush().
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn uint16_t crc16(const uint8_t* p_data, uint8_t len)
+ * 
+ * @brief CRC-16/CCITT-FALSE, without a table.
+ */
+static uint16_t crc16(const uint8_t* p_data, uint8_t len);
+
+/**
+ * @fn uint8_t cobs_decode(uint8_t len)
+ * 
+ * @brief Decodes the len bytes of m_rx in place.
+ * 
+ * @return Returns the decoded length, 0 for a bad code byte.
+ */
+static uint8_t cobs_decode(uint8_t len);
+
+/**
+ * @fn void cobs_encode(uint8_t len)
+ * 
+ * @brief Encodes the frame at m_tx[1] to m_tx[len] in place, code byte in m_tx[0], 
+ * then adds the 0x00 and sets m_tx_len.
+ */
+static void cobs_encode(uint8_t len);
+
+/**
+ * @fn void service_frame(uint8_t len)
+ * 
+ * @brief Checks the len encoded bytes in m_rx, runs the handler and encodes the 
+ * response into m_tx.
+ */
+static void service_frame(uint8_t len);
+
+/**
+ * @fn bool send_response(void)
+ * 
+ * @brief Writes what's left of m_tx to the TX ring.
+ * 
+ * @return Returns true once all of it is in.
+ */
+static bool send_response(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** CDC RPC FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+void cdc_rpc_init(void)
+{
+    m_rx_len  = 0;
+    m_rx_scanned = 0;
+    m_rx_skip = false;
+    m_tx_len  = 0;
+    m_tx_unflushed = false;
+}
+
+void cdc_rpc_tasks(void)
+{
+    uint8_t i, left;
+    
+    while(1)
+    {
+        if(m_tx_len && !send_response()) return; // TX ring full, the rest waits.
+        
+        if(m_rx_scanned == m_rx_len)
+        {
+            i = cdc_read(&m_rx[m_rx_len], sizeof(m_rx) - m_rx_len);
+            if(i == 0) break;
+            m_rx_len += i;
+        }
+        for(i = m_rx_scanned; i < m_rx_len; i++) if(m_rx[i] == 0) break;
+        
+        if(i == m_rx_len) // No delimiter yet.
+        {
+            m_rx_scanned = i;
+            if(m_rx_len == sizeof(m_rx))
+            {
+                if(!m_rx_skip) g_cdc_rpc_errors++;
+                m_rx_len = m_rx_scanned = 0;
+                m_rx_skip = true;
+            }
+            continue;
+        }
+        
+        if(m_rx_skip) m_rx_skip = false;
+        else if(i) service_frame(i);
+        
+        // Whatever came after the delimiter is the start of the next request.
+        left = m_rx_len - (i + 1);
+        for(m_rx_len = 0; m_rx_len < left; m_rx_len++) m_rx[m_rx_len] = m_rx[i + 1 + m_rx_len];
+        m_rx_scanned = 0;
+    }
+    
+    // The RX ring is drained, send the batch of responses.
+    if(m_tx_unflushed)
+    {
+        cdc_flush();
+        m_tx_unflushed = false;
+    }
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static uint16_t crc16(const uint8_t* p_data, uint8_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint8_t  x;
+    
+    while(len--)
+    {
+        x = (uint8_t)(crc >> 8) ^ *p_data++;
+        x ^= x >> 4;
+        crc = (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+    }
+    return crc;
+}
+
+static uint8_t cobs_decode(uint8_t len)
+{
+    uint8_t in = 0, out = 0, code, n;
+    
+    while(in < len)
+    {
+        code = m_rx[in++];
+        if(code == 0 || (uint8_t)(len - in) < (uint8_t)(code - 1)) return 0;
+        for(n = code - 1; n; n--) m_rx[out++] = m_rx[in++];
+        if(code != 0xFF && in < len) m_rx[out++] = 0;
+    }
+    return out;
+}
+
+static void cobs_encode(uint8_t len)
+{
+    uint8_t code_pos = 0, code = 1, i;
+    
+    // Output and input line up, the one byte of overhead is m_tx[0].
+    for(i = 1; i <= len; i++)
+    {
+        if(m_tx[i] == 0)
+        {
+            m_tx[code_pos] = code;
+            code_pos = i;
+            code = 1;
+        }
+        else code++;
+    }
+    m_tx[code_pos] = code;
+    m_tx[len + 1]  = 0;
+    m_tx_len = len + 2;
+    m_tx_pos = 0;
+}
+
+static void service_frame(uint8_t len)
+{
+    uint8_t  command, resp_len = 0, status;
+    uint16_t crc;
+    
+    len = cobs_decode(len);
+    if(len < CDC_RPC_OVERHEAD)
+    {
+        g_cdc_rpc_errors++;
+        return;
+    }
+    len -= 2;
+    crc = crc16(m_rx, len);
+    if(m_rx[len] != (uint8_t)crc || m_rx[len + 1] != (uint8_t)(crc >> 8))
+    {
+        g_cdc_rpc_errors++;
+        return;
+    }
+    
+    command = m_rx[1];
+    if(command < CDC_RPC_NUM_COMMANDS && g_cdc_rpc_handlers[command])
+    {
+        status = g_cdc_rpc_handlers[command](&m_rx[2], len - 2, &m_tx[3], &resp_len);
+        if(resp_len > CDC_RPC_MAX_PAYLOAD)
+        {
+            status   = CDC_RPC_ERR_LENGTH;
+            resp_len = 0;
+        }
+    }
+    else status = CDC_RPC_ERR_COMMAND;
+    
+    m_tx[1] = m_rx[0]; // seq
+    m_tx[2] = status;
+    crc = crc16(&m_tx[1], resp_len + 2);
+    m_tx[resp_len + 3] = (uint8_t)crc;
+    m_tx[resp_len + 4] = (uint8_t)(crc >> 8);
+    cobs_encode(resp_len + CDC_RPC_OVERHEAD);
+}
+
+static bool send_response(void)
+{
+    m_tx_pos += cdc_write(&m_tx[m_tx_pos], m_tx_len - m_tx_pos);
+    if(m_tx_pos != m_tx_len) return false;
+    m_tx_len = 0;
+    m_tx_unflushed = true;
+    return true;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,186 @@
+/**
+ * @file usb_cdc_rpc.h
+ * @brief <i>CDC RPC</i> framing definitions, global variable and function declarations.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - CDC RPC Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_CDC_RPC_H
+#define USB_CDC_RPC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_cdc.h"
+#include "usb_cdc_rpc_config.h"
+
+/*
+ * Binary requests and responses over the CDC rings, for host tools that would 
+ * otherwise send one text command per round trip (see Tools/CDC_RPC).
+ * 
+ * Each message is COBS encoded and ends with a 0x00, so a frame boundary can 
+ * always be found again after a lost or corrupt byte:
+ * 
+ * Request:  COBS([seq][command][data...][CRC LSB][CRC MSB]) 0x00
+ * Response: COBS([seq][status][data...][CRC LSB][CRC MSB]) 0x00
+ * 
+ * The CRC is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of everything 
+ * before it. seq is chosen by the host and copied into the response, so the 
+ * host can keep many requests in flight and match the responses up. 
+ * Requests are answered in order. Responses are written to the TX ring 
+ * back to back and only flushed once the RX ring is empty, so a burst of 
+ * requests gets its responses in full CDC_DAT_EP_SIZE packets.
+ * 
+ * Frames with a bad CRC, too short or too long are dropped and counted in 
+ * g_cdc_rpc_errors, the host times the request out.
+ */
+
+/* ************************************************************************** */
+/* ************************** WARNING FOR SETTINGS ************************** */
+/* ************************************************************************** */
+
+#ifndef USE_CDC_RINGS
+#error "The CDC RPC library reads and writes the CDC rings, define USE_CDC_RINGS in usb_cdc_config.h."
+#endif
+
+#if (CDC_RPC_MAX_PAYLOAD < 1) || (CDC_RPC_MAX_PAYLOAD > 249)
+#error "CDC_RPC_MAX_PAYLOAD must be 1 to 249, a whole frame has to be one COBS block."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** CDC RPC DEFINES ****************************** */
+/* ************************************************************************** */
+
+/// Response status values from the library, handlers use 0 to 0xEF.
+#define CDC_RPC_OK          0x00
+#define CDC_RPC_ERR_COMMAND 0xF0 // No handler for the command.
+#define CDC_RPC_ERR_LENGTH  0xF1 // Handler gave more than CDC_RPC_MAX_PAYLOAD bytes.
+
+/// Bytes around the data: seq, command/status and the CRC.
+#define CDC_RPC_OVERHEAD 4
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** CDC RPC TYPES ****************************** */
+/* ************************************************************************** */
+
+/**
+ * Command Handler Type
+ * 
+ * p_req/req_len are the request data, the handler writes up to 
+ * CDC_RPC_MAX_PAYLOAD bytes of response data to p_resp and sets *p_resp_len 
+ * (0 on entry). Returns the response status, CDC_RPC_OK or its own error code.
+ */
+typedef uint8_t (*cdc_rpc_handler_t)(const uint8_t* p_req, uint8_t req_len, uint8_t* p_resp, uint8_t* p_resp_len);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ VARS FROM: usb_cdc_rpc.c ************************ */
+/* ************************************************************************** */
+
+extern uint16_t g_cdc_rpc_errors; ///< Frames dropped for a bad CRC, length or COBS code, wraps.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** CDC RPC FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void cdc_rpc_init(void)
+ * 
+ * @brief Drops any partly received request and response.
+ * 
+ * Call after cdc_init(), in usb_app_init().
+ */
+void cdc_rpc_init(void);
+
+/**
+ * @fn void cdc_rpc_tasks(void)
+ * 
+ * @brief Decodes the requests in the RX ring, runs their handlers and writes 
+ * the responses to the TX ring.
+ * 
+ * Place in the main loop. While a response doesn't fit in the TX ring no more 
+ * requests are taken, the RX ring then fills and the host is NAKed.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * while(1)
+ * {
+ *     if(usb_get_state() == STATE_CONFIGURED) cdc_rpc_tasks();
+ * }
+ * @endcode
+ * </li></ul>
+ */
+void cdc_rpc_tasks(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ FUNCTIONS FROM THE APP ************************** */
+/* ************************************************************************** */
+
+/**
+ * @var g_cdc_rpc_handlers
+ * @brief Command Handler Table, indexed by command, defined by your program.
+ * 
+ * Handlers run from cdc_rpc_tasks(). Unused entries are NULL and answered 
+ * with CDC_RPC_ERR_COMMAND.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * static uint8_t read_adc(const uint8_t* p_req, uint8_t req_len, uint8_t* p_resp, uint8_t* p_resp_len)
+ * {
+ *     uint16_t value = adc_read(p_req[0]);
+ *     p_resp[0] = (uint8_t)value;
+ *     p_resp[1] = (uint8_t)(value >> 8);
+ *     *p_resp_len = 2;
+ *     return CDC_RPC_OK;
+ * }
+ * 
+ * const cdc_rpc_handler_t g_cdc_rpc_handlers[CDC_RPC_NUM_COMMANDS] =
+ * {
+ *     [0] = echo,
+ *     [1] = read_adc
+ * };
+ * @endcode
+ * </li></ul>
+ */
+extern const cdc_rpc_handler_t g_cdc_rpc_handlers[CDC_RPC_NUM_COMMANDS];
+
+/* ************************************************************************** */
+
+#endif /* USB_CDC_RPC_H */
@@ -99,6 +99,28 @@
 #define DEVICE_QUALIFIER_DESC          6
 #define OTHER_SPEED_CONFIGURATION_DESC 7
 #define INTERFACE_POWER_DESC           8
+#define INTERFACE_ASSOCIATION_DESC     11
+#define BOS_DESC                       15
+#define DEVICE_CAPABILITY_DESC         16
+
+/// Device Capability Types (bDevCapabilityType)
+#define PLATFORM_CAPABILITY 0x05
+
+/// Endpoint Transfer Types (bmAttributes D1...0)
+#define EP_CONTROL     0x00
+#define EP_ISOCHRONOUS 0x01
+#define EP_BULK        0x02
+#define EP_INTERRUPT   0x03
+
+/// Endpoint Synchronization Types (bmAttributes D3...2), Isochronous only
+#define EP_NO_SYNC      0x00
+#define EP_ASYNCHRONOUS 0x04
+#define EP_ADAPTIVE     0x08
+#define EP_SYNCHRONOUS  0x0C
+
+/// Endpoint Addresses (bEndpointAddress)
+#define EP_OUT_ADDR(ep) (ep)
+#define EP_IN_ADDR(ep)  (0x80 | (ep))
 
 /* ************************************************************************** */
 
@@ -112,6 +134,12 @@
 #define CDC 2
 #define HID 3
 #define MSC 8
+#define MISC_CLASS   0xEF
+#define VENDOR_CLASS 0xFF
+
+/// Miscellaneous Class, Interface Association Descriptor SubClass and Protocol
+#define MISC_COMMON_SUBCLASS 0x02
+#define MISC_IAD_PROTOCOL    0x01
 
 /* ************************************************************************** */
 
@@ -396,6 +424,156 @@ typedef struct
     uint8_t  bInterval;
 }ch9_standard_endpoint_descriptor_t;
 
+/// Interface Association Descriptor Structure
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bFirstInterface;
+    uint8_t  bInterfaceCount;
+    uint8_t  bFunctionClass;
+    uint8_t  bFunctionSubClass;
+    uint8_t  bFunctionProtocol;
+    uint8_t  iFunction;
+}ch9_interface_association_descriptor_t;
+
+/// Binary Device Object Store (BOS) Descriptor Structure
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t wTotalLength;
+    uint8_t  bNumDeviceCaps;
+}ch9_bos_descriptor_t;
+
+/// MS OS 2.0 Platform Capability Descriptor Structure (a Device Capability in the BOS)
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDevCapabilityType;
+    uint8_t  bReserved;
+    uint8_t  PlatformCapabilityUUID[16];
+    uint32_t dwWindowsVersion;
+    uint16_t wMSOSDescriptorSetTotalLength;
+    uint8_t  bMS_VendorCode;
+    uint8_t  bAltEnumCode;
+}ch9_ms_os_20_platform_descriptor_t;
+
+/// MS OS 2.0 Descriptor Set Header Structure
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint32_t dwWindowsVersion;
+    uint16_t wTotalLength;
+}ms_os_20_set_header_descriptor_t;
+
+/// MS OS 2.0 Compatible ID Descriptor Structure
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint8_t  CompatibleID[8];
+    uint8_t  SubCompatibleID[8];
+}ms_os_20_compatible_id_descriptor_t;
+
+/// MS OS 2.0 Registry Property Descriptor Structure, for the DeviceInterfaceGUIDs property
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint16_t wPropertyDataType;
+    uint16_t wPropertyNameLength;
+    uint16_t PropertyName[21];     // L"DeviceInterfaceGUIDs"
+    uint16_t wPropertyDataLength;
+    uint16_t PropertyData[40];     // L"{xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx}\0", REG_MULTI_SZ
+}ms_os_20_guid_property_descriptor_t;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** MS OS 2.0 DEFINES **************************** */
+/* ************************************************************************** */
+
+/*
+ * A device with a BOS (bcdUSB 0x0201 or above) holding the MS OS 2.0 Platform 
+ * Capability is asked for its MS OS 2.0 Descriptor Set by Windows 8.1 and 
+ * later with a vendor request: bmRequestType 0xC0, bRequest bMS_VendorCode, 
+ * wIndex MS_OS_20_DESCRIPTOR_INDEX. A Compatible ID of "WINUSB" binds WinUSB 
+ * without an INF, DeviceInterfaceGUIDs is the GUID the Application opens.
+ */
+#define MS_OS_20_DESCRIPTOR_INDEX    0x07
+#define MS_OS_20_SET_ALT_ENUMERATION 0x08
+
+#define MS_OS_20_SET_HEADER_DESCRIPTOR       0x00
+#define MS_OS_20_SUBSET_HEADER_CONFIGURATION 0x01
+#define MS_OS_20_SUBSET_HEADER_FUNCTION      0x02
+#define MS_OS_20_FEATURE_COMPATIBLE_ID       0x03
+#define MS_OS_20_FEATURE_REG_PROPERTY        0x04
+
+#define MS_OS_20_REG_MULTI_SZ   0x0007
+#define MS_OS_20_WINDOWS_8_1    0x06030000UL
+
+#define MS_OS_20_PLATFORM_UUID  {0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C, \
+                                 0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F} // {D8DD60DF-4589-4CC7-9CD2-659D9E648A9F}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** DESCRIPTOR BUILDER **************************** */
+/* ************************************************************************** */
+
+/*
+ * Initializers for the structures above, so a configuration can be put 
+ * together from the function descriptor blocks of each class library 
+ * (CDC_FUNCTION_DESCRIPTORS(), MSD_FUNCTION_DESCRIPTORS() and 
+ * HID_FUNCTION_DESCRIPTORS()). A function with more than one interface starts 
+ * with an Interface Association Descriptor, so the host binds one driver to 
+ * all of them. The Device Descriptor of a configuration using IADs must use 
+ * MISC_CLASS, MISC_COMMON_SUBCLASS and MISC_IAD_PROTOCOL.
+ * 
+ * Code Example:
+ * typedef struct
+ * {
+ *     ch9_configutarion_descriptor_t configuration0_descriptor;
+ *     cdc_function_descriptors_t     cdc;
+ *     msd_function_descriptors_t     msd;
+ * }config_descriptor_t;
+ * 
+ * static const config_descriptor_t config_descriptor0 =
+ * {
+ *     CH9_CONFIGURATION_DESCRIPTOR(sizeof(config_descriptor0), NUM_INTERFACES, 1, 0xC0, 50),
+ *     CDC_FUNCTION_DESCRIPTORS(2),
+ *     MSD_FUNCTION_DESCRIPTORS()
+ * };
+ */
+#define CH9_CONFIGURATION_DESCRIPTOR(total_length, num_interfaces, value, attributes, max_power) \
+    {9, CONFIGURATION_DESC, (total_length), (num_interfaces), (value), 0, (attributes), (max_power)}
+
+#define CH9_INTERFACE_ASSOCIATION_DESCRIPTOR(first_interface, interface_count, function_class, function_subclass, function_protocol) \
+    {8, INTERFACE_ASSOCIATION_DESC, (first_interface), (interface_count), (function_class), (function_subclass), (function_protocol), 0}
+
+#define CH9_INTERFACE_DESCRIPTOR(number, alternate_setting, num_endpoints, interface_class, interface_subclass, interface_protocol) \
+    {9, INTERFACE_DESC, (number), (alternate_setting), (num_endpoints), (interface_class), (interface_subclass), (interface_protocol), 0}
+
+#define CH9_ENDPOINT_DESCRIPTOR(address, attributes, max_packet_size, interval) \
+    {7, ENDPOINT_DESC, (address), (attributes), (max_packet_size), (interval)}
+
+#define CH9_BOS_DESCRIPTOR(total_length, num_device_caps) \
+    {5, BOS_DESC, (total_length), (num_device_caps)}
+
+#define CH9_MS_OS_20_PLATFORM_DESCRIPTOR(set_total_length, vendor_code) \
+    {28, DEVICE_CAPABILITY_DESC, PLATFORM_CAPABILITY, 0, MS_OS_20_PLATFORM_UUID, MS_OS_20_WINDOWS_8_1, (set_total_length), (vendor_code), 0}
+
+#define MS_OS_20_SET_HEADER(total_length) \
+    {10, MS_OS_20_SET_HEADER_DESCRIPTOR, MS_OS_20_WINDOWS_8_1, (total_length)}
+
+#define MS_OS_20_WINUSB_COMPATIBLE_ID() \
+    {20, MS_OS_20_FEATURE_COMPATIBLE_ID, {'W','I','N','U','S','B',0,0}, {0,0,0,0,0,0,0,0}}
+
 /* ************************************************************************** */
 
 #endif /* USB_CH9_H */
\ No newline at end of file
@@ -0,0 +1,390 @@
+/**
+ * @file usb_dfu.c
+ * @brief Contains <i>DFU Class</i> functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - DFU Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_dfu.h"
+#include "usb_ch9.h"
+
+/* ************************************************************************** */
+/* ****************************** LOCAL DEFINES ***************************** */
+/* ************************************************************************** */
+
+// bmRequestType of a Class Request to an interface.
+#define DFU_REQUEST_OUT 0x21
+#define DFU_REQUEST_IN  0xA1
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************* DFU BUFFERS ****************************** */
+/* ************************************************************************** */
+
+#ifndef DFU_RUNTIME
+uint8_t g_dfu_blocks[2][DFU_TRANSFER_SIZE];
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+/** DFU_GETSTATUS response */
+static struct
+{
+    uint8_t bStatus;
+    uint8_t bwPollTimeout[3];
+    uint8_t bState;
+    uint8_t iString;
+}m_status;
+
+#ifdef DFU_RUNTIME
+static bool     m_detach;       // DFU_DETACH seen, dfu_detach() is due.
+static uint16_t m_detach_frame; // Frame number of the DFU_DETACH.
+#else
+static uint8_t           m_rx_block;       // g_dfu_blocks[] the next DFU_DNLOAD lands in.
+static uint16_t          m_rx_block_num;   // wValue of the block received.
+static uint16_t          m_rx_bytes;       // wLength of the block received.
+static volatile bool     m_busy;           // dfu_tasks() has a block (or the manifestation) to do.
+static uint8_t           m_prog_block;     // g_dfu_blocks[] being programmed.
+static uint16_t          m_prog_block_num;
+static uint16_t          m_prog_bytes;     // 0 runs dfu_manifest().
+static bool              m_manifest_queued;
+static volatile uint8_t  m_prog_status;    // Result of the last dfu_program_block()/dfu_manifest().
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn bool get_status(void)
+ * 
+ * @brief Sends the 6 byte DFU_GETSTATUS response, in DFU mode this is where 
+ * a received block is queued and the state moves on.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+static bool get_status(void);
+
+/**
+ * @fn void send_status(uint8_t state, uint8_t poll_timeout)
+ * 
+ * @brief Fills in m_status and starts the IN data stage.
+ * 
+ * @param[in] state bState, also the new state.
+ * @param[in] poll_timeout bwPollTimeout in mS.
+ */
+static void send_status(uint8_t state, uint8_t poll_timeout);
+
+#ifndef DFU_RUNTIME
+/**
+ * @fn bool dnload(void)
+ * 
+ * @brief Starts the data stage of a DFU_DNLOAD, or the manifestation for the 
+ * zero length one at the end.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+static bool dnload(void);
+
+#ifdef DFU_USE_UPLOAD
+/**
+ * @fn bool upload(void)
+ * 
+ * @brief Sends one block from dfu_upload_block().
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+static bool upload(void);
+#endif
+
+/**
+ * @fn bool stalled(void)
+ * 
+ * @brief Moves to dfuERROR with errSTALLEDPKT, for a request the state doesn't allow.
+ * 
+ * @return Returns false, so the request is stalled.
+ */
+static bool stalled(void);
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** DFU FUNCTIONS ****************************** */
+/* ************************************************************************** */
+
+void dfu_init(void)
+{
+    #ifdef DFU_RUNTIME
+    m_status.bState  = DFU_STATE_APP_IDLE;
+    m_detach = false;
+    #else
+    m_status.bState  = DFU_STATE_DFU_IDLE;
+    m_rx_block = 0;
+    m_busy = false;
+    m_manifest_queued = false;
+    m_prog_status = DFU_STATUS_OK;
+    #endif
+    m_status.bStatus = DFU_STATUS_OK;
+}
+
+bool dfu_class_request(void)
+{
+    if((uint8_t)g_usb_setup.wIndex != DFU_INT) return false;
+    
+    #ifdef DFU_RUNTIME
+    switch(g_usb_setup.bRequest)
+    {
+        case DFU_DETACH:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_OUT || m_status.bState != DFU_STATE_APP_IDLE) return false;
+            m_status.bState = DFU_STATE_APP_DETACH;
+            m_detach_frame = usb_get_frame_number();
+            m_detach = true;
+            usb_arm_in_status();
+            return true;
+        case DFU_GETSTATUS:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_IN) return false;
+            return get_status();
+        case DFU_GETSTATE:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_IN) return false;
+            usb_set_ram_ptr(&m_status.bState);
+            usb_setup_in_control_transfer(RAM, 1, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        default:
+            return false;
+    }
+    #else
+    switch(g_usb_setup.bRequest)
+    {
+        case DFU_DNLOAD:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_OUT) return false;
+            return dnload();
+        #ifdef DFU_USE_UPLOAD
+        case DFU_UPLOAD:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_IN) return false;
+            return upload();
+        #endif
+        case DFU_GETSTATUS:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_IN) return false;
+            return get_status();
+        case DFU_CLRSTATUS:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_OUT) return false;
+            if(m_status.bState != DFU_STATE_DFU_ERROR) return stalled();
+            m_status.bState  = DFU_STATE_DFU_IDLE;
+            m_status.bStatus = DFU_STATUS_OK;
+            m_prog_status    = DFU_STATUS_OK;
+            usb_arm_in_status();
+            return true;
+        case DFU_GETSTATE:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_IN) return false;
+            usb_set_ram_ptr(&m_status.bState);
+            usb_setup_in_control_transfer(RAM, 1, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        case DFU_ABORT:
+            if(g_usb_setup.bmRequestType != DFU_REQUEST_OUT) return false;
+            switch(m_status.bState)
+            {
+                case DFU_STATE_DFU_IDLE:
+                case DFU_STATE_DFU_DNLOAD_SYNC:
+                case DFU_STATE_DFU_DNLOAD_IDLE:
+                case DFU_STATE_DFU_MANIFEST_SYNC:
+                case DFU_STATE_DFU_UPLOAD_IDLE:
+                    m_status.bState = DFU_STATE_DFU_IDLE; // A block already queued is still written.
+                    usb_arm_in_status();
+                    return true;
+                default:
+                    return stalled();
+            }
+        default:
+            return stalled();
+    }
+    #endif
+}
+
+#ifndef DFU_RUNTIME
+bool dfu_out_control_finished(void)
+{
+    if(g_usb_setup.bmRequestType != DFU_REQUEST_OUT || g_usb_setup.bRequest != DFU_DNLOAD) return false;
+    m_status.bState = DFU_STATE_DFU_DNLOAD_SYNC;
+    return true;
+}
+#endif
+
+void dfu_tasks(void)
+{
+    #ifdef DFU_RUNTIME
+    if(m_detach && ((usb_get_frame_number() - m_detach_frame) & 0x7FF) >= DFU_DETACH_FRAMES)
+    {
+        m_detach = false;
+        dfu_detach();
+    }
+    #else
+    uint8_t status;
+    
+    if(!m_busy) return;
+    if(m_prog_bytes) status = dfu_program_block(m_prog_block_num, g_dfu_blocks[m_prog_block], m_prog_bytes);
+    else status = dfu_manifest();
+    if(status != DFU_STATUS_OK) m_prog_status = status; // Reported by the next DFU_GETSTATUS.
+    m_busy = false;
+    #endif
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static bool get_status(void)
+{
+    #ifdef DFU_RUNTIME
+    send_status(m_status.bState, 0);
+    #else
+    if(m_prog_status != DFU_STATUS_OK)
+    {
+        m_status.bStatus = m_prog_status;
+        send_status(DFU_STATE_DFU_ERROR, 0);
+        return true;
+    }
+    
+    switch(m_status.bState)
+    {
+        case DFU_STATE_DFU_DNLOAD_SYNC:
+        case DFU_STATE_DFU_DNBUSY:
+            if(m_busy) // The block before is still being written, the new one waits in the other buffer.
+            {
+                send_status(DFU_STATE_DFU_DNBUSY, DFU_POLL_TIMEOUT);
+                break;
+            }
+            m_prog_block     = m_rx_block;
+            m_prog_block_num = m_rx_block_num;
+            m_prog_bytes     = m_rx_bytes;
+            m_rx_block ^= 1;
+            m_busy = true;
+            send_status(DFU_STATE_DFU_DNLOAD_IDLE, 0); // The next block can come straight away.
+            break;
+        case DFU_STATE_DFU_MANIFEST_SYNC:
+        case DFU_STATE_DFU_MANIFEST:
+            if(m_manifest_queued && !m_busy)
+            {
+                m_manifest_queued = false;
+                send_status(DFU_STATE_DFU_IDLE, 0); // Manifestation tolerant.
+                break;
+            }
+            if(!m_busy)
+            {
+                m_prog_bytes = 0;
+                m_manifest_queued = true;
+                m_busy = true;
+            }
+            send_status(DFU_STATE_DFU_MANIFEST, DFU_POLL_TIMEOUT);
+            break;
+        default:
+            send_status(m_status.bState, 0);
+            break;
+    }
+    #endif
+    return true;
+}
+
+static void send_status(uint8_t state, uint8_t poll_timeout)
+{
+    m_status.bState           = state;
+    m_status.bwPollTimeout[0] = poll_timeout;
+    m_status.bwPollTimeout[1] = 0;
+    m_status.bwPollTimeout[2] = 0;
+    m_status.iString          = 0;
+    usb_set_ram_ptr((uint8_t*)&m_status);
+    usb_setup_in_control_transfer(RAM, sizeof(m_status), g_usb_setup.wLength);
+    usb_start_in_control_transfer();
+}
+
+#ifndef DFU_RUNTIME
+static bool dnload(void)
+{
+    if(m_status.bState != DFU_STATE_DFU_IDLE && m_status.bState != DFU_STATE_DFU_DNLOAD_IDLE) return stalled();
+    
+    if(g_usb_setup.wLength == 0)
+    {
+        if(m_status.bState == DFU_STATE_DFU_IDLE) return stalled(); // Nothing was sent.
+        m_status.bState = DFU_STATE_DFU_MANIFEST_SYNC;
+        m_manifest_queued = false;
+        usb_arm_in_status();
+        return true;
+    }
+    if(g_usb_setup.wLength > DFU_TRANSFER_SIZE) return stalled();
+    
+    m_rx_block_num = g_usb_setup.wValue;
+    m_rx_bytes     = g_usb_setup.wLength;
+    usb_set_ram_ptr(g_dfu_blocks[m_rx_block]);
+    usb_set_num_out_control_bytes(g_usb_setup.wLength);
+    usb_set_control_stage(DATA_OUT_STAGE);
+    return true;
+}
+
+#ifdef DFU_USE_UPLOAD
+static bool upload(void)
+{
+    uint16_t max_bytes = g_usb_setup.wLength;
+    uint16_t bytes;
+    
+    if(m_status.bState != DFU_STATE_DFU_IDLE && m_status.bState != DFU_STATE_DFU_UPLOAD_IDLE) return stalled();
+    if(max_bytes > DFU_TRANSFER_SIZE) max_bytes = DFU_TRANSFER_SIZE;
+    
+    bytes = dfu_upload_block(g_usb_setup.wValue, g_dfu_blocks[m_rx_block], max_bytes);
+    m_status.bState = bytes < max_bytes ? DFU_STATE_DFU_IDLE : DFU_STATE_DFU_UPLOAD_IDLE; // A short block ends the upload.
+    usb_set_ram_ptr(g_dfu_blocks[m_rx_block]);
+    usb_setup_in_control_transfer(RAM, bytes, g_usb_setup.wLength);
+    usb_start_in_control_transfer();
+    return true;
+}
+#endif
+
+static bool stalled(void)
+{
+    m_status.bState  = DFU_STATE_DFU_ERROR;
+    m_status.bStatus = DFU_STATUS_ERR_STALLEDPKT;
+    return false;
+}
+#endif
+
+/* ************************************************************************** */
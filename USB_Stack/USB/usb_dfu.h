@@ -0,0 +1,316 @@
+/**
+ * @file usb_dfu.h
+ * @brief <i>DFU Class</i> definitions, global variable and function declarations.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - DFU Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_DFU_H
+#define USB_DFU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_hal.h"
+#include "usb.h"
+#include "usb_dfu_config.h"
+
+/*
+ * Device Firmware Upgrade 1.1 on EP0, no other Endpoints are used.
+ * 
+ * DFU mode (a bootloader): each DFU_DNLOAD block is DFU_TRANSFER_SIZE bytes, 
+ * one flash erase row. A block lands in one of two RAM buffers and is handed 
+ * to dfu_program_block() in the main loop (dfu_tasks()) on the host's next 
+ * DFU_GETSTATUS, which returns dfuDNLOAD-IDLE straight away, so the next block 
+ * is on the bus while this one is being erased and written. Only if the block 
+ * before is still being programmed does DFU_GETSTATUS return dfuDNBUSY with 
+ * bwPollTimeout DFU_POLL_TIMEOUT. The zero length DFU_DNLOAD at the end waits 
+ * for the last block, then runs dfu_manifest(). The interface is manifestation 
+ * tolerant, it goes back to dfuIDLE after manifestation and the Application 
+ * decides when to start the new firmware.
+ * 
+ * Run-Time (DFU_RUNTIME, an application): DFU_DETACH calls dfu_detach() from 
+ * dfu_tasks() once its status stage is done (bitWillDetach), which restarts 
+ * into the bootloader, so no button has to be held for an update. Put the 
+ * interface in g_usb_if_handlers next to the other classes:
+ * 
+ * [DFU_INT] = {dfu_class_request, NULL, NULL}
+ * 
+ * and in DFU mode:
+ * 
+ * [DFU_INT] = {dfu_class_request, NULL, dfu_out_control_finished}
+ */
+
+/* ************************************************************************** */
+/* ************************ WARNING FOR OUT CONTROL ************************* */
+/* ************************************************************************** */
+
+#if !defined(DFU_RUNTIME) && !defined(USE_OUT_CONTROL_FINISHED)
+#error "DFU mode needs USE_OUT_CONTROL_FINISHED in usb_config.h, a DFU_DNLOAD block is queued when its data stage ends."
+#endif
+
+#if !defined(DFU_RUNTIME) && ((DFU_TRANSFER_SIZE < 8) || (DFU_TRANSFER_SIZE > 1024))
+#error "DFU_TRANSFER_SIZE must be 8 to 1024 bytes."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** DFU DEFINES ******************************** */
+/* ************************************************************************** */
+
+/// Interface Class, SubClass and Protocol
+#define DFU_CLASS            0xFE // Application Specific.
+#define DFU_SUBCLASS         0x01
+#define DFU_PROTOCOL_RUNTIME 0x01
+#define DFU_PROTOCOL_DFU     0x02
+
+/// Class Specific Descriptor Type
+#define DFU_FUNCTIONAL_DESC 0x21
+
+/// DFU Functional Descriptor bmAttributes
+#define DFU_CAN_DNLOAD             0x01
+#define DFU_CAN_UPLOAD             0x02
+#define DFU_MANIFESTATION_TOLERANT 0x04
+#define DFU_WILL_DETACH            0x08
+
+/// Class Requests
+#define DFU_DETACH    0
+#define DFU_DNLOAD    1
+#define DFU_UPLOAD    2
+#define DFU_GETSTATUS 3
+#define DFU_CLRSTATUS 4
+#define DFU_GETSTATE  5
+#define DFU_ABORT     6
+
+/// bState values
+#define DFU_STATE_APP_IDLE                0
+#define DFU_STATE_APP_DETACH              1
+#define DFU_STATE_DFU_IDLE                2
+#define DFU_STATE_DFU_DNLOAD_SYNC         3
+#define DFU_STATE_DFU_DNBUSY              4
+#define DFU_STATE_DFU_DNLOAD_IDLE         5
+#define DFU_STATE_DFU_MANIFEST_SYNC       6
+#define DFU_STATE_DFU_MANIFEST            7
+#define DFU_STATE_DFU_MANIFEST_WAIT_RESET 8
+#define DFU_STATE_DFU_UPLOAD_IDLE         9
+#define DFU_STATE_DFU_ERROR               10
+
+/// bStatus values, dfu_program_block() and dfu_manifest() return one
+#define DFU_STATUS_OK                0x00
+#define DFU_STATUS_ERR_TARGET        0x01
+#define DFU_STATUS_ERR_FILE          0x02
+#define DFU_STATUS_ERR_WRITE         0x03
+#define DFU_STATUS_ERR_ERASE         0x04
+#define DFU_STATUS_ERR_CHECK_ERASED  0x05
+#define DFU_STATUS_ERR_PROG          0x06
+#define DFU_STATUS_ERR_VERIFY        0x07
+#define DFU_STATUS_ERR_ADDRESS       0x08
+#define DFU_STATUS_ERR_NOTDONE       0x09
+#define DFU_STATUS_ERR_FIRMWARE      0x0A
+#define DFU_STATUS_ERR_VENDOR        0x0B
+#define DFU_STATUS_ERR_USBR          0x0C
+#define DFU_STATUS_ERR_POR           0x0D
+#define DFU_STATUS_ERR_UNKNOWN       0x0E
+#define DFU_STATUS_ERR_STALLEDPKT    0x0F
+
+#ifdef DFU_RUNTIME
+#define DFU_ATTRIBUTES (DFU_CAN_DNLOAD | DFU_WILL_DETACH)
+#define DFU_PROTOCOL   DFU_PROTOCOL_RUNTIME
+#else
+#ifdef DFU_USE_UPLOAD
+#define DFU_ATTRIBUTES (DFU_CAN_DNLOAD | DFU_CAN_UPLOAD | DFU_MANIFESTATION_TOLERANT | DFU_WILL_DETACH)
+#else
+#define DFU_ATTRIBUTES (DFU_CAN_DNLOAD | DFU_MANIFESTATION_TOLERANT | DFU_WILL_DETACH)
+#endif
+#define DFU_PROTOCOL   DFU_PROTOCOL_DFU
+#endif
+
+#ifndef DFU_TRANSFER_SIZE
+#define DFU_TRANSFER_SIZE 64 // Only reported by the Run-Time interface, the bootloader's is the one used.
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** DFU FUNCTION DESCRIPTORS ************************* */
+/* ************************************************************************** */
+
+/** DFU Functional Descriptor Type */
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bmAttributes;
+    uint16_t wDetachTimeOut;
+    uint16_t wTransferSize;
+    uint16_t bcdDFUVersion;
+}dfu_functional_descriptor_t;
+
+/// DFU function, one interface with no Endpoints.
+typedef struct
+{
+    ch9_standard_interface_descriptor_t interface;
+    dfu_functional_descriptor_t         functional;
+}dfu_function_descriptors_t;
+
+#define DFU_FUNCTION_DESCRIPTORS() \
+{ \
+    CH9_INTERFACE_DESCRIPTOR(DFU_INT, 0, 0, DFU_CLASS, DFU_SUBCLASS, DFU_PROTOCOL), \
+    {9, DFU_FUNCTIONAL_DESC, DFU_ATTRIBUTES, DFU_DETACH_TIMEOUT, DFU_TRANSFER_SIZE, 0x0110} \
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** VARS FROM: usb_dfu.c ************************** */
+/* ************************************************************************** */
+
+#ifndef DFU_RUNTIME
+extern uint8_t g_dfu_blocks[2][DFU_TRANSFER_SIZE]; ///< DFU_DNLOAD data lands in one while the other is programmed.
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** DFU FUNCTIONS ****************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void dfu_init(void)
+ * 
+ * @brief Puts the interface in appIDLE (DFU_RUNTIME) or dfuIDLE.
+ */
+void dfu_init(void);
+
+/**
+ * @fn bool dfu_class_request(void)
+ * 
+ * @brief Used to service Class Requests for DFU.
+ * 
+ * A request the current state doesn't allow is stalled and, in DFU mode, moves 
+ * the interface to dfuERROR with errSTALLEDPKT as the spec says.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+bool dfu_class_request(void);
+
+#ifndef DFU_RUNTIME
+/**
+ * @fn bool dfu_out_control_finished(void)
+ * 
+ * @brief Ends the data stage of a DFU_DNLOAD, the block waits for DFU_GETSTATUS.
+ * 
+ * @return Returns true if the request was a DFU_DNLOAD.
+ */
+bool dfu_out_control_finished(void);
+#endif
+
+/**
+ * @fn void dfu_tasks(void)
+ * 
+ * @brief Runs the slow work from the main loop.
+ * 
+ * In DFU mode a queued block is passed to dfu_program_block() or, after the 
+ * last one, dfu_manifest() is called. With DFU_RUNTIME dfu_detach() is called 
+ * DFU_DETACH_FRAMES after a DFU_DETACH. The USB interrupt keeps running, EP0 
+ * requests are answered while a block is programmed (the SIE NAKs while the 
+ * CPU is stalled for a flash write).
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * while(1)
+ * {
+ *     dfu_tasks();
+ * }
+ * @endcode
+ * </li></ul>
+ */
+void dfu_tasks(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ FUNCTIONS FROM THE APP ************************** */
+/* ************************************************************************** */
+
+#ifdef DFU_RUNTIME
+/**
+ * @fn void dfu_detach(void)
+ * 
+ * @brief Restarts into the bootloader, defined by your program.
+ * 
+ * Called from dfu_tasks(). Leave a mark the bootloader checks after the reset 
+ * (a RAM variable that isn't cleared, or EEPROM), then RESET(). The DFU 
+ * Bootloader Example takes the RESET instruction itself as the mark (RCON's RI).
+ */
+void dfu_detach(void);
+#else
+/**
+ * @fn uint8_t dfu_program_block(uint16_t block_num, uint8_t* p_data, uint16_t bytes)
+ * 
+ * @brief Erases and writes one block, defined by your program.
+ * 
+ * Called from dfu_tasks(). Block n is at n * DFU_TRANSFER_SIZE in the image, 
+ * bytes is DFU_TRANSFER_SIZE except for a short last block.
+ * 
+ * @return Returns DFU_STATUS_OK, or the error to report (DFU_STATUS_ERR_ADDRESS 
+ * for a block outside the application space).
+ */
+uint8_t dfu_program_block(uint16_t block_num, uint8_t* p_data, uint16_t bytes);
+
+/**
+ * @fn uint8_t dfu_manifest(void)
+ * 
+ * @brief Finishes an update once every block is written, defined by your program.
+ * 
+ * Called from dfu_tasks(), e.g. to check the image and mark it valid.
+ * 
+ * @return Returns DFU_STATUS_OK, or the error to report.
+ */
+uint8_t dfu_manifest(void);
+
+#ifdef DFU_USE_UPLOAD
+/**
+ * @fn uint16_t dfu_upload_block(uint16_t block_num, uint8_t* p_data, uint16_t bytes)
+ * 
+ * @brief Reads one block back for DFU_UPLOAD, defined by your program.
+ * 
+ * Called from the USB interrupt.
+ * 
+ * @return Returns the bytes put in p_data, fewer than bytes ends the upload.
+ */
+uint16_t dfu_upload_block(uint16_t block_num, uint8_t* p_data, uint16_t bytes);
+#endif
+#endif
+
+/* ************************************************************************** */
+
+#endif /* USB_DFU_H */
@@ -44,6 +44,9 @@
 #define _EPINEN    0x02
 #define _EPSTALL   0x01
 
+// UEPn of any Endpoint, the UEPn registers are consecutive on every part.
+#define USB_UEP(ep) ((&UEP0)[ep])
+
 /* ************************************************************************** */
 
 
@@ -55,6 +58,8 @@
 #define _DTS    (uint8_t)0x40
 #define _DTSEN  (uint8_t)0x08
 #define _BSTALL (uint8_t)0x04
+#define _BC9    (uint8_t)0x02
+#define _BC8    (uint8_t)0x01
 
 /* ************************************************************************** */
 
@@ -205,6 +210,17 @@
 #endif
 #endif
 
+// Buffer Descriptor index of any Endpoint from EP1 to EP15 (ppb is ignored when the Endpoint doesn't ping-pong).
+#if (PINGPONG_MODE == PINGPONG_DIS)
+#define EP_BD_INDEX(ep, dir, ppb) (((ep) << 1) + (dir))
+#elif (PINGPONG_MODE == PINGPONG_0_OUT)
+#define EP_BD_INDEX(ep, dir, ppb) (((ep) << 1) + (dir) + 1)
+#elif (PINGPONG_MODE == PINGPONG_1_15)
+#define EP_BD_INDEX(ep, dir, ppb) (((ep) << 2) + ((dir) << 1) + (ppb) - 2)
+#else
+#define EP_BD_INDEX(ep, dir, ppb) (((ep) << 2) + ((dir) << 1) + (ppb))
+#endif
+
 /* ************************************************************************** */
 
 
@@ -226,6 +242,58 @@
 /* ************************************************************************** */
 
 
+/* ************************************************************************** */
+/* ******************************** NEAR RAM ******************************** */
+/* ************************************************************************** */
+
+// With USE_NEAR_RAM the variables touched on every transaction are qualified 
+// __near, so they're reached without a MOVLB/BANKSEL. On PIC18s that's access 
+// RAM (0x00 to 0x5F). PIC16F145Xs only have common RAM (0x70 to 0x7F, half of 
+// it the setup packet at SETUP_DATA_ADDR), so there only USB_NEAR ones go in 
+// it and USB_ACCESS is empty. XC8 ignores __near unless Address Qualifiers is 
+// set to request (-maddrqual=request), anything that doesn't fit then goes 
+// in banked RAM.
+#if defined(USE_NEAR_RAM) && !defined(USB_SIM)
+#define USB_NEAR __near
+#if defined(_PIC14E)
+#define USB_ACCESS
+#else
+#define USB_ACCESS __near
+#endif
+#else
+#define USB_NEAR
+#define USB_ACCESS
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** HOST SIMULATOR ****************************** */
+/* ************************************************************************** */
+
+// Tools/SIE_Sim builds the stack on a PC with USB_SIM defined. There's no __at()
+// or 16 bit pointer there, so fixed address objects are #defined into the
+// simulator's copy of the part's data memory (g_usb_sim_ram), and a BD's ADR
+// is an offset into it.
+#if defined(USB_SIM)
+extern uint8_t g_usb_sim_ram[];
+#define USB_SIM_AT(type, addr)          (*(type*)&g_usb_sim_ram[addr])
+#define USB_SIM_AT_ARRAY(type, n, addr) (*(type(*)[n])&g_usb_sim_ram[addr])
+#define USB_RAM_ADDR(p)    ((uint16_t)((const uint8_t*)(p) - g_usb_sim_ram))
+#define USB_RAM_PTR(addr)  (&g_usb_sim_ram[addr])
+#define USB_PTR16(type, p) ((type)(p))
+typedef uintptr_t usb_desc_addr_t;
+#else
+#define USB_RAM_ADDR(p)    ((uint16_t)(p))  // BD ADR of a buffer.
+#define USB_RAM_PTR(addr)  ((uint8_t*)(addr)) // Buffer at a BD ADR.
+#define USB_PTR16(type, p) ((type)((uint16_t)(p))) // Tells XC8 the pointer only needs 16 bits.
+typedef uint16_t usb_desc_addr_t; // Entry of g_config_descriptors[] and g_string_descriptors[].
+#endif
+
+/* ************************************************************************** */
+
+
 /* ************************************************************************** */
 /* ********************* PROCESSOR SPECIFIC DEFINES  ************************ */
 /* ************************************************************************** */
@@ -247,18 +315,401 @@
 #define EP_BUFFERS_STARTING_ADDR (BDT_BASE_ADDR + BDT_SIZE)
 #endif
 
+// RAM the SIE can reach, a Buffer Descriptor's ADR must point inside it.
+#if defined(_PIC14E)
+#define USB_RAM_START 0x2000 // Linear addresses only.
+#define USB_RAM_END   0x21FF
+#elif defined(_18F13K50) || defined(_18F14K50)
+#define USB_RAM_START 0x200
+#define USB_RAM_END   0x2FF
+#elif defined(_18F24J50) || defined(_18F25J50) || defined(_18F26J50) || defined(_18F44J50) || defined(_18F45J50) || defined(_18F46J50) || \
+      defined(_18F26J53) || defined(_18F46J53) || defined(_18F27J53) || defined(_18F47J53)
+#define USB_RAM_START 0x000 // All of RAM.
+#define USB_RAM_END   0xEBF
+#else
+#define USB_RAM_START 0x400
+#define USB_RAM_END   0x7FF
+#endif
+#if defined(USB_SIM)
+#define USB_SIE_REACHABLE(addr, bytes) (((const uint8_t*)(addr) >= &g_usb_sim_ram[USB_RAM_START]) && ((const uint8_t*)(addr) + (bytes) - 1 <= &g_usb_sim_ram[USB_RAM_END]))
+#else
+#define USB_SIE_REACHABLE(addr, bytes) (((uint16_t)(addr) >= USB_RAM_START) && (((uint16_t)(addr) + (bytes) - 1) <= USB_RAM_END))
+#endif
+
 #if defined(_18F24K50)||defined(_18F25K50)||defined(_18F45K50)
-#define USB_INTERRUPT_ENABLE PIE3bits.USBIE
-#define USB_INTERRUPT_FLAG   PIR3bits.USBIF
+#define USB_INTERRUPT_ENABLE   PIE3bits.USBIE
+#define USB_INTERRUPT_FLAG     PIR3bits.USBIF
+#define USB_INTERRUPT_PRIORITY IPR3bits.USBIP
 #else
-#define USB_INTERRUPT_ENABLE PIE2bits.USBIE
-#define USB_INTERRUPT_FLAG   PIR2bits.USBIF
+#define USB_INTERRUPT_ENABLE   PIE2bits.USBIE
+#define USB_INTERRUPT_FLAG     PIR2bits.USBIF
+#if !defined(_PIC14E)
+#define USB_INTERRUPT_PRIORITY IPR2bits.USBIP
+#endif
 #endif
 
+#define USB_SOF_ENABLE UIEbits.SOFIE // Classes that only need the SOF interrupt now and then.
+
 #define TRANSACTION_EP  g_usb_last_USTAT.ENDP
 #define TRANSACTION_DIR g_usb_last_USTAT.DIR
 #define PINGPONG_PARITY g_usb_last_USTAT.PPBI
 
+// Buffer Descriptor used by the last transaction, worked out from USTAT (any Endpoint). 
+// EP0 only ping-pongs its OUT BDs in PINGPONG_0_OUT and not at all in PINGPONG_1_15.
+#if (PINGPONG_MODE == PINGPONG_DIS)
+#define TRANSACTION_BD_INDEX ((*((uint8_t*)&g_usb_last_USTAT)) >> 2)
+#elif (PINGPONG_MODE == PINGPONG_0_OUT)
+#define TRANSACTION_BD_INDEX ((TRANSACTION_EP == EP0 && TRANSACTION_DIR == OUT) ? PINGPONG_PARITY : \
+                              (((*((uint8_t*)&g_usb_last_USTAT)) >> 2) + 1))
+#elif (PINGPONG_MODE == PINGPONG_1_15)
+#define TRANSACTION_BD_INDEX ((TRANSACTION_EP == EP0) ? ((*((uint8_t*)&g_usb_last_USTAT)) >> 2) : \
+                              (((*((uint8_t*)&g_usb_last_USTAT)) >> 1) - 2))
+#else
+#define TRANSACTION_BD_INDEX ((*((uint8_t*)&g_usb_last_USTAT)) >> 1)
+#endif
+#define TRANSACTION_BD (&g_usb_bd_table[TRANSACTION_BD_INDEX])
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************** ENDPOINT BUFFER ALLOCATOR ************************* */
+/* ************************************************************************** */
+/*
+ * PIC18 EP buffers are packed straight after the BDT, EP0 first, then EP1 to 
+ * EP15, each Endpoint's OUT buffers (EVEN, ODD) before its IN buffers. Sizes 
+ * come from the one Endpoint list in usb_config.h:
+ * 
+ *   EPn_SIZE        Both directions of EPn (n < NUM_ENDPOINTS).
+ *   EPn_OUT_SIZE    Optional, overrides EPn_SIZE for OUT, 0 if EPn has no OUT.
+ *   EPn_IN_SIZE     Optional, overrides EPn_SIZE for IN, 0 if EPn has no IN.
+ * 
+ * An ODD buffer is only reserved where PINGPONG_MODE gives the Endpoint one.
+ * The SIE takes any byte address in USB RAM (only the BDT is fixed, already 
+ * aligned by the hardware), so no padding is added between buffers.
+ * 
+ * Use EP_OUT_EVEN_BUFFER_ADDR(ep), EP_OUT_ODD_BUFFER_ADDR(ep), 
+ * EP_IN_EVEN_BUFFER_ADDR(ep) and EP_IN_ODD_BUFFER_ADDR(ep) with __at(). 
+ * EP_OUT_BUFFER_ADDR(ep) and EP_IN_BUFFER_ADDR(ep) are the EVEN ones, for 
+ * Endpoints without ping-pong buffers.
+ * 
+ * PIC16 EP buffers have fixed, bank aligned addresses (see the class headers).
+ */
+
+#ifndef _PIC14E
+#if (PINGPONG_MODE == PINGPONG_0_OUT) || (PINGPONG_MODE == PINGPONG_ALL_EP)
+#define EP0_NUM_OUT_BUFFERS 2
+#else
+#define EP0_NUM_OUT_BUFFERS 1
+#endif
+#if (PINGPONG_MODE == PINGPONG_ALL_EP)
+#define EP0_NUM_IN_BUFFERS 2
+#else
+#define EP0_NUM_IN_BUFFERS 1
+#endif
+#if (PINGPONG_MODE == PINGPONG_1_15) || (PINGPONG_MODE == PINGPONG_ALL_EP)
+#define EPN_NUM_BUFFERS 2 // EP1 to EP15, per direction.
+#else
+#define EPN_NUM_BUFFERS 1
+#endif
+
+#define EP0_OUT_SIZE EP0_SIZE
+#define EP0_IN_SIZE  EP0_SIZE
+#if (NUM_ENDPOINTS > 1) && defined(EP1_SIZE)
+#ifndef EP1_OUT_SIZE
+#define EP1_OUT_SIZE EP1_SIZE
+#endif
+#ifndef EP1_IN_SIZE
+#define EP1_IN_SIZE  EP1_SIZE
+#endif
+#else
+#undef  EP1_OUT_SIZE
+#undef  EP1_IN_SIZE
+#define EP1_OUT_SIZE 0
+#define EP1_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 2) && defined(EP2_SIZE)
+#ifndef EP2_OUT_SIZE
+#define EP2_OUT_SIZE EP2_SIZE
+#endif
+#ifndef EP2_IN_SIZE
+#define EP2_IN_SIZE  EP2_SIZE
+#endif
+#else
+#undef  EP2_OUT_SIZE
+#undef  EP2_IN_SIZE
+#define EP2_OUT_SIZE 0
+#define EP2_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 3) && defined(EP3_SIZE)
+#ifndef EP3_OUT_SIZE
+#define EP3_OUT_SIZE EP3_SIZE
+#endif
+#ifndef EP3_IN_SIZE
+#define EP3_IN_SIZE  EP3_SIZE
+#endif
+#else
+#undef  EP3_OUT_SIZE
+#undef  EP3_IN_SIZE
+#define EP3_OUT_SIZE 0
+#define EP3_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 4) && defined(EP4_SIZE)
+#ifndef EP4_OUT_SIZE
+#define EP4_OUT_SIZE EP4_SIZE
+#endif
+#ifndef EP4_IN_SIZE
+#define EP4_IN_SIZE  EP4_SIZE
+#endif
+#else
+#undef  EP4_OUT_SIZE
+#undef  EP4_IN_SIZE
+#define EP4_OUT_SIZE 0
+#define EP4_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 5) && defined(EP5_SIZE)
+#ifndef EP5_OUT_SIZE
+#define EP5_OUT_SIZE EP5_SIZE
+#endif
+#ifndef EP5_IN_SIZE
+#define EP5_IN_SIZE  EP5_SIZE
+#endif
+#else
+#undef  EP5_OUT_SIZE
+#undef  EP5_IN_SIZE
+#define EP5_OUT_SIZE 0
+#define EP5_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 6) && defined(EP6_SIZE)
+#ifndef EP6_OUT_SIZE
+#define EP6_OUT_SIZE EP6_SIZE
+#endif
+#ifndef EP6_IN_SIZE
+#define EP6_IN_SIZE  EP6_SIZE
+#endif
+#else
+#undef  EP6_OUT_SIZE
+#undef  EP6_IN_SIZE
+#define EP6_OUT_SIZE 0
+#define EP6_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 7) && defined(EP7_SIZE)
+#ifndef EP7_OUT_SIZE
+#define EP7_OUT_SIZE EP7_SIZE
+#endif
+#ifndef EP7_IN_SIZE
+#define EP7_IN_SIZE  EP7_SIZE
+#endif
+#else
+#undef  EP7_OUT_SIZE
+#undef  EP7_IN_SIZE
+#define EP7_OUT_SIZE 0
+#define EP7_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 8) && defined(EP8_SIZE)
+#ifndef EP8_OUT_SIZE
+#define EP8_OUT_SIZE EP8_SIZE
+#endif
+#ifndef EP8_IN_SIZE
+#define EP8_IN_SIZE  EP8_SIZE
+#endif
+#else
+#undef  EP8_OUT_SIZE
+#undef  EP8_IN_SIZE
+#define EP8_OUT_SIZE 0
+#define EP8_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 9) && defined(EP9_SIZE)
+#ifndef EP9_OUT_SIZE
+#define EP9_OUT_SIZE EP9_SIZE
+#endif
+#ifndef EP9_IN_SIZE
+#define EP9_IN_SIZE  EP9_SIZE
+#endif
+#else
+#undef  EP9_OUT_SIZE
+#undef  EP9_IN_SIZE
+#define EP9_OUT_SIZE 0
+#define EP9_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 10) && defined(EP10_SIZE)
+#ifndef EP10_OUT_SIZE
+#define EP10_OUT_SIZE EP10_SIZE
+#endif
+#ifndef EP10_IN_SIZE
+#define EP10_IN_SIZE  EP10_SIZE
+#endif
+#else
+#undef  EP10_OUT_SIZE
+#undef  EP10_IN_SIZE
+#define EP10_OUT_SIZE 0
+#define EP10_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 11) && defined(EP11_SIZE)
+#ifndef EP11_OUT_SIZE
+#define EP11_OUT_SIZE EP11_SIZE
+#endif
+#ifndef EP11_IN_SIZE
+#define EP11_IN_SIZE  EP11_SIZE
+#endif
+#else
+#undef  EP11_OUT_SIZE
+#undef  EP11_IN_SIZE
+#define EP11_OUT_SIZE 0
+#define EP11_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 12) && defined(EP12_SIZE)
+#ifndef EP12_OUT_SIZE
+#define EP12_OUT_SIZE EP12_SIZE
+#endif
+#ifndef EP12_IN_SIZE
+#define EP12_IN_SIZE  EP12_SIZE
+#endif
+#else
+#undef  EP12_OUT_SIZE
+#undef  EP12_IN_SIZE
+#define EP12_OUT_SIZE 0
+#define EP12_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 13) && defined(EP13_SIZE)
+#ifndef EP13_OUT_SIZE
+#define EP13_OUT_SIZE EP13_SIZE
+#endif
+#ifndef EP13_IN_SIZE
+#define EP13_IN_SIZE  EP13_SIZE
+#endif
+#else
+#undef  EP13_OUT_SIZE
+#undef  EP13_IN_SIZE
+#define EP13_OUT_SIZE 0
+#define EP13_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 14) && defined(EP14_SIZE)
+#ifndef EP14_OUT_SIZE
+#define EP14_OUT_SIZE EP14_SIZE
+#endif
+#ifndef EP14_IN_SIZE
+#define EP14_IN_SIZE  EP14_SIZE
+#endif
+#else
+#undef  EP14_OUT_SIZE
+#undef  EP14_IN_SIZE
+#define EP14_OUT_SIZE 0
+#define EP14_IN_SIZE  0
+#endif
+#if (NUM_ENDPOINTS > 15) && defined(EP15_SIZE)
+#ifndef EP15_OUT_SIZE
+#define EP15_OUT_SIZE EP15_SIZE
+#endif
+#ifndef EP15_IN_SIZE
+#define EP15_IN_SIZE  EP15_SIZE
+#endif
+#else
+#undef  EP15_OUT_SIZE
+#undef  EP15_IN_SIZE
+#define EP15_OUT_SIZE 0
+#define EP15_IN_SIZE  0
+#endif
+#define EP0_OUT_EVEN_BUFFER_ADDR EP_BUFFERS_STARTING_ADDR
+#define EP0_OUT_ODD_BUFFER_ADDR  (EP0_OUT_EVEN_BUFFER_ADDR + (EP0_OUT_SIZE * (EP0_NUM_OUT_BUFFERS - 1)))
+#define EP0_IN_EVEN_BUFFER_ADDR  (EP0_OUT_EVEN_BUFFER_ADDR + (EP0_OUT_SIZE * EP0_NUM_OUT_BUFFERS))
+#define EP0_IN_ODD_BUFFER_ADDR   (EP0_IN_EVEN_BUFFER_ADDR + (EP0_IN_SIZE * (EP0_NUM_IN_BUFFERS - 1)))
+#define EP0_BUFFERS_END_ADDR     (EP0_IN_EVEN_BUFFER_ADDR + (EP0_IN_SIZE * EP0_NUM_IN_BUFFERS))
+
+#define EP1_OUT_EVEN_BUFFER_ADDR  EP0_BUFFERS_END_ADDR
+#define EP1_OUT_ODD_BUFFER_ADDR   (EP1_OUT_EVEN_BUFFER_ADDR + (EP1_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP1_IN_EVEN_BUFFER_ADDR   (EP1_OUT_EVEN_BUFFER_ADDR + (EP1_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP1_IN_ODD_BUFFER_ADDR    (EP1_IN_EVEN_BUFFER_ADDR + (EP1_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP1_BUFFERS_END_ADDR      (EP1_IN_EVEN_BUFFER_ADDR + (EP1_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP2_OUT_EVEN_BUFFER_ADDR  EP1_BUFFERS_END_ADDR
+#define EP2_OUT_ODD_BUFFER_ADDR   (EP2_OUT_EVEN_BUFFER_ADDR + (EP2_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP2_IN_EVEN_BUFFER_ADDR   (EP2_OUT_EVEN_BUFFER_ADDR + (EP2_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP2_IN_ODD_BUFFER_ADDR    (EP2_IN_EVEN_BUFFER_ADDR + (EP2_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP2_BUFFERS_END_ADDR      (EP2_IN_EVEN_BUFFER_ADDR + (EP2_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP3_OUT_EVEN_BUFFER_ADDR  EP2_BUFFERS_END_ADDR
+#define EP3_OUT_ODD_BUFFER_ADDR   (EP3_OUT_EVEN_BUFFER_ADDR + (EP3_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP3_IN_EVEN_BUFFER_ADDR   (EP3_OUT_EVEN_BUFFER_ADDR + (EP3_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP3_IN_ODD_BUFFER_ADDR    (EP3_IN_EVEN_BUFFER_ADDR + (EP3_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP3_BUFFERS_END_ADDR      (EP3_IN_EVEN_BUFFER_ADDR + (EP3_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP4_OUT_EVEN_BUFFER_ADDR  EP3_BUFFERS_END_ADDR
+#define EP4_OUT_ODD_BUFFER_ADDR   (EP4_OUT_EVEN_BUFFER_ADDR + (EP4_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP4_IN_EVEN_BUFFER_ADDR   (EP4_OUT_EVEN_BUFFER_ADDR + (EP4_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP4_IN_ODD_BUFFER_ADDR    (EP4_IN_EVEN_BUFFER_ADDR + (EP4_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP4_BUFFERS_END_ADDR      (EP4_IN_EVEN_BUFFER_ADDR + (EP4_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP5_OUT_EVEN_BUFFER_ADDR  EP4_BUFFERS_END_ADDR
+#define EP5_OUT_ODD_BUFFER_ADDR   (EP5_OUT_EVEN_BUFFER_ADDR + (EP5_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP5_IN_EVEN_BUFFER_ADDR   (EP5_OUT_EVEN_BUFFER_ADDR + (EP5_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP5_IN_ODD_BUFFER_ADDR    (EP5_IN_EVEN_BUFFER_ADDR + (EP5_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP5_BUFFERS_END_ADDR      (EP5_IN_EVEN_BUFFER_ADDR + (EP5_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP6_OUT_EVEN_BUFFER_ADDR  EP5_BUFFERS_END_ADDR
+#define EP6_OUT_ODD_BUFFER_ADDR   (EP6_OUT_EVEN_BUFFER_ADDR + (EP6_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP6_IN_EVEN_BUFFER_ADDR   (EP6_OUT_EVEN_BUFFER_ADDR + (EP6_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP6_IN_ODD_BUFFER_ADDR    (EP6_IN_EVEN_BUFFER_ADDR + (EP6_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP6_BUFFERS_END_ADDR      (EP6_IN_EVEN_BUFFER_ADDR + (EP6_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP7_OUT_EVEN_BUFFER_ADDR  EP6_BUFFERS_END_ADDR
+#define EP7_OUT_ODD_BUFFER_ADDR   (EP7_OUT_EVEN_BUFFER_ADDR + (EP7_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP7_IN_EVEN_BUFFER_ADDR   (EP7_OUT_EVEN_BUFFER_ADDR + (EP7_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP7_IN_ODD_BUFFER_ADDR    (EP7_IN_EVEN_BUFFER_ADDR + (EP7_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP7_BUFFERS_END_ADDR      (EP7_IN_EVEN_BUFFER_ADDR + (EP7_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP8_OUT_EVEN_BUFFER_ADDR  EP7_BUFFERS_END_ADDR
+#define EP8_OUT_ODD_BUFFER_ADDR   (EP8_OUT_EVEN_BUFFER_ADDR + (EP8_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP8_IN_EVEN_BUFFER_ADDR   (EP8_OUT_EVEN_BUFFER_ADDR + (EP8_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP8_IN_ODD_BUFFER_ADDR    (EP8_IN_EVEN_BUFFER_ADDR + (EP8_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP8_BUFFERS_END_ADDR      (EP8_IN_EVEN_BUFFER_ADDR + (EP8_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP9_OUT_EVEN_BUFFER_ADDR  EP8_BUFFERS_END_ADDR
+#define EP9_OUT_ODD_BUFFER_ADDR   (EP9_OUT_EVEN_BUFFER_ADDR + (EP9_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP9_IN_EVEN_BUFFER_ADDR   (EP9_OUT_EVEN_BUFFER_ADDR + (EP9_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP9_IN_ODD_BUFFER_ADDR    (EP9_IN_EVEN_BUFFER_ADDR + (EP9_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP9_BUFFERS_END_ADDR      (EP9_IN_EVEN_BUFFER_ADDR + (EP9_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP10_OUT_EVEN_BUFFER_ADDR EP9_BUFFERS_END_ADDR
+#define EP10_OUT_ODD_BUFFER_ADDR  (EP10_OUT_EVEN_BUFFER_ADDR + (EP10_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP10_IN_EVEN_BUFFER_ADDR  (EP10_OUT_EVEN_BUFFER_ADDR + (EP10_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP10_IN_ODD_BUFFER_ADDR   (EP10_IN_EVEN_BUFFER_ADDR + (EP10_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP10_BUFFERS_END_ADDR     (EP10_IN_EVEN_BUFFER_ADDR + (EP10_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP11_OUT_EVEN_BUFFER_ADDR EP10_BUFFERS_END_ADDR
+#define EP11_OUT_ODD_BUFFER_ADDR  (EP11_OUT_EVEN_BUFFER_ADDR + (EP11_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP11_IN_EVEN_BUFFER_ADDR  (EP11_OUT_EVEN_BUFFER_ADDR + (EP11_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP11_IN_ODD_BUFFER_ADDR   (EP11_IN_EVEN_BUFFER_ADDR + (EP11_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP11_BUFFERS_END_ADDR     (EP11_IN_EVEN_BUFFER_ADDR + (EP11_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP12_OUT_EVEN_BUFFER_ADDR EP11_BUFFERS_END_ADDR
+#define EP12_OUT_ODD_BUFFER_ADDR  (EP12_OUT_EVEN_BUFFER_ADDR + (EP12_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP12_IN_EVEN_BUFFER_ADDR  (EP12_OUT_EVEN_BUFFER_ADDR + (EP12_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP12_IN_ODD_BUFFER_ADDR   (EP12_IN_EVEN_BUFFER_ADDR + (EP12_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP12_BUFFERS_END_ADDR     (EP12_IN_EVEN_BUFFER_ADDR + (EP12_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP13_OUT_EVEN_BUFFER_ADDR EP12_BUFFERS_END_ADDR
+#define EP13_OUT_ODD_BUFFER_ADDR  (EP13_OUT_EVEN_BUFFER_ADDR + (EP13_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP13_IN_EVEN_BUFFER_ADDR  (EP13_OUT_EVEN_BUFFER_ADDR + (EP13_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP13_IN_ODD_BUFFER_ADDR   (EP13_IN_EVEN_BUFFER_ADDR + (EP13_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP13_BUFFERS_END_ADDR     (EP13_IN_EVEN_BUFFER_ADDR + (EP13_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP14_OUT_EVEN_BUFFER_ADDR EP13_BUFFERS_END_ADDR
+#define EP14_OUT_ODD_BUFFER_ADDR  (EP14_OUT_EVEN_BUFFER_ADDR + (EP14_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP14_IN_EVEN_BUFFER_ADDR  (EP14_OUT_EVEN_BUFFER_ADDR + (EP14_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP14_IN_ODD_BUFFER_ADDR   (EP14_IN_EVEN_BUFFER_ADDR + (EP14_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP14_BUFFERS_END_ADDR     (EP14_IN_EVEN_BUFFER_ADDR + (EP14_IN_SIZE * EPN_NUM_BUFFERS))
+#define EP15_OUT_EVEN_BUFFER_ADDR EP14_BUFFERS_END_ADDR
+#define EP15_OUT_ODD_BUFFER_ADDR  (EP15_OUT_EVEN_BUFFER_ADDR + (EP15_OUT_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP15_IN_EVEN_BUFFER_ADDR  (EP15_OUT_EVEN_BUFFER_ADDR + (EP15_OUT_SIZE * EPN_NUM_BUFFERS))
+#define EP15_IN_ODD_BUFFER_ADDR   (EP15_IN_EVEN_BUFFER_ADDR + (EP15_IN_SIZE * (EPN_NUM_BUFFERS - 1)))
+#define EP15_BUFFERS_END_ADDR     (EP15_IN_EVEN_BUFFER_ADDR + (EP15_IN_SIZE * EPN_NUM_BUFFERS))
+
+#define EP_BUFFERS_END_ADDR EP15_BUFFERS_END_ADDR
+
+#if (EP_BUFFERS_END_ADDR - 1) > USB_RAM_END
+#error "The BDT and EP buffers don't fit in this part's USB RAM, reduce the EPn_SIZEs, EP0_SIZE or NUM_ENDPOINTS, or use less ping-pong buffering."
+#endif
+#endif
+
+#define EP_OUT_EVEN_BUFFER_ADDR(ep)  EP_OUT_EVEN_BUFFER_ADDR_(ep)
+#define EP_OUT_ODD_BUFFER_ADDR(ep)   EP_OUT_ODD_BUFFER_ADDR_(ep)
+#define EP_IN_EVEN_BUFFER_ADDR(ep)   EP_IN_EVEN_BUFFER_ADDR_(ep)
+#define EP_IN_ODD_BUFFER_ADDR(ep)    EP_IN_ODD_BUFFER_ADDR_(ep)
+#define EP_OUT_BUFFER_ADDR(ep)       EP_OUT_EVEN_BUFFER_ADDR_(ep)
+#define EP_IN_BUFFER_ADDR(ep)        EP_IN_EVEN_BUFFER_ADDR_(ep)
+#define EP_OUT_EVEN_BUFFER_ADDR_(ep) EP##ep##_OUT_EVEN_BUFFER_ADDR // Extra level so EPn names expand first.
+#define EP_OUT_ODD_BUFFER_ADDR_(ep)  EP##ep##_OUT_ODD_BUFFER_ADDR
+#define EP_IN_EVEN_BUFFER_ADDR_(ep)  EP##ep##_IN_EVEN_BUFFER_ADDR
+#define EP_IN_ODD_BUFFER_ADDR_(ep)   EP##ep##_IN_ODD_BUFFER_ADDR
+
 /* ************************************************************************** */
 
 
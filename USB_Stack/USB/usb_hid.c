@@ -92,6 +92,16 @@ typedef struct
     uint16_t Interface;
 }hid_set_idle_t;
 
+typedef struct
+{
+    unsigned :8;
+    unsigned :8;
+    uint8_t  Protocol;
+    unsigned :8;
+    uint16_t Interface;
+    uint16_t wLength;
+}hid_get_set_protocol_t;
+
 /* ************************************************************************** */
 
 
@@ -117,10 +127,13 @@ uint8_t g_hid_ep_in_odd[HID_EP_SIZE]    __at(HID_EP_IN_ODD_BUFFER_BASE_ADDR);
 /* ****************************** GLOBAL VARS ******************************* */
 /* ************************************************************************** */
 
-volatile bool                    g_hid_report_sent = true;
+USB_ACCESS volatile bool         g_hid_report_sent = true;
 volatile uint8_t                 g_hid_report_num_sent;
 volatile bool                    g_hid_sent_report[HID_NUM_IN_REPORTS] = {true};
 volatile hid_in_report_setting_t g_hid_in_report_settings[HID_NUM_IN_REPORTS];
+#if defined(USE_GET_PROTOCOL) || defined(USE_SET_PROTOCOL)
+volatile uint8_t                 g_hid_protocol = HID_REPORT_PROTOCOL;
+#endif
 
 /* ************************************************************************** */
 
@@ -144,6 +157,26 @@ extern const uint16_t g_hid_in_reports[];
 extern const uint8_t  g_hid_in_report_size[];
 extern const uint16_t g_hid_out_reports[];
 extern const uint8_t  g_hid_out_report_size[];
+#if HID_NUM_FEATURE_REPORTS != 0
+extern const uint16_t g_hid_feature_reports[];
+extern const uint8_t  g_hid_feature_report_size[];
+#endif
+#ifdef USE_SET_PROTOCOL
+extern const uint16_t g_hid_boot_in_report;
+extern const uint8_t  g_hid_boot_in_report_size;
+#endif
+
+// A report header from Tools/HID_Report_Compiler makes the size of report 0 
+// of each type a constant, so the one report paths don't read it from ROM.
+#ifndef HID_IN_REPORT0_SIZE
+#define HID_IN_REPORT0_SIZE g_hid_in_report_size[0]
+#endif
+#ifndef HID_OUT_REPORT0_SIZE
+#define HID_OUT_REPORT0_SIZE g_hid_out_report_size[0]
+#endif
+#ifndef HID_FEATURE_REPORT0_SIZE
+#define HID_FEATURE_REPORT0_SIZE g_hid_feature_report_size[0]
+#endif
 
 /* ************************************************************************** */
 
@@ -155,6 +188,42 @@ extern const uint8_t  g_hid_out_report_size[];
 static hid_get_set_report_t m_get_set_report __at(SETUP_DATA_ADDR);
 static hid_get_idle_t       m_get_idle       __at(SETUP_DATA_ADDR);
 static hid_set_idle_t       m_set_idle       __at(SETUP_DATA_ADDR);
+#if defined(USE_GET_PROTOCOL) || defined(USE_SET_PROTOCOL)
+static hid_get_set_protocol_t m_get_set_protocol __at(SETUP_DATA_ADDR);
+#endif
+#ifdef USE_HID_REPORT_QUEUE
+static volatile uint8_t     m_queued_reports; // Bit n set, report n waits for the IN EP.
+#endif
+#ifdef USE_HID_FEATURE_TASKS
+static uint8_t              m_feature_wait;     // Feature Report number + 1 the SET_REPORT data stage fills, 0 for none.
+static volatile uint8_t     m_feature_received; // Bit n set, Feature Report n waits for hid_feature_tasks().
+#endif
+#ifdef USE_HID_MOTION
+static volatile int16_t     m_motion_x;       // Movement not reported yet.
+static volatile int16_t     m_motion_y;
+#ifdef HID_MOTION_WHEEL
+static volatile int16_t     m_motion_wheel;
+#endif
+static volatile uint8_t     m_motion_buttons; // Held now.
+static volatile uint8_t     m_motion_clicks;  // Pressed since the last report, sent even if released again.
+static uint8_t              m_motion_sent;    // Buttons in the last report.
+#endif
+static uint16_t             m_idle_time;          // SOF count, the idle timers run against it.
+static uint16_t             m_idle_next_deadline; // Earliest Idle_Deadline of the running timers.
+static bool                 m_idle_timer_running; // false, every report's Idle_Duration is infinite (0) or expired.
+#ifdef USE_HID_FRAME_IDLE
+static uint16_t             m_idle_frame;         // Frame number m_idle_time was last brought up to.
+#endif
+#if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+static uint8_t              m_in_ppb;         // Next IN buffer to arm.
+static volatile uint8_t     m_in_armed;       // IN buffers owned by the SIE, 0 to 2.
+static uint8_t              m_in_report[2];   // Report number in each IN buffer.
+#ifdef USE_HID_OUT_NO_COPY
+static uint8_t              m_out_ppb;        // Next OUT buffer hid_release_out() arms.
+static volatile uint8_t     m_out_held;       // OUT buffers handed to hid_out_packet(), 0 to 2.
+static volatile bool        m_out_skip;       // The newer held buffer had an unknown Report ID.
+#endif
+#endif
 
 /* ************************************************************************** */
 
@@ -209,6 +278,120 @@ static bool get_idle(void);
  */
 static bool set_idle(void);
 
+/**
+ * @fn bool get_protocol(void)
+ * 
+ * @brief Returns the protocol in use, boot (0) or report (1).
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+static bool get_protocol(void);
+
+/**
+ * @fn bool set_protocol(void)
+ * 
+ * @brief Switches between the boot protocol and the report protocol.
+ * 
+ * In the boot protocol only IN report 0 is sent, from g_hid_boot_in_report, 
+ * and OUT report 0 is received without its Report ID.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+static bool set_protocol(void);
+
+/**
+ * @fn void transmit_report(uint8_t report_num)
+ * 
+ * @brief Copies a report to the next IN buffer and arms it.
+ * 
+ * @param[in] report_num Report number to send.
+ */
+static void transmit_report(uint8_t report_num);
+
+/**
+ * @fn void start_idle_timer(uint8_t report_num)
+ * 
+ * @brief Restarts a report's idle period from now.
+ * 
+ * The deadline only pulls m_idle_next_deadline forward, an earlier deadline 
+ * that has moved on is found stale when it comes round and skipped.
+ * 
+ * @param[in] report_num Report number.
+ */
+static void start_idle_timer(uint8_t report_num);
+
+/**
+ * @fn void find_next_idle_deadline(void)
+ * 
+ * @brief Finds the earliest deadline of the idle timers still running, only 
+ * used when a deadline comes round.
+ */
+static void find_next_idle_deadline(void);
+
+#ifdef USE_HID_FRAME_IDLE
+/**
+ * @fn void idle_catch_up(void)
+ * 
+ * @brief Moves m_idle_time on by the frames since the last call.
+ */
+static void idle_catch_up(void);
+
+/**
+ * @fn void idle_wake(void)
+ * 
+ * @brief Turns the SOF interrupt on when the next deadline is 
+ * HID_IDLE_WAKE_FRAMES away or less, off otherwise. Left alone when _SOFIE is 
+ * in INTERRUPTS_MASK, HID then isn't the only user of the SOF interrupt.
+ */
+static void idle_wake(void);
+#endif
+
+#if defined(USE_HID_OUT_NO_COPY) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP)
+/**
+ * @fn void arm_out(uint8_t ppb)
+ * 
+ * @brief Arms an OUT buffer, the Data Toggle is moved on straight away as both 
+ * buffers can be owned by the SIE at once.
+ * 
+ * @param[in] ppb EVEN or ODD buffer.
+ */
+static void arm_out(uint8_t ppb);
+#endif
+
+#ifdef USE_HID_REPORT_QUEUE
+/**
+ * @fn void send_queued_report(void)
+ * 
+ * @brief Takes the next report from the queue and sends it, HID_QUEUE_PRIORITY 
+ * picks the lowest report number, otherwise the one after the last report sent.
+ */
+static void send_queued_report(void);
+#endif
+
+#ifdef USE_HID_MOTION
+/**
+ * @fn void send_motion(void)
+ * 
+ * @brief Builds HID_MOTION_REPORT from the totals and sends it, if there's 
+ * movement or a button change. The IN EP must be free for it.
+ */
+static void send_motion(void);
+
+/**
+ * @fn void motion_add(volatile int16_t* p_total, int16_t delta)
+ * 
+ * @brief Adds delta to a total, saturating at the int16_t range.
+ */
+static void motion_add(volatile int16_t* p_total, int16_t delta);
+
+/**
+ * @fn int8_t motion_take(volatile int16_t* p_total)
+ * 
+ * @brief Takes up to +-127 from a total for a report field, the rest stays.
+ */
+static int8_t motion_take(volatile int16_t* p_total);
+#endif
+
 /* ************************************************************************** */
 
 
@@ -261,9 +444,11 @@ bool hid_class_request(void)
         #endif
         #ifdef USE_GET_PROTOCOL
         case GET_PROTOCOL:
+            return get_protocol();
         #endif
         #ifdef USE_SET_PROTOCOL
         case SET_PROTOCOL:
+            return set_protocol();
         #endif
         default:
             return false;
@@ -330,6 +515,11 @@ void hid_init(void)
     #endif
     #endif
     
+    #ifdef USE_HID_FEATURE_TASKS
+    m_feature_wait = 0;
+    m_feature_received = 0;
+    #endif
+    
     // EP Settings
     HID_UEPbits.EPHSHK   = 1;  // Handshaking enabled 
     HID_UEPbits.EPCONDIS = 0;  // Don't allow SETUP
@@ -340,28 +530,60 @@ void hid_init(void)
     #if HID_NUM_IN_REPORTS != 0
     HID_UEPbits.EPINEN  = 1;   // EP input enabled
     g_usb_ep_stat[HID_EP][IN].Halt = 0;
+    m_idle_timer_running = false;
+    #ifdef USE_HID_FRAME_IDLE
+    m_idle_frame = usb_get_frame_number();
+    #endif
     #if HID_NUM_IN_REPORTS > 1
     for(uint8_t i = 0; i < HID_NUM_IN_REPORTS; i++)
     {
 		g_hid_sent_report[i] = true;
         g_hid_in_report_settings[i].Idle_Count_Overflow = false;
-        g_hid_in_report_settings[i].Idle_Count = 0;
         g_hid_in_report_settings[i].Idle_Duration_1ms = DEFAULT_IDLE;
         g_hid_in_report_settings[i].Idle_Duration_4ms = DEFAULT_IDLE / 4;
+        start_idle_timer(i);
     }
     #else
     g_hid_sent_report[0] = true;
 	g_hid_in_report_settings[0].Idle_Count_Overflow = false;
-    g_hid_in_report_settings[0].Idle_Count = 0;
     g_hid_in_report_settings[0].Idle_Duration_1ms = DEFAULT_IDLE;
     g_hid_in_report_settings[0].Idle_Duration_4ms = DEFAULT_IDLE / 4;
+    start_idle_timer(0);
     #endif
     #endif
     hid_clear_ep_toggle();
+    #if defined(USE_GET_PROTOCOL) || defined(USE_SET_PROTOCOL)
+    g_hid_protocol = HID_REPORT_PROTOCOL; // Report protocol is the default after configuration.
+    #endif
+    #ifdef USE_HID_REPORT_QUEUE
+    m_queued_reports = 0;
+    #endif
+    #ifdef USE_HID_MOTION
+    m_motion_x = 0;
+    m_motion_y = 0;
+    #ifdef HID_MOTION_WHEEL
+    m_motion_wheel = 0;
+    #endif
+    m_motion_buttons = 0;
+    m_motion_clicks = 0;
+    m_motion_sent = 0;
+    #endif
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    m_in_ppb   = HID_EP_IN_LAST_PPB ^ 1;
+    m_in_armed = 0;
+    #endif
 
     #if HID_NUM_OUT_REPORTS != 0
     #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    #ifdef USE_HID_OUT_NO_COPY
+    m_out_ppb  = HID_EP_OUT_LAST_PPB ^ 1;
+    m_out_held = 0;
+    m_out_skip = false;
+    arm_out(m_out_ppb);
+    arm_out(m_out_ppb ^ 1);
+    #else
     hid_arm_ep_out(HID_BD_OUT_EVEN);
+    #endif
     #else
     hid_arm_ep_out();
     #endif
@@ -371,61 +593,184 @@ void hid_init(void)
 
 void hid_tasks(void)
 {
-    if(TRANSACTION_DIR == IN)
+    if(TRANSACTION_DIR == IN) hid_in_tasks();
+    else hid_out_tasks();
+}
+
+void hid_in_tasks(void)
+{
+    #ifdef USE_HID_IN
+    uint8_t report_num;
+    #endif
+    
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    HID_EP_IN_LAST_PPB = PINGPONG_PARITY; // Data Toggle was moved on when the buffer was armed.
+    #ifdef USE_HID_IN
+    report_num = m_in_report[PINGPONG_PARITY];
+    #endif
+    #else
+    USB_NEXT_TOGGLE(HID_EP_IN_DATA_TOGGLE_VAL);
+    #ifdef USE_HID_IN
+    report_num = g_hid_report_num_sent;
+    #endif
+    #endif
+    hid_set_sent_report_flag();
+    #ifdef USE_HID_REPORT_QUEUE
+    if(m_queued_reports) send_queued_report();
+    #endif
+    #ifdef USE_HID_MOTION
+    if(g_hid_report_sent && g_hid_sent_report[HID_MOTION_REPORT]) send_motion();
+    #endif
+    #ifdef USE_HID_IN
+    hid_in(report_num);
+    #endif
+}
+
+#ifdef USE_HID_OUT_NO_COPY
+void hid_out_tasks(void)
+{
+    bd_t*    p_bd;
+    uint8_t* report;
+    uint8_t  report_num = 0;
+    
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    HID_EP_OUT_LAST_PPB = PINGPONG_PARITY; // Data Toggle was moved on when the buffer was armed.
+    if(PINGPONG_PARITY == ODD) p_bd = &g_usb_bd_table[HID_BD_OUT_ODD];
+    else p_bd = &g_usb_bd_table[HID_BD_OUT_EVEN];
+    m_out_held++;
+    #else
+    USB_NEXT_TOGGLE(HID_EP_OUT_DATA_TOGGLE_VAL);
+    p_bd = &g_usb_bd_table[HID_BD_OUT];
+    #endif
+    report = USB_RAM_PTR(p_bd->ADR);
+    
+    #if HID_NUM_REPORT_IDS != 0
+    #ifdef USE_SET_PROTOCOL
+    if(g_hid_protocol != HID_BOOT_PROTOCOL) // Boot reports have no Report ID.
+    #endif
     {
-        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-        HID_EP_IN_LAST_PPB = PINGPONG_PARITY;
-        #endif
-        HID_EP_IN_DATA_TOGGLE_VAL ^= 1;
-        hid_set_sent_report_flag();
+        if(report[0] == 0 || report[0] > HID_NUM_OUT_REPORTS) // Unknown Report ID, the buffer goes back.
+        {
+            #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+            if(m_out_held == 1) hid_release_out();
+            else m_out_skip = true; // Goes back after the buffer before it.
+            #else
+            hid_arm_ep_out();
+            #endif
+            return;
+        }
+        report_num = report[0] - 1u;
+    }
+    #endif
+    hid_out_packet(report_num, report, p_bd->CNT);
+}
+
+#else
+void hid_out_tasks(void)
+{
+    #if HID_NUM_OUT_REPORTS == 1
+    uint8_t* report = (uint8_t*)g_hid_out_reports[0];
+    uint8_t  size   = HID_OUT_REPORT0_SIZE;
+    
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    HID_EP_OUT_LAST_PPB = PINGPONG_PARITY;
+    #endif
+    USB_NEXT_TOGGLE(HID_EP_OUT_DATA_TOGGLE_VAL);
+    
+    #if defined(USE_SET_PROTOCOL) && HID_NUM_REPORT_IDS != 0
+    if(g_hid_protocol == HID_BOOT_PROTOCOL) // Boot reports have no Report ID.
+    {
+        report++;
+        size--;
+    }
+    #endif
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    if(HID_EP_OUT_LAST_PPB == ODD)
+    {
+        usb_ram_copy((uint8_t*)HID_EP_OUT_ODD_BUFFER_BASE_ADDR, report, size);
+        hid_out(0);
     }
     else
     {
-        #if HID_NUM_OUT_REPORTS == 1
-        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-        HID_EP_OUT_LAST_PPB = PINGPONG_PARITY;
-        #endif
-        HID_EP_OUT_DATA_TOGGLE_VAL ^= 1;
-        
-        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-        if(HID_EP_OUT_LAST_PPB == ODD)
-        {
-            usb_ram_copy((uint8_t*)HID_EP_OUT_ODD_BUFFER_BASE_ADDR, (uint8_t*)g_hid_out_reports[0], g_hid_out_report_size[0]);
-            hid_out(0);
-        }
-        else
-        {
-            usb_ram_copy((uint8_t*)HID_EP_OUT_EVEN_BUFFER_BASE_ADDR, (uint8_t*)g_hid_out_reports[0], g_hid_out_report_size[0]);
-            hid_out(0);
-        }
-        #else
-        usb_ram_copy((uint8_t*)HID_EP_OUT_BUFFER_BASE_ADDR, (uint8_t*)g_hid_out_reports[0], g_hid_out_report_size[0]);
+        usb_ram_copy((uint8_t*)HID_EP_OUT_EVEN_BUFFER_BASE_ADDR, report, size);
         hid_out(0);
-        #endif
-        #elif HID_NUM_OUT_REPORTS > 1
-        uint8_t report_num;
-        
-        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-        HID_EP_OUT_LAST_PPB = PINGPONG_PARITY;
-        #endif
-        HID_EP_OUT_DATA_TOGGLE_VAL ^= 1;
-        
-        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-        uint8_t* ep_buff_base_addr = (uint8_t*)HID_EP_OUT_EVEN_BUFFER_BASE_ADDR;
+    }
+    #else
+    usb_ram_copy((uint8_t*)HID_EP_OUT_BUFFER_BASE_ADDR, report, size);
+    hid_out(0);
+    #endif
+    #elif HID_NUM_OUT_REPORTS > 1
+    uint8_t report_num;
+    
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    HID_EP_OUT_LAST_PPB = PINGPONG_PARITY;
+    #endif
+    USB_NEXT_TOGGLE(HID_EP_OUT_DATA_TOGGLE_VAL);
+    
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    uint8_t* ep_buff_base_addr = (uint8_t*)HID_EP_OUT_EVEN_BUFFER_BASE_ADDR;
 
-        if(HID_EP_OUT_LAST_PPB == ODD) ep_buff_base_addr = (uint8_t*)HID_EP_OUT_ODD_BUFFER_BASE_ADDR;
+    if(HID_EP_OUT_LAST_PPB == ODD) ep_buff_base_addr = (uint8_t*)HID_EP_OUT_ODD_BUFFER_BASE_ADDR;
+    #else
+    uint8_t* ep_buff_base_addr = (uint8_t*)HID_EP_OUT_BUFFER_BASE_ADDR;
+    #endif
 
-        report_num = *ep_buff_base_addr;
-        usb_ram_copy(ep_buff_base_addr, (uint8_t*)g_hid_out_reports[report_num], g_hid_out_report_size[report_num]);
-        hid_out(report_num);
+    #ifdef USE_SET_PROTOCOL
+    if(g_hid_protocol == HID_BOOT_PROTOCOL) // Only report 0, without its Report ID.
+    {
+        usb_ram_copy(ep_buff_base_addr, (uint8_t*)g_hid_out_reports[0] + 1, HID_OUT_REPORT0_SIZE - 1u);
+        hid_out(0);
+        return;
+    }
+    #endif
+    report_num = *ep_buff_base_addr;
+    if(report_num == 0 || report_num > HID_NUM_OUT_REPORTS) // Unknown Report ID, armed again straight away.
+    {
+        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+        if(HID_EP_OUT_LAST_PPB == ODD) hid_arm_ep_out(HID_BD_OUT_EVEN);
+        else hid_arm_ep_out(HID_BD_OUT_ODD);
         #else
-        report_num = *(uint8_t*)HID_EP_OUT_BUFFER_BASE_ADDR;
-        usb_ram_copy((uint8_t*)HID_EP_OUT_BUFFER_BASE_ADDR, (uint8_t*)g_hid_out_reports[report_num], g_hid_out_report_size[report_num]);
-        hid_out(report_num);
-        #endif
+        hid_arm_ep_out();
         #endif
+        return;
     }
+    report_num--;
+    usb_ram_copy(ep_buff_base_addr, (uint8_t*)g_hid_out_reports[report_num], g_hid_out_report_size[report_num]);
+    hid_out(report_num);
+    #endif
 }
+#endif
+
+#ifdef USE_HID_OUT_NO_COPY
+void hid_release_out(void)
+{
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    #ifndef USE_POLLING
+    bool usb_interrupt_enabled = USB_INTERRUPT_ENABLE;
+    
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    if(m_out_held)
+    {
+        m_out_held--;
+        arm_out(m_out_ppb);
+        m_out_ppb ^= 1;
+        if(m_out_skip && m_out_held)
+        {
+            m_out_skip = false;
+            m_out_held--;
+            arm_out(m_out_ppb);
+            m_out_ppb ^= 1;
+        }
+    }
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = usb_interrupt_enabled; // Also called from hid_out_tasks().
+    #endif
+    #else
+    hid_arm_ep_out();
+    #endif
+}
+#endif
 
 void hid_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
 {
@@ -439,15 +784,98 @@ void hid_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
         g_usb_bd_table[++bdt_index].STAT = 0;
         #endif
     }
-    if(dir == IN) hid_set_sent_report_flag();
+    if(dir == IN)
+    {
+        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+        // Reports still armed are dropped, the SIE uses the buffer after the last one completed.
+        g_usb_bd_table[HID_BD_IN_EVEN].STAT = 0;
+        g_usb_bd_table[HID_BD_IN_ODD].STAT  = 0;
+        m_in_ppb = HID_EP_IN_LAST_PPB ^ 1;
+        while(m_in_armed)
+        {
+            HID_EP_IN_LAST_PPB ^= 1;
+            hid_set_sent_report_flag();
+        }
+        HID_EP_IN_LAST_PPB = m_in_ppb ^ 1;
+        g_hid_report_sent = true;
+        #else
+        hid_set_sent_report_flag();
+        #endif
+        #ifdef USE_HID_REPORT_QUEUE
+        if(m_queued_reports) send_queued_report();
+        #endif
+        #ifdef USE_HID_MOTION
+        if(g_hid_report_sent && g_hid_sent_report[HID_MOTION_REPORT]) send_motion();
+        #endif
+    }
+    #if defined(USE_HID_OUT_NO_COPY) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP)
+    else
+    {
+        // Buffers still held are dropped, both are armed again from the cleared toggle.
+        g_usb_bd_table[HID_BD_OUT_EVEN].STAT = 0;
+        g_usb_bd_table[HID_BD_OUT_ODD].STAT  = 0;
+        m_out_ppb  = HID_EP_OUT_LAST_PPB ^ 1;
+        m_out_held = 0;
+        m_out_skip = false;
+        arm_out(m_out_ppb);
+        arm_out(m_out_ppb ^ 1);
+    }
+    #endif
 }
 
 void hid_set_sent_report_flag(void)
 {
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    uint8_t report_num = m_in_report[HID_EP_IN_LAST_PPB];
+    
+    if(m_in_armed) m_in_armed--;
+    g_hid_report_sent = true;
+    if(m_in_armed && m_in_report[HID_EP_IN_LAST_PPB ^ 1] == report_num) return; // Also in the other buffer.
+    #else
+    uint8_t report_num = g_hid_report_num_sent;
+    
     g_hid_report_sent = true;
-    g_hid_sent_report[g_hid_report_num_sent] = true;
+    #endif
+    #ifdef USE_HID_REPORT_QUEUE
+    if(m_queued_reports & (1 << report_num)) return; // Queued again while it was going out.
+    #endif
+    g_hid_sent_report[report_num] = true;
+}
+
+bool hid_out_control_finished(void)
+{
+    #ifdef USE_HID_FEATURE_TASKS
+    if(m_feature_wait)
+    {
+        m_feature_received |= (uint8_t)(1 << (m_feature_wait - 1u));
+        m_feature_wait = 0;
+    }
+    #endif
+    return true;
 }
 
+#ifdef USE_HID_FEATURE_TASKS
+void hid_feature_tasks(void)
+{
+    uint8_t received = m_feature_received;
+    
+    for(uint8_t report_num = 0; report_num < HID_NUM_FEATURE_REPORTS; report_num++)
+    {
+        if((received & (1 << report_num)) == 0) continue;
+        
+        hid_set_feature(report_num);
+        
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 0;
+        #endif
+        m_feature_received &= (uint8_t)~(1 << report_num);
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 1;
+        #endif
+    }
+}
+#endif
+
 void hid_clear_ep_toggle(void)
 {
     g_usb_ep_stat[HID_EP][OUT].Data_Toggle_Val = 0;
@@ -470,10 +898,19 @@ static bool get_report(void)
         #if HID_NUM_IN_REPORTS == 0
         return false;
         #else
+        #ifdef USE_SET_PROTOCOL
+        if(g_hid_protocol == HID_BOOT_PROTOCOL)
+        {
+            usb_set_ram_ptr((uint8_t*)g_hid_boot_in_report);
+            usb_setup_in_control_transfer(RAM, g_hid_boot_in_report_size, m_get_set_report.Report_Length);
+            usb_start_in_control_transfer();
+            return true;
+        }
+        #endif
         #if HID_NUM_REPORT_IDS == 0
         if(m_get_set_report.Report_ID != 0) return false;
         usb_set_ram_ptr((uint8_t*)g_hid_in_reports[0]);
-        bytes_available = g_hid_in_report_size[0];
+        bytes_available = HID_IN_REPORT0_SIZE;
         #else
         if(m_get_set_report.Report_ID > HID_NUM_REPORT_IDS) return false;
         if(m_get_set_report.Report_ID == 0) return false;
@@ -490,9 +927,9 @@ static bool get_report(void)
         #if HID_NUM_REPORT_IDS == 0
         if(m_get_set_report.Report_ID != 0) return false;
         usb_set_ram_ptr((uint8_t*)g_hid_feature_reports[0]);
-        bytes_available = g_hid_feature_report_size[0];
+        bytes_available = HID_FEATURE_REPORT0_SIZE;
         #else
-        if(m_get_set_report.Report_ID > HID_NUM_REPORT_IDS) return false;
+        if(m_get_set_report.Report_ID > HID_NUM_FEATURE_REPORTS) return false;
         if(m_get_set_report.Report_ID == 0) return false;
         usb_set_ram_ptr((uint8_t*)g_hid_feature_reports[m_get_set_report.Report_ID - 1u]);
         bytes_available = g_hid_feature_report_size[m_get_set_report.Report_ID - 1u];
@@ -502,8 +939,7 @@ static bool get_report(void)
     else return false;
     #if HID_NUM_IN_REPORTS != 0 || HID_NUM_FEATURE_REPORTS != 0
     usb_setup_in_control_transfer(RAM, bytes_available, m_get_set_report.Report_Length);
-    usb_in_control_transfer();
-    usb_set_control_stage(DATA_IN_STAGE);
+    usb_start_in_control_transfer();
     return true;
     #endif
 }
@@ -512,6 +948,12 @@ static bool get_report(void)
 static bool set_report(void)
 {
     uint16_t bytes_available = 0;
+    #if HID_NUM_FEATURE_REPORTS != 0
+    uint8_t  report_num;
+    #endif
+    #ifdef USE_HID_FEATURE_TASKS
+    m_feature_wait = 0; // A data stage cut short by a new SETUP leaves nothing behind.
+    #endif
 
     if(m_get_set_report.Report_Type == REPORT_OUTPUT)
     {
@@ -521,12 +963,22 @@ static bool set_report(void)
         #if HID_NUM_REPORT_IDS == 0
         if(m_get_set_report.Report_ID != 0) return false;
         usb_set_ram_ptr((uint8_t*)g_hid_out_reports[0]);
-        bytes_available = g_hid_out_report_size[0];
+        bytes_available = HID_OUT_REPORT0_SIZE;
         #else
-        if(m_get_set_report.Report_ID > HID_NUM_REPORT_IDS) return false;
-        if(m_get_set_report.Report_ID == 0) return false;
-        usb_set_ram_ptr((uint8_t*)g_hid_out_reports[m_get_set_report.Report_ID - 1u]);
-        bytes_available = g_hid_out_report_size[m_get_set_report.Report_ID - 1u];
+        #ifdef USE_SET_PROTOCOL
+        if(g_hid_protocol == HID_BOOT_PROTOCOL) // Report 0, without its Report ID.
+        {
+            usb_set_ram_ptr((uint8_t*)g_hid_out_reports[0] + 1);
+            bytes_available = HID_OUT_REPORT0_SIZE - 1u;
+        }
+        else
+        #endif
+        {
+            if(m_get_set_report.Report_ID > HID_NUM_REPORT_IDS) return false;
+            if(m_get_set_report.Report_ID == 0) return false;
+            usb_set_ram_ptr((uint8_t*)g_hid_out_reports[m_get_set_report.Report_ID - 1u]);
+            bytes_available = g_hid_out_report_size[m_get_set_report.Report_ID - 1u];
+        }
         #endif
         #endif
     }
@@ -537,19 +989,25 @@ static bool set_report(void)
         #else
         #if HID_NUM_REPORT_IDS == 0
         if(m_get_set_report.Report_ID != 0) return false;
-        usb_set_ram_ptr((uint8_t*)g_hid_feature_reports[0]);
-        bytes_available = g_hid_feature_report_size[0];
+        report_num = 0;
         #else
-        if(m_get_set_report.Report_ID > HID_NUM_REPORT_IDS) return false;
+        if(m_get_set_report.Report_ID > HID_NUM_FEATURE_REPORTS) return false;
         if(m_get_set_report.Report_ID == 0) return false;
-        usb_set_ram_ptr((uint8_t*)g_hid_feature_reports[m_get_set_report.Report_ID - 1u]);
-        bytes_available = g_hid_feature_report_size[m_get_set_report.Report_ID - 1u];
+        report_num = m_get_set_report.Report_ID - 1u;
         #endif
+        #ifdef USE_HID_FEATURE_TASKS
+        if(m_feature_received & (1 << report_num)) return false; // hid_set_feature() hasn't had it yet.
+        #endif
+        usb_set_ram_ptr((uint8_t*)g_hid_feature_reports[report_num]);
+        bytes_available = g_hid_feature_report_size[report_num];
         #endif
     }
     else return false;
     #if HID_NUM_OUT_REPORTS != 0 || HID_NUM_FEATURE_REPORTS != 0
     if(m_get_set_report.Report_Length > bytes_available) return false;
+    #ifdef USE_HID_FEATURE_TASKS
+    if(m_get_set_report.Report_Type == REPORT_FEATURE) m_feature_wait = report_num + 1u;
+    #endif
     usb_set_num_out_control_bytes(m_get_set_report.Report_Length);
     usb_set_control_stage(DATA_OUT_STAGE);
     return true;
@@ -574,14 +1032,7 @@ static bool get_idle(void)
     if(m_get_idle.wLength != 1) return false;
 
     usb_setup_in_control_transfer(RAM, 1, 1);
-    
-    #if PINGPONG_MODE == PINGPONG_ALL_EP
-    EP0_IN_LAST_PPB ^= 1;
-    usb_in_control_transfer();
-    #else
-    usb_in_control_transfer();
-    #endif
-    usb_set_control_stage(DATA_IN_STAGE);
+    usb_start_in_control_transfer();
     
     return true;
     #endif
@@ -597,9 +1048,9 @@ static bool set_idle(void)
     #if HID_NUM_REPORT_IDS == 0
     if(m_set_idle.Report_ID != 0) return false;
 	g_hid_in_report_settings[0].Idle_Count_Overflow = false;
-	g_hid_in_report_settings[0].Idle_Count = 0;
     g_hid_in_report_settings[0].Idle_Duration_4ms = m_set_idle.Duration;
     g_hid_in_report_settings[0].Idle_Duration_1ms = ((uint16_t)m_set_idle.Duration) << 2;
+    start_idle_timer(0);
     #else
     if(m_set_idle.Report_ID > HID_NUM_REPORT_IDS) return false;
     if(m_set_idle.Report_ID == 0) // All idles are set
@@ -607,17 +1058,17 @@ static bool set_idle(void)
         for(uint8_t i = 0; i < HID_NUM_IN_REPORTS; i++)
         {
 			g_hid_in_report_settings[i].Idle_Count_Overflow = false;
-			g_hid_in_report_settings[i].Idle_Count = 0;
             g_hid_in_report_settings[i].Idle_Duration_4ms = m_set_idle.Duration;
             g_hid_in_report_settings[i].Idle_Duration_1ms = ((uint16_t)m_set_idle.Duration) << 2;
+            start_idle_timer(i);
         }
     }
     else
     {
 		g_hid_in_report_settings[m_set_idle.Report_ID - 1u].Idle_Count_Overflow = false;
-		g_hid_in_report_settings[m_set_idle.Report_ID - 1u].Idle_Count = 0;
         g_hid_in_report_settings[m_set_idle.Report_ID - 1u].Idle_Duration_4ms = m_set_idle.Duration;
         g_hid_in_report_settings[m_set_idle.Report_ID - 1u].Idle_Duration_1ms = ((uint16_t)m_set_idle.Duration) << 2;
+        start_idle_timer(m_set_idle.Report_ID - 1u);
     }
     #endif
     usb_set_control_stage(STATUS_IN_STAGE);
@@ -627,6 +1078,230 @@ static bool set_idle(void)
 }
 #endif
 
+#ifdef USE_GET_PROTOCOL
+static bool get_protocol(void)
+{
+    if(m_get_set_protocol.wLength != 1) return false;
+    
+    usb_set_ram_ptr((uint8_t*)&g_hid_protocol);
+    usb_setup_in_control_transfer(RAM, 1, 1);
+    usb_start_in_control_transfer();
+    return true;
+}
+#endif
+
+#ifdef USE_SET_PROTOCOL
+static bool set_protocol(void)
+{
+    if(m_get_set_protocol.Protocol > HID_REPORT_PROTOCOL) return false;
+    
+    g_hid_protocol = m_get_set_protocol.Protocol;
+    usb_set_control_stage(STATUS_IN_STAGE);
+    usb_arm_in_status();
+    return true;
+}
+#endif
+
+static void start_idle_timer(uint8_t report_num)
+{
+    uint16_t duration = g_hid_in_report_settings[report_num].Idle_Duration_1ms;
+    uint16_t deadline;
+    
+    if(duration == 0) return; // Infinite, never expires.
+    
+    #ifdef USE_HID_FRAME_IDLE
+    idle_catch_up();
+    #endif
+    deadline = m_idle_time + duration;
+    g_hid_in_report_settings[report_num].Idle_Deadline = deadline;
+    if(!m_idle_timer_running || (int16_t)(deadline - m_idle_next_deadline) < 0)
+    {
+        m_idle_next_deadline = deadline;
+        m_idle_timer_running = true;
+    }
+    #ifdef USE_HID_FRAME_IDLE
+    idle_wake();
+    #endif
+}
+
+static void find_next_idle_deadline(void)
+{
+    uint16_t remaining;
+    uint16_t nearest = 0xFFFF;
+    
+    m_idle_timer_running = false;
+    for(uint8_t i = 0; i < HID_NUM_IN_REPORTS; i++)
+    {
+        if(g_hid_in_report_settings[i].Idle_Duration_1ms == 0 || g_hid_in_report_settings[i].Idle_Count_Overflow) continue;
+        
+        remaining = g_hid_in_report_settings[i].Idle_Deadline - m_idle_time;
+        if(remaining <= nearest)
+        {
+            nearest = remaining;
+            m_idle_next_deadline = g_hid_in_report_settings[i].Idle_Deadline;
+            m_idle_timer_running = true;
+        }
+    }
+}
+
+#ifdef USE_HID_FRAME_IDLE
+static void idle_catch_up(void)
+{
+    uint16_t frame = usb_get_frame_number();
+    
+    m_idle_time += (frame - m_idle_frame) & 0x7FF;
+    m_idle_frame = frame;
+}
+
+static void idle_wake(void)
+{
+    #if (INTERRUPTS_MASK & _SOFIE) == 0 // Otherwise the SOF interrupt stays on for the other usb_sof() users.
+    USB_SOF_ENABLE = m_idle_timer_running && (uint16_t)(m_idle_next_deadline - m_idle_time) <= HID_IDLE_WAKE_FRAMES;
+    #endif
+}
+#endif
+
+static void transmit_report(uint8_t report_num)
+{
+    uint8_t* report = (uint8_t*)g_hid_in_reports[report_num];
+    #if HID_NUM_IN_REPORTS == 1
+    uint8_t  size   = HID_IN_REPORT0_SIZE;
+    #else
+    uint8_t  size   = g_hid_in_report_size[report_num];
+    #endif
+    
+    #ifdef USE_SET_PROTOCOL
+    if(g_hid_protocol == HID_BOOT_PROTOCOL) // hid_send_report() only lets report 0 through.
+    {
+        report = (uint8_t*)g_hid_boot_in_report;
+        size   = g_hid_boot_in_report_size;
+    }
+    #endif
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    uint8_t* ep_buffer_base_addr = (uint8_t*)HID_EP_IN_EVEN_BUFFER_BASE_ADDR;
+    uint8_t bd_in = HID_BD_IN_EVEN;
+
+    if(m_in_ppb == ODD)
+    {
+        ep_buffer_base_addr = (uint8_t*)HID_EP_IN_ODD_BUFFER_BASE_ADDR;
+        bd_in = HID_BD_IN_ODD;
+    }
+
+    usb_ram_copy(report, ep_buffer_base_addr, size);
+    hid_arm_ep_in(bd_in, size);
+    USB_NEXT_TOGGLE(HID_EP_IN_DATA_TOGGLE_VAL); // Both buffers can be armed, so the toggle moves on here.
+    m_in_report[m_in_ppb] = report_num;
+    m_in_ppb ^= 1;
+    m_in_armed++;
+
+    #else
+    usb_ram_copy(report, (uint8_t*)HID_EP_IN_BUFFER_BASE_ADDR, size);
+    hid_arm_ep_in(size);
+    #endif
+    g_hid_in_report_settings[report_num].Idle_Count_Overflow = false;
+    start_idle_timer(report_num);
+    g_hid_sent_report[report_num] = false;
+    g_hid_report_num_sent = report_num;
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    g_hid_report_sent = (m_in_armed < 2); // The other buffer can still take a report.
+    #else
+    g_hid_report_sent = false;
+    #endif
+}
+
+#if defined(USE_HID_OUT_NO_COPY) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP)
+static void arm_out(uint8_t ppb)
+{
+    if(ppb == ODD) hid_arm_ep_out(HID_BD_OUT_ODD);
+    else hid_arm_ep_out(HID_BD_OUT_EVEN);
+    USB_NEXT_TOGGLE(HID_EP_OUT_DATA_TOGGLE_VAL);
+}
+#endif
+
+#ifdef USE_HID_REPORT_QUEUE
+static void send_queued_report(void)
+{
+    uint8_t report_num;
+    
+    #if HID_NUM_IN_REPORTS > 1
+    #ifdef HID_QUEUE_PRIORITY
+    report_num = 0;
+    #else
+    report_num = g_hid_report_num_sent;
+    #endif
+    for(uint8_t i = 0; i < HID_NUM_IN_REPORTS; i++)
+    {
+        #ifndef HID_QUEUE_PRIORITY
+        if(++report_num == HID_NUM_IN_REPORTS) report_num = 0;
+        #endif
+        if(m_queued_reports & (1 << report_num)) break;
+        #ifdef HID_QUEUE_PRIORITY
+        report_num++;
+        #endif
+    }
+    #else
+    report_num = 0;
+    #endif
+    
+    m_queued_reports &= (uint8_t)~(1 << report_num);
+    transmit_report(report_num);
+}
+#endif
+
+#ifdef USE_HID_MOTION
+static void send_motion(void)
+{
+    uint8_t* report = (uint8_t*)g_hid_in_reports[HID_MOTION_REPORT];
+    uint8_t  buttons = m_motion_buttons | m_motion_clicks;
+    
+    #ifdef HID_MOTION_WHEEL
+    if(m_motion_x == 0 && m_motion_y == 0 && m_motion_wheel == 0 && buttons == m_motion_sent) return;
+    #else
+    if(m_motion_x == 0 && m_motion_y == 0 && buttons == m_motion_sent) return;
+    #endif
+    #ifdef USE_SET_PROTOCOL
+    if(g_hid_protocol == HID_BOOT_PROTOCOL) report = (uint8_t*)g_hid_boot_in_report; // What transmit_report() sends.
+    #endif
+    
+    report[HID_MOTION_BUTTONS] = buttons;
+    report[HID_MOTION_X] = (uint8_t)motion_take(&m_motion_x);
+    report[HID_MOTION_Y] = (uint8_t)motion_take(&m_motion_y);
+    #ifdef HID_MOTION_WHEEL
+    report[HID_MOTION_WHEEL] = (uint8_t)motion_take(&m_motion_wheel);
+    #endif
+    m_motion_clicks = 0;
+    m_motion_sent = buttons;
+    transmit_report(HID_MOTION_REPORT);
+    
+    // The report is in the EP buffer, idle repeats of it mustn't move the pointer again.
+    report[HID_MOTION_X] = 0;
+    report[HID_MOTION_Y] = 0;
+    #ifdef HID_MOTION_WHEEL
+    report[HID_MOTION_WHEEL] = 0;
+    #endif
+}
+
+static void motion_add(volatile int16_t* p_total, int16_t delta)
+{
+    int16_t total = *p_total;
+    
+    if(delta > 0 && total > (int16_t)(32767 - delta)) total = 32767;
+    else if(delta < 0 && total < (int16_t)(-32767 - delta)) total = -32767;
+    else total += delta;
+    *p_total = total;
+}
+
+static int8_t motion_take(volatile int16_t* p_total)
+{
+    int16_t take = *p_total;
+    
+    if(take > 127) take = 127;
+    else if(take < -127) take = -127;
+    *p_total -= take;
+    return (int8_t)take;
+}
+#endif
+
 /* ************************************************************************** */
 
 
@@ -636,60 +1311,141 @@ static bool set_idle(void)
 
 void hid_send_report(uint8_t report_num)
 {
+    #ifdef USE_SET_PROTOCOL
+    if(g_hid_protocol == HID_BOOT_PROTOCOL && report_num != 0) // No boot form, the host can't read it.
+    {
+        g_hid_sent_report[report_num] = true;
+        return;
+    }
+    #endif
+    #ifdef USE_HID_REPORT_QUEUE
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    m_queued_reports |= (uint8_t)(1 << report_num);
+    g_hid_sent_report[report_num] = false;
+    if(g_hid_report_sent) send_queued_report();
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    #else
     if(g_hid_report_sent)
     {
-        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-        uint8_t* ep_buffer_base_addr = (uint8_t*)HID_EP_IN_ODD_BUFFER_BASE_ADDR;
-        uint8_t bd_in = HID_BD_IN_ODD;
-
-        if(HID_EP_IN_LAST_PPB == ODD)
-        {
-            ep_buffer_base_addr = (uint8_t*)HID_EP_IN_EVEN_BUFFER_BASE_ADDR;
-            bd_in = HID_BD_IN_EVEN;
-        }
-
-        usb_ram_copy((uint8_t*)g_hid_in_reports[report_num], ep_buffer_base_addr, g_hid_in_report_size[report_num]);
-        hid_arm_ep_in(bd_in, g_hid_in_report_size[report_num]);
-
-        #else
-        usb_ram_copy((uint8_t*)g_hid_in_reports[report_num], (uint8_t*)HID_EP_IN_BUFFER_BASE_ADDR, g_hid_in_report_size[report_num]);
-        hid_arm_ep_in(g_hid_in_report_size[report_num]);
-        #endif
+        #ifndef USE_POLLING
 		USB_INTERRUPT_ENABLE = 0;
-        g_hid_in_report_settings[report_num].Idle_Count = 0;
+        #endif
+        transmit_report(report_num);
+        #ifndef USE_POLLING
 		USB_INTERRUPT_ENABLE = 1;
-		g_hid_sent_report[report_num] = false;
-		g_hid_report_num_sent = report_num;
-        g_hid_report_sent = false;
+        #endif
     }
+    #endif
+}
+
+#ifdef USE_HID_MOTION
+void hid_motion_add(int16_t x, int16_t y, int8_t wheel)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    motion_add(&m_motion_x, x);
+    motion_add(&m_motion_y, y);
+    #ifdef HID_MOTION_WHEEL
+    motion_add(&m_motion_wheel, wheel);
+    #endif
+    if(usb_get_state() == STATE_CONFIGURED && g_hid_report_sent && g_hid_sent_report[HID_MOTION_REPORT]) send_motion();
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+void hid_motion_buttons(uint8_t buttons)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    m_motion_clicks |= buttons & (uint8_t)~m_motion_buttons;
+    m_motion_buttons = buttons;
+    if(usb_get_state() == STATE_CONFIGURED && g_hid_report_sent && g_hid_sent_report[HID_MOTION_REPORT]) send_motion();
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
 }
+#endif
 
 void hid_service_sof(void)
 {
     if(usb_get_state() == STATE_CONFIGURED)
     {
-        #if HID_NUM_IN_REPORTS > 1
-        uint8_t i;
-        for(i = 0; i < HID_NUM_IN_REPORTS; i++)
-        {
-            if(g_hid_in_report_settings[i].Idle_Duration_1ms != 0) 
-                g_hid_in_report_settings[i].Idle_Count++; // If the Idle_Duration for a report is not infinite (0), increment their counter.
-        }
-        
-        for(i = 0; i < HID_NUM_IN_REPORTS; i++) // If an Idle_Counter is not infinite and goes past the Idle_Duration, send the report.
+        #ifdef USE_HID_FRAME_IDLE
+        idle_catch_up();
+        if(!m_idle_timer_running || (int16_t)(m_idle_time - m_idle_next_deadline) < 0) // Nothing due yet.
         {
-            if(g_hid_in_report_settings[i].Idle_Duration_1ms != 0 && g_hid_in_report_settings[i].Idle_Count > g_hid_in_report_settings[i].Idle_Duration_1ms - 1) 
-                g_hid_in_report_settings[i].Idle_Count_Overflow = true;
+            idle_wake();
+            return;
         }
         #else
-		if(g_hid_in_report_settings[0].Idle_Duration_1ms != 0)
+        m_idle_time++;
+        if(!m_idle_timer_running || m_idle_time != m_idle_next_deadline) return; // Nothing expires this frame.
+        #endif
+        
+        for(uint8_t i = 0; i < HID_NUM_IN_REPORTS; i++)
         {
-			g_hid_in_report_settings[0].Idle_Count++; // If the Idle_Duration is not infinite (0), increment the counter.
-			if(g_hid_in_report_settings[0].Idle_Count > g_hid_in_report_settings[0].Idle_Duration_1ms - 1) 
-                g_hid_in_report_settings[0].Idle_Count_Overflow = true;
+            if(g_hid_in_report_settings[i].Idle_Duration_1ms == 0 || g_hid_in_report_settings[i].Idle_Count_Overflow) continue;
+            #ifdef USE_HID_FRAME_IDLE
+            if((int16_t)(m_idle_time - g_hid_in_report_settings[i].Idle_Deadline) < 0) continue; // Frames can be skipped.
+            #else
+            if(g_hid_in_report_settings[i].Idle_Deadline != m_idle_time) continue;
+            #endif
+            
+            g_hid_in_report_settings[i].Idle_Count_Overflow = true;
+            #ifdef USE_HID_REPORT_QUEUE
+            #ifdef USE_SET_PROTOCOL
+            if(g_hid_protocol == HID_BOOT_PROTOCOL && i != 0) continue;
+            #endif
+            m_queued_reports |= (uint8_t)(1 << i); // Idle report goes straight to the queue.
+            g_hid_sent_report[i] = false;
+            #endif
         }
+        #ifdef USE_HID_REPORT_QUEUE
+        if(m_queued_reports && g_hid_report_sent) send_queued_report();
+        #endif
+        find_next_idle_deadline();
+        #ifdef USE_HID_FRAME_IDLE
+        idle_wake();
         #endif
     }
 }
 
+#ifdef USE_HID_FRAME_IDLE
+void hid_service_idle(void)
+{
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    hid_service_sof();
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+}
+
+uint16_t hid_idle_frames_left(void)
+{
+    uint16_t left = 0xFFFF;
+    
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 0;
+    #endif
+    if(m_idle_timer_running)
+    {
+        idle_catch_up();
+        left = ((int16_t)(m_idle_next_deadline - m_idle_time) < 0) ? 0 : m_idle_next_deadline - m_idle_time;
+    }
+    #ifndef USE_POLLING
+    USB_INTERRUPT_ENABLE = 1;
+    #endif
+    return left;
+}
+#endif
+
 /* ************************************************************************** */
\ No newline at end of file
@@ -40,21 +40,13 @@
 /* ************************ HID ENDPOINT ADDRESSES ************************** */
 /* ************************************************************************** */
 
-#if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_1_15
-#define HID_EP_BUFFERS_STARTING_ADDR (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE * 2))
-#elif PINGPONG_MODE == PINGPONG_0_OUT
-#define HID_EP_BUFFERS_STARTING_ADDR  (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE * 3))
-#else
-#define HID_EP_BUFFERS_STARTING_ADDR (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE * 4))
-#endif
-
 #if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
 #ifdef _PIC14E
 #define HID_EP_OUT_BUFFER_BASE_ADDR 0x2050
 #define HID_EP_IN_BUFFER_BASE_ADDR  0x20A0
 #else
-#define HID_EP_OUT_BUFFER_BASE_ADDR   HID_EP_BUFFERS_STARTING_ADDR
-#define HID_EP_IN_BUFFER_BASE_ADDR   (HID_EP_BUFFERS_STARTING_ADDR + HID_EP_SIZE)
+#define HID_EP_OUT_BUFFER_BASE_ADDR EP_OUT_BUFFER_ADDR(HID_EP)
+#define HID_EP_IN_BUFFER_BASE_ADDR  EP_IN_BUFFER_ADDR(HID_EP)
 #endif
 
 #else // PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
@@ -64,11 +56,41 @@
 #define HID_EP_IN_EVEN_BUFFER_BASE_ADDR  0x20F0
 #define HID_EP_IN_ODD_BUFFER_BASE_ADDR   0x2140
 #else
-#define HID_EP_OUT_EVEN_BUFFER_BASE_ADDR  HID_EP_BUFFERS_STARTING_ADDR
-#define HID_EP_OUT_ODD_BUFFER_BASE_ADDR   (HID_EP_BUFFERS_STARTING_ADDR + HID_EP_SIZE)
-#define HID_EP_IN_EVEN_BUFFER_BASE_ADDR   (HID_EP_BUFFERS_STARTING_ADDR + (HID_EP_SIZE * 2))
-#define HID_EP_IN_ODD_BUFFER_BASE_ADDR    (HID_EP_BUFFERS_STARTING_ADDR + (HID_EP_SIZE * 3))
+#define HID_EP_OUT_EVEN_BUFFER_BASE_ADDR EP_OUT_EVEN_BUFFER_ADDR(HID_EP)
+#define HID_EP_OUT_ODD_BUFFER_BASE_ADDR  EP_OUT_ODD_BUFFER_ADDR(HID_EP)
+#define HID_EP_IN_EVEN_BUFFER_BASE_ADDR  EP_IN_EVEN_BUFFER_ADDR(HID_EP)
+#define HID_EP_IN_ODD_BUFFER_BASE_ADDR   EP_IN_ODD_BUFFER_ADDR(HID_EP)
+#endif
+#endif
+
+#if defined(_PIC14E) && (PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT) && ((HID_EP_IN_BUFFER_BASE_ADDR + HID_EP_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "HID's EP buffers overlap the EP0 buffers, reduce EP0_SIZE."
+#elif defined(_PIC14E) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP) && ((HID_EP_IN_ODD_BUFFER_BASE_ADDR + HID_EP_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "HID's EP buffers overlap the EP0 buffers, reduce EP0_SIZE or HID_EP_SIZE."
+#endif
+
+#if defined(USE_SET_PROTOCOL) && !defined(USE_GET_PROTOCOL)
+#error "USE_SET_PROTOCOL needs USE_GET_PROTOCOL, a boot device must answer both."
+#endif
+
+#if defined(USE_HID_REPORT_QUEUE) && (HID_NUM_IN_REPORTS > 8)
+#error "USE_HID_REPORT_QUEUE keeps the queue in an 8 bit map, HID_NUM_IN_REPORTS must be 8 or less."
+#endif
+
+#if defined(USE_HID_FEATURE_TASKS) && (!defined(USE_SET_REPORT) || !defined(USE_OUT_CONTROL_FINISHED))
+#error "USE_HID_FEATURE_TASKS needs USE_SET_REPORT, and USE_OUT_CONTROL_FINISHED in usb_config.h."
+#endif
+
+#if defined(USE_HID_FRAME_IDLE) && !defined(USE_SOF)
+#error "USE_HID_FRAME_IDLE needs USE_SOF, usb_sof() still calls hid_service_sof() when a deadline is near."
 #endif
+
+#if defined(USE_HID_MOTION) && (HID_MOTION_REPORT >= HID_NUM_IN_REPORTS)
+#error "HID_MOTION_REPORT must be one of the IN reports."
+#endif
+
+#if defined(USE_HID_FEATURE_TASKS) && (HID_NUM_FEATURE_REPORTS > 8)
+#error "USE_HID_FEATURE_TASKS keeps the received reports in an 8 bit map, HID_NUM_FEATURE_REPORTS must be 8 or less."
 #endif
 
 /* ************************************************************************** */
@@ -86,6 +108,10 @@
 #define HID_KEYBOARD 1
 #define HID_MOUSE    2
 
+// Get_Protocol/Set_Protocol Values
+#define HID_BOOT_PROTOCOL   0
+#define HID_REPORT_PROTOCOL 1
+
 #define HID_DESC          0x21
 #define HID_REPORT_DESC   0x22
 #define HID_PHYSICAL_DESC 0x23
@@ -124,13 +150,56 @@ typedef struct
 {
     uint8_t  Idle_Duration_4ms;
     uint16_t Idle_Duration_1ms;
-    uint16_t Idle_Count;
-	bool     Idle_Count_Overflow;
+    uint16_t Idle_Deadline;       // SOF count the idle period ends at.
+	bool     Idle_Count_Overflow; // Idle period ended, the report is due.
 }hid_in_report_setting_t;
 
 /* ************************************************************************** */
 
 
+/* ************************************************************************** */
+/* ************************ HID FUNCTION DESCRIPTORS ************************ */
+/* ************************************************************************** */
+
+#ifndef HID_INT
+#define HID_INT 0 // HID Interface Number.
+#endif
+
+typedef struct
+{
+    ch9_standard_interface_descriptor_t interface;
+    hid_descriptor_t                    hid;
+    ch9_standard_endpoint_descriptor_t  ep_in;
+    #if HID_NUM_OUT_REPORTS != 0
+    ch9_standard_endpoint_descriptor_t  ep_out;
+    #endif
+}hid_function_descriptors_t;
+
+/*
+ * Initializer for hid_function_descriptors_t, see the DESCRIPTOR BUILDER in 
+ * usb_ch9.h. Uses interface HID_INT and HID_EP, the OUT EP is only added when 
+ * there are OUT reports. Point g_hid_descriptor at the hid member.
+ */
+#if HID_NUM_OUT_REPORTS != 0
+#define HID_FUNCTION_DESCRIPTORS(subclass, protocol, report_descriptor_size, interval) \
+{ \
+    CH9_INTERFACE_DESCRIPTOR(HID_INT, 0, 2, HID, (subclass), (protocol)), \
+    {9, HID_DESC, 0x0111, 0x00, HID_NUM_DESC, HID_REPORT_DESC, (report_descriptor_size)}, \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(HID_EP), EP_INTERRUPT, HID_EP_SIZE, (interval)), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_OUT_ADDR(HID_EP), EP_INTERRUPT, HID_EP_SIZE, (interval)) \
+}
+#else
+#define HID_FUNCTION_DESCRIPTORS(subclass, protocol, report_descriptor_size, interval) \
+{ \
+    CH9_INTERFACE_DESCRIPTOR(HID_INT, 0, 1, HID, (subclass), (protocol)), \
+    {9, HID_DESC, 0x0111, 0x00, HID_NUM_DESC, HID_REPORT_DESC, (report_descriptor_size)}, \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(HID_EP), EP_INTERRUPT, HID_EP_SIZE, (interval)) \
+}
+#endif
+
+/* ************************************************************************** */
+
+
 /* ************************************************************************** */
 /* ************************** VARS FROM: usb_hid_c ************************** */
 /* ************************************************************************** */
@@ -146,10 +215,13 @@ extern uint8_t g_hid_ep_in_even[HID_EP_SIZE]   __at(HID_EP_IN_EVEN_BUFFER_BASE_A
 extern uint8_t g_hid_ep_in_odd[HID_EP_SIZE]    __at(HID_EP_IN_ODD_BUFFER_BASE_ADDR);
 #endif
 
-extern volatile bool                    g_hid_report_sent;
+extern USB_ACCESS volatile bool         g_hid_report_sent;
 extern volatile uint8_t                 g_hid_report_num_sent;
 extern volatile bool                    g_hid_sent_report[HID_NUM_IN_REPORTS];
 extern volatile hid_in_report_setting_t g_hid_in_report_settings[HID_NUM_IN_REPORTS];
+#if defined(USE_GET_PROTOCOL) || defined(USE_SET_PROTOCOL)
+extern volatile uint8_t                 g_hid_protocol;
+#endif
 
 /* ************************************************************************** */
 
@@ -195,6 +267,24 @@ void hid_init(void);
  */
 void hid_tasks(void);
 
+/**
+ * @fn void hid_in_tasks(void)
+ * 
+ * @brief Services a completed transaction on HID's IN Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void hid_in_tasks(void);
+
+/**
+ * @fn void hid_out_tasks(void)
+ * 
+ * @brief Services a completed transaction on HID's OUT Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void hid_out_tasks(void);
+
 /**
  * @fn void hid_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
  * 
@@ -308,7 +398,15 @@ void hid_arm_ep_in(uint8_t cnt);
 /**
  * @fn void hid_send_report(uint8_t report_num)
  * 
- * @brief Sends OUT Report on HID EP.
+ * @brief Sends IN Report on HID EP.
+ * 
+ * Without USE_HID_REPORT_QUEUE nothing is sent while g_hid_report_sent is false. 
+ * With it the report is queued, and sent from g_hid_in_reports[report_num] when 
+ * its turn comes, so calling again before then only updates the data sent. 
+ * g_hid_sent_report[report_num] stays false until the report has gone.
+ * 
+ * With PINGPONG_1_15 or PINGPONG_ALL_EP both IN buffers are used, so 
+ * g_hid_report_sent is only false while two reports wait for the host.
  * 
  * @param report_num Report number to send.
  */
@@ -318,9 +416,79 @@ void hid_send_report(uint8_t report_num);
  * @fn void hid_service_sof(void)
  * 
  * @brief Sends OUT Report on HID EP regularly using SOF.
+ * 
+ * Each report's idle period is kept as a deadline against a SOF count, so a 
+ * frame with no deadline costs one compare. Reports are only looked at when a 
+ * deadline comes round. With USE_HID_REPORT_QUEUE an expired report is also 
+ * queued.
  */
 void hid_service_sof(void);
 
+#ifdef USE_HID_FRAME_IDLE
+/**
+ * @fn void hid_service_idle(void)
+ * 
+ * @brief Run in the main loop in place of a SOF interrupt every frame, the 
+ * idle timers catch up from the 11 bit frame number.
+ * 
+ * Take _SOFIE out of INTERRUPTS_MASK and keep hid_service_sof() in usb_sof(). 
+ * The SOF interrupt is only turned on from HID_IDLE_WAKE_FRAMES before the 
+ * next deadline, so a frame with nothing due costs no interrupt. HID has to be 
+ * the only user of usb_sof() for that: with _SOFIE left in INTERRUPTS_MASK 
+ * (CDC flushing, Audio, app timers) the SOF interrupt is never turned off and 
+ * only the catching up from the frame number is kept. It has to 
+ * run at least every 2 seconds (the frame number wraps at 2048), a main loop 
+ * that waits for interrupts can use hid_idle_frames_left() to set a timer.
+ */
+void hid_service_idle(void);
+
+/**
+ * @fn uint16_t hid_idle_frames_left(void)
+ * 
+ * @brief Returns the frames until the next idle deadline, 0xFFFF if none runs.
+ */
+uint16_t hid_idle_frames_left(void);
+#endif
+
+#ifdef USE_HID_MOTION
+/**
+ * @fn void hid_motion_add(int16_t x, int16_t y, int8_t wheel)
+ * 
+ * @brief Adds movement to the totals for the next motion report.
+ * 
+ * The report is built when the host has read the last one (in hid_tasks()), 
+ * or straight away if the IN EP is free, so each poll carries all the 
+ * movement since the one before. Each field is limited to -127 to 127 and 
+ * the rest is carried to the next report, nothing is dropped. 
+ * hid_send_report() of HID_MOTION_REPORT is then only for idle repeats, they 
+ * carry the buttons and no movement. wheel is ignored without HID_MOTION_WHEEL.
+ * 
+ * @param[in] x Counts moved in X.
+ * @param[in] y Counts moved in Y.
+ * @param[in] wheel Wheel detents.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * hid_motion_add(sensor_dx(), sensor_dy(), 0);
+ * @endcode
+ * </li></ul>
+ */
+void hid_motion_add(int16_t x, int16_t y, int8_t wheel);
+
+/**
+ * @fn void hid_motion_buttons(uint8_t buttons)
+ * 
+ * @brief Sets the buttons held (bit n, button n + 1) for the motion report.
+ * 
+ * A button pressed and released again before the host's next poll is still 
+ * sent as pressed once, then released.
+ * 
+ * @param[in] buttons Buttons held now.
+ */
+void hid_motion_buttons(uint8_t buttons);
+#endif
+
 /** @fn void hid_out(void)
  * 
  * @brief Function to run in main, so you can respond to reception of 
@@ -330,6 +498,94 @@ void hid_service_sof(void);
  */
 void hid_out(uint8_t report_num);
 
+#ifdef USE_HID_OUT_NO_COPY
+/** @fn void hid_out_packet(uint8_t report_num, uint8_t* report, uint8_t cnt)
+ * 
+ * @brief Function you provide in place of hid_out(), called from 
+ * hid_out_tasks() with the OUT report still in the EP buffer.
+ * 
+ * The buffer stays yours until hid_release_out(), with ping-pong the host can 
+ * fill the other one meanwhile. Report IDs are checked against 
+ * HID_NUM_OUT_REPORTS first, packets with an unknown one never get here.
+ * 
+ * @param report_num Report number received.
+ * @param report Report in the EP buffer, starting with its Report ID if used.
+ * @param cnt Bytes received.
+ */
+void hid_out_packet(uint8_t report_num, uint8_t* report, uint8_t cnt);
+
+/** @fn void hid_release_out(void)
+ * 
+ * @brief Hands the oldest OUT buffer given to hid_out_packet() back to the 
+ * SIE. Buffers must be released in the order they came.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * void hid_out_packet(uint8_t report_num, uint8_t* report, uint8_t cnt)
+ * {
+ *     if(report[0] == COMMAND_TOGGLE_LED) LED_LAT ^= (1 << LED_BIT);
+ *     hid_release_out();
+ * }
+ * @endcode
+ * </li></ul>
+ */
+void hid_release_out(void);
+#endif
+
+/**
+ * @fn bool hid_out_control_finished(void)
+ * 
+ * @brief Ends the data stage of a SET_REPORT, call it from usb_out_control_finished() 
+ * (or put it in g_usb_if_handlers).
+ * 
+ * The status stage is always acknowledged straight away. With 
+ * USE_HID_FEATURE_TASKS a received Feature Report is left for hid_feature_tasks().
+ * 
+ * @return Returns true, the report has been taken.
+ */
+bool hid_out_control_finished(void);
+
+#ifdef USE_HID_FEATURE_TASKS
+/**
+ * @fn void hid_feature_tasks(void)
+ * 
+ * @brief Run in the main loop, calls hid_set_feature() for every Feature Report 
+ * received by SET_REPORT since the last call.
+ * 
+ * EP0 isn't held meanwhile, the host's SET_REPORT has already finished. Until 
+ * hid_set_feature() returns, another SET_REPORT for the same report is stalled 
+ * so the data can't change underneath it.
+ * 
+ * GET_REPORT(Feature) is always served straight from g_hid_feature_reports[] 
+ * in RAM, stage the data there ahead of time. A report no bigger than EP0_SIZE 
+ * is copied to the EP0 buffer while the SETUP is serviced, so updating it with 
+ * the USB interrupt disabled can't tear it.
+ */
+void hid_feature_tasks(void);
+
+/** @fn void hid_set_feature(uint8_t report_num)
+ * 
+ * @brief Function you provide, called from hid_feature_tasks() with a Feature 
+ * Report the host has set.
+ * 
+ * @param report_num Feature Report number received, its data is in 
+ * g_hid_feature_reports[report_num].
+ */
+void hid_set_feature(uint8_t report_num);
+#endif
+
+#ifdef USE_HID_IN
+/** @fn void hid_in(uint8_t report_num)
+ * 
+ * @brief Function you provide, called from hid_in_tasks() once the host has 
+ * read an IN Report, so the next one can follow straight away.
+ * 
+ * @param report_num Report number sent.
+ */
+void hid_in(uint8_t report_num);
+#endif
+
 /* ************************************************************************** */
 
 #endif /* USB_HID_H */
\ No newline at end of file
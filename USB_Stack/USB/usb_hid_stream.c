@@ -0,0 +1,339 @@
+/**
+ * @file usb_hid_stream.c
+ * @brief Contains <i>HID Class</i> multi-endpoint streaming functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - HID Stream Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_hid_stream.h"
+#include "usb_hid_report_defines.h"
+#include "usb_hid_pages.h"
+#include "usb_ch9.h"
+
+/* ************************************************************************** */
+/* ************************ HID STREAM DESCRIPTORS ************************** */
+/* ************************************************************************** */
+
+// Report Descriptor (Vendor), HID_STREAM_EP_SIZE bytes in and out, no Report ID.
+// Sized to HID_STREAM_REPORT_DESC_SIZE so the HID Descriptors can give its length.
+const uint8_t g_hid_stream_report_descriptor[HID_STREAM_REPORT_DESC_SIZE] =
+{
+    Usage_Page2(VENDOR_DEFINED_PAGE),
+    Usage(0x01),
+    Collection(APPLICATION),
+        Usage_Minimum(1),
+        Usage_Maximum(HID_STREAM_EP_SIZE),
+        Logic_Minimum(0),
+        Logic_Maximum2(0x00FF),
+        Report_Size(8),
+        Report_Count(HID_STREAM_EP_SIZE),
+        Input(DATA|ARRAY|ABSOLUTE),
+        Usage_Minimum(1),
+        Usage_Maximum(HID_STREAM_EP_SIZE),
+        Output(DATA|ARRAY|ABSOLUTE),
+    End_Collection()
+};
+
+// Every channel has the same HID Descriptor, it's served from here instead of 
+// the Configuration Descriptor.
+static const hid_stream_descriptor_t m_hid_descriptor =
+{
+    9, HID_STREAM_DESC, 0x0111, 0x00, 1, HID_STREAM_REPORT_DESC, HID_STREAM_REPORT_DESC_SIZE
+};
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** HID STREAM EP BUFFERS **************************** */
+/* ************************************************************************** */
+
+static uint8_t m_ep_buffers[HID_STREAM_NUM_CH][2][HID_STREAM_NUM_BUFFERS][HID_STREAM_EP_SIZE] __at(HID_STREAM_EP_BUFFERS_BASE_ADDR);
+
+#define CH_EP(ch) ((ch) + 1)
+
+#if HID_STREAM_NUM_BUFFERS == 2
+#define PPB_NEXT(ppb) ((ppb) ^ 1)
+#else
+#define PPB_NEXT(ppb) 0
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+static uint8_t m_out_ppb[HID_STREAM_NUM_CH]; // Next OUT buffer the Application reads.
+static uint8_t m_in_ppb[HID_STREAM_NUM_CH];  // Next IN buffer the Application writes.
+static uint8_t m_idle[HID_STREAM_NUM_CH];    // SET_IDLE duration, only kept for GET_IDLE.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void arm(uint8_t ch, uint8_t dir, uint8_t ppb)
+ * 
+ * @brief Arms a buffer with HID_STREAM_EP_SIZE bytes, the Data Toggle is moved 
+ * on straight away as both ping-pong buffers can be owned by the SIE at once.
+ * 
+ * @param[in] ch Channel number.
+ * @param[in] dir OUT or IN.
+ * @param[in] ppb EVEN or ODD buffer.
+ */
+static void arm(uint8_t ch, uint8_t dir, uint8_t ppb);
+
+/**
+ * @fn void reset_out(uint8_t ch)
+ * 
+ * @brief Drops every OUT buffer of a channel and arms them again from DATA0, 
+ * starting with the buffer the SIE uses next.
+ * 
+ * @param[in] ch Channel number.
+ */
+static void reset_out(uint8_t ch);
+
+/**
+ * @fn void reset_in(uint8_t ch)
+ * 
+ * @brief Drops every IN buffer of a channel not sent yet, the next one written 
+ * is the buffer the SIE uses next.
+ * 
+ * @param[in] ch Channel number.
+ */
+static void reset_in(uint8_t ch);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************* HID STREAM FUNCTIONS *************************** */
+/* ************************************************************************** */
+
+void hid_stream_init(void)
+{
+    for(uint8_t ch = 0; ch < HID_STREAM_NUM_CH; ch++)
+    {
+        for(uint8_t dir = OUT; dir <= IN; dir++)
+        {
+            for(uint8_t ppb = 0; ppb < HID_STREAM_NUM_BUFFERS; ppb++)
+            {
+                g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), dir, ppb)].STAT = 0;
+                g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), dir, ppb)].ADR  = USB_RAM_ADDR(m_ep_buffers[ch][dir][ppb]);
+            }
+            g_usb_ep_stat[CH_EP(ch)][dir].Halt = 0;
+        }
+        m_idle[ch] = 0;
+    }
+    
+    // EP Settings, handshaking, IN and OUT enabled, no SETUP.
+    UEP1 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #if HID_STREAM_NUM_CH > 1
+    UEP2 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if HID_STREAM_NUM_CH > 2
+    UEP3 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if HID_STREAM_NUM_CH > 3
+    UEP4 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if HID_STREAM_NUM_CH > 4
+    UEP5 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if HID_STREAM_NUM_CH > 5
+    UEP6 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    #if HID_STREAM_NUM_CH > 6
+    UEP7 = _EPHSHK | _EPCONDIS | _EPOUTEN | _EPINEN;
+    #endif
+    
+    for(uint8_t ch = 0; ch < HID_STREAM_NUM_CH; ch++)
+    {
+        reset_out(ch);
+        reset_in(ch);
+    }
+}
+
+void hid_stream_tasks(void)
+{
+    if(TRANSACTION_DIR == IN) hid_stream_in_tasks();
+    else hid_stream_out_tasks();
+}
+
+void hid_stream_out_tasks(void)
+{
+    // Data Toggle was moved on when armed, only the SIE's position is kept.
+    g_usb_ep_stat[TRANSACTION_EP][OUT].Last_PPB = PINGPONG_PARITY;
+}
+
+void hid_stream_in_tasks(void)
+{
+    g_usb_ep_stat[TRANSACTION_EP][IN].Last_PPB = PINGPONG_PARITY;
+}
+
+bool hid_stream_class_request(void)
+{
+    uint8_t ch = (uint8_t)g_usb_setup.wIndex - HID_STREAM_FIRST_INT;
+    
+    if(g_usb_setup.bmRequestType_bits.Type != CLASS) return false;
+    if(ch >= HID_STREAM_NUM_CH) return false;
+    
+    switch(g_usb_setup.bRequest)
+    {
+        case HID_STREAM_SET_IDLE:
+            m_idle[ch] = (uint8_t)(g_usb_setup.wValue >> 8);
+            usb_set_control_stage(STATUS_IN_STAGE);
+            usb_arm_in_status();
+            return true;
+        case HID_STREAM_GET_IDLE:
+            if(g_usb_setup.wLength == 0) return false;
+            
+            usb_set_ram_ptr(&m_idle[ch]);
+            usb_setup_in_control_transfer(RAM, 1, g_usb_setup.wLength);
+            usb_start_in_control_transfer();
+            return true;
+        default:
+            return false; // GET_REPORT/SET_REPORT, reports only move on the interrupt Endpoints.
+    }
+}
+
+bool hid_stream_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+{
+    // Stupid compiler cuts off address at 8 bits!
+    uint32_t address;
+    
+    switch(g_usb_get_descriptor.DescriptorType)
+    {
+        case HID_STREAM_DESC:
+            address = (uint32_t)&m_hid_descriptor;
+            *descriptor = (const uint8_t*)address;
+            *size = sizeof(hid_stream_descriptor_t);
+            return true;
+        case HID_STREAM_REPORT_DESC:
+            address = (uint32_t)g_hid_stream_report_descriptor;
+            *descriptor = (const uint8_t*)address;
+            *size = HID_STREAM_REPORT_DESC_SIZE;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void hid_stream_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+{
+    if(ep == 0 || ep > HID_STREAM_NUM_CH) return;
+    
+    g_usb_ep_stat[ep][dir].Halt = 0;
+    if(dir == OUT) reset_out(ep - 1);
+    else reset_in(ep - 1);
+}
+
+void hid_stream_clear_ep_toggle(uint8_t ch)
+{
+    reset_out(ch);
+    reset_in(ch);
+}
+
+uint8_t* hid_stream_peek_out(uint8_t ch, uint8_t* p_cnt)
+{
+    bd_t* p_bd = &g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), OUT, m_out_ppb[ch])];
+    
+    if(p_bd->STAT & _UOWN) return NULL;
+    *p_cnt = p_bd->CNT;
+    return USB_RAM_PTR(p_bd->ADR);
+}
+
+void hid_stream_release_out(uint8_t ch)
+{
+    if(g_usb_ep_stat[CH_EP(ch)][OUT].Halt) return;
+    arm(ch, OUT, m_out_ppb[ch]);
+    m_out_ppb[ch] = PPB_NEXT(m_out_ppb[ch]);
+}
+
+uint8_t* hid_stream_acquire_in(uint8_t ch)
+{
+    if(g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), IN, m_in_ppb[ch])].STAT & _UOWN) return NULL;
+    return m_ep_buffers[ch][IN][m_in_ppb[ch]];
+}
+
+void hid_stream_commit_in(uint8_t ch)
+{
+    if(g_usb_ep_stat[CH_EP(ch)][IN].Halt) return;
+    arm(ch, IN, m_in_ppb[ch]);
+    m_in_ppb[ch] = PPB_NEXT(m_in_ppb[ch]);
+}
+
+bool hid_stream_in_idle(uint8_t ch)
+{
+    for(uint8_t ppb = 0; ppb < HID_STREAM_NUM_BUFFERS; ppb++)
+    {
+        if(g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), IN, ppb)].STAT & _UOWN) return false;
+    }
+    return true;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static void arm(uint8_t ch, uint8_t dir, uint8_t ppb)
+{
+    usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), dir, ppb)], &g_usb_ep_stat[CH_EP(ch)][dir], HID_STREAM_EP_SIZE);
+    USB_NEXT_TOGGLE(g_usb_ep_stat[CH_EP(ch)][dir].Data_Toggle_Val);
+}
+
+static void reset_out(uint8_t ch)
+{
+    for(uint8_t ppb = 0; ppb < HID_STREAM_NUM_BUFFERS; ppb++) g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), OUT, ppb)].STAT = 0;
+    g_usb_ep_stat[CH_EP(ch)][OUT].Data_Toggle_Val = 0;
+    
+    // Only completed transactions move the SIE on, it uses the buffer after the last one.
+    m_out_ppb[ch] = PPB_NEXT(g_usb_ep_stat[CH_EP(ch)][OUT].Last_PPB);
+    for(uint8_t i = 0; i < HID_STREAM_NUM_BUFFERS; i++)
+    {
+        arm(ch, OUT, m_out_ppb[ch]);
+        m_out_ppb[ch] = PPB_NEXT(m_out_ppb[ch]);
+    }
+}
+
+static void reset_in(uint8_t ch)
+{
+    for(uint8_t ppb = 0; ppb < HID_STREAM_NUM_BUFFERS; ppb++) g_usb_bd_table[EP_BD_INDEX(CH_EP(ch), IN, ppb)].STAT = 0;
+    g_usb_ep_stat[CH_EP(ch)][IN].Data_Toggle_Val = 0;
+    m_in_ppb[ch] = PPB_NEXT(g_usb_ep_stat[CH_EP(ch)][IN].Last_PPB);
+}
+
+/* ************************************************************************** */
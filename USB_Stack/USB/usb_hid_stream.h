@@ -0,0 +1,334 @@
+/**
+ * @file usb_hid_stream.h
+ * @brief <i>HID Class</i> multi-endpoint streaming settings, global variable and function declarations.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - HID Stream Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_HID_STREAM_H
+#define USB_HID_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_hal.h"
+#include "usb.h"
+#include "usb_ch9.h"
+#include "usb_hid_stream_config.h"
+
+/*
+ * Driverless bulk-like transfer over HID, one raw 64 byte report per direction 
+ * per frame on every channel. Each channel is its own HID interface with an 
+ * interrupt IN and OUT Endpoint, so the host opens them as separate HID devices 
+ * and can keep all of them busy at once (see Tools/HID_Stripe). The reports 
+ * have no Report ID, the Application works straight in USB RAM like the Vendor 
+ * library:
+ * 
+ * OUT: hid_stream_peek_out() gives the oldest received report of a channel, 
+ *      hid_stream_release_out() arms its buffer again.
+ * IN:  hid_stream_acquire_in() gives the next free IN buffer of a channel, 
+ *      hid_stream_commit_in() sends it. IN reports are always HID_STREAM_EP_SIZE.
+ * 
+ * Every call only looks at the BDs' UOWN bits, so they can be used from the 
+ * main loop while usb_tasks() runs in the interrupt.
+ */
+
+/* ************************************************************************** */
+/* ************************* WARNING FOR CHANNELS *************************** */
+/* ************************************************************************** */
+
+#if HID_STREAM_NUM_CH < 1 || HID_STREAM_NUM_CH > 7
+#error "HID Stream uses EP1 to EP7, HID_STREAM_NUM_CH must be 1 to 7."
+#endif
+
+#if (HID_STREAM_NUM_CH + 1) > NUM_ENDPOINTS
+#error "HID Stream channel c uses EP(c + 1), NUM_ENDPOINTS must be at least HID_STREAM_NUM_CH + 1."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *********************** HID STREAM EP BUFFERS **************************** */
+/* ************************************************************************** */
+
+#if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
+#define HID_STREAM_NUM_BUFFERS 1
+#else
+#define HID_STREAM_NUM_BUFFERS 2
+#endif
+
+// PIC16 EP0 buffers are at the top of USB RAM, the EP buffers start in bank 1 (or after the BDT).
+// PIC18 EP buffers come from the allocator in usb_hal.h, EP2_SIZE to EP7_SIZE are set to EP1_SIZE.
+#ifdef _PIC14E
+#if BDT_SIZE <= 0x50
+#define HID_STREAM_EP_BUFFERS_BASE_ADDR 0x2050
+#else
+#define HID_STREAM_EP_BUFFERS_BASE_ADDR (BDT_BASE_ADDR + BDT_SIZE)
+#endif
+#else
+#define HID_STREAM_EP_BUFFERS_BASE_ADDR EP_OUT_EVEN_BUFFER_ADDR(EP1)
+#endif
+
+#define HID_STREAM_EP_BUFFERS_SIZE (HID_STREAM_NUM_CH * 2 * HID_STREAM_NUM_BUFFERS * HID_STREAM_EP_SIZE)
+
+#if defined(_PIC14E) && ((HID_STREAM_EP_BUFFERS_BASE_ADDR + HID_STREAM_EP_BUFFERS_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "HID Stream's EP buffers overlap the EP0 buffers, reduce HID_STREAM_NUM_CH, EP1_SIZE or EP0_SIZE."
+#elif !defined(_PIC14E) && ((HID_STREAM_EP_BUFFERS_BASE_ADDR + HID_STREAM_EP_BUFFERS_SIZE) != EP_BUFFERS_END_ADDR)
+#error "HID Stream's EP buffers don't match the allocator, set EP2_SIZE to EP(HID_STREAM_NUM_CH)_SIZE to EP1_SIZE in usb_config.h."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** HID DEFINES ******************************* */
+/* ************************************************************************** */
+
+// HID Class Requests
+#define HID_STREAM_GET_REPORT 0x01
+#define HID_STREAM_GET_IDLE   0x02
+#define HID_STREAM_SET_IDLE   0x0A
+
+#define HID_STREAM_DESC        0x21
+#define HID_STREAM_REPORT_DESC 0x22
+
+// Bytes in g_hid_stream_report_descriptor, every channel shares it.
+#define HID_STREAM_REPORT_DESC_SIZE 29
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************************* TYPES ********************************** */
+/* ************************************************************************** */
+
+/// HID Descriptor, the same layout as hid_descriptor_t in usb_hid.h.
+typedef struct
+{
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint16_t bcdHID;
+    uint8_t  bCountryCode;
+    uint8_t  bNumDescriptors;
+    uint8_t  bClassDescriptorType;
+    uint16_t wDescriptorLength;
+}hid_stream_descriptor_t;
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************** HID STREAM FUNCTION DESCRIPTORS ********************* */
+/* ************************************************************************** */
+
+/// HID Stream channel, one HID interface with an interrupt IN and OUT Endpoint.
+typedef struct
+{
+    ch9_standard_interface_descriptor_t interface;
+    hid_stream_descriptor_t             hid;
+    ch9_standard_endpoint_descriptor_t  ep_in;
+    ch9_standard_endpoint_descriptor_t  ep_out;
+}hid_stream_function_descriptors_t;
+
+/*
+ * Initializer for hid_stream_function_descriptors_t, see the DESCRIPTOR BUILDER 
+ * in usb_ch9.h. Channel ch uses interface HID_STREAM_FIRST_INT + ch and EP(ch + 1).
+ */
+#define HID_STREAM_FUNCTION_DESCRIPTORS(ch) \
+{ \
+    CH9_INTERFACE_DESCRIPTOR(HID_STREAM_FIRST_INT + (ch), 0, 2, HID, 0, 0), \
+    {9, HID_STREAM_DESC, 0x0111, 0x00, 1, HID_STREAM_REPORT_DESC, HID_STREAM_REPORT_DESC_SIZE}, \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(EP1 + (ch)), EP_INTERRUPT, HID_STREAM_EP_SIZE, HID_STREAM_INTERVAL), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_OUT_ADDR(EP1 + (ch)), EP_INTERRUPT, HID_STREAM_EP_SIZE, HID_STREAM_INTERVAL) \
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************** VARS FROM: usb_hid_stream.c *********************** */
+/* ************************************************************************** */
+
+extern const uint8_t g_hid_stream_report_descriptor[HID_STREAM_REPORT_DESC_SIZE];
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** HID STREAM FUNCTIONS ************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void hid_stream_init(void)
+ * 
+ * @brief Used to initialize the EPs used by the HID Stream library.
+ * 
+ * EP settings are configured, the Buffer Descriptor Table values are setup, and 
+ * every OUT buffer is armed.
+ */
+void hid_stream_init(void);
+
+/**
+ * @fn void hid_stream_tasks(void)
+ * 
+ * @brief Services a completed transaction on a HID Stream Endpoint.
+ */
+void hid_stream_tasks(void);
+
+/**
+ * @fn void hid_stream_out_tasks(void)
+ * 
+ * @brief Services a completed transaction on a HID Stream OUT Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void hid_stream_out_tasks(void);
+
+/**
+ * @fn void hid_stream_in_tasks(void)
+ * 
+ * @brief Services a completed transaction on a HID Stream IN Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void hid_stream_in_tasks(void);
+
+/**
+ * @fn bool hid_stream_class_request(void)
+ * 
+ * @brief Services HID Class Requests to a HID Stream interface.
+ * 
+ * SET_IDLE is accepted and GET_IDLE returns 0, reports are only sent when the 
+ * Application commits them. Everything else is stalled.
+ * 
+ * @return Returns success (true) or failure (false) to execute the Request.
+ */
+bool hid_stream_class_request(void);
+
+/**
+ * @fn bool hid_stream_get_class_descriptor(const uint8_t** descriptor, uint16_t* size)
+ * 
+ * @brief Gives the HID or Report Descriptor of a HID Stream interface.
+ * 
+ * @param[out] descriptor Pointer to the descriptor.
+ * @param[out] size Size of the descriptor.
+ * 
+ * @return Returns success (true) or failure (false) to find the descriptor.
+ */
+bool hid_stream_get_class_descriptor(const uint8_t** descriptor, uint16_t* size);
+
+/**
+ * @fn void hid_stream_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+ * 
+ * @brief Clears a halt on a HID Stream Endpoint.
+ * 
+ * Received reports not yet released are dropped, the OUT buffers are armed 
+ * again from DATA0 and IN starts again from DATA0.
+ * 
+ * @param[in] bdt_index Buffer Descriptor Index.
+ * @param[in] ep Endpoint number.
+ * @param[in] dir Endpoint direction.
+ */
+void hid_stream_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir);
+
+/**
+ * @fn void hid_stream_clear_ep_toggle(uint8_t ch)
+ * 
+ * @brief Restarts both directions of a channel from DATA0, used on SET_INTERFACE.
+ * 
+ * @param[in] ch Channel number.
+ */
+void hid_stream_clear_ep_toggle(uint8_t ch);
+
+/**
+ * @fn uint8_t* hid_stream_peek_out(uint8_t ch, uint8_t* p_cnt)
+ * 
+ * @brief Gets the oldest received OUT report of a channel.
+ * 
+ * @param[in] ch Channel number.
+ * @param[out] p_cnt Amount of bytes received.
+ * 
+ * @return Returns a pointer to the report in USB RAM, or NULL if nothing has 
+ * been received.
+ */
+uint8_t* hid_stream_peek_out(uint8_t ch, uint8_t* p_cnt);
+
+/**
+ * @fn void hid_stream_release_out(uint8_t ch)
+ * 
+ * @brief Arms the buffer from hid_stream_peek_out() to receive again.
+ * 
+ * @param[in] ch Channel number.
+ */
+void hid_stream_release_out(uint8_t ch);
+
+/**
+ * @fn uint8_t* hid_stream_acquire_in(uint8_t ch)
+ * 
+ * @brief Gets the next IN buffer of a channel to write a report into.
+ * 
+ * @param[in] ch Channel number.
+ * 
+ * @return Returns a pointer to HID_STREAM_EP_SIZE bytes of USB RAM, or NULL if 
+ * every IN buffer of the channel is still armed.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t* p_data;
+ * for(uint8_t ch = 0; ch < HID_STREAM_NUM_CH; ch++)
+ * {
+ *     if((p_data = hid_stream_acquire_in(ch)) == NULL) continue;
+ *     adc_read_block(p_data, HID_STREAM_EP_SIZE);
+ *     hid_stream_commit_in(ch);
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* hid_stream_acquire_in(uint8_t ch);
+
+/**
+ * @fn void hid_stream_commit_in(uint8_t ch)
+ * 
+ * @brief Arms the buffer from hid_stream_acquire_in() to send a report.
+ * 
+ * @param[in] ch Channel number.
+ */
+void hid_stream_commit_in(uint8_t ch);
+
+/**
+ * @fn bool hid_stream_in_idle(uint8_t ch)
+ * 
+ * @brief Lets the Application know every IN report of a channel has been sent.
+ * 
+ * @param[in] ch Channel number.
+ * 
+ * @return Returns true if no IN buffer of the channel is armed.
+ */
+bool hid_stream_in_idle(uint8_t ch);
+
+/* ************************************************************************** */
+
+#endif /* USB_HID_STREAM_H */
@@ -27,6 +27,7 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "usb.h"
 #include "usb_msd.h"
@@ -45,11 +46,80 @@
 /******************************************************************************/
 
 
+/******************************************************************************/
+/*************************** ASYNC MEDIA DEFINES ******************************/
+/******************************************************************************/
+
+// What msd_tasks() carries on with once msd_media_complete() is called.
+#define RESUME_NONE       0
+#define RESUME_READ_DATA  1 ///< Start sending the first sector of a READ_10.
+#define RESUME_WRITE_DATA 2 ///< Arm OUT for more WRITE_10 data, or send the CSW.
+
+/******************************************************************************/
+
+
+/******************************************************************************/
+/****************************** SCSI COMMAND TABLE ****************************/
+/******************************************************************************/
+
+/** 
+ * One SCSI command service_cbw() can decode. The table is built from the USE_* 
+ * options, so commands that aren't used take no ROM. 
+ */
+typedef struct
+{
+    uint8_t opcode;
+    uint8_t dev_expect; ///< Dn or Di, finishes the command once the handler returns true. Di, Do for READ/WRITE.
+    uint8_t max_len;    ///< Di only, size of the response, the allocation length is cut to it.
+    bool    need_media; ///< Fail with MEDIUM NOT PRESENT before the handler is called (USE_EXTERNAL_MEDIA).
+    bool    (*handler)(void); ///< Returns false if it finished the command itself. NULL for nothing to do.
+}scsi_cmd_t;
+
+#if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+#define CMD_IN_BUFF m_in_ep_addr ///< IN buffer for the data response of a command.
+#else
+#define CMD_IN_BUFF g_msd_ep_in
+#endif
+
+/******************************************************************************/
+
+
+/******************************************************************************/
+/***************************** MEDIA CALLBACKS ********************************/
+/******************************************************************************/
+
+#if MSD_NUM_LUNS > 1
+#define LUN_MEDIA_PRESENT()                 g_msd_luns[g_msd_lun].media_present()
+#define LUN_TEST_UNIT_READY()               g_msd_luns[g_msd_lun].test_unit_ready()
+#define LUN_START_STOP_UNIT()               g_msd_luns[g_msd_lun].start_stop_unit()
+#define LUN_READ_CAPACITY()                 g_msd_luns[g_msd_lun].read_capacity()
+#define LUN_RX_SECTOR()                     g_msd_luns[g_msd_lun].rx_sector()
+#define LUN_RX_SECTOR_ASYNC(lba, p)         g_msd_luns[g_msd_lun].rx_sector_async(lba, p)
+#define LUN_TX_SECTOR()                     g_msd_luns[g_msd_lun].tx_sector()
+#define LUN_COMMIT_SECTOR(lun, lba, p)      g_msd_luns[lun].commit_sector(lba, p) // The cache can hold another LUN's sector.
+#define LUN_WR_PROTECT()                    g_msd_luns[g_msd_lun].wr_protect()
+#else
+#define LUN_MEDIA_PRESENT()                 msd_media_present()
+#define LUN_TEST_UNIT_READY()               msd_test_unit_ready()
+#define LUN_START_STOP_UNIT()               msd_start_stop_unit()
+#define LUN_READ_CAPACITY()                 msd_read_capacity()
+#define LUN_RX_SECTOR()                     msd_rx_sector()
+#define LUN_RX_SECTOR_ASYNC(lba, p)         msd_rx_sector_async(lba, p)
+#define LUN_TX_SECTOR()                     msd_tx_sector()
+#define LUN_COMMIT_SECTOR(lun, lba, p)      msd_commit_sector(lba, p)
+#define LUN_WR_PROTECT()                    msd_wr_protect()
+#endif
+
+/******************************************************************************/
+
+
 /******************************************************************************/
 /****************************** MSD ENDPOINTS *********************************/
 /******************************************************************************/
 
-#if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
+#if defined(USB_SIM)
+// Placed by usb_msd.h.
+#elif PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
 uint8_t g_msd_ep_out[MSD_EP_SIZE] __at(MSD_EP_OUT_BUFFER_BASE_ADDR);
 uint8_t g_msd_ep_in[MSD_EP_SIZE]  __at(MSD_EP_IN_BUFFER_BASE_ADDR);
 #else // PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
@@ -66,10 +136,20 @@ uint8_t g_msd_ep_in_odd[MSD_EP_SIZE]   __at(MSD_EP_IN_ODD_BUFFER_BASE_ADDR);
 /****************************** SECTOR VARS ***********************************/
 /******************************************************************************/
 
-uint16_t g_msd_byte_of_sect;
+USB_ACCESS uint16_t g_msd_byte_of_sect;
+#if defined(MSD_ARENA)
+USB_ARENA_ASSERT(msd, sizeof(g_usb_arena.msd) >= MSD_ARENA_BYTES); // The msd state of USB_ARENA_STATES is too small.
+#else
 #ifndef MSD_LIMITED_RAM
 uint8_t g_msd_sect_data[512];
 #endif
+#ifdef MSD_READ_PREFETCH
+uint8_t g_msd_prefetch_data[512];
+#endif
+#ifdef MSD_WRITE_CACHE
+uint8_t g_msd_cache_data[512];
+#endif
+#endif
 
 /******************************************************************************/
 
@@ -78,18 +158,27 @@ uint8_t g_msd_sect_data[512];
 /******************************* MSD GLOBAL VARS ******************************/
 /******************************************************************************/
 
+#ifndef USB_SIM // Placed by usb_msd.h.
 msd_cbw_t                 g_msd_cbw __at(CBW_DATA_ADDR);
 msd_csw_t                 g_msd_csw __at(CBW_DATA_ADDR);
-msd_rw_10_vars_t          g_msd_rw_10_vars;
+#endif
+USB_ACCESS msd_rw_10_vars_t g_msd_rw_10_vars;
 msd_bytes_to_transfer_t   g_msd_bytes_to_transfer;
 uint8_t                   g_msd_sense_key;
 uint8_t                   g_msd_additional_sense_code;
 uint8_t                   g_msd_additional_sense_code_qualifier;
+volatile uint8_t          g_msd_task_overflows;
+#if MSD_NUM_LUNS > 1
+uint8_t                   g_msd_lun;
+#endif
 
 
 #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
 scsi_read_capacity_10_t g_msd_read_capacity_10;
 scsi_mode_sense_t       g_msd_mode_sense;
+#elif defined(USB_SIM)
+#define g_msd_read_capacity_10  USB_SIM_AT(scsi_read_capacity_10_t, MSD_EP_IN_BUFFER_BASE_ADDR)
+#define g_msd_mode_sense        USB_SIM_AT(scsi_mode_sense_t, MSD_EP_IN_BUFFER_BASE_ADDR)
 #else
 scsi_read_capacity_10_t g_msd_read_capacity_10 __at(MSD_EP_IN_BUFFER_BASE_ADDR);
 scsi_mode_sense_t       g_msd_mode_sense       __at(MSD_EP_IN_BUFFER_BASE_ADDR);
@@ -102,14 +191,41 @@ scsi_mode_sense_t       g_msd_mode_sense       __at(MSD_EP_IN_BUFFER_BASE_ADDR);
 /******************************* LOCAL VARS ***********************************/
 /******************************************************************************/
 
+#if defined(USB_SIM)
+#define m_request_sense_cmd    USB_SIM_AT(scsi_request_sense_cmd_t, CBW_DATA_ADDR + 15)
+#define m_inquiry_cmd          USB_SIM_AT(scsi_inquiry_cmd_t, CBW_DATA_ADDR + 15)
+#define m_mode_sense_6_cmd     USB_SIM_AT(scsi_mode_sense_6_cmd_t, CBW_DATA_ADDR + 15)
+#define m_read_capacity_10_cmd USB_SIM_AT(scsi_read_capacity_10_cmd_t, CBW_DATA_ADDR + 15)
+#define m_read_10_cmd          USB_SIM_AT(scsi_read_10_cmd_t, CBW_DATA_ADDR + 15)
+#define m_write_10_cmd         USB_SIM_AT(scsi_write_10_cmd_t, CBW_DATA_ADDR + 15)
+#define m_read_12_cmd          USB_SIM_AT(scsi_read_12_cmd_t, CBW_DATA_ADDR + 15)
+#define m_read_16_cmd          USB_SIM_AT(scsi_read_16_cmd_t, CBW_DATA_ADDR + 15)
+#define m_read_capacity_16_cmd USB_SIM_AT(scsi_read_capacity_16_cmd_t, CBW_DATA_ADDR + 15)
+#define m_mode_select_6_cmd    USB_SIM_AT(scsi_mode_select_6_cmd_t, CBW_DATA_ADDR + 15)
+#define m_pamr_cmd             USB_SIM_AT(scsi_pamr_cmd_t, CBW_DATA_ADDR + 15)
+#else
 static scsi_request_sense_cmd_t    m_request_sense_cmd    __at(CBW_DATA_ADDR + 15);
 static scsi_inquiry_cmd_t          m_inquiry_cmd          __at(CBW_DATA_ADDR + 15);
 static scsi_mode_sense_6_cmd_t     m_mode_sense_6_cmd     __at(CBW_DATA_ADDR + 15);
 static scsi_read_capacity_10_cmd_t m_read_capacity_10_cmd __at(CBW_DATA_ADDR + 15);
 static scsi_read_10_cmd_t          m_read_10_cmd          __at(CBW_DATA_ADDR + 15);
 static scsi_write_10_cmd_t         m_write_10_cmd         __at(CBW_DATA_ADDR + 15);
+#ifdef USE_RW_12_16
+static scsi_read_12_cmd_t          m_read_12_cmd          __at(CBW_DATA_ADDR + 15);
+static scsi_read_16_cmd_t          m_read_16_cmd          __at(CBW_DATA_ADDR + 15);
+static scsi_read_capacity_16_cmd_t m_read_capacity_16_cmd __at(CBW_DATA_ADDR + 15);
+#endif
 static scsi_mode_select_6_cmd_t    m_mode_select_6_cmd    __at(CBW_DATA_ADDR + 15);
 static scsi_pamr_cmd_t             m_pamr_cmd             __at(CBW_DATA_ADDR + 15);
+#endif
+
+static const scsi_cmd_t *m_cmd; // Command being serviced.
+#ifdef MSD_MOUNT_STATS
+static msd_mount_stats_t m_mount_stats;
+#endif
+#if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+static uint8_t *m_in_ep_addr;
+#endif
 
 volatile static uint8_t m_msd_state;
 volatile static bool    m_end_data_short;
@@ -118,17 +234,144 @@ volatile static bool    m_clear_halt_event;
 
 volatile static bool    m_media_present;
 volatile static bool    m_unit_attention;
+static bool             m_media_prev; // Last msd_media_present() result, for check_for_media().
+
+#if MSD_NUM_LUNS > 1
+/** State of the LUNs not being serviced, swapped in by select_lun(). */
+static struct
+{
+    uint8_t sense_key;
+    uint8_t additional_sense_code;
+    uint8_t additional_sense_code_qualifier;
+    bool    media_present;
+    bool    unit_attention;
+    bool    media_prev;
+}m_lun_state[MSD_NUM_LUNS];
+
+static const uint8_t m_max_lun = MSD_NUM_LUNS - 1;
+#else
+static const uint8_t m_max_lun = 0;
+#endif
 
-volatile static uint8_t m_task_cnt;
-volatile static uint8_t m_task_put_index;
-volatile static uint8_t m_task_get_index;
+// Free running indexes, the ring holds m_task_head - m_task_tail tasks.
+volatile static uint8_t m_task_head; // Only written by msd_add_task().
+volatile static uint8_t m_task_tail; // Only written by msd_tasks() (and BOMSR/msd_init() with it idle).
 
 volatile static union
 {
-    uint8_t     task[8];
-    usb_ustat_t task_stat[8];
+    uint8_t     task[MSD_TASK_QUEUE_SIZE];
+    usb_ustat_t task_stat[MSD_TASK_QUEUE_SIZE];
 }m_tasks_buff;
 
+#ifdef MSD_READ_PREFETCH
+static uint8_t *m_drain_sect; // Sector being sent to the host.
+static uint8_t *m_fill_sect;  // Sector being fetched by msd_rx_sector_async().
+volatile static bool m_prefetch_busy;
+volatile static bool m_sect_swap_pending;
+static uint32_t m_ahead_lba;   // Sector after the last READ_10, read ahead into m_fill_sect for the next one.
+static bool     m_ahead_valid;
+#if MSD_NUM_LUNS > 1
+static uint8_t  m_ahead_lun;
+#endif
+#endif
+
+#ifdef MSD_ASYNC_MEDIA
+volatile static bool m_media_busy; // A sector callback returned MSD_MEDIA_PENDING, msd_media_complete() not called yet.
+static uint8_t       m_media_resume;
+#endif
+
+#ifdef MSD_DIRECT_WRITE
+static bool m_direct_write; // OUT BD is pointed into g_msd_sect_data for this WRITE_10.
+#endif
+
+#ifdef MSD_WRITE_CACHE
+static uint8_t  *const m_cache_slot[2] = {g_msd_sect_data, g_msd_cache_data};
+static uint32_t m_cache_lba[2];
+static bool     m_cache_dirty[2];
+#if MSD_NUM_LUNS > 1
+static uint8_t  m_cache_lun[2];
+#endif
+static uint8_t  m_cache_fill; // Slot WRITE_10 is receiving into.
+#endif
+
+#ifdef MSD_IMAGE_CRC
+// Running CRC-32s, complemented when they're sent by scsi_image_crc().
+static uint32_t m_write_crc;
+static uint32_t m_write_sectors;
+static uint32_t m_verify_crc;
+static uint32_t m_verify_sectors;
+
+// Reflected 0xEDB88320 (zlib's crc32()), a byte at a time so the CRC keeps up 
+// with full speed bulk packets.
+static const uint32_t m_crc32_table[256] =
+{
+    0x00000000UL, 0x77073096UL, 0xEE0E612CUL, 0x990951BAUL,
+    0x076DC419UL, 0x706AF48FUL, 0xE963A535UL, 0x9E6495A3UL,
+    0x0EDB8832UL, 0x79DCB8A4UL, 0xE0D5E91EUL, 0x97D2D988UL,
+    0x09B64C2BUL, 0x7EB17CBDUL, 0xE7B82D07UL, 0x90BF1D91UL,
+    0x1DB71064UL, 0x6AB020F2UL, 0xF3B97148UL, 0x84BE41DEUL,
+    0x1ADAD47DUL, 0x6DDDE4EBUL, 0xF4D4B551UL, 0x83D385C7UL,
+    0x136C9856UL, 0x646BA8C0UL, 0xFD62F97AUL, 0x8A65C9ECUL,
+    0x14015C4FUL, 0x63066CD9UL, 0xFA0F3D63UL, 0x8D080DF5UL,
+    0x3B6E20C8UL, 0x4C69105EUL, 0xD56041E4UL, 0xA2677172UL,
+    0x3C03E4D1UL, 0x4B04D447UL, 0xD20D85FDUL, 0xA50AB56BUL,
+    0x35B5A8FAUL, 0x42B2986CUL, 0xDBBBC9D6UL, 0xACBCF940UL,
+    0x32D86CE3UL, 0x45DF5C75UL, 0xDCD60DCFUL, 0xABD13D59UL,
+    0x26D930ACUL, 0x51DE003AUL, 0xC8D75180UL, 0xBFD06116UL,
+    0x21B4F4B5UL, 0x56B3C423UL, 0xCFBA9599UL, 0xB8BDA50FUL,
+    0x2802B89EUL, 0x5F058808UL, 0xC60CD9B2UL, 0xB10BE924UL,
+    0x2F6F7C87UL, 0x58684C11UL, 0xC1611DABUL, 0xB6662D3DUL,
+    0x76DC4190UL, 0x01DB7106UL, 0x98D220BCUL, 0xEFD5102AUL,
+    0x71B18589UL, 0x06B6B51FUL, 0x9FBFE4A5UL, 0xE8B8D433UL,
+    0x7807C9A2UL, 0x0F00F934UL, 0x9609A88EUL, 0xE10E9818UL,
+    0x7F6A0DBBUL, 0x086D3D2DUL, 0x91646C97UL, 0xE6635C01UL,
+    0x6B6B51F4UL, 0x1C6C6162UL, 0x856530D8UL, 0xF262004EUL,
+    0x6C0695EDUL, 0x1B01A57BUL, 0x8208F4C1UL, 0xF50FC457UL,
+    0x65B0D9C6UL, 0x12B7E950UL, 0x8BBEB8EAUL, 0xFCB9887CUL,
+    0x62DD1DDFUL, 0x15DA2D49UL, 0x8CD37CF3UL, 0xFBD44C65UL,
+    0x4DB26158UL, 0x3AB551CEUL, 0xA3BC0074UL, 0xD4BB30E2UL,
+    0x4ADFA541UL, 0x3DD895D7UL, 0xA4D1C46DUL, 0xD3D6F4FBUL,
+    0x4369E96AUL, 0x346ED9FCUL, 0xAD678846UL, 0xDA60B8D0UL,
+    0x44042D73UL, 0x33031DE5UL, 0xAA0A4C5FUL, 0xDD0D7CC9UL,
+    0x5005713CUL, 0x270241AAUL, 0xBE0B1010UL, 0xC90C2086UL,
+    0x5768B525UL, 0x206F85B3UL, 0xB966D409UL, 0xCE61E49FUL,
+    0x5EDEF90EUL, 0x29D9C998UL, 0xB0D09822UL, 0xC7D7A8B4UL,
+    0x59B33D17UL, 0x2EB40D81UL, 0xB7BD5C3BUL, 0xC0BA6CADUL,
+    0xEDB88320UL, 0x9ABFB3B6UL, 0x03B6E20CUL, 0x74B1D29AUL,
+    0xEAD54739UL, 0x9DD277AFUL, 0x04DB2615UL, 0x73DC1683UL,
+    0xE3630B12UL, 0x94643B84UL, 0x0D6D6A3EUL, 0x7A6A5AA8UL,
+    0xE40ECF0BUL, 0x9309FF9DUL, 0x0A00AE27UL, 0x7D079EB1UL,
+    0xF00F9344UL, 0x8708A3D2UL, 0x1E01F268UL, 0x6906C2FEUL,
+    0xF762575DUL, 0x806567CBUL, 0x196C3671UL, 0x6E6B06E7UL,
+    0xFED41B76UL, 0x89D32BE0UL, 0x10DA7A5AUL, 0x67DD4ACCUL,
+    0xF9B9DF6FUL, 0x8EBEEFF9UL, 0x17B7BE43UL, 0x60B08ED5UL,
+    0xD6D6A3E8UL, 0xA1D1937EUL, 0x38D8C2C4UL, 0x4FDFF252UL,
+    0xD1BB67F1UL, 0xA6BC5767UL, 0x3FB506DDUL, 0x48B2364BUL,
+    0xD80D2BDAUL, 0xAF0A1B4CUL, 0x36034AF6UL, 0x41047A60UL,
+    0xDF60EFC3UL, 0xA867DF55UL, 0x316E8EEFUL, 0x4669BE79UL,
+    0xCB61B38CUL, 0xBC66831AUL, 0x256FD2A0UL, 0x5268E236UL,
+    0xCC0C7795UL, 0xBB0B4703UL, 0x220216B9UL, 0x5505262FUL,
+    0xC5BA3BBEUL, 0xB2BD0B28UL, 0x2BB45A92UL, 0x5CB36A04UL,
+    0xC2D7FFA7UL, 0xB5D0CF31UL, 0x2CD99E8BUL, 0x5BDEAE1DUL,
+    0x9B64C2B0UL, 0xEC63F226UL, 0x756AA39CUL, 0x026D930AUL,
+    0x9C0906A9UL, 0xEB0E363FUL, 0x72076785UL, 0x05005713UL,
+    0x95BF4A82UL, 0xE2B87A14UL, 0x7BB12BAEUL, 0x0CB61B38UL,
+    0x92D28E9BUL, 0xE5D5BE0DUL, 0x7CDCEFB7UL, 0x0BDBDF21UL,
+    0x86D3D2D4UL, 0xF1D4E242UL, 0x68DDB3F8UL, 0x1FDA836EUL,
+    0x81BE16CDUL, 0xF6B9265BUL, 0x6FB077E1UL, 0x18B74777UL,
+    0x88085AE6UL, 0xFF0F6A70UL, 0x66063BCAUL, 0x11010B5CUL,
+    0x8F659EFFUL, 0xF862AE69UL, 0x616BFFD3UL, 0x166CCF45UL,
+    0xA00AE278UL, 0xD70DD2EEUL, 0x4E048354UL, 0x3903B3C2UL,
+    0xA7672661UL, 0xD06016F7UL, 0x4969474DUL, 0x3E6E77DBUL,
+    0xAED16A4AUL, 0xD9D65ADCUL, 0x40DF0B66UL, 0x37D83BF0UL,
+    0xA9BCAE53UL, 0xDEBB9EC5UL, 0x47B2CF7FUL, 0x30B5FFE9UL,
+    0xBDBDF21CUL, 0xCABAC28AUL, 0x53B39330UL, 0x24B4A3A6UL,
+    0xBAD03605UL, 0xCDD70693UL, 0x54DE5729UL, 0x23D967BFUL,
+    0xB3667A2EUL, 0xC4614AB8UL, 0x5D681B02UL, 0x2A6F2B94UL,
+    0xB40BBE37UL, 0xC30C8EA1UL, 0x5A05DF1BUL, 0x2D02EF8DUL
+};
+#endif
+
 /******************************************************************************/
 
 
@@ -150,10 +393,184 @@ extern const scsi_inquiry_t g_scsi_inquiry;
  * 
  * @brief Used to service Command Block Wrapper on MSD's Endpoint.
  * 
- * The function parses the Command Block, and responds to SCSI Commands.
+ * The function looks the Command Block's opcode up in m_scsi_cmds, checks for
+ * media, calls the command's handler and then runs the data or status stage 
+ * the entry gives. READ_10 is first, so its lookup is the quickest.
  */
 static void service_cbw(void);
 
+/**
+ * @fn bool scsi_read_write(void)
+ * 
+ * @brief Starts the data stage of a READ or WRITE (10, 12 or 16) Command.
+ * 
+ * @return Always false, the command finishes in service_read10() or 
+ * service_write10().
+ */
+static bool scsi_read_write(void);
+
+/**
+ * @fn bool scsi_write(void)
+ * 
+ * @brief Checks write protection, then services WRITE (10, 12 or 16) with 
+ * scsi_read_write().
+ * 
+ * @return Always false.
+ */
+static bool scsi_write(void);
+
+/**
+ * @fn bool scsi_test_unit_ready(void)
+ * 
+ * @brief Services the TEST_UNIT_READY SCSI Command.
+ * 
+ * @return Returns true if the unit is ready.
+ */
+static bool scsi_test_unit_ready(void);
+
+#ifdef USE_PREVENT_ALLOW_MEDIUM_REMOVAL
+/**
+ * @fn bool scsi_prevent_allow_medium_removal(void)
+ * 
+ * @brief Services the PREVENT_ALLOW_MEDIUM_REMOVAL SCSI Command. Removal can't
+ * be prevented, so it's failed after the write cache is flushed.
+ * 
+ * @return Always false.
+ */
+static bool scsi_prevent_allow_medium_removal(void);
+#endif
+
+/**
+ * @fn bool scsi_request_sense(void)
+ * 
+ * @brief Loads the fixed format sense data for REQUEST_SENSE.
+ * 
+ * @return Always true.
+ */
+static bool scsi_request_sense(void);
+
+/**
+ * @fn bool scsi_inquiry(void)
+ * 
+ * @brief Loads g_scsi_inquiry for INQUIRY.
+ * 
+ * @return Always true.
+ */
+static bool scsi_inquiry(void);
+
+/**
+ * @fn bool scsi_mode_sense_6(void)
+ * 
+ * @brief Loads the mode parameter header for MODE_SENSE_6.
+ * 
+ * @return Always true.
+ */
+static bool scsi_mode_sense_6(void);
+
+/**
+ * @fn bool scsi_mode_sense_10(void)
+ * 
+ * @brief Loads the mode parameter header for MODE_SENSE_10, the same as 
+ * MODE_SENSE_6's in the longer form.
+ */
+static bool scsi_mode_sense_10(void);
+
+/**
+ * @fn bool scsi_read_format_capacities(void)
+ * 
+ * @brief Loads the capacity list for READ_FORMAT_CAPACITIES, one current 
+ * capacity descriptor. Windows asks for it before READ_CAPACITY.
+ */
+static bool scsi_read_format_capacities(void);
+
+#ifdef USE_START_STOP_UNIT
+/**
+ * @fn bool scsi_start_stop_unit(void)
+ * 
+ * @brief Services the START_STOP_UNIT SCSI Command.
+ * 
+ * @return Returns true if msd_start_stop_unit() passed.
+ */
+static bool scsi_start_stop_unit(void);
+#endif
+
+/**
+ * @fn bool scsi_read_capacity(void)
+ * 
+ * @brief Loads the READ_CAPACITY (10) response.
+ * 
+ * @return Returns false if the Command Block was invalid.
+ */
+static bool scsi_read_capacity(void);
+
+#ifdef USE_RW_12_16
+/**
+ * @fn bool scsi_service_action_in_16(void)
+ * 
+ * @brief Loads the READ_CAPACITY_16 response, the only SERVICE_ACTION_IN_16 
+ * supported.
+ * 
+ * @return Returns false if the Command Block was invalid.
+ */
+static bool scsi_service_action_in_16(void);
+#endif
+
+/**
+ * @fn bool scsi_synchronize_cache_10(void)
+ * 
+ * @brief Commits the write cache for SYNCHRONIZE_CACHE_10.
+ * 
+ * @return Always true.
+ */
+static bool scsi_synchronize_cache_10(void);
+
+#ifdef USE_VERIFY_10
+/**
+ * @fn bool scsi_verify_10(void)
+ * 
+ * @brief Services VERIFY_10 on the device, without a data stage.
+ * 
+ * Every sector in the range is read with msd_rx_sector() (and added to the 
+ * verify CRC with MSD_IMAGE_CRC), so checking an image only costs the media's 
+ * read time. BYTCHK, comparing against data sent by the host, isn't supported.
+ * 
+ * @return Returns true when the range was read.
+ */
+static bool scsi_verify_10(void);
+#endif
+
+#ifdef MSD_IMAGE_CRC
+/**
+ * @fn bool scsi_image_crc(void)
+ * 
+ * @brief Services the vendor MSD_IMAGE_CRC_CMD, sends the write and verify 
+ * CRC-32s and sector counts.
+ * 
+ * @return Always true.
+ */
+static bool scsi_image_crc(void);
+
+/**
+ * @fn uint32_t image_crc(uint32_t crc, const uint8_t *p_data, uint16_t len)
+ * 
+ * @brief Adds len bytes at p_data to a running CRC-32.
+ * 
+ * @param crc The running CRC, not complemented.
+ * @param p_data Data to add.
+ * @param len Amount of bytes.
+ * 
+ * @return The new running CRC.
+ */
+static uint32_t image_crc(uint32_t crc, const uint8_t *p_data, uint16_t len);
+
+/**
+ * @fn void reset_image_crc(void)
+ * 
+ * @brief Starts the write and verify CRC-32s over.
+ */
+static void reset_image_crc(void);
+#endif
+
 /**
  * @fn void setup_cbw(void)
  * 
@@ -179,12 +596,84 @@ static void setup_csw(void);
  */
 static void service_read10(void);
 
+#ifdef USE_WRITE_10
 /**
  * @fn void service_write10(void)
  * 
  * @brief Services the WRITE_10 SCSI Command.
  */
 static void service_write10(void);
+#endif
+
+/**
+ * @fn void start_read_data(void)
+ * 
+ * @brief Loads and arms the first READ_10 packets once the first sector is in
+ * g_msd_sect_data.
+ */
+static void start_read_data(void);
+
+#ifdef USE_WRITE_10
+/**
+ * @fn void next_write_data(void)
+ * 
+ * @brief Arms OUT for the next WRITE_10 packet, or ends the data stage once 
+ * all of it has been received.
+ */
+static void next_write_data(void);
+#endif
+
+#ifdef MSD_ASYNC_MEDIA
+/**
+ * @fn bool rx_sector_pending(void)
+ * 
+ * @brief Calls msd_rx_sector(), marking the media busy if it's still going.
+ * 
+ * @return Returns true if msd_rx_sector() returned MSD_MEDIA_PENDING.
+ */
+static bool rx_sector_pending(void);
+
+#ifdef USE_WRITE_10
+/**
+ * @fn bool tx_sector_pending(void)
+ * 
+ * @brief Calls msd_tx_sector(), marking the media busy if it's still going.
+ * 
+ * @return Returns true if msd_tx_sector() returned MSD_MEDIA_PENDING.
+ */
+static bool tx_sector_pending(void);
+#endif
+#endif
+
+/**
+ * @fn bool load_rw_vars(void)
+ * 
+ * @brief Loads g_msd_rw_10_vars from a READ/WRITE (10, 12 or 16) Command.
+ * 
+ * @return Returns false if the LBA doesn't fit in 32-bits, so can't be on the
+ * media.
+ */
+static bool load_rw_vars(void);
+
+/**
+ * @fn uint32_t get_be32(const uint8_t *p_src)
+ * 
+ * @brief Reads a big-endian 32-bit value from a Command Block.
+ * 
+ * @param p_src Address of the most significant byte.
+ * @return The value.
+ */
+static uint32_t get_be32(const uint8_t *p_src);
+
+/**
+ * @fn void put_be32(uint8_t *p_dst, uint32_t val)
+ * 
+ * @brief Writes a 32-bit value big-endian, for SCSI response data.
+ * 
+ * @param p_dst Address for the most significant byte.
+ * @param val The value.
+ */
+static void put_be32(uint8_t *p_dst, uint32_t val);
 
 /**
  * @fn bool check_13_cases(uint32_t device_bytes, uint8_t dev_expect)
@@ -283,6 +772,118 @@ static void unit_attention_sense(void);
  */
 static bool check_for_media(void);
 
+#if MSD_NUM_LUNS > 1
+/**
+ * @fn void select_lun(uint8_t lun)
+ * 
+ * @brief Makes lun the LUN being serviced.
+ * 
+ * The sense values and media state of the previous LUN are saved to 
+ * m_lun_state, and lun's are loaded in their place. Keeps the rest of the 
+ * library working on plain globals, which is cheaper on PIC than indexing.
+ * 
+ * @param lun The CBW's LUN.
+ */
+static void select_lun(uint8_t lun);
+#endif
+
+#ifdef MSD_READ_PREFETCH
+/**
+ * @fn void start_prefetch(void)
+ * 
+ * @brief Starts fetching the sector after g_msd_rw_10_vars.LBA into 
+ * m_fill_sect, if the READ_10 transfer needs it.
+ */
+static void start_prefetch(void);
+
+/**
+ * @fn void swap_sect_buffers(void)
+ * 
+ * @brief Swaps the drain and fill sector buffers once the prefetch has 
+ * finished, and starts fetching the next sector.
+ */
+static void swap_sect_buffers(void);
+
+/**
+ * @fn void start_read_ahead(void)
+ * 
+ * @brief Starts fetching the sector after the end of the READ_10 into 
+ * m_fill_sect, as hosts reading sequentially ask for it next.
+ */
+static void start_read_ahead(void);
+
+/**
+ * @fn bool take_read_ahead(void)
+ * 
+ * @brief Checks if the new READ_10 starts at the sector read ahead, and if so
+ * makes it the drain sector.
+ * 
+ * @return Returns true if the first sector is ready.
+ */
+static bool take_read_ahead(void);
+#endif
+
+#ifdef MSD_WRITE_CACHE
+/**
+ * @fn void commit_cache_slot(uint8_t slot)
+ * 
+ * @brief Writes a cached sector to the media with msd_commit_sector().
+ * 
+ * @param slot The write cache slot to commit.
+ */
+static void commit_cache_slot(uint8_t slot);
+
+/**
+ * @fn void flush_cache(void)
+ * 
+ * @brief Commits all cached sectors, oldest first.
+ */
+static void flush_cache(void);
+#endif
+
+/******************************************************************************/
+
+
+/******************************************************************************/
+/******************************* SCSI COMMANDS ********************************/
+/******************************************************************************/
+
+static const scsi_cmd_t m_scsi_cmds[] =
+{
+    // opcode,                      dev_expect, max_len, need_media, handler
+    {READ_10,                       Di,  0,  true,  scsi_read_write},
+    {WRITE_10,                      Do,  0,  true,  scsi_write},
+    #ifdef USE_RW_12_16
+    {READ_12,                       Di,  0,  true,  scsi_read_write},
+    {WRITE_12,                      Do,  0,  true,  scsi_write},
+    {READ_16,                       Di,  0,  true,  scsi_read_write},
+    {WRITE_16,                      Do,  0,  true,  scsi_write},
+    {SERVICE_ACTION_IN_16,          Di,  32, true,  scsi_service_action_in_16},
+    #endif
+    {TEST_UNIT_READY,               Dn,  0,  false, scsi_test_unit_ready}, // Checks the media itself, Unit Attention first.
+    {REQUEST_SENSE,                 Di,  18, false, scsi_request_sense},
+    {INQUIRY,                       Di,  36, false, scsi_inquiry},
+    {MODE_SENSE_6,                  Di,  4,  true,  scsi_mode_sense_6},
+    {READ_CAPACITY,                 Di,  8,  true,  scsi_read_capacity},
+    {MODE_SENSE_10,                 Di,  8,  true,  scsi_mode_sense_10},
+    {READ_FORMAT_CAPACITIES,        Di,  12, false, scsi_read_format_capacities}, // Reports no media itself.
+    #ifdef USE_PREVENT_ALLOW_MEDIUM_REMOVAL
+    {PREVENT_ALLOW_MEDIUM_REMOVAL,  Dn,  0,  true,  scsi_prevent_allow_medium_removal},
+    #endif
+    #ifdef USE_START_STOP_UNIT
+    {START_STOP_UNIT,               Dn,  0,  true,  scsi_start_stop_unit},
+    #endif
+    #ifdef USE_VERIFY_10
+    {VERIFY_10,                     Dn,  0,  true,  scsi_verify_10},
+    #endif
+    {SYNCHRONIZE_CACHE_10,          Dn,  0,  true,  scsi_synchronize_cache_10},
+    #ifdef MSD_IMAGE_CRC
+    {MSD_IMAGE_CRC_CMD,             Di,  16, false, scsi_image_crc},
+    #endif
+};
+
+#define NUM_SCSI_CMDS (sizeof(m_scsi_cmds) / sizeof(scsi_cmd_t))
+
 /******************************************************************************/
 
 
@@ -342,25 +943,34 @@ bool msd_class_request(void)
 {   
     if(g_usb_setup.bRequest == BOMSR) // Bulk Only Mass Storage Reset
     {
-        if(g_usb_setup.wValue != 0 || g_usb_setup.wIndex != 0 || g_usb_setup.wLength != 0) return false;
+        if(g_usb_setup.wValue != 0 || g_usb_setup.wIndex != MSD_INT || g_usb_setup.wLength != 0) return false;
         #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
         if(MSD_EP_OUT_LAST_PPB == ODD && g_usb_bd_table[MSD_BD_OUT_EVEN].STATbits.UOWN == 0) setup_cbw();
         else if (MSD_EP_OUT_LAST_PPB == EVEN && g_usb_bd_table[MSD_BD_OUT_ODD].STATbits.UOWN == 0) setup_cbw();
         #else
         if(!g_usb_bd_table[MSD_BD_OUT].STATbits.UOWN) setup_cbw();
         #endif
-        m_task_cnt       = 0;
-        m_task_put_index = 0;
-        m_task_get_index = 0;
+        m_task_tail = m_task_head; // In the ISR, so msd_tasks() isn't part way through a task.
         
         m_wait_for_bomsr = false;
         m_unit_attention = false;
+        #if MSD_NUM_LUNS > 1
+        for(uint8_t i = 0; i < MSD_NUM_LUNS; i++) m_lun_state[i].unit_attention = false;
+        #endif
         usb_arm_in_status();
         usb_set_control_stage(STATUS_IN_STAGE);
         return true;
     }
+    
+    if(g_usb_setup.bRequest == GET_MAX_LUN)
+    {
+        if(g_usb_setup.wValue != 0 || g_usb_setup.wIndex != MSD_INT || g_usb_setup.wLength != 1) return false;
+        usb_set_rom_ptr(&m_max_lun);
+        usb_setup_in_control_transfer(ROM, 1, g_usb_setup.wLength);
+        usb_start_in_control_transfer();
+        return true;
+    }
 
-    // Only supported class request is BOMSR, GET_MAX_LUN is not supported
     return false;
 }
 
@@ -370,19 +980,19 @@ void msd_init(void)
     #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
     // BD settings
     g_usb_bd_table[MSD_BD_OUT_EVEN].STAT = 0;
-    g_usb_bd_table[MSD_BD_OUT_EVEN].ADR  = (uint16_t)g_msd_ep_out_even;
+    g_usb_bd_table[MSD_BD_OUT_EVEN].ADR  = USB_RAM_ADDR(g_msd_ep_out_even);
     g_usb_bd_table[MSD_BD_OUT_ODD].STAT  = 0;
-    g_usb_bd_table[MSD_BD_OUT_ODD].ADR   = (uint16_t)g_msd_ep_out_odd;
+    g_usb_bd_table[MSD_BD_OUT_ODD].ADR   = USB_RAM_ADDR(g_msd_ep_out_odd);
     g_usb_bd_table[MSD_BD_IN_EVEN].STAT  = 0;
-    g_usb_bd_table[MSD_BD_IN_EVEN].ADR   = (uint16_t)g_msd_ep_in_even;
+    g_usb_bd_table[MSD_BD_IN_EVEN].ADR   = USB_RAM_ADDR(g_msd_ep_in_even);
     g_usb_bd_table[MSD_BD_IN_ODD].STAT   = 0;
-    g_usb_bd_table[MSD_BD_IN_ODD].ADR    = (uint16_t)g_msd_ep_in_odd;
+    g_usb_bd_table[MSD_BD_IN_ODD].ADR    = USB_RAM_ADDR(g_msd_ep_in_odd);
     #else
     // BD settings
     g_usb_bd_table[MSD_BD_OUT].STAT = 0;
-    g_usb_bd_table[MSD_BD_OUT].ADR  = (uint16_t)g_msd_ep_out;
+    g_usb_bd_table[MSD_BD_OUT].ADR  = USB_RAM_ADDR(g_msd_ep_out);
     g_usb_bd_table[MSD_BD_IN].STAT  = 0;
-    g_usb_bd_table[MSD_BD_IN].ADR   = (uint16_t)g_msd_ep_in;
+    g_usb_bd_table[MSD_BD_IN].ADR   = USB_RAM_ADDR(g_msd_ep_in);
     #endif
 
     // EP Settings
@@ -397,12 +1007,31 @@ void msd_init(void)
     
     m_wait_for_bomsr    = false;
     m_unit_attention    = false;
+    m_media_prev        = false;
     m_end_data_short    = false;
     m_clear_halt_event  = false;
     
-    m_task_cnt       = 0;
-    m_task_put_index = 0;
-    m_task_get_index = 0;
+    m_task_head          = 0;
+    m_task_tail          = 0;
+    g_msd_task_overflows = 0;
+    #ifdef MSD_MOUNT_STATS
+    usb_ram_set(0, (uint8_t*)&m_mount_stats, sizeof(m_mount_stats));
+    #endif
+    
+    #ifdef MSD_READ_PREFETCH
+    m_prefetch_busy     = false;
+    m_ahead_valid       = false;
+    m_sect_swap_pending = false;
+    #endif
+    
+    #ifdef MSD_ASYNC_MEDIA
+    m_media_busy   = false;
+    m_media_resume = RESUME_NONE;
+    #endif
+    
+    #ifdef MSD_IMAGE_CRC
+    reset_image_crc();
+    #endif
     
     setup_cbw();
 }
@@ -410,22 +1039,66 @@ void msd_init(void)
 
 void msd_add_task(void)
 {
-    if(m_task_cnt >= 4) return;
-
-    m_tasks_buff.task[m_task_put_index++] = *((uint8_t*)&g_usb_last_USTAT);
-    if(m_task_put_index == 4) m_task_put_index = 0;
-    m_task_cnt++;
+    if((uint8_t)(m_task_head - m_task_tail) >= MSD_TASK_QUEUE_SIZE)
+    {
+        g_msd_task_overflows++;
+        return;
+    }
+    m_tasks_buff.task[m_task_head & (MSD_TASK_QUEUE_SIZE - 1)] = *((uint8_t*)&g_usb_last_USTAT);
+    m_task_head++; // Only after the task is stored, msd_tasks() can take it from here.
 }
 
 
 void msd_tasks(void)
 {
+    bool queued;
+    
+    // Idle, leave the USB interrupt alone.
+    #ifdef MSD_ASYNC_MEDIA
+    if(m_task_head == m_task_tail && !m_clear_halt_event && m_media_resume == RESUME_NONE) return;
+    #else
+    if(m_task_head == m_task_tail && !m_clear_halt_event) return;
+    #endif
+    
+    #ifndef USE_POLLING
     USB_INTERRUPT_ENABLE = 0;
-    if(m_task_cnt)
+    #endif
+    queued = (m_task_head != m_task_tail); // Again, a BOMSR could have emptied it.
+    #ifdef MSD_READ_PREFETCH
+    // Leave the task queued while the next sector is still being fetched. 
+    // OUT tasks wait too, so a new command can't reuse the sector buffers.
+    if(queued && m_prefetch_busy && (MSD_TRANSACTION_DIR == OUT || m_sect_swap_pending))
     {
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 1;
+        #endif
+        return;
+    }
+    #endif
+    #ifdef MSD_ASYNC_MEDIA
+    // Nothing is armed while the media is busy, so the host is NAKed.
+    if(m_media_busy)
+    {
+        #ifndef USE_POLLING
+        USB_INTERRUPT_ENABLE = 1;
+        #endif
+        return;
+    }
+    if(m_media_resume != RESUME_NONE)
+    {
+        if(m_media_resume == RESUME_READ_DATA) start_read_data();
+        #ifdef USE_WRITE_10
+        else next_write_data();
+        #endif
+        m_media_resume = RESUME_NONE;
+    }
+    #endif
+    if(queued)
+    {
+        USB_TRACE(TRACE_MSD_TASKS); // The USB interrupt is masked.
         if(MSD_TRANSACTION_DIR == OUT)
         {
-            MSD_EP_OUT_DATA_TOGGLE_VAL ^= 1;
+            USB_NEXT_TOGGLE(MSD_EP_OUT_DATA_TOGGLE_VAL);
             #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
             MSD_EP_OUT_LAST_PPB = MSD_PINGPONG_PARITY;
             #endif
@@ -443,7 +1116,7 @@ void msd_tasks(void)
         }
         else
         {
-            MSD_EP_IN_DATA_TOGGLE_VAL ^= 1;
+            USB_NEXT_TOGGLE(MSD_EP_IN_DATA_TOGGLE_VAL);
             #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
             MSD_EP_IN_LAST_PPB = MSD_PINGPONG_PARITY;
             #endif
@@ -472,9 +1145,8 @@ void msd_tasks(void)
                     break;
             }
         }
-        m_task_get_index++;
-        if(m_task_get_index == 4) m_task_get_index = 0;
-        m_task_cnt--;
+        m_task_tail++;
+        USB_TRACE(TRACE_MSD_TASKS | TRACE_EXIT);
     }
     else if(m_clear_halt_event)
     {
@@ -482,7 +1154,9 @@ void msd_tasks(void)
         else if(m_msd_state == MSD_WAIT_CLEAR) setup_csw();
         m_clear_halt_event = false;
     }
+    #ifndef USE_POLLING
     USB_INTERRUPT_ENABLE = 1;
+    #endif
 }
 
 
@@ -510,15 +1184,48 @@ void msd_clear_ep_toggle(void)
 }
 
 
+#ifdef MSD_READ_PREFETCH
+void msd_rx_sector_complete(void)
+{
+    m_prefetch_busy = false;
+}
+#endif
+
+
+#ifdef MSD_ASYNC_MEDIA
+void msd_media_complete(void)
+{
+    m_media_busy = false;
+}
+#endif
+
+
+#ifdef MSD_WRITE_CACHE
+void msd_flush_tasks(void)
+{
+    // The fill slot can only be dirty before WRITE_10 starts reusing it, so it holds the older sector.
+    if(m_cache_dirty[m_cache_fill]) commit_cache_slot(m_cache_fill);
+    else if(m_cache_dirty[m_cache_fill ^ 1]) commit_cache_slot(m_cache_fill ^ 1);
+}
+#endif
+
+
+#ifdef MSD_MOUNT_STATS
+void msd_get_mount_stats(msd_mount_stats_t* p_stats)
+{
+    usb_ram_copy((uint8_t*)&m_mount_stats, (uint8_t*)p_stats, sizeof(m_mount_stats));
+}
+#endif
+
+
 static void service_cbw(void)
 {
-    uint8_t  dev_expect;
+    const scsi_cmd_t *p_cmd;
+    uint8_t i;
 
     #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-    uint8_t *in_ep_addr;
-    
-    if(MSD_EP_IN_LAST_PPB == ODD) in_ep_addr = g_msd_ep_in_even;
-    else in_ep_addr = g_msd_ep_in_odd;
+    if(MSD_EP_IN_LAST_PPB == ODD) m_in_ep_addr = g_msd_ep_in_even;
+    else m_in_ep_addr = g_msd_ep_in_odd;
     
     if(MSD_EP_OUT_LAST_PPB == ODD) usb_ram_copy(g_msd_ep_out_odd, g_msd_cbw.BYTES, 31);
     else usb_ram_copy(g_msd_ep_out_even, g_msd_cbw.BYTES, 31);
@@ -527,324 +1234,490 @@ static void service_cbw(void)
     #endif
     
     if(!cbw_valid()) return;
+    #if MSD_NUM_LUNS > 1
+    select_lun(g_msd_cbw.bCBWLUN);
+    #endif
     
-    switch(g_msd_cbw.CBWCB0[0])
+    #ifdef MSD_MOUNT_STATS
+    if(!m_mount_stats.CBW_Seen)
     {
-        case WRITE_10:
-            #if defined(USE_WRITE_10) && defined(USE_WR_PROTECT)
-            if(msd_wr_protect())
-            {
-            #endif
-                #if !defined(USE_WRITE_10) || defined(USE_WR_PROTECT)
-                g_msd_sense_key                       = DATA_PROTECT;
-                g_msd_additional_sense_code           = ASC_WRITE_PROTECTED;
-                g_msd_additional_sense_code_qualifier = ASCQ_WRITE_PROTECTED;
-                fail_command();
-                return;
-                #endif
-            #if defined(USE_WRITE_10) && defined(USE_WR_PROTECT)
-            }
-            #endif
-        case READ_10:
-            #ifdef USE_WRITE_10
-            if(g_msd_cbw.CBWCB0[0] == READ_10) dev_expect = Di;	
-            else dev_expect = Do;	
-            #else	
-            dev_expect = Di;	
-            #endif
-            
-            #ifdef USE_EXTERNAL_MEDIA
-            if(!check_for_media())
-            {
-                media_not_present_sense();
-                fail_command();
-                return;
-            }
-            #endif
-            g_msd_rw_10_vars.TF_LEN_BYTES[0] = m_read_10_cmd.TF_LEN_BYTES[1];
-            g_msd_rw_10_vars.TF_LEN_BYTES[1] = m_read_10_cmd.TF_LEN_BYTES[0];
-            
-            if(g_msd_rw_10_vars.TF_LEN == 0)
-            {
-                check_13_cases(0, Dn);
-                return;
-            }
-            
-            g_msd_rw_10_vars.START_LBA_BYTES[0] = m_read_10_cmd.LBA_BYTES[3];
-            g_msd_rw_10_vars.START_LBA_BYTES[1] = m_read_10_cmd.LBA_BYTES[2];
-            g_msd_rw_10_vars.START_LBA_BYTES[2] = m_read_10_cmd.LBA_BYTES[1];
-            g_msd_rw_10_vars.START_LBA_BYTES[3] = m_read_10_cmd.LBA_BYTES[0];
-            g_msd_rw_10_vars.LBA = g_msd_rw_10_vars.START_LBA;
-            
-            if((g_msd_rw_10_vars.LBA + g_msd_rw_10_vars.TF_LEN) > VOL_CAPACITY_IN_BLOCKS)
-            {
-                g_msd_sense_key                       = ILLEGAL_REQUEST;
-                g_msd_additional_sense_code           = ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
-                g_msd_additional_sense_code_qualifier = ASCQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
-                fail_command();
-                return;
-            }
-            
-            g_msd_rw_10_vars.TF_LEN_IN_BYTES = ((uint32_t)g_msd_rw_10_vars.TF_LEN)*BYTES_PER_BLOCK_LE;
-            
-            if(!check_13_cases(g_msd_rw_10_vars.TF_LEN_IN_BYTES, dev_expect)) return;
-            
-            g_msd_byte_of_sect = 0;
-            
-            #ifdef USE_WRITE_10
-            if(dev_expect == Do)
-            {
-                #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-                msd_arm_ep_out((uint8_t)MSD_BD_OUT_EVEN + (MSD_EP_OUT_LAST_PPB ^ 1));
-                MSD_EP_OUT_DATA_TOGGLE_VAL ^= 1;
-                msd_arm_ep_out((uint8_t)MSD_BD_OUT_EVEN + MSD_EP_OUT_LAST_PPB);
-                #else
-                msd_arm_ep_out();
-                #endif
-                m_msd_state = MSD_WRITE_DATA;
-                return;
-            }
-            #endif
-            #ifdef MSD_LIMITED_RAM
-            #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-            MSD_EP_IN_LAST_PPB ^= 1;
-            service_read10();
-
-            MSD_EP_IN_DATA_TOGGLE_VAL ^= 1;
-            MSD_EP_IN_LAST_PPB ^= 1;
-            service_read10();
-            #else
-            service_read10();
-            #endif
-            #else
-            #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-            MSD_EP_IN_LAST_PPB ^= 1;
-            msd_rx_sector();
-            service_read10();
-
-            MSD_EP_IN_DATA_TOGGLE_VAL ^= 1;
-            MSD_EP_IN_LAST_PPB ^= 1;
-            service_read10();
-            #else
-            msd_rx_sector();
-            service_read10();
-            #endif
-            #endif
-            m_msd_state = MSD_READ_DATA;
-            break;
-            
-        case TEST_UNIT_READY:
-            #ifdef USE_EXTERNAL_MEDIA
-            m_media_present = check_for_media();
-            if(m_unit_attention)
-            {
-                m_unit_attention = false;
-                unit_attention_sense();
-                fail_command();
-                return;
-            }
-            
-            if(!m_media_present)
-            {
-                media_not_present_sense();
-                fail_command();
-                return;
-            }
-            #else
-            if(m_unit_attention)
-            {
-                m_unit_attention = false;
-                unit_attention_sense();
-                fail_command();
-                return;
-            }    
-            #endif
-            
-            #ifdef USE_TEST_UNIT_READY
-            if(check_13_cases(0, Dn) && msd_test_unit_ready()) fail_command();
-            #else
-            check_13_cases(0, Dn);
-            #endif
-            break;
-            
-            
-        #ifdef USE_PREVENT_ALLOW_MEDIUM_REMOVAL
-        case PREVENT_ALLOW_MEDIUM_REMOVAL:
-            #ifdef USE_EXTERNAL_MEDIA
-            if(!check_for_media())
-            {
-                media_not_present_sense();
-                fail_command();
-                return;
-            }
-            #endif
-            invalid_command_sense();
-            fail_command();
-            break;
+        m_mount_stats.CBW_Seen = true;
+        m_mount_stats.First_CBW_Frame = usb_get_frame_number();
+    }
+    if(!m_mount_stats.Read_Seen) m_mount_stats.Commands++;
+    #endif
+    
+    p_cmd = m_scsi_cmds;
+    for(i = 0; i < NUM_SCSI_CMDS; i++)
+    {
+        if(p_cmd->opcode == g_msd_cbw.CBWCB0[0]) break;
+        p_cmd++;
+    }
+    if(i == NUM_SCSI_CMDS)
+    {
+        #ifdef MSD_MOUNT_STATS
+        if(!m_mount_stats.Read_Seen && m_mount_stats.Num_Unsupported < MSD_MOUNT_UNSUPPORTED)
+        {
+            m_mount_stats.Unsupported[m_mount_stats.Num_Unsupported++] = g_msd_cbw.CBWCB0[0];
+        }
         #endif
-            
-            
-        case REQUEST_SENSE:
-            g_msd_bytes_to_transfer.LB = m_request_sense_cmd.ALLOCATION_LENGTH;
-            g_msd_bytes_to_transfer.HB = 0;
-            if(g_msd_bytes_to_transfer.val)
-            {
-                if(g_msd_bytes_to_transfer.val > 18) g_msd_bytes_to_transfer.val = 18;
-                
-                #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-                usb_ram_set(0, in_ep_addr, g_msd_bytes_to_transfer.val);
-                
-                in_ep_addr[0] = CURRENT_FIXED; // RESPONSE_CODE
-                in_ep_addr[2] = g_msd_sense_key;
-                in_ep_addr[7] = 10; // ADDITIONAL_SENSE_LENGTH
-                in_ep_addr[12] = g_msd_additional_sense_code;
-                in_ep_addr[13] = g_msd_additional_sense_code_qualifier;
-                #else
-                usb_ram_set(0, g_msd_ep_in, g_msd_bytes_to_transfer.val);
-                
-                g_msd_ep_in[0] = CURRENT_FIXED; // RESPONSE_CODE
-                g_msd_ep_in[2] = g_msd_sense_key;
-                g_msd_ep_in[7] = 10; // ADDITIONAL_SENSE_LENGTH
-                g_msd_ep_in[12] = g_msd_additional_sense_code;
-                g_msd_ep_in[13] = g_msd_additional_sense_code_qualifier;
-                #endif
-                send_data_response((uint8_t)g_msd_bytes_to_transfer.val);
-                return;
-            }
-            check_13_cases(0, Dn);
-            break;
-            
-            
-        case INQUIRY:
-            g_msd_bytes_to_transfer.LB = m_inquiry_cmd.ALLOCATION_LENGTH_BYTES[1];
-            g_msd_bytes_to_transfer.HB = m_inquiry_cmd.ALLOCATION_LENGTH_BYTES[0];
-            
-            if(g_msd_bytes_to_transfer.val)
-            {
-                if(g_msd_bytes_to_transfer.val > 36) g_msd_bytes_to_transfer.val = 36;
-                #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-                usb_rom_copy((const uint8_t*)&g_scsi_inquiry, in_ep_addr, (uint8_t)g_msd_bytes_to_transfer.val);
-                #else
-                usb_rom_copy((const uint8_t*)&g_scsi_inquiry, g_msd_ep_in, (uint8_t)g_msd_bytes_to_transfer.val);
-                #endif
-                send_data_response((uint8_t)g_msd_bytes_to_transfer.val);
-                return;
-            } 
-            check_13_cases(0, Dn);
-            break;
-            
-            
-        case MODE_SENSE_6:
-            g_msd_bytes_to_transfer.LB = m_mode_sense_6_cmd.ALLOCATION_LENGTH;
-            g_msd_bytes_to_transfer.HB = 0;
-            
-            #ifdef USE_EXTERNAL_MEDIA
-            if(!check_for_media())
-            {
-                media_not_present_sense();
-                fail_command();
-                return;
-            }
-            #endif
-            
-            if(g_msd_bytes_to_transfer.val)
-            {
-                if(g_msd_bytes_to_transfer.val > 4) g_msd_bytes_to_transfer.val = 4;
-                g_msd_mode_sense.MODE_DATA_LENGTH          = 0x03;
-                g_msd_mode_sense.MEDIUM_TYPE               = 0x00;
-                g_msd_mode_sense.DEVICE_SPECIFIC_PARAMETER = 0x00; // 0x00 for R/W, 0x80 for R-only
-                g_msd_mode_sense.BLOCK_DESCRIPTOR_LENGTH   = 0x00;
-                #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-                usb_ram_copy((uint8_t*)&g_msd_mode_sense, in_ep_addr, (uint8_t)g_msd_bytes_to_transfer.val);
-                #endif
-                send_data_response((uint8_t)g_msd_bytes_to_transfer.val);
-                return;
-            }
-            check_13_cases(0, Dn);
-            break;
-            
-        #ifdef USE_START_STOP_UNIT
-        case START_STOP_UNIT:
-            #ifdef USE_EXTERNAL_MEDIA
-            if(!check_for_media())
-            {
-                media_not_present_sense();
-                fail_command();
-                return;
-            }
-            #endif
-            if(check_13_cases(0, Dn) && msd_start_stop_unit())
-            {
-                fail_command();
-                return;
-            }
-            break;
+        invalid_command_sense();
+        fail_command();
+        return;
+    }
+    m_cmd = p_cmd;
+    
+    #ifdef USE_EXTERNAL_MEDIA
+    if(p_cmd->need_media && !check_for_media())
+    {
+        media_not_present_sense();
+        fail_command();
+        return;
+    }
+    #endif
+    
+    if(p_cmd->handler != NULL && !p_cmd->handler()) return;
+    
+    if(p_cmd->dev_expect == Di && g_msd_bytes_to_transfer.val)
+    {
+        if(g_msd_bytes_to_transfer.val > p_cmd->max_len) g_msd_bytes_to_transfer.val = p_cmd->max_len;
+        send_data_response((uint8_t)g_msd_bytes_to_transfer.val);
+    }
+    else check_13_cases(0, Dn);
+}
+
+
+static bool scsi_write(void)
+{
+    #if defined(USE_WRITE_10) && defined(USE_WR_PROTECT)
+    if(!LUN_WR_PROTECT()) return scsi_read_write();
+    #elif defined(USE_WRITE_10)
+    return scsi_read_write();
+    #endif
+    #if !defined(USE_WRITE_10) || defined(USE_WR_PROTECT)
+    g_msd_sense_key                       = DATA_PROTECT;
+    g_msd_additional_sense_code           = ASC_WRITE_PROTECTED;
+    g_msd_additional_sense_code_qualifier = ASCQ_WRITE_PROTECTED;
+    fail_command();
+    return false;
+    #endif
+}
+
+
+static bool scsi_read_write(void)
+{
+    bool lba_valid;
+    
+    lba_valid = load_rw_vars();
+    
+    if(g_msd_rw_10_vars.TF_LEN == 0)
+    {
+        check_13_cases(0, Dn);
+        return false;
+    }
+    
+    // Written so LBA + TF_LEN can't overflow 32-bits.
+    if(!lba_valid || (g_msd_rw_10_vars.TF_LEN > VOL_CAPACITY_IN_BLOCKS) || (g_msd_rw_10_vars.LBA > (VOL_CAPACITY_IN_BLOCKS - g_msd_rw_10_vars.TF_LEN)))
+    {
+        g_msd_sense_key                       = ILLEGAL_REQUEST;
+        g_msd_additional_sense_code           = ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+        g_msd_additional_sense_code_qualifier = ASCQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+        fail_command();
+        return false;
+    }
+    
+    if(g_msd_rw_10_vars.TF_LEN > (0xFFFFFFFFUL / BYTES_PER_BLOCK_LE)) g_msd_rw_10_vars.TF_LEN_IN_BYTES = 0xFFFFFFFFUL; // More than a CBW can ask for, check_13_cases() phase errors it.
+    else g_msd_rw_10_vars.TF_LEN_IN_BYTES = g_msd_rw_10_vars.TF_LEN * BYTES_PER_BLOCK_LE;
+    
+    if(!check_13_cases(g_msd_rw_10_vars.TF_LEN_IN_BYTES, m_cmd->dev_expect)) return false;
+    
+    #ifdef MSD_MOUNT_STATS
+    if(!m_mount_stats.Read_Seen && m_cmd->dev_expect == Di)
+    {
+        m_mount_stats.Read_Seen = true;
+        m_mount_stats.First_Read_Frame = usb_get_frame_number();
+    }
+    #endif
+    g_msd_byte_of_sect = 0;
+    
+    #ifdef USE_WRITE_10
+    if(m_cmd->dev_expect == Do)
+    {
+        #ifdef MSD_READ_PREFETCH
+        m_ahead_valid = false; // Could be overwriting it.
         #endif
-            
-            
-        case READ_CAPACITY:
-            #ifdef USE_EXTERNAL_MEDIA
-            if(!check_for_media())
-            {
-                media_not_present_sense();
-                fail_command();
-                return;
-            }
-            #endif
-            if((m_read_capacity_10_cmd.LOGICAL_BLOCK_ADDRESS != 0)&&(m_read_capacity_10_cmd.PMI == 0))
-            {
-                g_msd_sense_key                       = ILLEGAL_REQUEST;
-                g_msd_additional_sense_code           = ASC_INVALID_FIELD_IN_CBD;
-                g_msd_additional_sense_code_qualifier = ASCQ_INVALID_FIELD_IN_CBD;
-                fail_command();
-                return;
-            }
-            g_msd_rw_10_vars.START_LBA_BYTES[0] = m_read_capacity_10_cmd.LOGICAL_BLOCK_ADDRESS_BYTES[3];// Big-endian to little-endian
-            g_msd_rw_10_vars.START_LBA_BYTES[1] = m_read_capacity_10_cmd.LOGICAL_BLOCK_ADDRESS_BYTES[2];
-            g_msd_rw_10_vars.START_LBA_BYTES[2] = m_read_capacity_10_cmd.LOGICAL_BLOCK_ADDRESS_BYTES[1];
-            g_msd_rw_10_vars.START_LBA_BYTES[3] = m_read_capacity_10_cmd.LOGICAL_BLOCK_ADDRESS_BYTES[0];
+        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+        msd_arm_ep_out((uint8_t)MSD_BD_OUT_EVEN + (MSD_EP_OUT_LAST_PPB ^ 1));
+        USB_NEXT_TOGGLE(MSD_EP_OUT_DATA_TOGGLE_VAL);
+        msd_arm_ep_out((uint8_t)MSD_BD_OUT_EVEN + MSD_EP_OUT_LAST_PPB);
+        #else
+        #ifdef MSD_DIRECT_WRITE
+        m_direct_write = usb_set_bd_buffer(&g_usb_bd_table[MSD_BD_OUT], g_msd_sect_data, BYTES_PER_BLOCK_LE);
+        #endif
+        msd_arm_ep_out();
+        #endif
+        m_msd_state = MSD_WRITE_DATA;
+        return false;
+    }
+    #endif
+    
+    #ifdef MSD_WRITE_CACHE
+    flush_cache(); // Make sure the media holds the latest data before reading.
+    #endif
+    #ifndef MSD_LIMITED_RAM
+    #ifdef MSD_READ_PREFETCH
+    m_sect_swap_pending = false;
+    if(!take_read_ahead())
+    {
+        m_drain_sect = g_msd_sect_data;
+        m_fill_sect  = g_msd_prefetch_data;
+        LUN_RX_SECTOR();
+    }
+    start_prefetch();
+    #elif defined(MSD_ASYNC_MEDIA)
+    if(rx_sector_pending())
+    {
+        m_media_resume = RESUME_READ_DATA;
+        m_msd_state = MSD_READ_DATA;
+        return false;
+    }
+    #else
+    LUN_RX_SECTOR();
+    #endif
+    #endif
+    start_read_data();
+    return false;
+}
 
-            g_msd_rw_10_vars.LBA = g_msd_rw_10_vars.START_LBA;
 
-            #ifdef USE_READ_CAPACITY
-            msd_read_capacity();
-            #else
+static void start_read_data(void)
+{
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    MSD_EP_IN_LAST_PPB ^= 1;
+    service_read10();
 
-            g_msd_read_capacity_10.RETURNED_LOGICAL_BLOCK_ADDRESS = g_msd_rw_10_vars.START_LBA > LAST_BLOCK_LE ? 0xFFFFFFFFUL : LAST_BLOCK_BE;
-            g_msd_read_capacity_10.BLOCK_LENGTH_IN_BYTES = BYTES_PER_BLOCK_BE;
-            #endif
-            #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
-            usb_ram_copy((uint8_t*)&g_msd_read_capacity_10, in_ep_addr, 8);
-            #endif
-            send_data_response(8);
-            break;
-            
-        #ifdef USE_VERIFY_10
-        case VERIFY_10:
-            #ifdef USE_EXTERNAL_MEDIA
-            if(!check_for_media())
-            {
-                media_not_present_sense();
-                fail_command();
-                return;
-            }
+    USB_NEXT_TOGGLE(MSD_EP_IN_DATA_TOGGLE_VAL);
+    MSD_EP_IN_LAST_PPB ^= 1;
+    service_read10();
+    #else
+    service_read10();
+    #endif
+    m_msd_state = MSD_READ_DATA;
+}
+
+
+static bool scsi_test_unit_ready(void)
+{
+    #ifdef USE_EXTERNAL_MEDIA
+    m_media_present = check_for_media();
+    #endif
+    if(m_unit_attention)
+    {
+        m_unit_attention = false;
+        unit_attention_sense();
+        fail_command();
+        return false;
+    }
+    
+    #ifdef USE_EXTERNAL_MEDIA
+    if(!m_media_present)
+    {
+        media_not_present_sense();
+        fail_command();
+        return false;
+    }
+    #endif
+    
+    #ifdef USE_TEST_UNIT_READY
+    if(LUN_TEST_UNIT_READY())
+    {
+        fail_command();
+        return false;
+    }
+    #endif
+    return true;
+}
+
+
+#ifdef USE_PREVENT_ALLOW_MEDIUM_REMOVAL
+static bool scsi_prevent_allow_medium_removal(void)
+{
+    #ifdef MSD_WRITE_CACHE
+    flush_cache();
+    #endif
+    invalid_command_sense();
+    fail_command();
+    return false;
+}
+#endif
+
+
+static bool scsi_request_sense(void)
+{
+    usb_ram_set(0, CMD_IN_BUFF, 18);
+    CMD_IN_BUFF[0]  = CURRENT_FIXED; // RESPONSE_CODE
+    CMD_IN_BUFF[2]  = g_msd_sense_key;
+    CMD_IN_BUFF[7]  = 10; // ADDITIONAL_SENSE_LENGTH
+    CMD_IN_BUFF[12] = g_msd_additional_sense_code;
+    CMD_IN_BUFF[13] = g_msd_additional_sense_code_qualifier;
+    
+    g_msd_bytes_to_transfer.LB = m_request_sense_cmd.ALLOCATION_LENGTH;
+    g_msd_bytes_to_transfer.HB = 0;
+    return true;
+}
+
+
+static bool scsi_inquiry(void)
+{
+    usb_rom_copy((const uint8_t*)&g_scsi_inquiry, CMD_IN_BUFF, 36);
+    
+    g_msd_bytes_to_transfer.LB = m_inquiry_cmd.ALLOCATION_LENGTH_BYTES[1];
+    g_msd_bytes_to_transfer.HB = m_inquiry_cmd.ALLOCATION_LENGTH_BYTES[0];
+    return true;
+}
+
+
+static bool scsi_mode_sense_6(void)
+{
+    g_msd_mode_sense.MODE_DATA_LENGTH          = 0x03;
+    g_msd_mode_sense.MEDIUM_TYPE               = 0x00;
+    g_msd_mode_sense.DEVICE_SPECIFIC_PARAMETER = 0x00; // 0x00 for R/W, 0x80 for R-only
+    g_msd_mode_sense.BLOCK_DESCRIPTOR_LENGTH   = 0x00;
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    usb_ram_copy((uint8_t*)&g_msd_mode_sense, CMD_IN_BUFF, 4);
+    #endif
+    
+    g_msd_bytes_to_transfer.LB = m_mode_sense_6_cmd.ALLOCATION_LENGTH;
+    g_msd_bytes_to_transfer.HB = 0;
+    return true;
+}
+
+
+static bool scsi_mode_sense_10(void)
+{
+    usb_ram_set(0, CMD_IN_BUFF, 8); // MEDIUM_TYPE, DEVICE_SPECIFIC_PARAMETER (R/W) and BLOCK_DESCRIPTOR_LENGTH 0.
+    CMD_IN_BUFF[1] = 0x06; // MODE_DATA_LENGTH, the bytes after it.
+    
+    g_msd_bytes_to_transfer.LB = g_msd_cbw.CBWCB0[8];
+    g_msd_bytes_to_transfer.HB = g_msd_cbw.CBWCB0[7];
+    return true;
+}
+
+
+static bool scsi_read_format_capacities(void)
+{
+    usb_ram_set(0, CMD_IN_BUFF, 12);
+    CMD_IN_BUFF[3] = 8; // CAPACITY_LIST_LENGTH, one descriptor.
+    #ifdef USE_EXTERNAL_MEDIA
+    if(!check_for_media()) CMD_IN_BUFF[8] = NO_MEDIA_PRESENT;
+    else
+    {
+        put_be32(&CMD_IN_BUFF[4], VOL_CAPACITY_IN_BLOCKS);
+        CMD_IN_BUFF[8] = FORMATTED_MEDIA;
+    }
+    #else
+    put_be32(&CMD_IN_BUFF[4], VOL_CAPACITY_IN_BLOCKS);
+    CMD_IN_BUFF[8] = FORMATTED_MEDIA;
+    #endif
+    CMD_IN_BUFF[10] = (uint8_t)(BYTES_PER_BLOCK_LE >> 8); // BLOCK_LENGTH, 24 bits.
+    CMD_IN_BUFF[11] = (uint8_t)BYTES_PER_BLOCK_LE;
+    
+    g_msd_bytes_to_transfer.LB = g_msd_cbw.CBWCB0[8];
+    g_msd_bytes_to_transfer.HB = g_msd_cbw.CBWCB0[7];
+    return true;
+}
+
+
+#ifdef USE_START_STOP_UNIT
+static bool scsi_start_stop_unit(void)
+{
+    #ifdef MSD_WRITE_CACHE
+    flush_cache();
+    #endif
+    #ifdef MSD_READ_PREFETCH
+    m_ahead_valid = false; // Media may be ejected or spun down.
+    #endif
+    if(LUN_START_STOP_UNIT())
+    {
+        fail_command();
+        return false;
+    }
+    return true;
+}
+#endif
+
+
+static bool scsi_read_capacity(void)
+{
+    if((m_read_capacity_10_cmd.LOGICAL_BLOCK_ADDRESS != 0)&&(m_read_capacity_10_cmd.PMI == 0))
+    {
+        g_msd_sense_key                       = ILLEGAL_REQUEST;
+        g_msd_additional_sense_code           = ASC_INVALID_FIELD_IN_CBD;
+        g_msd_additional_sense_code_qualifier = ASCQ_INVALID_FIELD_IN_CBD;
+        fail_command();
+        return false;
+    }
+    g_msd_rw_10_vars.START_LBA = get_be32(m_read_capacity_10_cmd.LOGICAL_BLOCK_ADDRESS_BYTES);
+    g_msd_rw_10_vars.LBA = g_msd_rw_10_vars.START_LBA;
+
+    #ifdef USE_READ_CAPACITY
+    LUN_READ_CAPACITY();
+    #else
+    if(g_msd_rw_10_vars.START_LBA > LAST_BLOCK_LE) g_msd_read_capacity_10.RETURNED_LOGICAL_BLOCK_ADDRESS = 0xFFFFFFFFUL;
+    else put_be32((uint8_t*)&g_msd_read_capacity_10.RETURNED_LOGICAL_BLOCK_ADDRESS, LAST_BLOCK_LE);
+    g_msd_read_capacity_10.BLOCK_LENGTH_IN_BYTES = BYTES_PER_BLOCK_BE;
+    #endif
+    #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+    usb_ram_copy((uint8_t*)&g_msd_read_capacity_10, CMD_IN_BUFF, 8);
+    #endif
+    
+    g_msd_bytes_to_transfer.val = 8; // No allocation length, always sent.
+    return true;
+}
+
+
+#ifdef USE_RW_12_16
+static bool scsi_service_action_in_16(void)
+{
+    uint32_t alloc_len;
+    
+    if(m_read_capacity_16_cmd.SERVICE_ACTION != READ_CAPACITY_16)
+    {
+        invalid_command_sense();
+        fail_command();
+        return false;
+    }
+    if((get_be32(m_read_capacity_16_cmd.LOGICAL_BLOCK_ADDRESS_BYTES) != 0 || get_be32(&m_read_capacity_16_cmd.LOGICAL_BLOCK_ADDRESS_BYTES[4]) != 0)&&(m_read_capacity_16_cmd.PMI == 0))
+    {
+        g_msd_sense_key                       = ILLEGAL_REQUEST;
+        g_msd_additional_sense_code           = ASC_INVALID_FIELD_IN_CBD;
+        g_msd_additional_sense_code_qualifier = ASCQ_INVALID_FIELD_IN_CBD;
+        fail_command();
+        return false;
+    }
+    // RETURNED LOGICAL BLOCK ADDRESS (8 bytes), LOGICAL BLOCK LENGTH IN BYTES (4 bytes), 
+    // protection and provisioning fields left 0.
+    usb_ram_set(0, CMD_IN_BUFF, 32);
+    put_be32(&CMD_IN_BUFF[4], LAST_BLOCK_LE);
+    put_be32(&CMD_IN_BUFF[8], BYTES_PER_BLOCK_LE);
+    
+    alloc_len = get_be32(m_read_capacity_16_cmd.ALLOCATION_LENGTH_BYTES);
+    if(alloc_len > 32) alloc_len = 32;
+    g_msd_bytes_to_transfer.val = (uint16_t)alloc_len;
+    return true;
+}
+#endif
+
+
+static bool scsi_synchronize_cache_10(void)
+{
+    #ifdef MSD_WRITE_CACHE
+    flush_cache();
+    #endif
+    return true; // Without a write cache every WRITE_10 is on the media before its CSW.
+}
+
+
+#ifdef USE_VERIFY_10
+static bool scsi_verify_10(void)
+{
+    if(g_msd_cbw.CBWCB0[1] & 0x06) // BYTCHK
+    {
+        g_msd_sense_key                       = ILLEGAL_REQUEST;
+        g_msd_additional_sense_code           = ASC_INVALID_FIELD_IN_CBD;
+        g_msd_additional_sense_code_qualifier = ASCQ_INVALID_FIELD_IN_CBD;
+        fail_command();
+        return false;
+    }
+    
+    load_rw_vars(); // Same LBA and length fields as READ_10.
+    if((g_msd_rw_10_vars.TF_LEN > VOL_CAPACITY_IN_BLOCKS) || (g_msd_rw_10_vars.LBA > (VOL_CAPACITY_IN_BLOCKS - g_msd_rw_10_vars.TF_LEN)))
+    {
+        g_msd_sense_key                       = ILLEGAL_REQUEST;
+        g_msd_additional_sense_code           = ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+        g_msd_additional_sense_code_qualifier = ASCQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+        fail_command();
+        return false;
+    }
+    
+    #ifdef MSD_WRITE_CACHE
+    flush_cache(); // Check what's on the media, the slots are free to reuse after.
+    #endif
+    #ifdef MSD_READ_PREFETCH
+    m_ahead_valid = false; // g_msd_sect_data could be holding it.
+    #endif
+    
+    // Nothing is armed until the CSW, the IN buffer and g_msd_sect_data are ours.
+    while(g_msd_rw_10_vars.TF_LEN)
+    {
+        #ifdef MSD_LIMITED_RAM
+        for(g_msd_byte_of_sect = 0; g_msd_byte_of_sect < BYTES_PER_BLOCK_LE; g_msd_byte_of_sect += MSD_EP_SIZE)
+        {
+            LUN_RX_SECTOR();
+            #if defined(MSD_IMAGE_CRC) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP)
+            if(MSD_EP_IN_LAST_PPB == ODD) m_verify_crc = image_crc(m_verify_crc, g_msd_ep_in_odd, MSD_EP_SIZE);
+            else m_verify_crc = image_crc(m_verify_crc, g_msd_ep_in_even, MSD_EP_SIZE);
+            #elif defined(MSD_IMAGE_CRC)
+            m_verify_crc = image_crc(m_verify_crc, g_msd_ep_in, MSD_EP_SIZE);
             #endif
-            check_13_cases(0, Dn);
-            break;
+        }
+        g_msd_byte_of_sect = 0;
+        #else
+        LUN_RX_SECTOR();
+        #ifdef MSD_IMAGE_CRC
+        m_verify_crc = image_crc(m_verify_crc, g_msd_sect_data, BYTES_PER_BLOCK_LE);
         #endif
-        default:
-            invalid_command_sense();
-            fail_command();
-            break;
+        #endif
+        #ifdef MSD_IMAGE_CRC
+        m_verify_sectors++;
+        #endif
+        g_msd_rw_10_vars.LBA++;
+        g_msd_rw_10_vars.TF_LEN--;
     }
+    return true;
+}
+#endif
+
+
+#ifdef MSD_IMAGE_CRC
+static bool scsi_image_crc(void)
+{
+    put_be32(&CMD_IN_BUFF[0],  ~m_write_crc);
+    put_be32(&CMD_IN_BUFF[4],  m_write_sectors);
+    put_be32(&CMD_IN_BUFF[8],  ~m_verify_crc);
+    put_be32(&CMD_IN_BUFF[12], m_verify_sectors);
+    if(g_msd_cbw.CBWCB0[1] & MSD_IMAGE_CRC_RESET) reset_image_crc();
+    
+    g_msd_bytes_to_transfer.val = 16; // No allocation length, always sent.
+    return true;
+}
+
+
+static uint32_t image_crc(uint32_t crc, const uint8_t *p_data, uint16_t len)
+{
+    while(len--) crc = m_crc32_table[(uint8_t)crc ^ *p_data++] ^ (crc >> 8);
+    return crc;
 }
 
 
+static void reset_image_crc(void)
+{
+    m_write_crc      = 0xFFFFFFFFUL;
+    m_write_sectors  = 0;
+    m_verify_crc     = 0xFFFFFFFFUL;
+    m_verify_sectors = 0;
+}
+#endif
+
+
 static void setup_cbw(void)
 {
     #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
     msd_arm_ep_out((uint8_t)MSD_BD_OUT_EVEN + (MSD_EP_OUT_LAST_PPB ^ 1));
     #else
+    #ifdef MSD_DIRECT_WRITE
+    g_usb_bd_table[MSD_BD_OUT].ADR = USB_RAM_ADDR(g_msd_ep_out); // Back from g_msd_sect_data.
+    #endif
     msd_arm_ep_out();
     #endif
     m_msd_state = MSD_CBW;
@@ -873,6 +1746,64 @@ static void setup_csw(void)
 }
 
 
+static bool load_rw_vars(void)
+{
+    bool lba_valid = true;
+    
+    switch(g_msd_cbw.CBWCB0[0])
+    {
+        #ifdef USE_RW_12_16
+        case READ_16:
+        case WRITE_16:
+            lba_valid = (get_be32(m_read_16_cmd.LBA_BYTES) == 0); // Upper 32-bits of the 64-bit LBA.
+            g_msd_rw_10_vars.START_LBA = get_be32(&m_read_16_cmd.LBA_BYTES[4]);
+            g_msd_rw_10_vars.TF_LEN    = get_be32(m_read_16_cmd.TF_LEN_BYTES);
+            break;
+            
+        case READ_12:
+        case WRITE_12:
+            g_msd_rw_10_vars.START_LBA = get_be32(m_read_12_cmd.LBA_BYTES);
+            g_msd_rw_10_vars.TF_LEN    = get_be32(m_read_12_cmd.TF_LEN_BYTES);
+            break;
+        #endif
+            
+        default: // READ_10 or WRITE_10
+            g_msd_rw_10_vars.START_LBA = get_be32(m_read_10_cmd.LBA_BYTES);
+            g_msd_rw_10_vars.TF_LEN_BYTES[0] = m_read_10_cmd.TF_LEN_BYTES[1];
+            g_msd_rw_10_vars.TF_LEN_BYTES[1] = m_read_10_cmd.TF_LEN_BYTES[0];
+            g_msd_rw_10_vars.TF_LEN_BYTES[2] = 0;
+            g_msd_rw_10_vars.TF_LEN_BYTES[3] = 0;
+            break;
+    }
+    g_msd_rw_10_vars.LBA = g_msd_rw_10_vars.START_LBA;
+    return lba_valid;
+}
+
+
+static uint32_t get_be32(const uint8_t *p_src)
+{
+    uint32_t val;
+    uint8_t *p_val = (uint8_t*)&val;
+    
+    p_val[0] = p_src[3];
+    p_val[1] = p_src[2];
+    p_val[2] = p_src[1];
+    p_val[3] = p_src[0];
+    return val;
+}
+
+
+static void put_be32(uint8_t *p_dst, uint32_t val)
+{
+    uint8_t *p_val = (uint8_t*)&val;
+    
+    p_dst[0] = p_val[3];
+    p_dst[1] = p_val[2];
+    p_dst[2] = p_val[1];
+    p_dst[3] = p_val[0];
+}
+
+
 static bool check_13_cases(uint32_t device_bytes, uint8_t dev_expect)
 {
 // Chapter 6.7 of MSC BOT Spec 1.0
@@ -920,6 +1851,7 @@ static bool check_13_cases(uint32_t device_bytes, uint8_t dev_expect)
     {
         if(g_msd_cbw.dCBWDataTransferLength == 0)
         {
+            g_msd_csw.bCSWStatus = COMMAND_PASSED; // Before setup_csw() copies it out.
             setup_csw();
             goto command_passed;
         }
@@ -953,6 +1885,7 @@ static bool cbw_valid(void)
     if(g_usb_bd_table[MSD_BD_OUT].CNT != 31) goto cbw_not_valid;
     #endif
     if(g_msd_cbw.dCBWSignature != CBW_SIG) goto cbw_not_valid;
+    if(g_msd_cbw.bCBWLUN > m_max_lun) goto cbw_not_valid;
     return true;
     
     cbw_not_valid:
@@ -973,6 +1906,13 @@ static void cause_bomsr(void)
 
 static void fail_command(void)
 {
+    #ifdef MSD_MOUNT_STATS
+    if(!m_mount_stats.Read_Seen)
+    {
+        m_mount_stats.Failed++;
+        if(g_msd_cbw.dCBWDataTransferLength != 0) m_mount_stats.Stalls++;
+    }
+    #endif
     if(g_msd_cbw.dCBWDataTransferLength == 0) // Hn
     {
         g_msd_csw.bCSWStatus = COMMAND_FAILED;
@@ -1027,7 +1967,10 @@ static void service_read10(void)
     }
     
     #ifdef MSD_LIMITED_RAM
-    msd_rx_sector();
+    LUN_RX_SECTOR();
+    #elif defined(MSD_READ_PREFETCH)
+    if(m_sect_swap_pending) swap_sect_buffers();
+    usb_ram_copy(m_drain_sect + g_msd_byte_of_sect, ep_address, MSD_EP_SIZE); // Load EP size worth of data from the drained sector buffer.
     #else
     usb_ram_copy(g_msd_sect_data + g_msd_byte_of_sect, ep_address, MSD_EP_SIZE); // Load EP size worth of data from the g_msd_sect_data buffer.
     #endif
@@ -1036,8 +1979,12 @@ static void service_read10(void)
     if(g_msd_byte_of_sect == BYTES_PER_BLOCK_LE) // More than one sector is required. Last bytes of sector were sent, increment the address, and load new sector.
     {
         g_msd_rw_10_vars.LBA++;
-        #ifndef MSD_LIMITED_RAM
-        msd_rx_sector();
+        #ifdef MSD_READ_PREFETCH
+        m_sect_swap_pending = (g_msd_rw_10_vars.TF_LEN_IN_BYTES != MSD_EP_SIZE); // Next sector is already being fetched.
+        #elif defined(MSD_ASYNC_MEDIA)
+        if(g_msd_rw_10_vars.TF_LEN_IN_BYTES != MSD_EP_SIZE) rx_sector_pending(); // This packet is loaded already, msd_tasks() holds the next one.
+        #elif !defined(MSD_LIMITED_RAM)
+        if(g_msd_rw_10_vars.TF_LEN_IN_BYTES != MSD_EP_SIZE) LUN_RX_SECTOR(); // Don't fetch past the end of the transfer.
         #endif
         g_msd_byte_of_sect = 0;
     }
@@ -1049,14 +1996,17 @@ static void service_read10(void)
     
     if(g_msd_rw_10_vars.TF_LEN_IN_BYTES == 0)
     {
-        MSD_EP_IN_DATA_TOGGLE_VAL ^= 1;
+        USB_NEXT_TOGGLE(MSD_EP_IN_DATA_TOGGLE_VAL);
         m_msd_state = MSD_READ_FINISHED;
     }
     return;
     
     #else
     #ifdef MSD_LIMITED_RAM
-    msd_rx_sector();
+    LUN_RX_SECTOR();
+    #elif defined(MSD_READ_PREFETCH)
+    if(m_sect_swap_pending) swap_sect_buffers();
+    usb_ram_copy(m_drain_sect + g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE); // Load EP size worth of data from the drained sector buffer.
     #else
     usb_ram_copy(g_msd_sect_data + g_msd_byte_of_sect, g_msd_ep_in, MSD_EP_SIZE); // Load EP size worth of data from the g_msd_sect_data buffer.
     #endif
@@ -1065,8 +2015,12 @@ static void service_read10(void)
     if(g_msd_byte_of_sect == BYTES_PER_BLOCK_LE) // More than one sector is required. Last bytes of sector were sent, increment the address, and load new sector.
     {
         g_msd_rw_10_vars.LBA++;
-        #ifndef MSD_LIMITED_RAM
-        msd_rx_sector();
+        #ifdef MSD_READ_PREFETCH
+        m_sect_swap_pending = (g_msd_rw_10_vars.TF_LEN_IN_BYTES != MSD_EP_SIZE); // Next sector is already being fetched.
+        #elif defined(MSD_ASYNC_MEDIA)
+        if(g_msd_rw_10_vars.TF_LEN_IN_BYTES != MSD_EP_SIZE) rx_sector_pending(); // This packet is loaded already, msd_tasks() holds the next one.
+        #elif !defined(MSD_LIMITED_RAM)
+        if(g_msd_rw_10_vars.TF_LEN_IN_BYTES != MSD_EP_SIZE) LUN_RX_SECTOR(); // Don't fetch past the end of the transfer.
         #endif
         g_msd_byte_of_sect = 0;
     }
@@ -1082,8 +2036,13 @@ static void service_read10(void)
 }
 
 
+#ifdef USE_WRITE_10
 static void service_write10(void)
 {
+    #ifdef MSD_ASYNC_MEDIA
+    bool pending = false;
+    #endif
+    
     #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
     #ifndef MSD_LIMITED_RAM
     uint8_t *ep_address;
@@ -1091,17 +2050,39 @@ static void service_write10(void)
     if(MSD_EP_OUT_LAST_PPB == ODD) ep_address = g_msd_ep_out_odd;
     else ep_address = g_msd_ep_out_even;
     #endif
+    
+    #if defined(MSD_IMAGE_CRC) && defined(MSD_LIMITED_RAM)
+    if(MSD_EP_OUT_LAST_PPB == ODD) m_write_crc = image_crc(m_write_crc, g_msd_ep_out_odd, MSD_EP_SIZE);
+    else m_write_crc = image_crc(m_write_crc, g_msd_ep_out_even, MSD_EP_SIZE);
+    #elif defined(MSD_IMAGE_CRC)
+    m_write_crc = image_crc(m_write_crc, ep_address, MSD_EP_SIZE);
+    #endif
 
     #ifdef MSD_LIMITED_RAM
-    msd_tx_sector();
+    LUN_TX_SECTOR();
+    #elif defined(MSD_WRITE_CACHE)
+    if(g_msd_byte_of_sect == 0 && m_cache_dirty[m_cache_fill]) commit_cache_slot(m_cache_fill); // Slot still holds an older sector.
+    usb_ram_copy(ep_address, m_cache_slot[m_cache_fill] + g_msd_byte_of_sect, MSD_EP_SIZE); // Load EP size worth of data from EP to the cache slot.
     #else
     usb_ram_copy(ep_address, g_msd_sect_data + g_msd_byte_of_sect, MSD_EP_SIZE); // Load EP size worth of data from EP to g_msd_sect_data buffer.
     #endif
     g_msd_byte_of_sect += MSD_EP_SIZE;
     if(g_msd_byte_of_sect == BYTES_PER_BLOCK_LE)
     {
-        #ifndef MSD_LIMITED_RAM
-        msd_tx_sector();
+        #ifdef MSD_IMAGE_CRC
+        m_write_sectors++;
+        #endif
+        #ifdef MSD_WRITE_CACHE
+        m_cache_lba[m_cache_fill]   = g_msd_rw_10_vars.LBA; // Sector is committed later by msd_flush_tasks().
+        m_cache_dirty[m_cache_fill] = true;
+        #if MSD_NUM_LUNS > 1
+        m_cache_lun[m_cache_fill]   = g_msd_lun;
+        #endif
+        m_cache_fill ^= 1;
+        #elif defined(MSD_ASYNC_MEDIA)
+        pending = tx_sector_pending();
+        #elif !defined(MSD_LIMITED_RAM)
+        LUN_TX_SECTOR();
         #endif
         g_msd_rw_10_vars.LBA++;
         g_msd_byte_of_sect = 0;
@@ -1110,38 +2091,65 @@ static void service_write10(void)
     g_msd_rw_10_vars.TF_LEN_IN_BYTES -= MSD_EP_SIZE;
     g_msd_csw.dCSWDataResidue        -= MSD_EP_SIZE;
     
-    if(g_msd_rw_10_vars.TF_LEN_IN_BYTES == 0)
-    {
-        MSD_EP_OUT_DATA_TOGGLE_VAL ^= 1;
-        if(m_end_data_short)
-        {
-            msd_stall_ep_out();
-            m_end_data_short = false;
-            m_msd_state = MSD_WAIT_CLEAR;
-        }
-        else setup_csw();
-    }
-    else msd_arm_ep_out((uint8_t)MSD_BD_OUT_EVEN + MSD_EP_OUT_LAST_PPB);
-    
     #else
+    #if defined(MSD_IMAGE_CRC) && defined(MSD_DIRECT_WRITE)
+    m_write_crc = image_crc(m_write_crc, m_direct_write ? g_msd_sect_data + g_msd_byte_of_sect : g_msd_ep_out, MSD_EP_SIZE);
+    #elif defined(MSD_IMAGE_CRC)
+    m_write_crc = image_crc(m_write_crc, g_msd_ep_out, MSD_EP_SIZE);
+    #endif
+    
     #ifdef MSD_LIMITED_RAM
-    msd_tx_sector();
+    LUN_TX_SECTOR();
+    #elif defined(MSD_WRITE_CACHE)
+    if(g_msd_byte_of_sect == 0 && m_cache_dirty[m_cache_fill]) commit_cache_slot(m_cache_fill); // Slot still holds an older sector.
+    usb_ram_copy(g_msd_ep_out, m_cache_slot[m_cache_fill] + g_msd_byte_of_sect, MSD_EP_SIZE); // Load EP size worth of data from EP to the cache slot.
+    #elif defined(MSD_DIRECT_WRITE)
+    if(!m_direct_write) usb_ram_copy(g_msd_ep_out, g_msd_sect_data + g_msd_byte_of_sect, MSD_EP_SIZE); // Otherwise the SIE already put it there.
     #else
     usb_ram_copy(g_msd_ep_out, g_msd_sect_data + g_msd_byte_of_sect, MSD_EP_SIZE); // Load EP size worth of data from EP to g_msd_sect_data buffer.
     #endif
     g_msd_byte_of_sect += MSD_EP_SIZE;
     if(g_msd_byte_of_sect == BYTES_PER_BLOCK_LE){
-        #ifndef MSD_LIMITED_RAM
-        msd_tx_sector();
+        #ifdef MSD_IMAGE_CRC
+        m_write_sectors++;
+        #endif
+        #ifdef MSD_WRITE_CACHE
+        m_cache_lba[m_cache_fill]   = g_msd_rw_10_vars.LBA; // Sector is committed later by msd_flush_tasks().
+        m_cache_dirty[m_cache_fill] = true;
+        #if MSD_NUM_LUNS > 1
+        m_cache_lun[m_cache_fill]   = g_msd_lun;
+        #endif
+        m_cache_fill ^= 1;
+        #elif defined(MSD_ASYNC_MEDIA)
+        pending = tx_sector_pending();
+        #elif !defined(MSD_LIMITED_RAM)
+        LUN_TX_SECTOR();
         #endif
         g_msd_rw_10_vars.LBA++;
         g_msd_byte_of_sect = 0;
     }
     g_msd_rw_10_vars.TF_LEN_IN_BYTES -= MSD_EP_SIZE;
     g_msd_csw.dCSWDataResidue -= MSD_EP_SIZE;
+    #endif
     
+    #ifdef MSD_ASYNC_MEDIA
+    if(pending)
+    {
+        m_media_resume = RESUME_WRITE_DATA; // Don't arm OUT or send the CSW until the sector is written.
+        return;
+    }
+    #endif
+    next_write_data();
+}
+
+
+static void next_write_data(void)
+{
     if(g_msd_rw_10_vars.TF_LEN_IN_BYTES == 0)
     {
+        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+        USB_NEXT_TOGGLE(MSD_EP_OUT_DATA_TOGGLE_VAL);
+        #endif
         if(m_end_data_short)
         {
             msd_stall_ep_out();
@@ -1150,9 +2158,19 @@ static void service_write10(void)
         }
         else setup_csw();
     }
-    else msd_arm_ep_out();
-    #endif
+    else
+    {
+        #if PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
+        msd_arm_ep_out((uint8_t)MSD_BD_OUT_EVEN + MSD_EP_OUT_LAST_PPB);
+        #else
+        #ifdef MSD_DIRECT_WRITE
+        if(m_direct_write) g_usb_bd_table[MSD_BD_OUT].ADR = USB_RAM_ADDR(g_msd_sect_data + g_msd_byte_of_sect);
+        #endif
+        msd_arm_ep_out();
+        #endif
+    }
 }
+#endif
 
 
 static void invalid_command_sense(void)
@@ -1181,17 +2199,147 @@ static void unit_attention_sense(void)
 #ifdef USE_EXTERNAL_MEDIA
 static bool check_for_media(void)
 {
-    static bool prev_val = false;
     bool return_val;
     
-    return_val = msd_media_present();
+    return_val = LUN_MEDIA_PRESENT();
     
-    if(return_val != prev_val) m_unit_attention = true;
+    if(return_val != m_media_prev)
+    {
+        m_unit_attention = true;
+        #ifdef MSD_READ_PREFETCH
+        m_ahead_valid = false; // Media changed under it.
+        #endif
+    }
     
-    prev_val = return_val;
+    m_media_prev = return_val;
     
     return return_val;
 }
 #endif
 
+#if MSD_NUM_LUNS > 1
+static void select_lun(uint8_t lun)
+{
+    if(lun == g_msd_lun) return;
+    
+    m_lun_state[g_msd_lun].sense_key                       = g_msd_sense_key;
+    m_lun_state[g_msd_lun].additional_sense_code           = g_msd_additional_sense_code;
+    m_lun_state[g_msd_lun].additional_sense_code_qualifier = g_msd_additional_sense_code_qualifier;
+    m_lun_state[g_msd_lun].media_present                   = m_media_present;
+    m_lun_state[g_msd_lun].unit_attention                  = m_unit_attention;
+    m_lun_state[g_msd_lun].media_prev                      = m_media_prev;
+    
+    g_msd_sense_key                       = m_lun_state[lun].sense_key;
+    g_msd_additional_sense_code           = m_lun_state[lun].additional_sense_code;
+    g_msd_additional_sense_code_qualifier = m_lun_state[lun].additional_sense_code_qualifier;
+    m_media_present                       = m_lun_state[lun].media_present;
+    m_unit_attention                      = m_lun_state[lun].unit_attention;
+    m_media_prev                          = m_lun_state[lun].media_prev;
+    
+    g_msd_lun = lun;
+}
+#endif
+
+#ifdef MSD_ASYNC_MEDIA
+static bool rx_sector_pending(void)
+{
+    m_media_busy = true; // Set first, msd_media_complete() may be called before the callback returns.
+    if(LUN_RX_SECTOR() == MSD_MEDIA_DONE)
+    {
+        m_media_busy = false;
+        return false;
+    }
+    return true;
+}
+
+
+#ifdef USE_WRITE_10
+static bool tx_sector_pending(void)
+{
+    m_media_busy = true;
+    if(LUN_TX_SECTOR() == MSD_MEDIA_DONE)
+    {
+        m_media_busy = false;
+        return false;
+    }
+    return true;
+}
+#endif
+#endif
+
+#ifdef MSD_READ_PREFETCH
+static void start_prefetch(void)
+{
+    if(g_msd_rw_10_vars.TF_LEN_IN_BYTES <= BYTES_PER_BLOCK_LE) // Current sector is the last one.
+    {
+        start_read_ahead();
+        return;
+    }
+    
+    m_prefetch_busy = true;
+    LUN_RX_SECTOR_ASYNC(g_msd_rw_10_vars.LBA + 1, m_fill_sect);
+}
+
+
+static void swap_sect_buffers(void)
+{
+    uint8_t *temp;
+    
+    temp         = m_drain_sect;
+    m_drain_sect = m_fill_sect;
+    m_fill_sect  = temp;
+    
+    m_sect_swap_pending = false;
+    start_prefetch();
+}
+
+
+static void start_read_ahead(void)
+{
+    m_ahead_lba   = g_msd_rw_10_vars.LBA + 1;
+    m_ahead_valid = (m_ahead_lba < VOL_CAPACITY_IN_BLOCKS);
+    if(!m_ahead_valid) return;
+    #if MSD_NUM_LUNS > 1
+    m_ahead_lun = g_msd_lun;
+    #endif
+    
+    // msd_tasks() holds the next CBW until it's in, so the buffers stay ours.
+    m_prefetch_busy = true;
+    LUN_RX_SECTOR_ASYNC(m_ahead_lba, m_fill_sect);
+}
+
+
+static bool take_read_ahead(void)
+{
+    uint8_t *temp;
+    bool    hit = m_ahead_valid && (g_msd_rw_10_vars.LBA == m_ahead_lba);
+    
+    #if MSD_NUM_LUNS > 1
+    hit = hit && (m_ahead_lun == g_msd_lun);
+    #endif
+    m_ahead_valid = false;
+    if(!hit) return false;
+    
+    temp         = m_drain_sect;
+    m_drain_sect = m_fill_sect;
+    m_fill_sect  = temp;
+    return true;
+}
+#endif
+
+#ifdef MSD_WRITE_CACHE
+static void commit_cache_slot(uint8_t slot)
+{
+    LUN_COMMIT_SECTOR(m_cache_lun[slot], m_cache_lba[slot], m_cache_slot[slot]);
+    m_cache_dirty[slot] = false;
+}
+
+
+static void flush_cache(void)
+{
+    if(m_cache_dirty[m_cache_fill]) commit_cache_slot(m_cache_fill);
+    if(m_cache_dirty[m_cache_fill ^ 1]) commit_cache_slot(m_cache_fill ^ 1);
+}
+#endif
+
 /******************************************************************************/
\ No newline at end of file
@@ -33,6 +33,7 @@
 #include <stdbool.h>
 #include "usb_config.h"
 #include "usb_hal.h"
+#include "usb.h"
 #include "usb_msd_config.h"
 #include "usb_scsi.h"
 
@@ -48,24 +49,72 @@
 
 
 /* ************************************************************************** */
-/* **************************** MSD EP ADDRESSES **************************** */
+/* *************************** MSD CONFIG CHECKS **************************** */
 /* ************************************************************************** */
 
-#if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_1_15
-#define MSD_EP_BUFFERS_STARTING_ADDR (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE*2))
-#elif PINGPONG_MODE == PINGPONG_0_OUT
-#define MSD_EP_BUFFERS_STARTING_ADDR  (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE*3))
-#else
-#define MSD_EP_BUFFERS_STARTING_ADDR (EP_BUFFERS_STARTING_ADDR + (EP0_SIZE*4))
+#if defined(MSD_DIRECT_WRITE) && (defined(MSD_LIMITED_RAM) || defined(MSD_WRITE_CACHE) || !defined(USE_WRITE_10))
+#error "MSD_DIRECT_WRITE needs USE_WRITE_10 and g_msd_sect_data, it can't be used with MSD_LIMITED_RAM or MSD_WRITE_CACHE."
+#endif
+#if defined(MSD_DIRECT_WRITE) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP)
+#error "MSD_DIRECT_WRITE can't be used when MSD's Endpoints ping-pong."
+#endif
+
+#if defined(MSD_READ_PREFETCH) && defined(MSD_LIMITED_RAM)
+#error "MSD_READ_PREFETCH needs the sector buffers, it can't be used with MSD_LIMITED_RAM."
+#endif
+
+#if defined(MSD_WRITE_CACHE) && (defined(MSD_LIMITED_RAM) || !defined(USE_WRITE_10))
+#error "MSD_WRITE_CACHE needs USE_WRITE_10 and the sector buffers, it can't be used with MSD_LIMITED_RAM."
+#endif
+
+#if defined(MSD_ASYNC_MEDIA) && (defined(MSD_LIMITED_RAM) || defined(MSD_READ_PREFETCH) || defined(MSD_WRITE_CACHE))
+#error "MSD_ASYNC_MEDIA needs the sector buffers, it can't be used with MSD_LIMITED_RAM, MSD_READ_PREFETCH or MSD_WRITE_CACHE."
+#endif
+
+#if defined(MSD_ARENA) && (!defined(USE_ARENA) || defined(MSD_LIMITED_RAM))
+#error "MSD_ARENA needs USE_ARENA and the sector buffers, it can't be used with MSD_LIMITED_RAM."
+#endif
+
+#if defined(USE_VERIFY_10) && defined(MSD_ASYNC_MEDIA)
+#error "USE_VERIFY_10 reads the sectors straight through, it can't be used with MSD_ASYNC_MEDIA."
+#endif
+
+#if defined(MSD_IMAGE_CRC) && (MSD_EP_SIZE < 16)
+#error "MSD_IMAGE_CRC needs MSD_EP_SIZE of at least 16 for the MSD_IMAGE_CRC_CMD response."
+#endif
+
+#if defined(USE_RW_12_16) && (MSD_EP_SIZE < 32)
+#error "USE_RW_12_16 needs MSD_EP_SIZE of at least 32 for the READ_CAPACITY_16 response."
+#endif
+
+#ifndef MSD_NUM_LUNS
+#define MSD_NUM_LUNS 1
+#endif
+#if MSD_NUM_LUNS < 1 || MSD_NUM_LUNS > 16
+#error "MSD_NUM_LUNS must be between 1 and 16."
 #endif
 
+#ifndef MSD_TASK_QUEUE_SIZE
+#define MSD_TASK_QUEUE_SIZE 4
+#endif
+#if MSD_TASK_QUEUE_SIZE < 2 || MSD_TASK_QUEUE_SIZE > 128 || (MSD_TASK_QUEUE_SIZE & (MSD_TASK_QUEUE_SIZE - 1))
+#error "MSD_TASK_QUEUE_SIZE must be a power of two, from 2 to 128."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** MSD EP ADDRESSES **************************** */
+/* ************************************************************************** */
+
 #if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
 #ifdef _PIC14E
 #define MSD_EP_OUT_BUFFER_BASE_ADDR 0x2050
 #define MSD_EP_IN_BUFFER_BASE_ADDR  0x20A0
 #else
-#define MSD_EP_OUT_BUFFER_BASE_ADDR  MSD_EP_BUFFERS_STARTING_ADDR
-#define MSD_EP_IN_BUFFER_BASE_ADDR   (MSD_EP_BUFFERS_STARTING_ADDR + MSD_EP_SIZE)
+#define MSD_EP_OUT_BUFFER_BASE_ADDR EP_OUT_BUFFER_ADDR(MSD_EP)
+#define MSD_EP_IN_BUFFER_BASE_ADDR  EP_IN_BUFFER_ADDR(MSD_EP)
 #endif
 
 #else // PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
@@ -75,10 +124,10 @@
 #define MSD_EP_IN_EVEN_BUFFER_BASE_ADDR  0x20F0
 #define MSD_EP_IN_ODD_BUFFER_BASE_ADDR   0x2140
 #else
-#define MSD_EP_OUT_EVEN_BUFFER_BASE_ADDR   MSD_EP_BUFFERS_STARTING_ADDR
-#define MSD_EP_OUT_ODD_BUFFER_BASE_ADDR   (MSD_EP_BUFFERS_STARTING_ADDR +  MSD_EP_SIZE)
-#define MSD_EP_IN_EVEN_BUFFER_BASE_ADDR   (MSD_EP_BUFFERS_STARTING_ADDR + (MSD_EP_SIZE * 2))
-#define MSD_EP_IN_ODD_BUFFER_BASE_ADDR    (MSD_EP_BUFFERS_STARTING_ADDR + (MSD_EP_SIZE * 3))
+#define MSD_EP_OUT_EVEN_BUFFER_BASE_ADDR EP_OUT_EVEN_BUFFER_ADDR(MSD_EP)
+#define MSD_EP_OUT_ODD_BUFFER_BASE_ADDR  EP_OUT_ODD_BUFFER_ADDR(MSD_EP)
+#define MSD_EP_IN_EVEN_BUFFER_BASE_ADDR  EP_IN_EVEN_BUFFER_ADDR(MSD_EP)
+#define MSD_EP_IN_ODD_BUFFER_BASE_ADDR   EP_IN_ODD_BUFFER_ADDR(MSD_EP)
 #endif
 extern uint8_t MSD_EP_OUT_EVEN[MSD_EP_SIZE]    __at(MSD_EP_OUT_EVEN_BUFFER_BASE_ADDR);
 extern uint8_t MSD_EP_OUT_ODD[MSD_EP_SIZE]     __at(MSD_EP_OUT_ODD_BUFFER_BASE_ADDR);
@@ -86,6 +135,25 @@ extern uint8_t MSD_EP_IN_EVEN[MSD_EP_SIZE]     __at(MSD_EP_IN_EVEN_BUFFER_BASE_A
 extern uint8_t MSD_EP_IN_ODD[MSD_EP_SIZE]      __at(MSD_EP_IN_ODD_BUFFER_BASE_ADDR);
 #endif
 
+#if defined(_PIC14E) && (PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT) && ((MSD_EP_IN_BUFFER_BASE_ADDR + MSD_EP_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "MSD's EP buffers overlap the EP0 buffers, reduce EP0_SIZE."
+#elif defined(_PIC14E) && (PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP) && ((MSD_EP_IN_ODD_BUFFER_BASE_ADDR + MSD_EP_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "MSD's EP buffers overlap the EP0 buffers, reduce EP0_SIZE or MSD_EP_SIZE."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************* MSD LUNS ********************************* */
+/* ************************************************************************** */
+
+#if MSD_NUM_LUNS > 1
+// Each LUN's capacity comes from its g_msd_luns[] entry, leave these out of usb_msd_config.h.
+#define VOL_CAPACITY_IN_BLOCKS (*g_msd_luns[g_msd_lun].p_vol_capacity)
+#define LAST_BLOCK_LE          (VOL_CAPACITY_IN_BLOCKS - 1)
+#endif
+
 /* ************************************************************************** */
 
 
@@ -149,6 +217,56 @@ extern uint8_t MSD_EP_IN_ODD[MSD_EP_SIZE]      __at(MSD_EP_IN_ODD_BUFFER_BASE_AD
 /* ************************************************************************** */
 
 
+/* ************************************************************************** */
+/* ***************************** MSD MEDIA RESULTS ************************** */
+/* ************************************************************************** */
+
+// msd_rx_sector()/msd_tx_sector() return values with MSD_ASYNC_MEDIA
+#define MSD_MEDIA_DONE    0 // Sector has been read/written.
+#define MSD_MEDIA_PENDING 1 // Still going, msd_media_complete() will be called.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** MSD VENDOR COMMANDS *************************** */
+/* ************************************************************************** */
+
+// SCSI opcode in the vendor specific range, with MSD_IMAGE_CRC. The 16 byte 
+// response is four big-endian values: CRC-32 of the sectors WRITE_10 received, 
+// how many there were, then the same for the sectors VERIFY_10 read back. Bit 0
+// of CDB byte 1 clears them after they're read.
+#define MSD_IMAGE_CRC_CMD   0xC0
+#define MSD_IMAGE_CRC_RESET 0x01
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ******************************* MOUNT STATS ****************************** */
+/* ************************************************************************** */
+
+#ifdef MSD_MOUNT_STATS
+#define MSD_MOUNT_UNSUPPORTED 4 // Unsupported opcodes kept, the first ones seen.
+
+/** Mount Stats Type, frames are SOF frame numbers (1ms each, 11 bits) */
+typedef struct
+{
+    uint16_t First_CBW_Frame;  // First CBW after SET_CONFIGURATION.
+    uint16_t First_Read_Frame; // First READ, the host has finished probing and reads the volume.
+    uint16_t Commands;         // CBWs up to the first READ.
+    uint8_t  Failed;           // Commands failed up to the first READ.
+    uint8_t  Stalls;           // Of those, failed with a data stage (a stall and clear halt each).
+    uint8_t  Num_Unsupported;
+    uint8_t  Unsupported[MSD_MOUNT_UNSUPPORTED];
+    bool     CBW_Seen;
+    bool     Read_Seen;
+}msd_mount_stats_t;
+#endif
+
+/* ************************************************************************** */
+
+
 /* ************************************************************************** */
 /* ******************************** MSD STATES ****************************** */
 /* ************************************************************************** */
@@ -184,8 +302,8 @@ extern uint8_t MSD_EP_IN_ODD[MSD_EP_SIZE]      __at(MSD_EP_IN_ODD_BUFFER_BASE_AD
 /* ******************************** MSD HAL ********************************* */
 /* ************************************************************************** */
 
-#define MSD_TRANSACTION_DIR m_tasks_buff.task_stat[m_task_get_index].DIR
-#define MSD_PINGPONG_PARITY m_tasks_buff.task_stat[m_task_get_index].PPBI
+#define MSD_TRANSACTION_DIR m_tasks_buff.task_stat[m_task_tail & (MSD_TASK_QUEUE_SIZE - 1)].DIR
+#define MSD_PINGPONG_PARITY m_tasks_buff.task_stat[m_task_tail & (MSD_TASK_QUEUE_SIZE - 1)].PPBI
 
 #define MSD_EP_OUT_LAST_PPB        g_usb_ep_stat[MSD_EP][OUT].Last_PPB
 #define MSD_EP_IN_LAST_PPB         g_usb_ep_stat[MSD_EP][IN].Last_PPB
@@ -254,7 +372,7 @@ typedef union
     };
 }msd_csw_t;
 
-/** READ_10 Variables Structure */
+/** READ/WRITE (10, 12 and 16) Variables Structure */
 typedef struct
 {
     union
@@ -265,8 +383,8 @@ typedef struct
     uint32_t LBA;
     union
     {
-        uint8_t TF_LEN_BYTES[2];
-        uint16_t TF_LEN;
+        uint8_t TF_LEN_BYTES[4];
+        uint32_t TF_LEN;
     };
     uint32_t TF_LEN_IN_BYTES;
 }msd_rw_10_vars_t;
@@ -282,6 +400,75 @@ typedef union
     };
 }msd_bytes_to_transfer_t;
 
+#if MSD_NUM_LUNS > 1
+/** Media callbacks and capacity of one Logical Unit, see g_msd_luns. */
+typedef struct
+{
+    #ifdef USE_EXTERNAL_MEDIA
+    bool    (*media_present)(void);
+    #endif
+    #ifdef USE_TEST_UNIT_READY
+    uint8_t (*test_unit_ready)(void);
+    #endif
+    #ifdef USE_START_STOP_UNIT
+    uint8_t (*start_stop_unit)(void);
+    #endif
+    #ifdef USE_READ_CAPACITY
+    void    (*read_capacity)(void);
+    #endif
+    #ifdef MSD_ASYNC_MEDIA
+    uint8_t (*rx_sector)(void);
+    #else
+    void    (*rx_sector)(void);
+    #endif
+    #ifdef MSD_READ_PREFETCH
+    void    (*rx_sector_async)(uint32_t lba, uint8_t* p_sect_data);
+    #endif
+    #ifdef USE_WRITE_10
+    #ifdef MSD_WRITE_CACHE
+    void    (*commit_sector)(uint32_t lba, uint8_t* p_sect_data);
+    #elif defined(MSD_ASYNC_MEDIA)
+    uint8_t (*tx_sector)(void);
+    #else
+    void    (*tx_sector)(void);
+    #endif
+    #endif
+    #ifdef USE_WR_PROTECT
+    bool    (*wr_protect)(void);
+    #endif
+    const uint32_t *p_vol_capacity; ///< Capacity in blocks, can point to a variable set once the media's size is known.
+}msd_lun_t;
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ MSD FUNCTION DESCRIPTORS ************************ */
+/* ************************************************************************** */
+
+#ifndef MSD_INT
+#define MSD_INT 0 // MSD Interface Number.
+#endif
+
+typedef struct
+{
+    ch9_standard_interface_descriptor_t interface;
+    ch9_standard_endpoint_descriptor_t  ep_in;
+    ch9_standard_endpoint_descriptor_t  ep_out;
+}msd_function_descriptors_t;
+
+/*
+ * Initializer for msd_function_descriptors_t, see the DESCRIPTOR BUILDER in 
+ * usb_ch9.h. Uses interface MSD_INT and MSD_EP.
+ */
+#define MSD_FUNCTION_DESCRIPTORS() \
+{ \
+    CH9_INTERFACE_DESCRIPTOR(MSD_INT, 0, 2, MSC, SCSI_TRANSPARENT, BBB), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(MSD_EP), EP_BULK, MSD_EP_SIZE, 0), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_OUT_ADDR(MSD_EP), EP_BULK, MSD_EP_SIZE, 0) \
+}
+
 /* ************************************************************************** */
 
 
@@ -289,7 +476,14 @@ typedef union
 /* ****************** MSD GLOBAL VARS FROM: usb_msd_acm.c ******************* */
 /* ************************************************************************** */
 
-#if PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
+#if defined(USB_SIM)
+#define g_msd_ep_out      USB_SIM_AT_ARRAY(uint8_t, MSD_EP_SIZE, MSD_EP_OUT_BUFFER_BASE_ADDR)
+#define g_msd_ep_in       USB_SIM_AT_ARRAY(uint8_t, MSD_EP_SIZE, MSD_EP_IN_BUFFER_BASE_ADDR)
+#define g_msd_ep_out_even USB_SIM_AT_ARRAY(uint8_t, MSD_EP_SIZE, MSD_EP_OUT_EVEN_BUFFER_BASE_ADDR)
+#define g_msd_ep_out_odd  USB_SIM_AT_ARRAY(uint8_t, MSD_EP_SIZE, MSD_EP_OUT_ODD_BUFFER_BASE_ADDR)
+#define g_msd_ep_in_even  USB_SIM_AT_ARRAY(uint8_t, MSD_EP_SIZE, MSD_EP_IN_EVEN_BUFFER_BASE_ADDR)
+#define g_msd_ep_in_odd   USB_SIM_AT_ARRAY(uint8_t, MSD_EP_SIZE, MSD_EP_IN_ODD_BUFFER_BASE_ADDR)
+#elif PINGPONG_MODE == PINGPONG_DIS || PINGPONG_MODE == PINGPONG_0_OUT
 extern uint8_t g_msd_ep_out[MSD_EP_SIZE] __at(MSD_EP_OUT_BUFFER_BASE_ADDR);
 extern uint8_t g_msd_ep_in[MSD_EP_SIZE]  __at(MSD_EP_IN_BUFFER_BASE_ADDR);
 #else // PINGPONG_MODE == PINGPONG_1_15 || PINGPONG_MODE == PINGPONG_ALL_EP
@@ -299,15 +493,50 @@ extern uint8_t g_msd_ep_in_even[MSD_EP_SIZE]  __at(MSD_EP_IN_EVEN_BUFFER_BASE_AD
 extern uint8_t g_msd_ep_in_odd[MSD_EP_SIZE]   __at(MSD_EP_IN_ODD_BUFFER_BASE_ADDR);
 #endif
 
-extern uint16_t g_msd_byte_of_sect;
+extern USB_ACCESS uint16_t g_msd_byte_of_sect;
+#if defined(MSD_ARENA)
+// The sector buffers are the msd state of g_usb_arena, one after the other.
+#ifdef MSD_READ_PREFETCH
+#define MSD_ARENA_CACHE 1024
+#else
+#define MSD_ARENA_CACHE 512
+#endif
+#ifdef MSD_WRITE_CACHE
+#define MSD_ARENA_BYTES (MSD_ARENA_CACHE + 512) // Size the msd state needs.
+#else
+#define MSD_ARENA_BYTES MSD_ARENA_CACHE
+#endif
+#define g_msd_sect_data     USB_ARENA_ARRAY(uint8_t, 512, msd, 0)
+#define g_msd_prefetch_data USB_ARENA_ARRAY(uint8_t, 512, msd, 512)
+#define g_msd_cache_data    USB_ARENA_ARRAY(uint8_t, 512, msd, MSD_ARENA_CACHE)
+#else
 #ifndef MSD_LIMITED_RAM
 extern uint8_t g_msd_sect_data[512];
 #endif
+#ifdef MSD_READ_PREFETCH
+extern uint8_t g_msd_prefetch_data[512];
+#endif
+#ifdef MSD_WRITE_CACHE
+extern uint8_t g_msd_cache_data[512];
+#endif
+#endif
+#if defined(USB_SIM)
+#define g_msd_cbw                USB_SIM_AT(msd_cbw_t, CBW_DATA_ADDR)
+#else
 extern msd_cbw_t                 g_msd_cbw __at(CBW_DATA_ADDR);
+#endif
+extern volatile uint8_t          g_msd_task_overflows; ///< Transactions msd_add_task() had no room for, wraps.
+#if defined(USB_SIM)
+#define g_msd_csw                USB_SIM_AT(msd_csw_t, CBW_DATA_ADDR)
+#else
 extern msd_csw_t                 g_msd_csw;
-extern msd_rw_10_vars_t          g_msd_rw_10_vars;
+#endif
+extern USB_ACCESS msd_rw_10_vars_t g_msd_rw_10_vars;
 extern msd_bytes_to_transfer_t   g_msd_bytes_to_transfer;
 extern scsi_fixed_format_sense_t g_msd_fixed_format_sense;
+#if MSD_NUM_LUNS > 1
+extern uint8_t                   g_msd_lun; ///< LUN of the CBW being serviced, selects the g_msd_luns[] entry.
+#endif
 
 /* ************************************************************************** */
 
@@ -339,7 +568,11 @@ void msd_init(void);
  * 
  * @brief Adds a MSD Task to the queue.
  * 
- * Adds a MSD Task to the queue so that msd_tasks() can service it.
+ * Adds a MSD Task to the queue so that msd_tasks() can service it. The queue
+ * holds MSD_TASK_QUEUE_SIZE tasks. It's a single producer/single consumer 
+ * ring, this is the only writer of its head, so it can be called from the 
+ * USB interrupt while msd_tasks() runs. When full the task is dropped and 
+ * g_msd_task_overflows counted.
  */
 void msd_add_task(void);
 
@@ -353,6 +586,10 @@ void msd_add_task(void);
  * servicing the Control EP when the USTAT buffer has values for MSD_EPs. This
  * can prevent the arming of EP0_OUT in time for a SETUP_PACKET. The host sees
  * this as an error. Place msd_add_task() instead.
+ * 
+ * When there is nothing to do msd_tasks() returns without masking the USB 
+ * interrupt. It's only masked while a task is serviced, as EP0's Clear 
+ * Feature and BOMSR requests change the same BDs and state.
  */
 void msd_tasks(void);
 
@@ -480,16 +717,141 @@ void msd_stall_ep_out(void);
  */
 void msd_stall_ep_in(void);
 
+#ifdef MSD_READ_PREFETCH
+/**
+ * @fn void msd_rx_sector_complete(void)
+ * 
+ * @brief Tells the MSD library a sector started by msd_rx_sector_async() has 
+ * been fetched.
+ * 
+ * Can be called from inside msd_rx_sector_async(), from an interrupt, or from
+ * the main loop. msd_tasks() holds off the next READ_10 IN packet that needs 
+ * the sector, and the next CBW, until this is called. The sector after the 
+ * end of each READ_10 is also asked for, in case the host reads on from there.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * msd_rx_sector_complete();
+ * @endcode
+ * </li></ul>
+ */
+void msd_rx_sector_complete(void);
+#endif
+
+#ifdef MSD_ASYNC_MEDIA
+/**
+ * @fn void msd_media_complete(void)
+ * 
+ * @brief Tells the MSD library the sector msd_rx_sector() or msd_tx_sector() 
+ * returned MSD_MEDIA_PENDING for is done.
+ * 
+ * Can be called from inside the callback, from an interrupt, or from the main
+ * loop. Until then msd_tasks() returns straight away, leaving MSD's Endpoints 
+ * unarmed so the host is NAKed, and g_msd_sect_data belongs to the media. 
+ * The USB interrupt stays enabled, so EP0 and other interfaces keep working.
+ * A WRITE_10's CSW isn't sent until its last sector is done.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * if(flash_write_finished()) msd_media_complete();
+ * @endcode
+ * </li></ul>
+ */
+void msd_media_complete(void);
+#endif
+
+#ifdef MSD_WRITE_CACHE
+/**
+ * @fn void msd_flush_tasks(void)
+ * 
+ * @brief Commits sectors held in the write cache to the media.
+ * 
+ * With MSD_WRITE_CACHE, WRITE_10 sectors are buffered in RAM and the CSW is 
+ * returned without waiting for the media. msd_flush_tasks() must be run 
+ * frequently in your main program loop, next to msd_tasks(). Each call commits
+ * at most one sector with msd_commit_sector(). SYNCHRONIZE_CACHE_10, 
+ * PREVENT_ALLOW_MEDIUM_REMOVAL, START_STOP_UNIT and READ_10 flush the whole 
+ * cache before they complete.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * msd_tasks();
+ * msd_flush_tasks();
+ * @endcode
+ * </li></ul>
+ */
+void msd_flush_tasks(void);
+#endif
+
+#ifdef MSD_MOUNT_STATS
+/**
+ * @fn void msd_get_mount_stats(msd_mount_stats_t* p_stats)
+ * 
+ * @brief Copies the mount trace, restarted by msd_init() at each 
+ * SET_CONFIGURATION.
+ * 
+ * First_Read_Frame - First_CBW_Frame is how long the host spent probing 
+ * before reading the volume, each of Stalls costs a clear halt round trip. 
+ * Unsupported lists the opcodes to look at first.
+ * 
+ * @param[out] p_stats Where to copy the stats.
+ */
+void msd_get_mount_stats(msd_mount_stats_t* p_stats);
+#endif
+
 // TODO: descriptions for these
 // USER FUNCTIONS TO PLACE IN MAIN
 bool    msd_media_present(void);
 uint8_t msd_test_unit_ready(void);
 uint8_t msd_start_stop_unit(void);
 void    msd_read_capacity(void);
+#ifdef MSD_ASYNC_MEDIA
+uint8_t msd_rx_sector(void); // Return MSD_MEDIA_DONE, or MSD_MEDIA_PENDING and call msd_media_complete() once g_msd_sect_data is loaded.
+#else
 void    msd_rx_sector(void);
+#endif
+#ifdef MSD_READ_PREFETCH
+void    msd_rx_sector_async(uint32_t lba, uint8_t* p_sect_data); // Start fetching sector lba into p_sect_data, then call msd_rx_sector_complete().
+#endif
+#ifdef MSD_ASYNC_MEDIA
+uint8_t msd_tx_sector(void); // Return MSD_MEDIA_DONE, or MSD_MEDIA_PENDING and call msd_media_complete() once g_msd_sect_data is written.
+#else
 void    msd_tx_sector(void);
+#endif
+#ifdef MSD_WRITE_CACHE
+void    msd_commit_sector(uint32_t lba, uint8_t* p_sect_data); // Write the cached sector lba to the media. Replaces msd_tx_sector().
+#endif
 bool    msd_wr_protect(void);
 
+#if MSD_NUM_LUNS > 1
+/**
+ * @var const msd_lun_t g_msd_luns[MSD_NUM_LUNS]
+ * 
+ * @brief Per LUN media callbacks, defined by your program in place of the 
+ * functions above.
+ * 
+ * g_msd_lun holds the LUN being serviced while a callback runs, and each LUN
+ * keeps its own sense data and media change state. All LUNs share 
+ * BYTES_PER_BLOCK_LE and the INQUIRY response. GET_MAX_LUN returns 
+ * MSD_NUM_LUNS - 1.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * const msd_lun_t g_msd_luns[MSD_NUM_LUNS] =
+ * {
+ *     {flash_media_present, flash_rx_sector, flash_tx_sector, &g_flash_block_count}, // LUN 0
+ *     {sd_media_present,    sd_rx_sector,    sd_tx_sector,    &g_sd_block_count}     // LUN 1
+ * };
+ * @endcode
+ * </li></ul>
+ */
+extern const msd_lun_t g_msd_luns[MSD_NUM_LUNS];
+#endif
+
 /* ************************************************************************** */
 
 #endif /* USB_MSD_H */
\ No newline at end of file
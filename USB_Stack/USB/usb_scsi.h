@@ -118,7 +118,7 @@
 #define MODE_SELECT_6                0x15 // Optional, not supported.
 #define MODE_SELECT_10               0x55 // Optional, not supported.
 #define MODE_SENSE_6                 0x1A // Optional, supported.      **
-#define MODE_SENSE_10                0x5A // Optional, not supported.
+#define MODE_SENSE_10                0x5A // Optional, supported.      **
 #define MOVE_MEDIUM                  0xA7 // Optional, not supported.
 #define PERSISTANT_RESERVE_IN        0x5E // Optional, not supported.
 #define PERSISTANT_RESERVE_OUT       0x5F // Optional, not supported.
@@ -127,8 +127,8 @@
 #define PREVENT_ALLOW_MEDIUM_REMOVAL 0x1E // Optional, not supported.  **
 #define READ_6                       0x08 // Manditory, not supported.
 #define READ_10                      0x28 // Manditory, supported.     **
-#define READ_12                      0xA8 // Optional, not supported.
-#define READ_16                      0x88 // Manditory, not supported.
+#define READ_12                      0xA8 // Optional, supported.      ** (USE_RW_12_16 only)
+#define READ_16                      0x88 // Manditory, supported.     ** (USE_RW_12_16 only)
 #define READ_BUFFER                  0x3C // Optional, not supported.
 #define READ_CAPACITY                0x25 // Manditory, supported.     **
 #define READ_DEFECT_DATA_10          0x37 // Optional, not supported.
@@ -149,10 +149,11 @@
 #define RESERVE_10                   0x56 // Manditory, not supported.
 #define SEEK_10                      0x2B // Optional, not supported.
 #define SEND_DIAGNOSTIC              0x1D // Manditory, not supported.
+#define SERVICE_ACTION_IN_16         0x9E // Optional, supported.      ** (READ_CAPACITY_16 only)
 #define SET_LIMITS_10                0x33 // Optional, not supported.
 #define SET_LIMITS_12                0xB3 // Optional, not supported.
 #define START_STOP_UNIT              0x1B // Optional, supported.      **
-#define SYNCHRONIZE_CACHE_10         0x35 // Optional, not supported.
+#define SYNCHRONIZE_CACHE_10         0x35 // Optional, supported.      ** (nothing to do without MSD_WRITE_CACHE)
 #define SYNCHRONIZE_CACHE_16         0x91 // Optional, not supported.
 #define TEST_UNIT_READY              0x00 // Manditory, supported.     **
 #define VERIFY_10                    0x2F // Optional, supported.      **
@@ -160,8 +161,8 @@
 #define VERIFY_16                    0x8F // Optional, not supported.
 #define WRITE_6                      0x0A // Optional, not supported.
 #define WRITE_10                     0x2A // Optional, supported.      **
-#define WRITE_12                     0xAA // Optional, not supported.
-#define WRITE_16                     0x8A // Optional, not supported.
+#define WRITE_12                     0xAA // Optional, supported.      ** (USE_RW_12_16 only)
+#define WRITE_16                     0x8A // Optional, supported.      ** (USE_RW_12_16 only)
 #define WRITE_AND_VERIFY_10          0x2E // Optional, not supported.
 #define WRITE_AND_VERIFY_12          0xAE // Optional, not supported.
 #define WRITE_AND_VERIFY_16          0x8E // Optional, not supported.
@@ -181,6 +182,16 @@
 #define XPWRITE_10                   0x51 // Optional, not supported.
 #define XPWRITE_32                   0x7F // Optional, not supported.
 
+// MMC/UFI Commands Windows and macOS send a disk as well
+#define READ_FORMAT_CAPACITIES       0x23 // Supported.                **
+
+// READ_FORMAT_CAPACITIES Descriptor Codes
+#define FORMATTED_MEDIA              0x02
+#define NO_MEDIA_PRESENT             0x03
+
+// SERVICE_ACTION_IN_16 Service Actions
+#define READ_CAPACITY_16             0x10 // Manditory, supported.     ** (USE_RW_12_16 only)
+
 /* ************************************************************************** */
 
 
@@ -308,6 +319,53 @@ typedef struct
     uint8_t CONTROL;
 }scsi_read_10_cmd_t;
 
+// 0x9E/0x10 Read Capacity (16) Command
+typedef struct
+{
+    uint8_t OPERATION_CODE;
+    unsigned SERVICE_ACTION: 5;
+    unsigned: 3;
+    uint8_t LOGICAL_BLOCK_ADDRESS_BYTES[8];
+    uint8_t ALLOCATION_LENGTH_BYTES[4];
+    unsigned PMI: 1;
+    unsigned: 7;
+    uint8_t CONTROL;
+}scsi_read_capacity_16_cmd_t;
+
+// 0xA8 READ (12) Command, WRITE (12) 0xAA has the same layout.
+typedef struct
+{
+    uint8_t OPERATION_CODE;
+    unsigned: 1;
+    unsigned FUA_NV: 1;
+    unsigned: 1;
+    unsigned FUA: 1;
+    unsigned DPO: 1;
+    unsigned RDPROTECT: 3;
+    uint8_t LBA_BYTES[4];
+    uint8_t TF_LEN_BYTES[4];
+    unsigned GROUP_NUMBER: 5;
+    unsigned: 3;
+    uint8_t CONTROL;
+}scsi_read_12_cmd_t;
+
+// 0x88 READ (16) Command, WRITE (16) 0x8A has the same layout.
+typedef struct
+{
+    uint8_t OPERATION_CODE;
+    unsigned: 1;
+    unsigned FUA_NV: 1;
+    unsigned: 1;
+    unsigned FUA: 1;
+    unsigned DPO: 1;
+    unsigned RDPROTECT: 3;
+    uint8_t LBA_BYTES[8];
+    uint8_t TF_LEN_BYTES[4];
+    unsigned GROUP_NUMBER: 5;
+    unsigned: 3;
+    uint8_t CONTROL;
+}scsi_read_16_cmd_t;
+
 //0x2A Write (10) Command
 typedef struct
 {
@@ -0,0 +1,237 @@
+/**
+ * @file usb_vendor.c
+ * @brief Contains <i>Vendor Class</i> bulk streaming functions.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Vendor Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "usb.h"
+#include "usb_vendor.h"
+#include "usb_ch9.h"
+
+/* ************************************************************************** */
+/* ************************* VENDOR EP BUFFERS ****************************** */
+/* ************************************************************************** */
+
+uint8_t g_vendor_ep_out_even[VENDOR_EP_SIZE] __at(VENDOR_EP_OUT_EVEN_BUFFER_BASE_ADDR);
+uint8_t g_vendor_ep_out_odd[VENDOR_EP_SIZE]  __at(VENDOR_EP_OUT_ODD_BUFFER_BASE_ADDR);
+uint8_t g_vendor_ep_in_even[VENDOR_EP_SIZE]  __at(VENDOR_EP_IN_EVEN_BUFFER_BASE_ADDR);
+uint8_t g_vendor_ep_in_odd[VENDOR_EP_SIZE]   __at(VENDOR_EP_IN_ODD_BUFFER_BASE_ADDR);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ****************************** LOCAL VARS ******************************** */
+/* ************************************************************************** */
+
+static uint8_t m_out_ppb; // Next OUT buffer the Application reads.
+static uint8_t m_in_ppb;  // Next IN buffer the Application writes.
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ LOCAL FUNCTION PROTOTYPES *********************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void arm_out(uint8_t ppb)
+ * 
+ * @brief Arms an OUT buffer, the Data Toggle is moved on straight away as both 
+ * buffers are owned by the SIE at once.
+ * 
+ * @param[in] ppb EVEN or ODD buffer.
+ */
+static void arm_out(uint8_t ppb);
+
+/**
+ * @fn void arm_in(uint8_t ppb, uint8_t cnt)
+ * 
+ * @brief Arms an IN buffer, the Data Toggle is moved on straight away as both 
+ * buffers are owned by the SIE at once.
+ * 
+ * @param[in] ppb EVEN or ODD buffer.
+ * @param[in] cnt Amount of bytes to send.
+ */
+static void arm_in(uint8_t ppb, uint8_t cnt);
+
+/**
+ * @fn void reset_out(void)
+ * 
+ * @brief Drops every OUT buffer and arms both again from DATA0, starting with 
+ * the buffer the SIE uses next.
+ */
+static void reset_out(void);
+
+/**
+ * @fn void reset_in(void)
+ * 
+ * @brief Drops every IN buffer not sent yet, the next one written is the buffer 
+ * the SIE uses next.
+ */
+static void reset_in(void);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* *************************** VENDOR FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+void vendor_init(void)
+{
+    g_usb_bd_table[VENDOR_BD_OUT_EVEN].STAT = 0;
+    g_usb_bd_table[VENDOR_BD_OUT_EVEN].ADR  = VENDOR_EP_OUT_EVEN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[VENDOR_BD_OUT_ODD].STAT  = 0;
+    g_usb_bd_table[VENDOR_BD_OUT_ODD].ADR   = VENDOR_EP_OUT_ODD_BUFFER_BASE_ADDR;
+    g_usb_bd_table[VENDOR_BD_IN_EVEN].STAT  = 0;
+    g_usb_bd_table[VENDOR_BD_IN_EVEN].ADR   = VENDOR_EP_IN_EVEN_BUFFER_BASE_ADDR;
+    g_usb_bd_table[VENDOR_BD_IN_ODD].STAT   = 0;
+    g_usb_bd_table[VENDOR_BD_IN_ODD].ADR    = VENDOR_EP_IN_ODD_BUFFER_BASE_ADDR;
+    
+    // EP Settings
+    VENDOR_UEPbits.EPHSHK   = 1; // Handshaking enabled 
+    VENDOR_UEPbits.EPCONDIS = 0; // Don't allow SETUP
+    VENDOR_UEPbits.EPOUTEN  = 1; // EP output enabled
+    VENDOR_UEPbits.EPINEN   = 1; // EP input enabled
+    
+    g_usb_ep_stat[VENDOR_EP][OUT].Halt = 0;
+    g_usb_ep_stat[VENDOR_EP][IN].Halt  = 0;
+    
+    reset_out();
+    reset_in();
+}
+
+void vendor_tasks(void)
+{
+    if(TRANSACTION_DIR == IN) vendor_in_tasks();
+    else vendor_out_tasks();
+}
+
+void vendor_out_tasks(void)
+{
+    // Data Toggle was moved on when armed, only the SIE's position is kept.
+    VENDOR_EP_OUT_LAST_PPB = PINGPONG_PARITY;
+}
+
+void vendor_in_tasks(void)
+{
+    VENDOR_EP_IN_LAST_PPB = PINGPONG_PARITY;
+}
+
+void vendor_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+{
+    g_usb_ep_stat[ep][dir].Halt = 0;
+    if(dir == OUT) reset_out();
+    else reset_in();
+}
+
+void vendor_clear_ep_toggle(void)
+{
+    reset_out();
+    reset_in();
+}
+
+uint8_t* vendor_peek_out(uint8_t* p_cnt)
+{
+    bd_t* p_bd = &g_usb_bd_table[EP_BD_INDEX(VENDOR_EP, OUT, m_out_ppb)];
+    
+    if(p_bd->STAT & _UOWN) return NULL;
+    *p_cnt = p_bd->CNT;
+    return USB_RAM_PTR(p_bd->ADR);
+}
+
+void vendor_release_out(void)
+{
+    if(g_usb_ep_stat[VENDOR_EP][OUT].Halt) return;
+    arm_out(m_out_ppb);
+    m_out_ppb ^= 1;
+}
+
+uint8_t* vendor_acquire_in(void)
+{
+    bd_t* p_bd = &g_usb_bd_table[EP_BD_INDEX(VENDOR_EP, IN, m_in_ppb)];
+    
+    if(p_bd->STAT & _UOWN) return NULL;
+    return USB_RAM_PTR(p_bd->ADR);
+}
+
+void vendor_commit_in(uint8_t cnt)
+{
+    if(g_usb_ep_stat[VENDOR_EP][IN].Halt) return;
+    arm_in(m_in_ppb, cnt);
+    m_in_ppb ^= 1;
+}
+
+bool vendor_in_idle(void)
+{
+    if(g_usb_bd_table[VENDOR_BD_IN_EVEN].STAT & _UOWN) return false;
+    if(g_usb_bd_table[VENDOR_BD_IN_ODD].STAT & _UOWN) return false;
+    return true;
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** LOCAL FUNCTIONS ***************************** */
+/* ************************************************************************** */
+
+static void arm_out(uint8_t ppb)
+{
+    usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(VENDOR_EP, OUT, ppb)], &g_usb_ep_stat[VENDOR_EP][OUT], VENDOR_EP_SIZE);
+    USB_NEXT_TOGGLE(VENDOR_EP_OUT_DATA_TOGGLE_VAL);
+}
+
+static void arm_in(uint8_t ppb, uint8_t cnt)
+{
+    usb_arm_endpoint(&g_usb_bd_table[EP_BD_INDEX(VENDOR_EP, IN, ppb)], &g_usb_ep_stat[VENDOR_EP][IN], cnt);
+    USB_NEXT_TOGGLE(VENDOR_EP_IN_DATA_TOGGLE_VAL);
+}
+
+static void reset_out(void)
+{
+    g_usb_bd_table[VENDOR_BD_OUT_EVEN].STAT = 0;
+    g_usb_bd_table[VENDOR_BD_OUT_ODD].STAT  = 0;
+    VENDOR_EP_OUT_DATA_TOGGLE_VAL = 0;
+    
+    // Only completed transactions move the SIE on, it uses the buffer after the last one.
+    m_out_ppb = VENDOR_EP_OUT_LAST_PPB ^ 1;
+    arm_out(m_out_ppb);
+    arm_out(m_out_ppb ^ 1);
+}
+
+static void reset_in(void)
+{
+    g_usb_bd_table[VENDOR_BD_IN_EVEN].STAT = 0;
+    g_usb_bd_table[VENDOR_BD_IN_ODD].STAT  = 0;
+    VENDOR_EP_IN_DATA_TOGGLE_VAL = 0;
+    m_in_ppb = VENDOR_EP_IN_LAST_PPB ^ 1;
+}
+
+/* ************************************************************************** */
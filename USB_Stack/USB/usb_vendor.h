@@ -0,0 +1,268 @@
+/**
+ * @file usb_vendor.h
+ * @brief <i>Vendor Class</i> bulk streaming settings, global variable and function declarations.
+ * @author John Izzard
+ * @date 2024-11-14
+ * 
+ * USB uC - Vendor Library.
+ * Copyright (C) 2017-2024 John Izzard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef USB_VENDOR_H
+#define USB_VENDOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usb_config.h"
+#include "usb_hal.h"
+#include "usb.h"
+#include "usb_vendor_config.h"
+
+/*
+ * Raw bulk IN and OUT on VENDOR_EP, both ping-pong buffers of each direction 
+ * are kept armed so the host can send or read a packet every transaction slot. 
+ * The Application works straight in USB RAM:
+ * 
+ * OUT: vendor_peek_out() gives the oldest received packet, vendor_release_out() 
+ *      arms its buffer again.
+ * IN:  vendor_acquire_in() gives the next free IN buffer, vendor_commit_in() 
+ *      arms it. A packet shorter than VENDOR_EP_SIZE (or zero length) ends the 
+ *      host's read.
+ * 
+ * Both calls only look at the BDs' UOWN bits, so they can be used from the 
+ * main loop while usb_tasks() runs in the interrupt.
+ */
+
+/* ************************************************************************** */
+/* ************************** WARNING FOR PINGPONG ************************** */
+/* ************************************************************************** */
+
+#if (PINGPONG_MODE != PINGPONG_1_15) && (PINGPONG_MODE != PINGPONG_ALL_EP)
+#error "The Vendor library keeps both ping-pong buffers of VENDOR_EP armed, PINGPONG_1_15 or PINGPONG_ALL_EP must be used."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************** VENDOR EP ADDRESSES *************************** */
+/* ************************************************************************** */
+
+#ifdef _PIC14E
+#define VENDOR_EP_OUT_EVEN_BUFFER_BASE_ADDR 0x2050
+#define VENDOR_EP_OUT_ODD_BUFFER_BASE_ADDR  0x20A0
+#define VENDOR_EP_IN_EVEN_BUFFER_BASE_ADDR  0x20F0
+#define VENDOR_EP_IN_ODD_BUFFER_BASE_ADDR   0x2140
+#else
+#define VENDOR_EP_OUT_EVEN_BUFFER_BASE_ADDR EP_OUT_EVEN_BUFFER_ADDR(VENDOR_EP)
+#define VENDOR_EP_OUT_ODD_BUFFER_BASE_ADDR  EP_OUT_ODD_BUFFER_ADDR(VENDOR_EP)
+#define VENDOR_EP_IN_EVEN_BUFFER_BASE_ADDR  EP_IN_EVEN_BUFFER_ADDR(VENDOR_EP)
+#define VENDOR_EP_IN_ODD_BUFFER_BASE_ADDR   EP_IN_ODD_BUFFER_ADDR(VENDOR_EP)
+#endif
+
+#if defined(_PIC14E) && ((VENDOR_EP_IN_ODD_BUFFER_BASE_ADDR + VENDOR_EP_SIZE) > EP0_BUFFERS_LOW_ADDR)
+#error "Vendor's EP buffers overlap the EP0 buffers, reduce EP0_SIZE."
+#endif
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ***************************** VENDOR EP STAT ***************************** */
+/* ************************************************************************** */
+
+#define VENDOR_EP_OUT_LAST_PPB        g_usb_ep_stat[VENDOR_EP][OUT].Last_PPB
+#define VENDOR_EP_IN_LAST_PPB         g_usb_ep_stat[VENDOR_EP][IN].Last_PPB
+#define VENDOR_EP_OUT_DATA_TOGGLE_VAL g_usb_ep_stat[VENDOR_EP][OUT].Data_Toggle_Val
+#define VENDOR_EP_IN_DATA_TOGGLE_VAL  g_usb_ep_stat[VENDOR_EP][IN].Data_Toggle_Val
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ********************** VENDOR FUNCTION DESCRIPTORS *********************** */
+/* ************************************************************************** */
+
+/// Vendor function, one interface with a bulk OUT and IN Endpoint.
+typedef struct
+{
+    ch9_standard_interface_descriptor_t interface;
+    ch9_standard_endpoint_descriptor_t  ep_out;
+    ch9_standard_endpoint_descriptor_t  ep_in;
+}vendor_function_descriptors_t;
+
+#define VENDOR_FUNCTION_DESCRIPTORS() \
+{ \
+    CH9_INTERFACE_DESCRIPTOR(VENDOR_INT, 0, 2, VENDOR_CLASS, 0, 0), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_OUT_ADDR(VENDOR_EP), EP_BULK, VENDOR_EP_SIZE, 0), \
+    CH9_ENDPOINT_DESCRIPTOR(EP_IN_ADDR(VENDOR_EP), EP_BULK, VENDOR_EP_SIZE, 0) \
+}
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* ************************ VARS FROM: usb_vendor.c ************************* */
+/* ************************************************************************** */
+
+extern uint8_t g_vendor_ep_out_even[VENDOR_EP_SIZE] __at(VENDOR_EP_OUT_EVEN_BUFFER_BASE_ADDR);
+extern uint8_t g_vendor_ep_out_odd[VENDOR_EP_SIZE]  __at(VENDOR_EP_OUT_ODD_BUFFER_BASE_ADDR);
+extern uint8_t g_vendor_ep_in_even[VENDOR_EP_SIZE]  __at(VENDOR_EP_IN_EVEN_BUFFER_BASE_ADDR);
+extern uint8_t g_vendor_ep_in_odd[VENDOR_EP_SIZE]   __at(VENDOR_EP_IN_ODD_BUFFER_BASE_ADDR);
+
+/* ************************************************************************** */
+
+
+/* ************************************************************************** */
+/* **************************** VENDOR FUNCTIONS **************************** */
+/* ************************************************************************** */
+
+/**
+ * @fn void vendor_init(void)
+ * 
+ * @brief Used to initialize the EP used by the Vendor library.
+ * 
+ * EP settings are configured, the Buffer Descriptor Table values are setup, and 
+ * both OUT buffers are armed.
+ */
+void vendor_init(void);
+
+/**
+ * @fn void vendor_tasks(void)
+ * 
+ * @brief Services a completed transaction on VENDOR_EP.
+ */
+void vendor_tasks(void);
+
+/**
+ * @fn void vendor_out_tasks(void)
+ * 
+ * @brief Services a completed transaction on the Vendor OUT Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void vendor_out_tasks(void);
+
+/**
+ * @fn void vendor_in_tasks(void)
+ * 
+ * @brief Services a completed transaction on the Vendor IN Endpoint.
+ * 
+ * Can be placed directly in g_usb_ep_handlers when USE_EP_HANDLER_TABLE is used.
+ */
+void vendor_in_tasks(void);
+
+/**
+ * @fn void vendor_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir)
+ * 
+ * @brief Clears a halt on the Vendor Endpoint.
+ * 
+ * Received packets not yet released are dropped, the OUT buffers are armed 
+ * again from DATA0 and IN starts again from DATA0.
+ * 
+ * @param[in] bdt_index Buffer Descriptor Index.
+ * @param[in] ep Endpoint number.
+ * @param[in] dir Endpoint direction.
+ */
+void vendor_clear_halt(uint8_t bdt_index, uint8_t ep, uint8_t dir);
+
+/**
+ * @fn void vendor_clear_ep_toggle(void)
+ * 
+ * @brief Restarts both directions from DATA0, used on SET_INTERFACE.
+ */
+void vendor_clear_ep_toggle(void);
+
+/**
+ * @fn uint8_t* vendor_peek_out(uint8_t* p_cnt)
+ * 
+ * @brief Gets the oldest received OUT packet.
+ * 
+ * @param[out] p_cnt Amount of bytes received.
+ * 
+ * @return Returns a pointer to the packet in USB RAM, or NULL if nothing has 
+ * been received.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t  cnt;
+ * uint8_t* p_data;
+ * while((p_data = vendor_peek_out(&cnt)) != NULL)
+ * {
+ *     dac_write(p_data, cnt);
+ *     vendor_release_out();
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* vendor_peek_out(uint8_t* p_cnt);
+
+/**
+ * @fn void vendor_release_out(void)
+ * 
+ * @brief Arms the buffer from vendor_peek_out() to receive again.
+ */
+void vendor_release_out(void);
+
+/**
+ * @fn uint8_t* vendor_acquire_in(void)
+ * 
+ * @brief Gets the next IN buffer to write a packet into.
+ * 
+ * @return Returns a pointer to VENDOR_EP_SIZE bytes of USB RAM, or NULL if both 
+ * IN buffers are still armed.
+ * 
+ * <b>Code Example:</b>
+ * <ul style="list-style-type:none"><li>
+ * @code
+ * uint8_t* p_data;
+ * while((p_data = vendor_acquire_in()) != NULL)
+ * {
+ *     adc_read_block(p_data, VENDOR_EP_SIZE);
+ *     vendor_commit_in(VENDOR_EP_SIZE);
+ * }
+ * @endcode
+ * </li></ul>
+ */
+uint8_t* vendor_acquire_in(void);
+
+/**
+ * @fn void vendor_commit_in(uint8_t cnt)
+ * 
+ * @brief Arms the buffer from vendor_acquire_in() to send cnt bytes.
+ * 
+ * @param[in] cnt Amount of bytes written, 0 sends a zero length packet.
+ */
+void vendor_commit_in(uint8_t cnt);
+
+/**
+ * @fn bool vendor_in_idle(void)
+ * 
+ * @brief Lets the Application know every IN packet has been sent.
+ * 
+ * @return Returns true if neither IN buffer is armed.
+ */
+bool vendor_in_idle(void);
+
+/* ************************************************************************** */
+
+#endif /* USB_VENDOR_H */